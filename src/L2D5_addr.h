@@ -0,0 +1,70 @@
+/*
+ * File:        src/L2D5_addr.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 16-byte node address helpers for Radio_ORBIT.
+ *    Compare / hash / copy used by every table keyed on NodeAddr.
+ *
+ */
+
+#ifndef L2D5_ADDR_H
+#define L2D5_ADDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5ADDR_BYTES 16
+
+
+static inline bool L2D5ADDR_equal(const uint8_t *_a, const uint8_t *_b) {
+  uint64_t a0, a1, b0, b1;
+  memcpy(&a0, _a, 8);
+  memcpy(&a1, _a + 8, 8);
+  memcpy(&b0, _b, 8);
+  memcpy(&b1, _b + 8, 8);
+  return ((a0 ^ b0) | (a1 ^ b1)) == 0;
+}
+
+static inline bool L2D5ADDR_is_broadcast(const uint8_t *_a) {
+  uint64_t a0, a1;
+  memcpy(&a0, _a, 8);
+  memcpy(&a1, _a + 8, 8);
+  return (a0 & a1) == UINT64_MAX;
+}
+
+/* 64-bit mixer (splitmix64 finalizer) */
+static inline uint64_t L2D5ADDR_mix64(uint64_t _x) {
+  _x ^= _x >> 30;
+  _x *= 0xBF58476D1CE4E5B9ull;
+  _x ^= _x >> 27;
+  _x *= 0x94D049BB133111EBull;
+  _x ^= _x >> 31;
+  return _x;
+}
+
+static inline uint32_t L2D5ADDR_mix32(uint32_t _x) {
+  return (uint32_t)(L2D5ADDR_mix64(_x) >> 32);
+}
+
+static inline uint64_t L2D5ADDR_hash(const uint8_t *_a) {
+  uint64_t a0, a1;
+  memcpy(&a0, _a, 8);
+  memcpy(&a1, _a + 8, 8);
+  return L2D5ADDR_mix64(a0 ^ L2D5ADDR_mix64(a1 + 0x9E3779B97F4A7C15ull));
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_ADDR_H
@@ -0,0 +1,298 @@
+/*
+ * File:        src/L2D5_aes.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 multi-buffer AES-256-CBC-CTS (CS1) kernels for Radio_ORBIT.
+ *    See L2D5_aes.h
+ *
+ *
+ *  CBC-CS1, len = 16*m + d (0 <= d < 16):
+ *
+ *    C[i]  = E(P[i] ^ C[i-1]),  C[0] = IV,  i = 1 .. m
+ *    d == 0: out = C[1] .. C[m]
+ *    d  > 0: Cn = E(C[m] ^ (P[m+1] || 0...0))
+ *            out = C[1] .. C[m-1] || first d bytes of C[m] || Cn
+ *
+ */
+
+#include "L2D5_aes.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define L2D5AES_HAVE_AESNI 1
+#endif
+
+
+#ifdef L2D5AES_HAVE_AESNI
+
+bool L2D5Aes_available(void) {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+}
+
+#define AES_TARGET __attribute__((target("aes,sse2")))
+
+AES_TARGET
+static inline __m128i expand_step1(__m128i t1, __m128i t2) {
+  __m128i t4;
+  t2 = _mm_shuffle_epi32(t2, 0xFF);
+  t4 = _mm_slli_si128(t1, 4);
+  t1 = _mm_xor_si128(t1, t4);
+  t4 = _mm_slli_si128(t4, 4);
+  t1 = _mm_xor_si128(t1, t4);
+  t4 = _mm_slli_si128(t4, 4);
+  t1 = _mm_xor_si128(t1, t4);
+  return _mm_xor_si128(t1, t2);
+}
+
+AES_TARGET
+static inline __m128i expand_step2(__m128i t1, __m128i t3) {
+  __m128i t2, t4;
+  t4 = _mm_aeskeygenassist_si128(t1, 0x00);
+  t2 = _mm_shuffle_epi32(t4, 0xAA);
+  t4 = _mm_slli_si128(t3, 4);
+  t3 = _mm_xor_si128(t3, t4);
+  t4 = _mm_slli_si128(t4, 4);
+  t3 = _mm_xor_si128(t3, t4);
+  t4 = _mm_slli_si128(t4, 4);
+  t3 = _mm_xor_si128(t3, t4);
+  return _mm_xor_si128(t3, t2);
+}
+
+#define EXPAND_ROUND(_i, _rcon)                                   \
+  do {                                                            \
+    t1 = expand_step1(t1, _mm_aeskeygenassist_si128(t3, _rcon));  \
+    rk[_i] = t1;                                                  \
+    t3 = expand_step2(t1, t3);                                    \
+    rk[_i + 1] = t3;                                              \
+  } while (0)
+
+AES_TARGET
+void L2D5Aes_expand(const uint8_t *_key, L2D5AesKey_t *_out) {
+  __m128i rk[L2D5AES_ROUNDS + 1];
+  __m128i t1 = _mm_loadu_si128((const __m128i *)_key);
+  __m128i t3 = _mm_loadu_si128((const __m128i *)(_key + 16));
+
+  rk[0] = t1;
+  rk[1] = t3;
+  EXPAND_ROUND(2,  0x01);
+  EXPAND_ROUND(4,  0x02);
+  EXPAND_ROUND(6,  0x04);
+  EXPAND_ROUND(8,  0x08);
+  EXPAND_ROUND(10, 0x10);
+  EXPAND_ROUND(12, 0x20);
+  t1 = expand_step1(t1, _mm_aeskeygenassist_si128(t3, 0x40));
+  rk[14] = t1;
+
+  for (int i = 0; i <= L2D5AES_ROUNDS; i++) {
+    _mm_store_si128((__m128i *)_out->enc[i], rk[i]);
+  }
+  _mm_store_si128((__m128i *)_out->dec[0], rk[L2D5AES_ROUNDS]);
+  for (int i = 1; i < L2D5AES_ROUNDS; i++) {
+    _mm_store_si128((__m128i *)_out->dec[i], _mm_aesimc_si128(rk[L2D5AES_ROUNDS - i]));
+  }
+  _mm_store_si128((__m128i *)_out->dec[L2D5AES_ROUNDS], rk[0]);
+}
+
+#define RK(_keys, _l, _dir, _r) _mm_load_si128((const __m128i *)(_keys)[_l]->_dir[_r])
+
+#define AES_INLINE AES_TARGET static inline __attribute__((always_inline))
+
+/* One block per lane, all lanes in flight together */
+AES_INLINE
+void lanes_encrypt(__m128i *_x, const L2D5AesKey_t *const *_keys, size_t _n) {
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    _x[l] = _mm_xor_si128(_x[l], RK(_keys, l, enc, 0));
+  }
+  for (int r = 1; r < L2D5AES_ROUNDS; r++) {
+    #pragma GCC unroll 8
+    for (size_t l = 0; l < _n; l++) {
+      _x[l] = _mm_aesenc_si128(_x[l], RK(_keys, l, enc, r));
+    }
+  }
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    _x[l] = _mm_aesenclast_si128(_x[l], RK(_keys, l, enc, L2D5AES_ROUNDS));
+  }
+}
+
+AES_INLINE
+void lanes_decrypt(__m128i *_x, const L2D5AesKey_t *const *_keys, size_t _n) {
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    _x[l] = _mm_xor_si128(_x[l], RK(_keys, l, dec, 0));
+  }
+  for (int r = 1; r < L2D5AES_ROUNDS; r++) {
+    #pragma GCC unroll 8
+    for (size_t l = 0; l < _n; l++) {
+      _x[l] = _mm_aesdec_si128(_x[l], RK(_keys, l, dec, r));
+    }
+  }
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    _x[l] = _mm_aesdeclast_si128(_x[l], RK(_keys, l, dec, L2D5AES_ROUNDS));
+  }
+}
+
+AES_INLINE
+void cts_encrypt_lanes(const L2D5AesKey_t *const *_keys, const uint8_t *const *_ivs,
+                       const uint8_t *const *_in, uint8_t *const *_out,
+                       size_t _n, size_t _len) {
+  __m128i x[L2D5AES_LANES];
+  size_t m = _len / 16, d = _len % 16;
+
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    x[l] = _mm_loadu_si128((const __m128i *)_ivs[l]);
+  }
+  for (size_t b = 0; b < m; b++) {
+    #pragma GCC unroll 8
+    for (size_t l = 0; l < _n; l++) {
+      x[l] = _mm_xor_si128(x[l], _mm_loadu_si128((const __m128i *)(_in[l] + 16 * b)));
+    }
+    lanes_encrypt(x, _keys, _n);
+    /* with d > 0, C[m] stays in x: only its first d bytes reach the output */
+    if (b < m - 1 || d == 0) {
+      #pragma GCC unroll 8
+      for (size_t l = 0; l < _n; l++) {
+        _mm_storeu_si128((__m128i *)(_out[l] + 16 * b), x[l]);
+      }
+    }
+  }
+  if (d == 0) {
+    return;
+  }
+
+  uint8_t cm[L2D5AES_LANES][16];
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    uint8_t pad[16] = {0};
+    memcpy(pad, _in[l] + 16 * m, d);
+    _mm_storeu_si128((__m128i *)cm[l], x[l]);
+    x[l] = _mm_xor_si128(x[l], _mm_loadu_si128((const __m128i *)pad));
+  }
+  lanes_encrypt(x, _keys, _n);
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    memcpy(_out[l] + 16 * (m - 1), cm[l], d);
+    _mm_storeu_si128((__m128i *)(_out[l] + 16 * (m - 1) + d), x[l]);
+  }
+}
+
+AES_INLINE
+void cts_decrypt_lanes(const L2D5AesKey_t *const *_keys, const uint8_t *const *_ivs,
+                       const uint8_t *const *_in, uint8_t *const *_out,
+                       size_t _n, size_t _len) {
+  __m128i x[L2D5AES_LANES], prev[L2D5AES_LANES], c[L2D5AES_LANES];
+  size_t m = _len / 16, d = _len % 16;
+  size_t full = d ? m - 1 : m;
+
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    prev[l] = _mm_loadu_si128((const __m128i *)_ivs[l]);
+  }
+  for (size_t b = 0; b < full; b++) {
+    #pragma GCC unroll 8
+    for (size_t l = 0; l < _n; l++) {
+      c[l] = _mm_loadu_si128((const __m128i *)(_in[l] + 16 * b));
+      x[l] = c[l];
+    }
+    lanes_decrypt(x, _keys, _n);
+    #pragma GCC unroll 8
+    for (size_t l = 0; l < _n; l++) {
+      _mm_storeu_si128((__m128i *)(_out[l] + 16 * b), _mm_xor_si128(x[l], prev[l]));
+      prev[l] = c[l];
+    }
+  }
+  if (d == 0) {
+    return;
+  }
+
+  /* z = D(Cn) = C[m] ^ (P[m+1] || 0); C[m] = C[m]* || z[d..15] */
+  uint8_t cm[L2D5AES_LANES][16], z[L2D5AES_LANES][16];
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    memcpy(cm[l], _in[l] + 16 * (m - 1), d);
+    x[l] = _mm_loadu_si128((const __m128i *)(_in[l] + 16 * (m - 1) + d));
+  }
+  lanes_decrypt(x, _keys, _n);
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    _mm_storeu_si128((__m128i *)z[l], x[l]);
+    memcpy(cm[l] + d, z[l] + d, 16 - d);
+    x[l] = _mm_loadu_si128((const __m128i *)cm[l]);
+  }
+  lanes_decrypt(x, _keys, _n);
+  #pragma GCC unroll 8
+  for (size_t l = 0; l < _n; l++) {
+    _mm_storeu_si128((__m128i *)(_out[l] + 16 * (m - 1)), _mm_xor_si128(x[l], prev[l]));
+    for (size_t k = 0; k < d; k++) {
+      _out[l][16 * m + k] = z[l][k] ^ cm[l][k];
+    }
+  }
+}
+
+/* Constant lane counts let the lane loops unroll and keep every lane in a register */
+AES_TARGET
+void L2D5Aes_cts_encrypt_lanes(const L2D5AesKey_t *const *_keys, const uint8_t *const *_ivs,
+                               const uint8_t *const *_in, uint8_t *const *_out,
+                               size_t _n, size_t _len) {
+  switch (_n) {
+    case 1: cts_encrypt_lanes(_keys, _ivs, _in, _out, 1, _len); break;
+    case 2: cts_encrypt_lanes(_keys, _ivs, _in, _out, 2, _len); break;
+    case 3: cts_encrypt_lanes(_keys, _ivs, _in, _out, 3, _len); break;
+    case 4: cts_encrypt_lanes(_keys, _ivs, _in, _out, 4, _len); break;
+    case 5: cts_encrypt_lanes(_keys, _ivs, _in, _out, 5, _len); break;
+    case 6: cts_encrypt_lanes(_keys, _ivs, _in, _out, 6, _len); break;
+    case 7: cts_encrypt_lanes(_keys, _ivs, _in, _out, 7, _len); break;
+    case 8: cts_encrypt_lanes(_keys, _ivs, _in, _out, 8, _len); break;
+    default: break;
+  }
+}
+
+AES_TARGET
+void L2D5Aes_cts_decrypt_lanes(const L2D5AesKey_t *const *_keys, const uint8_t *const *_ivs,
+                               const uint8_t *const *_in, uint8_t *const *_out,
+                               size_t _n, size_t _len) {
+  switch (_n) {
+    case 1: cts_decrypt_lanes(_keys, _ivs, _in, _out, 1, _len); break;
+    case 2: cts_decrypt_lanes(_keys, _ivs, _in, _out, 2, _len); break;
+    case 3: cts_decrypt_lanes(_keys, _ivs, _in, _out, 3, _len); break;
+    case 4: cts_decrypt_lanes(_keys, _ivs, _in, _out, 4, _len); break;
+    case 5: cts_decrypt_lanes(_keys, _ivs, _in, _out, 5, _len); break;
+    case 6: cts_decrypt_lanes(_keys, _ivs, _in, _out, 6, _len); break;
+    case 7: cts_decrypt_lanes(_keys, _ivs, _in, _out, 7, _len); break;
+    case 8: cts_decrypt_lanes(_keys, _ivs, _in, _out, 8, _len); break;
+    default: break;
+  }
+}
+
+#else  // !L2D5AES_HAVE_AESNI
+
+bool L2D5Aes_available(void) {
+  return false;
+}
+
+void L2D5Aes_expand(const uint8_t *_key, L2D5AesKey_t *_out) {
+  (void)_key;
+  memset(_out, 0, sizeof(*_out));
+}
+
+void L2D5Aes_cts_encrypt_lanes(const L2D5AesKey_t *const *_keys, const uint8_t *const *_ivs,
+                               const uint8_t *const *_in, uint8_t *const *_out,
+                               size_t _n, size_t _len) {
+  (void)_keys; (void)_ivs; (void)_in; (void)_out; (void)_n; (void)_len;
+}
+
+void L2D5Aes_cts_decrypt_lanes(const L2D5AesKey_t *const *_keys, const uint8_t *const *_ivs,
+                               const uint8_t *const *_in, uint8_t *const *_out,
+                               size_t _n, size_t _len) {
+  (void)_keys; (void)_ivs; (void)_in; (void)_out; (void)_n; (void)_len;
+}
+
+#endif // L2D5AES_HAVE_AESNI
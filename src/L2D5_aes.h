@@ -0,0 +1,67 @@
+/*
+ * File:        src/L2D5_aes.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 multi-buffer AES-256-CBC-CTS (CS1) kernels for Radio_ORBIT.
+ *    CBC is serial inside one frame, but frames are independent: up to
+ *    L2D5AES_LANES frames (each with its own key) are pushed through the
+ *    AES-NI pipeline in lockstep, one block index at a time.
+ *
+ *    Output is bit-exact with OpenSSL "AES-256-CBC-CTS" (CS1).
+ *
+ * NOTE:
+ *   - x86_64 AES-NI only. L2D5Aes_available() returns false elsewhere and
+ *     callers keep the OpenSSL path (see L2D5_keycache.h).
+ *   - All lanes of one call share the same length (>= 16 bytes).
+ *
+ */
+
+#ifndef L2D5_AES_H
+#define L2D5_AES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5AES_LANES  8
+#define L2D5AES_ROUNDS 14
+
+
+/* Expanded AES-256 key schedule, encryption and equivalent-inverse decryption */
+typedef struct {
+  uint8_t enc[L2D5AES_ROUNDS + 1][16];
+  uint8_t dec[L2D5AES_ROUNDS + 1][16];
+} __attribute__((aligned(16))) L2D5AesKey_t;
+
+
+bool L2D5Aes_available(void);
+
+/* Only valid when L2D5Aes_available() */
+void L2D5Aes_expand(const uint8_t *_key, L2D5AesKey_t *_out);
+
+/*
+ * _n lanes (1 .. L2D5AES_LANES), each: _keys[i], _ivs[i] (16 bytes),
+ * _in[i] -> _out[i], _len bytes. In-place (_in[i] == _out[i]) is allowed.
+ */
+void L2D5Aes_cts_encrypt_lanes(const L2D5AesKey_t *const *_keys, const uint8_t *const *_ivs,
+                               const uint8_t *const *_in, uint8_t *const *_out,
+                               size_t _n, size_t _len);
+
+void L2D5Aes_cts_decrypt_lanes(const L2D5AesKey_t *const *_keys, const uint8_t *const *_ivs,
+                               const uint8_t *const *_in, uint8_t *const *_out,
+                               size_t _n, size_t _len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_AES_H
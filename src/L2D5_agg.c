@@ -0,0 +1,248 @@
+/*
+ * File:        src/L2D5_agg.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 payload aggregation for Radio_ORBIT.
+ *    See L2D5_agg.h
+ *
+ */
+
+#include "L2D5_agg.h"
+#include "ORBIT_schema.h"
+#include <stdlib.h>
+
+
+/* ------------------------- open-addressed index ------------------------ */
+
+static inline uint32_t agg_key(uint8_t _tag, const uint8_t *_dst) {
+  return (uint32_t)L2D5ADDR_hash(_dst) ^ ((uint32_t)_tag * 0x9E3779B1u);
+}
+
+static inline uint32_t aidx_home(const L2D5Agg_t *_a, uint32_t _key) {
+  return L2D5ADDR_mix32(_key) & _a->idx_mask;
+}
+
+static void aidx_insert(L2D5Agg_t *_a, uint32_t _key, uint32_t _slot) {
+  uint32_t i = aidx_home(_a, _key);
+  while (_a->idx[i].slot != L2D5AGG_NIL) {
+    i = (i + 1) & _a->idx_mask;
+  }
+  _a->idx[i].key = _key;
+  _a->idx[i].slot = _slot;
+}
+
+/* backward-shift deletion, same as the route index */
+static void aidx_remove(L2D5Agg_t *_a, uint32_t _key, uint32_t _slot) {
+  L2D5AggIndexEntry_t *idx = _a->idx;
+  uint32_t mask = _a->idx_mask;
+  uint32_t i = aidx_home(_a, _key);
+  while (idx[i].slot != _slot) {
+    if (idx[i].slot == L2D5AGG_NIL) {
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  uint32_t j = i;
+  for (;;) {
+    j = (j + 1) & mask;
+    if (idx[j].slot == L2D5AGG_NIL) {
+      break;
+    }
+    uint32_t k = aidx_home(_a, idx[j].key);
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      idx[i] = idx[j];
+      i = j;
+    }
+  }
+  idx[i].slot = L2D5AGG_NIL;
+}
+
+static uint32_t agg_find(const L2D5Agg_t *_a, uint32_t _key, uint8_t _tag, const uint8_t *_dst) {
+  uint32_t i = aidx_home(_a, _key);
+  for (;;) {
+    uint32_t s = _a->idx[i].slot;
+    if (s == L2D5AGG_NIL) {
+      return L2D5AGG_NIL;
+    }
+    if (_a->idx[i].key == _key && _a->p[s].frame.TAG == _tag && L2D5ADDR_equal(_a->p[s].frame.DstAddress, _dst)) {
+      return s;
+    }
+    i = (i + 1) & _a->idx_mask;
+  }
+}
+
+
+/* ---------------------------- pending frames ---------------------------- */
+
+static void agg_emit(L2D5Agg_t *_a, uint32_t _s, uint64_t _now) {
+  L2D5AggPending_t *p = &_a->p[_s];
+  ORBITWheel_cancel(&_a->wheel, _s);
+  p->frame.FLAG = L2D5FLAG_MKFLAG(p->pri, L2D5FLAG_ERR_NML, L2D5AGG_FLAG_NUL);
+  aidx_remove(_a, p->key, _s);
+  /* the slot is free before the callback runs, so it may push again */
+  L2D5Frame_t f;
+  memcpy(&f, &p->frame, sizeof(f));
+  uint32_t count = p->count;
+  p->deadline = UINT64_MAX;
+  _a->next_free[_s] = _a->free_head;
+  _a->free_head = _s;
+  _a->frames++;
+  _a->emit(_a->ctx, &f, count, _now);
+}
+
+static uint32_t agg_open(L2D5Agg_t *_a, uint32_t _key, uint8_t _tag, const uint8_t *_dst, uint16_t _ttl,
+                         uint64_t _now) {
+  if (_a->free_head == L2D5AGG_NIL) {
+    /* every slot busy: the one due first goes now */
+    uint32_t victim = 0;
+    for (uint32_t s = 1; s < _a->capacity; s++) {
+      if (_a->p[s].deadline < _a->p[victim].deadline) {
+        victim = s;
+      }
+    }
+    _a->flush_evict++;
+    agg_emit(_a, victim, _now);
+  }
+  uint32_t s = _a->free_head;
+  _a->free_head = _a->next_free[s];
+  _a->next_free[s] = s;                   // in use marker, see L2D5Agg_flush()
+
+  L2D5AggPending_t *p = &_a->p[s];
+  memset(&p->frame, 0, sizeof(p->frame));
+  p->frame.TAG = _tag;
+  memcpy(p->frame.SrcAddress, _a->self, 16);
+  memcpy(p->frame.DstAddress, _dst, 16);
+  L2D5Frame_set_TTL(&p->frame, _ttl);
+  p->used = 0;
+  p->count = 0;
+  p->pri = 0;
+  p->key = _key;
+  p->first = _now;
+  p->deadline = UINT64_MAX;
+  aidx_insert(_a, _key, s);
+  return s;
+}
+
+static void agg_fire(void *_ctx, uint32_t _id, uint64_t _now) {
+  L2D5Agg_t *a = _ctx;
+  a->flush_deadline++;
+  agg_emit(a, _id, _now);
+}
+
+
+/* ------------------------------ lifecycle ------------------------------ */
+
+int L2D5Agg_init(L2D5Agg_t *_a, uint32_t _capacity, const uint8_t *_self, uint64_t _hold, uint64_t _tick,
+                 uint64_t _now, L2D5AggEmitFn_t _emit, void *_ctx) {
+  uint32_t idx_size = 16;
+  while (idx_size < _capacity * 2) {
+    idx_size <<= 1;
+  }
+  memset(_a, 0, sizeof(*_a));
+  if (_capacity == 0 || _emit == NULL || ORBITWheel_init(&_a->wheel, _capacity, _tick, _now) != 0) {
+    return -1;
+  }
+  _a->p = malloc((size_t)_capacity * sizeof(L2D5AggPending_t));
+  _a->next_free = malloc((size_t)_capacity * sizeof(uint32_t));
+  _a->idx = malloc((size_t)idx_size * sizeof(L2D5AggIndexEntry_t));
+  if (_a->p == NULL || _a->next_free == NULL || _a->idx == NULL) {
+    L2D5Agg_free(_a);
+    return -1;
+  }
+  for (uint32_t i = 0; i < idx_size; i++) {
+    _a->idx[i].slot = L2D5AGG_NIL;
+  }
+  for (uint32_t i = 0; i < _capacity; i++) {
+    _a->next_free[i] = i + 1 < _capacity ? i + 1 : L2D5AGG_NIL;
+    _a->p[i].deadline = UINT64_MAX;
+  }
+  _a->capacity = _capacity;
+  _a->idx_mask = idx_size - 1;
+  _a->free_head = 0;
+  memcpy(_a->self, _self, 16);
+  _a->hold = _hold;
+  for (int pri = 0; pri < 16; pri++) {
+    _a->max_latency[pri] = _hold;
+  }
+  _a->emit = _emit;
+  _a->ctx = _ctx;
+  return 0;
+}
+
+void L2D5Agg_free(L2D5Agg_t *_a) {
+  free(_a->p);
+  free(_a->next_free);
+  free(_a->idx);
+  ORBITWheel_free(&_a->wheel);
+  memset(_a, 0, sizeof(*_a));
+}
+
+
+/* ------------------------------- sending ------------------------------- */
+
+int L2D5Agg_push(L2D5Agg_t *_a, uint8_t _tag, const uint8_t *_dst, uint16_t _ttl, uint8_t _pri, uint8_t _port,
+                 const void *_data, size_t _len, uint64_t _now) {
+  if (_len == 0 || _len > L2D5AGG_MAX_MSG) {
+    return -1;
+  }
+  _pri &= 0x0F;
+  uint32_t key = agg_key(_tag, _dst);
+  uint32_t s = agg_find(_a, key, _tag, _dst);
+  if (s != L2D5AGG_NIL && _a->p[s].used + L2D5AGG_HDR + _len > L2D5AGG_PAYLOAD) {
+    _a->flush_full++;
+    agg_emit(_a, s, _now);
+    s = L2D5AGG_NIL;
+  }
+  if (s == L2D5AGG_NIL) {
+    s = agg_open(_a, key, _tag, _dst, _ttl, _now);
+  }
+
+  L2D5AggPending_t *p = &_a->p[s];
+  uint8_t *rec = p->frame.Payload + p->used;
+  rec[0] = (uint8_t)_len;
+  rec[1] = _port;
+  memcpy(rec + L2D5AGG_HDR, _data, _len);
+  p->used = (uint16_t)(p->used + L2D5AGG_HDR + _len);
+  p->count++;
+  p->pri = _pri > p->pri ? _pri : p->pri;
+  _a->msgs++;
+  _a->msg_bytes += _len;
+
+  uint64_t latency = _a->max_latency[_pri];
+  if (latency == 0) {
+    _a->flush_urgent++;
+    agg_emit(_a, s, _now);
+    return 0;
+  }
+  if (L2D5AGG_PAYLOAD - p->used < L2D5AGG_HDR + 1) {
+    _a->flush_full++;
+    agg_emit(_a, s, _now);
+    return 0;
+  }
+  uint64_t deadline = p->first + _a->hold < _now + latency ? p->first + _a->hold : _now + latency;
+  if (deadline < p->deadline) {
+    p->deadline = deadline;
+    /* the tick holding the deadline, not the next one */
+    ORBITWheel_schedule(&_a->wheel, s, deadline / _a->wheel.tick * _a->wheel.tick);
+  }
+  return 0;
+}
+
+uint32_t L2D5Agg_poll(L2D5Agg_t *_a, uint64_t _now) {
+  uint64_t frames = _a->frames;
+  ORBITWheel_advance(&_a->wheel, _now, agg_fire, _a);
+  return (uint32_t)(_a->frames - frames);
+}
+
+uint32_t L2D5Agg_flush(L2D5Agg_t *_a, uint64_t _now) {
+  uint64_t frames = _a->frames;
+  for (uint32_t s = 0; s < _a->capacity; s++) {
+    if (_a->next_free[s] == s) {
+      agg_emit(_a, s, _now);
+    }
+  }
+  return (uint32_t)(_a->frames - frames);
+}
@@ -0,0 +1,193 @@
+/*
+ * File:        src/L2D5_agg.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 payload aggregation for Radio_ORBIT.
+ *    Packs several short messages for the same (TAG, DstAddress) into one
+ *    176-byte L2D5Frame_t Payload, so small sensor messages share one
+ *    224-byte L2 frame of airtime and one CRC / AES pass.
+ *
+ *
+ *  Aggregated payload (FLAG NUL field = L2D5AGG_FLAG_NUL):
+ *
+ *  | len | port | data (len bytes) | len | port | data | ... | 0 | zero fill |
+ *  ---------------------------------------------------------------------------
+ *  |  1  |  1   |    1 .. 174      |  1  |  1   |      |     |
+ *
+ *   len 0 (or the end of the payload) ends the list. port is the
+ *   application's message type / channel, carried as is.
+ *
+ *  Sender: one pending frame per (TAG, DstAddress), found through a small
+ *  open-addressed index. A pending frame goes out when
+ *
+ *  | Reason   | When                                                     |
+ *  ----------------------------------------------------------------------
+ *  | full     | the next message does not fit, or less than a record    |
+ *  |          | header + 1 byte is left                                  |
+ *  | deadline | oldest message waited hold, or any message reached its  |
+ *  |          | max_latency[PRI] (the tighter one wins)                  |
+ *  | urgent   | max_latency[PRI] == 0                                    |
+ *  | evict    | every pending slot busy and a new destination arrives    |
+ *
+ *  Deadlines sit on an ORBITWheel_t, so L2D5Agg_poll() costs nothing for
+ *  frames that are not due. The frame FLAG PRI is the highest PRI inside.
+ *
+ *  Receiver: L2D5AggIter_t walks the records in place (zero copy); every
+ *  record is bounds checked against the 176-byte payload.
+ *
+ * NOTE:
+ *   - Relays forward aggregated frames untouched: one frame, one DstAddress.
+ *   - Latency bounds hold to one _tick when L2D5Agg_poll() runs every tick.
+ *   - Not thread safe.
+ *
+ */
+
+#ifndef L2D5_AGG_H
+#define L2D5_AGG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_struct.h"
+#include "L2D5_addr.h"
+#include "ORBIT_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5AGG_PAYLOAD  176
+#define L2D5AGG_HDR      2
+#define L2D5AGG_MAX_MSG  (L2D5AGG_PAYLOAD - L2D5AGG_HDR)
+#define L2D5AGG_FLAG_NUL L2D5FLAG_NUL_B
+#define L2D5AGG_NIL      UINT32_MAX
+
+
+typedef struct {
+  L2D5Frame_t frame;
+  uint16_t    used;                       // payload bytes filled
+  uint8_t     count;
+  uint8_t     pri;
+  uint32_t    key;
+  uint64_t    first;                      // enqueue time of the oldest message
+  uint64_t    deadline;
+} L2D5AggPending_t;
+
+
+typedef struct {
+  uint32_t key;
+  uint32_t slot;                          // L2D5AGG_NIL when empty
+} L2D5AggIndexEntry_t;
+
+
+/* Frame ready for the TX path; _count messages inside */
+typedef void (*L2D5AggEmitFn_t)(void *_ctx, const L2D5Frame_t *_frame, uint32_t _count, uint64_t _now);
+
+
+typedef struct {
+  L2D5AggPending_t    *p;
+  uint32_t             capacity;
+  uint32_t             free_head;
+  uint32_t            *next_free;
+  L2D5AggIndexEntry_t *idx;
+  uint32_t             idx_mask;
+  ORBITWheel_t         wheel;
+  uint8_t              self[16];          // SrcAddress of emitted frames
+  uint64_t             hold;
+  uint64_t             max_latency[16];   // per FLAG PRI, 0 = send at once
+  L2D5AggEmitFn_t      emit;
+  void                *ctx;
+
+  uint64_t             msgs;
+  uint64_t             msg_bytes;
+  uint64_t             frames;
+  uint64_t             flush_full;
+  uint64_t             flush_deadline;
+  uint64_t             flush_urgent;
+  uint64_t             flush_evict;
+} L2D5Agg_t;
+
+
+/*
+ * _capacity destinations pending at once. Every PRI starts with
+ * max_latency = _hold; adjust with L2D5Agg_set_latency(). Times in caller
+ * units, deadlines kept to _tick. 0 or -1.
+ */
+int  L2D5Agg_init(L2D5Agg_t *_a, uint32_t _capacity, const uint8_t *_self, uint64_t _hold, uint64_t _tick,
+                  uint64_t _now, L2D5AggEmitFn_t _emit, void *_ctx);
+void L2D5Agg_free(L2D5Agg_t *_a);
+
+static inline void L2D5Agg_set_latency(L2D5Agg_t *_a, uint8_t _pri, uint64_t _max_latency) {
+  _a->max_latency[_pri & 0x0F] = _max_latency;
+}
+
+/*
+ * Queues one message of _len (1 .. L2D5AGG_MAX_MSG) bytes for (_tag, _dst),
+ * may emit frames right away (full / urgent / evict). 0 or -1.
+ */
+int L2D5Agg_push(L2D5Agg_t *_a, uint8_t _tag, const uint8_t *_dst, uint16_t _ttl, uint8_t _pri, uint8_t _port,
+                 const void *_data, size_t _len, uint64_t _now);
+
+/* Emits every frame whose deadline has come by _now. Returns frames emitted. */
+uint32_t L2D5Agg_poll(L2D5Agg_t *_a, uint64_t _now);
+
+/* Emits everything pending */
+uint32_t L2D5Agg_flush(L2D5Agg_t *_a, uint64_t _now);
+
+static inline uint32_t L2D5Agg_pending(const L2D5Agg_t *_a) {
+  return _a->wheel.armed;
+}
+
+
+/* ---------------------------- receive side ---------------------------- */
+
+static inline bool L2D5Agg_is_aggregate(const L2D5Frame_t *_f) {
+  return L2D5FLAG_GET_NUL(_f->FLAG) == L2D5AGG_FLAG_NUL;
+}
+
+typedef struct {
+  const uint8_t *data;                    // points into the frame payload
+  uint8_t        len;
+  uint8_t        port;
+} L2D5AggMsg_t;
+
+typedef struct {
+  const uint8_t *p;
+  const uint8_t *end;
+  bool           bad;                     // a record ran past the payload
+} L2D5AggIter_t;
+
+static inline void L2D5AggIter_init(L2D5AggIter_t *_it, const L2D5Frame_t *_f) {
+  _it->p = _f->Payload;
+  _it->end = _f->Payload + L2D5AGG_PAYLOAD;
+  _it->bad = false;
+}
+
+/* Next record, or false at the end of the list / on a malformed record */
+static inline bool L2D5AggIter_next(L2D5AggIter_t *_it, L2D5AggMsg_t *_m) {
+  if (_it->end - _it->p < L2D5AGG_HDR + 1 || _it->p[0] == 0) {
+    return false;
+  }
+  size_t len = _it->p[0];
+  if ((size_t)(_it->end - _it->p) < L2D5AGG_HDR + len) {
+    _it->bad = true;
+    _it->p = _it->end;
+    return false;
+  }
+  _m->len = (uint8_t)len;
+  _m->port = _it->p[1];
+  _m->data = _it->p + L2D5AGG_HDR;
+  _it->p += L2D5AGG_HDR + len;
+  return true;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_AGG_H
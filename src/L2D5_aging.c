@@ -0,0 +1,114 @@
+/*
+ * File:        src/L2D5_aging.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 neighbor / remote route expiry for Radio_ORBIT.
+ *    See L2D5_aging.h
+ *
+ */
+
+#include "L2D5_aging.h"
+#include <string.h>
+
+
+typedef struct {
+  L2D5Aging_t *a;
+  uint32_t     removed;
+} AgingRun_t;
+
+
+static void aging_orphan(void *_ctx, uint32_t _dest) {
+  AgingRun_t *run = _ctx;
+  L2D5Aging_t *a = run->a;
+  ORBITWheel_cancel(&a->wheel, a->nb->capacity + _dest);
+  if (a->on_route != NULL) {
+    a->on_route(a->ctx, _dest);
+  }
+  L2D5Route_remove(a->route, _dest);
+  a->routes_orphaned++;
+  run->removed++;
+}
+
+static void aging_neighbor_gone(AgingRun_t *_run, uint32_t _slot) {
+  L2D5Aging_t *a = _run->a;
+  if (a->on_neighbor != NULL) {
+    a->on_neighbor(a->ctx, _slot);
+  }
+  L2D5Route_neighbor_lost(a->route, _slot, aging_orphan, _run);
+  L2D5Neighbor_remove(a->nb, _slot);
+  _run->removed++;
+}
+
+static void aging_fire(void *_ctx, uint32_t _id, uint64_t _now) {
+  AgingRun_t *run = _ctx;
+  L2D5Aging_t *a = run->a;
+
+  if (_id < a->nb->capacity) {
+    if (!L2D5Neighbor_occupied(a->nb, _id)) {
+      return;
+    }
+    uint64_t until = a->nb->last_seen[_id] + a->nb_timeout;
+    if (until > _now) {
+      ORBITWheel_schedule(&a->wheel, _id, until);
+      a->rearmed++;
+      return;
+    }
+    aging_neighbor_gone(run, _id);
+    a->nb_expired++;
+    return;
+  }
+
+  uint32_t dest = _id - a->nb->capacity;
+  if (a->route->next_free[dest] != dest) {
+    return;
+  }
+  uint64_t until = a->route->cold[dest].last_seen + a->route_timeout;
+  if (until > _now) {
+    ORBITWheel_schedule(&a->wheel, _id, until);
+    a->rearmed++;
+    return;
+  }
+  if (a->on_route != NULL) {
+    a->on_route(a->ctx, dest);
+  }
+  L2D5Route_remove(a->route, dest);
+  a->routes_expired++;
+  run->removed++;
+}
+
+
+int L2D5Aging_init(L2D5Aging_t *_a, L2D5NeighborTable_t *_nb, L2D5RouteTable_t *_route, uint64_t _nb_timeout,
+                   uint64_t _route_timeout, uint64_t _tick, uint64_t _now) {
+  memset(_a, 0, sizeof(*_a));
+  if (_route->nb != _nb || _route->nb_capacity != _nb->capacity) {
+    return -1;
+  }
+  _a->nb = _nb;
+  _a->route = _route;
+  _a->nb_timeout = _nb_timeout;
+  _a->route_timeout = _route_timeout;
+  return ORBITWheel_init(&_a->wheel, _nb->capacity + _route->capacity, _tick, _now);
+}
+
+void L2D5Aging_free(L2D5Aging_t *_a) {
+  ORBITWheel_free(&_a->wheel);
+  memset(_a, 0, sizeof(*_a));
+}
+
+void L2D5Aging_neighbor_drop(L2D5Aging_t *_a, uint32_t _slot) {
+  AgingRun_t run = { _a, 0 };
+  if (_slot >= _a->nb->capacity || !L2D5Neighbor_occupied(_a->nb, _slot)) {
+    return;
+  }
+  ORBITWheel_cancel(&_a->wheel, _slot);
+  aging_neighbor_gone(&run, _slot);
+}
+
+uint32_t L2D5Aging_advance(L2D5Aging_t *_a, uint64_t _now) {
+  AgingRun_t run = { _a, 0 };
+  ORBITWheel_advance(&_a->wheel, _now, aging_fire, &run);
+  return run.removed;
+}
@@ -0,0 +1,103 @@
+/*
+ * File:        src/L2D5_aging.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 neighbor / remote route expiry for Radio_ORBIT.
+ *    One ORBITWheel_t timer per neighbor slot and per route dest slot,
+ *    refreshed in O(1) on every HELLO, so housekeeping cost follows the
+ *    entries that actually expire instead of the table size.
+ *
+ *
+ *  Timer ids in the wheel:
+ *
+ *  | Id range                              | Entry                       |
+ *  ----------------------------------------------------------------------
+ *  | 0 .. nb->capacity - 1                 | neighbor slot               |
+ *  | nb->capacity .. + route->capacity - 1 | route dest slot             |
+ *
+ *  Neighbor expiry cascades: every remote route using the neighbor as a
+ *  candidate next hop is re-evaluated (L2D5Route_neighbor_lost()); a
+ *  destination left without any live next hop is removed right away, not
+ *  at its own timeout. Destinations with another candidate switch to it.
+ *
+ *  A timer firing re-checks the table: a slot since freed is skipped, and
+ *  an entry whose last_seen moved on (refreshed without telling the
+ *  aging) is re-armed from last_seen instead of expired.
+ *
+ * NOTE:
+ *   - The tables must outlive the aging and keep their capacity.
+ *   - Callbacks run before the entry is removed; they must not remove it.
+ *   - Not thread safe.
+ *
+ */
+
+#ifndef L2D5_AGING_H
+#define L2D5_AGING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_neighbor.h"
+#include "L2D5_route.h"
+#include "ORBIT_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef void (*L2D5AgingFn_t)(void *_ctx, uint32_t _slot);
+
+
+typedef struct {
+  L2D5NeighborTable_t *nb;
+  L2D5RouteTable_t    *route;
+  ORBITWheel_t         wheel;
+  uint64_t             nb_timeout;
+  uint64_t             route_timeout;
+
+  L2D5AgingFn_t        on_neighbor;       // optional: neighbor slot expiring
+  L2D5AgingFn_t        on_route;          // optional: dest slot expiring / orphaned
+  void                *ctx;
+
+  uint64_t             nb_expired;
+  uint64_t             routes_expired;    // own timeout
+  uint64_t             routes_orphaned;   // last next hop expired
+  uint64_t             rearmed;           // fired early, entry refreshed in the table
+} L2D5Aging_t;
+
+
+/* Timeouts and _tick in the tables' time unit (last_seen); 0 or -1 */
+int  L2D5Aging_init(L2D5Aging_t *_a, L2D5NeighborTable_t *_nb, L2D5RouteTable_t *_route, uint64_t _nb_timeout,
+                    uint64_t _route_timeout, uint64_t _tick, uint64_t _now);
+void L2D5Aging_free(L2D5Aging_t *_a);
+
+/* HELLO_PKT_NB (or any frame) from neighbor _slot at _now */
+static inline void L2D5Aging_neighbor_seen(L2D5Aging_t *_a, uint32_t _slot, uint64_t _now) {
+  ORBITWheel_extend(&_a->wheel, _slot, _now + _a->nb_timeout);
+}
+
+/* HELLO_PKT_RM accepted for dest _dest at _now */
+static inline void L2D5Aging_route_seen(L2D5Aging_t *_a, uint32_t _dest, uint64_t _now) {
+  ORBITWheel_extend(&_a->wheel, _a->nb->capacity + _dest, _now + _a->route_timeout);
+}
+
+/* Neighbor _slot is gone now (link failure, key change): same cascade as an expiry */
+void L2D5Aging_neighbor_drop(L2D5Aging_t *_a, uint32_t _slot);
+
+/* Expires everything due by _now. Returns entries removed (neighbors + routes). */
+uint32_t L2D5Aging_advance(L2D5Aging_t *_a, uint64_t _now);
+
+static inline size_t L2D5Aging_bytes(const L2D5Aging_t *_a) {
+  return ORBITWheel_bytes(&_a->wheel);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_AGING_H
@@ -0,0 +1,237 @@
+/*
+ * File:        src/L2D5_classify.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Batch classifier for received L2 / L2.5 frames for Radio_ORBIT.
+ *    See L2D5_classify.h
+ *
+ */
+
+#include "L2D5_classify.h"
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+  #define L2D5CLS_SSE2
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  #define L2D5CLS_NEON
+  #include <arm_neon.h>
+#endif
+
+#define OFF_TAG  (offsetof(L2Frame, Payload) + offsetof(L2D5Frame_t, TAG))
+#define OFF_FLAG (offsetof(L2Frame, Payload) + offsetof(L2D5Frame_t, FLAG))
+#define OFF_EFD  offsetof(L2Frame, EFD)
+
+STATIC_ASSERT(OFF_TAG == 3 && OFF_FLAG == 8 && OFF_EFD == 223, L2D5CLS_header_offsets);
+STATIC_ASSERT(L2D5FLAG_PRI_SHIFT == 0, L2D5CLS_pri_is_a_mask);
+
+
+/*
+ * Gather: three 32-bit loads per frame, straight into vector lanes, header
+ * bytes picked out of them in the vector code (little endian):
+ *
+ *  | Word | Frame offset | Bytes used            |
+ *  -----------------------------------------------
+ *  | w0   |      0       | 0: SFD, 3: L2.5 TAG   |
+ *  | w8   |      8       | 0: L2.5 FLAG          |
+ *  | wE   |     220      | 3: EFD                |
+ *
+ *  Lanes past _n point at an all-zero frame: MALFORMED, then masked off.
+ */
+#define OFF_W0 0
+#define OFF_W8 OFF_FLAG
+#define OFF_WE (OFF_EFD - 3)
+
+typedef struct {
+  const uint8_t *f[L2D5CLS_MAX];
+} cls_lanes_t;
+
+static const L2Frame cls_zero_frame;
+
+static inline uint32_t cls_load32(const uint8_t *_p) {
+  uint32_t v;
+  memcpy(&v, _p, 4);
+  return v;
+}
+
+
+#if defined(L2D5CLS_SSE2)
+
+/* Word at _off of frames _f[0 .. 3] */
+static inline __m128i cls_word4(const uint8_t *const *_f, size_t _off) {
+  return _mm_set_epi32((int)cls_load32(_f[3] + _off), (int)cls_load32(_f[2] + _off),
+                       (int)cls_load32(_f[1] + _off), (int)cls_load32(_f[0] + _off));
+}
+
+/* Byte _b of four words each in _a .. _d -> 16 bytes */
+static inline __m128i cls_narrow(__m128i _a, __m128i _b4, __m128i _c, __m128i _d, int _b) {
+  const __m128i ff = _mm_set1_epi32(0xFF);
+  __m128i a = _mm_and_si128(_mm_srli_epi32(_a, _b * 8), ff);
+  __m128i b = _mm_and_si128(_mm_srli_epi32(_b4, _b * 8), ff);
+  __m128i c = _mm_and_si128(_mm_srli_epi32(_c, _b * 8), ff);
+  __m128i d = _mm_and_si128(_mm_srli_epi32(_d, _b * 8), ff);
+  return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+/* 16 lanes at _o: class / PRI stored, class / TAG bit masks returned */
+static inline void cls_16(const cls_lanes_t *_l, size_t _o, L2D5ClassBatch_t *_out, uint32_t _m[7]) {
+  const uint8_t *const *f = _l->f + _o;
+  __m128i w0a = cls_word4(f, OFF_W0), w0b = cls_word4(f + 4, OFF_W0);
+  __m128i w0c = cls_word4(f + 8, OFF_W0), w0d = cls_word4(f + 12, OFF_W0);
+  __m128i sfd = cls_narrow(w0a, w0b, w0c, w0d, 0);
+  __m128i tag = cls_narrow(w0a, w0b, w0c, w0d, 3);
+  __m128i flag = cls_narrow(cls_word4(f, OFF_W8), cls_word4(f + 4, OFF_W8), cls_word4(f + 8, OFF_W8),
+                            cls_word4(f + 12, OFF_W8), 0);
+  __m128i efd = cls_narrow(cls_word4(f, OFF_WE), cls_word4(f + 4, OFF_WE), cls_word4(f + 8, OFF_WE),
+                           cls_word4(f + 12, OFF_WE), 3);
+
+  __m128i ok = _mm_and_si128(_mm_cmpeq_epi8(sfd, _mm_set1_epi8((char)MAGIC_L2LAYER_SFD)),
+                             _mm_cmpeq_epi8(efd, _mm_set1_epi8((char)MAGIC_L2LAYER_EFD)));
+  __m128i nb = _mm_and_si128(ok, _mm_cmpeq_epi8(tag, _mm_set1_epi8((char)L2D5TAG_HELLO_PKT_NB)));
+  __m128i rm = _mm_and_si128(ok, _mm_cmpeq_epi8(tag, _mm_set1_epi8((char)L2D5TAG_HELLO_PKT_RM)));
+  __m128i dc = _mm_and_si128(ok, _mm_cmpeq_epi8(tag, _mm_set1_epi8((char)L2D5TAG_TCP_DATA_DC)));
+  __m128i dr = _mm_and_si128(ok, _mm_cmpeq_epi8(tag, _mm_set1_epi8((char)L2D5TAG_TCP_DATA_RM)));
+  __m128i any = _mm_or_si128(_mm_or_si128(nb, rm), _mm_or_si128(dc, dr));
+
+  __m128i cls = _mm_or_si128(_mm_or_si128(_mm_and_si128(rm, _mm_set1_epi8(L2D5CLS_HELLO_RM)),
+                                          _mm_and_si128(dc, _mm_set1_epi8(L2D5CLS_DATA_DC))),
+                             _mm_or_si128(_mm_and_si128(dr, _mm_set1_epi8(L2D5CLS_DATA_RM)),
+                                          _mm_andnot_si128(any, _mm_set1_epi8(L2D5CLS_MALFORMED))));
+  _mm_storeu_si128((__m128i *)(_out->cls + _o), cls);
+  _mm_storeu_si128((__m128i *)(_out->pri + _o), _mm_and_si128(flag, _mm_set1_epi8(L2D5FLAG_PRI_MASK)));
+
+  __m128i fwd = _mm_set1_epi8(L2D5CLS_TAG_FORWARD);
+  _m[L2D5CLS_HELLO_NB] = (uint32_t)_mm_movemask_epi8(nb);
+  _m[L2D5CLS_HELLO_RM] = (uint32_t)_mm_movemask_epi8(rm);
+  _m[L2D5CLS_DATA_DC] = (uint32_t)_mm_movemask_epi8(dc);
+  _m[L2D5CLS_DATA_RM] = (uint32_t)_mm_movemask_epi8(dr);
+  _m[L2D5CLS_MALFORMED] = (uint32_t)_mm_movemask_epi8(any) ^ 0xFFFF;
+  _m[5] = (uint32_t)_mm_movemask_epi8(tag);   // ENCRYPTED is the top bit
+  _m[6] = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(tag, fwd), fwd));
+}
+
+#elif defined(L2D5CLS_NEON)
+
+static inline uint32_t cls_movemask(uint8x16_t _v) {
+  static const uint8_t bit[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  uint8x16_t m = vandq_u8(_v, vld1q_u8(bit));
+  return (uint32_t)vaddv_u8(vget_low_u8(m)) | ((uint32_t)vaddv_u8(vget_high_u8(m)) << 8);
+}
+
+/* Byte _b of the word at _off of frames _f[0 .. 15] */
+static inline uint8x16_t cls_narrow(const uint8_t *const *_f, size_t _off, int _b) {
+  uint32_t w[16];
+  for (int i = 0; i < 16; i++) {
+    w[i] = cls_load32(_f[i] + _off);
+  }
+  int32x4_t sh = vdupq_n_s32(-8 * _b);
+  uint16x8_t lo = vcombine_u16(vmovn_u32(vshlq_u32(vld1q_u32(w + 0), sh)),
+                               vmovn_u32(vshlq_u32(vld1q_u32(w + 4), sh)));
+  uint16x8_t hi = vcombine_u16(vmovn_u32(vshlq_u32(vld1q_u32(w + 8), sh)),
+                               vmovn_u32(vshlq_u32(vld1q_u32(w + 12), sh)));
+  return vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+}
+
+static inline void cls_16(const cls_lanes_t *_l, size_t _o, L2D5ClassBatch_t *_out, uint32_t _m[7]) {
+  const uint8_t *const *f = _l->f + _o;
+  uint8x16_t sfd = cls_narrow(f, OFF_W0, 0);
+  uint8x16_t tag = cls_narrow(f, OFF_W0, 3);
+  uint8x16_t flag = cls_narrow(f, OFF_W8, 0);
+  uint8x16_t efd = cls_narrow(f, OFF_WE, 3);
+
+  uint8x16_t ok = vandq_u8(vceqq_u8(sfd, vdupq_n_u8(MAGIC_L2LAYER_SFD)), vceqq_u8(efd, vdupq_n_u8(MAGIC_L2LAYER_EFD)));
+  uint8x16_t nb = vandq_u8(ok, vceqq_u8(tag, vdupq_n_u8(L2D5TAG_HELLO_PKT_NB)));
+  uint8x16_t rm = vandq_u8(ok, vceqq_u8(tag, vdupq_n_u8(L2D5TAG_HELLO_PKT_RM)));
+  uint8x16_t dc = vandq_u8(ok, vceqq_u8(tag, vdupq_n_u8(L2D5TAG_TCP_DATA_DC)));
+  uint8x16_t dr = vandq_u8(ok, vceqq_u8(tag, vdupq_n_u8(L2D5TAG_TCP_DATA_RM)));
+  uint8x16_t any = vorrq_u8(vorrq_u8(nb, rm), vorrq_u8(dc, dr));
+
+  uint8x16_t cls = vorrq_u8(vorrq_u8(vandq_u8(rm, vdupq_n_u8(L2D5CLS_HELLO_RM)),
+                                     vandq_u8(dc, vdupq_n_u8(L2D5CLS_DATA_DC))),
+                            vorrq_u8(vandq_u8(dr, vdupq_n_u8(L2D5CLS_DATA_RM)),
+                                     vbicq_u8(vdupq_n_u8(L2D5CLS_MALFORMED), any)));
+  vst1q_u8(_out->cls + _o, cls);
+  vst1q_u8(_out->pri + _o, vandq_u8(flag, vdupq_n_u8(L2D5FLAG_PRI_MASK)));
+
+  _m[L2D5CLS_HELLO_NB] = cls_movemask(nb);
+  _m[L2D5CLS_HELLO_RM] = cls_movemask(rm);
+  _m[L2D5CLS_DATA_DC] = cls_movemask(dc);
+  _m[L2D5CLS_DATA_RM] = cls_movemask(dr);
+  _m[L2D5CLS_MALFORMED] = cls_movemask(any) ^ 0xFFFF;
+  _m[5] = cls_movemask(vtstq_u8(tag, vdupq_n_u8(L2D5CLS_TAG_ENCRYPTED)));
+  _m[6] = cls_movemask(vtstq_u8(tag, vdupq_n_u8(L2D5CLS_TAG_FORWARD)));
+}
+
+#else
+
+static inline void cls_16(const cls_lanes_t *_l, size_t _o, L2D5ClassBatch_t *_out, uint32_t _m[7]) {
+  for (int k = 0; k < 7; k++) {
+    _m[k] = 0;
+  }
+  for (size_t i = 0; i < 16; i++) {
+    const L2Frame *f = (const L2Frame *)_l->f[_o + i];
+    uint8_t tag = ((const L2D5Frame_t *)f->Payload)->TAG;
+    L2D5Class_t c = L2D5Cls_frame(f, &_out->pri[_o + i]);
+    _out->cls[_o + i] = (uint8_t)c;
+    _m[c] |= 1u << i;
+    _m[5] |= (uint32_t)((tag & L2D5CLS_TAG_ENCRYPTED) != 0) << i;
+    _m[6] |= (uint32_t)((tag & L2D5CLS_TAG_FORWARD) != 0) << i;
+  }
+}
+
+#endif
+
+
+static void cls_run(const cls_lanes_t *_l, size_t _n, L2D5ClassBatch_t *_out) {
+  uint32_t lo[7], hi[7];
+  cls_16(_l, 0, _out, lo);
+  cls_16(_l, 16, _out, hi);
+  uint32_t valid = _n >= 32 ? 0xFFFFFFFFu : (1u << _n) - 1;
+
+  for (int c = 0; c < L2D5CLS_CLASSES; c++) {
+    uint32_t m = (lo[c] | (hi[c] << 16)) & valid;
+    uint32_t k = 0;
+    _out->mask[c] = m;
+    while (m) {
+      _out->idx[c][k++] = (uint8_t)__builtin_ctz(m);
+      m &= m - 1;
+    }
+    _out->count[c] = (uint8_t)k;
+  }
+  _out->encrypted = (lo[5] | (hi[5] << 16)) & valid;
+  _out->forward = (lo[6] | (hi[6] << 16)) & valid;
+}
+
+static inline void cls_pad(cls_lanes_t *_l, size_t _n) {
+  for (size_t i = _n; i < L2D5CLS_MAX; i++) {
+    _l->f[i] = (const uint8_t *)&cls_zero_frame;
+  }
+}
+
+void L2D5Cls_batch(const L2Frame *const *_frames, size_t _n, L2D5ClassBatch_t *_out) {
+  cls_lanes_t l;
+  if (_n > L2D5CLS_MAX) {
+    _n = L2D5CLS_MAX;
+  }
+  for (size_t i = 0; i < _n; i++) {
+    l.f[i] = (const uint8_t *)_frames[i];
+  }
+  cls_pad(&l, _n);
+  cls_run(&l, _n, _out);
+}
+
+void L2D5Cls_batch_contig(const L2Frame *_frames, size_t _n, L2D5ClassBatch_t *_out) {
+  cls_lanes_t l;
+  if (_n > L2D5CLS_MAX) {
+    _n = L2D5CLS_MAX;
+  }
+  for (size_t i = 0; i < _n; i++) {
+    l.f[i] = (const uint8_t *)&_frames[i];
+  }
+  cls_pad(&l, _n);
+  cls_run(&l, _n, _out);
+}
@@ -0,0 +1,108 @@
+/*
+ * File:        src/L2D5_classify.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Batch classifier for received L2 / L2.5 frames for Radio_ORBIT.
+ *    Up to L2D5CLS_MAX frames per call: SFD / EFD check, L2.5 TAG type,
+ *    ENCRYPTED / FORWARD bits and FLAG PRI, then one index list per class
+ *    so later stages get uniform batches.
+ *
+ *
+ *  Per call:
+ *
+ *    1. three 32-bit loads per frame (offsets 0, 8, 220) straight into
+ *       vector lanes, SFD / TAG / FLAG / EFD bytes narrowed out of them
+ *    2. compare all lanes at once (SSE2 / NEON, 16 lanes per op):
+ *         ok    = SFD == 0x5A && EFD == 0xFF
+ *         class = TAG == one of the four L2D5TAG_t, else MALFORMED
+ *    3. class bitmasks -> index lists (input order kept per class)
+ *
+ *  | Class     | TAG (L2D5TAG_t)  | Next stage            |
+ *  -------------------------------------------------------
+ *  | HELLO_NB  | HELLO_PKT_NB     | neighbor table        |
+ *  | HELLO_RM  | HELLO_PKT_RM     | decrypt, route table  |
+ *  | DATA_DC   | TCP_DATA_DC      | decrypt, local        |
+ *  | DATA_RM   | TCP_DATA_RM      | decrypt, relay        |
+ *  | MALFORMED | other, bad SFD / EFD                     |
+ *
+ *  TAG bits are numbered from the MSB in L2D5_struct.h (bit 0 = ENCRYPTED
+ *  = 0x80, bit 2 = FORWARD = 0x20).
+ *
+ * NOTE:
+ *   - Same results as L2D5Cls_frame() (scalar, L2D5FLAG_GET_PRI) for
+ *     every input; the test checks both on random and crafted frames.
+ *   - The L2 TAG is not looked at: FEC ports run L2FecDec first.
+ *
+ */
+
+#ifndef L2D5_CLASSIFY_H
+#define L2D5_CLASSIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+#include "L2D5_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5CLS_MAX          32           // frames per call
+
+#define L2D5CLS_TAG_ENCRYPTED 0x80        // TAG bit 0
+#define L2D5CLS_TAG_FORWARD   0x20        // TAG bit 2
+
+
+typedef enum {
+  L2D5CLS_HELLO_NB = 0,
+  L2D5CLS_HELLO_RM,
+  L2D5CLS_DATA_DC,
+  L2D5CLS_DATA_RM,
+  L2D5CLS_MALFORMED,
+  L2D5CLS_CLASSES
+} L2D5Class_t;
+
+
+typedef struct {
+  uint8_t  count[L2D5CLS_CLASSES];
+  uint8_t  idx[L2D5CLS_CLASSES][L2D5CLS_MAX]; // input indices, ascending
+  uint8_t  cls[L2D5CLS_MAX];              // L2D5Class_t per input frame
+  uint8_t  pri[L2D5CLS_MAX];              // FLAG PRI per input frame (any class)
+  uint32_t mask[L2D5CLS_CLASSES];         // bit i: frame i is of the class
+  uint32_t encrypted;                     // bit i: TAG ENCRYPTED set
+  uint32_t forward;                       // bit i: TAG FORWARD set
+} L2D5ClassBatch_t;
+
+
+/* Scalar reference for one frame; *_pri gets the FLAG PRI */
+static inline L2D5Class_t L2D5Cls_frame(const L2Frame *_f, uint8_t *_pri) {
+  const L2D5Frame_t *l = (const L2D5Frame_t *)_f->Payload;
+  *_pri = L2D5FLAG_GET_PRI(l->FLAG);
+  if (_f->SFD != MAGIC_L2LAYER_SFD || _f->EFD != MAGIC_L2LAYER_EFD) {
+    return L2D5CLS_MALFORMED;
+  }
+  switch (l->TAG) {
+    case L2D5TAG_HELLO_PKT_NB: return L2D5CLS_HELLO_NB;
+    case L2D5TAG_HELLO_PKT_RM: return L2D5CLS_HELLO_RM;
+    case L2D5TAG_TCP_DATA_DC:  return L2D5CLS_DATA_DC;
+    case L2D5TAG_TCP_DATA_RM:  return L2D5CLS_DATA_RM;
+    default:                   return L2D5CLS_MALFORMED;
+  }
+}
+
+/* Classifies _frames[0 .. _n), _n <= L2D5CLS_MAX */
+void L2D5Cls_batch(const L2Frame *const *_frames, size_t _n, L2D5ClassBatch_t *_out);
+
+/* Same over _n frames stored back to back (a deframer / pool run) */
+void L2D5Cls_batch_contig(const L2Frame *_frames, size_t _n, L2D5ClassBatch_t *_out);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_CLASSIFY_H
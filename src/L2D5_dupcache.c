@@ -0,0 +1,159 @@
+/*
+ * File:        src/L2D5_dupcache.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 flood duplicate-suppression cache for Radio_ORBIT.
+ *    See L2D5_dupcache.h
+ *
+ */
+
+#include "L2D5_dupcache.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
+
+
+/* 8-bit mask: bit i set when _tags[i] == _tag */
+static inline uint32_t set_match(const uint16_t *_tags, uint16_t _tag) {
+#if defined(__SSE2__)
+  __m128i eq = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *)_tags), _mm_set1_epi16((short)_tag));
+  return (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128()));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  static const uint16_t bit[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+  uint16x8_t m = vandq_u16(vceqq_u16(vld1q_u16(_tags), vdupq_n_u16(_tag)), vld1q_u16(bit));
+  return (uint32_t)vaddvq_u16(m);
+#else
+  uint32_t m = 0;
+  for (int i = 0; i < L2D5DUP_WAYS; i++) {
+    m |= (uint32_t)(_tags[i] == _tag) << i;
+  }
+  return m;
+#endif
+}
+
+static void *dup_alloc(size_t _n, size_t _size) {
+  size_t bytes = (_n * _size + 63) & ~(size_t)63;
+  void *p = aligned_alloc(64, bytes);
+  if (p != NULL) {
+    memset(p, 0, bytes);
+  }
+  return p;
+}
+
+
+int L2D5Dup_init(L2D5DupCache_t *_c, uint32_t _sources, uint64_t _hold) {
+  uint32_t buckets = 1;
+  while ((uint64_t)buckets * L2D5DUP_WAYS < 2 * (uint64_t)_sources) {
+    buckets <<= 1;
+  }
+  memset(_c, 0, sizeof(*_c));
+  _c->tag = dup_alloc((size_t)buckets * L2D5DUP_WAYS, sizeof(uint16_t));
+  _c->ent = dup_alloc((size_t)buckets * L2D5DUP_WAYS, sizeof(L2D5DupEntry_t));
+  if (_c->tag == NULL || _c->ent == NULL) {
+    L2D5Dup_free(_c);
+    return -1;
+  }
+  _c->bucket_mask = buckets - 1;
+  _c->hold = _hold;
+  return 0;
+}
+
+void L2D5Dup_free(L2D5DupCache_t *_c) {
+  free(_c->tag);
+  free(_c->ent);
+  memset(_c, 0, sizeof(*_c));
+}
+
+void L2D5Dup_clear(L2D5DupCache_t *_c) {
+  memset(_c->tag, 0, ((size_t)_c->bucket_mask + 1) * L2D5DUP_WAYS * sizeof(uint16_t));
+}
+
+
+static inline L2D5DupResult_t entry_reset(L2D5DupEntry_t *_e, uint16_t _seq, uint16_t _ttl, uint64_t _now) {
+  _e->window = 1;
+  _e->top = _seq;
+  _e->top_ttl = _ttl;
+  _e->last_seen = _now;
+  return L2D5DUP_NEW;
+}
+
+/* Updates a known source's window */
+static L2D5DupResult_t entry_check(L2D5DupCache_t *_c, L2D5DupEntry_t *_e, uint16_t _seq, uint16_t _ttl,
+                                   uint64_t _now) {
+  if (_now - _e->last_seen > _c->hold) {
+    return entry_reset(_e, _seq, _ttl, _now);
+  }
+  int16_t d = (int16_t)(uint16_t)(_seq - _e->top);
+  if (d > 0) {
+    _e->window = d >= L2D5DUP_WINDOW ? 1 : (_e->window << d) | 1;
+    _e->top = _seq;
+    _e->top_ttl = _ttl;
+    _e->last_seen = _now;
+    return L2D5DUP_NEW;
+  }
+  uint32_t age = (uint32_t)(-(int32_t)d);
+  if (age >= L2D5DUP_WINDOW) {
+    _c->stale++;
+    return L2D5DUP_STALE;
+  }
+  uint64_t bit = 1ull << age;
+  if ((_e->window & bit) == 0) {
+    _e->window |= bit;
+    _e->last_seen = _now;
+    return L2D5DUP_NEW;
+  }
+  if (age == 0 && _ttl > _e->top_ttl) {
+    _e->top_ttl = _ttl;
+    _e->last_seen = _now;
+    return L2D5DUP_BETTER;
+  }
+  _c->dups++;
+  return L2D5DUP_SEEN;
+}
+
+L2D5DupResult_t L2D5Dup_check(L2D5DupCache_t *_c, const uint8_t *_addr, uint16_t _seq, uint16_t _ttl,
+                              uint64_t _now) {
+  uint64_t h = L2D5ADDR_hash(_addr);
+  size_t base[2] = { (size_t)((uint32_t)h & _c->bucket_mask) * L2D5DUP_WAYS,
+                     (size_t)((uint32_t)(h >> 24) & _c->bucket_mask) * L2D5DUP_WAYS };
+  uint16_t tag = (uint16_t)(h >> 48) | 1;
+  _c->checks++;
+
+  for (int s = 0; s < 2; s++) {
+    for (uint32_t m = set_match(&_c->tag[base[s]], tag); m != 0; m &= m - 1) {
+      L2D5DupEntry_t *e = &_c->ent[base[s] + (uint32_t)__builtin_ctz(m)];
+      if (L2D5ADDR_equal(e->addr, _addr)) {
+        return entry_check(_c, e, _seq, _ttl, _now);
+      }
+    }
+  }
+
+  /* unknown source: the emptier set, else the least recently refreshed of both */
+  uint32_t free0 = set_match(&_c->tag[base[0]], 0), free1 = set_match(&_c->tag[base[1]], 0);
+  size_t slot;
+  if ((free0 | free1) != 0) {
+    slot = __builtin_popcount(free1) > __builtin_popcount(free0) ? base[1] + (uint32_t)__builtin_ctz(free1)
+                                                                 : base[0] + (uint32_t)__builtin_ctz(free0);
+  } else {
+    slot = base[0];
+    for (int s = 0; s < 2; s++) {
+      for (uint32_t k = 0; k < L2D5DUP_WAYS; k++) {
+        if (_c->ent[base[s] + k].last_seen < _c->ent[slot].last_seen) {
+          slot = base[s] + k;
+        }
+      }
+    }
+    _c->evictions++;
+  }
+  _c->tag[slot] = tag;
+  memcpy(_c->ent[slot].addr, _addr, 16);
+  return entry_reset(&_c->ent[slot], _seq, _ttl, _now);
+}
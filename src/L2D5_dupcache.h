@@ -0,0 +1,123 @@
+/*
+ * File:        src/L2D5_dupcache.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 flood duplicate-suppression cache for Radio_ORBIT.
+ *    Remembers which (source address, SEQ) pairs a relay has already seen,
+ *    so HELLO_PKT_RM (FORWARD bit) and other flooded frames are relayed
+ *    once instead of once per copy heard.
+ *
+ *
+ *  Per source: a sliding window of the last L2D5DUP_WINDOW SEQ numbers.
+ *
+ *   bit i of window = "top - i seen"          (16-bit serial arithmetic)
+ *
+ *   SEQ newer than top      -> window shifts, top = SEQ         NEW
+ *   top - 63 .. top, unseen -> bit set                          NEW
+ *   top - 63 .. top, seen   -> top with more TTL left than any
+ *                              copy so far                      BETTER
+ *                              otherwise                        SEEN
+ *   older than top - 63     ->                                  STALE
+ *
+ *  BETTER keeps a TTL-scoped flood at its full radius: when the first copy
+ *  a relay hears took the long way round, the shorter copy behind it is
+ *  still relayed, once.
+ *
+ *  Sources live in 8-way sets of 16-bit tags, one SSE2 / NEON compare per
+ *  set. Each source has two candidate sets and is placed in the emptier
+ *  one, so overflow is rare at half load. When both sets are full, the
+ *  least recently refreshed of their 16 sources is evicted.
+ *
+ * NOTE:
+ *   - Fixed memory, no allocation after L2D5Dup_init(), not thread safe.
+ *   - A source is refreshed only by NEW / BETTER. One that has not been
+ *     refreshed for _hold (e.g. it rebooted and restarted SEQ) is
+ *     forgotten on its next frame, which is then NEW.
+ *   - Eviction fails open: a forgotten source's copies are relayed again.
+ *
+ */
+
+#ifndef L2D5_DUPCACHE_H
+#define L2D5_DUPCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_struct.h"
+#include "L2D5_addr.h"
+#include "ORBIT_schema.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5DUP_WAYS   8
+#define L2D5DUP_WINDOW 64
+
+
+typedef enum {
+  L2D5DUP_NEW = 0,                        // first copy: process and relay
+  L2D5DUP_BETTER,                         // newest SEQ again, more TTL left: relay
+  L2D5DUP_SEEN,                           // duplicate: drop
+  L2D5DUP_STALE                           // behind the window: drop
+} L2D5DupResult_t;
+
+
+typedef struct {
+  uint8_t  addr[16];
+  uint64_t window;
+  uint64_t last_seen;
+  uint16_t top;
+  uint16_t top_ttl;                       // most TTL left on a copy of top
+  uint32_t _pad;
+} L2D5DupEntry_t;
+
+
+typedef struct {
+  uint16_t       *tag;                    // buckets * L2D5DUP_WAYS, 0 = empty
+  L2D5DupEntry_t *ent;
+  uint32_t        bucket_mask;
+  uint64_t        hold;
+
+  uint64_t        checks;
+  uint64_t        dups;                   // SEEN
+  uint64_t        stale;
+  uint64_t        evictions;
+} L2D5DupCache_t;
+
+
+/* _sources sources at most half load (power of 2 of 8-way sets); 0 or -1 */
+int  L2D5Dup_init(L2D5DupCache_t *_c, uint32_t _sources, uint64_t _hold);
+void L2D5Dup_free(L2D5DupCache_t *_c);
+void L2D5Dup_clear(L2D5DupCache_t *_c);
+
+/* Records and classifies one copy of (_addr, _seq) arriving with _ttl hops left */
+L2D5DupResult_t L2D5Dup_check(L2D5DupCache_t *_c, const uint8_t *_addr, uint16_t _seq, uint16_t _ttl,
+                              uint64_t _now);
+
+static inline bool L2D5Dup_forward(L2D5DupResult_t _r) {
+  return _r <= L2D5DUP_BETTER;
+}
+
+/* HELLO_PKT_RM: keyed on the HelloPkt NodeSrcAddr + SEQ, TTL from the L2.5 header */
+static inline L2D5DupResult_t L2D5Dup_check_hello(L2D5DupCache_t *_c, const L2D5Frame_t *_f, uint64_t _now) {
+  const L2D5Routing_HelloPkt_t *h = (const L2D5Routing_HelloPkt_t *)_f->Payload;
+  return L2D5Dup_check(_c, h->NodeSrcAddr, L2D5HelloPkt_get_SEQ(h), L2D5Frame_get_TTL(_f), _now);
+}
+
+/* Bytes held by the cache */
+static inline size_t L2D5Dup_bytes(const L2D5DupCache_t *_c) {
+  size_t slots = ((size_t)_c->bucket_mask + 1) * L2D5DUP_WAYS;
+  return slots * (sizeof(uint16_t) + sizeof(L2D5DupEntry_t));
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_DUPCACHE_H
@@ -0,0 +1,319 @@
+/*
+ * File:        src/L2D5_handshake.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 neighbor key agreement worker pool for Radio_ORBIT.
+ *    See L2D5_handshake.h
+ *
+ */
+
+#define _GNU_SOURCE
+#include "L2D5_handshake.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+#define HS_NIL         UINT32_MAX
+#define HS_IDLE_SPINS  64
+
+
+/* ------------------------------- X25519 -------------------------------- */
+
+static void *hs_priv_new(const uint8_t *_sk) {
+  return EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, NULL, _sk, 32);
+}
+
+static int hs_x25519(void *_priv, const uint8_t *_peer_pk, uint8_t *_shared) {
+  EVP_PKEY *peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, NULL, _peer_pk, 32);
+  EVP_PKEY_CTX *ctx = peer != NULL ? EVP_PKEY_CTX_new((EVP_PKEY *)_priv, NULL) : NULL;
+  size_t len = L2D5KEY_SHARED_BYTES;
+  int ok = ctx != NULL && EVP_PKEY_derive_init(ctx) == 1 && EVP_PKEY_derive_set_peer(ctx, peer) == 1 &&
+           EVP_PKEY_derive(ctx, _shared, &len) == 1 && len == L2D5KEY_SHARED_BYTES;
+  EVP_PKEY_CTX_free(ctx);
+  EVP_PKEY_free(peer);
+  return ok ? 0 : -1;
+}
+
+int L2D5Hs_public(const uint8_t *_sk, uint8_t *_pk_out) {
+  EVP_PKEY *priv = hs_priv_new(_sk);
+  size_t len = 32;
+  int ok = priv != NULL && EVP_PKEY_get_raw_public_key(priv, _pk_out, &len) == 1 && len == 32;
+  EVP_PKEY_free(priv);
+  return ok ? 0 : -1;
+}
+
+int L2D5Hs_agree(const uint8_t *_sk, const uint8_t *_peer_pk, uint8_t *_shared_out) {
+  EVP_PKEY *priv = hs_priv_new(_sk);
+  int rc = priv != NULL ? hs_x25519(priv, _peer_pk, _shared_out) : -1;
+  EVP_PKEY_free(priv);
+  return rc;
+}
+
+
+/* ------------------------------- workers ------------------------------- */
+
+static inline bool hs_running(const L2D5Hs_t *_h) {
+  return atomic_load_explicit(&_h->running, memory_order_relaxed);
+}
+
+static void hs_idle(uint32_t *_spins) {
+  if (++*_spins < HS_IDLE_SPINS) {
+    sched_yield();
+    return;
+  }
+  struct timespec ts = { 0, L2D5HS_IDLE_SLEEP_NS };
+  nanosleep(&ts, NULL);
+}
+
+static void hs_compute(void *_priv, L2D5HsJob_t *_j) {
+  uint8_t hint[L2D5KEY_HINT_BYTES];
+  _j->status = hs_x25519(_priv, _j->PublicKey, _j->shared);
+  if (_j->status != 0) {
+    return;
+  }
+  L2D5Key_derive(_j->shared, _j->key, _j->iv);
+  L2D5Key_derive_hint(_j->shared, hint);
+  _j->hint = L2D5Key_hint_load(hint);
+}
+
+static void *hs_worker_main(void *_arg) {
+  L2D5HsWorker_t *w = _arg;
+  void *jobs[L2D5HS_BATCH];
+  uint32_t spins = 0;
+
+  while (hs_running(w->hs)) {
+    size_t n = ORBITSpsc_pop_burst(&w->in, jobs, L2D5HS_BATCH);
+    if (n == 0) {
+      hs_idle(&spins);
+      continue;
+    }
+    spins = 0;
+    for (size_t i = 0; i < n; i++) {
+      hs_compute(w->priv, jobs[i]);
+    }
+    /* out is as deep as the job table: never full */
+    ORBITSpsc_push_burst(&w->out, jobs, n);
+    atomic_store_explicit(&w->done, atomic_load_explicit(&w->done, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+    atomic_store_explicit(&w->bursts, atomic_load_explicit(&w->bursts, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+  }
+  return NULL;
+}
+
+
+/* ------------------------- pending index (owner) ----------------------- */
+
+static inline uint32_t pend_home(const L2D5Hs_t *_h, const uint8_t *_addr) {
+  return (uint32_t)L2D5ADDR_hash(_addr) & _h->pend_mask;
+}
+
+static uint32_t pend_find(const L2D5Hs_t *_h, const uint8_t *_addr) {
+  for (uint32_t i = pend_home(_h, _addr);; i = (i + 1) & _h->pend_mask) {
+    uint32_t j = _h->pend[i];
+    if (j == HS_NIL || L2D5ADDR_equal(_h->job[j].NodeAddr, _addr)) {
+      return i;
+    }
+  }
+}
+
+/* backward-shift deletion, keeps probe chains tombstone free */
+static void pend_erase(L2D5Hs_t *_h, uint32_t _i) {
+  uint32_t i = _i;
+  for (uint32_t k = (i + 1) & _h->pend_mask; _h->pend[k] != HS_NIL; k = (k + 1) & _h->pend_mask) {
+    uint32_t home = pend_home(_h, _h->job[_h->pend[k]].NodeAddr);
+    if (((k - home) & _h->pend_mask) >= ((k - i) & _h->pend_mask)) {
+      _h->pend[i] = _h->pend[k];
+      i = k;
+    }
+  }
+  _h->pend[i] = HS_NIL;
+}
+
+
+/* -------------------------------- pool --------------------------------- */
+
+static void hs_worker_release(L2D5HsWorker_t *_w) {
+  EVP_PKEY_free(_w->priv);
+  free(_w->in.slots);
+  free(_w->out.slots);
+  memset(_w, 0, sizeof(*_w));
+}
+
+int L2D5Hs_init(L2D5Hs_t *_h, L2D5NeighborTable_t *_nb, L2D5KeyCache_t *_keys, const uint8_t *_sk,
+                uint32_t _workers, uint32_t _jobs, const int *_cpu) {
+  memset(_h, 0, sizeof(*_h));
+  if (_workers == 0 || _workers > L2D5HS_MAX_WORKERS) {
+    return -1;
+  }
+  uint32_t njobs = _jobs != 0 ? _jobs : 256;
+  uint32_t pend = 2;
+  while (pend < njobs * 2) {
+    pend <<= 1;
+  }
+
+  _h->nb = _nb;
+  _h->keys = _keys;
+  _h->njobs = njobs;
+  _h->pend_mask = pend - 1;
+  _h->job = aligned_alloc(64, (size_t)njobs * sizeof(L2D5HsJob_t));
+  _h->worker = aligned_alloc(64, (size_t)_workers * sizeof(L2D5HsWorker_t));
+  _h->free_list = malloc((size_t)njobs * sizeof(uint32_t));
+  _h->stale = calloc(njobs, 1);
+  _h->pend = malloc((size_t)pend * sizeof(uint32_t));
+  if (_h->job == NULL || _h->worker == NULL || _h->free_list == NULL || _h->stale == NULL || _h->pend == NULL) {
+    L2D5Hs_free(_h);
+    return -1;
+  }
+  memset(_h->job, 0, (size_t)njobs * sizeof(L2D5HsJob_t));
+  memset(_h->worker, 0, (size_t)_workers * sizeof(L2D5HsWorker_t));
+  memset(_h->pend, 0xFF, (size_t)pend * sizeof(uint32_t));
+  for (uint32_t i = 0; i < njobs; i++) {
+    _h->free_list[i] = njobs - 1 - i;
+  }
+  _h->nfree = njobs;
+
+  atomic_init(&_h->running, true);
+  for (uint32_t w = 0; w < _workers; w++) {
+    L2D5HsWorker_t *wk = &_h->worker[w];
+    wk->hs = _h;
+    atomic_init(&wk->done, 0);
+    atomic_init(&wk->bursts, 0);
+    wk->priv = hs_priv_new(_sk);
+    if (wk->priv == NULL || ORBITSpsc_init(&wk->in, njobs) != 0 || ORBITSpsc_init(&wk->out, njobs) != 0 ||
+        pthread_create(&_h->thread[w], NULL, hs_worker_main, wk) != 0) {
+      hs_worker_release(wk);
+      L2D5Hs_free(_h);
+      return -1;
+    }
+    _h->nworkers++;
+    if (_cpu != NULL && _cpu[w] != L2D5HS_CPU_ANY) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(_cpu[w], &set);
+      pthread_setaffinity_np(_h->thread[w], sizeof(set), &set);   // best effort
+    }
+  }
+  return 0;
+}
+
+void L2D5Hs_free(L2D5Hs_t *_h) {
+  atomic_store(&_h->running, false);
+  for (uint32_t w = 0; w < _h->nworkers; w++) {
+    pthread_join(_h->thread[w], NULL);
+  }
+  for (uint32_t w = 0; w < _h->nworkers; w++) {
+    hs_worker_release(&_h->worker[w]);
+  }
+  if (_h->job != NULL) {
+    OPENSSL_cleanse(_h->job, (size_t)_h->njobs * sizeof(L2D5HsJob_t));
+  }
+  free(_h->job);
+  free(_h->worker);
+  free(_h->free_list);
+  free(_h->stale);
+  free(_h->pend);
+  memset(_h, 0, sizeof(*_h));
+}
+
+L2D5HsSubmit_t L2D5Hs_submit(L2D5Hs_t *_h, uint32_t _slot) {
+  const L2D5NeighborTable_t *nb = _h->nb;
+  if (nb->has_shared[_slot]) {
+    _h->have++;
+    return L2D5HS_HAVE;
+  }
+  const uint8_t *addr = nb->addr[_slot];
+  const uint8_t *pubkey = nb->keys[_slot].PublicKey;
+  L2D5NeighborRef_t ref = L2D5Neighbor_ref(nb, _slot);
+
+  uint32_t p = pend_find(_h, addr);
+  uint32_t old = _h->pend[p];
+  if (old != HS_NIL) {
+    const L2D5HsJob_t *o = &_h->job[old];
+    if (memcmp(o->PublicKey, pubkey, 32) == 0 && o->ref.slot == ref.slot && o->ref.gen == ref.gen) {
+      _h->dups++;
+      return L2D5HS_DUP;
+    }
+  }
+  if (_h->nfree == 0) {
+    _h->full++;
+    return L2D5HS_FULL;
+  }
+
+  uint32_t w = 0;
+  for (uint32_t i = 1; i < _h->nworkers; i++) {
+    if (_h->worker[i].load < _h->worker[w].load) {
+      w = i;
+    }
+  }
+  uint32_t id = _h->free_list[--_h->nfree];
+  L2D5HsJob_t *j = &_h->job[id];
+  memcpy(j->NodeAddr, addr, 16);
+  memcpy(j->PublicKey, pubkey, 32);
+  j->ref = ref;
+  j->worker = w;
+  _h->stale[id] = 0;
+  if (old != HS_NIL) {
+    _h->stale[old] = 1;                   // keeps its job slot until it comes back
+  }
+  _h->pend[p] = id;
+
+  void *item = j;
+  ORBITSpsc_push_burst(&_h->worker[w].in, &item, 1);   // as deep as the job table
+  _h->worker[w].load++;
+  _h->submitted++;
+  return L2D5HS_QUEUED;
+}
+
+static bool hs_install(L2D5Hs_t *_h, L2D5HsJob_t *_j) {
+  L2D5NeighborTable_t *nb = _h->nb;
+  if (!L2D5Neighbor_ref_valid(nb, _j->ref) || memcmp(nb->keys[_j->ref.slot].PublicKey, _j->PublicKey, 32) != 0) {
+    _h->superseded++;
+    return false;
+  }
+  if (_j->status != 0) {
+    _h->failed++;
+    return false;
+  }
+  L2D5Neighbor_set_shared(nb, _j->ref.slot, _j->shared);
+  if (_h->keys != NULL &&
+      L2D5KeyCache_install_keys(_h->keys, _j->NodeAddr, _j->PublicKey, _j->key, _j->iv, _j->hint) == NULL) {
+    _h->failed++;
+    return false;
+  }
+  _h->installed++;
+  return true;
+}
+
+uint32_t L2D5Hs_poll(L2D5Hs_t *_h) {
+  void *jobs[L2D5HS_BATCH];
+  uint32_t installed = 0;
+
+  for (uint32_t w = 0; w < _h->nworkers; w++) {
+    size_t n;
+    while ((n = ORBITSpsc_pop_burst(&_h->worker[w].out, jobs, L2D5HS_BATCH)) != 0) {
+      for (size_t i = 0; i < n; i++) {
+        L2D5HsJob_t *j = jobs[i];
+        uint32_t id = (uint32_t)(j - _h->job);
+        if (_h->stale[id]) {
+          _h->superseded++;
+        } else {
+          pend_erase(_h, pend_find(_h, j->NodeAddr));
+          installed += hs_install(_h, j);
+        }
+        OPENSSL_cleanse(j->shared, sizeof(j->shared));
+        OPENSSL_cleanse(j->key, sizeof(j->key));
+        OPENSSL_cleanse(j->iv, sizeof(j->iv));
+        _h->free_list[_h->nfree++] = id;
+      }
+      _h->worker[w].load -= (uint32_t)n;
+    }
+  }
+  return installed;
+}
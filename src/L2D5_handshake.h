@@ -0,0 +1,162 @@
+/*
+ * File:        src/L2D5_handshake.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 neighbor key agreement worker pool for Radio_ORBIT.
+ *    A HELLO from a neighbor without a SharedKey becomes a job: X25519
+ *    (own secret key, neighbor PublicKey) plus the SHA-384 / KeyHint
+ *    derivations of L2D5_keycache.h, run on worker threads in bursts.
+ *    Finished jobs are installed by the owner thread, the only writer of
+ *    the neighbor table and key cache.
+ *
+ *
+ *  Job flow (every hand-off is an ORBITSpsc_t ring, no locks):
+ *
+ *   owner: L2D5Hs_submit() --in[w]--> [worker w] --out[w]--> owner: L2D5Hs_poll()
+ *          dedup by NodeAddr           burst of      X25519          checks ref / key,
+ *          least loaded worker         L2D5HS_BATCH  SHA-384, hint   SharedKey + session
+ *
+ *  | Submit result  | When                                                |
+ *  ----------------------------------------------------------------------
+ *  | QUEUED         | new job                                             |
+ *  | DUP            | same NodeAddr and PublicKey already in progress     |
+ *  | HAVE           | neighbor already has a SharedKey                    |
+ *  | FULL           | every job slot in use; the next HELLO retries       |
+ *
+ *  A job whose neighbor announced another PublicKey meanwhile is
+ *  superseded: the new key gets its own job, the old result is dropped.
+ *  So is a result whose neighbor slot was freed or reused (gen changed).
+ *
+ * NOTE:
+ *   - Submit / poll / free from one thread (the one owning the neighbor
+ *     table, e.g. the ROUTE stage).
+ *   - X25519 is OpenSSL's (RFC 7748), same output as libsodium's
+ *     crypto_scalarmult(). A peer key giving an all-zero secret fails.
+ *   - Idle workers yield, then sleep L2D5HS_IDLE_SLEEP_NS per round.
+ *
+ */
+
+#ifndef L2D5_HANDSHAKE_H
+#define L2D5_HANDSHAKE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_neighbor.h"
+#include "L2D5_keycache.h"
+#include "ORBIT_spsc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5HS_MAX_WORKERS    64
+#define L2D5HS_BATCH          16          // jobs per worker burst
+#define L2D5HS_IDLE_SLEEP_NS  200000
+#define L2D5HS_CPU_ANY        (-1)
+
+
+typedef enum {
+  L2D5HS_QUEUED = 0,
+  L2D5HS_DUP,
+  L2D5HS_HAVE,
+  L2D5HS_FULL
+} L2D5HsSubmit_t;
+
+
+typedef struct {
+  _Alignas(64)
+  /* in: written by the owner before the job is pushed */
+  uint8_t           NodeAddr[16];
+  uint8_t           PublicKey[32];
+  L2D5NeighborRef_t ref;
+  uint32_t          worker;
+  /* out: written by the worker before the job comes back */
+  int32_t           status;               // 0, or -1 when X25519 failed
+  uint32_t          hint;
+  uint8_t           shared[L2D5KEY_SHARED_BYTES];
+  uint8_t           key[L2D5KEY_AES_KEY_BYTES];
+  uint8_t           iv[L2D5KEY_AES_IV_BYTES];
+} L2D5HsJob_t;
+
+
+typedef struct L2D5Hs L2D5Hs_t;
+
+typedef struct {
+  _Alignas(64)
+  L2D5Hs_t         *hs;
+  void             *priv;                 // EVP_PKEY, own X25519 key, this worker only
+  ORBITSpsc_t       in;                   // owner -> worker
+  ORBITSpsc_t       out;                  // worker -> owner
+  uint32_t          load;                 // owner: jobs handed out, not polled back
+  _Atomic uint64_t  done;                 // worker: jobs computed
+  _Atomic uint64_t  bursts;
+} L2D5HsWorker_t;
+
+
+struct L2D5Hs {
+  L2D5NeighborTable_t *nb;
+  L2D5KeyCache_t      *keys;              // optional, gets the session too
+  L2D5HsWorker_t      *worker;
+  uint32_t             nworkers;
+  pthread_t            thread[L2D5HS_MAX_WORKERS];
+  _Atomic bool         running;
+
+  /* owner only */
+  L2D5HsJob_t         *job;
+  uint32_t             njobs;
+  uint32_t            *free_list;
+  uint32_t             nfree;
+  uint8_t             *stale;             // per job: superseded, drop the result
+  uint32_t            *pend;              // NodeAddr -> job, open addressed
+  uint32_t             pend_mask;
+
+  uint64_t             submitted;
+  uint64_t             dups;
+  uint64_t             have;
+  uint64_t             full;
+  uint64_t             installed;
+  uint64_t             superseded;        // results dropped: key changed or neighbor gone
+  uint64_t             failed;            // X25519 rejected the peer key
+};
+
+
+/* Pure helpers (any thread). 0, or -1 on failure. */
+int L2D5Hs_public(const uint8_t *_sk, uint8_t *_pk_out);
+int L2D5Hs_agree(const uint8_t *_sk, const uint8_t *_peer_pk, uint8_t *_shared_out);
+
+/*
+ * Starts _workers threads (1 .. L2D5HS_MAX_WORKERS, pinned to _cpu[i]
+ * when _cpu != NULL) with X25519 secret key _sk, at most _jobs (0 -> 256)
+ * handshakes in flight. Results go to _nb, and to _keys when not NULL.
+ * Returns 0, or -1.
+ */
+int  L2D5Hs_init(L2D5Hs_t *_h, L2D5NeighborTable_t *_nb, L2D5KeyCache_t *_keys, const uint8_t *_sk,
+                 uint32_t _workers, uint32_t _jobs, const int *_cpu);
+
+/* Stops the workers; jobs still in flight are dropped */
+void L2D5Hs_free(L2D5Hs_t *_h);
+
+/* Key agreement for the neighbor in _slot (its NodeAddr and PublicKey as stored) */
+L2D5HsSubmit_t L2D5Hs_submit(L2D5Hs_t *_h, uint32_t _slot);
+
+/* Installs finished jobs. Returns SharedKeys installed. */
+uint32_t L2D5Hs_poll(L2D5Hs_t *_h);
+
+/* Jobs submitted and not polled back yet */
+static inline uint32_t L2D5Hs_pending(const L2D5Hs_t *_h) {
+  return _h->njobs - _h->nfree;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_HANDSHAKE_H
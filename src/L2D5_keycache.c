@@ -0,0 +1,492 @@
+/*
+ * File:        src/L2D5_keycache.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 session key cache for Radio_ORBIT.
+ *    See L2D5_keycache.h
+ *
+ */
+
+#include "L2D5_keycache.h"
+#include "L2D5_classify.h"
+#include <stdlib.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+#define KEYHINT_LABEL "ORBIT-KEYHINT"
+
+
+/* SHA-384(shared) -> 32-byte AES key + 16-byte IV */
+void L2D5Key_derive(const uint8_t *_shared, uint8_t *_key_out, uint8_t *_iv_out) {
+  uint8_t digest[48];
+  unsigned int len = 0;
+
+  EVP_Digest(_shared, L2D5KEY_SHARED_BYTES, digest, &len, EVP_sha384(), NULL);
+  memcpy(_key_out, digest, L2D5KEY_AES_KEY_BYTES);
+  memcpy(_iv_out, digest + L2D5KEY_AES_KEY_BYTES, L2D5KEY_AES_IV_BYTES);
+  OPENSSL_cleanse(digest, sizeof(digest));
+}
+
+void L2D5Key_derive_hint(const uint8_t *_shared, uint8_t *_hint_out) {
+  uint8_t msg[sizeof(KEYHINT_LABEL) - 1 + L2D5KEY_SHARED_BYTES];
+  uint8_t digest[32];
+  unsigned int len = 0;
+
+  memcpy(msg, KEYHINT_LABEL, sizeof(KEYHINT_LABEL) - 1);
+  memcpy(msg + sizeof(KEYHINT_LABEL) - 1, _shared, L2D5KEY_SHARED_BYTES);
+  EVP_Digest(msg, sizeof(msg), digest, &len, EVP_sha256(), NULL);
+  memcpy(_hint_out, digest, L2D5KEY_HINT_BYTES);
+  OPENSSL_cleanse(msg, sizeof(msg));
+}
+
+
+/* ------------------------- open-addressed index ------------------------ */
+
+static inline uint32_t kidx_home(const L2D5KeyCache_t *_c, uint32_t _key) {
+  return L2D5ADDR_mix32(_key) & _c->idx_mask;
+}
+
+static void kidx_insert(L2D5KeyCache_t *_c, L2D5KeyIndexEntry_t *_idx, uint32_t _key, uint32_t _slot) {
+  uint32_t i = kidx_home(_c, _key);
+  while (_idx[i].slot != L2D5KEYCACHE_NIL) {
+    i = (i + 1) & _c->idx_mask;
+  }
+  _idx[i].key = _key;
+  _idx[i].slot = _slot;
+}
+
+/* backward-shift deletion, keeps probe chains tombstone free */
+static void kidx_remove(L2D5KeyCache_t *_c, L2D5KeyIndexEntry_t *_idx, uint32_t _key, uint32_t _slot) {
+  uint32_t mask = _c->idx_mask;
+  uint32_t i = kidx_home(_c, _key);
+  while (_idx[i].slot != _slot) {
+    if (_idx[i].slot == L2D5KEYCACHE_NIL) {
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  uint32_t j = i;
+  for (;;) {
+    j = (j + 1) & mask;
+    if (_idx[j].slot == L2D5KEYCACHE_NIL) {
+      break;
+    }
+    uint32_t k = kidx_home(_c, _idx[j].key);
+    /* move j back into the hole at i unless its home lies in (i, j] */
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      _idx[i] = _idx[j];
+      i = j;
+    }
+  }
+  _idx[i].slot = L2D5KEYCACHE_NIL;
+}
+
+static inline uint32_t addr_key(const uint8_t *_addr) {
+  return (uint32_t)L2D5ADDR_hash(_addr);
+}
+
+
+/* ------------------------------- LRU ---------------------------------- */
+
+static void lru_unlink(L2D5KeyCache_t *_c, uint32_t _slot) {
+  L2D5Session_t *s = &_c->sessions[_slot];
+  if (s->lru_prev != L2D5KEYCACHE_NIL) {
+    _c->sessions[s->lru_prev].lru_next = s->lru_next;
+  } else {
+    _c->lru_head = s->lru_next;
+  }
+  if (s->lru_next != L2D5KEYCACHE_NIL) {
+    _c->sessions[s->lru_next].lru_prev = s->lru_prev;
+  } else {
+    _c->lru_tail = s->lru_prev;
+  }
+}
+
+static void lru_push_front(L2D5KeyCache_t *_c, uint32_t _slot) {
+  L2D5Session_t *s = &_c->sessions[_slot];
+  s->lru_prev = L2D5KEYCACHE_NIL;
+  s->lru_next = _c->lru_head;
+  if (_c->lru_head != L2D5KEYCACHE_NIL) {
+    _c->sessions[_c->lru_head].lru_prev = _slot;
+  } else {
+    _c->lru_tail = _slot;
+  }
+  _c->lru_head = _slot;
+}
+
+static inline void lru_touch(L2D5KeyCache_t *_c, uint32_t _slot) {
+  if (_c->lru_head != _slot) {
+    lru_unlink(_c, _slot);
+    lru_push_front(_c, _slot);
+  }
+}
+
+
+/* ------------------------------ cache --------------------------------- */
+
+int L2D5KeyCache_init(L2D5KeyCache_t *_c, uint32_t _capacity) {
+  memset(_c, 0, sizeof(*_c));
+  if (_capacity == 0) {
+    return -1;
+  }
+
+  uint32_t idx_size = 1;
+  while (idx_size < 2 * _capacity) {
+    idx_size <<= 1;
+  }
+
+  _c->sessions = calloc(_capacity, sizeof(L2D5Session_t));
+  _c->hint_idx = malloc(idx_size * sizeof(L2D5KeyIndexEntry_t));
+  _c->addr_idx = malloc(idx_size * sizeof(L2D5KeyIndexEntry_t));
+  _c->cipher = EVP_CIPHER_fetch(NULL, "AES-256-CBC-CTS", NULL);
+  _c->capacity = _capacity;
+  _c->aesni = L2D5Aes_available();
+  if (_c->aesni) {
+    _c->aes_keys = aligned_alloc(64, ((_capacity * sizeof(L2D5AesKey_t)) + 63) & ~(size_t)63);
+  }
+  if (_c->sessions == NULL || _c->hint_idx == NULL || _c->addr_idx == NULL || _c->cipher == NULL ||
+      (_c->aesni && _c->aes_keys == NULL)) {
+    L2D5KeyCache_free(_c);
+    return -1;
+  }
+  _c->idx_mask = idx_size - 1;
+  for (uint32_t i = 0; i < idx_size; i++) {
+    _c->hint_idx[i].slot = L2D5KEYCACHE_NIL;
+    _c->addr_idx[i].slot = L2D5KEYCACHE_NIL;
+  }
+
+  _c->lru_head = _c->lru_tail = L2D5KEYCACHE_NIL;
+  for (uint32_t i = 0; i < _capacity; i++) {
+    L2D5Session_t *s = &_c->sessions[i];
+    s->enc = EVP_CIPHER_CTX_new();
+    s->dec = EVP_CIPHER_CTX_new();
+    if (s->enc == NULL || s->dec == NULL) {
+      L2D5KeyCache_free(_c);
+      return -1;
+    }
+    s->aes = _c->aesni ? &_c->aes_keys[i] : NULL;
+    s->lru_next = (i + 1 < _capacity) ? i + 1 : L2D5KEYCACHE_NIL;
+  }
+  _c->free_head = 0;
+  return 0;
+}
+
+void L2D5KeyCache_free(L2D5KeyCache_t *_c) {
+  if (_c->sessions != NULL) {
+    for (uint32_t i = 0; i < _c->capacity; i++) {
+      EVP_CIPHER_CTX_free(_c->sessions[i].enc);
+      EVP_CIPHER_CTX_free(_c->sessions[i].dec);
+    }
+    OPENSSL_cleanse(_c->sessions, _c->capacity * sizeof(L2D5Session_t));
+  }
+  if (_c->aes_keys != NULL) {
+    OPENSSL_cleanse(_c->aes_keys, _c->capacity * sizeof(L2D5AesKey_t));
+  }
+  free(_c->aes_keys);
+  EVP_CIPHER_free(_c->cipher);
+  free(_c->sessions);
+  free(_c->hint_idx);
+  free(_c->addr_idx);
+  memset(_c, 0, sizeof(*_c));
+}
+
+static uint32_t cache_find_slot(L2D5KeyCache_t *_c, const uint8_t *_addr) {
+  uint32_t key = addr_key(_addr);
+  uint32_t i = kidx_home(_c, key);
+  while (_c->addr_idx[i].slot != L2D5KEYCACHE_NIL) {
+    if (_c->addr_idx[i].key == key && L2D5ADDR_equal(_c->sessions[_c->addr_idx[i].slot].NodeAddr, _addr)) {
+      return _c->addr_idx[i].slot;
+    }
+    i = (i + 1) & _c->idx_mask;
+  }
+  return L2D5KEYCACHE_NIL;
+}
+
+static void cache_drop_slot(L2D5KeyCache_t *_c, uint32_t _slot) {
+  L2D5Session_t *s = &_c->sessions[_slot];
+  kidx_remove(_c, _c->hint_idx, s->hint, _slot);
+  kidx_remove(_c, _c->addr_idx, addr_key(s->NodeAddr), _slot);
+  lru_unlink(_c, _slot);
+  /* contexts stay allocated for reuse; their key schedule is replaced on the next install */
+  s->valid = 0;
+  s->lru_next = _c->free_head;
+  _c->free_head = _slot;
+  _c->count--;
+}
+
+L2D5Session_t *L2D5KeyCache_install_keys(L2D5KeyCache_t *_c, const uint8_t *_addr,
+                                         const uint8_t *_pubkey, const uint8_t *_key,
+                                         const uint8_t *_iv, uint32_t _hint) {
+  uint32_t slot = cache_find_slot(_c, _addr);
+  if (slot != L2D5KEYCACHE_NIL) {
+    cache_drop_slot(_c, slot);
+  }
+  if (_c->free_head == L2D5KEYCACHE_NIL) {
+    cache_drop_slot(_c, _c->lru_tail);
+    _c->evictions++;
+  }
+  slot = _c->free_head;
+  L2D5Session_t *s = &_c->sessions[slot];
+  _c->free_head = s->lru_next;
+
+  if (EVP_EncryptInit_ex2(s->enc, _c->cipher, _key, _iv, NULL) != 1 ||
+      EVP_DecryptInit_ex2(s->dec, _c->cipher, _key, _iv, NULL) != 1) {
+    s->lru_next = _c->free_head;
+    _c->free_head = slot;
+    return NULL;
+  }
+  if (s->aes != NULL) {
+    L2D5Aes_expand(_key, s->aes);
+  }
+  s->hint = _hint;
+  memcpy(s->NodeAddr, _addr, L2D5ADDR_BYTES);
+  memcpy(s->iv, _iv, L2D5KEY_AES_IV_BYTES);
+  memcpy(s->PublicKey, _pubkey, sizeof(s->PublicKey));
+  s->uses = 0;
+  s->valid = 1;
+
+  kidx_insert(_c, _c->hint_idx, _hint, slot);
+  kidx_insert(_c, _c->addr_idx, addr_key(_addr), slot);
+  lru_push_front(_c, slot);
+  _c->count++;
+  return s;
+}
+
+L2D5Session_t *L2D5KeyCache_install(L2D5KeyCache_t *_c, const uint8_t *_addr,
+                                    const uint8_t *_pubkey, const uint8_t *_shared) {
+  uint8_t key[L2D5KEY_AES_KEY_BYTES], iv[L2D5KEY_AES_IV_BYTES], hint[L2D5KEY_HINT_BYTES];
+
+  L2D5Key_derive(_shared, key, iv);
+  L2D5Key_derive_hint(_shared, hint);
+  L2D5Session_t *s = L2D5KeyCache_install_keys(_c, _addr, _pubkey, key, iv, L2D5Key_hint_load(hint));
+  OPENSSL_cleanse(key, sizeof(key));
+  return s;
+}
+
+L2D5Session_t *L2D5KeyCache_find(L2D5KeyCache_t *_c, const uint8_t *_addr) {
+  uint32_t slot = cache_find_slot(_c, _addr);
+  return slot == L2D5KEYCACHE_NIL ? NULL : &_c->sessions[slot];
+}
+
+int L2D5KeyCache_invalidate(L2D5KeyCache_t *_c, const uint8_t *_addr) {
+  uint32_t slot = cache_find_slot(_c, _addr);
+  if (slot == L2D5KEYCACHE_NIL) {
+    return 0;
+  }
+  cache_drop_slot(_c, slot);
+  return 1;
+}
+
+int L2D5KeyCache_observe_pubkey(L2D5KeyCache_t *_c, const uint8_t *_addr, const uint8_t *_pubkey) {
+  uint32_t slot = cache_find_slot(_c, _addr);
+  if (slot == L2D5KEYCACHE_NIL || memcmp(_c->sessions[slot].PublicKey, _pubkey, 32) == 0) {
+    return 0;
+  }
+  cache_drop_slot(_c, slot);
+  return 1;
+}
+
+
+int L2D5KeyCache_encrypt(L2D5KeyCache_t *_c, L2D5Session_t *_s,
+                         const L2D5Frame_t *_in, L2D5Frame_Encrypted_t *_out) {
+  int len = 0;
+
+  /* new IV only: the expanded key schedule in the context is kept */
+  if (EVP_EncryptInit_ex2(_s->enc, NULL, NULL, _s->iv, NULL) != 1 ||
+      EVP_EncryptUpdate(_s->enc, _out->EncryptedPayload, &len,
+                        (const uint8_t *)_in + offsetof(L2D5Frame_t, SrcAddress),
+                        (int)L2D5KEY_CIPHER_BYTES) != 1 ||
+      len != (int)L2D5KEY_CIPHER_BYTES) {
+    return -1;
+  }
+  _out->TAG = _in->TAG;
+  memcpy(_out->KeyHint, &_s->hint, L2D5KEY_HINT_BYTES);
+  _out->FLAG = _in->FLAG;
+  _s->uses++;
+  lru_touch(_c, (uint32_t)(_s - _c->sessions));
+  return 0;
+}
+
+/* A relayed frame (TAG FORWARD) keeps its originator in SrcAddress */
+static inline bool frame_relayed(uint8_t _tag) {
+  return (_tag & L2D5CLS_TAG_FORWARD) != 0;
+}
+
+static L2D5Session_t *decrypt_accept(L2D5KeyCache_t *_c, uint32_t _slot, const L2D5Frame_Encrypted_t *_in,
+                                     L2D5Frame_t *_out) {
+  L2D5Session_t *s = &_c->sessions[_slot];
+  _out->TAG = _in->TAG;
+  memmove(_out->KeyHint, _in->KeyHint, L2D5KEY_HINT_BYTES);
+  _out->FLAG = _in->FLAG;
+  s->uses++;
+  _c->hits++;
+  lru_touch(_c, _slot);
+  return s;
+}
+
+L2D5Session_t *L2D5KeyCache_decrypt(L2D5KeyCache_t *_c, const L2D5Frame_Encrypted_t *_in,
+                                    L2D5Frame_t *_out) {
+  uint32_t hint = L2D5Key_hint_load(_in->KeyHint);
+  uint32_t i = kidx_home(_c, hint);
+  uint32_t tried = 0, last = L2D5KEYCACHE_NIL;
+
+  for (; _c->hint_idx[i].slot != L2D5KEYCACHE_NIL; i = (i + 1) & _c->idx_mask) {
+    if (_c->hint_idx[i].key != hint) {
+      continue;
+    }
+    uint32_t slot = _c->hint_idx[i].slot;
+    L2D5Session_t *s = &_c->sessions[slot];
+    int len = 0;
+    if (EVP_DecryptInit_ex2(s->dec, NULL, NULL, s->iv, NULL) != 1 ||
+        EVP_DecryptUpdate(s->dec, (uint8_t *)_out + offsetof(L2D5Frame_t, SrcAddress), &len,
+                          _in->EncryptedPayload, (int)L2D5KEY_CIPHER_BYTES) != 1) {
+      continue;
+    }
+    tried++;
+    last = slot;
+    if (L2D5ADDR_equal(_out->SrcAddress, s->NodeAddr)) {
+      _c->collisions += tried - 1;
+      return decrypt_accept(_c, slot, _in, _out);
+    }
+  }
+  /* relayed: the session is the previous hop, only an unambiguous hint names it */
+  if (tried == 1 && frame_relayed(_in->TAG)) {
+    return decrypt_accept(_c, last, _in, _out);
+  }
+  _c->collisions += tried;
+  _c->misses++;
+  return NULL;
+}
+
+
+/* ------------------------------ batch --------------------------------- */
+
+#define FRAME_BODY(_f) ((uint8_t *)(_f) + offsetof(L2D5Frame_t, SrcAddress))
+
+size_t L2D5KeyCache_encrypt_batch(L2D5KeyCache_t *_c, L2D5Session_t *const *_s,
+                                  const L2D5Frame_t *const *_in, L2D5Frame_Encrypted_t *const *_out,
+                                  size_t _n) {
+  size_t done = 0;
+
+  if (!_c->aesni) {
+    for (size_t i = 0; i < _n; i++) {
+      done += (L2D5KeyCache_encrypt(_c, _s[i], _in[i], _out[i]) == 0);
+    }
+    return done;
+  }
+
+  for (size_t i = 0; i < _n; i += L2D5AES_LANES) {
+    const L2D5AesKey_t *keys[L2D5AES_LANES];
+    const uint8_t *ivs[L2D5AES_LANES], *in[L2D5AES_LANES];
+    uint8_t *out[L2D5AES_LANES];
+    size_t lanes = (_n - i < L2D5AES_LANES) ? _n - i : L2D5AES_LANES;
+
+    for (size_t l = 0; l < lanes; l++) {
+      L2D5Session_t *s = _s[i + l];
+      keys[l] = s->aes;
+      ivs[l] = s->iv;
+      in[l] = FRAME_BODY(_in[i + l]);
+      out[l] = _out[i + l]->EncryptedPayload;
+    }
+    L2D5Aes_cts_encrypt_lanes(keys, ivs, in, out, lanes, L2D5KEY_CIPHER_BYTES);
+    for (size_t l = 0; l < lanes; l++) {
+      L2D5Session_t *s = _s[i + l];
+      _out[i + l]->TAG = _in[i + l]->TAG;
+      _out[i + l]->FLAG = _in[i + l]->FLAG;
+      memcpy(_out[i + l]->KeyHint, &s->hint, L2D5KEY_HINT_BYTES);
+      s->uses++;
+      lru_touch(_c, (uint32_t)(s - _c->sessions));
+    }
+    done += lanes;
+  }
+  return done;
+}
+
+/* Only session for _hint, NULL if none, *_ambiguous set if more than one */
+static L2D5Session_t *cache_sole_by_hint(L2D5KeyCache_t *_c, uint32_t _hint, bool *_ambiguous) {
+  L2D5Session_t *found = NULL;
+  *_ambiguous = false;
+  for (uint32_t i = kidx_home(_c, _hint); _c->hint_idx[i].slot != L2D5KEYCACHE_NIL; i = (i + 1) & _c->idx_mask) {
+    if (_c->hint_idx[i].key == _hint) {
+      if (found != NULL) {
+        *_ambiguous = true;
+        return NULL;
+      }
+      found = &_c->sessions[_c->hint_idx[i].slot];
+    }
+  }
+  return found;
+}
+
+size_t L2D5KeyCache_decrypt_batch(L2D5KeyCache_t *_c, const L2D5Frame_Encrypted_t *const *_in,
+                                  L2D5Frame_t *const *_out, L2D5Session_t **_s_out, size_t _n) {
+  const L2D5AesKey_t *keys[L2D5AES_LANES];
+  const uint8_t *ivs[L2D5AES_LANES], *in[L2D5AES_LANES];
+  uint8_t *out[L2D5AES_LANES];
+  L2D5Session_t *sess[L2D5AES_LANES];
+  size_t idx[L2D5AES_LANES];
+  size_t lanes = 0, done = 0;
+
+  for (size_t i = 0; i <= _n; i++) {
+    if (i < _n) {
+      bool ambiguous = false;
+      L2D5Session_t *s = NULL;
+      if (_c->aesni) {
+        s = cache_sole_by_hint(_c, L2D5Key_hint_load(_in[i]->KeyHint), &ambiguous);
+      }
+      if (s == NULL) {
+        if (_c->aesni && !ambiguous) {
+          _c->misses++;
+        } else {
+          /* no AES-NI or a KeyHint collision: the OpenSSL path tries every
+           * candidate, so it must work from a copy when decrypting in place */
+          L2D5Frame_Encrypted_t copy;
+          const L2D5Frame_Encrypted_t *src = _in[i];
+          if ((const void *)src == (const void *)_out[i]) {
+            memcpy(&copy, src, sizeof(copy));
+            src = &copy;
+          }
+          s = L2D5KeyCache_decrypt(_c, src, _out[i]);
+          done += (s != NULL);
+        }
+        if (_s_out != NULL) {
+          _s_out[i] = s;
+        }
+        continue;
+      }
+      _out[i]->TAG = _in[i]->TAG;
+      memmove(_out[i]->KeyHint, _in[i]->KeyHint, L2D5KEY_HINT_BYTES);
+      _out[i]->FLAG = _in[i]->FLAG;
+      keys[lanes] = s->aes;
+      ivs[lanes] = s->iv;
+      in[lanes] = _in[i]->EncryptedPayload;
+      out[lanes] = FRAME_BODY(_out[i]);
+      sess[lanes] = s;
+      idx[lanes] = i;
+      lanes++;
+    }
+    if (lanes == L2D5AES_LANES || (i == _n && lanes > 0)) {
+      L2D5Aes_cts_decrypt_lanes(keys, ivs, in, out, lanes, L2D5KEY_CIPHER_BYTES);
+      for (size_t l = 0; l < lanes; l++) {
+        L2D5Session_t *s = sess[l];
+        if (!L2D5ADDR_equal(_out[idx[l]]->SrcAddress, s->NodeAddr) && !frame_relayed(_out[idx[l]]->TAG)) {
+          _c->misses++;
+          s = NULL;
+        } else {
+          s->uses++;
+          _c->hits++;
+          lru_touch(_c, (uint32_t)(s - _c->sessions));
+          done++;
+        }
+        if (_s_out != NULL) {
+          _s_out[idx[l]] = s;
+        }
+      }
+      lanes = 0;
+    }
+  }
+  return done;
+}
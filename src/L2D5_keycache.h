@@ -0,0 +1,187 @@
+/*
+ * File:        src/L2D5_keycache.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 session key cache for Radio_ORBIT.
+ *    Holds one pre-keyed AES-256 context pair per neighbor session so that
+ *    encrypting/decrypting an L2D5Frame_Encrypted_t only costs the cipher.
+ *    X25519 + SHA-384 run once, when a session is installed.
+ *
+ *
+ *  Session derivation (shared = X25519(sk, peer_pk), 32 bytes):
+ *
+ *  | Output   | Derivation                               | Bytes |
+ *  ---------------------------------------------------------------
+ *  | AES key  | SHA-384(shared)[0..31]                   |  32   |
+ *  | AES IV   | SHA-384(shared)[32..47]                  |  16   |
+ *  | KeyHint  | SHA-256("ORBIT-KEYHINT" || shared)[0..3] |   4   |
+ *
+ *
+ *  Cipher: AES-256-CBC with ciphertext stealing (CS1), so the 210-byte
+ *  EncryptedPayload (SrcAddress .. Payload of L2D5Frame_t) stays 210 bytes.
+ *
+ *
+ *  Lookup:
+ *    - by KeyHint (RX): open-addressed hint index, several sessions may share
+ *      a hint; the decrypted SrcAddress must match the session NodeAddr.
+ *      A relayed frame (TAG FORWARD) keeps its originator in SrcAddress, so
+ *      it is taken by the only session with its hint (the previous hop) and
+ *      dropped when the hint is shared.
+ *    - by NodeAddr (TX, HELLO): open-addressed address index.
+ *    Bounded capacity, LRU eviction, no allocation after init.
+ *
+ *  Batch path: *_batch() push up to L2D5AES_LANES frames at a time through
+ *  the multi-buffer AES-NI kernels (L2D5_aes.h), with the per-session OpenSSL
+ *  contexts as the scalar fallback. Both are bit-exact.
+ *
+ * NOTE:
+ *   - Not thread safe; one cache per crypto thread.
+ *   - L2D5Session_t pointers stay valid until the next install / invalidate.
+ *
+ */
+
+#ifndef L2D5_KEYCACHE_H
+#define L2D5_KEYCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_struct.h"
+#include "L2D5_addr.h"
+#include "L2D5_aes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5KEY_SHARED_BYTES  32
+#define L2D5KEY_AES_KEY_BYTES 32
+#define L2D5KEY_AES_IV_BYTES  16
+#define L2D5KEY_HINT_BYTES    4
+#define L2D5KEY_CIPHER_BYTES  sizeof(((L2D5Frame_Encrypted_t *)0)->EncryptedPayload)
+
+#define L2D5KEYCACHE_NIL      UINT32_MAX
+
+
+typedef struct L2D5Session {
+  /* hot: touched on every frame */
+  uint32_t hint;                          // KeyHint, host order of the 4 wire bytes
+  uint32_t lru_prev;
+  uint32_t lru_next;
+  uint8_t  valid;
+  uint8_t  NodeAddr[16];
+  uint8_t  iv[L2D5KEY_AES_IV_BYTES];
+  void    *enc;                           // EVP_CIPHER_CTX, keyed
+  void    *dec;                           // EVP_CIPHER_CTX, keyed
+  L2D5AesKey_t *aes;                      // expanded schedule for the batch path, or NULL
+  /* cold */
+  uint8_t  PublicKey[32];
+  uint64_t uses;
+} L2D5Session_t;
+
+
+typedef struct {
+  uint32_t key;                           // hint or address hash
+  uint32_t slot;                          // L2D5KEYCACHE_NIL when empty
+} L2D5KeyIndexEntry_t;
+
+
+typedef struct {
+  L2D5Session_t       *sessions;
+  uint32_t             capacity;
+  uint32_t             count;
+  uint32_t             lru_head;          // most recently used
+  uint32_t             lru_tail;          // eviction candidate
+  uint32_t             free_head;         // free list through lru_next
+  L2D5KeyIndexEntry_t *hint_idx;
+  L2D5KeyIndexEntry_t *addr_idx;
+  uint32_t             idx_mask;
+  void                *cipher;            // EVP_CIPHER (AES-256-CBC-CTS)
+  L2D5AesKey_t        *aes_keys;          // one per session when AES-NI is usable
+  bool                 aesni;             // batch calls use L2D5Aes lanes
+  uint64_t             hits;
+  uint64_t             misses;
+  uint64_t             collisions;        // hint matched, address did not
+  uint64_t             evictions;
+} L2D5KeyCache_t;
+
+
+/* Derivations (see table above) */
+void L2D5Key_derive(const uint8_t *_shared, uint8_t *_key_out, uint8_t *_iv_out);
+void L2D5Key_derive_hint(const uint8_t *_shared, uint8_t *_hint_out);
+
+static inline uint32_t L2D5Key_hint_load(const uint8_t *_hint) {
+  uint32_t h;
+  memcpy(&h, _hint, 4);
+  return h;
+}
+
+
+/* Returns 0, or -1 on allocation / OpenSSL failure */
+int  L2D5KeyCache_init(L2D5KeyCache_t *_c, uint32_t _capacity);
+void L2D5KeyCache_free(L2D5KeyCache_t *_c);
+
+/*
+ * Install (or re-key) the session with _addr from an X25519 shared secret.
+ * Evicts the least recently used session when full. Returns NULL on failure.
+ */
+L2D5Session_t *L2D5KeyCache_install(L2D5KeyCache_t *_c, const uint8_t *_addr,
+                                    const uint8_t *_pubkey, const uint8_t *_shared);
+
+/* Same, with key / iv / hint already derived */
+L2D5Session_t *L2D5KeyCache_install_keys(L2D5KeyCache_t *_c, const uint8_t *_addr,
+                                         const uint8_t *_pubkey, const uint8_t *_key,
+                                         const uint8_t *_iv, uint32_t _hint);
+
+L2D5Session_t *L2D5KeyCache_find(L2D5KeyCache_t *_c, const uint8_t *_addr);
+
+/* Drop the session with _addr. Returns 1 if one was dropped. */
+int L2D5KeyCache_invalidate(L2D5KeyCache_t *_c, const uint8_t *_addr);
+
+/*
+ * Call for every HELLO: drops the session if _addr now announces a different
+ * PublicKey. Returns 1 if the session was dropped (caller must re-derive).
+ */
+int L2D5KeyCache_observe_pubkey(L2D5KeyCache_t *_c, const uint8_t *_addr, const uint8_t *_pubkey);
+
+/*
+ * Encrypt _in with _s: copies TAG/FLAG, writes KeyHint and the 210-byte
+ * EncryptedPayload. Returns 0, or -1 on cipher failure.
+ */
+int L2D5KeyCache_encrypt(L2D5KeyCache_t *_c, L2D5Session_t *_s,
+                         const L2D5Frame_t *_in, L2D5Frame_Encrypted_t *_out);
+
+/*
+ * Decrypt _in with the session selected by its KeyHint (address verified,
+ * or sole hint match for a relayed frame). Returns the session used (the
+ * link it arrived on), or NULL if no session decrypts it.
+ */
+L2D5Session_t *L2D5KeyCache_decrypt(L2D5KeyCache_t *_c, const L2D5Frame_Encrypted_t *_in,
+                                    L2D5Frame_t *_out);
+
+/*
+ * Encrypt _n frames, _s[i] for _in[i] -> _out[i]. _in[i] may alias _out[i].
+ * Returns the number of frames encrypted.
+ */
+size_t L2D5KeyCache_encrypt_batch(L2D5KeyCache_t *_c, L2D5Session_t *const *_s,
+                                  const L2D5Frame_t *const *_in, L2D5Frame_Encrypted_t *const *_out,
+                                  size_t _n);
+
+/*
+ * Decrypt _n frames, session picked by KeyHint like L2D5KeyCache_decrypt().
+ * _in[i] may alias _out[i]. _s_out[i] (optional) gets the session or NULL.
+ * Returns the number of frames decrypted.
+ */
+size_t L2D5KeyCache_decrypt_batch(L2D5KeyCache_t *_c, const L2D5Frame_Encrypted_t *const *_in,
+                                  L2D5Frame_t *const *_out, L2D5Session_t **_s_out, size_t _n);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_KEYCACHE_H
@@ -0,0 +1,311 @@
+/*
+ * File:        src/L2D5_neighbor.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 one-hop neighbor table for Radio_ORBIT.
+ *    See L2D5_neighbor.h
+ *
+ */
+
+#include "L2D5_neighbor.h"
+#include "ORBIT_schema.h"
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
+
+
+/* 16-bit mask: bit i set when _ctrl[i] == _tag */
+static inline uint32_t group_match(const uint8_t *_ctrl, uint8_t _tag) {
+#if defined(__SSE2__)
+  __m128i c = _mm_load_si128((const __m128i *)_ctrl);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8((char)_tag)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  static const uint8_t bit[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  uint8x16_t m = vandq_u8(vceqq_u8(vld1q_u8(_ctrl), vdupq_n_u8(_tag)), vld1q_u8(bit));
+  return (uint32_t)vaddv_u8(vget_low_u8(m)) | ((uint32_t)vaddv_u8(vget_high_u8(m)) << 8);
+#else
+  uint32_t m = 0;
+  for (int i = 0; i < L2D5NB_GROUP; i++) {
+    m |= (uint32_t)(_ctrl[i] == _tag) << i;
+  }
+  return m;
+#endif
+}
+
+/* 16-bit mask: bit i set when _ctrl[i] is EMPTY or DELETED (top bit set) */
+static inline uint32_t group_match_free(const uint8_t *_ctrl) {
+#if defined(__SSE2__)
+  return (uint32_t)_mm_movemask_epi8(_mm_load_si128((const __m128i *)_ctrl));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  static const uint8_t bit[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  uint8x16_t m = vandq_u8(vcltzq_s8(vreinterpretq_s8_u8(vld1q_u8(_ctrl))), vld1q_u8(bit));
+  return (uint32_t)vaddv_u8(vget_low_u8(m)) | ((uint32_t)vaddv_u8(vget_high_u8(m)) << 8);
+#else
+  uint32_t m = 0;
+  for (int i = 0; i < L2D5NB_GROUP; i++) {
+    m |= (uint32_t)(_ctrl[i] >> 7) << i;
+  }
+  return m;
+#endif
+}
+
+
+static void *nb_alloc(size_t _n, size_t _size) {
+  size_t bytes = (_n * _size + 63) & ~(size_t)63;
+  void *p = aligned_alloc(64, bytes);
+  if (p != NULL) {
+    memset(p, 0, bytes);
+  }
+  return p;
+}
+
+int L2D5Neighbor_init(L2D5NeighborTable_t *_t, uint32_t _capacity) {
+  uint32_t groups = 1;
+  while (groups * L2D5NB_GROUP < _capacity) {
+    groups <<= 1;
+  }
+  uint32_t cap = groups * L2D5NB_GROUP;
+
+  memset(_t, 0, sizeof(*_t));
+  _t->ctrl        = nb_alloc(cap, 1);
+  _t->addr        = nb_alloc(cap, 16);
+  _t->last_seen   = nb_alloc(cap, sizeof(uint64_t));
+  _t->last_rssi   = nb_alloc(cap, sizeof(int32_t));
+  _t->gen         = nb_alloc(cap, sizeof(uint32_t));
+  _t->nodes_limit = nb_alloc(cap, sizeof(uint16_t));
+  _t->has_shared  = nb_alloc(cap, 1);
+  _t->keys        = nb_alloc(cap, sizeof(L2D5NeighborKeys_t));
+  if (!_t->ctrl || !_t->addr || !_t->last_seen || !_t->last_rssi || !_t->gen ||
+      !_t->nodes_limit || !_t->has_shared || !_t->keys) {
+    L2D5Neighbor_free(_t);
+    return -1;
+  }
+  memset(_t->ctrl, L2D5NB_CTRL_EMPTY, cap);
+  _t->capacity = cap;
+  _t->group_mask = groups - 1;
+  return 0;
+}
+
+void L2D5Neighbor_free(L2D5NeighborTable_t *_t) {
+  if (_t->keys != NULL) {
+    memset(_t->keys, 0, (size_t)_t->capacity * sizeof(L2D5NeighborKeys_t));
+  }
+  free(_t->ctrl);
+  free(_t->addr);
+  free(_t->last_seen);
+  free(_t->last_rssi);
+  free(_t->gen);
+  free(_t->nodes_limit);
+  free(_t->has_shared);
+  free(_t->keys);
+  memset(_t, 0, sizeof(*_t));
+}
+
+
+/* Next group of the probe sequence of L2D5Neighbor_find() */
+static inline uint32_t probe_next(const L2D5NeighborTable_t *_t, uint32_t _g, uint32_t _i) {
+  return (_g + _i + 1) & _t->group_mask;
+}
+
+uint32_t L2D5Neighbor_find(const L2D5NeighborTable_t *_t, const uint8_t *_addr) {
+  uint64_t h = L2D5ADDR_hash(_addr);
+  uint8_t tag = (uint8_t)(h & 0x7F);
+  uint32_t g = (uint32_t)(h >> 7) & _t->group_mask;
+
+  for (uint32_t i = 0; i <= _t->group_mask; i++) {
+    const uint8_t *ctrl = _t->ctrl + (size_t)g * L2D5NB_GROUP;
+    uint32_t m = group_match(ctrl, tag);
+    while (m) {
+      uint32_t slot = g * L2D5NB_GROUP + (uint32_t)__builtin_ctz(m);
+      if (L2D5ADDR_equal(_t->addr[slot], _addr)) {
+        return slot;
+      }
+      m &= m - 1;
+    }
+    if (group_match(ctrl, L2D5NB_CTRL_EMPTY)) {
+      return L2D5NB_NIL;
+    }
+    g = probe_next(_t, g, i);
+  }
+  return L2D5NB_NIL;
+}
+
+/*
+ * Rehash in place without moving an occupied slot: a tombstone is only
+ * needed in a group some live entry's probe chain passes through (find()
+ * must not stop there). Every DELETED becomes EMPTY, then the free slots
+ * of each group passed on the way to a live entry go back to DELETED.
+ */
+static void nb_purge(L2D5NeighborTable_t *_t) {
+  for (uint32_t s = 0; s < _t->capacity; s++) {
+    if (_t->ctrl[s] == L2D5NB_CTRL_DELETED) {
+      _t->ctrl[s] = L2D5NB_CTRL_EMPTY;
+    }
+  }
+  for (uint32_t s = L2D5Neighbor_next(_t, 0); s != L2D5NB_NIL; s = L2D5Neighbor_next(_t, s + 1)) {
+    uint32_t g = (uint32_t)(L2D5ADDR_hash(_t->addr[s]) >> 7) & _t->group_mask;
+    for (uint32_t i = 0; g != s / L2D5NB_GROUP; i++) {
+      uint8_t *ctrl = _t->ctrl + (size_t)g * L2D5NB_GROUP;
+      /* chains only pass full groups, so these were all tombstones before */
+      for (uint32_t m = group_match(ctrl, L2D5NB_CTRL_EMPTY); m; m &= m - 1) {
+        ctrl[__builtin_ctz(m)] = L2D5NB_CTRL_DELETED;
+      }
+      g = probe_next(_t, g, i);
+    }
+  }
+  uint32_t deleted = 0;
+  for (uint32_t s = 0; s < _t->capacity; s++) {
+    deleted += _t->ctrl[s] == L2D5NB_CTRL_DELETED;
+  }
+  _t->deleted = deleted;
+  _t->purges++;
+}
+
+uint32_t L2D5Neighbor_insert(L2D5NeighborTable_t *_t, const uint8_t *_addr, bool *_created) {
+  uint32_t slot = L2D5Neighbor_find(_t, _addr);
+  if (_created != NULL) {
+    *_created = false;
+  }
+  if (slot != L2D5NB_NIL) {
+    return slot;
+  }
+
+  /* not present: the chain ends at the first group with an EMPTY slot,
+   * and the first tombstone on the way is reused before that EMPTY */
+  uint64_t h = L2D5ADDR_hash(_addr);
+  for (int pass = 0; pass < 2 && slot == L2D5NB_NIL; pass++) {
+    uint32_t g = (uint32_t)(h >> 7) & _t->group_mask, tomb = L2D5NB_NIL, empty = L2D5NB_NIL;
+    for (uint32_t i = 0; i <= _t->group_mask; i++) {
+      const uint8_t *ctrl = _t->ctrl + (size_t)g * L2D5NB_GROUP;
+      uint32_t d = tomb == L2D5NB_NIL ? group_match(ctrl, L2D5NB_CTRL_DELETED) : 0;
+      uint32_t e = group_match(ctrl, L2D5NB_CTRL_EMPTY);
+      if (d) {
+        tomb = g * L2D5NB_GROUP + (uint32_t)__builtin_ctz(d);
+      }
+      if (e) {
+        empty = g * L2D5NB_GROUP + (uint32_t)__builtin_ctz(e);
+        break;
+      }
+      g = probe_next(_t, g, i);
+    }
+    if (tomb != L2D5NB_NIL) {
+      slot = tomb;
+      _t->deleted--;
+    } else if (empty != L2D5NB_NIL && (uint64_t)(_t->count + _t->deleted + 1) * 8 <= (uint64_t)_t->capacity * 7) {
+      slot = empty;
+    } else if (_t->deleted == 0) {
+      break;                                // live load at the limit
+    } else {
+      nb_purge(_t);
+    }
+  }
+  if (slot == L2D5NB_NIL) {
+    return L2D5NB_NIL;
+  }
+
+  _t->ctrl[slot] = (uint8_t)(h & 0x7F);
+  memcpy(_t->addr[slot], _addr, 16);
+  _t->last_seen[slot] = 0;
+  _t->last_rssi[slot] = 0;
+  _t->nodes_limit[slot] = 0;
+  _t->has_shared[slot] = 0;
+  memset(&_t->keys[slot], 0, sizeof(L2D5NeighborKeys_t));
+  _t->gen[slot]++;
+  _t->count++;
+  if (_created != NULL) {
+    *_created = true;
+  }
+  return slot;
+}
+
+void L2D5Neighbor_remove(L2D5NeighborTable_t *_t, uint32_t _slot) {
+  if (_slot >= _t->capacity || !L2D5Neighbor_occupied(_t, _slot)) {
+    return;
+  }
+  const uint8_t *ctrl = _t->ctrl + (size_t)(_slot / L2D5NB_GROUP) * L2D5NB_GROUP;
+  /* a group that still has an EMPTY slot ends every probe chain through it */
+  if (group_match(ctrl, L2D5NB_CTRL_EMPTY)) {
+    _t->ctrl[_slot] = L2D5NB_CTRL_EMPTY;
+  } else {
+    _t->ctrl[_slot] = L2D5NB_CTRL_DELETED;
+    _t->deleted++;
+  }
+  memset(&_t->keys[_slot], 0, sizeof(L2D5NeighborKeys_t));
+  _t->has_shared[_slot] = 0;
+  _t->gen[_slot]++;
+  _t->count--;
+  if ((uint64_t)_t->deleted * L2D5NB_PURGE_DIV > _t->capacity) {
+    nb_purge(_t);
+  }
+}
+
+uint32_t L2D5Neighbor_observe(L2D5NeighborTable_t *_t, const uint8_t *_addr, const uint8_t *_pubkey,
+                              uint64_t _now, int32_t _rssi, unsigned *_flags) {
+  bool created = false;
+  unsigned flags = 0;
+  uint32_t slot = L2D5Neighbor_insert(_t, _addr, &created);
+
+  if (slot != L2D5NB_NIL) {
+    if (created) {
+      flags |= L2D5NB_OBS_NEW;
+    }
+    if (_pubkey != NULL && memcmp(_t->keys[slot].PublicKey, _pubkey, 32) != 0) {
+      if (!created) {
+        flags |= L2D5NB_OBS_KEY_CHANGED;
+      }
+      memcpy(_t->keys[slot].PublicKey, _pubkey, 32);
+      memset(_t->keys[slot].SharedKey, 0, 32);
+      _t->has_shared[slot] = 0;
+    }
+    L2D5Neighbor_touch(_t, slot, _now, _rssi);
+  }
+  if (_flags != NULL) {
+    *_flags = flags;
+  }
+  return slot;
+}
+
+uint32_t L2D5Neighbor_next(const L2D5NeighborTable_t *_t, uint32_t _from) {
+  for (uint32_t g = _from / L2D5NB_GROUP; g <= _t->group_mask; g++) {
+    uint32_t m = ~group_match_free(_t->ctrl + (size_t)g * L2D5NB_GROUP) & 0xFFFF;
+    if (g == _from / L2D5NB_GROUP) {
+      m &= 0xFFFFu << (_from % L2D5NB_GROUP);
+    }
+    if (m) {
+      return g * L2D5NB_GROUP + (uint32_t)__builtin_ctz(m);
+    }
+  }
+  return L2D5NB_NIL;
+}
+
+
+void L2D5Neighbor_export(const L2D5NeighborTable_t *_t, uint32_t _slot, L2D5Routing_NeighborTable_t *_out) {
+  memcpy(_out->NodeAddr, _t->addr[_slot], 16);
+  memcpy(_out->PublicKey, _t->keys[_slot].PublicKey, 32);
+  memcpy(_out->SharedKey, _t->keys[_slot].SharedKey, 32);
+  L2D5NbRecord_set_last_seen_time(_out, _t->last_seen[_slot]);
+  L2D5NbRecord_set_last_rssi(_out, _t->last_rssi[_slot]);
+  L2D5NbRecord_set_NodesLimit(_out, _t->nodes_limit[_slot]);
+}
+
+uint32_t L2D5Neighbor_import(L2D5NeighborTable_t *_t, const L2D5Routing_NeighborTable_t *_in) {
+  static const uint8_t zero[32] = {0};
+  uint32_t slot = L2D5Neighbor_insert(_t, _in->NodeAddr, NULL);
+  if (slot == L2D5NB_NIL) {
+    return L2D5NB_NIL;
+  }
+  memcpy(_t->keys[slot].PublicKey, _in->PublicKey, 32);
+  memcpy(_t->keys[slot].SharedKey, _in->SharedKey, 32);
+  _t->has_shared[slot] = memcmp(_in->SharedKey, zero, 32) != 0;
+  _t->last_seen[slot] = L2D5NbRecord_get_last_seen_time(_in);
+  _t->last_rssi[slot] = L2D5NbRecord_get_last_rssi(_in);
+  _t->nodes_limit[slot] = L2D5NbRecord_get_NodesLimit(_in);
+  return slot;
+}
@@ -0,0 +1,154 @@
+/*
+ * File:        src/L2D5_neighbor.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 one-hop neighbor table for Radio_ORBIT.
+ *    Open-addressed, SIMD-probed store of L2D5Routing_NeighborTable_t
+ *    records, split into hot and cold arrays (SoA).
+ *
+ *
+ *  Layout (capacity = 16 * groups, every array indexed by slot):
+ *
+ *  | Array      | Per slot | Temperature | Used by                      |
+ *  ----------------------------------------------------------------------
+ *  | ctrl       |     1    |     hot     | probe: 16 tags per SSE/NEON  |
+ *  | addr       |    16    |     hot     | NodeAddr, one 16-byte compare|
+ *  | last_seen  |     8    |     hot     | every HELLO / data frame     |
+ *  | last_rssi  |     4    |     hot     | every HELLO / data frame     |
+ *  | gen        |     4    |     warm    | slot reuse detection         |
+ *  | nodes_limit|     2    |     warm    | HELLO                        |
+ *  | keys       |    64    |     cold    | PublicKey + SharedKey        |
+ *
+ *  ctrl byte: 0x80 = EMPTY, 0xFE = DELETED, 0x00..0x7F = 7-bit hash tag.
+ *
+ *  Slots never move while occupied: a slot index (plus its gen) is a stable
+ *  handle that other tables (remote routes, timers) may keep.
+ *
+ * NOTE:
+ *   - Fixed capacity; insert fails at 7/8 load. Insert reuses the first
+ *     tombstone on its probe chain; past capacity / L2D5NB_PURGE_DIV
+ *     tombstones (or at the load limit) they are rehashed in place:
+ *     only groups a live chain passes keep them, no slot moves.
+ *   - Not thread safe; readers on other threads need their own sync.
+ *
+ */
+
+#ifndef L2D5_NEIGHBOR_H
+#define L2D5_NEIGHBOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_struct.h"
+#include "L2D5_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5NB_GROUP     16
+#define L2D5NB_NIL       UINT32_MAX
+
+#define L2D5NB_CTRL_EMPTY   0x80
+#define L2D5NB_CTRL_DELETED 0xFE
+#define L2D5NB_PURGE_DIV    8             // rehash tombstones beyond capacity / 8
+
+/* L2D5Neighbor_observe() result bits */
+#define L2D5NB_OBS_NEW         0x01
+#define L2D5NB_OBS_KEY_CHANGED 0x02
+
+
+typedef struct {
+  uint8_t PublicKey[32];
+  uint8_t SharedKey[32];
+} L2D5NeighborKeys_t;
+
+
+typedef struct {
+  /* hot */
+  uint8_t   *ctrl;
+  uint8_t  (*addr)[16];
+  uint64_t  *last_seen;
+  int32_t   *last_rssi;
+  /* warm */
+  uint32_t  *gen;
+  uint16_t  *nodes_limit;
+  uint8_t   *has_shared;
+  /* cold */
+  L2D5NeighborKeys_t *keys;
+
+  uint32_t   capacity;
+  uint32_t   group_mask;
+  uint32_t   count;
+  uint32_t   deleted;
+  uint64_t   purges;                      // in-place tombstone rehashes
+} L2D5NeighborTable_t;
+
+
+/* Stable reference to a neighbor: valid while gen matches */
+typedef struct {
+  uint32_t slot;
+  uint32_t gen;
+} L2D5NeighborRef_t;
+
+
+/* _capacity is rounded up to a power-of-2 number of 16-slot groups */
+int  L2D5Neighbor_init(L2D5NeighborTable_t *_t, uint32_t _capacity);
+void L2D5Neighbor_free(L2D5NeighborTable_t *_t);
+
+uint32_t L2D5Neighbor_find(const L2D5NeighborTable_t *_t, const uint8_t *_addr);
+
+/* Find or create. *_created (optional) tells which. L2D5NB_NIL when full. */
+uint32_t L2D5Neighbor_insert(L2D5NeighborTable_t *_t, const uint8_t *_addr, bool *_created);
+
+void L2D5Neighbor_remove(L2D5NeighborTable_t *_t, uint32_t _slot);
+
+/*
+ * HELLO / frame received from _addr: refresh last_seen / last_rssi, and
+ * when _pubkey != NULL compare it with the stored key.
+ * Returns the slot (L2D5NB_NIL when full); *_flags gets L2D5NB_OBS_* bits.
+ * A changed key clears the SharedKey (has_shared = 0).
+ */
+uint32_t L2D5Neighbor_observe(L2D5NeighborTable_t *_t, const uint8_t *_addr, const uint8_t *_pubkey,
+                              uint64_t _now, int32_t _rssi, unsigned *_flags);
+
+static inline bool L2D5Neighbor_occupied(const L2D5NeighborTable_t *_t, uint32_t _slot) {
+  return _t->ctrl[_slot] < 0x80;
+}
+
+static inline void L2D5Neighbor_touch(L2D5NeighborTable_t *_t, uint32_t _slot, uint64_t _now, int32_t _rssi) {
+  _t->last_seen[_slot] = _now;
+  _t->last_rssi[_slot] = _rssi;
+}
+
+static inline void L2D5Neighbor_set_shared(L2D5NeighborTable_t *_t, uint32_t _slot, const uint8_t *_shared) {
+  memcpy(_t->keys[_slot].SharedKey, _shared, 32);
+  _t->has_shared[_slot] = 1;
+}
+
+static inline L2D5NeighborRef_t L2D5Neighbor_ref(const L2D5NeighborTable_t *_t, uint32_t _slot) {
+  L2D5NeighborRef_t r = { _slot, _t->gen[_slot] };
+  return r;
+}
+
+static inline bool L2D5Neighbor_ref_valid(const L2D5NeighborTable_t *_t, L2D5NeighborRef_t _r) {
+  return _r.slot < _t->capacity && _t->gen[_r.slot] == _r.gen && L2D5Neighbor_occupied(_t, _r.slot);
+}
+
+/* Next occupied slot >= _from, or L2D5NB_NIL */
+uint32_t L2D5Neighbor_next(const L2D5NeighborTable_t *_t, uint32_t _from);
+
+/* Packed 94-byte record <-> table slot (multi-byte fields big-endian) */
+void     L2D5Neighbor_export(const L2D5NeighborTable_t *_t, uint32_t _slot, L2D5Routing_NeighborTable_t *_out);
+uint32_t L2D5Neighbor_import(L2D5NeighborTable_t *_t, const L2D5Routing_NeighborTable_t *_in);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_NEIGHBOR_H
@@ -0,0 +1,448 @@
+/*
+ * File:        src/L2D5_route.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 OEMR remote route engine for Radio_ORBIT.
+ *    See L2D5_route.h
+ *
+ */
+
+#include "L2D5_route.h"
+#include "ORBIT_schema.h"
+#include <stdlib.h>
+
+
+/* ------------------------- open-addressed index ------------------------ */
+
+static inline uint32_t ridx_home(const L2D5RouteTable_t *_r, uint32_t _key) {
+  return L2D5ADDR_mix32(_key) & _r->idx_mask;
+}
+
+static void ridx_insert(L2D5RouteTable_t *_r, uint32_t _key, uint32_t _dest) {
+  uint32_t i = ridx_home(_r, _key);
+  while (_r->idx[i].dest != L2D5ROUTE_NIL) {
+    i = (i + 1) & _r->idx_mask;
+  }
+  _r->idx[i].key = _key;
+  _r->idx[i].dest = _dest;
+}
+
+/* backward-shift deletion, same as the key cache index */
+static void ridx_remove(L2D5RouteTable_t *_r, uint32_t _key, uint32_t _dest) {
+  L2D5RouteIndexEntry_t *idx = _r->idx;
+  uint32_t mask = _r->idx_mask;
+  uint32_t i = ridx_home(_r, _key);
+  while (idx[i].dest != _dest) {
+    if (idx[i].dest == L2D5ROUTE_NIL) {
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  uint32_t j = i;
+  for (;;) {
+    j = (j + 1) & mask;
+    if (idx[j].dest == L2D5ROUTE_NIL) {
+      break;
+    }
+    uint32_t k = ridx_home(_r, idx[j].key);
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      idx[i] = idx[j];
+      i = j;
+    }
+  }
+  idx[i].dest = L2D5ROUTE_NIL;
+}
+
+static inline uint32_t addr_key(const uint8_t *_addr) {
+  return (uint32_t)L2D5ADDR_hash(_addr);
+}
+
+
+/* --------------------- per-neighbor candidate lists -------------------- */
+
+static void cand_link(L2D5RouteTable_t *_r, uint32_t _id) {
+  L2D5RouteCand_t *c = &_r->cand[_id];
+  c->nb_prev = L2D5ROUTE_NIL;
+  c->nb_next = _r->nb_head[c->nb_slot];
+  if (c->nb_next != L2D5ROUTE_NIL) {
+    _r->cand[c->nb_next].nb_prev = _id;
+  }
+  _r->nb_head[c->nb_slot] = _id;
+}
+
+static void cand_clear(L2D5RouteTable_t *_r, uint32_t _id) {
+  L2D5RouteCand_t *c = &_r->cand[_id];
+  if (c->nb_slot == L2D5NB_NIL) {
+    return;
+  }
+  if (c->nb_prev != L2D5ROUTE_NIL) {
+    _r->cand[c->nb_prev].nb_next = c->nb_next;
+  } else {
+    _r->nb_head[c->nb_slot] = c->nb_next;
+  }
+  if (c->nb_next != L2D5ROUTE_NIL) {
+    _r->cand[c->nb_next].nb_prev = c->nb_prev;
+  }
+  c->nb_slot = L2D5NB_NIL;
+  c->nb_prev = c->nb_next = L2D5ROUTE_NIL;
+  c->restored = 0;
+}
+
+static inline bool cand_live(const L2D5RouteTable_t *_r, const L2D5RouteCand_t *_c) {
+  if (_c->nb_slot == L2D5NB_NIL) {
+    return false;
+  }
+  L2D5NeighborRef_t ref = { _c->nb_slot, _c->nb_gen };
+  return L2D5Neighbor_ref_valid(_r->nb, ref);
+}
+
+/* 16-bit SEQ serial arithmetic (RFC 1982 style) */
+static inline bool seq_newer(uint16_t _a, uint16_t _b) {
+  return (int16_t)(uint16_t)(_a - _b) > 0;
+}
+
+static inline bool cand_better(uint16_t _seq_a, uint16_t _hops_a, uint64_t _seen_a, uint8_t _restored_a,
+                               const L2D5RouteCand_t *_b) {
+  if (_restored_a != _b->restored) {
+    return _b->restored;
+  }
+  if (_seq_a != _b->seq) {
+    return seq_newer(_seq_a, _b->seq);
+  }
+  if (_hops_a != _b->hops) {
+    return _hops_a < _b->hops;
+  }
+  return _seen_a > _b->last_seen;
+}
+
+/* Drop dead candidates of _dest and recompute fwd. true when fwd changed. */
+static bool route_reevaluate(L2D5RouteTable_t *_r, uint32_t _dest) {
+  L2D5RouteCand_t *cand = &_r->cand[(size_t)_dest * L2D5ROUTE_CANDIDATES];
+  const L2D5RouteCand_t *best = NULL;
+
+  for (uint32_t k = 0; k < L2D5ROUTE_CANDIDATES; k++) {
+    if (!cand_live(_r, &cand[k])) {
+      cand_clear(_r, _dest * L2D5ROUTE_CANDIDATES + k);
+      continue;
+    }
+    if (best == NULL || cand_better(cand[k].seq, cand[k].hops, cand[k].last_seen, cand[k].restored, best)) {
+      best = &cand[k];
+    }
+  }
+
+  uint64_t fwd = best == NULL ? L2D5ROUTE_FWD_NONE : ((uint64_t)best->nb_slot << 32) | best->nb_gen;
+  if (fwd == _r->fwd[_dest]) {
+    return false;
+  }
+  _r->fwd[_dest] = fwd;
+  _r->changes++;
+  return true;
+}
+
+
+/* ------------------------------ lifecycle ------------------------------ */
+
+static void *route_alloc(size_t _n, size_t _size) {
+  size_t bytes = (_n * _size + 63) & ~(size_t)63;
+  void *p = aligned_alloc(64, bytes);
+  if (p != NULL) {
+    memset(p, 0, bytes);
+  }
+  return p;
+}
+
+int L2D5Route_init(L2D5RouteTable_t *_r, L2D5NeighborTable_t *_nb, uint32_t _capacity) {
+  uint32_t idx_size = 16;
+  while (idx_size < _capacity * 2) {
+    idx_size <<= 1;
+  }
+  size_t ncand = (size_t)_capacity * L2D5ROUTE_CANDIDATES;
+
+  memset(_r, 0, sizeof(*_r));
+  _r->nb        = _nb;
+  _r->addr      = route_alloc(_capacity, 16);
+  _r->fwd       = route_alloc(_capacity, sizeof(uint64_t));
+  _r->idx       = route_alloc(idx_size, sizeof(L2D5RouteIndexEntry_t));
+  _r->cand      = route_alloc(ncand, sizeof(L2D5RouteCand_t));
+  _r->nb_head   = route_alloc(_nb->capacity, sizeof(uint32_t));
+  _r->next_free = route_alloc(_capacity, sizeof(uint32_t));
+  _r->cold      = route_alloc(_capacity, sizeof(L2D5RouteCold_t));
+  if (_capacity == 0 || !_r->addr || !_r->fwd || !_r->idx || !_r->cand || !_r->nb_head ||
+      !_r->next_free || !_r->cold) {
+    L2D5Route_free(_r);
+    return -1;
+  }
+  for (uint32_t i = 0; i < idx_size; i++) {
+    _r->idx[i].dest = L2D5ROUTE_NIL;
+  }
+  for (size_t i = 0; i < ncand; i++) {
+    _r->cand[i].nb_slot = L2D5NB_NIL;
+    _r->cand[i].nb_prev = _r->cand[i].nb_next = L2D5ROUTE_NIL;
+  }
+  for (uint32_t i = 0; i < _nb->capacity; i++) {
+    _r->nb_head[i] = L2D5ROUTE_NIL;
+  }
+  for (uint32_t i = 0; i < _capacity; i++) {
+    _r->fwd[i] = L2D5ROUTE_FWD_NONE;
+    _r->next_free[i] = i + 1 < _capacity ? i + 1 : L2D5ROUTE_NIL;
+  }
+  _r->capacity = _capacity;
+  _r->nb_capacity = _nb->capacity;
+  _r->idx_mask = idx_size - 1;
+  _r->free_head = 0;
+  return 0;
+}
+
+void L2D5Route_free(L2D5RouteTable_t *_r) {
+  if (_r->cold != NULL) {
+    memset(_r->cold, 0, (size_t)_r->capacity * sizeof(L2D5RouteCold_t));
+  }
+  free(_r->addr);
+  free(_r->fwd);
+  free(_r->idx);
+  free(_r->cand);
+  free(_r->nb_head);
+  free(_r->next_free);
+  free(_r->cold);
+  memset(_r, 0, sizeof(*_r));
+}
+
+
+/* ------------------------------- lookup -------------------------------- */
+
+uint32_t L2D5Route_find(const L2D5RouteTable_t *_r, const uint8_t *_addr) {
+  uint32_t key = addr_key(_addr);
+  uint32_t i = ridx_home(_r, key);
+  while (_r->idx[i].dest != L2D5ROUTE_NIL) {
+    if (_r->idx[i].key == key && L2D5ADDR_equal(_r->addr[_r->idx[i].dest], _addr)) {
+      return _r->idx[i].dest;
+    }
+    i = (i + 1) & _r->idx_mask;
+  }
+  return L2D5ROUTE_NIL;
+}
+
+uint32_t L2D5Route_next(const L2D5RouteTable_t *_r, uint32_t _from) {
+  /* next_free[d] == d marks an in-use dest slot */
+  for (uint32_t d = _from; d < _r->capacity; d++) {
+    if (_r->next_free[d] == d) {
+      return d;
+    }
+  }
+  return L2D5ROUTE_NIL;
+}
+
+
+/* ------------------------------- update -------------------------------- */
+
+static uint32_t route_create(L2D5RouteTable_t *_r, const uint8_t *_addr) {
+  uint32_t dest = _r->free_head;
+  if (dest == L2D5ROUTE_NIL) {
+    return L2D5ROUTE_NIL;
+  }
+  _r->free_head = _r->next_free[dest];
+  _r->next_free[dest] = dest;             // in use marker, see L2D5Route_next()
+  memcpy(_r->addr[dest], _addr, 16);
+  _r->fwd[dest] = L2D5ROUTE_FWD_NONE;
+  memset(&_r->cold[dest], 0, sizeof(L2D5RouteCold_t));
+  ridx_insert(_r, addr_key(_addr), dest);
+  _r->count++;
+  return dest;
+}
+
+void L2D5Route_remove(L2D5RouteTable_t *_r, uint32_t _dest) {
+  if (_dest >= _r->capacity || _r->next_free[_dest] != _dest) {
+    return;
+  }
+  for (uint32_t k = 0; k < L2D5ROUTE_CANDIDATES; k++) {
+    cand_clear(_r, _dest * L2D5ROUTE_CANDIDATES + k);
+  }
+  ridx_remove(_r, addr_key(_r->addr[_dest]), _dest);
+  memset(&_r->cold[_dest], 0, sizeof(L2D5RouteCold_t));
+  _r->fwd[_dest] = L2D5ROUTE_FWD_NONE;
+  _r->next_free[_dest] = _r->free_head;
+  _r->free_head = _dest;
+  _r->count--;
+}
+
+uint32_t L2D5Route_hello(L2D5RouteTable_t *_r, const L2D5Routing_HelloPkt_t *_hello,
+                         uint32_t _via, uint16_t _hops, uint64_t _now, bool *_changed) {
+  const uint8_t *origin = _hello->NodeSrcAddr;
+  uint16_t seq = L2D5HelloPkt_get_SEQ(_hello);
+  uint16_t limit = L2D5HelloPkt_get_NodesLimit(_hello);
+  bool changed = false;
+  uint32_t dest = L2D5ROUTE_NIL;
+
+  if (_changed != NULL) {
+    *_changed = false;
+  }
+  if (_via >= _r->nb_capacity || !L2D5Neighbor_occupied(_r->nb, _via) || _hops == 0 ||
+      (limit != 0 && _hops > limit) || L2D5ADDR_is_broadcast(origin)) {
+    return L2D5ROUTE_NIL;
+  }
+
+  dest = L2D5Route_find(_r, origin);
+  if (dest == L2D5ROUTE_NIL && (dest = route_create(_r, origin)) == L2D5ROUTE_NIL) {
+    return L2D5ROUTE_NIL;
+  }
+  _r->updates++;
+
+  L2D5RouteCold_t *cold = &_r->cold[dest];
+  if (memcmp(cold->PublicKey, _hello->PublicKey, 32) != 0) {
+    memcpy(cold->PublicKey, _hello->PublicKey, 32);
+    memset(cold->SharedKey, 0, 32);
+  }
+  cold->nodes_limit = limit;
+  cold->last_seen = _now;
+
+  L2D5RouteCand_t *cand = &_r->cand[(size_t)dest * L2D5ROUTE_CANDIDATES];
+  uint32_t via_gen = _r->nb->gen[_via];
+  uint32_t hit = L2D5ROUTE_NIL, free_k = L2D5ROUTE_NIL, worst = L2D5ROUTE_NIL;
+
+  for (uint32_t k = 0; k < L2D5ROUTE_CANDIDATES; k++) {
+    if (!cand_live(_r, &cand[k])) {
+      cand_clear(_r, dest * L2D5ROUTE_CANDIDATES + k);
+      free_k = free_k == L2D5ROUTE_NIL ? k : free_k;
+    } else if (cand[k].nb_slot == _via && cand[k].nb_gen == via_gen) {
+      hit = k;
+    } else if (worst == L2D5ROUTE_NIL ||
+               cand_better(cand[worst].seq, cand[worst].hops, cand[worst].last_seen, cand[worst].restored, &cand[k])) {
+      worst = k;
+    }
+  }
+
+  if (hit != L2D5ROUTE_NIL) {
+    /* late copy of an older flood through the same neighbor */
+    if (!cand[hit].restored && seq_newer(cand[hit].seq, seq)) {
+      return dest;
+    }
+  } else {
+    if (free_k != L2D5ROUTE_NIL) {
+      hit = free_k;
+    } else if (cand_better(seq, _hops, _now, 0, &cand[worst])) {
+      hit = worst;
+      cand_clear(_r, dest * L2D5ROUTE_CANDIDATES + worst);
+    } else {
+      return dest;
+    }
+    cand[hit].nb_slot = _via;
+    cand[hit].nb_gen = via_gen;
+    cand_link(_r, dest * L2D5ROUTE_CANDIDATES + hit);
+  }
+  cand[hit].hops = _hops;
+  cand[hit].seq = seq;
+  cand[hit].restored = 0;
+  cand[hit].last_seen = _now;
+
+  changed = route_reevaluate(_r, dest);
+  if (_changed != NULL) {
+    *_changed = changed;
+  }
+  return dest;
+}
+
+uint32_t L2D5Route_neighbor_lost(L2D5RouteTable_t *_r, uint32_t _nb_slot, L2D5RouteOrphanFn_t _orphan,
+                                 void *_ctx) {
+  uint32_t n = 0;
+  if (_nb_slot >= _r->nb_capacity) {
+    return 0;
+  }
+  uint32_t id = _r->nb_head[_nb_slot];
+  while (id != L2D5ROUTE_NIL) {
+    uint32_t next = _r->cand[id].nb_next;
+    uint32_t dest = id / L2D5ROUTE_CANDIDATES;
+    cand_clear(_r, id);
+    route_reevaluate(_r, dest);
+    if (_orphan != NULL && _r->fwd[dest] == L2D5ROUTE_FWD_NONE) {
+      _orphan(_ctx, dest);
+    }
+    n++;
+    id = next;
+  }
+  return n;
+}
+
+uint32_t L2D5Route_neighbor_down(L2D5RouteTable_t *_r, uint32_t _nb_slot) {
+  return L2D5Route_neighbor_lost(_r, _nb_slot, NULL, NULL);
+}
+
+
+/* ------------------------------- export -------------------------------- */
+
+void L2D5Route_export(const L2D5RouteTable_t *_r, uint32_t _dest, L2D5Routing_RemoteTable_t *_out) {
+  const L2D5RouteCold_t *cold = &_r->cold[_dest];
+  const L2D5RouteCand_t *cand = &_r->cand[(size_t)_dest * L2D5ROUTE_CANDIDATES];
+  uint64_t fwd = _r->fwd[_dest];
+  uint16_t hops = UINT16_MAX;
+
+  memset(_out, 0, sizeof(*_out));
+  memcpy(_out->NodeAddr, _r->addr[_dest], 16);
+  memcpy(_out->PublicKey, cold->PublicKey, 32);
+  memcpy(_out->SharedKey, cold->SharedKey, 32);
+  if (fwd != L2D5ROUTE_FWD_NONE) {
+    uint32_t slot = (uint32_t)(fwd >> 32);
+    memcpy(_out->NextHopAddr, _r->nb->addr[slot], 16);
+    for (uint32_t k = 0; k < L2D5ROUTE_CANDIDATES; k++) {
+      if (cand[k].nb_slot == slot && cand[k].nb_gen == (uint32_t)fwd) {
+        hops = cand[k].hops;
+      }
+    }
+  }
+  L2D5RmRecord_set_last_seen_time(_out, cold->last_seen);
+  L2D5RmRecord_set_NodesLimit(_out, cold->nodes_limit);
+  L2D5RmRecord_set_hops(_out, hops);
+}
+
+uint32_t L2D5Route_import(L2D5RouteTable_t *_r, const L2D5Routing_RemoteTable_t *_in) {
+  uint32_t via = L2D5Neighbor_find(_r->nb, _in->NextHopAddr);
+  uint16_t hops = L2D5RmRecord_get_hops(_in);
+  if (via == L2D5NB_NIL || hops == 0 || hops == UINT16_MAX || L2D5ADDR_is_broadcast(_in->NodeAddr)) {
+    return L2D5ROUTE_NIL;
+  }
+  uint32_t dest = L2D5Route_find(_r, _in->NodeAddr);
+  if (dest == L2D5ROUTE_NIL && (dest = route_create(_r, _in->NodeAddr)) == L2D5ROUTE_NIL) {
+    return L2D5ROUTE_NIL;
+  }
+
+  /* one restored candidate per dest, merged in place; HELLO-learned data
+   * is fresher than any snapshot, so a live one via `via` wins outright */
+  L2D5RouteCand_t *cand = &_r->cand[(size_t)dest * L2D5ROUTE_CANDIDATES];
+  uint32_t old = L2D5ROUTE_NIL, free_k = L2D5ROUTE_NIL;
+  bool heard = false;
+  for (uint32_t k = 0; k < L2D5ROUTE_CANDIDATES; k++) {
+    if (!cand_live(_r, &cand[k])) {
+      free_k = free_k == L2D5ROUTE_NIL ? k : free_k;
+    } else if (cand[k].restored) {
+      old = old == L2D5ROUTE_NIL ? k : old;
+    } else if (cand[k].nb_slot == via) {
+      return dest;                        // already heard through that neighbor
+    } else {
+      heard = true;
+    }
+  }
+
+  L2D5RouteCold_t *cold = &_r->cold[dest];
+  if (!heard) {
+    memcpy(cold->PublicKey, _in->PublicKey, 32);
+    memcpy(cold->SharedKey, _in->SharedKey, 32);
+    cold->nodes_limit = L2D5RmRecord_get_NodesLimit(_in);
+    cold->last_seen = L2D5RmRecord_get_last_seen_time(_in);
+  }
+  uint32_t hit = old != L2D5ROUTE_NIL ? old : free_k;
+  if (hit == L2D5ROUTE_NIL) {
+    return dest;                          // full of HELLO-learned candidates already
+  }
+  cand_clear(_r, dest * L2D5ROUTE_CANDIDATES + hit);
+  cand[hit].nb_slot = via;
+  cand[hit].nb_gen = _r->nb->gen[via];
+  cand[hit].hops = hops;
+  cand[hit].seq = 0;
+  cand[hit].restored = 1;
+  cand[hit].last_seen = L2D5RmRecord_get_last_seen_time(_in);
+  cand_link(_r, dest * L2D5ROUTE_CANDIDATES + hit);
+  route_reevaluate(_r, dest);
+  return dest;
+}
@@ -0,0 +1,174 @@
+/*
+ * File:        src/L2D5_route.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 OEMR remote route engine for Radio_ORBIT.
+ *    Keeps L2D5Routing_RemoteTable_t state for multi-hop destinations,
+ *    updated incrementally by HELLO_PKT_RM, and resolves
+ *    destination -> next hop for TCP_DATA_RM forwarding in O(1).
+ *
+ *
+ *  Per destination (dest slot, stable while the route exists):
+ *
+ *  | Array  | Contents                                                  |
+ *  ---------------------------------------------------------------------
+ *  | addr   | NodeAddr                                                  |
+ *  | fwd    | best next hop: neighbor-table slot << 32 | neighbor gen    |
+ *  | cand   | L2D5ROUTE_CANDIDATES next-hop candidates (via, hops, SEQ) |
+ *  | cold   | PublicKey, SharedKey, NodesLimit, last_seen_time          |
+ *
+ *  Forwarding: hash index (addr -> dest) then fwd gives the neighbor slot
+ *  directly; no second address lookup in the neighbor table.
+ *
+ *  Best candidate: newest SEQ (16-bit serial arithmetic), then fewest hops,
+ *  then most recently seen. Candidates restored from a snapshot carry no
+ *  SEQ and lose to any candidate learned from a HELLO.
+ *
+ *  Incremental updates:
+ *    - HELLO_PKT_RM from origin O via neighbor N: only O is re-evaluated.
+ *    - neighbor N down: every candidate via N sits on a per-neighbor list,
+ *      so only destinations that used N are re-evaluated.
+ *
+ * NOTE:
+ *   - Fixed capacity, not thread safe.
+ *
+ */
+
+#ifndef L2D5_ROUTE_H
+#define L2D5_ROUTE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_struct.h"
+#include "L2D5_addr.h"
+#include "L2D5_neighbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5ROUTE_CANDIDATES 4
+#define L2D5ROUTE_NIL        UINT32_MAX
+#define L2D5ROUTE_FWD_NONE   UINT64_MAX
+
+
+typedef struct {
+  uint32_t nb_slot;                       // L2D5NB_NIL when unused
+  uint32_t nb_gen;
+  uint16_t hops;
+  uint16_t seq;
+  uint32_t nb_prev;                       // per-neighbor candidate list
+  uint32_t nb_next;
+  uint8_t  restored;                      // from L2D5Route_import(): SEQ unknown, any HELLO beats it
+  uint64_t last_seen;
+} L2D5RouteCand_t;
+
+
+typedef struct {
+  uint8_t  PublicKey[32];
+  uint8_t  SharedKey[32];
+  uint16_t nodes_limit;
+  uint64_t last_seen;
+} L2D5RouteCold_t;
+
+
+typedef struct {
+  uint32_t key;                           // address hash
+  uint32_t dest;                          // L2D5ROUTE_NIL when empty
+} L2D5RouteIndexEntry_t;
+
+
+typedef struct {
+  L2D5NeighborTable_t   *nb;
+  uint32_t               capacity;
+  uint32_t               count;
+  uint32_t               free_head;
+  /* hot */
+  uint8_t              (*addr)[16];
+  uint64_t              *fwd;
+  L2D5RouteIndexEntry_t *idx;
+  uint32_t               idx_mask;
+  /* warm */
+  L2D5RouteCand_t       *cand;            // capacity * L2D5ROUTE_CANDIDATES
+  uint32_t              *nb_head;         // per neighbor slot: first candidate id
+  uint32_t               nb_capacity;
+  uint32_t              *next_free;       // free list; next_free[d] == d when in use
+  /* cold */
+  L2D5RouteCold_t       *cold;
+
+  uint64_t               updates;
+  uint64_t               changes;         // best next hop changed
+} L2D5RouteTable_t;
+
+
+/* _nb must outlive the route table and keep its capacity */
+int  L2D5Route_init(L2D5RouteTable_t *_r, L2D5NeighborTable_t *_nb, uint32_t _capacity);
+void L2D5Route_free(L2D5RouteTable_t *_r);
+
+/*
+ * HELLO_PKT_RM carrying _hello, received from neighbor slot _via after _hops
+ * hops. Re-evaluates only _hello->NodeSrcAddr. Returns the dest slot
+ * (L2D5ROUTE_NIL when full / rejected); *_changed (optional) is set when
+ * the best next hop changed.
+ */
+uint32_t L2D5Route_hello(L2D5RouteTable_t *_r, const L2D5Routing_HelloPkt_t *_hello,
+                         uint32_t _via, uint16_t _hops, uint64_t _now, bool *_changed);
+
+/* Neighbor slot _nb_slot is gone: drop its candidates. Returns destinations re-evaluated. */
+uint32_t L2D5Route_neighbor_down(L2D5RouteTable_t *_r, uint32_t _nb_slot);
+
+/*
+ * Same, and _orphan(_ctx, dest) for every destination left without a live
+ * next hop. The callback may L2D5Route_remove() that dest.
+ */
+typedef void (*L2D5RouteOrphanFn_t)(void *_ctx, uint32_t _dest);
+uint32_t L2D5Route_neighbor_lost(L2D5RouteTable_t *_r, uint32_t _nb_slot, L2D5RouteOrphanFn_t _orphan,
+                                 void *_ctx);
+
+uint32_t L2D5Route_find(const L2D5RouteTable_t *_r, const uint8_t *_addr);
+void     L2D5Route_remove(L2D5RouteTable_t *_r, uint32_t _dest);
+
+/*
+ * Forwarding: next-hop neighbor slot for _dst, or L2D5NB_NIL.
+ * Direct neighbors resolve through the neighbor table.
+ */
+static inline uint32_t L2D5Route_next_hop(const L2D5RouteTable_t *_r, const uint8_t *_dst) {
+  uint32_t dest = L2D5Route_find(_r, _dst);
+  if (dest == L2D5ROUTE_NIL) {
+    return L2D5Neighbor_find(_r->nb, _dst);
+  }
+  uint64_t fwd = _r->fwd[dest];
+  uint32_t slot = (uint32_t)(fwd >> 32);
+  if (fwd == L2D5ROUTE_FWD_NONE || _r->nb->gen[slot] != (uint32_t)fwd) {
+    return L2D5NB_NIL;
+  }
+  return slot;
+}
+
+/* Packed 108-byte record of the best route (multi-byte fields big-endian) */
+void L2D5Route_export(const L2D5RouteTable_t *_r, uint32_t _dest, L2D5Routing_RemoteTable_t *_out);
+
+/*
+ * Record back into the table: one restored candidate via NextHopAddr (must
+ * already be in the neighbor table), merged into an earlier restored one.
+ * Skipped when a live HELLO candidate via that neighbor exists; PublicKey /
+ * last_seen are only taken while no HELLO candidate is live. The next HELLO
+ * for the destination replaces it whatever its SEQ. Returns the dest slot, or L2D5ROUTE_NIL
+ * when full / next hop unknown.
+ */
+uint32_t L2D5Route_import(L2D5RouteTable_t *_r, const L2D5Routing_RemoteTable_t *_in);
+
+/* Next used dest slot >= _from, or L2D5ROUTE_NIL */
+uint32_t L2D5Route_next(const L2D5RouteTable_t *_r, uint32_t _from);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_ROUTE_H
@@ -0,0 +1,464 @@
+/*
+ * File:        src/L2D5_snapshot.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Memory-mapped snapshot of the L2.5 neighbor / remote tables for
+ *    Radio_ORBIT.
+ *    See L2D5_snapshot.h
+ *
+ */
+
+#define _GNU_SOURCE
+#include "L2D5_snapshot.h"
+#include "L2_crc32.h"
+#include "ORBIT_schema.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#define SNAP_PAGE      4096
+#define SNAP_KEY_OFF   offsetof(L2D5Routing_NeighborTable_t, SharedKey)
+
+/* counter block kinds */
+#define SNAP_CTR_IMAGE 'I'
+#define SNAP_CTR_LOG   'L'
+#define SNAP_CTR_CHECK 'K'
+
+STATIC_ASSERT(offsetof(L2D5Routing_NeighborTable_t, SharedKey) == offsetof(L2D5Routing_RemoteTable_t, SharedKey),
+              L2D5SNAP_SharedKey_same_offset);
+STATIC_ASSERT(sizeof(L2D5Routing_RemoteTable_t) <= sizeof(((L2D5SnapEntry_t *)0)->rec), L2D5SNAP_record_fits);
+
+static const uint8_t snap_magic[8] = { 'O', 'R', 'B', 'I', 'T', 'S', 'N', 'P' };
+
+
+/* ------------------------------- layout -------------------------------- */
+
+static inline L2D5SnapHeader_t *snap_header(const L2D5Snap_t *_s, uint32_t _slot) {
+  return (L2D5SnapHeader_t *)(_s->map + (size_t)_slot * L2D5SNAP_HEADER_BYTES);
+}
+
+static inline L2D5SnapEntry_t *snap_image(const L2D5Snap_t *_s, uint32_t _slot) {
+  return (L2D5SnapEntry_t *)(_s->map + L2D5SNAP_DATA_OFFSET + (size_t)_slot * _s->image_bytes);
+}
+
+static inline L2D5SnapEntry_t *snap_log(const L2D5Snap_t *_s) {
+  return (L2D5SnapEntry_t *)(_s->map + L2D5SNAP_DATA_OFFSET + 2 * _s->image_bytes);
+}
+
+static inline uint32_t snap_entry_crc(const L2D5SnapEntry_t *_e) {
+  return L2CRC32_update(0, (const uint8_t *)_e + 4, L2D5SNAP_ENTRY_BYTES - 4);
+}
+
+static inline uint32_t snap_header_crc(const L2D5SnapHeader_t *_h) {
+  L2D5SnapHeader_t h = *_h;
+  h.crc = 0;
+  return L2CRC32_update(0, (const uint8_t *)&h, sizeof(h));
+}
+
+static int snap_msync(const L2D5Snap_t *_s, const void *_p, size_t _len, bool _wait) {
+  uintptr_t a = (uintptr_t)_p & ~(uintptr_t)(SNAP_PAGE - 1);
+  uintptr_t b = (uintptr_t)_p + _len;
+  (void)_s;
+  return msync((void *)a, b - a, _wait ? MS_SYNC : MS_ASYNC);
+}
+
+
+/* ---------------------- SharedKey at rest (AES-CTR) --------------------- */
+
+static int snap_ctr(L2D5Snap_t *_s, const uint8_t *_nonce, uint8_t _kind, uint32_t _index, uint8_t *_buf,
+                    size_t _len) {
+  uint8_t iv[16] = {0};
+  int out = 0;
+  memcpy(iv, _nonce, 8);
+  iv[8] = _kind;
+  iv[9] = (uint8_t)(_index >> 24);
+  iv[10] = (uint8_t)(_index >> 16);
+  iv[11] = (uint8_t)(_index >> 8);
+  iv[12] = (uint8_t)_index;
+  if (EVP_EncryptInit_ex((EVP_CIPHER_CTX *)_s->cipher, NULL, NULL, NULL, iv) != 1 ||
+      EVP_EncryptUpdate((EVP_CIPHER_CTX *)_s->cipher, _buf, &out, _buf, (int)_len) != 1 || out != (int)_len) {
+    return -1;
+  }
+  return 0;
+}
+
+static int snap_key_check(L2D5Snap_t *_s, const uint8_t *_nonce, uint8_t *_out) {
+  uint8_t zero[16] = {0};
+  if (snap_ctr(_s, _nonce, SNAP_CTR_CHECK, 0, zero, sizeof(zero)) != 0) {
+    return -1;
+  }
+  memcpy(_out, zero, 8);
+  return 0;
+}
+
+
+/* -------------------------------- entries ------------------------------- */
+
+/* Seal _rec (plain SharedKey) into _dst under the active gen */
+static int snap_write(L2D5Snap_t *_s, L2D5SnapEntry_t *_dst, uint8_t _kind, uint32_t _index, uint8_t _op,
+                      const void *_rec, size_t _len) {
+  L2D5SnapEntry_t e;
+  memset(&e, 0, sizeof(e));
+  e.op = _op;
+  e.gen = _s->hdr.gen;
+  e.index = _index;
+  memcpy(e.rec, _rec, _len);
+  int rc = 0;
+  if (_op == L2D5SNAP_NB_PUT || _op == L2D5SNAP_RM_PUT) {
+    rc = snap_ctr(_s, _s->hdr.nonce, _kind, _index, e.rec + SNAP_KEY_OFF, 32);
+  }
+  e.crc = snap_entry_crc(&e);
+  memcpy(_dst, &e, sizeof(e));
+  OPENSSL_cleanse(&e, sizeof(e));
+  return rc;
+}
+
+static inline bool snap_entry_valid(const L2D5SnapEntry_t *_e, uint64_t _gen, uint32_t _index) {
+  return _e->gen == _gen && _e->index == _index && _e->op >= L2D5SNAP_NB_PUT && _e->op <= L2D5SNAP_RM_DEL &&
+         _e->crc == snap_entry_crc(_e);
+}
+
+
+/* ------------------------------ lifecycle ------------------------------- */
+
+static bool snap_header_valid(const L2D5Snap_t *_s, const L2D5SnapHeader_t *_h) {
+  return memcmp(_h->magic, snap_magic, 8) == 0 && _h->version == L2D5SNAP_VERSION && _h->gen != 0 &&
+         _h->crc == snap_header_crc(_h) && _h->nb_capacity == _s->hdr.nb_capacity &&
+         _h->rm_capacity == _s->hdr.rm_capacity && _h->log_capacity == _s->hdr.log_capacity &&
+         (uint64_t)_h->nb_count + _h->rm_count <= (uint64_t)_h->nb_capacity + _h->rm_capacity;
+}
+
+int L2D5Snap_open(L2D5Snap_t *_s, const char *_path, const uint8_t *_key, L2D5NeighborTable_t *_nb,
+                  L2D5RouteTable_t *_route, uint32_t _log_entries) {
+  memset(_s, 0, sizeof(*_s));
+  _s->fd = -1;
+  _s->nb = _nb;
+  _s->route = _route;
+  memcpy(_s->key, _key, L2D5SNAP_KEY_BYTES);
+  _s->hdr.nb_capacity = _nb->capacity;
+  _s->hdr.rm_capacity = _route != NULL ? _route->capacity : 0;
+  _s->hdr.log_capacity = _log_entries != 0 ? _log_entries : L2D5SNAP_LOG_DEFAULT;
+
+  size_t image = ((size_t)_s->hdr.nb_capacity + _s->hdr.rm_capacity) * L2D5SNAP_ENTRY_BYTES;
+  size_t log = (size_t)_s->hdr.log_capacity * L2D5SNAP_ENTRY_BYTES;
+  _s->image_bytes = (image + SNAP_PAGE - 1) & ~(size_t)(SNAP_PAGE - 1);
+  _s->map_bytes = L2D5SNAP_DATA_OFFSET + 2 * _s->image_bytes + log;
+
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  _s->cipher = ctx;
+  if (ctx == NULL || EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, _s->key, NULL) != 1) {
+    L2D5Snap_close(_s);
+    return -1;
+  }
+
+  struct stat st;
+  _s->fd = open(_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (_s->fd < 0 || fstat(_s->fd, &st) != 0 ||
+      ((size_t)st.st_size != _s->map_bytes && ftruncate(_s->fd, (off_t)_s->map_bytes) != 0)) {
+    L2D5Snap_close(_s);
+    return -1;
+  }
+  _s->map = mmap(NULL, _s->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _s->fd, 0);
+  if (_s->map == MAP_FAILED) {
+    _s->map = NULL;
+    L2D5Snap_close(_s);
+    return -1;
+  }
+
+  /* newest valid generation, then the valid prefix of its log */
+  for (uint32_t k = 0; k < 2; k++) {
+    const L2D5SnapHeader_t *h = snap_header(_s, k);
+    if (snap_header_valid(_s, h) && h->gen > _s->hdr.gen) {
+      memcpy(&_s->hdr, h, sizeof(_s->hdr));
+      _s->active = k;
+    }
+  }
+  if (_s->hdr.gen != 0) {
+    const L2D5SnapEntry_t *log_e = snap_log(_s);
+    while (_s->log_count < _s->hdr.log_capacity && snap_entry_valid(&log_e[_s->log_count], _s->hdr.gen,
+                                                                    _s->log_count)) {
+      _s->log_count++;
+    }
+  }
+  return 0;
+}
+
+void L2D5Snap_close(L2D5Snap_t *_s) {
+  if (_s->map != NULL) {
+    munmap(_s->map, _s->map_bytes);
+  }
+  if (_s->fd >= 0) {
+    close(_s->fd);
+  }
+  EVP_CIPHER_CTX_free((EVP_CIPHER_CTX *)_s->cipher);
+  OPENSSL_cleanse(_s->key, sizeof(_s->key));
+  memset(_s, 0, sizeof(*_s));
+  _s->fd = -1;
+}
+
+
+/* ------------------------------- restore -------------------------------- */
+
+typedef struct {
+  L2D5KeyCache_t *keys;
+  L2D5Aging_t    *aging;
+  uint64_t        ref;                    // clock of the newest record
+  uint64_t        now;
+  uint64_t        offline;
+  uint64_t        max_age;
+} snap_restore_t;
+
+static inline uint64_t snap_entry_seen(const L2D5SnapEntry_t *_e) {
+  return _e->op == L2D5SNAP_NB_PUT ? L2D5NbRecord_get_last_seen_time((const L2D5Routing_NeighborTable_t *)_e->rec)
+                                   : L2D5RmRecord_get_last_seen_time((const L2D5Routing_RemoteTable_t *)_e->rec);
+}
+
+/* last_seen on the current clock; false when older than max_age */
+static bool snap_rebase(const snap_restore_t *_r, uint64_t _seen, uint64_t *_out) {
+  uint64_t age = (_r->ref > _seen ? _r->ref - _seen : 0) + _r->offline;
+  if (_r->max_age != 0 && age > _r->max_age) {
+    return false;
+  }
+  *_out = _r->now > age ? _r->now - age : 0;
+  return true;
+}
+
+static void snap_apply(L2D5Snap_t *_s, const snap_restore_t *_r, const L2D5SnapEntry_t *_e, uint8_t _kind) {
+  static const uint8_t zero[32] = {0};
+  union {
+    L2D5Routing_NeighborTable_t nb;
+    L2D5Routing_RemoteTable_t rm;
+    uint8_t raw[sizeof(_e->rec)];
+  } rec;
+  uint64_t seen;
+  uint32_t slot;
+
+  switch (_e->op) {
+    case L2D5SNAP_NB_PUT:
+      memcpy(rec.raw, _e->rec, sizeof(rec.raw));
+      if (!snap_rebase(_r, snap_entry_seen(_e), &seen) ||
+          snap_ctr(_s, _s->hdr.nonce, _kind, _e->index, rec.raw + SNAP_KEY_OFF, 32) != 0) {
+        _s->skipped++;
+        break;
+      }
+      L2D5NbRecord_set_last_seen_time(&rec.nb, seen);
+      slot = L2D5Neighbor_import(_s->nb, &rec.nb);
+      if (slot == L2D5NB_NIL) {
+        _s->skipped++;
+        break;
+      }
+      _s->restored_nb++;
+      if (_r->keys != NULL && memcmp(rec.nb.SharedKey, zero, 32) != 0) {
+        L2D5KeyCache_install(_r->keys, rec.nb.NodeAddr, rec.nb.PublicKey, rec.nb.SharedKey);
+      }
+      if (_r->aging != NULL) {
+        L2D5Aging_neighbor_seen(_r->aging, slot, seen);
+      }
+      break;
+
+    case L2D5SNAP_NB_DEL:
+      slot = L2D5Neighbor_find(_s->nb, _e->rec);
+      if (slot != L2D5NB_NIL) {
+        if (_s->route != NULL) {
+          L2D5Route_neighbor_down(_s->route, slot);
+        }
+        L2D5Neighbor_remove(_s->nb, slot);
+        if (_r->keys != NULL) {
+          L2D5KeyCache_invalidate(_r->keys, _e->rec);
+        }
+      }
+      break;
+
+    case L2D5SNAP_RM_PUT:
+      if (_s->route == NULL) {
+        break;
+      }
+      memcpy(rec.raw, _e->rec, sizeof(rec.raw));
+      if (!snap_rebase(_r, snap_entry_seen(_e), &seen) ||
+          snap_ctr(_s, _s->hdr.nonce, _kind, _e->index, rec.raw + SNAP_KEY_OFF, 32) != 0) {
+        _s->skipped++;
+        break;
+      }
+      L2D5RmRecord_set_last_seen_time(&rec.rm, seen);
+      slot = L2D5Route_import(_s->route, &rec.rm);
+      if (slot == L2D5ROUTE_NIL) {
+        _s->skipped++;
+        break;
+      }
+      _s->restored_rm++;
+      if (_r->aging != NULL) {
+        L2D5Aging_route_seen(_r->aging, slot, seen);
+      }
+      break;
+
+    case L2D5SNAP_RM_DEL:
+      if (_s->route != NULL && (slot = L2D5Route_find(_s->route, _e->rec)) != L2D5ROUTE_NIL) {
+        L2D5Route_remove(_s->route, slot);
+      }
+      break;
+  }
+  OPENSSL_cleanse(&rec, sizeof(rec));
+}
+
+int L2D5Snap_restore(L2D5Snap_t *_s, L2D5KeyCache_t *_keys, L2D5Aging_t *_aging, uint64_t _now,
+                     uint64_t _offline, uint64_t _max_age) {
+  _s->restored_nb = _s->restored_rm = _s->skipped = 0;
+  if (_s->hdr.gen == 0) {
+    return 0;
+  }
+  uint8_t check[8];
+  if (snap_key_check(_s, _s->hdr.nonce, check) != 0 || CRYPTO_memcmp(check, _s->hdr.key_check, 8) != 0) {
+    return -1;
+  }
+
+  const L2D5SnapEntry_t *img = snap_image(_s, _s->active);
+  const L2D5SnapEntry_t *log = snap_log(_s);
+  uint32_t nimg = _s->hdr.nb_count + _s->hdr.rm_count;
+  snap_restore_t r = { _keys, _aging, _s->hdr.saved_at, _now, _offline, _max_age };
+
+  /* ages are relative to the newest record written */
+  for (uint32_t i = 0; i < nimg + _s->log_count; i++) {
+    const L2D5SnapEntry_t *e = i < nimg ? &img[i] : &log[i - nimg];
+    if ((e->op == L2D5SNAP_NB_PUT || e->op == L2D5SNAP_RM_PUT) && snap_entry_seen(e) > r.ref) {
+      r.ref = snap_entry_seen(e);
+    }
+  }
+
+  /* image: neighbors first, their routes refer to them */
+  for (uint32_t i = 0; i < nimg; i++) {
+    if (snap_entry_valid(&img[i], _s->hdr.gen, i)) {
+      snap_apply(_s, &r, &img[i], SNAP_CTR_IMAGE);
+    } else {
+      _s->skipped++;
+    }
+  }
+  for (uint32_t i = 0; i < _s->log_count; i++) {
+    snap_apply(_s, &r, &log[i], SNAP_CTR_LOG);
+  }
+  return (int)(_s->restored_nb + _s->restored_rm);
+}
+
+
+/* -------------------------------- writes -------------------------------- */
+
+int L2D5Snap_compact(L2D5Snap_t *_s, uint64_t _now) {
+  uint32_t next = _s->hdr.gen != 0 ? _s->active ^ 1 : 0;
+  L2D5SnapEntry_t *img = snap_image(_s, next);
+  L2D5SnapHeader_t h = _s->hdr;
+
+  h.gen = _s->hdr.gen + 1;
+  h.saved_at = _now;
+  h.nb_count = h.rm_count = 0;
+  if (RAND_bytes(h.nonce, sizeof(h.nonce)) != 1 || snap_key_check(_s, h.nonce, h.key_check) != 0) {
+    return -1;
+  }
+
+  /* entries are sealed under the new gen / nonce */
+  L2D5SnapHeader_t cur = _s->hdr;
+  _s->hdr = h;
+  int rc = 0;
+  uint32_t n = 0;
+  L2D5Routing_NeighborTable_t nb;
+  L2D5Routing_RemoteTable_t rm;
+  for (uint32_t slot = L2D5Neighbor_next(_s->nb, 0); slot != L2D5NB_NIL && rc == 0;
+       slot = L2D5Neighbor_next(_s->nb, slot + 1)) {
+    L2D5Neighbor_export(_s->nb, slot, &nb);
+    rc = snap_write(_s, &img[n], SNAP_CTR_IMAGE, n, L2D5SNAP_NB_PUT, &nb, sizeof(nb));
+    n++;
+  }
+  h.nb_count = n;
+  if (_s->route != NULL) {
+    for (uint32_t d = L2D5Route_next(_s->route, 0); d != L2D5ROUTE_NIL && rc == 0;
+         d = L2D5Route_next(_s->route, d + 1)) {
+      if (_s->route->fwd[d] == L2D5ROUTE_FWD_NONE) {
+        continue;                         // no next hop to restore through
+      }
+      L2D5Route_export(_s->route, d, &rm);
+      rc = snap_write(_s, &img[n], SNAP_CTR_IMAGE, n, L2D5SNAP_RM_PUT, &rm, sizeof(rm));
+      n++;
+    }
+  }
+  h.rm_count = n - h.nb_count;
+  OPENSSL_cleanse(&nb, sizeof(nb));
+  OPENSSL_cleanse(&rm, sizeof(rm));
+
+  /* image durable before the header that points at it */
+  if (rc != 0 || (n != 0 && snap_msync(_s, img, (size_t)n * L2D5SNAP_ENTRY_BYTES, true) != 0)) {
+    _s->hdr = cur;
+    return -1;
+  }
+  memcpy(h.magic, snap_magic, 8);
+  h.version = L2D5SNAP_VERSION;
+  h.crc = 0;
+  h.crc = snap_header_crc(&h);
+  L2D5SnapHeader_t *dst = snap_header(_s, next);
+  memcpy(dst, &h, sizeof(h));
+  if (snap_msync(_s, dst, sizeof(h), true) != 0) {
+    _s->hdr = cur;
+    return -1;
+  }
+  _s->hdr = h;
+  _s->active = next;
+  _s->log_count = 0;
+  _s->fresh = true;
+  _s->compactions++;
+  return 0;
+}
+
+/* One log entry; compacts first when the log is full or belongs to the previous run */
+static int snap_append(L2D5Snap_t *_s, uint8_t _op, const void *_rec, size_t _len, uint64_t _now) {
+  if (!_s->fresh || _s->log_count == _s->hdr.log_capacity) {
+    /* the compaction already holds this change */
+    return L2D5Snap_compact(_s, _now);
+  }
+  uint32_t i = _s->log_count;
+  if (snap_write(_s, &snap_log(_s)[i], SNAP_CTR_LOG, i, _op, _rec, _len) != 0) {
+    return -1;
+  }
+  _s->log_count++;
+  _s->appended++;
+  return 0;
+}
+
+int L2D5Snap_neighbor_put(L2D5Snap_t *_s, uint32_t _slot) {
+  L2D5Routing_NeighborTable_t nb;
+  if (_slot >= _s->nb->capacity || !L2D5Neighbor_occupied(_s->nb, _slot)) {
+    return -1;
+  }
+  L2D5Neighbor_export(_s->nb, _slot, &nb);
+  int rc = snap_append(_s, L2D5SNAP_NB_PUT, &nb, sizeof(nb), _s->nb->last_seen[_slot]);
+  OPENSSL_cleanse(&nb, sizeof(nb));
+  return rc;
+}
+
+int L2D5Snap_neighbor_del(L2D5Snap_t *_s, const uint8_t *_addr, uint64_t _now) {
+  return snap_append(_s, L2D5SNAP_NB_DEL, _addr, 16, _now);
+}
+
+int L2D5Snap_route_put(L2D5Snap_t *_s, uint32_t _dest) {
+  L2D5Routing_RemoteTable_t rm;
+  if (_s->route == NULL || _dest >= _s->route->capacity || _s->route->next_free[_dest] != _dest) {
+    return -1;
+  }
+  L2D5Route_export(_s->route, _dest, &rm);
+  int rc = snap_append(_s, L2D5SNAP_RM_PUT, &rm, sizeof(rm), _s->route->cold[_dest].last_seen);
+  OPENSSL_cleanse(&rm, sizeof(rm));
+  return rc;
+}
+
+int L2D5Snap_route_del(L2D5Snap_t *_s, const uint8_t *_addr, uint64_t _now) {
+  return snap_append(_s, L2D5SNAP_RM_DEL, _addr, 16, _now);
+}
+
+int L2D5Snap_sync(L2D5Snap_t *_s, bool _wait) {
+  return msync(_s->map, _s->map_bytes, _wait ? MS_SYNC : MS_ASYNC);
+}
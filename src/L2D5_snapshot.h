@@ -0,0 +1,195 @@
+/*
+ * File:        src/L2D5_snapshot.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Memory-mapped snapshot of the L2.5 neighbor / remote tables for
+ *    Radio_ORBIT, so a restarted node keeps its neighbors, routes and
+ *    SharedKeys instead of relearning them from HELLOs and redoing every
+ *    X25519.
+ *
+ *
+ *  File (one mmap, MAP_SHARED):
+ *
+ *  | Offset               | Contents                                        |
+ *  ----------------------------------------------------------------------------
+ *  | 0                    | header slot 0                                   |
+ *  | 256                  | header slot 1                                   |
+ *  | 4096                 | image 0: (nb + rm capacity) entries             |
+ *  | 4096 + image         | image 1                                         |
+ *  | 4096 + 2 * image     | log: log_capacity entries                       |
+ *
+ *  Entry (128 bytes, CRC32 over bytes 4..127):
+ *
+ *  | crc | op | rsv | gen | index | L2D5Routing_NeighborTable_t / RemoteTable_t |
+ *  |  4  |  1 |  3  |  8  |   4   |                    108                      |
+ *
+ *  Records are the packed wire structs (ORBIT_schema.h accessors): restore
+ *  copies each mapped entry, decrypts its SharedKey and hands it to
+ *  L2D5Neighbor_import() / L2D5Route_import(), nothing else is parsed.
+ *
+ *  Writes:
+ *    - put / del after a table change appends one log entry (gen, index)
+ *    - log full, or L2D5Snap_compact(): the live tables are written to the
+ *      inactive image, msync'ed, then its header (gen + 1) is written and
+ *      msync'ed. The valid header with the highest gen wins; log entries
+ *      of an older gen are ignored, so the log restarts at index 0.
+ *    - a torn entry fails its CRC: replay stops there.
+ *
+ *  SharedKey at rest: AES-256-CTR under the caller's 32-byte storage key,
+ *  counter block = header nonce (random per compaction) | image / log |
+ *  entry index, so no block is encrypted twice under the same counter.
+ *  The header keeps a key check value: a wrong key restores nothing.
+ *
+ *  Restore: last_seen of every record is rebased to the current clock
+ *  (age against the newest record in the file + _offline); records older
+ *  than _max_age are skipped. Restored entries are then revalidated
+ *  lazily: aging expires them from the rebased last_seen unless a HELLO
+ *  refreshes them, a HELLO with a new PublicKey clears the SharedKey, and
+ *  restored routes lose to any route learned from a HELLO
+ *  (L2D5Route_import).
+ *
+ * NOTE:
+ *   - last_seen is only written on put and at compaction: compact
+ *     periodically so a restore sees recent ages.
+ *   - Entries survive a process crash once written (shared mapping); call
+ *     L2D5Snap_sync() for power loss.
+ *   - Header / entry integers are host byte order: the file is local to
+ *     the node. Capacities differing from the file's start it empty.
+ *   - The file is created 0600; the CRC detects damage, not tampering.
+ *   - Not thread safe; same thread as the tables. Link -lcrypto.
+ *
+ */
+
+#ifndef L2D5_SNAPSHOT_H
+#define L2D5_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_struct.h"
+#include "L2D5_neighbor.h"
+#include "L2D5_route.h"
+#include "L2D5_keycache.h"
+#include "L2D5_aging.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5SNAP_VERSION      1
+#define L2D5SNAP_KEY_BYTES    32          // storage key, AES-256
+#define L2D5SNAP_ENTRY_BYTES  128
+#define L2D5SNAP_HEADER_BYTES 256
+#define L2D5SNAP_DATA_OFFSET  4096
+#define L2D5SNAP_LOG_DEFAULT  1024
+
+
+typedef enum {
+  L2D5SNAP_NB_PUT = 1,
+  L2D5SNAP_NB_DEL,
+  L2D5SNAP_RM_PUT,
+  L2D5SNAP_RM_DEL
+} L2D5SnapOp_t;
+
+
+typedef struct {
+  uint32_t crc;                           // CRC32 of bytes 4..127
+  uint8_t  op;                            // L2D5SnapOp_t
+  uint8_t  rsv[3];
+  uint64_t gen;                           // generation written under
+  uint32_t index;                         // position in the image / log
+  uint8_t  rec[108];                      // neighbor (94) / remote (108) record
+} L2D5SnapEntry_t;
+
+STATIC_ASSERT(sizeof(L2D5SnapEntry_t) == L2D5SNAP_ENTRY_BYTES, L2D5SnapEntry_t_must_be_128_bytes);
+
+
+typedef struct {
+  uint8_t  magic[8];                      // "ORBITSNP"
+  uint32_t version;
+  uint32_t crc;                           // CRC32 of the header, crc = 0
+  uint64_t gen;
+  uint8_t  nonce[8];                      // counter block prefix of this gen
+  uint8_t  key_check[8];                  // keystream of the storage key
+  uint64_t saved_at;                      // table clock at compaction
+  uint32_t nb_capacity;                   // file layout
+  uint32_t rm_capacity;
+  uint32_t log_capacity;
+  uint32_t nb_count;                      // image: nb entries, then rm entries
+  uint32_t rm_count;
+  uint32_t rsv;
+} L2D5SnapHeader_t;
+
+STATIC_ASSERT(sizeof(L2D5SnapHeader_t) <= L2D5SNAP_HEADER_BYTES, L2D5SnapHeader_t_fits_slot);
+
+
+typedef struct {
+  int                  fd;
+  uint8_t             *map;
+  size_t               map_bytes;
+  size_t               image_bytes;
+  L2D5NeighborTable_t *nb;
+  L2D5RouteTable_t    *route;             // optional
+  void                *cipher;            // EVP_CIPHER_CTX, AES-256-CTR
+  uint8_t              key[L2D5SNAP_KEY_BYTES];
+
+  L2D5SnapHeader_t     hdr;               // active header (valid when gen != 0)
+  uint32_t             active;            // header / image slot of hdr
+  uint32_t             log_count;         // valid log entries under hdr.gen
+  bool                 fresh;             // hdr.gen started by this process
+
+  uint64_t             appended;
+  uint64_t             compactions;
+  uint32_t             restored_nb;       // last L2D5Snap_restore()
+  uint32_t             restored_rm;
+  uint32_t             skipped;           // older than _max_age / not importable
+} L2D5Snap_t;
+
+
+/*
+ * Map (creating / resizing when needed) the snapshot at _path for _nb and
+ * optional _route, with room for _log_entries log entries between
+ * compactions (0 -> L2D5SNAP_LOG_DEFAULT). Nothing is restored yet.
+ * Returns 0, or -1 on I/O / OpenSSL failure.
+ */
+int  L2D5Snap_open(L2D5Snap_t *_s, const char *_path, const uint8_t *_key, L2D5NeighborTable_t *_nb,
+                   L2D5RouteTable_t *_route, uint32_t _log_entries);
+void L2D5Snap_close(L2D5Snap_t *_s);
+
+/*
+ * Warm start into the (empty) tables: image + log of the newest valid
+ * generation. _offline: time since the process stopped, in the tables'
+ * clock unit (0 when unknown); _max_age: skip records older than this
+ * (0 = keep all). _keys / _aging optional: sessions installed from the
+ * SharedKeys (no X25519), timers armed from the rebased last_seen.
+ * Returns the entries restored (0 without a valid snapshot), -1 when the
+ * storage key does not match.
+ */
+int L2D5Snap_restore(L2D5Snap_t *_s, L2D5KeyCache_t *_keys, L2D5Aging_t *_aging, uint64_t _now,
+                     uint64_t _offline, uint64_t _max_age);
+
+/*
+ * Table changed: log the slot's current record / its removal. _now (table
+ * clock) stamps the compaction a removal may trigger. 0, or -1 on failure.
+ */
+int L2D5Snap_neighbor_put(L2D5Snap_t *_s, uint32_t _slot);
+int L2D5Snap_neighbor_del(L2D5Snap_t *_s, const uint8_t *_addr, uint64_t _now);
+int L2D5Snap_route_put(L2D5Snap_t *_s, uint32_t _dest);
+int L2D5Snap_route_del(L2D5Snap_t *_s, const uint8_t *_addr, uint64_t _now);
+
+/* Write the live tables as a new generation; empties the log. 0, or -1. */
+int L2D5Snap_compact(L2D5Snap_t *_s, uint64_t _now);
+
+/* msync the mapping (_wait: MS_SYNC, else MS_ASYNC). 0, or -1. */
+int L2D5Snap_sync(L2D5Snap_t *_s, bool _wait);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_SNAPSHOT_H
@@ -0,0 +1,113 @@
+/*
+ * File:        src/L2D5_trickle.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 HELLO emission scheduler for Radio_ORBIT (Trickle, RFC 6206).
+ *    See L2D5_trickle.h
+ *
+ */
+
+#include "L2D5_trickle.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+static void interval_begin(L2D5Trickle_t *_tr, uint64_t _start) {
+  _tr->rng += 0x9E3779B97F4A7C15ull;
+  uint64_t half = _tr->i / 2;
+  _tr->start = _start;
+  _tr->t = _start + half + L2D5ADDR_mix64(_tr->rng) % (_tr->i - half);
+  _tr->c = 0;
+  _tr->passed_t = false;
+}
+
+
+int L2D5Trickle_init(L2D5Trickle_t *_tr, uint32_t _nb_capacity, uint64_t _imin, uint32_t _doublings, uint32_t _k,
+                     uint32_t _max_suppress, uint64_t _now, uint64_t _seed) {
+  memset(_tr, 0, sizeof(*_tr));
+  if (_imin < 2 || _doublings > 32 || (_imin << _doublings) >> _doublings != _imin) {
+    return -1;
+  }
+  _tr->last_seq = calloc(_nb_capacity != 0 ? _nb_capacity : 1, sizeof(uint16_t));
+  if (_tr->last_seq == NULL) {
+    return -1;
+  }
+  _tr->nb_capacity = _nb_capacity;
+  _tr->imin = _imin;
+  _tr->imax = _imin << _doublings;
+  _tr->k = _k;
+  _tr->max_suppress = _max_suppress;
+  _tr->rng = _seed;
+  _tr->i = _imin;
+  interval_begin(_tr, _now);
+  return 0;
+}
+
+void L2D5Trickle_free(L2D5Trickle_t *_tr) {
+  free(_tr->last_seq);
+  memset(_tr, 0, sizeof(*_tr));
+}
+
+bool L2D5Trickle_reset(L2D5Trickle_t *_tr, uint64_t _now) {
+  if (_tr->i == _tr->imin) {
+    return false;
+  }
+  _tr->i = _tr->imin;
+  _tr->resets++;
+  interval_begin(_tr, _now);
+  return true;
+}
+
+bool L2D5Trickle_hello(L2D5Trickle_t *_tr, uint32_t _slot, uint16_t _seq, unsigned _flags, uint64_t _now) {
+  if (_slot >= _tr->nb_capacity) {
+    return false;
+  }
+  int16_t d = (int16_t)(uint16_t)(_seq - _tr->last_seq[_slot]);
+  if (_flags & (L2D5NB_OBS_NEW | L2D5NB_OBS_KEY_CHANGED)) {
+    _tr->last_seq[_slot] = _seq;
+    return L2D5Trickle_reset(_tr, _now);
+  }
+  if (d == 0) {
+    return false;
+  }
+  _tr->last_seq[_slot] = _seq;
+  if (d < 0) {
+    /* SEQ went back: the neighbor restarted */
+    return L2D5Trickle_reset(_tr, _now);
+  }
+  _tr->c++;
+  _tr->heard++;
+  return false;
+}
+
+bool L2D5Trickle_poll(L2D5Trickle_t *_tr, uint64_t _now) {
+  bool send = false;
+  for (;;) {
+    if (!_tr->passed_t) {
+      if (_now < _tr->t) {
+        break;
+      }
+      _tr->passed_t = true;
+      if (_tr->k == 0 || _tr->c < _tr->k || _tr->suppressed_run >= _tr->max_suppress) {
+        _tr->suppressed_run = 0;
+        _tr->sent++;
+        send = true;
+      } else {
+        _tr->suppressed_run++;
+        _tr->suppressed++;
+      }
+      continue;
+    }
+    uint64_t end = _tr->start + _tr->i;
+    if (_now < end) {
+      break;
+    }
+    _tr->i = _tr->i * 2 < _tr->imax ? _tr->i * 2 : _tr->imax;
+    _tr->intervals++;
+    interval_begin(_tr, end);
+  }
+  return send;
+}
@@ -0,0 +1,109 @@
+/*
+ * File:        src/L2D5_trickle.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 HELLO emission scheduler for Radio_ORBIT (Trickle, RFC 6206).
+ *    Decides when a node sends its HELLO_PKT_NB / HELLO_PKT_RM pair:
+ *    rarely while the neighborhood is stable, fast again when it changes.
+ *
+ *
+ *  Per interval [start, start + I):
+ *
+ *   start          t = start + rand[I/2, I)              start + I
+ *     |  c = 0          |  c < k: send HELLO                  |  I = min(2I, Imax)
+ *     |  heard HELLOs   |  else: suppressed                   |  next interval
+ *
+ *  What an overheard HELLO_PKT_NB means (L2D5Trickle_hello()):
+ *
+ *  | Neighbor table says               | Trickle                        |
+ *  ---------------------------------------------------------------------
+ *  | L2D5NB_OBS_NEW / _KEY_CHANGED     | inconsistent: I = Imin, reset  |
+ *  | SEQ older than last one heard     | inconsistent (restart)         |
+ *  | SEQ newer than last one heard     | consistent: c + 1              |
+ *  | same SEQ again                    | ignored, counted once          |
+ *
+ *  Suppression keeps a stable, dense neighborhood from all repeating what
+ *  everyone already knows; max_suppress bounds how many intervals in a
+ *  row a node stays silent, so neighbor / route expiry longer than
+ *  (max_suppress + 1) * Imax never ages out a live node.
+ *
+ * NOTE:
+ *   - Times in caller units (us in the simulator).
+ *   - k = 0 disables suppression (RFC 6206 k = infinity).
+ *   - Not thread safe.
+ *
+ */
+
+#ifndef L2D5_TRICKLE_H
+#define L2D5_TRICKLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_neighbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct {
+  uint64_t  imin;
+  uint64_t  imax;                         // imin << doublings
+  uint32_t  k;                            // redundancy constant, 0 = never suppress
+  uint32_t  max_suppress;                 // suppressed intervals in a row before one is forced
+  /* interval state */
+  uint64_t  i;
+  uint64_t  start;
+  uint64_t  t;                            // transmit point in [start + I/2, start + I)
+  uint32_t  c;                            // consistent HELLOs heard this interval
+  uint32_t  suppressed_run;
+  bool      passed_t;
+  uint64_t  rng;
+  /* per neighbor slot: last HELLO SEQ heard */
+  uint16_t *last_seq;
+  uint32_t  nb_capacity;
+
+  uint64_t  intervals;
+  uint64_t  sent;
+  uint64_t  suppressed;
+  uint64_t  resets;
+  uint64_t  heard;                        // consistent HELLOs counted
+} L2D5Trickle_t;
+
+
+/*
+ * Intervals from _imin to _imin << _doublings, first interval starting at
+ * _now with I = Imin. _nb_capacity: the neighbor table's capacity. 0 or -1.
+ */
+int  L2D5Trickle_init(L2D5Trickle_t *_tr, uint32_t _nb_capacity, uint64_t _imin, uint32_t _doublings, uint32_t _k,
+                      uint32_t _max_suppress, uint64_t _now, uint64_t _seed);
+void L2D5Trickle_free(L2D5Trickle_t *_tr);
+
+/* Inconsistency (new / lost neighbor, key change): back to Imin unless already there. true when reset. */
+bool L2D5Trickle_reset(L2D5Trickle_t *_tr, uint64_t _now);
+
+/* HELLO_PKT_NB from neighbor slot _slot with _seq, _flags from L2D5Neighbor_observe(). true when reset. */
+bool L2D5Trickle_hello(L2D5Trickle_t *_tr, uint32_t _slot, uint16_t _seq, unsigned _flags, uint64_t _now);
+
+/* Time of the next transmit point or interval end; call L2D5Trickle_poll() then */
+static inline uint64_t L2D5Trickle_next(const L2D5Trickle_t *_tr) {
+  return _tr->passed_t ? _tr->start + _tr->i : _tr->t;
+}
+
+/* Runs the timer to _now; true when the node should send its HELLO now */
+bool L2D5Trickle_poll(L2D5Trickle_t *_tr, uint64_t _now);
+
+static inline size_t L2D5Trickle_bytes(const L2D5Trickle_t *_tr) {
+  return sizeof(*_tr) + (size_t)_tr->nb_capacity * sizeof(uint16_t);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_TRICKLE_H
@@ -0,0 +1,178 @@
+/*
+ * File:        src/L2D5_txsched.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 transmit scheduler for Radio_ORBIT.
+ *    See L2D5_txsched.h
+ *
+ */
+
+#include "L2D5_txsched.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+/* ----------------------------- MPSC ring ------------------------------- */
+
+static int ring_init(L2D5TxRing_t *_r, uint32_t _depth) {
+  uint64_t n = 2;
+  while (n < _depth) {
+    n <<= 1;
+  }
+  _r->cells = aligned_alloc(L2D5TX_CACHELINE, ((n * sizeof(L2D5TxCell_t)) + 63) & ~(size_t)63);
+  if (_r->cells == NULL) {
+    return -1;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    atomic_init(&_r->cells[i].seq, i);
+    _r->cells[i].item = NULL;
+  }
+  _r->mask = n - 1;
+  _r->head = 0;
+  atomic_init(&_r->tail, 0);
+  atomic_init(&_r->dropped, 0);
+  return 0;
+}
+
+static bool ring_push(L2D5TxRing_t *_r, void *_item) {
+  uint64_t pos = atomic_load_explicit(&_r->tail, memory_order_relaxed);
+  for (;;) {
+    L2D5TxCell_t *c = &_r->cells[pos & _r->mask];
+    uint64_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+    int64_t diff = (int64_t)(seq - pos);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&_r->tail, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        c->item = _item;
+        atomic_store_explicit(&c->seq, pos + 1, memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;                       // consumer has not freed this cell yet
+    } else {
+      pos = atomic_load_explicit(&_r->tail, memory_order_relaxed);
+    }
+  }
+}
+
+static inline bool ring_ready(const L2D5TxRing_t *_r) {
+  const L2D5TxCell_t *c = &_r->cells[_r->head & _r->mask];
+  return atomic_load_explicit(&c->seq, memory_order_acquire) == _r->head + 1;
+}
+
+static inline void *ring_pop(L2D5TxRing_t *_r) {
+  L2D5TxCell_t *c = &_r->cells[_r->head & _r->mask];
+  if (atomic_load_explicit(&c->seq, memory_order_acquire) != _r->head + 1) {
+    return NULL;
+  }
+  void *item = c->item;
+  atomic_store_explicit(&c->seq, _r->head + _r->mask + 1, memory_order_release);
+  _r->head++;
+  return item;
+}
+
+
+/* ------------------------------ scheduler ------------------------------ */
+
+int L2D5TxSched_init(L2D5TxSched_t *_s, uint32_t _depth) {
+  memset(_s, 0, sizeof(*_s));
+  for (int p = 0; p < L2D5TX_LEVELS; p++) {
+    if (ring_init(&_s->ring[p], _depth) != 0) {
+      L2D5TxSched_free(_s);
+      return -1;
+    }
+  }
+  atomic_init(&_s->occ, 0);
+  L2D5TxSched_set_strict(_s);
+  return 0;
+}
+
+void L2D5TxSched_free(L2D5TxSched_t *_s) {
+  for (int p = 0; p < L2D5TX_LEVELS; p++) {
+    free(_s->ring[p].cells);
+  }
+  memset(_s, 0, sizeof(*_s));
+}
+
+void L2D5TxSched_set_weighted(L2D5TxSched_t *_s, const uint16_t *_weights) {
+  for (int p = 0; p < L2D5TX_LEVELS; p++) {
+    uint16_t w = _weights != NULL ? _weights[p] : (uint16_t)(1u << (p / 4));
+    _s->weight[p] = w ? w : 1;
+    _s->credit[p] = _s->weight[p];
+  }
+  _s->credit_mask = (1u << L2D5TX_LEVELS) - 1;
+  _s->weighted = true;
+}
+
+void L2D5TxSched_set_strict(L2D5TxSched_t *_s) {
+  _s->weighted = false;
+  _s->credit_mask = (1u << L2D5TX_LEVELS) - 1;
+}
+
+bool L2D5TxSched_push(L2D5TxSched_t *_s, uint8_t _pri, void *_item) {
+  uint32_t p = _pri & (L2D5TX_LEVELS - 1);
+  if (!ring_push(&_s->ring[p], _item)) {
+    atomic_fetch_add_explicit(&_s->ring[p].dropped, 1, memory_order_relaxed);
+    return false;
+  }
+  /*
+   * Cell is published; skip the shared RMW when the bit is already set.
+   * The fence pairs with the consumer's seq_cst clear + re-check: either we
+   * see the bit cleared, or the consumer sees our cell.
+   */
+  atomic_thread_fence(memory_order_seq_cst);
+  if (!(atomic_load_explicit(&_s->occ, memory_order_relaxed) & (1u << p))) {
+    atomic_fetch_or_explicit(&_s->occ, 1u << p, memory_order_release);
+  }
+  return true;
+}
+
+void *L2D5TxSched_pop(L2D5TxSched_t *_s, uint8_t *_pri) {
+  for (;;) {
+    uint32_t occ = atomic_load_explicit(&_s->occ, memory_order_acquire);
+    if (occ == 0) {
+      return NULL;
+    }
+    uint32_t cand = occ;
+    if (_s->weighted) {
+      cand &= _s->credit_mask;
+      if (cand == 0) {
+        /* every backlogged PRI spent its share: next round */
+        for (int p = 0; p < L2D5TX_LEVELS; p++) {
+          _s->credit[p] = _s->weight[p];
+        }
+        _s->credit_mask = (1u << L2D5TX_LEVELS) - 1;
+        cand = occ;
+      }
+    }
+    uint32_t p = 31u - (uint32_t)__builtin_clz(cand);
+    void *item = ring_pop(&_s->ring[p]);
+    if (item != NULL) {
+      if (_s->weighted && --_s->credit[p] == 0) {
+        _s->credit_mask &= ~(1u << p);
+      }
+      _s->sent[p]++;
+      if (_pri != NULL) {
+        *_pri = (uint8_t)p;
+      }
+      return item;
+    }
+    /* ring p looked empty: clear its bit, then undo if a producer raced us */
+    atomic_fetch_and_explicit(&_s->occ, ~(1u << p), memory_order_seq_cst);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (ring_ready(&_s->ring[p])) {
+      atomic_fetch_or_explicit(&_s->occ, 1u << p, memory_order_relaxed);
+    }
+  }
+}
+
+size_t L2D5TxSched_pop_burst(L2D5TxSched_t *_s, void **_out, size_t _max) {
+  size_t n = 0;
+  while (n < _max && (_out[n] = L2D5TxSched_pop(_s, NULL)) != NULL) {
+    n++;
+  }
+  return n;
+}
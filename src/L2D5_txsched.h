@@ -0,0 +1,125 @@
+/*
+ * File:        src/L2D5_txsched.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2.5 transmit scheduler for Radio_ORBIT.
+ *    One lock-free MPSC ring per FLAG PRI level (0-15, L->H) feeding a
+ *    single radio TX thread.
+ *
+ *
+ *  Layout:
+ *
+ *   producers (routing, app, retransmit, ...)
+ *        |  push(pri, item)
+ *        v
+ *   ring[15] ring[14] ... ring[1] ring[0]      bounded MPSC, per-cell seq
+ *        |        |           |      |
+ *   occ: bit15  bit14  ...   bit1   bit0       set after publish
+ *        \________________________________/
+ *                      |  pri = 31 - clz(occ)
+ *                      v
+ *                 TX thread (pop)
+ *
+ *  Strict mode: always the highest non-empty PRI.
+ *  Weighted mode: deficit round robin; PRI p may send weight[p] frames per
+ *  round, higher PRI first inside a round, so PRI 0 is never starved.
+ *  Still one clz per pick: candidates = occ & (PRIs with credit left).
+ *
+ *  Producer: claim cell (CAS on tail), write item, publish cell seq, then
+ *  set the occ bit. Consumer clears a bit only after seeing the ring
+ *  empty and re-checks the head cell, so a racing publish is never lost.
+ *
+ * NOTE:
+ *   - Any number of producer threads, exactly one consumer thread.
+ *   - Items are opaque pointers (L2D5Frame_t *, slab handle, ...), never NULL.
+ *
+ */
+
+#ifndef L2D5_TXSCHED_H
+#define L2D5_TXSCHED_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2D5TX_LEVELS 16
+#define L2D5TX_CACHELINE 64
+
+
+typedef struct {
+  _Atomic uint64_t seq;
+  void            *item;
+} L2D5TxCell_t;
+
+
+typedef struct {
+  _Alignas(L2D5TX_CACHELINE) _Atomic uint64_t tail;   // producers
+  _Alignas(L2D5TX_CACHELINE) uint64_t         head;   // consumer only
+  L2D5TxCell_t *cells;
+  uint64_t      mask;
+  _Atomic uint64_t dropped;                           // push on a full ring
+} L2D5TxRing_t;
+
+
+typedef struct {
+  L2D5TxRing_t ring[L2D5TX_LEVELS];
+  _Alignas(L2D5TX_CACHELINE) _Atomic uint32_t occ;    // bit p: ring p may be non-empty
+  /* consumer only */
+  _Alignas(L2D5TX_CACHELINE) bool weighted;
+  uint32_t credit_mask;                               // bit p: credit[p] > 0
+  uint16_t credit[L2D5TX_LEVELS];
+  uint16_t weight[L2D5TX_LEVELS];
+  uint64_t sent[L2D5TX_LEVELS];
+} L2D5TxSched_t;
+
+
+/* _depth (per PRI) is rounded up to a power of 2. Strict mode after init. */
+int  L2D5TxSched_init(L2D5TxSched_t *_s, uint32_t _depth);
+void L2D5TxSched_free(L2D5TxSched_t *_s);
+
+/*
+ * Weighted-fair draining: _weights[p] frames per round for PRI p (0 -> 1).
+ * NULL weights: 1 << (p / 4), i.e. 1,1,1,1,2,2,2,2,4,...,8.
+ * Consumer thread only.
+ */
+void L2D5TxSched_set_weighted(L2D5TxSched_t *_s, const uint16_t *_weights);
+void L2D5TxSched_set_strict(L2D5TxSched_t *_s);
+
+/* Any thread. false when ring _pri is full (counted in ring.dropped). */
+bool L2D5TxSched_push(L2D5TxSched_t *_s, uint8_t _pri, void *_item);
+
+/* PRI from the FLAG byte; works for plain and encrypted L2.5 frames */
+static inline bool L2D5TxSched_push_frame(L2D5TxSched_t *_s, L2D5Frame_t *_frame) {
+  return L2D5TxSched_push(_s, L2D5FLAG_GET_PRI(_frame->FLAG), _frame);
+}
+
+/* Consumer thread. Next item, or NULL when every ring is empty. *_pri optional. */
+void  *L2D5TxSched_pop(L2D5TxSched_t *_s, uint8_t *_pri);
+size_t L2D5TxSched_pop_burst(L2D5TxSched_t *_s, void **_out, size_t _max);
+
+/* Consumer thread. Frames queued at PRI _pri (cells claimed by producers included) */
+static inline uint64_t L2D5TxSched_depth(const L2D5TxSched_t *_s, uint8_t _pri) {
+  const L2D5TxRing_t *r = &_s->ring[_pri & (L2D5TX_LEVELS - 1)];
+  return atomic_load_explicit(&r->tail, memory_order_relaxed) - r->head;
+}
+
+static inline bool L2D5TxSched_empty(L2D5TxSched_t *_s) {
+  return atomic_load_explicit(&_s->occ, memory_order_acquire) == 0;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2D5_TXSCHED_H
@@ -0,0 +1,454 @@
+/*
+ * File:        src/L2_crc32.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2 DataLink layer FCS (CRC32) engine for Radio_ORBIT.
+ *    See L2_crc32.h
+ *
+ */
+
+#include "L2_crc32.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define L2CRC32_HAVE_PCLMUL 1
+#endif
+
+#if defined(__aarch64__)
+  #include <arm_acle.h>
+  #include <sys/auxv.h>
+  #include <asm/hwcap.h>
+  #define L2CRC32_HAVE_ARMV8 1
+#endif
+
+
+#define CRC32_PAYLOAD_OFF offsetof(L2Frame, Payload)
+#define CRC32_PAYLOAD_LEN sizeof(((const L2Frame *)0)->Payload)
+
+STATIC_ASSERT(CRC32_PAYLOAD_LEN == 216, crc32_x4_kernels_assume_216_byte_payload);
+
+typedef uint32_t (*crc32_kernel_fn)(uint32_t, const uint8_t *, size_t);
+/* FCS of the Payload of 4 contiguous frames, interleaved */
+typedef void (*crc32_x4_fn)(const uint8_t *, uint32_t *);
+
+static uint32_t crc32_table[8][256];
+static uint32_t crc32_pad8;               // register that 8 zero bytes turn into ~0
+static pthread_once_t crc32_table_once = PTHREAD_ONCE_INIT;
+
+static crc32_kernel_fn crc32_kernel = NULL;
+static crc32_x4_fn     crc32_kernel_x4 = NULL;
+static L2CRC32_impl_t  crc32_kernel_impl = L2CRC32_IMPL_AUTO;
+
+
+static void crc32_table_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) {
+      c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : (c >> 1);
+    }
+    crc32_table[0][i] = c;
+  }
+  for (uint32_t i = 0; i < 256; i++) {
+    for (int t = 1; t < 8; t++) {
+      uint32_t c = crc32_table[t - 1][i];
+      crc32_table[t][i] = (c >> 8) ^ crc32_table[0][c & 0xFF];
+    }
+  }
+  /* run 8 zero bytes backwards from ~0: the top byte of T[i] is unique to i */
+  uint32_t c = ~0u;
+  for (int n = 0; n < 8; n++) {
+    uint32_t i = 0;
+    while ((crc32_table[0][i] >> 24) != (c >> 24)) {
+      i++;
+    }
+    c = ((c ^ crc32_table[0][i]) << 8) | i;
+  }
+  crc32_pad8 = c;
+}
+
+
+/* ---------------------------- slicing-by-8 ---------------------------- */
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t *buf, size_t len) {
+  const uint32_t (*T)[256] = (const uint32_t (*)[256])crc32_table;
+  crc = ~crc;
+
+  while (len && ((uintptr_t)buf & 7)) {
+    crc = T[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+    len--;
+  }
+
+  while (len >= 8) {
+    uint32_t a = ((uint32_t)buf[0])       | ((uint32_t)buf[1] << 8) |
+                 ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    uint32_t b = ((uint32_t)buf[4])       | ((uint32_t)buf[5] << 8) |
+                 ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+    a ^= crc;
+    crc = T[7][a & 0xFF] ^ T[6][(a >> 8) & 0xFF] ^ T[5][(a >> 16) & 0xFF] ^ T[4][a >> 24] ^
+          T[3][b & 0xFF] ^ T[2][(b >> 8) & 0xFF] ^ T[1][(b >> 16) & 0xFF] ^ T[0][b >> 24];
+    buf += 8;
+    len -= 8;
+  }
+
+  while (len--) {
+    crc = T[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+
+/* ------------------------- PCLMULQDQ folding -------------------------- */
+
+#ifdef L2CRC32_HAVE_PCLMUL
+
+/* Bit-reflected folding constants for 0x04C11DB7 (Intel, "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction") */
+static const uint64_t crc32_k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4, 0x01c6e41596 };
+static const uint64_t crc32_k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0, 0x00ccaa009e };
+static const uint64_t crc32_k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124, 0x0000000000 };
+static const uint64_t crc32_poly[2] __attribute__((aligned(16))) = { 0x01db710641, 0x01f7011641 };
+
+/* 128-bit remainder -> 32-bit register */
+__attribute__((target("pclmul,sse4.1")))
+static inline uint32_t crc32_pclmul_reduce(__m128i x1) {
+  __m128i x0, x2, x3;
+
+  /* 128 -> 64 */
+  x0 = _mm_load_si128((const __m128i *)crc32_k3k4);
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+
+  x0 = _mm_loadl_epi64((const __m128i *)crc32_k5k0);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  /* Barrett reduction to 32 */
+  x0 = _mm_load_si128((const __m128i *)crc32_poly);
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+
+/* _len >= 64 and a multiple of 16; _crc is the pre-inverted running value */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul_fold(uint32_t crc, const uint8_t *buf, size_t len) {
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  x0 = _mm_load_si128((const __m128i *)crc32_k1k2);
+  buf += 64;
+  len -= 64;
+
+  /* 4 x 128-bit parallel fold */
+  while (len >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+    buf += 64;
+    len -= 64;
+  }
+
+  /* fold 4 x 128 into 128 */
+  x0 = _mm_load_si128((const __m128i *)crc32_k3k4);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  /* single 128-bit folds */
+  while (len >= 16) {
+    x2 = _mm_loadu_si128((const __m128i *)buf);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    buf += 16;
+    len -= 16;
+  }
+
+  return crc32_pclmul_reduce(x1);
+}
+
+/*
+ * 4 frames, one 128-bit lane each, so four independent fold chains share
+ * the multiplier. The 216-byte Payload is 13.5 blocks: it is read as
+ * 8 zero bytes + Payload (14 blocks) with the register preset to
+ * crc32_pad8, which the zero bytes turn into the usual ~0.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static void crc32_pclmul_x4(const uint8_t *_frames, uint32_t *_crc) {
+  const __m128i k = _mm_load_si128((const __m128i *)crc32_k3k4);
+  const __m128i pad = _mm_cvtsi32_si128((int)crc32_pad8);
+  const uint8_t *p0 = _frames + CRC32_PAYLOAD_OFF;
+  const uint8_t *p1 = p0 + L2CRC32_FRAME_BYTES;
+  const uint8_t *p2 = p1 + L2CRC32_FRAME_BYTES;
+  const uint8_t *p3 = p2 + L2CRC32_FRAME_BYTES;
+  __m128i x0, x1, x2, x3, y0, y1, y2, y3;
+
+  x0 = _mm_xor_si128(_mm_slli_si128(_mm_loadl_epi64((const __m128i *)p0), 8), pad);
+  x1 = _mm_xor_si128(_mm_slli_si128(_mm_loadl_epi64((const __m128i *)p1), 8), pad);
+  x2 = _mm_xor_si128(_mm_slli_si128(_mm_loadl_epi64((const __m128i *)p2), 8), pad);
+  x3 = _mm_xor_si128(_mm_slli_si128(_mm_loadl_epi64((const __m128i *)p3), 8), pad);
+
+  for (size_t off = 8; off < CRC32_PAYLOAD_LEN; off += 16) {
+    y0 = _mm_clmulepi64_si128(x0, k, 0x00);
+    y1 = _mm_clmulepi64_si128(x1, k, 0x00);
+    y2 = _mm_clmulepi64_si128(x2, k, 0x00);
+    y3 = _mm_clmulepi64_si128(x3, k, 0x00);
+    x0 = _mm_clmulepi64_si128(x0, k, 0x11);
+    x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+    x0 = _mm_xor_si128(_mm_xor_si128(x0, y0), _mm_loadu_si128((const __m128i *)(p0 + off)));
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, y1), _mm_loadu_si128((const __m128i *)(p1 + off)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, y2), _mm_loadu_si128((const __m128i *)(p2 + off)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, y3), _mm_loadu_si128((const __m128i *)(p3 + off)));
+  }
+
+  _crc[0] = ~crc32_pclmul_reduce(x0);
+  _crc[1] = ~crc32_pclmul_reduce(x1);
+  _crc[2] = ~crc32_pclmul_reduce(x2);
+  _crc[3] = ~crc32_pclmul_reduce(x3);
+}
+
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t *buf, size_t len) {
+  if (len < 64) {
+    return crc32_slice8(crc, buf, len);
+  }
+  size_t chunk = len & ~(size_t)15;
+  crc = ~crc32_pclmul_fold(~crc, buf, chunk);
+  return crc32_slice8(crc, buf + chunk, len - chunk);
+}
+
+static bool crc32_pclmul_supported(void) {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+
+#endif // L2CRC32_HAVE_PCLMUL
+
+
+/* -------------------------- ARMv8 CRC32 ------------------------------- */
+
+#ifdef L2CRC32_HAVE_ARMV8
+
+__attribute__((target("+crc")))
+static uint32_t crc32_armv8(uint32_t crc, const uint8_t *buf, size_t len) {
+  crc = ~crc;
+  while (len && ((uintptr_t)buf & 7)) {
+    crc = __crc32b(crc, *buf++);
+    len--;
+  }
+  /* 4 independent words per round keeps the CRC unit pipeline busy */
+  while (len >= 32) {
+    uint64_t w0, w1, w2, w3;
+    memcpy(&w0, buf, 8);
+    memcpy(&w1, buf + 8, 8);
+    memcpy(&w2, buf + 16, 8);
+    memcpy(&w3, buf + 24, 8);
+    crc = __crc32d(crc, w0);
+    crc = __crc32d(crc, w1);
+    crc = __crc32d(crc, w2);
+    crc = __crc32d(crc, w3);
+    buf += 32;
+    len -= 32;
+  }
+  while (len >= 8) {
+    uint64_t w;
+    memcpy(&w, buf, 8);
+    crc = __crc32d(crc, w);
+    buf += 8;
+    len -= 8;
+  }
+  while (len--) {
+    crc = __crc32b(crc, *buf++);
+  }
+  return ~crc;
+}
+
+/* 4 frames, 4 independent CRC32X chains: the instruction is pipelined, one chain is latency bound */
+__attribute__((target("+crc")))
+static void crc32_armv8_x4(const uint8_t *_frames, uint32_t *_crc) {
+  const uint8_t *p0 = _frames + CRC32_PAYLOAD_OFF;
+  const uint8_t *p1 = p0 + L2CRC32_FRAME_BYTES;
+  const uint8_t *p2 = p1 + L2CRC32_FRAME_BYTES;
+  const uint8_t *p3 = p2 + L2CRC32_FRAME_BYTES;
+  uint32_t c0 = ~0u, c1 = ~0u, c2 = ~0u, c3 = ~0u;
+  for (size_t off = 0; off < CRC32_PAYLOAD_LEN; off += 8) {
+    uint64_t w0, w1, w2, w3;
+    memcpy(&w0, p0 + off, 8);
+    memcpy(&w1, p1 + off, 8);
+    memcpy(&w2, p2 + off, 8);
+    memcpy(&w3, p3 + off, 8);
+    c0 = __crc32d(c0, w0);
+    c1 = __crc32d(c1, w1);
+    c2 = __crc32d(c2, w2);
+    c3 = __crc32d(c3, w3);
+  }
+  _crc[0] = ~c0;
+  _crc[1] = ~c1;
+  _crc[2] = ~c2;
+  _crc[3] = ~c3;
+}
+
+static bool crc32_armv8_supported(void) {
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#endif // L2CRC32_HAVE_ARMV8
+
+
+/* ---------------------------- dispatch -------------------------------- */
+
+static crc32_kernel_fn crc32_resolve(L2CRC32_impl_t *impl) {
+  switch (*impl) {
+    case L2CRC32_IMPL_SLICE8:
+      return crc32_slice8;
+#ifdef L2CRC32_HAVE_PCLMUL
+    case L2CRC32_IMPL_PCLMUL:
+      return crc32_pclmul_supported() ? crc32_pclmul : NULL;
+#endif
+#ifdef L2CRC32_HAVE_ARMV8
+    case L2CRC32_IMPL_ARMV8:
+      return crc32_armv8_supported() ? crc32_armv8 : NULL;
+#endif
+    case L2CRC32_IMPL_AUTO:
+#ifdef L2CRC32_HAVE_PCLMUL
+      if (crc32_pclmul_supported()) {
+        *impl = L2CRC32_IMPL_PCLMUL;
+        return crc32_pclmul;
+      }
+#endif
+#ifdef L2CRC32_HAVE_ARMV8
+      if (crc32_armv8_supported()) {
+        *impl = L2CRC32_IMPL_ARMV8;
+        return crc32_armv8;
+      }
+#endif
+      *impl = L2CRC32_IMPL_SLICE8;
+      return crc32_slice8;
+    default:
+      return NULL;
+  }
+}
+
+/* Interleaved batch kernel of a resolved impl, NULL: frame by frame */
+static crc32_x4_fn crc32_resolve_x4(L2CRC32_impl_t _impl) {
+  switch (_impl) {
+#ifdef L2CRC32_HAVE_PCLMUL
+    case L2CRC32_IMPL_PCLMUL:
+      return crc32_pclmul_x4;
+#endif
+#ifdef L2CRC32_HAVE_ARMV8
+    case L2CRC32_IMPL_ARMV8:
+      return crc32_armv8_x4;
+#endif
+    default:
+      return NULL;                        // slice8 is load bound, interleaving buys nothing
+  }
+}
+
+int L2CRC32_select(L2CRC32_impl_t _impl) {
+  pthread_once(&crc32_table_once, crc32_table_init);
+  crc32_kernel_fn fn = crc32_resolve(&_impl);
+  if (fn == NULL) {
+    return -1;
+  }
+  __atomic_store_n(&crc32_kernel_impl, _impl, __ATOMIC_RELAXED);
+  __atomic_store_n(&crc32_kernel_x4, crc32_resolve_x4(_impl), __ATOMIC_RELAXED);
+  __atomic_store_n(&crc32_kernel, fn, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static inline crc32_kernel_fn crc32_get_kernel(void) {
+  crc32_kernel_fn fn = __atomic_load_n(&crc32_kernel, __ATOMIC_ACQUIRE);
+  if (__builtin_expect(fn == NULL, 0)) {
+    L2CRC32_select(L2CRC32_IMPL_AUTO);
+    fn = __atomic_load_n(&crc32_kernel, __ATOMIC_ACQUIRE);
+  }
+  return fn;
+}
+
+L2CRC32_impl_t L2CRC32_active(void) {
+  crc32_get_kernel();
+  return __atomic_load_n(&crc32_kernel_impl, __ATOMIC_RELAXED);
+}
+
+const char *L2CRC32_impl_name(L2CRC32_impl_t _impl) {
+  switch (_impl) {
+    case L2CRC32_IMPL_AUTO:   return "auto";
+    case L2CRC32_IMPL_SLICE8: return "slice8";
+    case L2CRC32_IMPL_PCLMUL: return "pclmul";
+    case L2CRC32_IMPL_ARMV8:  return "armv8-crc";
+  }
+  return "unknown";
+}
+
+uint32_t L2CRC32_update(uint32_t _crc, const uint8_t *_buf, size_t _len) {
+  return crc32_get_kernel()(_crc, _buf, _len);
+}
+
+size_t L2CRC32_check_batch(const uint8_t *_frames, size_t _count, uint8_t *_ok) {
+  crc32_kernel_fn fn = crc32_get_kernel();
+  crc32_x4_fn x4 = __atomic_load_n(&crc32_kernel_x4, __ATOMIC_RELAXED);
+  size_t good = 0;
+  uint32_t crc[4];
+
+  for (size_t i = 0; i < _count; i += 4) {
+    const uint8_t *base = _frames + i * L2CRC32_FRAME_BYTES;
+    size_t n = _count - i < 4 ? _count - i : 4;
+    if (n == 4 && x4 != NULL) {
+      x4(base, crc);
+    } else {
+      for (size_t j = 0; j < n; j++) {
+        crc[j] = fn(0, base + j * L2CRC32_FRAME_BYTES + CRC32_PAYLOAD_OFF, CRC32_PAYLOAD_LEN);
+      }
+    }
+    for (size_t j = 0; j < n; j++) {
+      uint8_t match = (crc[j] == L2CRC32_load((const L2Frame *)(base + j * L2CRC32_FRAME_BYTES)));
+      good += match;
+      if (_ok != NULL) {
+        _ok[i + j] = match;
+      }
+    }
+  }
+  return good;
+}
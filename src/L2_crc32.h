@@ -0,0 +1,95 @@
+/*
+ * File:        src/L2_crc32.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2 DataLink layer FCS (CRC32) engine for Radio_ORBIT.
+ *    Bit-exact with zlib crc32() (IEEE 802.3, reflected 0xEDB88320).
+ *
+ *    Kernels:
+ *      - slicing-by-8 portable kernel (any CPU)
+ *      - PCLMULQDQ folding kernel     (x86_64, picked at runtime)
+ *      - ARMv8 CRC32 instruction kernel (aarch64, picked at runtime)
+ *
+ * NOTE:
+ *   - The FCS covers L2Frame.Payload (216 bytes) and is stored big-endian
+ *     in L2Frame.ChkSum[4].
+ *
+ */
+
+#ifndef L2_CRC32_H
+#define L2_CRC32_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2CRC32_FRAME_BYTES sizeof(L2Frame)
+
+
+typedef enum {
+  L2CRC32_IMPL_AUTO = 0,
+  L2CRC32_IMPL_SLICE8,
+  L2CRC32_IMPL_PCLMUL,
+  L2CRC32_IMPL_ARMV8
+} L2CRC32_impl_t;
+
+
+/* Select a kernel. AUTO picks the fastest one supported by this CPU.
+ * Returns 0 on success, -1 if the kernel is not available here. */
+int L2CRC32_select(L2CRC32_impl_t _impl);
+
+/* Currently selected kernel */
+L2CRC32_impl_t L2CRC32_active(void);
+const char *L2CRC32_impl_name(L2CRC32_impl_t _impl);
+
+/* Same contract as zlib: crc32(_crc, _buf, _len), start with _crc = 0 */
+uint32_t L2CRC32_update(uint32_t _crc, const uint8_t *_buf, size_t _len);
+
+
+static inline uint32_t L2CRC32_frame(const L2Frame *_frame) {
+  return L2CRC32_update(0, _frame->Payload, sizeof(_frame->Payload));
+}
+
+static inline uint32_t L2CRC32_load(const L2Frame *_frame) {
+  return ((uint32_t)_frame->ChkSum[0] << 24) |
+         ((uint32_t)_frame->ChkSum[1] << 16) |
+         ((uint32_t)_frame->ChkSum[2] << 8)  |
+         ((uint32_t)_frame->ChkSum[3]);
+}
+
+/* Compute the FCS of _frame->Payload and store it big-endian in ChkSum */
+static inline void L2CRC32_seal(L2Frame *_frame) {
+  uint32_t crc = L2CRC32_frame(_frame);
+  _frame->ChkSum[0] = (uint8_t)(crc >> 24);
+  _frame->ChkSum[1] = (uint8_t)(crc >> 16);
+  _frame->ChkSum[2] = (uint8_t)(crc >> 8);
+  _frame->ChkSum[3] = (uint8_t)crc;
+}
+
+static inline bool L2CRC32_check(const L2Frame *_frame) {
+  return L2CRC32_frame(_frame) == L2CRC32_load(_frame);
+}
+
+/*
+ * Check _count contiguous 224-byte frames starting at _frames. The
+ * PCLMULQDQ and ARMv8 kernels run 4 frames at a time interleaved.
+ * _ok (optional, may be NULL) receives 1/0 per frame.
+ * Returns the number of frames whose FCS matched.
+ */
+size_t L2CRC32_check_batch(const uint8_t *_frames, size_t _count, uint8_t *_ok);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2_CRC32_H
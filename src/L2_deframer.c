@@ -0,0 +1,180 @@
+/*
+ * File:        src/L2_deframer.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Streaming zero-copy L2 deframer for Radio_ORBIT.
+ *    See L2_deframer.h
+ *
+ */
+
+#include "L2_deframer.h"
+#include "L2_crc32.h"
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
+
+const uint8_t *L2Deframer_find_sfd(const uint8_t *_p, const uint8_t *_end) {
+#if defined(__SSE2__)
+  const __m128i sfd = _mm_set1_epi8((char)MAGIC_L2LAYER_SFD);
+  while (_p + 32 <= _end) {
+    __m128i a = _mm_loadu_si128((const __m128i *)_p);
+    __m128i b = _mm_loadu_si128((const __m128i *)(_p + 16));
+    uint32_t m = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, sfd)) |
+                 ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b, sfd)) << 16);
+    if (m) {
+      return _p + __builtin_ctz(m);
+    }
+    _p += 32;
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t sfd = vdupq_n_u8(MAGIC_L2LAYER_SFD);
+  while (_p + 16 <= _end) {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(_p), sfd);
+    /* narrow 16 x 8-bit lanes to a 64-bit mask, 4 bits per byte */
+    uint64_t m = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if (m) {
+      return _p + (__builtin_ctzll(m) >> 2);
+    }
+    _p += 16;
+  }
+#endif
+  while (_p < _end && *_p != MAGIC_L2LAYER_SFD) {
+    _p++;
+  }
+  return _p;
+}
+
+
+int L2Deframer_init(L2Deframer_t *_d, size_t _cap, bool _check_fcs) {
+  size_t p2 = 1;
+  while (p2 < _cap || p2 < 2 * L2DEFRAMER_FRAME_BYTES) {
+    p2 <<= 1;
+  }
+
+  memset(_d, 0, sizeof(*_d));
+  _d->ring = aligned_alloc(64, (p2 + L2DEFRAMER_MIRROR_BYTES + 63) & ~(size_t)63);
+  if (_d->ring == NULL) {
+    return -1;
+  }
+  _d->cap = p2;
+  _d->mask = p2 - 1;
+  _d->check_fcs = _check_fcs;
+  return 0;
+}
+
+void L2Deframer_free(L2Deframer_t *_d) {
+  free(_d->ring);
+  _d->ring = NULL;
+}
+
+void L2Deframer_reset(L2Deframer_t *_d) {
+  _d->head = 0;
+  _d->scan = 0;
+  _d->tail = 0;
+  _d->views = 0;
+  memset(&_d->stats, 0, sizeof(_d->stats));
+}
+
+
+/* Keep ring[cap ..] in sync with the first L2DEFRAMER_MIRROR_BYTES */
+static inline void deframer_mirror(L2Deframer_t *_d, size_t _idx, size_t _len) {
+  if (_idx < L2DEFRAMER_MIRROR_BYTES) {
+    size_t n = L2DEFRAMER_MIRROR_BYTES - _idx;
+    if (n > _len) {
+      n = _len;
+    }
+    memcpy(_d->ring + _d->cap + _idx, _d->ring + _idx, n);
+  }
+}
+
+uint8_t *L2Deframer_wbuf(L2Deframer_t *_d, size_t *_len) {
+  size_t idx = (size_t)_d->head & _d->mask;
+  size_t contig = _d->cap - idx;
+  size_t space = L2Deframer_space(_d);
+  *_len = space < contig ? space : contig;
+  return _d->ring + idx;
+}
+
+void L2Deframer_commit(L2Deframer_t *_d, size_t _len) {
+  deframer_mirror(_d, (size_t)_d->head & _d->mask, _len);
+  _d->head += _len;
+}
+
+size_t L2Deframer_push(L2Deframer_t *_d, const uint8_t *_chunk, size_t _len) {
+  size_t done = 0;
+  while (done < _len) {
+    size_t room;
+    uint8_t *w = L2Deframer_wbuf(_d, &room);
+    if (room == 0) {
+      break;
+    }
+    if (room > _len - done) {
+      room = _len - done;
+    }
+    memcpy(w, _chunk + done, room);
+    L2Deframer_commit(_d, room);
+    done += room;
+  }
+  return done;
+}
+
+
+size_t L2Deframer_poll(L2Deframer_t *_d, const L2Frame **_out, size_t _max) {
+  size_t n = 0;
+
+  while (n < _max) {
+    size_t avail = (size_t)(_d->head - _d->scan);
+    if (avail == 0) {
+      break;
+    }
+    size_t idx = (size_t)_d->scan & _d->mask;
+    const uint8_t *p = _d->ring + idx;
+
+    if (*p != MAGIC_L2LAYER_SFD) {
+      size_t lim = _d->cap - idx;
+      if (lim > avail) {
+        lim = avail;
+      }
+      size_t skip = (size_t)(L2Deframer_find_sfd(p, p + lim) - p);
+      _d->stats.resync_bytes += skip;
+      _d->scan += skip;
+      continue;
+    }
+    if (avail < L2DEFRAMER_FRAME_BYTES) {
+      break;
+    }
+
+    const L2Frame *frame = (const L2Frame *)p;
+    if (frame->EFD != MAGIC_L2LAYER_EFD) {
+      _d->stats.bad_efd++;
+      _d->stats.resync_bytes++;
+      _d->scan++;
+      continue;
+    }
+    if (_d->check_fcs && !L2CRC32_check(frame)) {
+      _d->stats.bad_fcs++;
+      _d->stats.resync_bytes++;
+      _d->scan++;
+      continue;
+    }
+
+    _out[n++] = frame;
+    _d->scan += L2DEFRAMER_FRAME_BYTES;
+  }
+
+  _d->stats.frames += n;
+  _d->views += n;
+  if (_d->views == 0) {
+    /* nothing handed out: skipped garbage can be reused right away */
+    _d->tail = _d->scan;
+  }
+  return n;
+}
@@ -0,0 +1,109 @@
+/*
+ * File:        src/L2_deframer.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Streaming zero-copy L2 deframer for Radio_ORBIT.
+ *    Takes arbitrary byte chunks from a serial/SPI link, finds L2 frame
+ *    boundaries (SFD .. EFD + FCS) and hands out const L2Frame* views
+ *    that point straight into its ring buffer.
+ *
+ *
+ *  Ring layout (cap is a power of 2, mirror is 223 bytes):
+ *
+ *  +---------------------------- cap ----------------------------+-- mirror --+
+ *  | ... [ released ][ scanned, views alive ][ unscanned ][ free ] copy of 0..|
+ *  +-------------------------------------------------------------+------------+
+ *             tail ^                   scan ^          head ^
+ *
+ *  Bytes written to ring[0 .. 222] are also copied to ring[cap .. cap+222],
+ *  so a frame starting anywhere in [0, cap) is always contiguous in memory.
+ *
+ *
+ *  Resync: on a bad candidate (EFD or FCS mismatch) the scanner skips one
+ *  byte and searches for the next MAGIC_L2LAYER_SFD with a SIMD scan.
+ *
+ * NOTE:
+ *   - One deframer per port; not thread safe.
+ *   - Views returned by L2Deframer_poll() stay valid until L2Deframer_release().
+ *
+ */
+
+#ifndef L2_DEFRAMER_H
+#define L2_DEFRAMER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2DEFRAMER_FRAME_BYTES  sizeof(L2Frame)
+#define L2DEFRAMER_MIRROR_BYTES (L2DEFRAMER_FRAME_BYTES - 1)
+
+
+typedef struct {
+  uint64_t frames;        // valid frames handed out
+  uint64_t bad_efd;       // SFD candidates rejected by EFD
+  uint64_t bad_fcs;       // SFD candidates rejected by CRC32
+  uint64_t resync_bytes;  // bytes skipped while searching for SFD
+} L2DeframerStats_t;
+
+
+typedef struct {
+  uint8_t *ring;          // cap + L2DEFRAMER_MIRROR_BYTES
+  size_t   cap;           // power of 2, >= 2 frames
+  size_t   mask;
+  uint64_t head;          // total bytes written
+  uint64_t scan;          // total bytes parsed
+  uint64_t tail;          // total bytes released
+  size_t   views;         // views handed out since the last release
+  bool     check_fcs;     // verify CRC32 before handing out a frame
+  L2DeframerStats_t stats;
+} L2Deframer_t;
+
+
+/* _cap is rounded up to a power of 2. Returns 0, or -1 on allocation failure. */
+int  L2Deframer_init(L2Deframer_t *_d, size_t _cap, bool _check_fcs);
+void L2Deframer_free(L2Deframer_t *_d);
+void L2Deframer_reset(L2Deframer_t *_d);
+
+/* Free bytes before the writer would overwrite unreleased data */
+static inline size_t L2Deframer_space(const L2Deframer_t *_d) {
+  return _d->cap - (size_t)(_d->head - _d->tail);
+}
+
+/* Copy in a chunk. Returns bytes accepted (short when the ring is full). */
+size_t L2Deframer_push(L2Deframer_t *_d, const uint8_t *_chunk, size_t _len);
+
+/*
+ * Zero-copy write: get a contiguous writable region (e.g. for read(2)),
+ * then commit the number of bytes actually written.
+ */
+uint8_t *L2Deframer_wbuf(L2Deframer_t *_d, size_t *_len);
+void     L2Deframer_commit(L2Deframer_t *_d, size_t _len);
+
+/* Find up to _max frames. Returns the number of views stored in _out. */
+size_t L2Deframer_poll(L2Deframer_t *_d, const L2Frame **_out, size_t _max);
+
+/* Give back every view handed out so far */
+static inline void L2Deframer_release(L2Deframer_t *_d) {
+  _d->tail = _d->scan;
+  _d->views = 0;
+}
+
+/* Exposed for reuse: first MAGIC_L2LAYER_SFD in [_p, _end), or _end */
+const uint8_t *L2Deframer_find_sfd(const uint8_t *_p, const uint8_t *_end);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2_DEFRAMER_H
@@ -0,0 +1,471 @@
+/*
+ * File:        src/L2_fec.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2 DataLink layer FEC (Reed-Solomon erasure code) for Radio_ORBIT.
+ *    See L2_fec.h
+ *
+ */
+
+#include "L2_fec.h"
+#include "L2_crc32.h"
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define L2FEC_HAVE_X86 1
+#endif
+
+#if defined(__aarch64__)
+  #include <arm_neon.h>
+  #define L2FEC_HAVE_NEON 1
+#endif
+
+#define GF_POLY 0x11D                     // x^8 + x^4 + x^3 + x^2 + 1, generator 2
+
+
+typedef void (*fec_kernel_fn)(uint8_t *, const uint8_t *, uint8_t, size_t);
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static uint8_t gf_mul_table[256][256];
+static uint8_t gf_nib[256][32] __attribute__((aligned(32)));   // c * x, c * (x << 4), x = 0 .. 15
+static uint8_t fec_cauchy[L2FEC_MAX_FRAMES][L2FEC_MAX_FRAMES];
+static pthread_once_t fec_table_once = PTHREAD_ONCE_INIT;
+
+static fec_kernel_fn fec_kernel = NULL;
+static L2FEC_impl_t  fec_kernel_impl = L2FEC_IMPL_AUTO;
+
+
+static void fec_table_init(void) {
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < 255; i++) {
+    gf_exp[i] = (uint8_t)x;
+    gf_log[x] = (uint8_t)i;
+    x <<= 1;
+    if (x & 0x100) {
+      x ^= GF_POLY;
+    }
+  }
+  for (uint32_t i = 255; i < 512; i++) {
+    gf_exp[i] = gf_exp[i - 255];
+  }
+  for (uint32_t a = 1; a < 256; a++) {
+    for (uint32_t b = 1; b < 256; b++) {
+      gf_mul_table[a][b] = gf_exp[gf_log[a] + gf_log[b]];
+    }
+  }
+  for (uint32_t c = 0; c < 256; c++) {
+    for (uint32_t n = 0; n < 16; n++) {
+      gf_nib[c][n] = gf_mul_table[c][n];
+      gf_nib[c][16 + n] = gf_mul_table[c][n << 4];
+    }
+  }
+  for (uint32_t j = 0; j < L2FEC_MAX_FRAMES; j++) {
+    for (uint32_t i = 0; i < L2FEC_MAX_FRAMES; i++) {
+      uint8_t v = (uint8_t)((L2FEC_MAX_FRAMES + j) ^ i);
+      fec_cauchy[j][i] = gf_exp[255 - gf_log[v]];
+    }
+  }
+}
+
+
+/* ------------------------------- scalar -------------------------------- */
+
+static void fec_scalar(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  const uint8_t *row = gf_mul_table[c];
+  for (size_t i = 0; i < len; i++) {
+    dst[i] ^= row[src[i]];
+  }
+}
+
+
+/* ---------------------------- SSSE3 / AVX2 ----------------------------- */
+
+#ifdef L2FEC_HAVE_X86
+
+__attribute__((target("ssse3")))
+static void fec_ssse3(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  const __m128i lo = _mm_load_si128((const __m128i *)gf_nib[c]);
+  const __m128i hi = _mm_load_si128((const __m128i *)(gf_nib[c] + 16));
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i l = _mm_and_si128(s, mask);
+    __m128i h = _mm_and_si128(_mm_srli_epi64(s, 4), mask);
+    __m128i p = _mm_xor_si128(_mm_shuffle_epi8(lo, l), _mm_shuffle_epi8(hi, h));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(dst + i)), p));
+  }
+  fec_scalar(dst + i, src + i, c, len - i);
+}
+
+static bool fec_ssse3_supported(void) {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("ssse3");
+}
+
+__attribute__((target("avx2")))
+static void fec_avx2(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)gf_nib[c]));
+  const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)(gf_nib[c] + 16)));
+  const __m256i mask = _mm256_set1_epi8(0x0F);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i l = _mm256_and_si256(s, mask);
+    __m256i h = _mm256_and_si256(_mm256_srli_epi64(s, 4), mask);
+    __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(lo, l), _mm256_shuffle_epi8(hi, h));
+    _mm256_storeu_si256((__m256i *)(dst + i),
+                        _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(dst + i)), p));
+  }
+  /* 216 = 6 x 32 + 24: one 16-byte step (VEX encoded here, no SSE
+   * transition) before the scalar tail */
+  for (; i + 16 <= len; i += 16) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i l = _mm_and_si128(s, _mm256_castsi256_si128(mask));
+    __m128i h = _mm_and_si128(_mm_srli_epi64(s, 4), _mm256_castsi256_si128(mask));
+    __m128i p = _mm_xor_si128(_mm_shuffle_epi8(_mm256_castsi256_si128(lo), l),
+                              _mm_shuffle_epi8(_mm256_castsi256_si128(hi), h));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(dst + i)), p));
+  }
+  fec_scalar(dst + i, src + i, c, len - i);
+}
+
+static bool fec_avx2_supported(void) {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif // L2FEC_HAVE_X86
+
+
+/* -------------------------------- NEON --------------------------------- */
+
+#ifdef L2FEC_HAVE_NEON
+
+static void fec_neon(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  const uint8x16_t lo = vld1q_u8(gf_nib[c]);
+  const uint8x16_t hi = vld1q_u8(gf_nib[c] + 16);
+  const uint8x16_t mask = vdupq_n_u8(0x0F);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t s = vld1q_u8(src + i);
+    uint8x16_t p = veorq_u8(vqtbl1q_u8(lo, vandq_u8(s, mask)), vqtbl1q_u8(hi, vshrq_n_u8(s, 4)));
+    vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), p));
+  }
+  fec_scalar(dst + i, src + i, c, len - i);
+}
+
+#endif // L2FEC_HAVE_NEON
+
+
+/* ---------------------------- dispatch -------------------------------- */
+
+static fec_kernel_fn fec_resolve(L2FEC_impl_t *impl) {
+  switch (*impl) {
+    case L2FEC_IMPL_SCALAR:
+      return fec_scalar;
+#ifdef L2FEC_HAVE_X86
+    case L2FEC_IMPL_SSSE3:
+      return fec_ssse3_supported() ? fec_ssse3 : NULL;
+    case L2FEC_IMPL_AVX2:
+      return fec_avx2_supported() ? fec_avx2 : NULL;
+#endif
+#ifdef L2FEC_HAVE_NEON
+    case L2FEC_IMPL_NEON:
+      return fec_neon;                    // baseline on aarch64
+#endif
+    case L2FEC_IMPL_AUTO:
+#ifdef L2FEC_HAVE_X86
+      if (fec_avx2_supported()) {
+        *impl = L2FEC_IMPL_AVX2;
+        return fec_avx2;
+      }
+      if (fec_ssse3_supported()) {
+        *impl = L2FEC_IMPL_SSSE3;
+        return fec_ssse3;
+      }
+#endif
+#ifdef L2FEC_HAVE_NEON
+      *impl = L2FEC_IMPL_NEON;
+      return fec_neon;
+#endif
+      *impl = L2FEC_IMPL_SCALAR;
+      return fec_scalar;
+    default:
+      return NULL;
+  }
+}
+
+int L2FEC_select(L2FEC_impl_t _impl) {
+  pthread_once(&fec_table_once, fec_table_init);
+  fec_kernel_fn fn = fec_resolve(&_impl);
+  if (fn == NULL) {
+    return -1;
+  }
+  __atomic_store_n(&fec_kernel_impl, _impl, __ATOMIC_RELAXED);
+  __atomic_store_n(&fec_kernel, fn, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static inline fec_kernel_fn fec_get_kernel(void) {
+  fec_kernel_fn fn = __atomic_load_n(&fec_kernel, __ATOMIC_ACQUIRE);
+  if (__builtin_expect(fn == NULL, 0)) {
+    L2FEC_select(L2FEC_IMPL_AUTO);
+    fn = __atomic_load_n(&fec_kernel, __ATOMIC_ACQUIRE);
+  }
+  return fn;
+}
+
+L2FEC_impl_t L2FEC_active(void) {
+  fec_get_kernel();
+  return __atomic_load_n(&fec_kernel_impl, __ATOMIC_RELAXED);
+}
+
+const char *L2FEC_impl_name(L2FEC_impl_t _impl) {
+  switch (_impl) {
+    case L2FEC_IMPL_AUTO:   return "auto";
+    case L2FEC_IMPL_SCALAR: return "scalar";
+    case L2FEC_IMPL_SSSE3:  return "ssse3";
+    case L2FEC_IMPL_AVX2:   return "avx2";
+    case L2FEC_IMPL_NEON:   return "neon";
+  }
+  return "unknown";
+}
+
+uint8_t L2FEC_gf_mul(uint8_t _a, uint8_t _b) {
+  pthread_once(&fec_table_once, fec_table_init);
+  return gf_mul_table[_a][_b];
+}
+
+uint8_t L2FEC_gf_inv(uint8_t _a) {
+  pthread_once(&fec_table_once, fec_table_init);
+  return _a != 0 ? gf_exp[255 - gf_log[_a]] : 0;
+}
+
+void L2FEC_mul_add(uint8_t *_dst, const uint8_t *_src, uint8_t _c, size_t _len) {
+  fec_get_kernel()(_dst, _src, _c, _len);
+}
+
+
+/* ------------------------------- encoder ------------------------------- */
+
+static void fec_seal(L2Frame *_f, uint8_t _gid, uint8_t _k, uint8_t _idx) {
+  _f->SFD = MAGIC_L2LAYER_SFD;
+  _f->TAG[0] = (uint8_t)(MAGIC_L2LAYER_TAG_FEC | (_gid & 0x0F));
+  _f->TAG[1] = (uint8_t)(((_k - 1) << 4) | _idx);
+  _f->EFD = MAGIC_L2LAYER_EFD;
+  L2CRC32_seal(_f);
+}
+
+int L2FecEnc_init(L2FecEnc_t *_e, uint8_t _k, uint8_t _m) {
+  memset(_e, 0, sizeof(*_e));
+  if (_k == 0 || _m == 0 || _k + _m > L2FEC_MAX_FRAMES) {
+    return -1;
+  }
+  _e->k = _k;
+  _e->m = _m;
+  fec_get_kernel();
+  return 0;
+}
+
+static uint32_t fec_enc_close(L2FecEnc_t *_e) {
+  /* parity of the closed group stays readable until the next push */
+  _e->closed_k = _e->count;
+  _e->groups++;
+  _e->count = 0;
+  return _e->m;
+}
+
+uint32_t L2FecEnc_push(L2FecEnc_t *_e, L2Frame *_frame) {
+  fec_kernel_fn fn = fec_get_kernel();
+  if (_e->count == 0) {
+    if (_e->groups != 0) {
+      _e->gid = (uint8_t)((_e->gid + 1) & 0x0F);
+    }
+    memset(_e->parity, 0, (size_t)_e->m * L2FEC_BYTES);
+  }
+  uint8_t idx = _e->count++;
+  fec_seal(_frame, _e->gid, _e->k, idx);
+  for (uint32_t j = 0; j < _e->m; j++) {
+    fn(_e->parity[j], _frame->Payload, fec_cauchy[j][idx], L2FEC_BYTES);
+  }
+  return _e->count == _e->k ? fec_enc_close(_e) : 0;
+}
+
+uint32_t L2FecEnc_flush(L2FecEnc_t *_e) {
+  if (_e->count == 0) {
+    return 0;
+  }
+  _e->short_groups++;
+  return fec_enc_close(_e);
+}
+
+void L2FecEnc_parity(const L2FecEnc_t *_e, uint32_t _j, L2Frame *_out) {
+  memcpy(_out->Payload, _e->parity[_j], L2FEC_BYTES);
+  fec_seal(_out, _e->gid, _e->closed_k, (uint8_t)(_e->closed_k + _j));
+}
+
+
+/* ------------------------------- decoder ------------------------------- */
+
+void L2FecDec_init(L2FecDec_t *_d, L2FecDeliverFn_t _deliver, void *_ctx) {
+  memset(_d, 0, sizeof(*_d));
+  _d->deliver = _deliver;
+  _d->ctx = _ctx;
+  fec_get_kernel();
+}
+
+static void fec_dec_close(L2FecDec_t *_d) {
+  if (_d->open && !_d->done && _d->k_known) {
+    _d->unrecoverable++;
+  }
+  _d->open = false;
+}
+
+/* invert the _n x _n matrix _a in place, Gauss-Jordan; Cauchy rows never leave a zero pivot */
+static void fec_invert(uint8_t _a[L2FEC_MAX_FRAMES][L2FEC_MAX_FRAMES], uint32_t _n) {
+  uint8_t inv[L2FEC_MAX_FRAMES][L2FEC_MAX_FRAMES];
+  memset(inv, 0, sizeof(inv));
+  for (uint32_t i = 0; i < _n; i++) {
+    inv[i][i] = 1;
+  }
+  for (uint32_t col = 0; col < _n; col++) {
+    uint32_t piv = col;
+    while (_a[piv][col] == 0) {
+      piv++;
+    }
+    if (piv != col) {
+      for (uint32_t c = 0; c < _n; c++) {
+        uint8_t t = _a[col][c];
+        _a[col][c] = _a[piv][c];
+        _a[piv][c] = t;
+        t = inv[col][c];
+        inv[col][c] = inv[piv][c];
+        inv[piv][c] = t;
+      }
+    }
+    const uint8_t *scale = gf_mul_table[gf_exp[255 - gf_log[_a[col][col]]]];
+    for (uint32_t c = 0; c < _n; c++) {
+      _a[col][c] = scale[_a[col][c]];
+      inv[col][c] = scale[inv[col][c]];
+    }
+    for (uint32_t r = 0; r < _n; r++) {
+      uint8_t f = _a[r][col];
+      if (r == col || f == 0) {
+        continue;
+      }
+      for (uint32_t c = 0; c < _n; c++) {
+        _a[r][c] ^= gf_mul_table[f][_a[col][c]];
+        inv[r][c] ^= gf_mul_table[f][inv[col][c]];
+      }
+    }
+  }
+  memcpy(_a, inv, sizeof(inv));
+}
+
+static void fec_dec_try(L2FecDec_t *_d) {
+  uint32_t k = _d->k;
+  uint16_t data_mask = (uint16_t)((1u << k) - 1);
+  uint32_t missing = k - (uint32_t)__builtin_popcount(_d->have & data_mask);
+  if (missing == 0) {
+    _d->done = true;
+    return;
+  }
+  if ((uint32_t)__builtin_popcount(_d->have & ~data_mask) < missing) {
+    return;
+  }
+  fec_kernel_fn fn = fec_get_kernel();
+  uint8_t lost[L2FEC_MAX_FRAMES], row[L2FEC_MAX_FRAMES];
+  uint8_t syn[L2FEC_MAX_FRAMES][L2FEC_BYTES];
+  uint8_t a[L2FEC_MAX_FRAMES][L2FEC_MAX_FRAMES];
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < k; i++) {
+    if (!(_d->have & (1u << i))) {
+      lost[n++] = (uint8_t)i;
+    }
+  }
+  n = 0;
+  for (uint32_t idx = k; idx < L2FEC_MAX_FRAMES && n < missing; idx++) {
+    if (_d->have & (1u << idx)) {
+      row[n++] = (uint8_t)(idx - k);
+    }
+  }
+  /* syndromes: parity less what the frames we have put in */
+  for (uint32_t t = 0; t < missing; t++) {
+    memcpy(syn[t], _d->frame[k + row[t]], L2FEC_BYTES);
+    for (uint32_t i = 0; i < k; i++) {
+      if (_d->have & (1u << i)) {
+        fn(syn[t], _d->frame[i], fec_cauchy[row[t]][i], L2FEC_BYTES);
+      }
+    }
+    for (uint32_t r = 0; r < missing; r++) {
+      a[t][r] = fec_cauchy[row[t]][lost[r]];
+    }
+  }
+  fec_invert(a, missing);
+  L2Frame out;
+  for (uint32_t r = 0; r < missing; r++) {
+    uint8_t *dst = _d->frame[lost[r]];
+    memset(dst, 0, L2FEC_BYTES);
+    for (uint32_t t = 0; t < missing; t++) {
+      fn(dst, syn[t], a[r][t], L2FEC_BYTES);
+    }
+    _d->have |= (uint16_t)(1u << lost[r]);
+    _d->recovered++;
+    memcpy(out.Payload, dst, L2FEC_BYTES);
+    fec_seal(&out, _d->gid, _d->data_k != 0 ? _d->data_k : (uint8_t)k, lost[r]);
+    _d->deliver(_d->ctx, &out);
+  }
+  _d->done = true;
+}
+
+L2FecResult_t L2FecDec_push(L2FecDec_t *_d, const L2Frame *_frame) {
+  if (!L2FEC_is_fec(_frame)) {
+    return L2FEC_PLAIN;
+  }
+  uint8_t gid = L2FEC_gid(_frame), k = L2FEC_k(_frame), idx = L2FEC_idx(_frame);
+  bool parity = idx >= k;
+  if (!_d->open || gid != _d->gid) {
+    fec_dec_close(_d);
+    _d->open = true;
+    _d->done = false;
+    _d->gid = gid;
+    _d->k = k;
+    _d->k_known = false;
+    _d->data_k = 0;
+    _d->have = 0;
+  }
+  /* data frames carry the K the group was opened with, parity the K it closed with */
+  if ((parity && _d->k_known && k != _d->k) || (!parity && (_d->k_known ? idx >= _d->k : k < _d->k))) {
+    _d->bad_tag++;
+    return L2FEC_BAD;
+  }
+  if (parity) {
+    _d->parity++;
+    if (!_d->k_known) {
+      uint16_t beyond = (uint16_t)(_d->have & ~((1u << k) - 1));
+      if (beyond != 0) {
+        _d->bad_tag++;                    // data frames past the K this parity claims
+        return L2FEC_BAD;
+      }
+      _d->k = k;
+      _d->k_known = true;
+    }
+  } else {
+    _d->data++;
+    _d->data_k = k;
+  }
+  if (!_d->done && !(_d->have & (1u << idx))) {
+    memcpy(_d->frame[idx], _frame->Payload, L2FEC_BYTES);
+    _d->have |= (uint16_t)(1u << idx);
+    if (_d->k_known) {
+      fec_dec_try(_d);
+    }
+  }
+  return parity ? L2FEC_PARITY : L2FEC_DATA;
+}
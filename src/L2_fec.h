@@ -0,0 +1,188 @@
+/*
+ * File:        src/L2_fec.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L2 DataLink layer FEC (Reed-Solomon erasure code) for Radio_ORBIT.
+ *    k data frames are followed by m parity frames; any k of the k + m
+ *    rebuild the group. A frame that fails the CRC32 is an erasure, so a
+ *    bit error costs a local rebuild instead of a multi-hop resend.
+ *
+ *    Kernels (GF(256) region multiply-add, picked at runtime):
+ *      - scalar 64 KB product table (any CPU)
+ *      - SSSE3 / AVX2 PSHUFB nibble tables (x86_64)
+ *      - NEON TBL nibble tables (aarch64)
+ *
+ *
+ *  FEC TAG (L2Frame.TAG, every frame of a group, data and parity):
+ *
+ * | Bits          | 15..12 | 11..8 |  7..4  |  3..0  |
+ * ---------------------------------------------------
+ * | Field         |  0xF   |  Gid  | K - 1  |  Idx   |
+ *
+ *  Gid: group number mod 16. Idx < K: data frame Idx, payload as sent
+ *  (an L2.5 frame, delivered as is). Idx >= K: parity row Idx - K,
+ *  payload = sum over data i of C[Idx - K][i] * payload i, with
+ *  C[j][i] = 1 / ((16 + j) ^ i) in GF(2^8) / 0x11D (Cauchy: every
+ *  square submatrix invertible, so any K frames decode). C does not
+ *  depend on K, so a group flushed after n < K data frames just sends
+ *  its parity with K = n.
+ *
+ *  Plain frames (TAG[0] high nibble != 0xF) pass through untouched.
+ *
+ * NOTE:
+ *   - K + M <= 16. A group goes out as one burst; the decoder holds one
+ *     open group per port and a frame of another Gid closes it.
+ *   - Parity covers the 216-byte Payload; rebuilt frames get SFD, TAG,
+ *     FCS and EFD again.
+ *
+ */
+
+#ifndef L2_FEC_H
+#define L2_FEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define MAGIC_L2LAYER_TAG_FEC 0xF0        // TAG[0] high nibble: FEC group member
+
+#define L2FEC_MAX_FRAMES 16               // K + M
+#define L2FEC_BYTES      216              // coded bytes per frame (Payload)
+
+
+typedef enum {
+  L2FEC_IMPL_AUTO = 0,
+  L2FEC_IMPL_SCALAR,
+  L2FEC_IMPL_SSSE3,
+  L2FEC_IMPL_AVX2,
+  L2FEC_IMPL_NEON
+} L2FEC_impl_t;
+
+
+/* Select a kernel. AUTO picks the fastest one supported by this CPU.
+ * Returns 0 on success, -1 if the kernel is not available here. */
+int L2FEC_select(L2FEC_impl_t _impl);
+
+/* Currently selected kernel */
+L2FEC_impl_t L2FEC_active(void);
+const char *L2FEC_impl_name(L2FEC_impl_t _impl);
+
+/* GF(256) */
+uint8_t L2FEC_gf_mul(uint8_t _a, uint8_t _b);
+uint8_t L2FEC_gf_inv(uint8_t _a);
+
+/* _dst[i] ^= _c * _src[i] with the selected kernel */
+void L2FEC_mul_add(uint8_t *_dst, const uint8_t *_src, uint8_t _c, size_t _len);
+
+
+static inline bool L2FEC_is_fec(const L2Frame *_frame) {
+  return (_frame->TAG[0] & 0xF0) == MAGIC_L2LAYER_TAG_FEC;
+}
+
+static inline uint8_t L2FEC_gid(const L2Frame *_frame) {
+  return _frame->TAG[0] & 0x0F;
+}
+
+static inline uint8_t L2FEC_k(const L2Frame *_frame) {
+  return (uint8_t)((_frame->TAG[1] >> 4) + 1);
+}
+
+static inline uint8_t L2FEC_idx(const L2Frame *_frame) {
+  return _frame->TAG[1] & 0x0F;
+}
+
+
+/* ------------------------------- encoder ------------------------------- */
+
+typedef struct {
+  uint8_t  k;
+  uint8_t  m;
+  uint8_t  gid;
+  uint8_t  count;                         // data frames in the open group
+  uint8_t  closed_k;                      // K of the group whose parity is due
+  uint8_t  parity[L2FEC_MAX_FRAMES][L2FEC_BYTES];
+
+  uint64_t groups;
+  uint64_t short_groups;                  // flushed before k data frames
+} L2FecEnc_t;
+
+
+/* _k data + _m parity frames per group, _k >= 1, _m >= 1, _k + _m <= 16. 0 or -1. */
+int L2FecEnc_init(L2FecEnc_t *_e, uint8_t _k, uint8_t _m);
+
+/*
+ * Stamps the FEC TAG on data frame _frame, seals its FCS (SFD / EFD set
+ * too) and adds it to the group's parity. Returns the parity frames now
+ * due: 0, or m when the group is full (fetch them with L2FecEnc_parity
+ * before the next push).
+ */
+uint32_t L2FecEnc_push(L2FecEnc_t *_e, L2Frame *_frame);
+
+/* Closes a partial group (e.g. a TX deadline). Returns parity frames due, 0 if the group is empty. */
+uint32_t L2FecEnc_flush(L2FecEnc_t *_e);
+
+/* Parity frame _j (0 .. m - 1) of the group just closed, sealed */
+void L2FecEnc_parity(const L2FecEnc_t *_e, uint32_t _j, L2Frame *_out);
+
+
+/* ------------------------------- decoder ------------------------------- */
+
+/*
+ * A data frame rebuilt from parity, sealed like the original: TAG K is the
+ * one the group's data frames carry. Only when none of them arrived (a
+ * short group lost whole) is it the K the parity carries.
+ */
+typedef void (*L2FecDeliverFn_t)(void *_ctx, const L2Frame *_frame);
+
+typedef struct {
+  bool             open;
+  bool             done;                  // rebuilt or nothing missing, later frames ignored
+  uint8_t          gid;
+  uint8_t          k;                     // from a parity frame; data frames give an upper bound
+  bool             k_known;
+  uint8_t          data_k;                // K the data frames were sealed with, 0 until one arrives
+  uint16_t         have;                  // bit Idx
+  uint8_t          frame[L2FEC_MAX_FRAMES][L2FEC_BYTES];
+  L2FecDeliverFn_t deliver;
+  void            *ctx;
+
+  uint64_t         data;                  // data frames seen
+  uint64_t         parity;                // parity frames seen
+  uint64_t         recovered;             // data frames rebuilt
+  uint64_t         unrecoverable;         // groups closed with data missing
+  uint64_t         bad_tag;               // Idx / K out of range or inconsistent
+} L2FecDec_t;
+
+
+typedef enum {
+  L2FEC_PLAIN = 0,                        // not an FEC frame, pass it on
+  L2FEC_DATA,                             // data frame, pass it on
+  L2FEC_PARITY,                           // parity frame, consumed
+  L2FEC_BAD                               // malformed FEC TAG, drop
+} L2FecResult_t;
+
+
+void L2FecDec_init(L2FecDec_t *_d, L2FecDeliverFn_t _deliver, void *_ctx);
+
+/*
+ * One frame that passed its FCS check. Frames lost or failing the FCS
+ * are simply not pushed. Rebuilt data frames go to the deliver callback
+ * (possibly from inside this call, after the frame that completed them).
+ */
+L2FecResult_t L2FecDec_push(L2FecDec_t *_d, const L2Frame *_frame);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2_FEC_H
@@ -0,0 +1,120 @@
+/*
+ * File:        src/L2_pool.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Fixed-size frame buffer pool for Radio_ORBIT.
+ *    See L2_pool.h
+ *
+ */
+
+#include "L2_pool.h"
+#include <stdlib.h>
+
+
+static inline uint64_t top_pack(uint32_t _tag, uint32_t _idx) {
+  return ((uint64_t)_tag << 32) | _idx;
+}
+
+/* Push the chain _first .. _last (already linked through next) in one CAS */
+static void stack_push_chain(L2Pool_t *_p, uint32_t _first, uint32_t _last, uint32_t _n) {
+  uint64_t top = atomic_load_explicit(&_p->top, memory_order_relaxed);
+  for (;;) {
+    atomic_store_explicit(&_p->bufs[_last].next, (uint32_t)top, memory_order_relaxed);
+    if (atomic_compare_exchange_weak_explicit(&_p->top, &top, top_pack((uint32_t)(top >> 32) + 1, _first),
+                                              memory_order_release, memory_order_relaxed)) {
+      break;
+    }
+  }
+  atomic_fetch_add_explicit(&_p->free_count, _n, memory_order_relaxed);
+}
+
+/*
+ * Detach up to _max buffers from the top in one CAS; indices to _out.
+ * The walk may follow stale links of buffers popped meanwhile; the tag
+ * makes that CAS fail and the walk restarts from the new top.
+ */
+static uint32_t stack_pop_chain(L2Pool_t *_p, uint32_t *_out, uint32_t _max) {
+  uint64_t top = atomic_load_explicit(&_p->top, memory_order_acquire);
+  for (;;) {
+    uint32_t n = 0, idx = (uint32_t)top;
+    while (n < _max && idx < _p->count) {
+      _out[n++] = idx;
+      idx = atomic_load_explicit(&_p->bufs[idx].next, memory_order_relaxed);
+    }
+    if (n == 0) {
+      return 0;
+    }
+    if (atomic_compare_exchange_weak_explicit(&_p->top, &top, top_pack((uint32_t)(top >> 32) + 1, idx),
+                                              memory_order_acquire, memory_order_acquire)) {
+      atomic_fetch_sub_explicit(&_p->free_count, n, memory_order_relaxed);
+      return n;
+    }
+  }
+}
+
+
+int L2Pool_init(L2Pool_t *_p, uint32_t _count) {
+  memset(_p, 0, sizeof(*_p));
+  if (_count == 0 || _count >= L2POOL_NIL) {
+    return -1;
+  }
+  _p->bufs = aligned_alloc(64, (size_t)_count * sizeof(L2PoolBuf_t));
+  if (_p->bufs == NULL) {
+    return -1;
+  }
+  memset(_p->bufs, 0, (size_t)_count * sizeof(L2PoolBuf_t));
+  for (uint32_t i = 0; i < _count; i++) {
+    _p->bufs[i].index = i;
+    atomic_init(&_p->bufs[i].refcnt, 0);
+    atomic_init(&_p->bufs[i].next, i + 1 < _count ? i + 1 : L2POOL_NIL);
+  }
+  _p->count = _count;
+  atomic_init(&_p->top, top_pack(0, 0));
+  atomic_init(&_p->free_count, _count);
+  atomic_init(&_p->exhausted, 0);
+  return 0;
+}
+
+void L2Pool_free(L2Pool_t *_p) {
+  free(_p->bufs);
+  memset(_p, 0, sizeof(*_p));
+}
+
+
+void L2PoolCache_init(L2PoolCache_t *_c, L2Pool_t *_p) {
+  _c->pool = _p;
+  _c->count = 0;
+}
+
+uint32_t L2PoolCache_refill(L2PoolCache_t *_c) {
+  if (_c->count < L2POOL_BATCH) {
+    _c->count += stack_pop_chain(_c->pool, _c->idx + _c->count, L2POOL_BATCH - _c->count);
+  }
+  if (_c->count == 0) {
+    atomic_fetch_add_explicit(&_c->pool->exhausted, 1, memory_order_relaxed);
+  }
+  return _c->count;
+}
+
+static void cache_release(L2PoolCache_t *_c, uint32_t _n) {
+  L2Pool_t *p = _c->pool;
+  uint32_t base = _c->count - _n;
+  for (uint32_t i = base; i + 1 < _c->count; i++) {
+    atomic_store_explicit(&p->bufs[_c->idx[i]].next, _c->idx[i + 1], memory_order_relaxed);
+  }
+  stack_push_chain(p, _c->idx[base], _c->idx[_c->count - 1], _n);
+  _c->count = base;
+}
+
+void L2PoolCache_spill(L2PoolCache_t *_c) {
+  cache_release(_c, L2POOL_BATCH);
+}
+
+void L2PoolCache_flush(L2PoolCache_t *_c) {
+  if (_c->count != 0) {
+    cache_release(_c, _c->count);
+  }
+}
@@ -0,0 +1,155 @@
+/*
+ * File:        src/L2_pool.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Fixed-size frame buffer pool for Radio_ORBIT.
+ *    Preallocated, cache-line aligned L2Frame buffers with refcounted
+ *    handles and per-thread caches. One buffer carries a frame from RX
+ *    through decrypt, route and TX without copies; the L2.5 frame is the
+ *    L2 Payload, i.e. offset 3 of the same buffer.
+ *
+ *
+ *  Buffer (256 bytes = 4 cache lines, 64-byte aligned):
+ *
+ *  | Offset    | Field       |                                          |
+ *  ---------------------------------------------------------------------
+ *  | 0x00-0xDF | frame       | L2Frame (224), L2D5Frame_t at 0x03       |
+ *  | 0xE0-0xE3 | refcnt      | atomic; 0 while free                     |
+ *  | 0xE4-0xE7 | index       | slot number in the pool                  |
+ *  | 0xE8-0xEB | next        | free-stack link                          |
+ *  | 0xEC-0xFF | meta        | port, rssi, rx_time, next_hop, aux       |
+ *
+ *
+ *  Free buffers:
+ *
+ *   thread A cache [64] <--refill/spill 32--> global stack <--> thread B cache [64]
+ *
+ *  The global stack is a Treiber stack of slot indices with a 32-bit ABA
+ *  tag; caches move buffers to / from it in batches, one CAS per batch
+ *  either way (refill detaches a chain of up to 32, spill pushes one),
+ *  so the common get / put is a plain array access with no atomics.
+ *
+ * NOTE:
+ *   - L2PoolCache_t is owned by one thread; the pool itself is shared.
+ *   - A buffer freed on another thread simply lands in that thread's cache.
+ *   - No heap allocation after L2Pool_init().
+ *
+ */
+
+#ifndef L2_POOL_H
+#define L2_POOL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+#include "L2D5_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L2POOL_CACHE     64
+#define L2POOL_BATCH     (L2POOL_CACHE / 2)
+#define L2POOL_NIL       UINT32_MAX
+
+
+typedef struct {
+  _Alignas(64) L2Frame frame;
+  _Atomic uint32_t refcnt;
+  uint32_t         index;
+  _Atomic uint32_t next;
+  uint16_t         port;
+  int16_t          rssi;
+  uint64_t         rx_time;
+  uint32_t         next_hop;              // neighbor slot chosen by the route stage
+  uint32_t         aux;
+} L2PoolBuf_t;
+
+STATIC_ASSERT(sizeof(L2PoolBuf_t) == 256, L2PoolBuf_t_must_be_256_bytes);
+
+
+typedef struct {
+  L2PoolBuf_t     *bufs;
+  uint32_t         count;
+  _Alignas(64) _Atomic uint64_t top;     // tag << 32 | index
+  _Atomic uint32_t free_count;           // buffers on the global stack
+  _Atomic uint64_t exhausted;            // get() found nothing anywhere
+} L2Pool_t;
+
+
+typedef struct {
+  L2Pool_t *pool;
+  uint32_t  count;
+  uint32_t  idx[L2POOL_CACHE];
+} L2PoolCache_t;
+
+
+int  L2Pool_init(L2Pool_t *_p, uint32_t _count);
+void L2Pool_free(L2Pool_t *_p);
+
+void L2PoolCache_init(L2PoolCache_t *_c, L2Pool_t *_p);
+/* Hand every cached buffer back to the pool (thread exit) */
+void L2PoolCache_flush(L2PoolCache_t *_c);
+
+/* refill / spill slow paths */
+uint32_t L2PoolCache_refill(L2PoolCache_t *_c);
+void     L2PoolCache_spill(L2PoolCache_t *_c);
+
+
+/* Buffer with refcnt 1, or NULL when the pool is exhausted. Frame bytes are not cleared. */
+static inline L2PoolBuf_t *L2PoolCache_get(L2PoolCache_t *_c) {
+  if (_c->count == 0 && L2PoolCache_refill(_c) == 0) {
+    return NULL;
+  }
+  L2PoolBuf_t *b = &_c->pool->bufs[_c->idx[--_c->count]];
+  atomic_store_explicit(&b->refcnt, 1, memory_order_relaxed);
+  return b;
+}
+
+static inline void L2PoolBuf_ref(L2PoolBuf_t *_b) {
+  atomic_fetch_add_explicit(&_b->refcnt, 1, memory_order_relaxed);
+}
+
+/* Drop one reference; the last one returns the buffer to _c */
+static inline void L2PoolCache_put(L2PoolCache_t *_c, L2PoolBuf_t *_b) {
+  /* sole owner: nobody else can take a new reference, skip the locked RMW */
+  if (atomic_load_explicit(&_b->refcnt, memory_order_acquire) == 1) {
+    atomic_store_explicit(&_b->refcnt, 0, memory_order_relaxed);
+  } else if (atomic_fetch_sub_explicit(&_b->refcnt, 1, memory_order_acq_rel) != 1) {
+    return;
+  }
+  if (_c->count == L2POOL_CACHE) {
+    L2PoolCache_spill(_c);
+  }
+  _c->idx[_c->count++] = _b->index;
+}
+
+static inline L2D5Frame_t *L2PoolBuf_l2d5(L2PoolBuf_t *_b) {
+  return (L2D5Frame_t *)_b->frame.Payload;
+}
+
+static inline L2PoolBuf_t *L2PoolBuf_from_l2d5(L2D5Frame_t *_f) {
+  return (L2PoolBuf_t *)((uint8_t *)_f - offsetof(L2Frame, Payload));
+}
+
+/* RX helper: one copy out of a deframer view, then no more copies */
+static inline L2PoolBuf_t *L2PoolCache_get_copy(L2PoolCache_t *_c, const L2Frame *_src) {
+  L2PoolBuf_t *b = L2PoolCache_get(_c);
+  if (b != NULL) {
+    memcpy(&b->frame, _src, sizeof(L2Frame));
+  }
+  return b;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L2_POOL_H
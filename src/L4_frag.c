@@ -0,0 +1,322 @@
+/*
+ * File:        src/L4_frag.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L4 fragmentation and reassembly for Radio_ORBIT.
+ *    See L4_frag.h
+ *
+ */
+
+#include "L4_frag.h"
+#include "ORBIT_bytes.h"
+#include <stdlib.h>
+
+
+/* ------------------------------- sender -------------------------------- */
+
+int L4FragTx_init(L4FragTx_t *_tx, uint16_t _msg_id, uint8_t _port, const void *_msg, uint32_t _len) {
+  if (_len == 0 || _len > L4FRAG_MAX_MSG) {
+    return -1;
+  }
+  _tx->msg = _msg;
+  _tx->len = _len;
+  _tx->msg_id = _msg_id;
+  _tx->port = _port;
+  _tx->count = (uint16_t)L4Frag_count(_len);
+  _tx->next = 0;
+  return 0;
+}
+
+void L4FragTx_build(const L4FragTx_t *_tx, uint16_t _index, L4Frag_t *_out) {
+  uint32_t off = (uint32_t)_index * L4FRAG_DATA;
+  uint32_t n = _tx->len - off < L4FRAG_DATA ? _tx->len - off : L4FRAG_DATA;
+  ORBIT_store_be16(_out->MsgID, _tx->msg_id);
+  _out->Type = L4TYPE_DATA;
+  _out->Port = _tx->port;
+  ORBIT_store_be16(_out->FragIndex, _index);
+  ORBIT_store_be16(_out->FragCount, _tx->count);
+  ORBIT_store_be32(_out->TotalLen, _tx->len);
+  memcpy(_out->Data, _tx->msg + off, n);
+  memset(_out->Data + n, 0, L4FRAG_DATA - n);
+}
+
+
+/* ------------------------- open-addressed index ------------------------ */
+
+static inline uint32_t reasm_key(const uint8_t *_src, uint16_t _msg_id) {
+  return (uint32_t)L2D5ADDR_hash(_src) ^ ((uint32_t)_msg_id * 0x9E3779B1u);
+}
+
+static inline uint32_t ridx_home(const L4Reasm_t *_r, uint32_t _key) {
+  return L2D5ADDR_mix32(_key) & _r->idx_mask;
+}
+
+static void ridx_insert(L4Reasm_t *_r, uint32_t _key, uint32_t _slot) {
+  uint32_t i = ridx_home(_r, _key);
+  while (_r->idx[i].slot != L4REASM_NIL) {
+    i = (i + 1) & _r->idx_mask;
+  }
+  _r->idx[i].key = _key;
+  _r->idx[i].slot = _slot;
+}
+
+/* backward-shift deletion, same as the route index */
+static void ridx_remove(L4Reasm_t *_r, uint32_t _key, uint32_t _slot) {
+  L4ReasmIndexEntry_t *idx = _r->idx;
+  uint32_t mask = _r->idx_mask;
+  uint32_t i = ridx_home(_r, _key);
+  while (idx[i].slot != _slot) {
+    if (idx[i].slot == L4REASM_NIL) {
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  uint32_t j = i;
+  for (;;) {
+    j = (j + 1) & mask;
+    if (idx[j].slot == L4REASM_NIL) {
+      break;
+    }
+    uint32_t k = ridx_home(_r, idx[j].key);
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      idx[i] = idx[j];
+      i = j;
+    }
+  }
+  idx[i].slot = L4REASM_NIL;
+}
+
+static uint32_t reasm_find(const L4Reasm_t *_r, uint32_t _key, const uint8_t *_src, uint16_t _msg_id) {
+  uint32_t i = ridx_home(_r, _key);
+  for (;;) {
+    uint32_t s = _r->idx[i].slot;
+    if (s == L4REASM_NIL) {
+      return L4REASM_NIL;
+    }
+    if (_r->idx[i].key == _key && _r->e[s].msg_id == _msg_id && L2D5ADDR_equal(_r->e[s].src, _src)) {
+      return s;
+    }
+    i = (i + 1) & _r->idx_mask;
+  }
+}
+
+
+/* ------------------------------- entries ------------------------------- */
+
+static inline uint64_t *reasm_map(const L4Reasm_t *_r, uint32_t _s) {
+  return _r->map + (size_t)_s * _r->map_words;
+}
+
+static inline uint8_t *reasm_buf(const L4Reasm_t *_r, uint32_t _s) {
+  return _r->buf + (size_t)_s * _r->max_msg;
+}
+
+static void reasm_release(L4Reasm_t *_r, uint32_t _s) {
+  ORBITWheel_cancel(&_r->wheel, _s);
+  ridx_remove(_r, _r->e[_s].key, _s);
+  _r->e[_s].deadline = UINT64_MAX;
+  _r->next_free[_s] = _r->free_head;
+  _r->free_head = _s;
+}
+
+static uint32_t reasm_open(L4Reasm_t *_r, uint32_t _key, const uint8_t *_src, uint16_t _msg_id, uint8_t _port,
+                           uint16_t _count, uint32_t _total, uint64_t _now) {
+  if (_r->free_head == L4REASM_NIL) {
+    /* every entry busy: the one closest to timing out goes */
+    uint32_t victim = 0;
+    for (uint32_t s = 1; s < _r->capacity; s++) {
+      if (_r->e[s].deadline < _r->e[victim].deadline) {
+        victim = s;
+      }
+    }
+    _r->evicted++;
+    reasm_release(_r, victim);
+  }
+  uint32_t s = _r->free_head;
+  _r->free_head = _r->next_free[s];
+  _r->next_free[s] = s;
+
+  L4ReasmEntry_t *e = &_r->e[s];
+  memcpy(e->src, _src, 16);
+  e->msg_id = _msg_id;
+  e->port = _port;
+  e->count = _count;
+  e->have = 0;
+  e->total = _total;
+  e->key = _key;
+  e->deadline = _now + _r->timeout;
+  /* only the words this message uses */
+  memset(reasm_map(_r, s), 0, (size_t)((_count + 63) / 64) * sizeof(uint64_t));
+  ridx_insert(_r, _key, s);
+  ORBITWheel_schedule(&_r->wheel, s, e->deadline);
+  return s;
+}
+
+static bool reasm_recent(const L4Reasm_t *_r, const uint8_t *_src, uint16_t _msg_id) {
+  for (uint32_t i = 0; i < 2 * _r->capacity; i++) {
+    const L4ReasmDone_t *d = &_r->done[i];
+    if (d->used && d->msg_id == _msg_id && L2D5ADDR_equal(d->src, _src)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void reasm_expire(void *_ctx, uint32_t _id, uint64_t _now) {
+  (void)_now;
+  L4Reasm_t *r = _ctx;
+  r->expired++;
+  reasm_release(r, _id);
+}
+
+
+/* ------------------------------ lifecycle ------------------------------ */
+
+int L4Reasm_init(L4Reasm_t *_r, uint32_t _capacity, uint32_t _max_msg, uint64_t _timeout, uint64_t _tick,
+                 uint64_t _now, L4ReasmDeliverFn_t _deliver, void *_ctx) {
+  uint32_t idx_size = 16;
+  while (idx_size < _capacity * 2) {
+    idx_size <<= 1;
+  }
+  memset(_r, 0, sizeof(*_r));
+  if (_capacity == 0 || _max_msg == 0 || _max_msg > L4FRAG_MAX_MSG || _deliver == NULL ||
+      ORBITWheel_init(&_r->wheel, _capacity, _tick, _now) != 0) {
+    return -1;
+  }
+  _r->map_words = (L4Frag_count(_max_msg) + 63) / 64;
+  _r->e = malloc((size_t)_capacity * sizeof(L4ReasmEntry_t));
+  _r->buf = malloc((size_t)_capacity * _max_msg);
+  _r->map = malloc((size_t)_capacity * _r->map_words * sizeof(uint64_t));
+  _r->next_free = malloc((size_t)_capacity * sizeof(uint32_t));
+  _r->idx = malloc((size_t)idx_size * sizeof(L4ReasmIndexEntry_t));
+  _r->done = calloc((size_t)_capacity * 2, sizeof(L4ReasmDone_t));
+  if (_r->e == NULL || _r->buf == NULL || _r->map == NULL || _r->next_free == NULL || _r->idx == NULL ||
+      _r->done == NULL) {
+    L4Reasm_free(_r);
+    return -1;
+  }
+  for (uint32_t i = 0; i < idx_size; i++) {
+    _r->idx[i].slot = L4REASM_NIL;
+  }
+  for (uint32_t i = 0; i < _capacity; i++) {
+    _r->next_free[i] = i + 1 < _capacity ? i + 1 : L4REASM_NIL;
+    _r->e[i].deadline = UINT64_MAX;
+  }
+  _r->capacity = _capacity;
+  _r->max_msg = _max_msg;
+  _r->idx_mask = idx_size - 1;
+  _r->free_head = 0;
+  _r->timeout = _timeout;
+  _r->deliver = _deliver;
+  _r->ctx = _ctx;
+  return 0;
+}
+
+void L4Reasm_free(L4Reasm_t *_r) {
+  free(_r->e);
+  free(_r->buf);
+  free(_r->map);
+  free(_r->next_free);
+  free(_r->idx);
+  free(_r->done);
+  ORBITWheel_free(&_r->wheel);
+  memset(_r, 0, sizeof(*_r));
+}
+
+
+/* ------------------------------ receiving ------------------------------ */
+
+L4ReasmStatus_t L4Reasm_push(L4Reasm_t *_r, const uint8_t *_src, const L4Frag_t *_f, uint64_t _now) {
+  uint16_t msg_id = ORBIT_load_be16(_f->MsgID);
+  uint16_t index = ORBIT_load_be16(_f->FragIndex);
+  uint16_t count = ORBIT_load_be16(_f->FragCount);
+  uint32_t total = ORBIT_load_be32(_f->TotalLen);
+  if (_f->Type != L4TYPE_DATA || total == 0 || count != L4Frag_count(total) || index >= count) {
+    _r->bad++;
+    return L4REASM_BAD;
+  }
+  if (total > _r->max_msg) {
+    _r->too_big++;
+    return L4REASM_TOO_BIG;
+  }
+  if (count == 1) {
+    /* nothing to reassemble */
+    _r->fragments++;
+    _r->messages++;
+    _r->bytes += total;
+    _r->deliver(_r->ctx, _src, msg_id, _f->Port, _f->Data, total);
+    return L4REASM_DONE;
+  }
+
+  uint32_t key = reasm_key(_src, msg_id);
+  uint32_t s = reasm_find(_r, key, _src, msg_id);
+  if (s == L4REASM_NIL) {
+    /* opening is once per message, the ring scan is not on the per-fragment path */
+    if (reasm_recent(_r, _src, msg_id)) {
+      _r->dups++;
+      return L4REASM_DUP;
+    }
+    s = reasm_open(_r, key, _src, msg_id, _f->Port, count, total, _now);
+  } else if (_r->e[s].total != total || _r->e[s].port != _f->Port) {
+    _r->bad++;
+    return L4REASM_BAD;
+  }
+
+  L4ReasmEntry_t *e = &_r->e[s];
+  uint64_t *map = reasm_map(_r, s);
+  uint64_t bit = 1ull << (index & 63);
+  if (map[index >> 6] & bit) {
+    _r->dups++;
+    return L4REASM_DUP;
+  }
+  map[index >> 6] |= bit;
+  uint32_t off = (uint32_t)index * L4FRAG_DATA;
+  uint32_t n = total - off < L4FRAG_DATA ? total - off : L4FRAG_DATA;
+  memcpy(reasm_buf(_r, s) + off, _f->Data, n);
+  _r->fragments++;
+
+  if (++e->have < e->count) {
+    e->deadline = _now + _r->timeout;
+    ORBITWheel_extend(&_r->wheel, s, e->deadline);
+    return L4REASM_PART;
+  }
+  _r->messages++;
+  _r->bytes += total;
+  L4ReasmDone_t *d = &_r->done[_r->done_head];
+  _r->done_head = _r->done_head + 1 < 2 * _r->capacity ? _r->done_head + 1 : 0;
+  memcpy(d->src, e->src, 16);
+  d->msg_id = msg_id;
+  d->used = 1;
+  _r->deliver(_r->ctx, e->src, msg_id, e->port, reasm_buf(_r, s), total);
+  reasm_release(_r, s);
+  return L4REASM_DONE;
+}
+
+uint32_t L4Reasm_poll(L4Reasm_t *_r, uint64_t _now) {
+  return ORBITWheel_advance(&_r->wheel, _now, reasm_expire, _r);
+}
+
+int32_t L4Reasm_missing(const L4Reasm_t *_r, const uint8_t *_src, uint16_t _msg_id, uint16_t *_out, uint32_t _max) {
+  uint32_t s = reasm_find(_r, reasm_key(_src, _msg_id), _src, _msg_id);
+  if (s == L4REASM_NIL) {
+    return -1;
+  }
+  const L4ReasmEntry_t *e = &_r->e[s];
+  const uint64_t *map = reasm_map(_r, s);
+  uint32_t words = (e->count + 63) / 64;
+  uint32_t n = 0;
+  for (uint32_t w = 0; w < words && n < _max; w++) {
+    uint64_t miss = ~map[w];
+    if (w == words - 1 && (e->count & 63) != 0) {
+      miss &= (1ull << (e->count & 63)) - 1;
+    }
+    while (miss != 0 && n < _max) {
+      _out[n++] = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(miss));
+      miss &= miss - 1;
+    }
+  }
+  return (int32_t)(e->count - e->have);
+}
@@ -0,0 +1,211 @@
+/*
+ * File:        src/L4_frag.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L4 fragmentation and reassembly for Radio_ORBIT.
+ *    Splits a message into L4Frag_t fragments (L4_struct.h) and puts
+ *    received fragments straight into a preallocated per-message buffer at
+ *    FragIndex * 164, so firmware images and logs cross the mesh with no
+ *    per-fragment allocation and O(1) work per fragment.
+ *
+ *
+ *  Reassembly table (L4Reasm_t), all allocated by L4Reasm_init():
+ *
+ *  | Part      | Size                      | Use                              |
+ *  ---------------------------------------------------------------------------
+ *  | entries   | capacity                  | (SrcAddress, MsgID), have/count  |
+ *  | buffers   | capacity * max_msg bytes  | fragment i lands at i * 164      |
+ *  | bitmaps   | capacity * map_words u64  | bit i = fragment i received      |
+ *  | index     | open addressed, 2x        | (SrcAddress, MsgID) -> entry     |
+ *  | wheel     | ORBITWheel_t, capacity    | timeout since the last fragment  |
+ *
+ *  A fragment is checked against its header (Type, FragCount == ceil(
+ *  TotalLen / 164), FragIndex < FragCount) and against the message it
+ *  joins (same TotalLen / Port). Its bitmap bit catches duplicates; the
+ *  message is complete when have == FragCount. L4Reasm_missing() lists
+ *  the fragments still to come, for selective repeat.
+ *
+ *  Completed messages stay in a small ring, so a late duplicate of their
+ *  last fragments does not open a new entry. When every entry is busy a
+ *  new message evicts the one closest to its timeout. Single-fragment
+ *  messages skip the table and are delivered from the fragment itself.
+ *
+ * NOTE:
+ *   - Fragments go in L2D5Frame_t Payload with FLAG NUL = L4FRAG_FLAG_NUL.
+ *   - The deliver callback's data is valid only during the call and the
+ *     callback must not call L4Reasm_push().
+ *   - A MsgID reused by the same source before the old message completes
+ *     or times out is rejected (L4REASM_BAD) until then.
+ *   - Not thread safe.
+ *
+ */
+
+#ifndef L4_FRAG_H
+#define L4_FRAG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2D5_struct.h"
+#include "L2D5_addr.h"
+#include "L4_struct.h"
+#include "ORBIT_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L4FRAG_FLAG_NUL L2D5FLAG_NUL_C
+#define L4REASM_NIL     UINT32_MAX
+
+
+static inline bool L4Frag_is_fragment(const L2D5Frame_t *_f) {
+  return L2D5FLAG_GET_NUL(_f->FLAG) == L4FRAG_FLAG_NUL;
+}
+
+static inline uint32_t L4Frag_count(uint32_t _len) {
+  return (_len + L4FRAG_DATA - 1) / L4FRAG_DATA;
+}
+
+
+/* ------------------------------- sender -------------------------------- */
+
+typedef struct {
+  const uint8_t *msg;                     // caller's message, read while fragments are built
+  uint32_t       len;
+  uint16_t       msg_id;
+  uint8_t        port;
+  uint16_t       count;
+  uint32_t       next;                    // next fragment L4FragTx_next() builds
+} L4FragTx_t;
+
+/* _len 1 .. L4FRAG_MAX_MSG. 0 or -1. */
+int L4FragTx_init(L4FragTx_t *_tx, uint16_t _msg_id, uint8_t _port, const void *_msg, uint32_t _len);
+
+/* Builds fragment _index (< count) into _out, e.g. an L2D5Frame_t Payload */
+void L4FragTx_build(const L4FragTx_t *_tx, uint16_t _index, L4Frag_t *_out);
+
+/* Next fragment in order, false when all built */
+static inline bool L4FragTx_next(L4FragTx_t *_tx, L4Frag_t *_out) {
+  if (_tx->next >= _tx->count) {
+    return false;
+  }
+  L4FragTx_build(_tx, (uint16_t)_tx->next++, _out);
+  return true;
+}
+
+
+/* ------------------------------ receiver ------------------------------- */
+
+typedef enum {
+  L4REASM_PART = 0,                       // stored, message not complete
+  L4REASM_DONE,                           // message complete and delivered
+  L4REASM_DUP,                            // fragment already held
+  L4REASM_BAD,                            // malformed / inconsistent header
+  L4REASM_TOO_BIG                         // TotalLen > max_msg
+} L4ReasmStatus_t;
+
+
+typedef struct {
+  uint8_t   src[16];
+  uint16_t  msg_id;
+  uint8_t   port;
+  uint16_t  count;
+  uint32_t  have;                         // fragments received
+  uint32_t  total;                        // message bytes
+  uint32_t  key;
+  uint64_t  deadline;                     // last fragment + timeout
+} L4ReasmEntry_t;
+
+
+typedef struct {
+  uint32_t key;
+  uint32_t slot;                          // L4REASM_NIL when empty
+} L4ReasmIndexEntry_t;
+
+
+typedef struct {
+  uint8_t  src[16];
+  uint16_t msg_id;
+  uint16_t used;
+} L4ReasmDone_t;
+
+
+/* Complete message, _data inside the reassembly buffer */
+typedef void (*L4ReasmDeliverFn_t)(void *_ctx, const uint8_t *_src, uint16_t _msg_id, uint8_t _port,
+                                   const uint8_t *_data, uint32_t _len);
+
+
+typedef struct {
+  L4ReasmEntry_t      *e;
+  uint8_t             *buf;               // capacity * max_msg
+  uint64_t            *map;               // capacity * map_words
+  uint32_t             capacity;
+  uint32_t             max_msg;
+  uint32_t             map_words;
+  uint32_t             free_head;
+  uint32_t            *next_free;         // next_free[s] == s: entry in use
+  L4ReasmIndexEntry_t *idx;
+  uint32_t             idx_mask;
+  L4ReasmDone_t       *done;              // ring of the last 2 * capacity completed messages
+  uint32_t             done_head;
+  ORBITWheel_t         wheel;
+  uint64_t             timeout;
+  L4ReasmDeliverFn_t   deliver;
+  void                *ctx;
+
+  uint64_t             fragments;         // stored, not counting dup / bad
+  uint64_t             messages;
+  uint64_t             bytes;
+  uint64_t             dups;
+  uint64_t             bad;
+  uint64_t             too_big;
+  uint64_t             expired;
+  uint64_t             evicted;
+} L4Reasm_t;
+
+
+/*
+ * _capacity messages in reassembly at once, each up to _max_msg bytes
+ * (<= L4FRAG_MAX_MSG). A message with no new fragment for _timeout is
+ * dropped. Times in caller units, kept to _tick. 0 or -1.
+ */
+int  L4Reasm_init(L4Reasm_t *_r, uint32_t _capacity, uint32_t _max_msg, uint64_t _timeout, uint64_t _tick,
+                  uint64_t _now, L4ReasmDeliverFn_t _deliver, void *_ctx);
+void L4Reasm_free(L4Reasm_t *_r);
+
+/* One fragment from _src (the frame's SrcAddress) */
+L4ReasmStatus_t L4Reasm_push(L4Reasm_t *_r, const uint8_t *_src, const L4Frag_t *_f, uint64_t _now);
+
+/* Drops messages timed out by _now. Returns how many. */
+uint32_t L4Reasm_poll(L4Reasm_t *_r, uint64_t _now);
+
+/*
+ * Writes up to _max missing fragment indices of (_src, _msg_id) to _out in
+ * increasing order. Returns how many are missing in total, -1 when the
+ * message is not in reassembly.
+ */
+int32_t L4Reasm_missing(const L4Reasm_t *_r, const uint8_t *_src, uint16_t _msg_id, uint16_t *_out, uint32_t _max);
+
+static inline uint32_t L4Reasm_pending(const L4Reasm_t *_r) {
+  return _r->wheel.armed;
+}
+
+static inline size_t L4Reasm_bytes(const L4Reasm_t *_r) {
+  return sizeof(*_r) +
+         (size_t)_r->capacity * (sizeof(L4ReasmEntry_t) + sizeof(uint32_t) + _r->max_msg +
+                                 _r->map_words * sizeof(uint64_t) + 2 * sizeof(L4ReasmDone_t)) +
+         (size_t)(_r->idx_mask + 1) * sizeof(L4ReasmIndexEntry_t) +
+         (size_t)_r->wheel.capacity * sizeof(ORBITWheelTimer_t);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L4_FRAG_H
@@ -0,0 +1,577 @@
+/*
+ * File:        src/L4_rel.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L4 reliable transport for Radio_ORBIT.
+ *    See L4_rel.h
+ *
+ */
+
+#include "L4_rel.h"
+#include "L2D5_addr.h"
+#include "ORBIT_bytes.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RACK_GAPS 2                       // reordering window, in pacing gaps
+
+
+static inline int32_t seq_diff(uint32_t _a, uint32_t _b) {
+  return (int32_t)(_a - _b);
+}
+
+static inline uint32_t id_rto(const L4Rel_t *_r, uint32_t _f) {
+  (void)_r;
+  return _f;
+}
+
+static inline uint32_t id_pace(const L4Rel_t *_r, uint32_t _f) {
+  return _r->tx_cap + _f;
+}
+
+static inline uint32_t id_rx(const L4Rel_t *_r, uint32_t _f) {
+  return 2 * _r->tx_cap + _f;
+}
+
+
+/* ------------------------------- sender -------------------------------- */
+
+/* what the path can carry: one frame per min(hops, 3) airtimes, plus the ACKs coming back */
+static uint64_t tx_air_gap(const L4Rel_t *_r, const L4RelTx_t *_t) {
+  uint64_t g = _r->cfg.airtime * (_t->hops < 3 ? _t->hops : 3);
+  return g + g / _r->cfg.ack_every;
+}
+
+static uint64_t tx_gap(const L4Rel_t *_r, const L4RelTx_t *_t) {
+  uint64_t g = tx_air_gap(_r, _t);
+  if (_t->srtt != 0 && _t->srtt / _t->cwnd > g) {
+    return _t->srtt / _t->cwnd;
+  }
+  return g;
+}
+
+/* segments allowed beyond the path itself: what the receiver holds before it ACKs, and a little */
+static inline uint32_t tx_slack(const L4Rel_t *_r) {
+  return _r->cfg.ack_every + 2;
+}
+
+static uint32_t tx_cwnd_cap(const L4Rel_t *_r, const L4RelTx_t *_t) {
+  uint32_t cap = _r->cfg.max_cwnd;
+  if (_t->rtt_min != 0) {
+    uint64_t bdp = _t->rtt_min / tx_air_gap(_r, _t) + tx_slack(_r);
+    bdp = bdp < 4 ? 4 : bdp;
+    cap = bdp < cap ? (uint32_t)bdp : cap;
+  }
+  return cap;
+}
+
+/* _held: time the receiver sat on the ACK; counts for the RTO, not for the path delay */
+static void tx_rtt_sample(const L4Rel_t *_r, L4RelTx_t *_t, uint64_t _rtt, uint64_t _held) {
+  _rtt = _rtt != 0 ? _rtt : 1;
+  if (_t->srtt == 0) {
+    _t->srtt = _rtt;
+    _t->rttvar = _rtt / 2;
+  } else {
+    uint64_t diff = _t->srtt > _rtt ? _t->srtt - _rtt : _rtt - _t->srtt;
+    _t->rttvar = (3 * _t->rttvar + diff) / 4;
+    _t->srtt = (7 * _t->srtt + _rtt) / 8;
+  }
+  uint64_t var = 4 * _t->rttvar > _r->cfg.tick ? 4 * _t->rttvar : _r->cfg.tick;
+  uint64_t rto = _t->srtt + var;
+  rto = rto < _r->cfg.min_rto ? _r->cfg.min_rto : rto;
+  _t->rto = rto > _r->cfg.max_rto ? _r->cfg.max_rto : rto;   // drops any backoff
+  uint64_t path = _rtt > _held ? _rtt - _held : 1;
+  _t->rtt_min = _t->rtt_min == 0 || path < _t->rtt_min ? path : _t->rtt_min;
+  _t->rtt_last = path;
+  _t->rtt_samples++;
+}
+
+static void tx_pump(L4Rel_t *_r, uint32_t _f, uint64_t _now) {
+  L4RelTx_t *t = &_r->tx[_f];
+  for (;;) {
+    bool more = seq_diff(t->end, t->nxt) > 0 && seq_diff(t->nxt, t->una) < (int32_t)t->rwnd;
+    if ((t->lost == 0 && !more) || t->inflight >= t->cwnd) {
+      return;
+    }
+    if (_now < t->next_send) {
+      ORBITWheel_schedule(&_r->wheel, id_pace(_r, _f), t->next_send);
+      return;
+    }
+    L4RelSlot_t *s;
+    if (t->lost != 0) {
+      uint32_t seq = t->una;
+      while (!t->ring[seq % L4REL_WINDOW].lost) {
+        seq++;
+      }
+      s = &t->ring[seq % L4REL_WINDOW];
+      s->lost = 0;
+      t->lost--;
+      t->retransmits++;
+    } else {
+      s = &t->ring[t->nxt % L4REL_WINDOW];
+      t->nxt++;
+      t->segs_sent++;
+    }
+    t->inflight++;
+    s->sent_at = _now;
+    s->tx_count = s->tx_count < UINT8_MAX ? s->tx_count + 1 : 1;
+    s->seg.Tx = s->tx_count;
+    /* paced against the schedule, not the late wakeup, so timer rounding does not slow the flow */
+    uint64_t gap = tx_gap(_r, t);
+    t->next_send = (t->next_send + gap > _now ? t->next_send : _now - gap) + gap;
+    if (!ORBITWheel_armed(&_r->wheel, id_rto(_r, _f))) {
+      ORBITWheel_schedule(&_r->wheel, id_rto(_r, _f), _now + t->rto);
+    }
+    _r->out(_r->ctx, t->tag, t->dst, &s->seg, _now);
+  }
+}
+
+/* first delivery of a segment, by CumAck or SackMap */
+static inline void tx_delivered(L4RelTx_t *_t, L4RelSlot_t *_s, uint64_t _now, uint64_t *_rack) {
+  if (_s->lost) {
+    _s->lost = 0;
+    _t->lost--;
+  } else {
+    _t->inflight--;
+  }
+  /* a resent segment whose first copy just made it says nothing about later sends */
+  if (_s->tx_count == 1 || _now - _s->sent_at >= _t->rtt_min) {
+    *_rack = _s->sent_at > *_rack ? _s->sent_at : *_rack;
+  }
+}
+
+static void tx_ack(L4Rel_t *_r, uint32_t _f, const L4Ack_t *_a, uint64_t _now) {
+  L4RelTx_t *t = &_r->tx[_f];
+  uint32_t cum = ORBIT_load_be32(_a->CumAck);
+  if (seq_diff(cum, t->una) < 0 || seq_diff(cum, t->nxt) > 0) {
+    return;                               // old or from the future
+  }
+  t->acks++;
+  uint32_t wnd = ORBIT_load_be16(_a->Window);
+  t->rwnd = wnd < L4REL_WINDOW ? (wnd != 0 ? wnd : 1) : L4REL_WINDOW;
+
+  /* the echoed copy times the round trip, resent or not */
+  if (_a->EchoTx != 0) {
+    uint32_t seq = t->una + (uint8_t)(_a->EchoSeq - (uint8_t)t->una);
+    L4RelSlot_t *s = &t->ring[seq % L4REL_WINDOW];
+    if (seq_diff(seq, t->nxt) < 0 && s->tx_count == _a->EchoTx) {
+      tx_rtt_sample(_r, t, _now - s->sent_at, (uint64_t)ORBIT_load_be16(_a->Delay) * _r->cfg.tick);
+    }
+  }
+
+  uint32_t delivered = 0;
+  uint64_t rack = 0;
+  while (t->una != cum) {
+    L4RelSlot_t *s = &t->ring[t->una % L4REL_WINDOW];
+    if (!s->sacked) {
+      tx_delivered(t, s, _now, &rack);
+      delivered++;
+    }
+    t->bytes_acked += ORBIT_load_be16(s->seg.Len);
+    t->una++;
+  }
+  for (uint32_t b = 0; b < L4ACK_SACK_BITS / 8; b++) {
+    uint32_t v = _a->SackMap[b];
+    while (v != 0) {
+      uint32_t seq = cum + 1 + b * 8 + (uint32_t)__builtin_ctz(v);
+      v &= v - 1;
+      if (seq_diff(seq, t->nxt) >= 0) {
+        b = L4ACK_SACK_BITS / 8;
+        break;
+      }
+      L4RelSlot_t *s = &t->ring[seq % L4REL_WINDOW];
+      if (!s->sacked) {
+        s->sacked = 1;
+        tx_delivered(t, s, _now, &rack);
+        delivered++;
+      }
+    }
+  }
+  t->rack_sent = rack > t->rack_sent ? rack : t->rack_sent;
+
+  /* RACK: anything sent well before a delivered segment is gone */
+  uint32_t newly_lost = 0;
+  uint64_t reo = RACK_GAPS * tx_air_gap(_r, t);
+  for (uint32_t seq = t->una; seq != t->nxt; seq++) {
+    L4RelSlot_t *s = &t->ring[seq % L4REL_WINDOW];
+    if (!s->sacked && !s->lost && s->sent_at + reo < t->rack_sent) {
+      s->lost = 1;
+      t->inflight--;
+      t->lost++;
+      newly_lost++;
+    }
+  }
+  t->lost_marked += newly_lost;
+
+  if (t->recovery && seq_diff(t->una, t->recover) >= 0) {
+    t->recovery = false;
+  }
+  if (newly_lost != 0 && !t->recovery) {
+    t->recovery = true;
+    t->recover = t->nxt;
+    /*
+     * back off only for a queue longer than our own slack can make (someone
+     * else is loading the path); random radio loss is just resent
+     */
+    if (t->rtt_last > t->rtt_min + t->rtt_min / 4 + tx_slack(_r) * tx_air_gap(_r, t)) {
+      t->ssthresh = t->cwnd * 7 / 10 > 2 ? t->cwnd * 7 / 10 : 2;
+      t->cwnd = t->ssthresh;
+      t->cwnd_acc = 0;
+      t->decreases++;
+    }
+  } else if (!t->recovery) {
+    if (t->cwnd < t->ssthresh) {
+      t->cwnd += delivered;
+    } else {
+      t->cwnd_acc += delivered;
+      while (t->cwnd_acc >= t->cwnd) {
+        t->cwnd_acc -= t->cwnd;
+        t->cwnd++;
+      }
+    }
+  }
+  uint32_t cap = tx_cwnd_cap(_r, t);
+  t->cwnd = t->cwnd > cap ? cap : t->cwnd;
+
+  if (t->una == t->nxt) {
+    ORBITWheel_cancel(&_r->wheel, id_rto(_r, _f));
+  } else if (delivered != 0) {
+    /* SACKed segments count: a hole being repaired is not a dead path */
+    ORBITWheel_schedule(&_r->wheel, id_rto(_r, _f), _now + t->rto);
+  }
+  tx_pump(_r, _f, _now);
+}
+
+static void tx_rto(L4Rel_t *_r, uint32_t _f, uint64_t _now) {
+  L4RelTx_t *t = &_r->tx[_f];
+  if (!t->open || t->una == t->nxt) {
+    return;
+  }
+  t->rto_fired++;
+  for (uint32_t seq = t->una; seq != t->nxt; seq++) {
+    L4RelSlot_t *s = &t->ring[seq % L4REL_WINDOW];
+    if (!s->sacked && !s->lost) {
+      s->lost = 1;
+      t->lost++;
+    }
+  }
+  t->inflight = 0;
+  t->ssthresh = t->cwnd / 2 > 2 ? t->cwnd / 2 : 2;
+  t->cwnd = 1;
+  t->cwnd_acc = 0;
+  t->recovery = false;
+  t->rto = t->rto * 2 < _r->cfg.max_rto ? t->rto * 2 : _r->cfg.max_rto;
+  t->next_send = _now;
+  ORBITWheel_schedule(&_r->wheel, id_rto(_r, _f), _now + t->rto);
+  tx_pump(_r, _f, _now);
+}
+
+
+/* ------------------------------ receiver ------------------------------- */
+
+static void rx_send_ack(L4Rel_t *_r, uint32_t _f, uint64_t _now) {
+  L4RelRx_t *x = &_r->rx[_f];
+  L4Ack_t a;
+  memset(&a, 0, sizeof(a));
+  ORBIT_store_be16(a.ConnID, x->conn_id);
+  a.Type = L4TYPE_ACK;
+  ORBIT_store_be32(a.CumAck, x->rcv_nxt);
+  ORBIT_store_be16(a.Window, L4REL_WINDOW);
+  /* timers fire at their tick, which may be before the echoed segment came in */
+  uint64_t held = _now > x->echo_at ? (_now - x->echo_at) / _r->cfg.tick : 0;
+  ORBIT_store_be16(a.Delay, (uint16_t)(held < UINT16_MAX ? held : UINT16_MAX));
+  a.EchoSeq = x->echo_seq;
+  a.EchoTx = x->echo_tx;
+  if (x->ooo != 0) {
+    for (uint32_t i = 0; i < L4REL_WINDOW - 1; i++) {
+      uint32_t k = (x->rcv_nxt + 1 + i) % L4REL_WINDOW;
+      if (x->have[k >> 6] & (1ull << (k & 63))) {
+        a.SackMap[i >> 3] |= (uint8_t)(1u << (i & 7));
+      }
+    }
+  }
+  x->acks_sent++;
+  x->unacked = 0;
+  x->ack_pending = false;
+  ORBITWheel_schedule(&_r->wheel, id_rx(_r, _f), _now + _r->cfg.rx_idle);
+  _r->out(_r->ctx, x->tag, x->src, &a, _now);
+}
+
+static void rx_seg(L4Rel_t *_r, uint32_t _f, const L4Seg_t *_g, uint64_t _now) {
+  L4RelRx_t *x = &_r->rx[_f];
+  uint32_t seq = ORBIT_load_be32(_g->Seq);
+  uint32_t len = ORBIT_load_be16(_g->Len);
+  if (len == 0 || len > L4SEG_DATA) {
+    _r->stray++;
+    return;
+  }
+  x->segs++;
+  x->echo_seq = (uint8_t)seq;
+  x->echo_tx = _g->Tx;
+  x->echo_at = _now;
+  int32_t d = seq_diff(seq, x->rcv_nxt);
+  if (d < 0) {
+    /* our ACK got lost */
+    x->dups++;
+    rx_send_ack(_r, _f, _now);
+    return;
+  }
+  if (d >= L4REL_WINDOW) {
+    x->out_of_window++;
+    return;
+  }
+  uint32_t k = seq % L4REL_WINDOW;
+  if (x->have[k >> 6] & (1ull << (k & 63))) {
+    x->dups++;
+    rx_send_ack(_r, _f, _now);
+    return;
+  }
+  x->have[k >> 6] |= 1ull << (k & 63);
+  x->len[k] = (uint8_t)len;
+  memcpy(x->data + (size_t)k * L4SEG_DATA, _g->Data, len);
+
+  bool ack_now = (_g->Flags & MAGIC_L4LAYER_SEGFLAG_PUSH) != 0;
+  if (d == 0) {
+    ack_now |= x->ooo != 0;               // a hole just filled
+    uint32_t run = 0;
+    for (;;) {
+      k = x->rcv_nxt % L4REL_WINDOW;
+      if (!(x->have[k >> 6] & (1ull << (k & 63)))) {
+        break;
+      }
+      x->have[k >> 6] &= ~(1ull << (k & 63));
+      x->rcv_nxt++;
+      x->bytes += x->len[k];
+      run++;
+      _r->data(_r->ctx, x->src, x->conn_id, x->data + (size_t)k * L4SEG_DATA, x->len[k]);
+    }
+    x->ooo -= run - 1;
+    x->unacked += run;
+  } else {
+    ack_now |= x->ooo == 0;               // a new hole
+    x->ooo++;
+    x->unacked++;
+  }
+  if (ack_now || x->unacked >= _r->cfg.ack_every) {
+    rx_send_ack(_r, _f, _now);
+  } else if (!x->ack_pending) {
+    x->ack_pending = true;
+    ORBITWheel_schedule(&_r->wheel, id_rx(_r, _f), _now + _r->cfg.ack_delay);
+  }
+}
+
+static int32_t rx_open(L4Rel_t *_r, const uint8_t *_src, uint16_t _conn_id, uint8_t _tag) {
+  for (uint32_t f = 0; f < _r->rx_cap; f++) {
+    L4RelRx_t *x = &_r->rx[f];
+    if (!x->open) {
+      uint8_t *len = x->len, *data = x->data;
+      memset(x, 0, sizeof(*x));
+      x->len = len;
+      x->data = data;
+      memcpy(x->src, _src, 16);
+      x->conn_id = _conn_id;
+      x->tag = _tag;
+      x->open = true;
+      return (int32_t)f;
+    }
+  }
+  return -1;
+}
+
+
+/* ------------------------------- timers -------------------------------- */
+
+static void rel_fire(void *_ctx, uint32_t _id, uint64_t _now) {
+  L4Rel_t *r = _ctx;
+  if (_id < r->tx_cap) {
+    tx_rto(r, _id, _now);
+  } else if (_id < 2 * r->tx_cap) {
+    if (r->tx[_id - r->tx_cap].open) {
+      tx_pump(r, _id - r->tx_cap, _now);
+    }
+  } else {
+    uint32_t f = _id - 2 * r->tx_cap;
+    if (r->rx[f].ack_pending) {
+      rx_send_ack(r, f, _now);
+    } else {
+      r->rx[f].open = false;              // idle
+    }
+  }
+}
+
+
+/* ------------------------------ lifecycle ------------------------------ */
+
+void L4Rel_config_default(L4RelConfig_t *_cfg) {
+  memset(_cfg, 0, sizeof(*_cfg));
+  _cfg->airtime = 9000;
+  _cfg->tick = 1000;
+  _cfg->ack_every = 4;
+  _cfg->ack_delay = 100000;
+  _cfg->initial_rto = 3000000;
+  _cfg->min_rto = 200000;
+  _cfg->max_rto = 60000000;
+  _cfg->max_cwnd = L4REL_WINDOW;
+  _cfg->rx_idle = 120000000;
+}
+
+int L4Rel_init(L4Rel_t *_r, const L4RelConfig_t *_cfg, uint32_t _tx_cap, uint32_t _rx_cap, uint64_t _now,
+               L4RelOutFn_t _out, L4RelDataFn_t _data, void *_ctx) {
+  memset(_r, 0, sizeof(*_r));
+  if (_out == NULL || _data == NULL || _cfg->airtime == 0 || _cfg->ack_every == 0 || _cfg->max_cwnd == 0 ||
+      _cfg->max_cwnd > L4REL_WINDOW || _cfg->min_rto == 0 || _cfg->min_rto > _cfg->max_rto ||
+      ORBITWheel_init(&_r->wheel, 2 * _tx_cap + _rx_cap, _cfg->tick, _now) != 0) {
+    return -1;
+  }
+  _r->cfg = *_cfg;
+  _r->tx_cap = _tx_cap;
+  _r->rx_cap = _rx_cap;
+  _r->out = _out;
+  _r->data = _data;
+  _r->ctx = _ctx;
+  _r->tx = calloc(_tx_cap != 0 ? _tx_cap : 1, sizeof(L4RelTx_t));
+  _r->rx = calloc(_rx_cap != 0 ? _rx_cap : 1, sizeof(L4RelRx_t));
+  if (_r->tx == NULL || _r->rx == NULL) {
+    L4Rel_free(_r);
+    return -1;
+  }
+  for (uint32_t f = 0; f < _tx_cap; f++) {
+    _r->tx[f].ring = malloc(L4REL_WINDOW * sizeof(L4RelSlot_t));
+    if (_r->tx[f].ring == NULL) {
+      L4Rel_free(_r);
+      return -1;
+    }
+  }
+  for (uint32_t f = 0; f < _rx_cap; f++) {
+    _r->rx[f].len = malloc(L4REL_WINDOW);
+    _r->rx[f].data = malloc((size_t)L4REL_WINDOW * L4SEG_DATA);
+    if (_r->rx[f].len == NULL || _r->rx[f].data == NULL) {
+      L4Rel_free(_r);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void L4Rel_free(L4Rel_t *_r) {
+  for (uint32_t f = 0; _r->tx != NULL && f < _r->tx_cap; f++) {
+    free(_r->tx[f].ring);
+  }
+  for (uint32_t f = 0; _r->rx != NULL && f < _r->rx_cap; f++) {
+    free(_r->rx[f].len);
+    free(_r->rx[f].data);
+  }
+  free(_r->tx);
+  free(_r->rx);
+  ORBITWheel_free(&_r->wheel);
+  memset(_r, 0, sizeof(*_r));
+}
+
+
+/* ------------------------------ sending -------------------------------- */
+
+int32_t L4Rel_connect(L4Rel_t *_r, const uint8_t *_dst, uint16_t _conn_id, uint8_t _tag, uint8_t _hops,
+                      uint64_t _now) {
+  for (uint32_t f = 0; f < _r->tx_cap; f++) {
+    L4RelTx_t *t = &_r->tx[f];
+    if (t->open) {
+      continue;
+    }
+    L4RelSlot_t *ring = t->ring;
+    memset(t, 0, sizeof(*t));
+    t->ring = ring;
+    memcpy(t->dst, _dst, 16);
+    t->conn_id = _conn_id;
+    t->tag = _tag;
+    t->hops = _hops != 0 ? _hops : 1;
+    t->open = true;
+    t->rwnd = L4REL_WINDOW;
+    t->rto = _r->cfg.initial_rto;
+    t->cwnd = _r->cfg.max_cwnd < 2 ? _r->cfg.max_cwnd : 2;
+    t->ssthresh = _r->cfg.max_cwnd;
+    t->next_send = _now;
+    return (int32_t)f;
+  }
+  return -1;
+}
+
+void L4Rel_close(L4Rel_t *_r, uint32_t _flow) {
+  ORBITWheel_cancel(&_r->wheel, id_rto(_r, _flow));
+  ORBITWheel_cancel(&_r->wheel, id_pace(_r, _flow));
+  _r->tx[_flow].open = false;
+}
+
+uint32_t L4Rel_send(L4Rel_t *_r, uint32_t _flow, const void *_data, uint32_t _len, uint64_t _now) {
+  L4RelTx_t *t = &_r->tx[_flow];
+  const uint8_t *p = _data;
+  uint32_t taken = 0;
+  if (t->end != t->nxt) {
+    /* top up the last segment if it has not left yet */
+    L4Seg_t *g = &t->ring[(t->end - 1) % L4REL_WINDOW].seg;
+    uint32_t used = ORBIT_load_be16(g->Len);
+    uint32_t n = L4SEG_DATA - used < _len ? L4SEG_DATA - used : _len;
+    memcpy(g->Data + used, p, n);
+    ORBIT_store_be16(g->Len, (uint16_t)(used + n));
+    taken = n;
+  }
+  while (taken < _len && t->end - t->una < L4REL_WINDOW) {
+    L4RelSlot_t *s = &t->ring[t->end % L4REL_WINDOW];
+    uint32_t n = _len - taken < L4SEG_DATA ? _len - taken : L4SEG_DATA;
+    ORBIT_store_be16(s->seg.ConnID, t->conn_id);
+    s->seg.Type = L4TYPE_SEG;
+    s->seg.Flags = 0;
+    ORBIT_store_be32(s->seg.Seq, t->end);
+    ORBIT_store_be16(s->seg.Len, (uint16_t)n);
+    memcpy(s->seg.Data, p + taken, n);
+    memset(s->seg.Data + n, 0, L4SEG_DATA - n);
+    s->seg.Tx = 0;
+    s->seg.Rsvd = 0;
+    s->sent_at = 0;
+    s->tx_count = 0;
+    s->sacked = 0;
+    s->lost = 0;
+    t->end++;
+    taken += n;
+  }
+  tx_pump(_r, _flow, _now);
+  return taken;
+}
+
+
+/* ----------------------------- receiving ------------------------------- */
+
+void L4Rel_input(L4Rel_t *_r, const uint8_t *_src, uint8_t _tag, const void *_pkt, uint64_t _now) {
+  const uint8_t *p = _pkt;
+  uint16_t conn_id = ORBIT_load_be16(p);
+  if (p[2] == L4TYPE_SEG) {
+    int32_t f = -1;
+    for (uint32_t i = 0; i < _r->rx_cap; i++) {
+      if (_r->rx[i].open && _r->rx[i].conn_id == conn_id && L2D5ADDR_equal(_r->rx[i].src, _src)) {
+        f = (int32_t)i;
+        break;
+      }
+    }
+    if (f < 0 && (f = rx_open(_r, _src, conn_id, _tag)) < 0) {
+      _r->rx_full++;
+      return;
+    }
+    rx_seg(_r, (uint32_t)f, _pkt, _now);
+  } else if (p[2] == L4TYPE_ACK) {
+    for (uint32_t i = 0; i < _r->tx_cap; i++) {
+      if (_r->tx[i].open && _r->tx[i].conn_id == conn_id && L2D5ADDR_equal(_r->tx[i].dst, _src)) {
+        tx_ack(_r, i, _pkt, _now);
+        return;
+      }
+    }
+    _r->stray++;
+  } else {
+    _r->stray++;
+  }
+}
+
+uint32_t L4Rel_poll(L4Rel_t *_r, uint64_t _now) {
+  return ORBITWheel_advance(&_r->wheel, _now, rel_fire, _r);
+}
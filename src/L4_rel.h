@@ -0,0 +1,236 @@
+/*
+ * File:        src/L4_rel.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L4 reliable transport for Radio_ORBIT (TAG TCP_DATA_DC / TCP_DATA_RM).
+ *    Sliding send window of L4Seg_t, selective ACKs (L4Ack_t SackMap),
+ *    RTT estimation per flow and airtime-paced congestion control for
+ *    half-duplex multi-hop radio. One ORBITWheel_t drives every timer.
+ *
+ *
+ *  Sender, per flow (seqs count segments):
+ *
+ *     una            nxt                 end
+ *      |  in flight / |  queued, not sent  |  free ring slots
+ *      |  SACKed /    |                    |
+ *      |  lost        |                    |
+ *
+ *  | Piece        | How                                                    |
+ *  -----------------------------------------------------------------------
+ *  | RTT          | RFC 6298 srtt / rttvar / RTO from the segment each ACK |
+ *  |              | echoes (Seq + Tx, so resends are timed too); rtt_min / |
+ *  |              | rtt_last less the ACK's Delay (time held by receiver)  |
+ *  | loss         | a segment is lost once one sent 2 pacing gaps after it |
+ *  |              | is delivered (RACK style), or on RTO (all outstanding) |
+ *  | pacing       | one segment per gap = max(airtime * min(hops, 3) *     |
+ *  |              | (1 + 1 / ack_every), srtt / cwnd)                      |
+ *  | cwnd         | slow start / AIMD, capped at rtt_min / gap + slack,    |
+ *  |              | slack = ack_every + 2                                  |
+ *  | decrease     | x 0.7 once per window, only when rtt_last exceeds      |
+ *  |              | 1.25 * rtt_min + slack * gap: a queue our own window   |
+ *  |              | cannot explain; plain radio loss is resent without     |
+ *  |              | backing off                                            |
+ *  | RTO          | re-armed by any ACK that delivers (SACK included),     |
+ *  |              | doubles per firing, reset by the next RTT sample       |
+ *
+ *  A half-duplex chain moves at most one frame per 3 hops' airtime (a
+ *  node cannot send while its next hop forwards, nor while the hop after
+ *  that does, hidden from it), and every ACK costs airtime on the way back.
+ *  The pacing gap is that bound, so the window fills the path without
+ *  piling frames into relay queues.
+ *
+ *  Receiver, per flow: ring of L4REL_WINDOW segments, in-order data handed
+ *  to the data callback in place. ACK after ack_every segments, after
+ *  ack_delay, at once on a PUSH segment, a new hole, a filled hole or a
+ *  duplicate.
+ *
+ *  Timer wheel ids:
+ *
+ *  | Ids                        | Timer                                     |
+ *  ------------------------------------------------------------------------
+ *  | [0, tx_cap)                | send flow RTO                             |
+ *  | [tx_cap, 2 tx_cap)         | send flow pacing                          |
+ *  | [2 tx_cap, 2 tx_cap + rx)  | receive flow delayed ACK, then idle close |
+ *
+ * NOTE:
+ *   - Flows are few per node; they are found by a linear scan of conn_id.
+ *   - The data callback's data is valid only during the call.
+ *   - Seqs start at 0 on both ends; a receive flow idle for rx_idle is
+ *     forgotten, so a sender quiet that long must connect again.
+ *   - Times in caller units (us in the tests). ACK Delay goes on air in
+ *     ticks, so both ends need the same tick. Not thread safe.
+ *
+ */
+
+#ifndef L4_REL_H
+#define L4_REL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L4_struct.h"
+#include "ORBIT_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define L4REL_WINDOW 256                  // segments, == L4ACK_SACK_BITS, power of 2
+
+
+typedef struct {
+  uint64_t airtime;                       // one L2 frame on air
+  uint64_t tick;                          // timer resolution
+  uint32_t ack_every;                     // in-order segments per ACK
+  uint64_t ack_delay;
+  uint64_t initial_rto;
+  uint64_t min_rto;
+  uint64_t max_rto;
+  uint32_t max_cwnd;                      // 1 .. L4REL_WINDOW; 1 = stop-and-wait
+  uint64_t rx_idle;                       // receive flow closed after this long without segments
+} L4RelConfig_t;
+
+
+typedef struct {
+  L4Seg_t  seg;                           // as sent, resent as is
+  uint64_t sent_at;
+  uint8_t  tx_count;
+  uint8_t  sacked;
+  uint8_t  lost;                          // waiting to be resent
+} L4RelSlot_t;
+
+
+typedef struct {
+  uint8_t      dst[16];
+  uint16_t     conn_id;
+  uint8_t      tag;
+  uint8_t      hops;
+  bool         open;
+  L4RelSlot_t *ring;                      // L4REL_WINDOW, seq % L4REL_WINDOW
+  uint32_t     una;                       // oldest not acknowledged
+  uint32_t     nxt;                       // next never-sent segment
+  uint32_t     end;                       // next segment to queue
+  uint32_t     rwnd;                      // from the last ACK
+  uint32_t     inflight;                  // sent, not delivered, not lost
+  uint32_t     lost;                      // marked lost, not resent yet
+  uint64_t     rack_sent;                 // latest sent_at among delivered segments
+  /* RTT */
+  uint64_t     srtt;                      // 0 until the first sample
+  uint64_t     rttvar;
+  uint64_t     rto;
+  uint64_t     rtt_min;
+  uint64_t     rtt_last;                  // latest sample less ACK delay
+  /* congestion control, segments */
+  uint32_t     cwnd;
+  uint32_t     cwnd_acc;                  // congestion avoidance: delivered since last +1
+  uint32_t     ssthresh;
+  uint32_t     recover;                   // in recovery until una reaches this
+  bool         recovery;
+  uint64_t     next_send;                 // pacing
+
+  uint64_t     segs_sent;                 // first transmissions
+  uint64_t     retransmits;
+  uint64_t     lost_marked;               // by the RACK rule
+  uint64_t     rto_fired;
+  uint64_t     decreases;                 // cwnd cuts
+  uint64_t     acks;
+  uint64_t     rtt_samples;
+  uint64_t     bytes_acked;
+} L4RelTx_t;
+
+
+typedef struct {
+  uint8_t   src[16];
+  uint16_t  conn_id;
+  uint8_t   tag;
+  bool      open;
+  bool      ack_pending;
+  uint32_t  rcv_nxt;
+  uint32_t  ooo;                          // segments held out of order
+  uint32_t  unacked;                      // segments since the last ACK
+  uint8_t   echo_seq;                     // last segment received, for the next ACK
+  uint8_t   echo_tx;
+  uint64_t  echo_at;
+  uint64_t  have[L4REL_WINDOW / 64];
+  uint8_t  *len;                          // L4REL_WINDOW
+  uint8_t  *data;                         // L4REL_WINDOW * L4SEG_DATA
+
+  uint64_t  segs;
+  uint64_t  dups;
+  uint64_t  out_of_window;
+  uint64_t  acks_sent;
+  uint64_t  bytes;
+} L4RelRx_t;
+
+
+/* One L4 packet (176 bytes, an L4Seg_t or L4Ack_t) for the L2D5Frame_t Payload, to _peer under _tag */
+typedef void (*L4RelOutFn_t)(void *_ctx, uint8_t _tag, const uint8_t *_peer, const void *_pkt, uint64_t _now);
+
+/* In-order data of flow (_src, _conn_id) */
+typedef void (*L4RelDataFn_t)(void *_ctx, const uint8_t *_src, uint16_t _conn_id, const uint8_t *_data,
+                              uint32_t _len);
+
+
+typedef struct {
+  L4RelConfig_t cfg;
+  L4RelTx_t    *tx;
+  uint32_t      tx_cap;
+  L4RelRx_t    *rx;
+  uint32_t      rx_cap;
+  ORBITWheel_t  wheel;
+  L4RelOutFn_t  out;
+  L4RelDataFn_t data;
+  void         *ctx;
+
+  uint64_t      rx_full;                  // segments of a new flow dropped, receive table full
+  uint64_t      stray;                    // ACKs for no open flow, malformed packets
+} L4Rel_t;
+
+
+/* airtime 9 ms (224-byte frame at 200 kbit/s), ACK every 4 or 100 ms, RTO 200 ms .. 60 s */
+void L4Rel_config_default(L4RelConfig_t *_cfg);
+
+/* _tx_cap send flows, _rx_cap receive flows. 0 or -1. */
+int  L4Rel_init(L4Rel_t *_r, const L4RelConfig_t *_cfg, uint32_t _tx_cap, uint32_t _rx_cap, uint64_t _now,
+                L4RelOutFn_t _out, L4RelDataFn_t _data, void *_ctx);
+void L4Rel_free(L4Rel_t *_r);
+
+/* Send flow to _dst over _hops hops; _tag TCP_DATA_DC or TCP_DATA_RM. Flow id or -1. */
+int32_t L4Rel_connect(L4Rel_t *_r, const uint8_t *_dst, uint16_t _conn_id, uint8_t _tag, uint8_t _hops,
+                      uint64_t _now);
+void    L4Rel_close(L4Rel_t *_r, uint32_t _flow);
+
+/* Route changed: new hop count, base delay learned again */
+static inline void L4Rel_set_hops(L4Rel_t *_r, uint32_t _flow, uint8_t _hops) {
+  _r->tx[_flow].hops = _hops != 0 ? _hops : 1;
+  _r->tx[_flow].rtt_min = 0;
+  _r->tx[_flow].rtt_last = 0;
+}
+
+/*
+ * Queues up to _len bytes on _flow and sends what the window and pacing
+ * allow. Returns bytes taken; less than _len when the window is full.
+ */
+uint32_t L4Rel_send(L4Rel_t *_r, uint32_t _flow, const void *_data, uint32_t _len, uint64_t _now);
+
+/* Segments queued or in flight, 0 when everything sent is acknowledged */
+static inline uint32_t L4Rel_outstanding(const L4Rel_t *_r, uint32_t _flow) {
+  return _r->tx[_flow].end - _r->tx[_flow].una;
+}
+
+/* One received L4 packet (the frame's Payload) from _src under _tag */
+void L4Rel_input(L4Rel_t *_r, const uint8_t *_src, uint8_t _tag, const void *_pkt, uint64_t _now);
+
+/* Runs RTO / pacing / ACK timers to _now. Returns timers fired. */
+uint32_t L4Rel_poll(L4Rel_t *_r, uint64_t _now);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L4_REL_H
@@ -0,0 +1,188 @@
+/*
+ * File:        src/L4_struct.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    L4 transport layer packet definition for Radio_ORBIT.
+ *    Carried in the 176-byte L2D5Frame_t Payload: fragments with the FLAG
+ *    NUL field set (see L4_frag.h), reliable transport segments / ACKs
+ *    under TAG TCP_DATA_DC / TCP_DATA_RM (see L4_rel.h).
+ *    This file is critical for protocol compatibility.
+ *
+ * WARNING:
+ *   - DO NOT MODIFY THIS FILE MANUALLY.
+ *   - Any changes must be approved and reviewed carefully.
+ *   - Modifying the structure will break compatibility between devices.
+ *   - Always ensure sizeof(L4Frag_t) == 176 bytes.
+ *   - Always ensure sizeof(L4Seg_t) == 176 bytes.
+ *   - Always ensure sizeof(L4Ack_t) == 176 bytes.
+ */
+
+
+#ifndef L4_STRUCT_H
+#define L4_STRUCT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Static assert that works in both C and C++ */
+#ifdef __cplusplus
+  #define STATIC_ASSERT(cond, msg) static_assert(cond, #msg)
+#else
+  #if __STDC_VERSION__ >= 201112L
+    #define STATIC_ASSERT(cond, msg) _Static_assert(cond, #msg)
+  #else
+    #define STATIC_ASSERT(cond, msg) typedef char static_assertion_##msg[(cond) ? 1 : -1]
+  #endif
+#endif
+
+
+/*
+ *  L4 Fragment
+ *
+ * | Packet        | MsgID | Type | Port | FragIndex | FragCount | TotalLen |  Data  |
+ * -----------------------------------------------------------------------------------
+ * | Length(Bytes) |   2   |   1  |   1  |     2     |     2     |     4    |  164   |
+ * -----------------------------------------------------------------------------------
+ * | L4 Fragment   | <--                  12+164 Bytes                          --> |
+ *
+ *
+ *
+ *  +------------------------- L4 Fragment ------------------------------+
+ *  +    00  01  02  03  04  05  06  07  08  09  0A  0B  0C  0D  0E  0F  +
+ *  +--------------------------------------------------------------------+
+ *  + 0|[MsgID][*Y][*P][-IDX-][-CNT-][-TotalLen-][----- 164 bytes data  |+
+ *  + ~| ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ |+
+ *  + A| --------------------------------------------------------------]|+
+ *  +--------------------------------------------------------------------+
+ *
+ *  *Y: Type
+ *  *P: Port (application channel, carried as is)
+ *
+ *  All multi-byte fields big-endian. Fragment i carries message bytes
+ *  [i * 164, min((i + 1) * 164, TotalLen)); only the last one is short.
+ *  FragCount == ceil(TotalLen / 164), 1 .. 65535. (SrcAddress, MsgID)
+ *  names one message.
+ */
+
+
+/*
+ *  L4 Transport Segment (TAG TCP_DATA_DC / TCP_DATA_RM)
+ *
+ * | Packet        | ConnID | Type | Flags | Seq | Len | Tx | Rsvd |  Data  |
+ * -------------------------------------------------------------------------
+ * | Length(Bytes) |   2    |   1  |   1   |  4  |  2  | 1  |  1   |  164   |
+ * -------------------------------------------------------------------------
+ * | L4 Segment    | <--                 12+164 Bytes                   --> |
+ *
+ *  Seq counts segments, not bytes. Len: data bytes used, 1 .. 164.
+ *  Tx: transmission number of this copy, 1 = first. Flags:
+ *  MAGIC_L4LAYER_SEGFLAG_*.
+ *
+ *
+ *  L4 Transport ACK (same TAG as the segments it acknowledges)
+ *
+ * | Packet        | ConnID | Type | Flags | CumAck | Window | EchoSeq | EchoTx | SackMap | Delay |   Padding   |
+ * -----------------------------------------------------------------------------------------------------------
+ * | Length(Bytes) |   2    |   1  |   1   |   4    |   2    |    1    |   1    |   32    |   2   |     130     |
+ * -----------------------------------------------------------------------------------------------------------
+ * | L4 ACK        | <--                          46+130 Bytes                           --> |@@ ZERO Pad @@|
+ *
+ *  CumAck: next Seq expected in order. SackMap bit i (byte i / 8, LSB
+ *  first) = Seq CumAck + 1 + i held out of order. Window: segments the
+ *  receiver takes beyond CumAck - 1. EchoSeq / EchoTx: low 8 bits of Seq
+ *  and the Tx of the segment that triggered this ACK, so the sender can
+ *  time retransmitted segments too; EchoTx 0 = none. Delay: how long
+ *  the receiver held this ACK after that segment arrived, in transport
+ *  ticks (1 ms by default, see L4_rel.h), saturating. Flags: 0.
+ *
+ *  Every L4 packet has Type at offset 2.
+ */
+
+
+#define MAGIC_L4LAYER_TYPE_DATA 0x01
+#define MAGIC_L4LAYER_TYPE_SEG  0x02
+#define MAGIC_L4LAYER_TYPE_ACK  0x03
+
+#define MAGIC_L4LAYER_SEGFLAG_PUSH 0x01   // ACK this segment at once
+
+#define L4FRAG_HDR       12
+#define L4FRAG_DATA      164
+#define L4FRAG_MAX_COUNT 65535u
+#define L4FRAG_MAX_MSG   ((uint32_t)L4FRAG_MAX_COUNT * L4FRAG_DATA)
+
+#define L4SEG_HDR        12
+#define L4SEG_DATA       164
+#define L4ACK_SACK_BITS  256
+
+typedef enum {
+  L4TYPE_DATA = MAGIC_L4LAYER_TYPE_DATA,
+  L4TYPE_SEG  = MAGIC_L4LAYER_TYPE_SEG,
+  L4TYPE_ACK  = MAGIC_L4LAYER_TYPE_ACK
+} L4TYPE_t;
+
+
+/* L4 Fragment structure definition (must be 176 bytes) */
+typedef struct {
+  /* 176 Bytes */
+  uint8_t MsgID[2];                   // L4: 0x00-0x01
+  uint8_t Type;                       // L4: 0x02
+  uint8_t Port;                       // L4: 0x03
+  uint8_t FragIndex[2];               // L4: 0x04-0x05
+  uint8_t FragCount[2];               // L4: 0x06-0x07
+  uint8_t TotalLen[4];                // L4: 0x08-0x0B
+  uint8_t Data[164];                  // L4: 0x0C-0xAF
+} L4Frag_t;
+
+
+
+/* L4 Transport Segment structure definition (must be 176 bytes) */
+typedef struct {
+  /* 176 Bytes */
+  uint8_t ConnID[2];                  // L4: 0x00-0x01
+  uint8_t Type;                       // L4: 0x02
+  uint8_t Flags;                      // L4: 0x03
+  uint8_t Seq[4];                     // L4: 0x04-0x07
+  uint8_t Len[2];                     // L4: 0x08-0x09
+  uint8_t Tx;                         // L4: 0x0A
+  uint8_t Rsvd;                       // L4: 0x0B
+  uint8_t Data[164];                  // L4: 0x0C-0xAF
+} L4Seg_t;
+
+
+/* L4 Transport ACK structure definition (must be 176 bytes with padding) */
+typedef struct {
+  /* 176 Bytes */
+  uint8_t ConnID[2];                  // L4: 0x00-0x01
+  uint8_t Type;                       // L4: 0x02
+  uint8_t Flags;                      // L4: 0x03
+  uint8_t CumAck[4];                  // L4: 0x04-0x07
+  uint8_t Window[2];                  // L4: 0x08-0x09
+  uint8_t EchoSeq;                    // L4: 0x0A
+  uint8_t EchoTx;                     // L4: 0x0B
+  uint8_t SackMap[32];                // L4: 0x0C-0x2B
+  uint8_t Delay[2];                   // L4: 0x2C-0x2D
+  uint8_t Padding[130];               // L4: 0x2E-0xAF
+} L4Ack_t;
+
+
+
+STATIC_ASSERT(sizeof(L4Frag_t) == 176, L4Frag_t_must_be_176bytes);
+STATIC_ASSERT(sizeof(L4Seg_t) == 176, L4Seg_t_must_be_176bytes);
+STATIC_ASSERT(sizeof(L4Ack_t) == 176, L4Ack_t_must_be_176bytes);
+
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // L4_STRUCT_H
@@ -0,0 +1,352 @@
+/*
+ * File:        src/ORBIT_air.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Virtual shared-memory air medium for Radio_ORBIT.
+ *    See ORBIT_air.h
+ *
+ */
+
+#define _GNU_SOURCE
+#include "ORBIT_air.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FRAME_BITS (8.0 * sizeof(L2Frame))
+
+
+static inline uint32_t f2u(float _f) { uint32_t u; memcpy(&u, &_f, 4); return u; }
+static inline float    u2f(uint32_t _u) { float f; memcpy(&f, &_u, 4); return f; }
+
+static uint64_t air_rng(ORBITAir_t *_a) {
+  _a->rng ^= _a->rng << 13;
+  _a->rng ^= _a->rng >> 7;
+  _a->rng ^= _a->rng << 17;
+  return _a->rng;
+}
+
+/* Uniform in (0, 1] */
+static inline double air_unit(ORBITAir_t *_a) {
+  return ((double)(air_rng(_a) >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t pow2_at_least(uint32_t _v) {
+  uint32_t p = 1;
+  while (p < _v) {
+    p <<= 1;
+  }
+  return p;
+}
+
+static inline ORBITAirSlot_t *air_slot(const ORBITAir_t *_a, uint32_t _node, uint64_t _pos) {
+  return &_a->ring[(size_t)_node * _a->hdr->slots + (_pos & (_a->hdr->slots - 1))];
+}
+
+
+/* ------------------------------ lifecycle ------------------------------ */
+
+static void params_store(ORBITAirHeader_t *_h, const ORBITAirParams_t *_p) {
+  atomic_store_explicit(&_h->loss_ppm, _p->loss_ppm, memory_order_relaxed);
+  atomic_store_explicit(&_h->ber_ppb, _p->ber_ppb, memory_order_relaxed);
+  atomic_store_explicit(&_h->noise_ppm, _p->noise_ppm, memory_order_relaxed);
+  atomic_store_explicit(&_h->latency_ns, _p->latency_ns, memory_order_relaxed);
+  atomic_store_explicit(&_h->bitrate_bps, _p->bitrate_bps, memory_order_relaxed);
+  atomic_store_explicit(&_h->backlog_ns, _p->backlog_ns ? _p->backlog_ns : 100000000ull, memory_order_relaxed);
+}
+
+int ORBITAir_create(const char *_path, uint32_t _nodes, uint32_t _slots, const ORBITAirParams_t *_p) {
+  if (_nodes == 0 || _nodes > ORBITAIR_MAX_NODES) {
+    return -1;
+  }
+  uint32_t slots = pow2_at_least(_slots ? _slots : 4096);
+  uint64_t node_off = (sizeof(ORBITAirHeader_t) + 63) & ~63ull;
+  uint64_t ring_off = (node_off + (uint64_t)_nodes * sizeof(ORBITAirNode_t) + 4095) & ~4095ull;
+  uint64_t size = ring_off + (uint64_t)_nodes * slots * sizeof(ORBITAirSlot_t);
+
+  /* a fresh inode: processes still mapping an old medium keep theirs */
+  unlink(_path);
+  int fd = open(_path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return -1;
+  }
+  if (ftruncate(fd, (off_t)size) != 0) {
+    close(fd);
+    unlink(_path);
+    return -1;
+  }
+  void *m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED) {
+    unlink(_path);
+    return -1;
+  }
+  /* ftruncate() zero-fills: every node free, every head and seq 0 */
+  ORBITAirHeader_t *h = m;
+  h->version = ORBITAIR_VERSION;
+  h->nodes = _nodes;
+  h->slots = slots;
+  h->node_off = node_off;
+  h->ring_off = ring_off;
+  h->size = size;
+  ORBITAirParams_t none = {0};
+  params_store(h, _p ? _p : &none);
+  atomic_store_explicit(&h->magic, ORBITAIR_MAGIC, memory_order_release);
+  munmap(m, size);
+  return 0;
+}
+
+int ORBITAir_attach(ORBITAir_t *_a, const char *_path, int _node) {
+  struct stat st;
+  memset(_a, 0, sizeof(*_a));
+  _a->fd = open(_path, O_RDWR | O_CLOEXEC);
+  if (_a->fd < 0 || fstat(_a->fd, &st) != 0 || (size_t)st.st_size < sizeof(ORBITAirHeader_t)) {
+    goto fail;
+  }
+  _a->size = (size_t)st.st_size;
+  void *m = mmap(NULL, _a->size, PROT_READ | PROT_WRITE, MAP_SHARED, _a->fd, 0);
+  if (m == MAP_FAILED) {
+    goto fail;
+  }
+  _a->map = m;
+  _a->hdr = m;
+  ORBITAirHeader_t *h = _a->hdr;
+  if (atomic_load_explicit(&h->magic, memory_order_acquire) != ORBITAIR_MAGIC || h->version != ORBITAIR_VERSION ||
+      h->size != _a->size || h->nodes == 0 || h->nodes > ORBITAIR_MAX_NODES) {
+    goto fail;
+  }
+  _a->node = (ORBITAirNode_t *)(_a->map + h->node_off);
+  _a->ring = (ORBITAirSlot_t *)(_a->map + h->ring_off);
+
+  uint32_t from = _node < 0 ? 0 : (uint32_t)_node, to = _node < 0 ? h->nodes : (uint32_t)_node + 1;
+  uint32_t self = UINT32_MAX;
+  for (uint32_t i = from; i < to && i < h->nodes; i++) {
+    uint32_t expect = 0;
+    if (atomic_compare_exchange_strong(&_a->node[i].state, &expect, 1)) {
+      self = i;
+      break;
+    }
+  }
+  if (self == UINT32_MAX) {
+    goto fail;
+  }
+  _a->self = (uint16_t)self;
+  ORBITAirNode_t *me = &_a->node[self];
+  atomic_store_explicit(&me->pid, (int32_t)getpid(), memory_order_relaxed);
+  atomic_store_explicit(&me->x, f2u(0.0f), memory_order_relaxed);
+  atomic_store_explicit(&me->y, f2u(0.0f), memory_order_relaxed);
+  atomic_store_explicit(&me->range, f2u(0.0f), memory_order_relaxed);
+  /* only frames sent from now on */
+  for (uint32_t i = 0; i < h->nodes; i++) {
+    _a->cursor[i] = atomic_load_explicit(&_a->node[i].head, memory_order_acquire);
+  }
+  if (getrandom(&_a->rng, sizeof(_a->rng), 0) != sizeof(_a->rng)) {
+    _a->rng = (uint64_t)getpid() * 0x9E3779B97F4A7C15ull ^ ORBITAir_now();
+  }
+  _a->rng |= 1;
+  return 0;
+
+fail:
+  if (_a->map != NULL) {
+    munmap(_a->map, _a->size);
+  }
+  if (_a->fd >= 0) {
+    close(_a->fd);
+  }
+  memset(_a, 0, sizeof(*_a));
+  _a->fd = -1;
+  return -1;
+}
+
+uint64_t ORBITAir_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void ORBITAir_detach(ORBITAir_t *_a) {
+  if (_a->map == NULL) {
+    return;
+  }
+  atomic_store_explicit(&_a->node[_a->self].pid, 0, memory_order_relaxed);
+  atomic_store_explicit(&_a->node[_a->self].state, 0, memory_order_release);
+  munmap(_a->map, _a->size);
+  close(_a->fd);
+  memset(_a, 0, sizeof(*_a));
+  _a->fd = -1;
+}
+
+void ORBITAir_set_params(ORBITAir_t *_a, const ORBITAirParams_t *_p) {
+  params_store(_a->hdr, _p);
+}
+
+void ORBITAir_get_params(const ORBITAir_t *_a, ORBITAirParams_t *_p) {
+  ORBITAirHeader_t *h = _a->hdr;
+  _p->loss_ppm = atomic_load_explicit(&h->loss_ppm, memory_order_relaxed);
+  _p->ber_ppb = atomic_load_explicit(&h->ber_ppb, memory_order_relaxed);
+  _p->noise_ppm = atomic_load_explicit(&h->noise_ppm, memory_order_relaxed);
+  _p->latency_ns = atomic_load_explicit(&h->latency_ns, memory_order_relaxed);
+  _p->bitrate_bps = atomic_load_explicit(&h->bitrate_bps, memory_order_relaxed);
+  _p->backlog_ns = atomic_load_explicit(&h->backlog_ns, memory_order_relaxed);
+}
+
+void ORBITAir_set_position(ORBITAir_t *_a, float _x, float _y, float _range) {
+  ORBITAirNode_t *me = &_a->node[_a->self];
+  atomic_store_explicit(&me->x, f2u(_x), memory_order_relaxed);
+  atomic_store_explicit(&me->y, f2u(_y), memory_order_relaxed);
+  atomic_store_explicit(&me->range, f2u(_range), memory_order_relaxed);
+}
+
+
+/* --------------------------------- TX ---------------------------------- */
+
+bool ORBITAir_send(ORBITAir_t *_a, const L2Frame *_frame, uint64_t _now_ns) {
+  ORBITAirHeader_t *h = _a->hdr;
+  ORBITAirNode_t *me = &_a->node[_a->self];
+  uint64_t bps = atomic_load_explicit(&h->bitrate_bps, memory_order_relaxed);
+  uint64_t start = _a->busy_until > _now_ns ? _a->busy_until : _now_ns;
+  if (start - _now_ns > atomic_load_explicit(&h->backlog_ns, memory_order_relaxed)) {
+    atomic_store_explicit(&me->refused, atomic_load_explicit(&me->refused, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    return false;
+  }
+  uint64_t airtime = bps ? (uint64_t)(FRAME_BITS * 1e9 / (double)bps) : 0;
+  _a->busy_until = start + airtime;
+
+  uint64_t pos = atomic_load_explicit(&me->head, memory_order_relaxed);
+  ORBITAirSlot_t *s = air_slot(_a, _a->self, pos);
+  atomic_store_explicit(&s->seq, 2 * pos + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  s->ready_ns = _a->busy_until + atomic_load_explicit(&h->latency_ns, memory_order_relaxed);
+  s->tx_ns = _now_ns;
+  memcpy(&s->frame, _frame, sizeof(L2Frame));
+  atomic_store_explicit(&s->seq, 2 * pos + 2, memory_order_release);
+  atomic_store_explicit(&me->head, pos + 1, memory_order_release);
+  atomic_store_explicit(&me->sent, atomic_load_explicit(&me->sent, memory_order_relaxed) + 1, memory_order_relaxed);
+  return true;
+}
+
+
+/* --------------------------------- RX ---------------------------------- */
+
+static bool in_range(const ORBITAirNode_t *_tx, const ORBITAirNode_t *_rx) {
+  float range = u2f(atomic_load_explicit(&_tx->range, memory_order_relaxed));
+  if (!(range > 0.0f)) {
+    return true;
+  }
+  float dx = u2f(atomic_load_explicit(&_tx->x, memory_order_relaxed)) -
+             u2f(atomic_load_explicit(&_rx->x, memory_order_relaxed));
+  float dy = u2f(atomic_load_explicit(&_tx->y, memory_order_relaxed)) -
+             u2f(atomic_load_explicit(&_rx->y, memory_order_relaxed));
+  return dx * dx + dy * dy <= range * range;
+}
+
+/* Flips bits of _f at _ber_ppb as one Poisson process over every received bit */
+static uint16_t air_flip(ORBITAir_t *_a, L2Frame *_f, uint32_t _ber_ppb) {
+  if (_ber_ppb == 0) {
+    return 0;
+  }
+  double p = _ber_ppb * 1e-9;
+  if (_a->ber_seen != _ber_ppb) {
+    _a->ber_seen = _ber_ppb;
+    _a->ber_left = -log(air_unit(_a)) / p;
+  }
+  uint16_t flips = 0;
+  double bit = 0.0;
+  while (bit + _a->ber_left < FRAME_BITS) {
+    bit += _a->ber_left;
+    uint32_t b = (uint32_t)bit;
+    ((uint8_t *)_f)[b >> 3] ^= (uint8_t)(1u << (b & 7));
+    flips++;
+    bit += 1.0;
+    _a->ber_left = -log(air_unit(_a)) / p;
+  }
+  _a->ber_left -= FRAME_BITS - bit;
+  return flips;
+}
+
+size_t ORBITAir_recv(ORBITAir_t *_a, L2Frame *_out, ORBITAirRxMeta_t *_meta, size_t _max, uint64_t _now_ns) {
+  ORBITAirHeader_t *h = _a->hdr;
+  const ORBITAirNode_t *me = &_a->node[_a->self];
+  uint32_t nodes = h->nodes, slots = h->slots;
+  uint32_t loss = atomic_load_explicit(&h->loss_ppm, memory_order_relaxed);
+  uint32_t ber = atomic_load_explicit(&h->ber_ppb, memory_order_relaxed);
+  size_t n = 0;
+
+  for (uint32_t k = 0; k < nodes && n < _max; k++) {
+    uint32_t src = (_a->rr + k) % nodes;
+    const ORBITAirNode_t *tx = &_a->node[src];
+    uint64_t head = atomic_load_explicit(&tx->head, memory_order_acquire);
+    uint64_t *cur = &_a->cursor[src];
+    if (src == _a->self || atomic_load_explicit(&tx->state, memory_order_relaxed) == 0 || !in_range(tx, me)) {
+      *cur = head;                          // not heard: nothing to catch up on later
+      continue;
+    }
+    if (head - *cur > slots) {
+      _a->stats.overrun += head - slots - *cur;
+      *cur = head - slots;
+    }
+    while (*cur < head && n < _max) {
+      const ORBITAirSlot_t *s = air_slot(_a, src, *cur);
+      uint64_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+      if (seq != 2 * *cur + 2) {
+        _a->stats.overrun++;                // lapped while we looked
+        (*cur)++;
+        continue;
+      }
+      uint64_t ready = s->ready_ns, tx_ns = s->tx_ns;
+      if (ready > _now_ns) {
+        break;                              // in order per sender: the rest is later still
+      }
+      memcpy(&_out[n], &s->frame, sizeof(L2Frame));
+      atomic_thread_fence(memory_order_acquire);
+      if (atomic_load_explicit(&s->seq, memory_order_relaxed) != seq) {
+        _a->stats.overrun++;
+        (*cur)++;
+        continue;
+      }
+      (*cur)++;
+      if (loss != 0 && air_rng(_a) % 1000000u < loss) {
+        _a->stats.lost++;
+        continue;
+      }
+      uint16_t flips = air_flip(_a, &_out[n], ber);
+      _a->stats.bit_errors += flips;
+      _a->stats.corrupted += flips != 0;
+      _a->stats.received++;
+      if (_meta != NULL) {
+        _meta[n] = (ORBITAirRxMeta_t){ .src = (uint16_t)src, .flips = flips, .tx_ns = tx_ns, .ready_ns = ready };
+      }
+      n++;
+    }
+  }
+  _a->rr = (uint16_t)((_a->rr + 1) % nodes);
+  return n;
+}
+
+size_t ORBITAir_recv_bytes(ORBITAir_t *_a, uint8_t *_buf, size_t _cap, uint64_t _now_ns) {
+  uint32_t noise = atomic_load_explicit(&_a->hdr->noise_ppm, memory_order_relaxed);
+  size_t len = 0;
+  L2Frame f;
+  while (_cap - len >= ORBITAIR_NOISE_MAX + sizeof(L2Frame) && ORBITAir_recv(_a, &f, NULL, 1, _now_ns) == 1) {
+    if (noise != 0 && air_rng(_a) % 1000000u < noise) {
+      uint32_t burst = 1 + (uint32_t)(air_rng(_a) % ORBITAIR_NOISE_MAX);
+      for (uint32_t i = 0; i < burst; i++) {
+        _buf[len++] = (uint8_t)air_rng(_a);
+      }
+      _a->stats.noise_bytes += burst;
+    }
+    memcpy(_buf + len, &f, sizeof(L2Frame));
+    len += sizeof(L2Frame);
+  }
+  return len;
+}
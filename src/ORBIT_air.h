@@ -0,0 +1,191 @@
+/*
+ * File:        src/ORBIT_air.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Virtual "air" for Radio_ORBIT: a shared-memory broadcast medium so
+ *    real node processes on one Linux box can talk L2 to each other, with
+ *    range, loss, bit errors, latency and a bitrate cap.
+ *
+ *
+ *  One file (e.g. /dev/shm/orbit_air) mapped by every node process:
+ *
+ *  | Offset   | Block                                                    |
+ *  ----------------------------------------------------------------------
+ *  | 0        | ORBITAirHeader_t: layout, impairment parameters          |
+ *  | node_off | ORBITAirNode_t[nodes]: attached, position, range, head   |
+ *  | ring_off | ORBITAirSlot_t[nodes][slots]: one TX ring per node       |
+ *
+ *  Every node writes only its own ring and every receiver keeps its own
+ *  cursor per sender in its process, so nothing is ever locked or CASed
+ *  on the frame path:
+ *
+ *   node A: send() --> ring A [seq|ready|frame] ...  head A
+ *                          |          \
+ *                 node B cursor[A]    node C cursor[A]      recv(): per frame
+ *                                                           range, loss, BER
+ *
+ *  A slot is a seqlock: seq = 2 * pos + 1 while written, 2 * pos + 2 once
+ *  published. A receiver more than `slots` frames behind loses the oldest
+ *  (counted as overrun), exactly like a radio that was not listening; the
+ *  sender never waits.
+ *
+ *  Timing: a frame occupies the sender's channel for 224 * 8 / bitrate s
+ *  after the previous one ends, and is deliverable latency_ns after that.
+ *  A sender more than backlog_ns of air time ahead is refused.
+ *
+ *  Reception (per receiver, independent draws):
+ *   - heard only when distance(sender, receiver) <= sender range
+ *     (range <= 0: everywhere)
+ *   - lost with loss_ppm per frame
+ *   - bits flipped at ber_ppb (Poisson over the bit stream)
+ *   - recv_bytes(): frames back to back as a serial modem delivers them,
+ *     with a burst of random bytes before a frame at noise_ppm, for
+ *     L2Deframer CRC / resync work
+ *
+ * NOTE:
+ *   - One ORBITAir_t per node and per thread; a process may attach several.
+ *   - Parameters are shared: ORBITAir_set_params() from any node applies
+ *     to every receiver from its next recv.
+ *   - Times are CLOCK_MONOTONIC ns (ORBITAir_now()), common to processes.
+ *
+ */
+
+#ifndef ORBIT_AIR_H
+#define ORBIT_AIR_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define ORBITAIR_MAGIC      0x4F524941u     // "ORIA"
+#define ORBITAIR_VERSION    1
+#define ORBITAIR_MAX_NODES  64
+#define ORBITAIR_NOISE_MAX  16              // bytes in one noise burst
+
+
+typedef struct {
+  uint32_t loss_ppm;                        // frames lost per million, per receiver
+  uint32_t ber_ppb;                         // bit errors per 1e9 bits
+  uint32_t noise_ppm;                       // recv_bytes: noise bursts per million frames
+  uint64_t latency_ns;
+  uint64_t bitrate_bps;                     // 0 = unlimited
+  uint64_t backlog_ns;                      // sender queue in air time, 0 -> 100 ms
+} ORBITAirParams_t;
+
+
+typedef struct {
+  _Alignas(64) _Atomic uint32_t magic;      // written last by ORBITAir_create()
+  uint32_t         version;
+  uint32_t         nodes;
+  uint32_t         slots;                   // per ring, power of 2
+  uint64_t         node_off;
+  uint64_t         ring_off;
+  uint64_t         size;
+  _Atomic uint32_t loss_ppm;
+  _Atomic uint32_t ber_ppb;
+  _Atomic uint32_t noise_ppm;
+  _Atomic uint64_t latency_ns;
+  _Atomic uint64_t bitrate_bps;
+  _Atomic uint64_t backlog_ns;
+} ORBITAirHeader_t;
+
+
+typedef struct {
+  _Alignas(64) _Atomic uint32_t state;      // 0 free, 1 attached
+  _Atomic int32_t  pid;
+  _Atomic uint32_t x, y, range;             // float bits, metres
+  _Alignas(64) _Atomic uint64_t head;       // frames published, ever
+  _Atomic uint64_t sent;
+  _Atomic uint64_t refused;                 // backlog full
+} ORBITAirNode_t;
+
+
+typedef struct {
+  _Atomic uint64_t seq;
+  uint64_t         ready_ns;                // deliverable from
+  uint64_t         tx_ns;                   // handed to send()
+  uint8_t          rsv[8];
+  L2Frame          frame;
+} ORBITAirSlot_t;
+
+STATIC_ASSERT(sizeof(ORBITAirSlot_t) == 256, ORBITAirSlot_t_must_be_256_bytes);
+
+
+typedef struct {
+  uint64_t received;
+  uint64_t lost;                            // loss_ppm
+  uint64_t overrun;                         // overwritten before read
+  uint64_t bit_errors;                      // bits flipped
+  uint64_t corrupted;                       // frames with at least one flip
+  uint64_t noise_bytes;
+} ORBITAirStats_t;
+
+
+/* Per received frame */
+typedef struct {
+  uint16_t src;                             // sender node
+  uint16_t flips;                           // bits flipped in this copy
+  uint64_t tx_ns;
+  uint64_t ready_ns;
+} ORBITAirRxMeta_t;
+
+
+typedef struct {
+  int                     fd;
+  uint8_t                *map;
+  size_t                  size;
+  ORBITAirHeader_t       *hdr;
+  ORBITAirNode_t         *node;
+  ORBITAirSlot_t         *ring;
+  uint16_t                self;
+  uint16_t                rr;               // first sender looked at next recv
+  uint64_t                busy_until;       // own channel, ns
+  uint64_t                cursor[ORBITAIR_MAX_NODES];
+  uint64_t                rng;
+  double                  ber_left;         // bits until the next error
+  uint32_t                ber_seen;         // ber_ppb ber_left was drawn for
+  ORBITAirStats_t         stats;
+} ORBITAir_t;
+
+
+/* CLOCK_MONOTONIC in ns, the clock _now_ns arguments are read on. */
+uint64_t ORBITAir_now(void);
+
+/* Creates (or replaces) the medium file. _slots rounded up to a power of 2, 0 -> 4096. Returns 0, or -1. */
+int  ORBITAir_create(const char *_path, uint32_t _nodes, uint32_t _slots, const ORBITAirParams_t *_p);
+
+/* Attaches as node _node, or the first free one when _node < 0. Returns 0, or -1 (taken / full / bad file). */
+int  ORBITAir_attach(ORBITAir_t *_a, const char *_path, int _node);
+void ORBITAir_detach(ORBITAir_t *_a);
+
+void ORBITAir_set_params(ORBITAir_t *_a, const ORBITAirParams_t *_p);
+void ORBITAir_get_params(const ORBITAir_t *_a, ORBITAirParams_t *_p);
+
+/* Own position and transmit range (metres, range <= 0: heard everywhere) */
+void ORBITAir_set_position(ORBITAir_t *_a, float _x, float _y, float _range);
+
+/* Broadcasts one frame sent at _now_ns. false when the backlog is full. */
+bool ORBITAir_send(ORBITAir_t *_a, const L2Frame *_frame, uint64_t _now_ns);
+
+/* Up to _max frames deliverable at _now_ns, from every sender in range. _meta optional. */
+size_t ORBITAir_recv(ORBITAir_t *_a, L2Frame *_out, ORBITAirRxMeta_t *_meta, size_t _max, uint64_t _now_ns);
+
+/* As recv(), as a byte stream with noise bursts; whole frames only. Returns bytes. */
+size_t ORBITAir_recv_bytes(ORBITAir_t *_a, uint8_t *_buf, size_t _cap, uint64_t _now_ns);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_AIR_H
@@ -0,0 +1,79 @@
+/*
+ * File:        src/ORBIT_bytes.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Byte-order helpers for Radio_ORBIT.
+ *    Every multi-byte field kept as uint8_t[] in the frame / table structs
+ *    (TTL, SEQ, TimeStamp, NodesLimit, last_rssi, last_seen_time, hops, ...)
+ *    is big-endian, same as L2Frame.ChkSum.
+ *
+ */
+
+#ifndef ORBIT_BYTES_H
+#define ORBIT_BYTES_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+static inline uint16_t ORBIT_load_be16(const uint8_t *_p) {
+  uint16_t v;
+  memcpy(&v, _p, 2);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap16(v);
+#endif
+  return v;
+}
+
+static inline uint32_t ORBIT_load_be32(const uint8_t *_p) {
+  uint32_t v;
+  memcpy(&v, _p, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+static inline uint64_t ORBIT_load_be64(const uint8_t *_p) {
+  uint64_t v;
+  memcpy(&v, _p, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static inline void ORBIT_store_be16(uint8_t *_p, uint16_t _v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  _v = __builtin_bswap16(_v);
+#endif
+  memcpy(_p, &_v, 2);
+}
+
+static inline void ORBIT_store_be32(uint8_t *_p, uint32_t _v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  _v = __builtin_bswap32(_v);
+#endif
+  memcpy(_p, &_v, 4);
+}
+
+static inline void ORBIT_store_be64(uint8_t *_p, uint64_t _v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  _v = __builtin_bswap64(_v);
+#endif
+  memcpy(_p, &_v, 8);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_BYTES_H
@@ -0,0 +1,491 @@
+/*
+ * File:        src/ORBIT_capture.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Field capture of raw L2 frames to pcapng for Radio_ORBIT.
+ *    See ORBIT_capture.h
+ *
+ */
+
+#define _GNU_SOURCE
+#include "ORBIT_capture.h"
+#include "ORBIT_bytes.h"
+#include "ORBIT_schema.h"
+#include "L2_crc32.h"
+#include "L2D5_classify.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PCAPNG_SHB      0x0A0D0D0Au
+#define PCAPNG_IDB      0x00000001u
+#define PCAPNG_EPB      0x00000006u
+#define PCAPNG_BOM      0x1A2B3C4Du
+#define OPT_ENDOFOPT    0
+#define OPT_SHB_USERAPPL 4
+#define OPT_IF_NAME     2
+#define OPT_IF_TSRESOL  9
+
+STATIC_ASSERT(ORBITCAP_EPB_BYTES == 264 && ORBITCAP_EPB_BYTES % 4 == 0, ORBITCAP_EPB_BYTES_fixed_and_aligned);
+STATIC_ASSERT(ORBITCAP_DECODE_BATCH <= L2D5CLS_MAX, ORBITCAP_DECODE_BATCH_fits_one_classify_call);
+
+
+/* ------------------------------- blocks -------------------------------- */
+
+/* pcapng integers are host byte order */
+static inline void put16(uint8_t *_p, uint16_t _v) { memcpy(_p, &_v, 2); }
+static inline void put32(uint8_t *_p, uint32_t _v) { memcpy(_p, &_v, 4); }
+static inline uint16_t get16(const uint8_t *_p) { uint16_t v; memcpy(&v, _p, 2); return v; }
+static inline uint32_t get32(const uint8_t *_p) { uint32_t v; memcpy(&v, _p, 4); return v; }
+
+static size_t put_opt(uint8_t *_p, uint16_t _code, const void *_val, uint16_t _len) {
+  size_t padded = (_len + 3u) & ~3u;
+  put16(_p, _code);
+  put16(_p + 2, _len);
+  memset(_p + 4, 0, padded);
+  if (_len != 0) {
+    memcpy(_p + 4, _val, _len);
+  }
+  return 4 + padded;
+}
+
+/* Type, total length at both ends around _body_len bytes already at _p + 8 */
+static size_t close_block(uint8_t *_p, uint32_t _type, size_t _body_len) {
+  uint32_t total = (uint32_t)(8 + _body_len + 4);
+  put32(_p, _type);
+  put32(_p + 4, total);
+  put32(_p + 8 + _body_len, total);
+  return total;
+}
+
+/* SHB + one IDB per lane */
+static size_t cap_header(const ORBITCap_t *_c, uint8_t *_out) {
+  static const char appl[] = "Radio_ORBIT";
+  uint8_t *p = _out;
+  size_t n = 0;
+
+  put32(p + 8, PCAPNG_BOM);
+  put16(p + 12, 1);
+  put16(p + 14, 0);
+  memset(p + 16, 0xFF, 8);                  // section length unknown
+  n = 16;
+  n += put_opt(p + 8 + n, OPT_SHB_USERAPPL, appl, sizeof(appl) - 1);
+  n += put_opt(p + 8 + n, OPT_ENDOFOPT, NULL, 0);
+  p += close_block(p, PCAPNG_SHB, n);
+
+  for (uint16_t k = 0; k < _c->cfg.lanes; k++) {
+    char name[16];
+    uint8_t tsresol = 9;
+    int len = snprintf(name, sizeof(name), "orbit%u", k);
+    put16(p + 8, ORBITCAP_LINKTYPE);
+    put16(p + 10, 0);
+    put32(p + 12, (uint32_t)ORBITCAP_DATA_BYTES);
+    n = 8;
+    n += put_opt(p + 8 + n, OPT_IF_NAME, name, (uint16_t)len);
+    n += put_opt(p + 8 + n, OPT_IF_TSRESOL, &tsresol, 1);
+    n += put_opt(p + 8 + n, OPT_ENDOFOPT, NULL, 0);
+    p += close_block(p, PCAPNG_IDB, n);
+  }
+  return (size_t)(p - _out);
+}
+
+
+/* ------------------------------- writer -------------------------------- */
+
+static void cap_name(const ORBITCap_t *_c, uint32_t _seq, char *_out) {
+  if (_c->cfg.file_bytes == 0) {
+    snprintf(_out, _c->name_len, "%s", _c->cfg.path);
+  } else {
+    snprintf(_out, _c->name_len, "%s.%u", _c->cfg.path, _seq);
+  }
+}
+
+static int cap_write_all(ORBITCap_t *_c, const uint8_t *_p, size_t _n) {
+  while (_n != 0) {
+    ssize_t w = write(_c->fd, _p, _n);
+    if (w < 0 && errno == EINTR) {
+      continue;
+    }
+    if (w <= 0) {
+      _c->write_errors++;
+      return -1;
+    }
+    _p += w;
+    _n -= (size_t)w;
+    _c->file_written += (uint64_t)w;
+  }
+  return 0;
+}
+
+static int cap_file_open(ORBITCap_t *_c) {
+  uint8_t hdr[64 + ORBITCAP_MAX_LANES * 64];
+  cap_name(_c, _c->seq, _c->name);
+  _c->fd = open(_c->name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (_c->fd < 0) {
+    return -1;
+  }
+  _c->file_written = 0;
+  return cap_write_all(_c, hdr, cap_header(_c, hdr));
+}
+
+static void cap_rotate(ORBITCap_t *_c) {
+  close(_c->fd);
+  _c->seq++;
+  _c->rotations++;
+  if (cap_file_open(_c) != 0) {
+    _c->write_errors++;
+  }
+  if (_c->cfg.files != 0 && _c->seq >= _c->cfg.files) {
+    cap_name(_c, _c->seq - _c->cfg.files, _c->name + _c->name_len);
+    unlink(_c->name + _c->name_len);
+  }
+}
+
+/* _n bytes of whole EPBs; split at block boundaries when rotating */
+static void cap_write(ORBITCap_t *_c, const uint8_t *_p, size_t _n) {
+  while (_n != 0) {
+    size_t take = _n;
+    if (_c->cfg.file_bytes != 0) {
+      if (_c->file_written >= _c->cfg.file_bytes) {
+        cap_rotate(_c);
+      }
+      uint64_t room = _c->cfg.file_bytes > _c->file_written ? _c->cfg.file_bytes - _c->file_written : 0;
+      size_t fit = (size_t)(room / ORBITCAP_EPB_BYTES) * ORBITCAP_EPB_BYTES;
+      take = fit == 0 ? ORBITCAP_EPB_BYTES : fit < _n ? fit : _n;
+    }
+    if (_c->fd >= 0 && cap_write_all(_c, _p, take) == 0) {
+      _c->written += take / ORBITCAP_EPB_BYTES;
+    }
+    _p += take;
+    _n -= take;
+  }
+}
+
+/* Every buffer handed off so far, lane by lane, in the order they were filled */
+static void cap_drain(ORBITCap_t *_c) {
+  for (uint16_t k = 0; k < _c->cfg.lanes; k++) {
+    ORBITCapLane_t *l = &_c->lane[k];
+    uint32_t n;
+    while ((n = atomic_load_explicit(&l->len[l->next], memory_order_acquire)) != 0) {
+      cap_write(_c, l->buf[l->next], n);
+      atomic_store_explicit(&l->len[l->next], 0, memory_order_release);
+      l->next ^= 1;
+    }
+  }
+}
+
+static void *cap_writer(void *_arg) {
+  ORBITCap_t *c = _arg;
+  for (;;) {
+    while (sem_wait(&c->ready) != 0 && errno == EINTR) {
+    }
+    bool stop = atomic_load_explicit(&c->stop, memory_order_acquire);
+    cap_drain(c);
+    if (stop) {
+      return NULL;
+    }
+  }
+}
+
+
+/* ------------------------------ lifecycle ------------------------------ */
+
+int ORBITCap_open(ORBITCap_t *_c, const ORBITCapConfig_t *_cfg) {
+  memset(_c, 0, sizeof(*_c));
+  _c->fd = -1;
+  if (_cfg->path == NULL || _cfg->lanes == 0 || _cfg->lanes > ORBITCAP_MAX_LANES) {
+    return -1;
+  }
+  _c->cfg = *_cfg;
+  _c->cfg.buf_bytes = _cfg->buf_bytes ? _cfg->buf_bytes : 1u << 20;
+  _c->cfg.flush_ns = _cfg->flush_ns ? _cfg->flush_ns : 100000000ull;
+  _c->cap = (_c->cfg.buf_bytes / ORBITCAP_EPB_BYTES ? _c->cfg.buf_bytes / ORBITCAP_EPB_BYTES : 1) *
+            ORBITCAP_EPB_BYTES;
+  _c->name_len = strlen(_cfg->path) + 16;
+  _c->name = malloc(2 * _c->name_len);     // current file, then scratch for the oldest
+  _c->lane = aligned_alloc(64, sizeof(ORBITCapLane_t) * _c->cfg.lanes);
+  if (_c->name == NULL || _c->lane == NULL) {
+    free(_c->name);
+    free(_c->lane);
+    return -1;
+  }
+  memset(_c->lane, 0, sizeof(ORBITCapLane_t) * _c->cfg.lanes);
+  int rc = 0;
+  for (uint16_t k = 0; k < _c->cfg.lanes; k++) {
+    for (int i = 0; i < 2; i++) {
+      _c->lane[k].buf[i] = malloc(_c->cap);
+      rc |= _c->lane[k].buf[i] == NULL ? -1 : 0;
+    }
+  }
+  if (rc != 0 || sem_init(&_c->ready, 0, 0) != 0) {
+    goto fail;
+  }
+  if (cap_file_open(_c) != 0 || pthread_create(&_c->thread, NULL, cap_writer, _c) != 0) {
+    sem_destroy(&_c->ready);
+    goto fail;
+  }
+  return 0;
+
+fail:
+  if (_c->fd >= 0) {
+    close(_c->fd);
+  }
+  for (uint16_t k = 0; k < _c->cfg.lanes; k++) {
+    free(_c->lane[k].buf[0]);
+    free(_c->lane[k].buf[1]);
+  }
+  free(_c->lane);
+  free(_c->name);
+  memset(_c, 0, sizeof(*_c));
+  return -1;
+}
+
+static void cap_handoff(ORBITCap_t *_c, ORBITCapLane_t *_l) {
+  atomic_store_explicit(&_l->len[_l->cur], _l->fill, memory_order_release);
+  sem_post(&_c->ready);
+  _l->cur ^= 1;
+  _l->fill = 0;
+}
+
+void ORBITCap_close(ORBITCap_t *_c) {
+  if (_c->lane == NULL) {
+    return;
+  }
+  for (uint16_t k = 0; k < _c->cfg.lanes; k++) {
+    if (_c->lane[k].fill != 0) {
+      cap_handoff(_c, &_c->lane[k]);
+    }
+  }
+  atomic_store_explicit(&_c->stop, true, memory_order_release);
+  sem_post(&_c->ready);
+  pthread_join(_c->thread, NULL);
+  sem_destroy(&_c->ready);
+  if (_c->fd >= 0) {
+    close(_c->fd);
+  }
+  for (uint16_t k = 0; k < _c->cfg.lanes; k++) {
+    free(_c->lane[k].buf[0]);
+    free(_c->lane[k].buf[1]);
+  }
+  free(_c->lane);
+  free(_c->name);
+  _c->lane = NULL;
+  _c->name = NULL;
+  _c->fd = -1;
+}
+
+
+/* ------------------------------- producer ------------------------------ */
+
+static inline void lane_add(_Atomic uint64_t *_c) {
+  atomic_store_explicit(_c, atomic_load_explicit(_c, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+bool ORBITCap_frame(ORBITCap_t *_c, uint16_t _lane, const L2Frame *_frame, uint64_t _t_ns, int32_t _rssi) {
+  ORBITCapLane_t *l = &_c->lane[_lane];
+  if (atomic_load_explicit(&l->len[l->cur], memory_order_acquire) != 0) {
+    lane_add(&l->dropped);
+    return false;
+  }
+  if (l->fill == 0) {
+    l->first_ns = _t_ns;
+  }
+  uint8_t *p = l->buf[l->cur] + l->fill;
+  put32(p, PCAPNG_EPB);
+  put32(p + 4, ORBITCAP_EPB_BYTES);
+  put32(p + 8, _lane);
+  put32(p + 12, (uint32_t)(_t_ns >> 32));
+  put32(p + 16, (uint32_t)_t_ns);
+  put32(p + 20, (uint32_t)ORBITCAP_DATA_BYTES);
+  put32(p + 24, (uint32_t)ORBITCAP_DATA_BYTES);
+  p[28] = 'O';
+  p[29] = ORBITCAP_VERSION;
+  p[30] = p[31] = 0;
+  ORBIT_store_be32(p + 32, (uint32_t)_rssi);
+  memcpy(p + 28 + ORBITCAP_PSEUDO_BYTES, _frame, sizeof(L2Frame));
+  put32(p + ORBITCAP_EPB_BYTES - 4, ORBITCAP_EPB_BYTES);
+  l->fill += ORBITCAP_EPB_BYTES;
+  lane_add(&l->captured);
+  if (l->fill + ORBITCAP_EPB_BYTES > _c->cap) {
+    cap_handoff(_c, l);
+  }
+  return true;
+}
+
+void ORBITCap_poll(ORBITCap_t *_c, uint16_t _lane, uint64_t _now_ns) {
+  ORBITCapLane_t *l = &_c->lane[_lane];
+  if (l->fill != 0 && _now_ns - l->first_ns >= _c->cfg.flush_ns) {
+    cap_handoff(_c, l);
+  }
+}
+
+
+/* ------------------------------- decoder ------------------------------- */
+
+int ORBITCapReader_open(ORBITCapReader_t *_r, const char *_path, bool _check_fcs) {
+  struct stat st;
+  memset(_r, 0, sizeof(*_r));
+  _r->check_fcs = _check_fcs;
+  _r->fd = open(_path, O_RDONLY | O_CLOEXEC);
+  if (_r->fd < 0 || fstat(_r->fd, &st) != 0 || st.st_size < 28) {
+    ORBITCapReader_close(_r);
+    return -1;
+  }
+  _r->size = (size_t)st.st_size;
+  void *m = mmap(NULL, _r->size, PROT_READ, MAP_PRIVATE, _r->fd, 0);
+  if (m == MAP_FAILED) {
+    ORBITCapReader_close(_r);
+    return -1;
+  }
+  _r->map = m;
+  madvise(m, _r->size, MADV_SEQUENTIAL);
+  if (get32(_r->map) != PCAPNG_SHB || get32(_r->map + 8) != PCAPNG_BOM) {
+    ORBITCapReader_close(_r);
+    return -1;
+  }
+  return 0;
+}
+
+void ORBITCapReader_close(ORBITCapReader_t *_r) {
+  if (_r->map != NULL) {
+    munmap((void *)_r->map, _r->size);
+  }
+  if (_r->fd >= 0) {
+    close(_r->fd);
+  }
+  memset(_r, 0, sizeof(*_r));
+  _r->fd = -1;
+}
+
+/* IDB: ours when ORBITCAP_LINKTYPE with if_tsresol 9 */
+static bool reader_idb(const uint8_t *_b, uint32_t _len) {
+  if (_len < 20 || get16(_b + 8) != ORBITCAP_LINKTYPE) {
+    return false;
+  }
+  uint8_t tsresol = 6;                      // pcapng default: microseconds
+  for (uint32_t o = 16; o + 4 <= _len - 4;) {
+    uint16_t code = get16(_b + o), olen = get16(_b + o + 2);
+    if (code == OPT_ENDOFOPT || o + 4 + olen > _len - 4) {
+      break;
+    }
+    if (code == OPT_IF_TSRESOL && olen >= 1) {
+      tsresol = _b[o + 4];
+    }
+    o += 4 + ((olen + 3u) & ~3u);
+  }
+  return tsresol == 9;
+}
+
+/* Annotate _n records whose frame / ts / iface / rssi are set */
+static void reader_annotate(ORBITCapReader_t *_r, ORBITCapRecord_t *_rec, size_t _n) {
+  const L2Frame *frames[ORBITCAP_DECODE_BATCH];
+  L2D5ClassBatch_t cls;
+  for (size_t i = 0; i < _n; i++) {
+    frames[i] = _rec[i].frame;
+  }
+  L2D5Cls_batch(frames, _n, &cls);
+  for (size_t i = 0; i < _n; i++) {
+    ORBITCapRecord_t *r = &_rec[i];
+    const L2D5Frame_t *l = (const L2D5Frame_t *)r->frame->Payload;
+    r->cls = cls.cls[i];
+    r->tag = l->TAG;
+    r->pri = cls.pri[i];
+    r->err = L2D5FLAG_GET_ERR(l->FLAG);
+    r->nul = L2D5FLAG_GET_NUL(l->FLAG);
+    /* TAG ENCRYPTED: everything after FLAG is ciphertext (HELLO_PKT_RM included) */
+    r->encrypted = (cls.encrypted >> i) & 1;
+    bool plain = r->cls != L2D5CLS_MALFORMED && !r->encrypted;
+    r->src = plain ? l->SrcAddress : NULL;
+    r->dst = plain ? l->DstAddress : NULL;
+    r->ttl = plain ? L2D5Frame_get_TTL(l) : 0;
+    r->fcs = _r->check_fcs ? L2CRC32_check(r->frame) : 2;
+  }
+}
+
+int ORBITCapReader_next(ORBITCapReader_t *_r, ORBITCapRecord_t *_out, size_t _max) {
+  size_t n = 0, done = 0;
+  while (n < _max && _r->off + 12 <= _r->size) {
+    const uint8_t *b = _r->map + _r->off;
+    uint32_t type = get32(b), len = get32(b + 4);
+    if (len < 12 || len % 4 != 0 || len > _r->size - _r->off || get32(b + len - 4) != len) {
+      break;
+    }
+    if (type == PCAPNG_SHB) {
+      if (len < 28 || get32(b + 8) != PCAPNG_BOM) {
+        break;
+      }
+      _r->ifaces = 0;
+    } else if (type == PCAPNG_IDB) {
+      if (_r->ifaces < sizeof(_r->iface_ok)) {
+        _r->iface_ok[_r->ifaces] = reader_idb(b, len);
+      }
+      _r->ifaces++;
+    } else if (type == PCAPNG_EPB) {
+      uint32_t iface = len >= 32 ? get32(b + 8) : UINT32_MAX;
+      if (iface < _r->ifaces && iface < sizeof(_r->iface_ok) && _r->iface_ok[iface] &&
+          get32(b + 20) == ORBITCAP_DATA_BYTES && len >= 32 + ORBITCAP_DATA_BYTES && b[28] == 'O') {
+        ORBITCapRecord_t *r = &_out[n++];
+        r->ts_ns = (uint64_t)get32(b + 12) << 32 | get32(b + 16);
+        r->iface = iface;
+        r->rssi = (int32_t)ORBIT_load_be32(b + 32);
+        r->frame = (const L2Frame *)(b + 28 + ORBITCAP_PSEUDO_BYTES);
+        if (n - done == ORBITCAP_DECODE_BATCH) {
+          reader_annotate(_r, _out + done, n - done);
+          done = n;
+        }
+      } else {
+        _r->skipped++;
+      }
+    }
+    _r->off += len;
+  }
+  if (n != done) {
+    reader_annotate(_r, _out + done, n - done);
+  }
+  _r->records += n;
+  if (n == 0 && _r->off + 12 <= _r->size) {
+    return -1;                              // stopped on a damaged block
+  }
+  return (int)n;
+}
+
+
+/* ------------------------------- format -------------------------------- */
+
+static char *hex16(char *_p, const uint8_t *_a) {
+  static const char digits[] = "0123456789abcdef";
+  if (_a == NULL) {
+    *_p++ = '-';
+    return _p;
+  }
+  for (int i = 0; i < 16; i++) {
+    *_p++ = digits[_a[i] >> 4];
+    *_p++ = digits[_a[i] & 15];
+  }
+  return _p;
+}
+
+int ORBITCap_format(const ORBITCapRecord_t *_rec, char *_buf, size_t _len) {
+  static const char *const tags[L2D5CLS_CLASSES] = { "HELLO_PKT_NB", "HELLO_PKT_RM", "TCP_DATA_DC", "TCP_DATA_RM",
+                                                     "MALFORMED" };
+  static const char *const errs[4] = { "NML", "DBG", "ERR", "WARN" };
+  static const char *const nuls[4] = { "A", "B", "C", "D" };
+  static const char *const fcs[3] = { "BAD", "ok", "-" };
+  char src[33], dst[33];
+  *hex16(src, _rec->src) = '\0';
+  *hex16(dst, _rec->dst) = '\0';
+  return snprintf(_buf, _len, "%llu.%09llu if%u %ddBm %s(0x%02x)%s pri %u %s NUL_%s %s > %s ttl %u fcs %s",
+                  (unsigned long long)(_rec->ts_ns / 1000000000ull),
+                  (unsigned long long)(_rec->ts_ns % 1000000000ull), _rec->iface, _rec->rssi,
+                  tags[_rec->cls < L2D5CLS_CLASSES ? _rec->cls : L2D5CLS_MALFORMED], _rec->tag,
+                  _rec->encrypted ? " enc" : "", _rec->pri, errs[_rec->err & 3], nuls[_rec->nul & 3], src, dst,
+                  _rec->ttl, fcs[_rec->fcs < 3 ? _rec->fcs : 2]);
+}
@@ -0,0 +1,192 @@
+/*
+ * File:        src/ORBIT_capture.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Field capture of raw L2 frames to pcapng for Radio_ORBIT, and an
+ *    offline batch decoder for the files it writes.
+ *
+ *
+ *  Capture (one lane per RX thread, one pcapng interface per lane):
+ *
+ *   RX k --ORBITCap_frame()--> lane k: [ buf 0 ][ buf 1 ]   EPBs encoded in place
+ *                                         |  full / flush_ns old: len[i] = bytes,
+ *                                         v  sem_post (never blocks)
+ *                                  writer thread: write(2) in lane order,
+ *                                  len[i] = 0, rotate files
+ *
+ *  Both buffers of a lane with the writer: the frame is dropped and
+ *  counted, the RX thread never waits for the disk.
+ *
+ *  Every frame is one fixed-size Enhanced Packet Block (264 bytes), so
+ *  rotation cuts buffers exactly at block boundaries:
+ *
+ *  | EPB header | pseudo-header | L2Frame | total length |
+ *  |     28     |       8       |   224   |      4       |
+ *
+ *  Pseudo-header (LINKTYPE_USER0, ORBITCAP_LINKTYPE):
+ *
+ *  | Offset | Field   | Value                                  |
+ *  ------------------------------------------------------------
+ *  | 0      | magic   | 'O'                                    |
+ *  | 1      | version | ORBITCAP_VERSION                       |
+ *  | 2      | rsv     | 0                                      |
+ *  | 4      | rssi    | int32, big-endian, as given by the RX  |
+ *
+ *  Timestamps are ns (if_tsresol 9) of the caller's clock. Blocks use
+ *  host byte order as pcapng allows; the decoder reads files of its own
+ *  byte order only.
+ *
+ *  Rotation: file_bytes != 0 writes <path>.0, <path>.1, ... each starting
+ *  with its own section header; files != 0 keeps only the newest files.
+ *
+ *  Decoder: mmap, walk the blocks, classify ORBITCAP_DECODE_BATCH frames
+ *  per L2D5Cls_batch() call and fill ORBITCapRecord_t with pointers into
+ *  the mapping (no copy of the frame).
+ *
+ * NOTE:
+ *   - ORBITCap_frame / ORBITCap_poll: one thread per lane.
+ *   - ORBITCap_close() after every producer stopped; it writes what is left.
+ *
+ */
+
+#ifndef ORBIT_CAPTURE_H
+#define ORBIT_CAPTURE_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+#include "L2D5_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define ORBITCAP_LINKTYPE     147           // LINKTYPE_USER0
+#define ORBITCAP_VERSION      1
+#define ORBITCAP_PSEUDO_BYTES 8
+#define ORBITCAP_DATA_BYTES   (ORBITCAP_PSEUDO_BYTES + sizeof(L2Frame))
+#define ORBITCAP_EPB_BYTES    (28 + ORBITCAP_DATA_BYTES + 4)
+#define ORBITCAP_MAX_LANES    16
+#define ORBITCAP_DECODE_BATCH 32
+
+
+typedef struct {
+  const char *path;                         // file, or prefix of <path>.N when rotating
+  uint16_t    lanes;                        // 1 .. ORBITCAP_MAX_LANES
+  uint32_t    buf_bytes;                    // per buffer (two per lane), 0 -> 1 MiB
+  uint64_t    file_bytes;                   // rotate after, 0 = one file
+  uint32_t    files;                        // keep the newest N, 0 = keep all
+  uint64_t    flush_ns;                     // hand off a partial buffer this old, 0 -> 100 ms
+} ORBITCapConfig_t;
+
+
+typedef struct {
+  /* producer */
+  _Alignas(64) uint8_t *buf[2];
+  uint32_t          cur;                    // buffer being filled
+  uint32_t          fill;                   // bytes in buf[cur]
+  uint64_t          first_ns;               // first frame in buf[cur]
+  /* producer -> writer */
+  _Alignas(64) _Atomic uint32_t len[2];     // != 0: with the writer, bytes to write
+  _Atomic uint64_t  captured;
+  _Atomic uint64_t  dropped;                // both buffers with the writer
+  /* writer */
+  _Alignas(64) uint32_t next;               // buffer the writer expects next
+} ORBITCapLane_t;
+
+
+typedef struct {
+  ORBITCapConfig_t cfg;
+  ORBITCapLane_t  *lane;
+  uint32_t         cap;                     // buf_bytes, whole EPBs
+  char            *name;                    // current file name
+  size_t           name_len;                // per name
+
+  /* writer thread */
+  pthread_t        thread;
+  sem_t            ready;
+  _Atomic bool     stop;
+  int              fd;
+  uint32_t         seq;                     // current rotation index
+  uint64_t         file_written;            // bytes in the current file
+  uint64_t         written;                 // frames written, every file
+  uint64_t         rotations;
+  uint64_t         write_errors;
+} ORBITCap_t;
+
+
+/* Creates the (first) file and starts the writer. Returns 0, or -1. */
+int  ORBITCap_open(ORBITCap_t *_c, const ORBITCapConfig_t *_cfg);
+void ORBITCap_close(ORBITCap_t *_c);
+
+/*
+ * Lane owner. Appends one frame received at _t_ns (ns, any epoch) with
+ * _rssi. Never blocks; false when dropped (writer behind).
+ */
+bool ORBITCap_frame(ORBITCap_t *_c, uint16_t _lane, const L2Frame *_frame, uint64_t _t_ns, int32_t _rssi);
+
+/* Lane owner, when idle: hands off a partial buffer older than flush_ns */
+void ORBITCap_poll(ORBITCap_t *_c, uint16_t _lane, uint64_t _now_ns);
+
+
+/* ---------------------------- offline decode ---------------------------- */
+
+typedef struct {
+  const L2Frame *frame;                     // into the mapping
+  const uint8_t *src;                       // L2.5 SrcAddress, NULL when encrypted / malformed
+  const uint8_t *dst;
+  uint64_t       ts_ns;
+  uint32_t       iface;                     // lane / RX port
+  int32_t        rssi;
+  uint8_t        cls;                       // L2D5Class_t
+  uint8_t        tag;                       // raw TAG byte
+  uint8_t        pri;                       // FLAG PRI 0-15
+  uint8_t        err;                       // L2D5FLAG_ERR_t
+  uint8_t        nul;                       // L2D5FLAG_NUL_t
+  uint8_t        encrypted;
+  uint8_t        fcs;                       // 1 ok, 0 bad, 2 not checked
+  uint16_t       ttl;                       // 0 when encrypted / malformed
+} ORBITCapRecord_t;
+
+
+typedef struct {
+  int            fd;
+  const uint8_t *map;
+  size_t         size;
+  size_t         off;                       // next block
+  bool           check_fcs;
+  uint32_t       ifaces;                    // IDBs seen in the current section
+  uint8_t        iface_ok[64];              // ORBITCAP_LINKTYPE with ns resolution
+  uint64_t       records;
+  uint64_t       skipped;                   // EPBs of other link types / sizes
+} ORBITCapReader_t;
+
+
+/* _check_fcs: recompute each frame's CRC32. Returns 0, or -1 (I/O, not pcapng, other byte order). */
+int  ORBITCapReader_open(ORBITCapReader_t *_r, const char *_path, bool _check_fcs);
+void ORBITCapReader_close(ORBITCapReader_t *_r);
+
+/* Up to _max records, in file order. Returns the count, 0 at the end, -1 on a damaged block. */
+int ORBITCapReader_next(ORBITCapReader_t *_r, ORBITCapRecord_t *_out, size_t _max);
+
+/*
+ * One annotated line (no newline) into _buf:
+ *   <sec>.<ns> if<k> <rssi>dBm <TAG> pri <p> <ERR> <NUL> <src> > <dst> ttl <t> fcs <ok|BAD|->
+ * Returns the length (snprintf rules).
+ */
+int ORBITCap_format(const ORBITCapRecord_t *_rec, char *_buf, size_t _len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_CAPTURE_H
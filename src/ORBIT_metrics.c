@@ -0,0 +1,134 @@
+/*
+ * File:        src/ORBIT_metrics.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Per-layer counters, gauges and latency histograms for Radio_ORBIT.
+ *    See ORBIT_metrics.h
+ *
+ */
+
+#include "ORBIT_metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+STATIC_ASSERT(sizeof(ORBITMetricsShard_t) % 64 == 0, ORBITMetricsShard_t_whole_cache_lines);
+STATIC_ASSERT(ORBITM_HIST_BUCKETS - 1 == ((ORBITM_HIST_MAX_EXP - 1 - ORBITM_HIST_SUB_BITS) << ORBITM_HIST_SUB_BITS) +
+                                         2 * ORBITM_HIST_SUB - 1, ORBITM_HIST_BUCKETS_covers_last_octave);
+
+
+typedef struct {
+  const char *name;
+  const char *labels;
+} metrics_counter_desc_t;
+
+#define ORBITM_DESC_C(Id, Name, Labels) { Name, Labels },
+#define ORBITM_DESC_H(Id, Label)        Label,
+static const metrics_counter_desc_t metrics_counters[ORBITM_COUNTERS_N] = { ORBITM_COUNTERS(ORBITM_DESC_C) };
+static const char *const metrics_hists[ORBITM_HISTS_N] = { ORBITM_HISTS(ORBITM_DESC_H) };
+#undef ORBITM_DESC_C
+#undef ORBITM_DESC_H
+
+
+int ORBITMetrics_init(ORBITMetrics_t *_m, uint32_t _shards) {
+  size_t bytes = (size_t)(_shards ? _shards : 1) * sizeof(ORBITMetricsShard_t);
+  memset(_m, 0, sizeof(*_m));
+  _m->shard = aligned_alloc(64, bytes);
+  if (_m->shard == NULL) {
+    return -1;
+  }
+  memset(_m->shard, 0, bytes);
+  _m->shards = _shards ? _shards : 1;
+  return 0;
+}
+
+void ORBITMetrics_free(ORBITMetrics_t *_m) {
+  free(_m->shard);
+  memset(_m, 0, sizeof(*_m));
+}
+
+
+static inline uint64_t ld(const _Atomic uint64_t *_c) {
+  return atomic_load_explicit((_Atomic uint64_t *)_c, memory_order_relaxed);
+}
+
+void ORBITMetrics_snapshot(const ORBITMetrics_t *_m, ORBITMetricsSnap_t *_out) {
+  memset(_out, 0, sizeof(*_out));
+  for (uint32_t s = 0; s < _m->shards; s++) {
+    const ORBITMetricsShard_t *sh = &_m->shard[s];
+    for (int c = 0; c < ORBITM_COUNTERS_N; c++) {
+      _out->counter[c] += ld(&sh->counter[c]);
+    }
+    for (int p = 0; p < ORBITM_PRI_LEVELS; p++) {
+      _out->queue_depth[p] += ld(&sh->queue_depth[p]);
+    }
+    for (int h = 0; h < ORBITM_HISTS_N; h++) {
+      const ORBITMHistogram_t *src = &sh->hist[h];
+      uint64_t max = ld(&src->max);
+      /* quantiles use the bucket sums: count may be a burst ahead of them */
+      for (uint32_t b = 0; b < ORBITM_HIST_BUCKETS; b++) {
+        _out->hist[h].bucket[b] += ld(&src->bucket[b]);
+      }
+      _out->hist[h].count += ld(&src->count);
+      _out->hist[h].sum += ld(&src->sum);
+      _out->hist[h].max = max > _out->hist[h].max ? max : _out->hist[h].max;
+    }
+  }
+}
+
+uint64_t ORBITMetrics_quantile(const ORBITMetricsSnap_t *_s, ORBITMHist_t _h, double _q) {
+  uint64_t total = 0;
+  for (uint32_t b = 0; b < ORBITM_HIST_BUCKETS; b++) {
+    total += _s->hist[_h].bucket[b];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t want = (uint64_t)((double)(total - 1) * (_q < 0 ? 0 : _q > 1 ? 1 : _q)), acc = 0;
+  for (uint32_t b = 0; b < ORBITM_HIST_BUCKETS; b++) {
+    acc += _s->hist[_h].bucket[b];
+    if (acc > want) {
+      return ORBITMetrics_hist_lower(b);
+    }
+  }
+  return ORBITMetrics_hist_lower(ORBITM_HIST_BUCKETS - 1);
+}
+
+
+const char *ORBITMetrics_counter_name(ORBITMCounter_t _c) {
+  return (unsigned)_c < ORBITM_COUNTERS_N ? metrics_counters[_c].name : "?";
+}
+
+const char *ORBITMetrics_hist_name(ORBITMHist_t _h) {
+  return (unsigned)_h < ORBITM_HISTS_N ? metrics_hists[_h] : "?";
+}
+
+int ORBITMetrics_write_text(const ORBITMetricsSnap_t *_s, FILE *_out) {
+  static const double qs[] = { 0.5, 0.9, 0.99, 0.999 };
+  int rc = 0;
+
+  for (int c = 0; c < ORBITM_COUNTERS_N; c++) {
+    const metrics_counter_desc_t *d = &metrics_counters[c];
+    rc |= fprintf(_out, "%s%s%s%s %llu\n", d->name, d->labels[0] ? "{" : "", d->labels, d->labels[0] ? "}" : "",
+                  (unsigned long long)_s->counter[c]) < 0;
+  }
+  for (int p = 0; p < ORBITM_PRI_LEVELS; p++) {
+    rc |= fprintf(_out, "orbit_queue_depth{pri=\"%d\"} %llu\n", p, (unsigned long long)_s->queue_depth[p]) < 0;
+  }
+  for (int h = 0; h < ORBITM_HISTS_N; h++) {
+    const char *st = metrics_hists[h];
+    for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+      rc |= fprintf(_out, "orbit_stage_latency_ns{stage=\"%s\",quantile=\"%g\"} %llu\n", st, qs[i],
+                    (unsigned long long)ORBITMetrics_quantile(_s, (ORBITMHist_t)h, qs[i])) < 0;
+    }
+    rc |= fprintf(_out, "orbit_stage_latency_ns_max{stage=\"%s\"} %llu\n", st,
+                  (unsigned long long)_s->hist[h].max) < 0;
+    rc |= fprintf(_out, "orbit_stage_latency_ns_sum{stage=\"%s\"} %llu\n", st,
+                  (unsigned long long)_s->hist[h].sum) < 0;
+    rc |= fprintf(_out, "orbit_stage_latency_ns_count{stage=\"%s\"} %llu\n", st,
+                  (unsigned long long)_s->hist[h].count) < 0;
+  }
+  return rc ? -1 : 0;
+}
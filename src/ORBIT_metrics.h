@@ -0,0 +1,222 @@
+/*
+ * File:        src/ORBIT_metrics.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Per-layer counters, gauges and latency histograms for Radio_ORBIT,
+ *    cheap enough to stay on in production.
+ *
+ *
+ *  One shard per writing thread (RX k, DISPATCH, ..., TX), each on its own
+ *  cache lines, so a hot path never shares a line with another writer:
+ *
+ *   [shard 0][shard 1] ... [shard n-1]      writers: plain load + store
+ *        \        |            /             (relaxed atomics, no lock
+ *         \       |           /               prefix, no RMW)
+ *          ORBITMetrics_snapshot()            any thread, any time:
+ *                 |                           relaxed loads, summed
+ *          ORBITMetrics_write_text()          "name{label} value" lines
+ *
+ *  Histograms are HDR-style log-linear: 16 linear sub-buckets per power
+ *  of two, so every recorded value is kept within 1/16 (6.25%) of its
+ *  true value from 1 ns up to 2^36 ns (~68 s); larger values land in the
+ *  last bucket. Index = one clz and two shifts.
+ *
+ *  | Value v (ns)    | Bucket                         | Width       |
+ *  ------------------------------------------------------------------
+ *  | 0 .. 31         | v                              | 1           |
+ *  | 2^e .. 2^e+1-1  | (e - 4) * 16 + (v >> (e - 4))  | 2^(e - 4)   |
+ *
+ *  Stages time a whole burst (two clock reads) and record the per-frame
+ *  share once with a weight of n (ORBITMetrics_hist_record_n), so the
+ *  cost per frame is a fraction of one record.
+ *
+ * NOTE:
+ *   - Exactly one writer thread per shard; readers never block writers.
+ *   - A snapshot is not atomic across counters (each one is exact); rates
+ *     from two snapshots are exact.
+ *   - Gauges are summed over shards: each shard owns different queues.
+ *
+ */
+
+#ifndef ORBIT_METRICS_H
+#define ORBIT_METRICS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "L2D5_struct.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define ORBITM_HIST_SUB_BITS 4
+#define ORBITM_HIST_SUB      (1u << ORBITM_HIST_SUB_BITS)
+#define ORBITM_HIST_MAX_EXP  36               // 2^36 ns, last exact octave 2^35
+#define ORBITM_HIST_BUCKETS  ((ORBITM_HIST_MAX_EXP - ORBITM_HIST_SUB_BITS + 1) * ORBITM_HIST_SUB)
+#define ORBITM_PRI_LEVELS    16               // FLAG PRI 0-15
+
+
+/*
+ * Counters: X(Id, name, labels). Every count is frames unless the name
+ * says otherwise.
+ */
+#define ORBITM_COUNTERS(X)                                                         \
+  X(RX_HELLO_NB,    "orbit_rx_frames_total",       "tag=\"HELLO_PKT_NB\"")        \
+  X(RX_HELLO_RM,    "orbit_rx_frames_total",       "tag=\"HELLO_PKT_RM\"")        \
+  X(RX_DATA_DC,     "orbit_rx_frames_total",       "tag=\"TCP_DATA_DC\"")         \
+  X(RX_DATA_RM,     "orbit_rx_frames_total",       "tag=\"TCP_DATA_RM\"")         \
+  X(RX_MALFORMED,   "orbit_rx_frames_total",       "tag=\"malformed\"")           \
+  X(TX_HELLO_NB,    "orbit_tx_frames_total",       "tag=\"HELLO_PKT_NB\"")        \
+  X(TX_HELLO_RM,    "orbit_tx_frames_total",       "tag=\"HELLO_PKT_RM\"")        \
+  X(TX_DATA_DC,     "orbit_tx_frames_total",       "tag=\"TCP_DATA_DC\"")         \
+  X(TX_DATA_RM,     "orbit_tx_frames_total",       "tag=\"TCP_DATA_RM\"")         \
+  X(DELIVERED,      "orbit_delivered_frames_total", "")                           \
+  X(FCS_FAIL,       "orbit_l2_crc_fail_total",     "")                            \
+  X(EFD_FAIL,       "orbit_l2_efd_fail_total",     "")                            \
+  X(RESYNC_BYTES,   "orbit_l2_resync_bytes_total", "")                            \
+  X(POOL_EMPTY,     "orbit_drop_frames_total",     "reason=\"pool_empty\"")       \
+  X(DECRYPT_FAIL,   "orbit_drop_frames_total",     "reason=\"decrypt\"")          \
+  X(TTL_DROP,       "orbit_drop_frames_total",     "reason=\"ttl\"")              \
+  X(NO_ROUTE,       "orbit_drop_frames_total",     "reason=\"no_route\"")         \
+  X(RING_FULL,      "orbit_drop_frames_total",     "reason=\"ring_full\"")        \
+  X(DUP_DROP,       "orbit_drop_frames_total",     "reason=\"dup\"")              \
+  X(KEYS_RX,        "orbit_link_keys_installed_total", "stage=\"decrypt\"")       \
+  X(KEYS_TX,        "orbit_link_keys_installed_total", "stage=\"encrypt\"")
+
+/* Histograms: X(Id, label) -> orbit_stage_latency_ns{stage="label"} */
+#define ORBITM_HISTS(X)                                                            \
+  X(DEFRAME,  "deframe")                                                           \
+  X(DECRYPT,  "decrypt")                                                           \
+  X(ROUTE,    "route")                                                             \
+  X(ENCRYPT,  "encrypt")                                                           \
+  X(SCHEDULE, "schedule")
+
+#define ORBITM_ENUM_C(Id, Name, Labels) ORBITM_C_##Id,
+#define ORBITM_ENUM_H(Id, Label)        ORBITM_H_##Id,
+typedef enum { ORBITM_COUNTERS(ORBITM_ENUM_C) ORBITM_COUNTERS_N } ORBITMCounter_t;
+typedef enum { ORBITM_HISTS(ORBITM_ENUM_H) ORBITM_HISTS_N } ORBITMHist_t;
+#undef ORBITM_ENUM_C
+#undef ORBITM_ENUM_H
+
+
+typedef struct {
+  _Atomic uint64_t count;
+  _Atomic uint64_t sum;                   // ns, for the mean
+  _Atomic uint64_t max;
+  _Atomic uint64_t bucket[ORBITM_HIST_BUCKETS];
+} ORBITMHistogram_t;
+
+
+typedef struct {
+  _Alignas(64) _Atomic uint64_t counter[ORBITM_COUNTERS_N];
+  _Alignas(64) _Atomic uint64_t queue_depth[ORBITM_PRI_LEVELS]; // gauge, per FLAG PRI
+  _Alignas(64) ORBITMHistogram_t hist[ORBITM_HISTS_N];
+} ORBITMetricsShard_t;
+
+
+typedef struct {
+  ORBITMetricsShard_t *shard;
+  uint32_t             shards;
+} ORBITMetrics_t;
+
+
+/* Plain sums of every shard at one moment */
+typedef struct {
+  uint64_t counter[ORBITM_COUNTERS_N];
+  uint64_t queue_depth[ORBITM_PRI_LEVELS];
+  struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t bucket[ORBITM_HIST_BUCKETS];
+  } hist[ORBITM_HISTS_N];
+} ORBITMetricsSnap_t;
+
+
+/* Returns 0, or -1 on allocation failure */
+int  ORBITMetrics_init(ORBITMetrics_t *_m, uint32_t _shards);
+void ORBITMetrics_free(ORBITMetrics_t *_m);
+
+static inline ORBITMetricsShard_t *ORBITMetrics_shard(ORBITMetrics_t *_m, uint32_t _i) {
+  return &_m->shard[_i];
+}
+
+
+/* ---- writer side: shard owner thread only ---- */
+
+static inline void ORBITMetrics_add(ORBITMetricsShard_t *_s, ORBITMCounter_t _c, uint64_t _v) {
+  atomic_store_explicit(&_s->counter[_c], atomic_load_explicit(&_s->counter[_c], memory_order_relaxed) + _v,
+                        memory_order_relaxed);
+}
+
+static inline void ORBITMetrics_queue_depth(ORBITMetricsShard_t *_s, uint8_t _pri, uint64_t _depth) {
+  atomic_store_explicit(&_s->queue_depth[_pri & (ORBITM_PRI_LEVELS - 1)], _depth, memory_order_relaxed);
+}
+
+static inline uint32_t ORBITMetrics_hist_index(uint64_t _v) {
+  uint32_t e = 63u - (uint32_t)__builtin_clzll(_v | ORBITM_HIST_SUB);
+  if (e >= ORBITM_HIST_MAX_EXP) {
+    return ORBITM_HIST_BUCKETS - 1;
+  }
+  uint32_t shift = e - ORBITM_HIST_SUB_BITS;
+  return (shift << ORBITM_HIST_SUB_BITS) + (uint32_t)(_v >> shift);
+}
+
+/* Smallest value that lands in bucket _b */
+static inline uint64_t ORBITMetrics_hist_lower(uint32_t _b) {
+  if (_b < 2 * ORBITM_HIST_SUB) {
+    return _b;
+  }
+  uint32_t shift = (_b >> ORBITM_HIST_SUB_BITS) - 1;
+  return (uint64_t)((_b & (ORBITM_HIST_SUB - 1)) + ORBITM_HIST_SUB) << shift;
+}
+
+/* _n samples of _v ns (a burst of _n frames taking _v ns each) */
+static inline void ORBITMetrics_hist_record_n(ORBITMetricsShard_t *_s, ORBITMHist_t _h, uint64_t _v, uint64_t _n) {
+  ORBITMHistogram_t *h = &_s->hist[_h];
+  _Atomic uint64_t *b = &h->bucket[ORBITMetrics_hist_index(_v)];
+  atomic_store_explicit(b, atomic_load_explicit(b, memory_order_relaxed) + _n, memory_order_relaxed);
+  atomic_store_explicit(&h->count, atomic_load_explicit(&h->count, memory_order_relaxed) + _n,
+                        memory_order_relaxed);
+  atomic_store_explicit(&h->sum, atomic_load_explicit(&h->sum, memory_order_relaxed) + _v * _n,
+                        memory_order_relaxed);
+  if (_v > atomic_load_explicit(&h->max, memory_order_relaxed)) {
+    atomic_store_explicit(&h->max, _v, memory_order_relaxed);
+  }
+}
+
+static inline void ORBITMetrics_hist_record(ORBITMetricsShard_t *_s, ORBITMHist_t _h, uint64_t _v) {
+  ORBITMetrics_hist_record_n(_s, _h, _v, 1);
+}
+
+
+/* ---- reader side: any thread ---- */
+
+void ORBITMetrics_snapshot(const ORBITMetrics_t *_m, ORBITMetricsSnap_t *_out);
+
+/* Value (bucket lower bound, ns) at quantile _q in [0, 1]; 0 when empty */
+uint64_t ORBITMetrics_quantile(const ORBITMetricsSnap_t *_s, ORBITMHist_t _h, double _q);
+
+/*
+ * Text export, one "name{labels} value" line per counter / gauge, and per
+ * histogram count, sum, max and quantiles 0.5 / 0.9 / 0.99 / 0.999.
+ * Returns 0, or -1 on write error.
+ */
+int ORBITMetrics_write_text(const ORBITMetricsSnap_t *_s, FILE *_out);
+
+const char *ORBITMetrics_counter_name(ORBITMCounter_t _c);
+const char *ORBITMetrics_hist_name(ORBITMHist_t _h);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_METRICS_H
@@ -0,0 +1,853 @@
+/*
+ * File:        src/ORBIT_pipeline.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Reference relay node runtime for Radio_ORBIT.
+ *    See ORBIT_pipeline.h
+ *
+ */
+
+#define _GNU_SOURCE
+#include "ORBIT_pipeline.h"
+#include "ORBIT_schema.h"
+#include "L2_crc32.h"
+#include "L2D5_classify.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/crypto.h>
+
+STATIC_ASSERT(ORBITPIPE_BATCH <= L2D5CLS_MAX, ORBITPIPE_BATCH_fits_one_classify_call);
+/* per-class counters are indexed by L2D5Class_t */
+STATIC_ASSERT(ORBITM_C_RX_MALFORMED - ORBITM_C_RX_HELLO_NB == L2D5CLS_MALFORMED &&
+              ORBITM_C_TX_DATA_RM - ORBITM_C_TX_HELLO_NB == L2D5CLS_DATA_RM, ORBITM_counters_follow_L2D5Class_t);
+
+#define IDLE_SPINS 64
+#define DUP_HOLD_NS (30ull * 1000000000ull)   // flood source silent this long: its SEQ may have restarted
+
+/* nb_keys bits: session install sent to that crypto stage */
+#define NB_KEYS_RX   0x01
+#define NB_KEYS_TX   0x02
+#define NB_KEYS_BOTH (NB_KEYS_RX | NB_KEYS_TX)
+
+/* Session install, ROUTE -> DECRYPT / ENCRYPT, in the Payload of a pool buffer (next_hop = neighbor slot) */
+typedef struct {
+  uint8_t NodeAddr[16];
+  uint8_t PublicKey[32];
+  uint8_t SharedKey[L2D5KEY_SHARED_BYTES];
+} PipeKeyMsg_t;
+
+STATIC_ASSERT(sizeof(PipeKeyMsg_t) <= sizeof(((L2Frame *)0)->Payload), PipeKeyMsg_t_fits_a_pool_buffer);
+
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline bool pipe_running(const ORBITPipe_t *_p) {
+  return atomic_load_explicit(&_p->running, memory_order_relaxed);
+}
+
+/* single writer per stats block: plain load + store, no locked RMW */
+static inline void stat_add(_Atomic uint64_t *_c, uint64_t _v) {
+  atomic_store_explicit(_c, atomic_load_explicit(_c, memory_order_relaxed) + _v, memory_order_relaxed);
+}
+
+static void stats_batch(ORBITPipeStats_t *_st, size_t _in, size_t _out, uint64_t _t0, uint64_t _t1) {
+  stat_add(&_st->in, _in);
+  stat_add(&_st->out, _out);
+  stat_add(&_st->drop, _in - _out);
+  stat_add(&_st->batches, 1);
+  stat_add(&_st->busy_ns, _t1 - _t0);
+}
+
+/* RX -> now latency of frames leaving the stage; call before handing them on */
+static void stats_latency(ORBITPipeStats_t *_st, L2PoolBuf_t *const *_bufs, size_t _n) {
+  uint64_t now = now_ns();
+  for (size_t i = 0; i < _n; i++) {
+    uint64_t lat = now > _bufs[i]->rx_time ? now - _bufs[i]->rx_time : 0;
+    uint32_t b = 63u - (uint32_t)__builtin_clzll(lat | 1);
+    stat_add(&_st->lat[b < ORBITPIPE_LAT_BUCKETS ? b : ORBITPIPE_LAT_BUCKETS - 1], 1);
+  }
+}
+
+/* Metrics shard of a stage thread (RX: per port) */
+static inline ORBITMetricsShard_t *pipe_shard(ORBITPipe_t *_p, int _stage, uint16_t _port) {
+  return ORBITMetrics_shard(&_p->metrics, _stage == ORBITPIPE_STAGE_RX ? _port
+                                                                       : (uint32_t)_p->cfg.ports + (uint32_t)_stage - 1);
+}
+
+/* Hand _n buffers to _r; whatever does not fit is dropped */
+static size_t forward(ORBITSpsc_t *_r, L2PoolCache_t *_c, ORBITMetricsShard_t *_m, L2PoolBuf_t **_bufs, size_t _n) {
+  size_t sent = ORBITSpsc_push_burst(_r, (void *const *)_bufs, _n);
+  for (size_t i = sent; i < _n; i++) {
+    L2PoolCache_put(_c, _bufs[i]);
+  }
+  if (sent != _n) {
+    ORBITMetrics_add(_m, ORBITM_C_RING_FULL, _n - sent);
+  }
+  return sent;
+}
+
+static void idle(uint32_t *_spins) {
+  if (++*_spins >= IDLE_SPINS) {
+    sched_yield();
+    *_spins = 0;
+  }
+}
+
+
+/* ------------------------------- stages -------------------------------- */
+
+static void stage_rx(ORBITPipe_t *_p, uint16_t _port, L2PoolCache_t *_c) {
+  L2Deframer_t *d = &_p->deframer[_port];
+  ORBITPipeStats_t *st = &_p->rx_stats[_port];
+  ORBITMetricsShard_t *ms = pipe_shard(_p, ORBITPIPE_STAGE_RX, _port);
+  ORBITCap_t *cap = _p->cfg.capture;
+  L2DeframerStats_t seen = d->stats;
+  const L2Frame *views[ORBITPIPE_BATCH];
+  L2PoolBuf_t *bufs[ORBITPIPE_BATCH];
+  uint32_t spins = 0;
+  int16_t rssi = 0;
+
+  while (pipe_running(_p)) {
+    size_t room = 0;
+    uint8_t *w = L2Deframer_wbuf(d, &room);
+    if (room != 0) {
+      size_t got = _p->cfg.rx_fn(_p->cfg.ctx, _port, w, room);
+      L2Deframer_commit(d, got);
+      if (got != 0 && _p->cfg.rssi_fn != NULL) {
+        rssi = _p->cfg.rssi_fn(_p->cfg.ctx, _port);
+      }
+    }
+    uint64_t tp = now_ns();
+    size_t n = L2Deframer_poll(d, views, ORBITPIPE_BATCH);
+    if (d->stats.resync_bytes != seen.resync_bytes) {
+      ORBITMetrics_add(ms, ORBITM_C_FCS_FAIL, d->stats.bad_fcs - seen.bad_fcs);
+      ORBITMetrics_add(ms, ORBITM_C_EFD_FAIL, d->stats.bad_efd - seen.bad_efd);
+      ORBITMetrics_add(ms, ORBITM_C_RESYNC_BYTES, d->stats.resync_bytes - seen.resync_bytes);
+      seen = d->stats;
+    }
+    if (n == 0) {
+      if (cap != NULL) {
+        ORBITCap_poll(cap, _port, tp);
+      }
+      idle(&spins);
+      continue;
+    }
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; cap != NULL && i < n; i++) {
+      ORBITCap_frame(cap, _port, views[i], t0, rssi);
+    }
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+      L2PoolBuf_t *b = L2PoolCache_get_copy(_c, views[i]);
+      if (b == NULL) {
+        continue;
+      }
+      b->port = _port;
+      b->rssi = rssi;
+      b->rx_time = t0;
+      b->next_hop = L2D5NB_NIL;
+      b->aux = L2D5NB_NIL;
+      bufs[m++] = b;
+    }
+    L2Deframer_release(d);
+    if (m != n) {
+      ORBITMetrics_add(ms, ORBITM_C_POOL_EMPTY, n - m);
+    }
+    stats_latency(st, bufs, m);
+    m = forward(&_p->rx_ring[_port], _c, ms, bufs, m);
+    uint64_t t1 = now_ns();
+    ORBITMetrics_hist_record_n(ms, ORBITM_H_DEFRAME, (t1 - tp) / n, n);
+    stats_batch(st, n, m, t0, t1);
+  }
+}
+
+static void stage_dispatch(ORBITPipe_t *_p, L2PoolCache_t *_c) {
+  ORBITPipeStats_t *st = &_p->stats[ORBITPIPE_STAGE_DISPATCH];
+  ORBITMetricsShard_t *ms = pipe_shard(_p, ORBITPIPE_STAGE_DISPATCH, 0);
+  L2PoolBuf_t *in[ORBITPIPE_BATCH], *data[ORBITPIPE_BATCH], *ctrl[ORBITPIPE_BATCH];
+  const L2Frame *frames[ORBITPIPE_BATCH];
+  L2D5ClassBatch_t cls;
+  uint32_t spins = 0, port = 0;
+
+  while (pipe_running(_p)) {
+    size_t n = ORBITSpsc_pop_burst(&_p->rx_ring[port], (void **)in, ORBITPIPE_BATCH);
+    port = port + 1 < _p->cfg.ports ? port + 1 : 0;
+    if (n == 0) {
+      idle(&spins);
+      continue;
+    }
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < n; i++) {
+      frames[i] = &in[i]->frame;
+    }
+    L2D5Cls_batch(frames, n, &cls);
+    for (int k = 0; k < L2D5CLS_CLASSES; k++) {
+      ORBITMetrics_add(ms, (ORBITMCounter_t)(ORBITM_C_RX_HELLO_NB + k), cls.count[k]);
+    }
+    size_t nd = 0, nc = 0;
+    /* everything with TAG ENCRYPTED needs its link session first */
+    for (uint32_t m = cls.mask[L2D5CLS_DATA_DC] | cls.mask[L2D5CLS_DATA_RM] | cls.mask[L2D5CLS_HELLO_RM]; m != 0;
+         m &= m - 1) {
+      data[nd++] = in[__builtin_ctz(m)];
+    }
+    for (uint32_t m = cls.mask[L2D5CLS_HELLO_NB]; m != 0; m &= m - 1) {
+      ctrl[nc++] = in[__builtin_ctz(m)];
+    }
+    for (size_t j = 0; j < cls.count[L2D5CLS_MALFORMED]; j++) {
+      L2PoolCache_put(_c, in[cls.idx[L2D5CLS_MALFORMED][j]]);
+    }
+    stats_latency(st, data, nd);
+    stats_latency(st, ctrl, nc);
+    nd = forward(&_p->dec_ring, _c, ms, data, nd);
+    nc = forward(&_p->ctrl_ring, _c, ms, ctrl, nc);
+    stats_batch(st, n, nd + nc, t0, now_ns());
+  }
+}
+
+/* DECRYPT's half of a session install (also before start). 0, or -1 */
+static int install_rx(ORBITPipe_t *_p, uint32_t _slot, const uint8_t *_addr, const uint8_t *_pubkey,
+                      const uint8_t *_shared) {
+  /* a session still naming this slot is for its old address / key */
+  for (uint32_t i = 0; i < _p->rx_keys.capacity; i++) {
+    if (_p->rx_nb[i] == _slot) {
+      _p->rx_nb[i] = L2D5NB_NIL;
+    }
+  }
+  L2D5Session_t *s = L2D5KeyCache_install(&_p->rx_keys, _addr, _pubkey, _shared);
+  if (s == NULL) {
+    return -1;
+  }
+  _p->rx_nb[s - _p->rx_keys.sessions] = _slot;
+  return 0;
+}
+
+/* ENCRYPT's half. 0, or -1 */
+static int install_tx(ORBITPipe_t *_p, uint32_t _slot, const uint8_t *_addr, const uint8_t *_pubkey,
+                      const uint8_t *_shared) {
+  L2D5Session_t *s = L2D5KeyCache_install(&_p->tx_keys, _addr, _pubkey, _shared);
+  /* an eviction hands the LRU session to _addr: whoever pointed at it has none now */
+  for (uint32_t i = 0; s != NULL && i < _p->nb.capacity; i++) {
+    if (_p->tx_sess[i] == s) {
+      _p->tx_sess[i] = NULL;
+    }
+  }
+  _p->tx_sess[_slot] = s;
+  return s != NULL ? 0 : -1;
+}
+
+typedef int (*install_fn_t)(ORBITPipe_t *, uint32_t, const uint8_t *, const uint8_t *, const uint8_t *);
+
+/* Session installs queued by ROUTE: install, wipe, release. Returns messages taken. */
+static size_t take_keys(ORBITPipe_t *_p, L2PoolCache_t *_c, ORBITSpsc_t *_r, install_fn_t _install,
+                        ORBITMetricsShard_t *_m, ORBITMCounter_t _done) {
+  L2PoolBuf_t *kb[ORBITPIPE_BATCH];
+  size_t n = ORBITSpsc_pop_burst(_r, (void **)kb, ORBITPIPE_BATCH);
+  for (size_t i = 0; i < n; i++) {
+    PipeKeyMsg_t *k = (PipeKeyMsg_t *)kb[i]->frame.Payload;
+    if (_install(_p, kb[i]->next_hop, k->NodeAddr, k->PublicKey, k->SharedKey) == 0) {
+      ORBITMetrics_add(_m, _done, 1);
+    }
+    OPENSSL_cleanse(k, sizeof(*k));
+    L2PoolCache_put(_c, kb[i]);
+  }
+  return n;
+}
+
+static void stage_decrypt(ORBITPipe_t *_p, L2PoolCache_t *_c) {
+  ORBITPipeStats_t *st = &_p->stats[ORBITPIPE_STAGE_DECRYPT];
+  ORBITMetricsShard_t *ms = pipe_shard(_p, ORBITPIPE_STAGE_DECRYPT, 0);
+  L2PoolBuf_t *in[ORBITPIPE_BATCH], *ok[ORBITPIPE_BATCH];
+  const L2D5Frame_Encrypted_t *enc[ORBITPIPE_BATCH];
+  L2D5Frame_t *dec[ORBITPIPE_BATCH];
+  L2D5Session_t *sess[ORBITPIPE_BATCH];
+  uint32_t spins = 0;
+
+  while (pipe_running(_p)) {
+    size_t n = ORBITSpsc_pop_burst(&_p->dec_ring, (void **)in, ORBITPIPE_BATCH);
+    size_t nk = take_keys(_p, _c, &_p->rx_key_ring, install_rx, ms, ORBITM_C_KEYS_RX);
+    if (n == 0) {
+      if (nk == 0) {
+        idle(&spins);
+      }
+      continue;
+    }
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < n; i++) {
+      dec[i] = L2PoolBuf_l2d5(in[i]);
+      enc[i] = (const L2D5Frame_Encrypted_t *)dec[i];
+    }
+    L2D5KeyCache_decrypt_batch(&_p->rx_keys, enc, dec, sess, n);
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (sess[i] != NULL) {
+        in[i]->aux = _p->rx_nb[sess[i] - _p->rx_keys.sessions];   // the hop it came from
+        ok[m++] = in[i];
+      } else {
+        L2PoolCache_put(_c, in[i]);
+      }
+    }
+    ORBITMetrics_add(ms, ORBITM_C_DECRYPT_FAIL, n - m);
+    stats_latency(st, ok, m);
+    m = forward(&_p->route_ring, _c, ms, ok, m);
+    uint64_t t1 = now_ns();
+    ORBITMetrics_hist_record_n(ms, ORBITM_H_DECRYPT, (t1 - t0) / n, n);
+    stats_batch(st, n, m, t0, t1);
+  }
+}
+
+static void route_hello_nb(ORBITPipe_t *_p, L2PoolBuf_t *_b, uint64_t _now) {
+  const L2D5Routing_HelloPkt_t *h = (const L2D5Routing_HelloPkt_t *)L2PoolBuf_l2d5(_b)->Payload;
+  unsigned flags = 0;
+  uint32_t slot = L2D5Neighbor_observe(&_p->nb, h->NodeSrcAddr, h->PublicKey, _now, _b->rssi, &flags);
+  if (slot == L2D5NB_NIL) {
+    return;
+  }
+  _p->nb.nodes_limit[slot] = L2D5HelloPkt_get_NodesLimit(h);
+  _p->nb_port[slot] = _b->port;
+  if (flags & (L2D5NB_OBS_NEW | L2D5NB_OBS_KEY_CHANGED)) {
+    _p->nb_keys[slot] = 0;                  // nothing is routed to it until its key is installed
+  }
+  if (_p->hs.nworkers != 0 && !_p->nb.has_shared[slot]) {
+    L2D5Hs_submit(&_p->hs, slot);
+  }
+}
+
+/*
+ * Sends every agreed SharedKey to both crypto stages. Returns false while
+ * one is still owed (key ring full / pool empty), to be retried.
+ */
+static bool route_push_keys(ORBITPipe_t *_p, L2PoolCache_t *_c) {
+  static const uint8_t bit[2] = { NB_KEYS_RX, NB_KEYS_TX };
+  ORBITSpsc_t *ring[2] = { &_p->rx_key_ring, &_p->tx_key_ring };
+  bool done = true;
+
+  for (uint32_t s = L2D5Neighbor_next(&_p->nb, 0); s != L2D5NB_NIL; s = L2D5Neighbor_next(&_p->nb, s + 1)) {
+    if (!_p->nb.has_shared[s] || _p->nb_keys[s] == NB_KEYS_BOTH) {
+      continue;
+    }
+    for (int k = 0; k < 2; k++) {
+      if (_p->nb_keys[s] & bit[k]) {
+        continue;
+      }
+      L2PoolBuf_t *b = L2PoolCache_get(_c);
+      if (b == NULL) {
+        return false;
+      }
+      PipeKeyMsg_t *m = (PipeKeyMsg_t *)b->frame.Payload;
+      memcpy(m->NodeAddr, _p->nb.addr[s], 16);
+      memcpy(m->PublicKey, _p->nb.keys[s].PublicKey, 32);
+      memcpy(m->SharedKey, _p->nb.keys[s].SharedKey, L2D5KEY_SHARED_BYTES);
+      b->next_hop = s;
+      if (ORBITSpsc_push_burst(ring[k], (void *const *)&b, 1) != 1) {
+        OPENSSL_cleanse(m, sizeof(*m));
+        L2PoolCache_put(_c, b);
+        done = false;
+        continue;
+      }
+      _p->nb_keys[s] |= bit[k];
+    }
+  }
+  return done;
+}
+
+/* Flood relay: one copy of _b per keyed neighbor except _via. Returns copies made; *_sent gets those queued. */
+static size_t route_relay(ORBITPipe_t *_p, L2PoolCache_t *_c, ORBITMetricsShard_t *_m, ORBITPipeStats_t *_st,
+                          L2PoolBuf_t *_b, uint32_t _via, size_t *_sent) {
+  L2PoolBuf_t *out[ORBITPIPE_BATCH];
+  size_t n = 0, made = 0;
+
+  for (uint32_t s = L2D5Neighbor_next(&_p->nb, 0); s != L2D5NB_NIL; s = L2D5Neighbor_next(&_p->nb, s + 1)) {
+    if (s == _via || _p->nb_keys[s] != NB_KEYS_BOTH) {
+      continue;
+    }
+    L2PoolBuf_t *b = L2PoolCache_get_copy(_c, &_b->frame);
+    if (b == NULL) {
+      ORBITMetrics_add(_m, ORBITM_C_POOL_EMPTY, 1);
+      break;
+    }
+    b->port = _p->nb_port[s];
+    b->rssi = _b->rssi;
+    b->rx_time = _b->rx_time;
+    b->next_hop = s;
+    b->aux = _via;
+    out[n++] = b;
+    if (n == ORBITPIPE_BATCH) {
+      stats_latency(_st, out, n);
+      *_sent += forward(&_p->enc_ring, _c, _m, out, n);
+      made += n;
+      n = 0;
+    }
+  }
+  stats_latency(_st, out, n);
+  *_sent += forward(&_p->enc_ring, _c, _m, out, n);
+  return made + n;
+}
+
+/*
+ * Decrypted HELLO_PKT_RM from neighbor slot aux: learn the route, then
+ * relay the first copy of each flood while TTL allows. Returns copies made.
+ */
+static size_t route_hello_rm(ORBITPipe_t *_p, L2PoolCache_t *_c, ORBITMetricsShard_t *_m, ORBITPipeStats_t *_st,
+                             L2PoolBuf_t *_b, uint64_t _now, size_t *_sent) {
+  L2D5Frame_t *f = L2PoolBuf_l2d5(_b);
+  const L2D5Routing_HelloPkt_t *h = (const L2D5Routing_HelloPkt_t *)f->Payload;
+  uint32_t via = _b->aux;
+  uint16_t limit = L2D5HelloPkt_get_NodesLimit(h), ttl = L2D5Frame_get_TTL(f);
+
+  /* SrcAddress is the originator: it must be the node the HELLO announces, and not us */
+  if (via == L2D5NB_NIL || ttl == 0 || ttl > limit || !L2D5ADDR_equal(h->NodeSrcAddr, f->SrcAddress) ||
+      L2D5ADDR_equal(f->SrcAddress, _p->cfg.self_addr)) {
+    return 0;
+  }
+  L2D5Route_hello(&_p->route, h, via, (uint16_t)(limit - ttl + 1), _now, NULL);
+  if (!L2D5Dup_forward(L2D5Dup_check_hello(&_p->dup, f, _now))) {
+    ORBITMetrics_add(_m, ORBITM_C_DUP_DROP, 1);
+    return 0;
+  }
+  if (ttl <= 1) {
+    ORBITMetrics_add(_m, ORBITM_C_TTL_DROP, 1);
+    return 0;
+  }
+  L2D5Frame_set_TTL(f, (uint16_t)(ttl - 1));
+  return route_relay(_p, _c, _m, _st, _b, via, _sent);
+}
+
+static void stage_route(ORBITPipe_t *_p, L2PoolCache_t *_c) {
+  ORBITPipeStats_t *st = &_p->stats[ORBITPIPE_STAGE_ROUTE];
+  ORBITMetricsShard_t *ms = pipe_shard(_p, ORBITPIPE_STAGE_ROUTE, 0);
+  L2PoolBuf_t *in[ORBITPIPE_BATCH], *fwd[ORBITPIPE_BATCH], *local[ORBITPIPE_BATCH];
+  uint32_t spins = 0;
+  bool keys_owed = false;
+
+  while (pipe_running(_p)) {
+    /* finished handshakes: keys go out before anything is routed to those neighbors */
+    if (_p->hs.nworkers != 0 && L2D5Hs_poll(&_p->hs) != 0) {
+      keys_owed = true;
+    }
+    if (keys_owed) {
+      keys_owed = !route_push_keys(_p, _c);
+    }
+
+    /* control first: routes learned in this batch apply to the data behind it */
+    size_t nc = ORBITSpsc_pop_burst(&_p->ctrl_ring, (void **)in, ORBITPIPE_BATCH);
+    if (nc != 0) {
+      uint64_t t0 = now_ns();
+      for (size_t i = 0; i < nc; i++) {
+        route_hello_nb(_p, in[i], t0);
+      }
+      stats_latency(st, in, nc);
+      uint64_t t1 = now_ns();
+      ORBITMetrics_hist_record_n(ms, ORBITM_H_ROUTE, (t1 - t0) / nc, nc);
+      stats_batch(st, nc, nc, t0, t1);
+      for (size_t i = 0; i < nc; i++) {
+        L2PoolCache_put(_c, in[i]);
+      }
+    }
+
+    size_t n = ORBITSpsc_pop_burst(&_p->route_ring, (void **)in, ORBITPIPE_BATCH);
+    if (n == 0) {
+      if (nc == 0) {
+        idle(&spins);
+      }
+      continue;
+    }
+    uint64_t t0 = now_ns();
+    size_t nf = 0, nl = 0, hellos = 0, made = 0, relayed = 0;
+    for (size_t i = 0; i < n; i++) {
+      L2D5Frame_t *f = L2PoolBuf_l2d5(in[i]);
+      if (in[i]->aux != L2D5NB_NIL) {
+        L2D5Neighbor_touch(&_p->nb, in[i]->aux, t0, in[i]->rssi);
+      }
+      if (f->TAG == L2D5TAG_HELLO_PKT_RM) {
+        made += route_hello_rm(_p, _c, ms, st, in[i], t0, &relayed);
+        hellos++;
+        L2PoolCache_put(_c, in[i]);
+        continue;
+      }
+      if (L2D5ADDR_equal(f->DstAddress, _p->cfg.self_addr)) {
+        local[nl++] = in[i];
+        continue;
+      }
+      uint16_t ttl = L2D5Frame_get_TTL(f);
+      if (f->TAG == L2D5TAG_TCP_DATA_RM && ttl <= 1) {
+        ORBITMetrics_add(ms, ORBITM_C_TTL_DROP, 1);
+        L2PoolCache_put(_c, in[i]);
+        continue;
+      }
+      uint32_t hop = f->TAG == L2D5TAG_TCP_DATA_RM ? L2D5Route_next_hop(&_p->route, f->DstAddress) : L2D5NB_NIL;
+      if (hop == L2D5NB_NIL || _p->nb_keys[hop] != NB_KEYS_BOTH) {
+        ORBITMetrics_add(ms, ORBITM_C_NO_ROUTE, 1);
+        L2PoolCache_put(_c, in[i]);
+        continue;
+      }
+      L2D5Frame_set_TTL(f, (uint16_t)(ttl - 1));
+      in[i]->next_hop = hop;
+      in[i]->port = _p->nb_port[hop];
+      fwd[nf++] = in[i];
+    }
+    stats_latency(st, fwd, nf);
+    stats_latency(st, local, nl);
+    nf = forward(&_p->enc_ring, _c, ms, fwd, nf);
+    nl = forward(&_p->local_ring, _c, ms, local, nl);
+    uint64_t t1 = now_ns();
+    ORBITMetrics_hist_record_n(ms, ORBITM_H_ROUTE, (t1 - t0) / n, n);
+    /* a HELLO is consumed here (out); its relayed copies count as frames in */
+    stats_batch(st, n + made, hellos + relayed + nf + nl, t0, t1);
+  }
+}
+
+static void stage_encrypt(ORBITPipe_t *_p, L2PoolCache_t *_c) {
+  ORBITPipeStats_t *st = &_p->stats[ORBITPIPE_STAGE_ENCRYPT];
+  ORBITMetricsShard_t *ms = pipe_shard(_p, ORBITPIPE_STAGE_ENCRYPT, 0);
+  L2PoolBuf_t *in[ORBITPIPE_BATCH];
+  const L2D5Frame_t *pt[ORBITPIPE_BATCH];
+  L2D5Frame_Encrypted_t *ct[ORBITPIPE_BATCH];
+  L2D5Session_t *sess[ORBITPIPE_BATCH];
+  uint32_t spins = 0;
+
+  while (pipe_running(_p)) {
+    size_t n = ORBITSpsc_pop_burst(&_p->enc_ring, (void **)in, ORBITPIPE_BATCH);
+    /* after the pop: a key ROUTE sent before routing these frames is in the ring by now */
+    size_t nk = take_keys(_p, _c, &_p->tx_key_ring, install_tx, ms, ORBITM_C_KEYS_TX);
+    if (n == 0) {
+      if (nk == 0) {
+        idle(&spins);
+      }
+      continue;
+    }
+    uint64_t t0 = now_ns();
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+      L2D5Session_t *s = _p->tx_sess[in[i]->next_hop];
+      if (s == NULL || !s->valid) {
+        ORBITMetrics_add(ms, ORBITM_C_NO_ROUTE, 1);
+        L2PoolCache_put(_c, in[i]);
+        continue;
+      }
+      in[m] = in[i];
+      pt[m] = L2PoolBuf_l2d5(in[i]);
+      ct[m] = (L2D5Frame_Encrypted_t *)L2PoolBuf_l2d5(in[i]);
+      sess[m++] = s;
+    }
+    L2D5KeyCache_encrypt_batch(&_p->tx_keys, sess, pt, ct, m);
+    for (size_t i = 0; i < m; i++) {
+      L2CRC32_seal(&in[i]->frame);
+    }
+    stats_latency(st, in, m);
+    m = forward(&_p->tx_ring, _c, ms, in, m);
+    uint64_t t1 = now_ns();
+    ORBITMetrics_hist_record_n(ms, ORBITM_H_ENCRYPT, (t1 - t0) / n, n);
+    stats_batch(st, n, m, t0, t1);
+  }
+}
+
+static void stage_tx(ORBITPipe_t *_p, L2PoolCache_t *_c) {
+  ORBITPipeStats_t *st = &_p->stats[ORBITPIPE_STAGE_TX];
+  ORBITMetricsShard_t *ms = pipe_shard(_p, ORBITPIPE_STAGE_TX, 0);
+  uint64_t tx[L2D5CLS_CLASSES];
+  L2PoolBuf_t *in[ORBITPIPE_BATCH];
+  uint32_t spins = 0;
+
+  while (pipe_running(_p)) {
+    size_t n = ORBITSpsc_pop_burst(&_p->tx_ring, (void **)in, ORBITPIPE_BATCH);
+    size_t nl = ORBITSpsc_pop_burst(&_p->local_ring, (void **)in + n, ORBITPIPE_BATCH - n);
+    if (n + nl == 0) {
+      idle(&spins);
+      continue;
+    }
+    uint64_t t0 = now_ns();
+    memset(tx, 0, sizeof(tx));
+    for (size_t i = 0; i < n; i++) {
+      uint8_t pri;
+      tx[L2D5Cls_frame(&in[i]->frame, &pri)]++;
+      _p->cfg.tx_fn(_p->cfg.ctx, in[i]->port, &in[i]->frame);
+    }
+    for (size_t i = n; i < n + nl; i++) {
+      if (_p->cfg.deliver_fn != NULL) {
+        _p->cfg.deliver_fn(_p->cfg.ctx, in[i]);
+      }
+    }
+    for (int k = L2D5CLS_HELLO_NB; k <= L2D5CLS_DATA_RM; k++) {
+      ORBITMetrics_add(ms, (ORBITMCounter_t)(ORBITM_C_TX_HELLO_NB + k), tx[k]);
+    }
+    ORBITMetrics_add(ms, ORBITM_C_DELIVERED, nl);
+    stats_latency(st, in, n + nl);
+    uint64_t t1 = now_ns();
+    ORBITMetrics_hist_record_n(ms, ORBITM_H_SCHEDULE, (t1 - t0) / (n + nl), n + nl);
+    stats_batch(st, n + nl, n + nl, t0, t1);
+    for (size_t i = 0; i < n + nl; i++) {
+      L2PoolCache_put(_c, in[i]);
+    }
+  }
+}
+
+
+static void *stage_main(void *_arg) {
+  ORBITPipeThread_t *t = _arg;
+  ORBITPipe_t *p = t->pipe;
+  L2PoolCache_t cache;
+  L2PoolCache_init(&cache, &p->pool);
+
+  switch (t->stage) {
+    case ORBITPIPE_STAGE_RX:       stage_rx(p, t->port, &cache); break;
+    case ORBITPIPE_STAGE_DISPATCH: stage_dispatch(p, &cache);    break;
+    case ORBITPIPE_STAGE_DECRYPT:  stage_decrypt(p, &cache);     break;
+    case ORBITPIPE_STAGE_ROUTE:    stage_route(p, &cache);       break;
+    case ORBITPIPE_STAGE_ENCRYPT:  stage_encrypt(p, &cache);     break;
+    case ORBITPIPE_STAGE_TX:       stage_tx(p, &cache);          break;
+    default: break;
+  }
+  L2PoolCache_flush(&cache);
+  return NULL;
+}
+
+
+/* ------------------------------ lifecycle ------------------------------ */
+
+void ORBITPipe_config_default(ORBITPipeConfig_t *_cfg) {
+  memset(_cfg, 0, sizeof(*_cfg));
+  _cfg->ports = 1;
+  for (int i = 0; i < ORBITPIPE_MAX_PORTS; i++) {
+    _cfg->cpu_rx[i] = ORBITPIPE_CPU_ANY;
+  }
+  for (int i = 0; i < ORBITPIPE_STAGES; i++) {
+    _cfg->cpu_stage[i] = ORBITPIPE_CPU_ANY;
+  }
+}
+
+int ORBITPipe_init(ORBITPipe_t *_p, const ORBITPipeConfig_t *_cfg) {
+  memset(_p, 0, sizeof(*_p));
+  if (_cfg->ports == 0 || _cfg->ports > ORBITPIPE_MAX_PORTS || _cfg->rx_fn == NULL || _cfg->tx_fn == NULL ||
+      (_cfg->capture != NULL && _cfg->capture->cfg.lanes < _cfg->ports)) {
+    return -1;
+  }
+  _p->cfg = *_cfg;
+  ORBITPipeConfig_t *c = &_p->cfg;
+  c->pool_frames = c->pool_frames ? c->pool_frames : 4096;
+  c->ring_depth  = c->ring_depth  ? c->ring_depth  : 1024;
+  c->neighbors   = c->neighbors   ? c->neighbors   : 256;
+  c->remotes     = c->remotes     ? c->remotes     : 4096;
+  c->sessions    = c->sessions    ? c->sessions    : c->neighbors;
+
+  int rc = 0;
+  rc |= L2Pool_init(&_p->pool, c->pool_frames);
+  rc |= ORBITMetrics_init(&_p->metrics, (uint32_t)c->ports + ORBITPIPE_STAGES - 1);
+  rc |= L2D5Neighbor_init(&_p->nb, c->neighbors);
+  if (rc == 0) {
+    rc |= L2D5Route_init(&_p->route, &_p->nb, c->remotes);
+    _p->tx_sess = calloc(_p->nb.capacity, sizeof(*_p->tx_sess));
+    _p->nb_keys = calloc(_p->nb.capacity, sizeof(*_p->nb_keys));
+    _p->nb_port = calloc(_p->nb.capacity, sizeof(*_p->nb_port));
+    rc |= _p->tx_sess == NULL || _p->nb_keys == NULL || _p->nb_port == NULL ? -1 : 0;
+    if (rc == 0 && c->secret_key != NULL) {
+      rc |= L2D5Hs_init(&_p->hs, &_p->nb, NULL, c->secret_key, c->hs_workers ? c->hs_workers : 1, 0, NULL);
+    }
+  }
+  rc |= L2D5Dup_init(&_p->dup, c->remotes, DUP_HOLD_NS);
+  rc |= L2D5KeyCache_init(&_p->rx_keys, c->sessions);
+  rc |= L2D5KeyCache_init(&_p->tx_keys, c->sessions);
+  if (_p->rx_keys.sessions != NULL) {
+    _p->rx_nb = malloc((size_t)_p->rx_keys.capacity * sizeof(*_p->rx_nb));
+    rc |= _p->rx_nb == NULL ? -1 : 0;
+    for (uint32_t i = 0; _p->rx_nb != NULL && i < _p->rx_keys.capacity; i++) {
+      _p->rx_nb[i] = L2D5NB_NIL;
+    }
+  }
+  for (uint16_t i = 0; i < c->ports; i++) {
+    rc |= L2Deframer_init(&_p->deframer[i], 16 * sizeof(L2Frame), true);
+    rc |= ORBITSpsc_init(&_p->rx_ring[i], c->ring_depth);
+  }
+  rc |= ORBITSpsc_init(&_p->ctrl_ring, c->ring_depth);
+  rc |= ORBITSpsc_init(&_p->dec_ring, c->ring_depth);
+  rc |= ORBITSpsc_init(&_p->route_ring, c->ring_depth);
+  rc |= ORBITSpsc_init(&_p->enc_ring, c->ring_depth);
+  rc |= ORBITSpsc_init(&_p->local_ring, c->ring_depth);
+  rc |= ORBITSpsc_init(&_p->tx_ring, c->ring_depth);
+  rc |= ORBITSpsc_init(&_p->rx_key_ring, c->ring_depth);
+  rc |= ORBITSpsc_init(&_p->tx_key_ring, c->ring_depth);
+  if (rc != 0) {
+    ORBITPipe_free(_p);
+    return -1;
+  }
+  atomic_init(&_p->running, false);
+  return 0;
+}
+
+/* Key installs never taken (stopped first): wipe them */
+static void wipe_keys(ORBITSpsc_t *_r) {
+  void *b;
+  while (_r->slots != NULL && ORBITSpsc_pop_burst(_r, &b, 1) == 1) {
+    OPENSSL_cleanse(((L2PoolBuf_t *)b)->frame.Payload, sizeof(PipeKeyMsg_t));
+  }
+}
+
+void ORBITPipe_free(ORBITPipe_t *_p) {
+  ORBITPipe_stop(_p);
+  L2D5Hs_free(&_p->hs);
+  wipe_keys(&_p->rx_key_ring);
+  wipe_keys(&_p->tx_key_ring);
+  for (uint16_t i = 0; i < ORBITPIPE_MAX_PORTS; i++) {
+    if (_p->deframer[i].ring != NULL) {
+      L2Deframer_free(&_p->deframer[i]);
+    }
+    free(_p->rx_ring[i].slots);
+  }
+  free(_p->ctrl_ring.slots);
+  free(_p->dec_ring.slots);
+  free(_p->route_ring.slots);
+  free(_p->enc_ring.slots);
+  free(_p->local_ring.slots);
+  free(_p->tx_ring.slots);
+  free(_p->rx_key_ring.slots);
+  free(_p->tx_key_ring.slots);
+  if (_p->rx_keys.sessions != NULL) {
+    L2D5KeyCache_free(&_p->rx_keys);
+  }
+  if (_p->tx_keys.sessions != NULL) {
+    L2D5KeyCache_free(&_p->tx_keys);
+  }
+  if (_p->route.addr != NULL) {
+    L2D5Route_free(&_p->route);
+  }
+  L2D5Dup_free(&_p->dup);
+  free(_p->rx_nb);
+  free(_p->tx_sess);
+  free(_p->nb_keys);
+  free(_p->nb_port);
+  L2D5Neighbor_free(&_p->nb);
+  L2Pool_free(&_p->pool);
+  ORBITMetrics_free(&_p->metrics);
+  memset(_p, 0, sizeof(*_p));
+}
+
+uint32_t ORBITPipe_add_neighbor(ORBITPipe_t *_p, const uint8_t *_addr, const uint8_t *_pubkey,
+                                const uint8_t *_shared, uint16_t _port) {
+  if (pipe_running(_p) || _port >= _p->cfg.ports) {
+    return L2D5NB_NIL;
+  }
+  uint32_t slot = L2D5Neighbor_observe(&_p->nb, _addr, _pubkey, 0, 0, NULL);
+  if (slot == L2D5NB_NIL) {
+    return L2D5NB_NIL;
+  }
+  L2D5Neighbor_set_shared(&_p->nb, slot, _shared);
+  _p->nb_port[slot] = _port;
+  if (install_rx(_p, slot, _addr, _pubkey, _shared) != 0 || install_tx(_p, slot, _addr, _pubkey, _shared) != 0) {
+    return L2D5NB_NIL;
+  }
+  _p->nb_keys[slot] = NB_KEYS_BOTH;
+  return slot;
+}
+
+static int pin(pthread_t _t, int _cpu) {
+  if (_cpu == ORBITPIPE_CPU_ANY) {
+    return 0;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(_cpu, &set);
+  return pthread_setaffinity_np(_t, sizeof(set), &set);
+}
+
+static int spawn(ORBITPipe_t *_p, int _stage, uint16_t _port, int _cpu) {
+  ORBITPipeThread_t *t = &_p->targ[_p->nthreads];
+  t->pipe = _p;
+  t->stage = _stage;
+  t->port = _port;
+  if (pthread_create(&_p->thread[_p->nthreads], NULL, stage_main, t) != 0) {
+    return -1;
+  }
+  pin(_p->thread[_p->nthreads], _cpu);      // best effort: CPU may be offline / restricted
+  _p->nthreads++;
+  return 0;
+}
+
+int ORBITPipe_start(ORBITPipe_t *_p) {
+  if (pipe_running(_p)) {
+    return -1;
+  }
+  atomic_store(&_p->running, true);
+  _p->t_start = now_ns();
+  _p->t_stop = 0;
+  int rc = 0;
+  for (int s = ORBITPIPE_STAGE_TX; s > ORBITPIPE_STAGE_RX; s--) {
+    rc |= spawn(_p, s, 0, _p->cfg.cpu_stage[s]);
+  }
+  for (uint16_t i = 0; i < _p->cfg.ports; i++) {
+    rc |= spawn(_p, ORBITPIPE_STAGE_RX, i, _p->cfg.cpu_rx[i]);
+  }
+  if (rc != 0) {
+    ORBITPipe_stop(_p);
+    return -1;
+  }
+  return 0;
+}
+
+void ORBITPipe_stop(ORBITPipe_t *_p) {
+  if (_p->nthreads == 0) {
+    return;
+  }
+  atomic_store(&_p->running, false);
+  for (uint32_t i = 0; i < _p->nthreads; i++) {
+    pthread_join(_p->thread[i], NULL);
+  }
+  _p->nthreads = 0;
+  _p->t_stop = now_ns();
+}
+
+
+/* ------------------------------- report -------------------------------- */
+
+const char *ORBITPipe_stage_name(int _stage) {
+  static const char *names[ORBITPIPE_STAGES] = { "RX", "DISPATCH", "DECRYPT", "ROUTE", "ENCRYPT", "TX" };
+  return _stage >= 0 && _stage < ORBITPIPE_STAGES ? names[_stage] : "?";
+}
+
+/* Upper bound (ns) of the bucket holding quantile _q */
+static uint64_t hist_quantile(const uint64_t *_h, uint64_t _total, double _q) {
+  uint64_t want = (uint64_t)((double)_total * _q), acc = 0;
+  for (int b = 0; b < ORBITPIPE_LAT_BUCKETS; b++) {
+    acc += _h[b];
+    if (acc > want) {
+      return 2ull << b;
+    }
+  }
+  return 2ull << (ORBITPIPE_LAT_BUCKETS - 1);
+}
+
+void ORBITPipe_report(ORBITPipe_t *_p, FILE *_out) {
+  uint64_t end = _p->t_stop ? _p->t_stop : now_ns();
+  double wall = (double)(end - _p->t_start) * 1e-9;
+
+  fprintf(_out, "%-9s %10s %10s %9s %6s %9s %10s %10s\n",
+          "stage", "frames", "drops", "Mfps", "busy%", "ns/frame", "p50 RX->", "p99 RX->");
+  for (int s = 0; s < ORBITPIPE_STAGES; s++) {
+    uint64_t in = 0, out = 0, drop = 0, busy = 0, h[ORBITPIPE_LAT_BUCKETS] = {0};
+    int nst = s == ORBITPIPE_STAGE_RX ? _p->cfg.ports : 1;
+    for (int k = 0; k < nst; k++) {
+      ORBITPipeStats_t *st = s == ORBITPIPE_STAGE_RX ? &_p->rx_stats[k] : &_p->stats[s];
+      in   += atomic_load_explicit(&st->in, memory_order_relaxed);
+      out  += atomic_load_explicit(&st->out, memory_order_relaxed);
+      drop += atomic_load_explicit(&st->drop, memory_order_relaxed);
+      busy += atomic_load_explicit(&st->busy_ns, memory_order_relaxed);
+      for (int b = 0; b < ORBITPIPE_LAT_BUCKETS; b++) {
+        h[b] += atomic_load_explicit(&st->lat[b], memory_order_relaxed);
+      }
+    }
+    fprintf(_out, "%-9s %10llu %10llu %9.3f %6.1f %9.1f %8.1fus %8.1fus\n",
+            ORBITPipe_stage_name(s), (unsigned long long)out, (unsigned long long)drop,
+            wall > 0 ? (double)out / wall / 1e6 : 0.0,
+            wall > 0 ? (double)busy * 1e-9 / wall / nst * 100.0 : 0.0,
+            in ? (double)busy / (double)in : 0.0,
+            (double)hist_quantile(h, out, 0.50) / 1e3,
+            (double)hist_quantile(h, out, 0.99) / 1e3);
+  }
+}
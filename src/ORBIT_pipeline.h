@@ -0,0 +1,227 @@
+/*
+ * File:        src/ORBIT_pipeline.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Reference relay node runtime for Radio_ORBIT.
+ *    Multi-stage forwarding pipeline, one pinned thread per stage, frames
+ *    handed between stages in bursts of ORBITPIPE_BATCH over SPSC rings.
+ *
+ *
+ *  Stages (frames live in one L2Pool buffer end to end, never copied
+ *  after RX):
+ *
+ *   radio 0 --> [RX 0] --\
+ *   radio 1 --> [RX 1] ---+--> [DISPATCH] --encrypted--> [DECRYPT] --> [ROUTE] --> [ENCRYPT] --> [TX] --> radio n
+ *   ...                  /              \                                ^   \                    ^
+ *   radio n --> [RX n] -/                \-----------HELLO_NB------------/    \------ local ------/
+ *
+ *   session installs: [ROUTE] --keys--> [DECRYPT], [ROUTE] --keys--> [ENCRYPT]
+ *
+ *  | Stage    | Work                                                        |
+ *  --------------------------------------------------------------------------
+ *  | RX k     | read radio k, L2 deframe + FCS check, copy into pool buffer |
+ *  | DISPATCH | L2D5Cls_batch: HELLO_PKT_NB -> ROUTE, TAG ENCRYPTED (data,  |
+ *  |          | HELLO_PKT_RM) -> DECRYPT, malformed dropped                 |
+ *  | DECRYPT  | KeyHint session lookup, multi-buffer AES, previous hop      |
+ *  | ROUTE    | HELLO -> neighbor / route tables, handshakes, flood relay;  |
+ *  |          | data -> next hop or local                                   |
+ *  | ENCRYPT  | next-hop session, multi-buffer AES, L2 FCS seal             |
+ *  | TX       | radio write (tx_fn) or local delivery (deliver_fn)          |
+ *
+ *  ROUTE is the only writer of the neighbor / route tables and the flood
+ *  duplicate cache; DECRYPT and ENCRYPT each own a key cache. Sessions come
+ *  from ORBITPipe_add_neighbor() before start, or, with cfg.secret_key, from
+ *  any HELLO_PKT_NB heard while running: ROUTE runs the X25519 handshake
+ *  (L2D5_handshake.h) and sends the SharedKey to both crypto stages over
+ *  their key rings before it routes anything to that neighbor.
+ *
+ *  Addressing as used by this relay: L2.5 SrcAddress is the originator and
+ *  is never rewritten; the hop a frame came from is the session it
+ *  decrypted with (a relayed frame, TAG FORWARD, is taken by the only
+ *  session with its KeyHint, see L2D5_keycache.h). DstAddress is the final
+ *  destination. TTL is decremented per hop. A HELLO_PKT_RM is taken to have
+ *  travelled NodesLimit - TTL + 1 hops; while TTL > 1 it is relayed once
+ *  per (NodeSrcAddr, SEQ) (L2D5_dupcache.h), re-encrypted for every keyed
+ *  neighbor except the one it came from.
+ *
+ *  Scaling: RX threads scale with radios; crypto runs on its own cores.
+ *  Beyond that, run one pipeline per group of radios.
+ *
+ * NOTE:
+ *   - Frames still in flight when ORBITPipe_stop() returns are dropped.
+ *   - Stats are relaxed atomics, safe to read while running.
+ *   - metrics: per-tag / drop-reason counters and per-stage service time
+ *     histograms (ORBIT_metrics.h), one shard per thread; read with
+ *     ORBITMetrics_snapshot(&p->metrics, ...) from any thread.
+ *   - capture: every deframed frame (FCS ok) is copied to pcapng by its RX
+ *     thread before the pool copy, timestamped with the RX clock, RSSI as
+ *     below. Close it after ORBITPipe_stop().
+ *   - rssi_fn (optional) is read after every rx_fn call that returned
+ *     bytes; a frame gets the RSSI of the read that completed it (0 without
+ *     rssi_fn).
+ *
+ */
+
+#ifndef ORBIT_PIPELINE_H
+#define ORBIT_PIPELINE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "L2_struct.h"
+#include "L2_deframer.h"
+#include "L2_pool.h"
+#include "L2D5_struct.h"
+#include "L2D5_dupcache.h"
+#include "L2D5_handshake.h"
+#include "L2D5_keycache.h"
+#include "L2D5_neighbor.h"
+#include "L2D5_route.h"
+#include "ORBIT_capture.h"
+#include "ORBIT_metrics.h"
+#include "ORBIT_spsc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define ORBITPIPE_MAX_PORTS   16
+#define ORBITPIPE_BATCH       32
+#define ORBITPIPE_LAT_BUCKETS 40            // log2(ns) histogram
+#define ORBITPIPE_CPU_ANY     (-1)
+
+
+typedef enum {
+  ORBITPIPE_STAGE_RX = 0,                   // sum over every RX thread
+  ORBITPIPE_STAGE_DISPATCH,
+  ORBITPIPE_STAGE_DECRYPT,
+  ORBITPIPE_STAGE_ROUTE,
+  ORBITPIPE_STAGE_ENCRYPT,
+  ORBITPIPE_STAGE_TX,
+  ORBITPIPE_STAGES
+} ORBITPipeStage_t;
+
+
+/* Non-blocking radio read into _buf; returns bytes read, 0 when idle */
+typedef size_t (*ORBITPipeRxFn_t)(void *_ctx, uint16_t _port, uint8_t *_buf, size_t _cap);
+/* RSSI (dBm) of the last rx_fn read on _port */
+typedef int16_t (*ORBITPipeRssiFn_t)(void *_ctx, uint16_t _port);
+/* Radio write of one sealed L2 frame */
+typedef void   (*ORBITPipeTxFn_t)(void *_ctx, uint16_t _port, const L2Frame *_frame);
+/* Decrypted frame addressed to this node; the buffer is released after return */
+typedef void   (*ORBITPipeDeliverFn_t)(void *_ctx, L2PoolBuf_t *_buf);
+
+
+typedef struct {
+  uint8_t  self_addr[16];
+  uint16_t ports;                           // 1 .. ORBITPIPE_MAX_PORTS
+  uint32_t pool_frames;                     // 0 -> 4096
+  uint32_t ring_depth;                      // per ring, 0 -> 1024
+  uint32_t neighbors;                       // neighbor table capacity, 0 -> 256
+  uint32_t remotes;                         // route table capacity, 0 -> 4096
+  uint32_t sessions;                        // key cache capacity, 0 -> neighbors
+  const uint8_t *secret_key;                // optional X25519 key: handshakes with neighbors heard
+  uint32_t hs_workers;                      // handshake threads, 0 -> 1 (with secret_key)
+  int      cpu_rx[ORBITPIPE_MAX_PORTS];     // ORBITPIPE_CPU_ANY = unpinned
+  int      cpu_stage[ORBITPIPE_STAGES];     // [ORBITPIPE_STAGE_RX] unused
+  ORBITPipeRxFn_t      rx_fn;
+  ORBITPipeRssiFn_t    rssi_fn;             // optional
+  ORBITPipeTxFn_t      tx_fn;
+  ORBITPipeDeliverFn_t deliver_fn;          // optional
+  ORBITCap_t          *capture;             // optional, lane k = RX port k, opened by the caller
+  void                *ctx;
+} ORBITPipeConfig_t;
+
+
+typedef struct {
+  _Alignas(64) _Atomic uint64_t in;
+  _Atomic uint64_t out;
+  _Atomic uint64_t drop;
+  _Atomic uint64_t batches;
+  _Atomic uint64_t busy_ns;                 // time spent on non-empty batches
+  _Atomic uint64_t lat[ORBITPIPE_LAT_BUCKETS]; // RX -> leaving this stage
+} ORBITPipeStats_t;
+
+
+typedef struct ORBITPipe ORBITPipe_t;
+
+typedef struct {
+  ORBITPipe_t *pipe;
+  int          stage;
+  uint16_t     port;
+} ORBITPipeThread_t;
+
+
+struct ORBITPipe {
+  ORBITPipeConfig_t   cfg;
+  L2Pool_t            pool;
+  L2D5NeighborTable_t nb;
+  L2D5RouteTable_t    route;
+  L2D5DupCache_t      dup;                  // ROUTE: HELLO_PKT_RM floods
+  L2D5Hs_t            hs;                   // ROUTE: runtime key agreement, cfg.secret_key only
+  L2D5KeyCache_t      rx_keys;              // DECRYPT stage
+  L2D5KeyCache_t      tx_keys;              // ENCRYPT stage
+  uint32_t           *rx_nb;                // DECRYPT: per rx_keys session, neighbor slot
+  L2D5Session_t     **tx_sess;              // ENCRYPT: per neighbor slot, in tx_keys
+  uint8_t            *nb_keys;              // ROUTE: per neighbor slot, key rings it was sent on
+  uint16_t           *nb_port;              // ROUTE: per neighbor slot, radio it was heard on
+  L2Deframer_t        deframer[ORBITPIPE_MAX_PORTS];
+
+  ORBITSpsc_t         rx_ring[ORBITPIPE_MAX_PORTS]; // RX k -> DISPATCH
+  ORBITSpsc_t         ctrl_ring;            // DISPATCH -> ROUTE (HELLO_PKT_NB)
+  ORBITSpsc_t         dec_ring;             // DISPATCH -> DECRYPT
+  ORBITSpsc_t         route_ring;           // DECRYPT -> ROUTE
+  ORBITSpsc_t         enc_ring;             // ROUTE -> ENCRYPT
+  ORBITSpsc_t         local_ring;           // ROUTE -> TX (deliver)
+  ORBITSpsc_t         tx_ring;              // ENCRYPT -> TX
+  ORBITSpsc_t         rx_key_ring;          // ROUTE -> DECRYPT (session installs)
+  ORBITSpsc_t         tx_key_ring;          // ROUTE -> ENCRYPT (session installs)
+
+  ORBITPipeThread_t   targ[ORBITPIPE_MAX_PORTS + ORBITPIPE_STAGES];
+  pthread_t           thread[ORBITPIPE_MAX_PORTS + ORBITPIPE_STAGES];
+  uint32_t            nthreads;
+  _Atomic bool        running;
+  uint64_t            t_start;
+  uint64_t            t_stop;
+
+  ORBITPipeStats_t    stats[ORBITPIPE_STAGES];
+  ORBITPipeStats_t    rx_stats[ORBITPIPE_MAX_PORTS];
+  ORBITMetrics_t      metrics;              // shard k: RX k, then ports + stage - 1
+};
+
+
+/* Fills defaults: every CPU unpinned, capacities 0 (= defaults above) */
+void ORBITPipe_config_default(ORBITPipeConfig_t *_cfg);
+
+int  ORBITPipe_init(ORBITPipe_t *_p, const ORBITPipeConfig_t *_cfg);
+void ORBITPipe_free(ORBITPipe_t *_p);
+
+/*
+ * Before ORBITPipe_start(): neighbor _addr on radio _port with X25519 shared
+ * secret _shared. Installs the link session in both crypto stages.
+ * Returns the neighbor slot, or L2D5NB_NIL.
+ */
+uint32_t ORBITPipe_add_neighbor(ORBITPipe_t *_p, const uint8_t *_addr, const uint8_t *_pubkey,
+                                const uint8_t *_shared, uint16_t _port);
+
+int  ORBITPipe_start(ORBITPipe_t *_p);
+void ORBITPipe_stop(ORBITPipe_t *_p);
+
+/* Per-stage frames, drops, Mframes/s, busy %, ns/frame, RX -> stage p50 / p99 */
+void ORBITPipe_report(ORBITPipe_t *_p, FILE *_out);
+
+const char *ORBITPipe_stage_name(int _stage);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_PIPELINE_H
@@ -0,0 +1,615 @@
+/*
+ * File:        src/ORBIT_radio.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Multi-interface radio I/O for Radio_ORBIT (io_uring / epoll).
+ *    See ORBIT_radio.h
+ *
+ */
+
+#define _GNU_SOURCE
+#include "ORBIT_radio.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define OP_RX     1ull
+#define OP_TX     2ull
+#define OP_CANCEL 3ull
+
+#define FRAME_BYTES ((uint32_t)sizeof(L2Frame))
+
+/* user_data: op << 48 | port << 32 | pool slot */
+static inline uint64_t ud_make(uint64_t _op, uint16_t _port, uint32_t _slot) {
+  return _op << 48 | (uint64_t)_port << 32 | _slot;
+}
+
+
+/* ------------------------------- common -------------------------------- */
+
+static void port_down(ORBITRadio_t *_r, ORBITRadioPort_t *_p, int32_t _res) {
+  if (!_p->up) {
+    return;
+  }
+  _p->up = false;
+  _p->err_pending = true;
+  _p->err_res = _res;
+  /* queued, never submitted: back to the pool, from the tail so [tx_head, tx_sub)
+   * stays what is in flight (io_uring; empty with epoll) and comes back on completion */
+  while (_p->tx_tail != _p->tx_sub) {
+    L2PoolCache_put(&_r->cache, _p->txq[--_p->tx_tail & (_r->cfg.tx_depth - 1)]);
+  }
+  if (_p->tx_head == _p->tx_sub) {
+    _p->tx_off = 0;                         // epoll: a frame written in part went with them
+  }
+}
+
+static inline bool rx_transient(const ORBITRadioPort_t *_p, int _err) {
+  /* connected UDP: ICMP unreachable from a peer not up yet */
+  return _err == EAGAIN || _err == EINTR || _err == ENOBUFS ||
+         (_p->kind == ORBITRADIO_DGRAM && _err == ECONNREFUSED);
+}
+
+static size_t emit_errors(ORBITRadio_t *_r, ORBITRadioEvent_t *_ev, size_t _n, size_t _max) {
+  for (uint16_t i = 0; i < _r->ports && _n < _max; i++) {
+    ORBITRadioPort_t *p = &_r->port[i];
+    if (p->err_pending) {
+      p->err_pending = false;
+      _ev[_n++] = (ORBITRadioEvent_t){ .buf = NULL, .port = i, .type = ORBITRADIO_EV_ERR, .res = p->err_res };
+    }
+  }
+  return _n;
+}
+
+
+/* ------------------------------- io_uring ------------------------------ */
+
+static int uring_setup(ORBITRadioUring_t *_u, uint32_t _entries, uint32_t _cq, struct io_uring_params *_prm) {
+  memset(_prm, 0, sizeof(*_prm));
+  _prm->flags = IORING_SETUP_CLAMP | IORING_SETUP_CQSIZE;
+  _prm->cq_entries = _cq > 2 * _entries ? _cq : 2 * _entries;
+  _u->fd = (int)syscall(__NR_io_uring_setup, _entries, _prm);
+  return _u->fd < 0 ? -1 : 0;
+}
+
+bool ORBITRadio_uring_supported(void) {
+  ORBITRadioUring_t u;
+  struct io_uring_params prm;
+  if (uring_setup(&u, 2, 4, &prm) != 0) {
+    return false;
+  }
+  close(u.fd);
+  return (prm.features & IORING_FEAT_EXT_ARG) != 0;
+}
+
+static void uring_unmap(ORBITRadioUring_t *_u) {
+  if (_u->sqes != NULL) {
+    munmap(_u->sqes, _u->sqes_len);
+  }
+  if (_u->cq_map != NULL && _u->cq_map != _u->sq_map) {
+    munmap(_u->cq_map, _u->cq_map_len);
+  }
+  if (_u->sq_map != NULL) {
+    munmap(_u->sq_map, _u->sq_map_len);
+  }
+  if (_u->fd >= 0) {
+    close(_u->fd);
+  }
+  memset(_u, 0, sizeof(*_u));
+  _u->fd = -1;
+}
+
+static int uring_init(ORBITRadio_t *_r) {
+  ORBITRadioUring_t *u = &_r->ring;
+  struct io_uring_params prm;
+  /* every port's reads and writes in flight at once still fit the CQ */
+  uint32_t cq_want = ORBITRADIO_MAX_PORTS * (_r->cfg.rx_depth + _r->cfg.tx_depth);
+  if (uring_setup(u, _r->cfg.entries, cq_want, &prm) != 0) {
+    u->fd = -1;
+    return -1;
+  }
+  if (!(prm.features & IORING_FEAT_EXT_ARG)) {
+    uring_unmap(u);
+    return -1;
+  }
+  u->sq_entries = prm.sq_entries;
+  u->cq_entries = prm.cq_entries;
+  u->sq_map_len = prm.sq_off.array + prm.sq_entries * sizeof(uint32_t);
+  u->cq_map_len = prm.cq_off.cqes + prm.cq_entries * sizeof(struct io_uring_cqe);
+  if (prm.features & IORING_FEAT_SINGLE_MMAP) {
+    u->sq_map_len = u->cq_map_len = u->sq_map_len > u->cq_map_len ? u->sq_map_len : u->cq_map_len;
+  }
+  u->sq_map = mmap(NULL, u->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                   IORING_OFF_SQ_RING);
+  if (u->sq_map == MAP_FAILED) {
+    u->sq_map = NULL;
+    uring_unmap(u);
+    return -1;
+  }
+  if (prm.features & IORING_FEAT_SINGLE_MMAP) {
+    u->cq_map = u->sq_map;
+  } else {
+    u->cq_map = mmap(NULL, u->cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                     IORING_OFF_CQ_RING);
+    if (u->cq_map == MAP_FAILED) {
+      u->cq_map = NULL;
+      uring_unmap(u);
+      return -1;
+    }
+  }
+  u->sqes_len = prm.sq_entries * sizeof(struct io_uring_sqe);
+  u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+  if (u->sqes == MAP_FAILED) {
+    u->sqes = NULL;
+    uring_unmap(u);
+    return -1;
+  }
+  uint8_t *sq = u->sq_map, *cq = u->cq_map;
+  u->sq_head  = (uint32_t *)(sq + prm.sq_off.head);
+  u->sq_tail  = (uint32_t *)(sq + prm.sq_off.tail);
+  u->sq_mask  = (uint32_t *)(sq + prm.sq_off.ring_mask);
+  u->sq_array = (uint32_t *)(sq + prm.sq_off.array);
+  u->cq_head  = (uint32_t *)(cq + prm.cq_off.head);
+  u->cq_tail  = (uint32_t *)(cq + prm.cq_off.tail);
+  u->cq_mask  = (uint32_t *)(cq + prm.cq_off.ring_mask);
+  u->cqes     = (struct io_uring_cqe *)(cq + prm.cq_off.cqes);
+
+  /* the whole pool as fixed buffer 0: no page pinning per I/O */
+  struct iovec iov = { _r->pool->bufs, (size_t)_r->pool->count * sizeof(L2PoolBuf_t) };
+  u->fixed = syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+  return 0;
+}
+
+/* Submits what is queued; with _wait, blocks up to _timeout_ms for one completion */
+static int uring_enter(ORBITRadio_t *_r, bool _wait, int _timeout_ms) {
+  ORBITRadioUring_t *u = &_r->ring;
+  struct __kernel_timespec ts = { _timeout_ms / 1000, (long long)(_timeout_ms % 1000) * 1000000 };
+  struct io_uring_getevents_arg arg = { .sigmask = 0, .sigmask_sz = _NSIG / 8, .ts = (uint64_t)(uintptr_t)&ts };
+  unsigned flags = 0;
+  void *argp = NULL;
+  size_t argsz = 0;
+  if (_wait) {
+    flags |= IORING_ENTER_GETEVENTS;
+    if (_timeout_ms >= 0) {
+      flags |= IORING_ENTER_EXT_ARG;
+      argp = &arg;
+      argsz = sizeof(arg);
+    }
+  } else if (u->to_submit == 0) {
+    return 0;
+  }
+  int rc;
+  do {
+    _r->syscalls++;
+    rc = (int)syscall(__NR_io_uring_enter, u->fd, u->to_submit, _wait ? 1u : 0u, flags, argp, argsz);
+  } while (rc < 0 && errno == EINTR);
+  if (rc > 0) {
+    u->to_submit -= (uint32_t)rc;
+    u->inflight += (uint32_t)rc;
+  }
+  /* ETIME: nothing completed in time; EBUSY / EAGAIN: reap first, submit next time */
+  return rc >= 0 || errno == ETIME || errno == EBUSY || errno == EAGAIN ? 0 : -1;
+}
+
+/* Next SQE, or NULL when the CQ could not take one more completion */
+static struct io_uring_sqe *uring_sqe(ORBITRadio_t *_r) {
+  ORBITRadioUring_t *u = &_r->ring;
+  if (u->inflight + u->to_submit >= u->cq_entries) {
+    return NULL;
+  }
+  uint32_t tail = *u->sq_tail;
+  if (tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+    if (uring_enter(_r, false, 0) != 0 || tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+      return NULL;
+    }
+  }
+  uint32_t idx = tail & *u->sq_mask;
+  struct io_uring_sqe *sqe = &u->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  u->sq_array[idx] = idx;
+  return sqe;
+}
+
+static inline void uring_commit(ORBITRadioUring_t *_u) {
+  __atomic_store_n(_u->sq_tail, *_u->sq_tail + 1, __ATOMIC_RELEASE);
+  _u->to_submit++;
+}
+
+static bool uring_rw(ORBITRadio_t *_r, bool _write, uint16_t _port, L2PoolBuf_t *_b, uint32_t _off) {
+  struct io_uring_sqe *sqe = uring_sqe(_r);
+  if (sqe == NULL) {
+    return false;
+  }
+  bool fixed = _r->ring.fixed;
+  sqe->opcode = _write ? (fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE)
+                       : (fixed ? IORING_OP_READ_FIXED : IORING_OP_READ);
+  sqe->fd = _r->port[_port].fd;
+  sqe->off = (uint64_t)-1;                  // current position: ttys, sockets
+  sqe->addr = (uint64_t)(uintptr_t)((uint8_t *)&_b->frame + _off);
+  sqe->len = FRAME_BYTES - _off;
+  sqe->buf_index = 0;
+  sqe->user_data = ud_make(_write ? OP_TX : OP_RX, _port, _b->index);
+  uring_commit(&_r->ring);
+  return true;
+}
+
+/* Reads to keep posted, queued frames to write: SQEs only, entered by the caller */
+static void uring_arm(ORBITRadio_t *_r) {
+  uint32_t mask = _r->cfg.tx_depth - 1;
+  for (uint16_t i = 0; i < _r->ports; i++) {
+    ORBITRadioPort_t *p = &_r->port[i];
+    if (!p->up) {
+      continue;
+    }
+    uint32_t rx_want = p->kind == ORBITRADIO_STREAM ? 1 : _r->cfg.rx_depth;
+    uint32_t tx_want = p->kind == ORBITRADIO_STREAM ? 1 : _r->cfg.tx_depth;
+    while (p->rx_posted < rx_want) {
+      L2PoolBuf_t *b = L2PoolCache_get(&_r->cache);
+      if (b == NULL) {
+        break;
+      }
+      if (!uring_rw(_r, false, i, b, 0)) {
+        L2PoolCache_put(&_r->cache, b);
+        break;
+      }
+      p->rx_posted++;
+    }
+    while (p->tx_posted < tx_want && p->tx_sub != p->tx_tail &&
+           uring_rw(_r, true, i, p->txq[p->tx_sub & mask], 0)) {
+      p->tx_sub++;
+      p->tx_posted++;
+    }
+  }
+}
+
+static size_t uring_reap(ORBITRadio_t *_r, ORBITRadioEvent_t *_ev, size_t _n, size_t _max) {
+  ORBITRadioUring_t *u = &_r->ring;
+  uint32_t head = *u->cq_head, tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail && _n < _max; head++) {
+    const struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+    uint64_t op = cqe->user_data >> 48;
+    uint16_t port = (uint16_t)(cqe->user_data >> 32);
+    int32_t res = cqe->res;
+    u->inflight--;
+    if (op == OP_CANCEL) {
+      continue;
+    }
+    ORBITRadioPort_t *p = &_r->port[port];
+    L2PoolBuf_t *b = &_r->pool->bufs[(uint32_t)cqe->user_data];
+
+    if (op == OP_RX) {
+      p->rx_posted--;
+      if (res > 0 && p->up) {
+        p->stats.rx_ops++;
+        p->stats.rx_bytes += (uint64_t)res;
+        _ev[_n++] = (ORBITRadioEvent_t){ .buf = b, .port = port, .type = ORBITRADIO_EV_RX, .res = res };
+        continue;
+      }
+      L2PoolCache_put(&_r->cache, b);
+      if (res < 0 && rx_transient(p, -res)) {
+        p->stats.errors += res != -EAGAIN && res != -EINTR;
+      } else if (res <= 0 && res != -ECANCELED) {
+        p->stats.errors += res < 0;
+        port_down(_r, p, res);
+      }
+      continue;
+    }
+
+    /* OP_TX: STREAM writes one frame at a time from tx_off, DGRAM all at once */
+    if (res > 0 && p->kind == ORBITRADIO_STREAM && p->tx_off + (uint32_t)res < FRAME_BYTES && p->up) {
+      p->tx_off += (uint32_t)res;
+      if (uring_rw(_r, true, port, b, p->tx_off)) {
+        continue;
+      }
+      res = -EAGAIN;                        // no SQE: the rest of the frame is lost with it
+    } else if (res == -EAGAIN && p->up && uring_rw(_r, true, port, b, p->kind == ORBITRADIO_STREAM ? p->tx_off : 0)) {
+      continue;
+    }
+    p->tx_posted--;
+    p->tx_head++;
+    p->tx_off = 0;
+    if (res > 0) {
+      p->stats.tx_frames++;
+    } else if (res != -ECANCELED) {
+      p->stats.errors++;
+      if (!(p->kind == ORBITRADIO_DGRAM && res == -ECONNREFUSED)) {
+        port_down(_r, p, res);
+      }
+    }
+    L2PoolCache_put(&_r->cache, b);
+  }
+  __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+  return _n;
+}
+
+static int uring_poll(ORBITRadio_t *_r, ORBITRadioEvent_t *_ev, size_t _max, int _timeout_ms) {
+  size_t n = emit_errors(_r, _ev, 0, _max);
+  n = uring_reap(_r, _ev, n, _max);
+  uring_arm(_r);
+  if (uring_enter(_r, n == 0 && _timeout_ms != 0, _timeout_ms) != 0) {
+    return -1;
+  }
+  n = uring_reap(_r, _ev, n, _max);
+  n = emit_errors(_r, _ev, n, _max);
+  uring_arm(_r);                            // re-posted reads go out with the next enter
+  return (int)n;
+}
+
+/* Cancels everything in flight and takes the buffers back */
+static void uring_drain(ORBITRadio_t *_r) {
+  ORBITRadioUring_t *u = &_r->ring;
+  ORBITRadioEvent_t ev[64];
+  for (uint16_t i = 0; i < _r->ports; i++) {
+    port_down(_r, &_r->port[i], 0);
+  }
+  struct io_uring_sqe *sqe = uring_sqe(_r);
+  if (sqe != NULL) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    sqe->user_data = ud_make(OP_CANCEL, 0, 0);
+    uring_commit(u);
+  }
+  for (int tries = 0; (u->inflight != 0 || u->to_submit != 0) && tries < 100; tries++) {
+    uring_enter(_r, u->inflight != 0 || u->to_submit != 0, 10);
+    size_t n = uring_reap(_r, ev, 0, sizeof(ev) / sizeof(ev[0]));
+    for (size_t k = 0; k < n; k++) {
+      if (ev[k].buf != NULL) {
+        L2PoolCache_put(&_r->cache, ev[k].buf);
+      }
+    }
+  }
+}
+
+
+/* -------------------------------- epoll -------------------------------- */
+
+static void epoll_out(ORBITRadio_t *_r, uint16_t _port, bool _want) {
+  ORBITRadioPort_t *p = &_r->port[_port];
+  if (p->want_out != _want) {
+    struct epoll_event e = { .events = EPOLLIN | (_want ? EPOLLOUT : 0), .data.u32 = _port };
+    epoll_ctl(_r->ep_fd, EPOLL_CTL_MOD, p->fd, &e);
+    p->want_out = _want;
+  }
+}
+
+static void epoll_tx(ORBITRadio_t *_r, uint16_t _port) {
+  ORBITRadioPort_t *p = &_r->port[_port];
+  uint32_t mask = _r->cfg.tx_depth - 1;
+  while (p->up && p->tx_head != p->tx_tail) {
+    L2PoolBuf_t *b = p->txq[p->tx_head & mask];
+    _r->syscalls++;
+    ssize_t w = write(p->fd, (uint8_t *)&b->frame + p->tx_off, FRAME_BYTES - p->tx_off);
+    if (w < 0 && errno == EINTR) {
+      continue;
+    }
+    if (w < 0 && errno == EAGAIN) {
+      epoll_out(_r, _port, true);
+      return;
+    }
+    if (w > 0 && p->kind == ORBITRADIO_STREAM && p->tx_off + (uint32_t)w < FRAME_BYTES) {
+      p->tx_off += (uint32_t)w;
+      continue;
+    }
+    p->tx_head++;
+    p->tx_sub = p->tx_head;
+    p->tx_off = 0;
+    L2PoolCache_put(&_r->cache, b);
+    if (w > 0) {
+      p->stats.tx_frames++;
+    } else if (w < 0) {
+      p->stats.errors++;
+      if (!(p->kind == ORBITRADIO_DGRAM && errno == ECONNREFUSED)) {
+        port_down(_r, p, -errno);
+      }
+    }
+  }
+  epoll_out(_r, _port, false);
+}
+
+static size_t epoll_rx(ORBITRadio_t *_r, uint16_t _port, ORBITRadioEvent_t *_ev, size_t _n, size_t _max) {
+  ORBITRadioPort_t *p = &_r->port[_port];
+  for (int k = 0; k < ORBITRADIO_RX_BUDGET && p->up && _n < _max; k++) {
+    L2PoolBuf_t *b = L2PoolCache_get(&_r->cache);
+    if (b == NULL) {
+      break;
+    }
+    _r->syscalls++;
+    ssize_t got = read(p->fd, &b->frame, FRAME_BYTES);
+    if (got > 0) {
+      p->stats.rx_ops++;
+      p->stats.rx_bytes += (uint64_t)got;
+      _ev[_n++] = (ORBITRadioEvent_t){ .buf = b, .port = _port, .type = ORBITRADIO_EV_RX, .res = (int32_t)got };
+      continue;
+    }
+    int err = got < 0 ? errno : 0;
+    L2PoolCache_put(&_r->cache, b);
+    if (got < 0 && rx_transient(p, err)) {
+      p->stats.errors += err != EAGAIN && err != EINTR;
+      if (err == EAGAIN) {
+        break;
+      }
+      continue;
+    }
+    p->stats.errors += got < 0;
+    port_down(_r, p, -err);
+  }
+  return _n;
+}
+
+static int epoll_poll(ORBITRadio_t *_r, ORBITRadioEvent_t *_ev, size_t _max, int _timeout_ms) {
+  struct epoll_event es[ORBITRADIO_MAX_PORTS];
+  size_t n = emit_errors(_r, _ev, 0, _max);
+  ORBITRadio_flush(_r);
+  n = emit_errors(_r, _ev, n, _max);
+  int ready;
+  do {
+    _r->syscalls++;
+    ready = epoll_wait(_r->ep_fd, es, ORBITRADIO_MAX_PORTS, n == 0 ? _timeout_ms : 0);
+  } while (ready < 0 && errno == EINTR);
+  if (ready < 0) {
+    return -1;
+  }
+  for (int i = 0; i < ready; i++) {
+    uint16_t port = (uint16_t)es[i].data.u32;
+    if (es[i].events & EPOLLOUT) {
+      epoll_tx(_r, port);
+    }
+    if (es[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+      n = epoll_rx(_r, port, _ev, n, _max);
+    }
+    if (!_r->port[port].up) {
+      epoll_ctl(_r->ep_fd, EPOLL_CTL_DEL, _r->port[port].fd, NULL);
+    }
+  }
+  return (int)emit_errors(_r, _ev, n, _max);
+}
+
+
+/* ------------------------------ lifecycle ------------------------------ */
+
+static uint32_t pow2_at_least(uint32_t _v) {
+  uint32_t p = 1;
+  while (p < _v) {
+    p <<= 1;
+  }
+  return p;
+}
+
+int ORBITRadio_init(ORBITRadio_t *_r, const ORBITRadioConfig_t *_cfg, L2Pool_t *_pool) {
+  memset(_r, 0, sizeof(*_r));
+  _r->ring.fd = -1;
+  _r->ep_fd = -1;
+  if (_pool == NULL || _cfg->backend > ORBITRADIO_EPOLL) {
+    return -1;
+  }
+  _r->cfg = *_cfg;
+  _r->cfg.rx_depth = _cfg->rx_depth ? _cfg->rx_depth : 8;
+  _r->cfg.tx_depth = pow2_at_least(_cfg->tx_depth ? _cfg->tx_depth : 64);
+  _r->cfg.entries = _cfg->entries ? _cfg->entries : 256;
+  _r->pool = _pool;
+  L2PoolCache_init(&_r->cache, _pool);
+
+  if (_cfg->backend != ORBITRADIO_EPOLL && uring_init(_r) == 0) {
+    _r->backend = ORBITRADIO_URING;
+    return 0;
+  }
+  if (_cfg->backend == ORBITRADIO_URING) {
+    return -1;
+  }
+  _r->ep_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (_r->ep_fd < 0) {
+    return -1;
+  }
+  _r->backend = ORBITRADIO_EPOLL;
+  return 0;
+}
+
+void ORBITRadio_free(ORBITRadio_t *_r) {
+  if (_r->backend == ORBITRADIO_URING) {
+    uring_drain(_r);
+    uring_unmap(&_r->ring);
+  }
+  for (uint16_t i = 0; i < _r->ports; i++) {
+    ORBITRadioPort_t *p = &_r->port[i];
+    port_down(_r, p, 0);
+    free(p->txq);
+  }
+  if (_r->ep_fd >= 0) {
+    close(_r->ep_fd);
+  }
+  if (_r->pool != NULL) {
+    L2PoolCache_flush(&_r->cache);
+  }
+  memset(_r, 0, sizeof(*_r));
+  _r->ring.fd = -1;
+  _r->ep_fd = -1;
+}
+
+int ORBITRadio_add_port(ORBITRadio_t *_r, int _fd, ORBITRadioKind_t _kind) {
+  if (_r->ports == ORBITRADIO_MAX_PORTS || _fd < 0 || _kind > ORBITRADIO_DGRAM) {
+    return -1;
+  }
+  int fl = fcntl(_fd, F_GETFL);
+  if (fl < 0 || fcntl(_fd, F_SETFL, fl | O_NONBLOCK) != 0) {
+    return -1;
+  }
+  uint16_t i = _r->ports;
+  ORBITRadioPort_t *p = &_r->port[i];
+  memset(p, 0, sizeof(*p));
+  p->fd = _fd;
+  p->kind = (uint8_t)_kind;
+  p->txq = calloc(_r->cfg.tx_depth, sizeof(*p->txq));
+  if (p->txq == NULL) {
+    return -1;
+  }
+  if (_r->backend == ORBITRADIO_EPOLL) {
+    struct epoll_event e = { .events = EPOLLIN, .data.u32 = i };
+    if (epoll_ctl(_r->ep_fd, EPOLL_CTL_ADD, _fd, &e) != 0) {
+      free(p->txq);
+      p->txq = NULL;
+      return -1;
+    }
+  }
+  p->up = true;
+  _r->ports++;
+  return i;
+}
+
+
+/* --------------------------------- I/O --------------------------------- */
+
+bool ORBITRadio_send(ORBITRadio_t *_r, uint16_t _port, L2PoolBuf_t *_buf) {
+  if (_port >= _r->ports || !_r->port[_port].up) {
+    L2PoolCache_put(&_r->cache, _buf);
+    return false;
+  }
+  ORBITRadioPort_t *p = &_r->port[_port];
+  if (p->tx_tail - p->tx_head == _r->cfg.tx_depth) {
+    p->stats.tx_full++;
+    L2PoolCache_put(&_r->cache, _buf);
+    return false;
+  }
+  p->txq[p->tx_tail++ & (_r->cfg.tx_depth - 1)] = _buf;
+  return true;
+}
+
+int ORBITRadio_flush(ORBITRadio_t *_r) {
+  if (_r->backend == ORBITRADIO_URING) {
+    uring_arm(_r);
+    return uring_enter(_r, false, 0);
+  }
+  for (uint16_t i = 0; i < _r->ports; i++) {
+    if (_r->port[i].tx_head != _r->port[i].tx_tail && !_r->port[i].want_out) {
+      epoll_tx(_r, i);
+    }
+  }
+  return 0;
+}
+
+int ORBITRadio_poll(ORBITRadio_t *_r, ORBITRadioEvent_t *_ev, size_t _max, int _timeout_ms) {
+  if (_max == 0) {
+    return 0;
+  }
+  return _r->backend == ORBITRADIO_URING ? uring_poll(_r, _ev, _max, _timeout_ms)
+                                         : epoll_poll(_r, _ev, _max, _timeout_ms);
+}
+
+const char *ORBITRadio_backend_name(ORBITRadioBackend_t _b) {
+  switch (_b) {
+    case ORBITRADIO_URING: return "io_uring";
+    case ORBITRADIO_EPOLL: return "epoll";
+    default:               return "auto";
+  }
+}
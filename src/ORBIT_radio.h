@@ -0,0 +1,203 @@
+/*
+ * File:        src/ORBIT_radio.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Multi-interface radio I/O for Radio_ORBIT: one thread drives every
+ *    modem link (serial / SPI / TTY byte streams, UDP-encapsulated links)
+ *    with batched submission and completion, io_uring first, epoll as the
+ *    fallback.
+ *
+ *
+ *  Buffers are L2Pool slots (one L2Frame each). With io_uring the whole
+ *  pool is registered once, so reads and writes are READ_FIXED /
+ *  WRITE_FIXED straight into / out of the slots:
+ *
+ *   ORBITRadio_send(port, buf) --> TX queue of the port --+
+ *                                                         |  one io_uring_enter():
+ *   reads kept posted on every port --------------------->+  submit all, reap all
+ *                                                         |
+ *   ORBITRadio_poll() <-- RX events (buf, port, bytes) <--+  TX done: buf put back
+ *
+ *  | Kind   | Link                      | RX unit                  | In flight      |
+ *  -----------------------------------------------------------------------------------
+ *  | STREAM | tty / pty / serial / SPI  | up to 224 bytes of a     | 1 read, 1 write|
+ *  |        |                           | byte stream: deframe it  | (keeps order)  |
+ *  | DGRAM  | connected UDP socket      | one datagram = one frame | rx_depth reads,|
+ *  |        |                           | (zero copy into the pool)| tx_depth writes|
+ *
+ *  epoll backend: level-triggered EPOLLIN per port, read(2) until EAGAIN
+ *  (bounded per poll), write(2) on send with EPOLLOUT for the remainder.
+ *  Same events, same ownership rules.
+ *
+ *  AUTO picks io_uring when the kernel has it with IORING_FEAT_EXT_ARG
+ *  (5.11+, timed waits without a timeout SQE), else epoll. Registering the
+ *  pool may fail (RLIMIT_MEMLOCK on old kernels): io_uring then uses plain
+ *  READ / WRITE on the same slots.
+ *
+ * NOTE:
+ *   - Single thread: every call on one ORBITRadio_t from the same thread.
+ *   - RX event buffers belong to the caller (L2PoolCache_put them back via
+ *     ORBITRadio_put() or keep them, e.g. a DGRAM frame into the pipeline).
+ *   - ORBITRadio_send() consumes one reference of the buffer.
+ *   - Pool size: ports * (rx_depth + tx_depth) buffers at least.
+ *
+ */
+
+#ifndef ORBIT_RADIO_H
+#define ORBIT_RADIO_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+#include "L2_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define ORBITRADIO_MAX_PORTS  64
+#define ORBITRADIO_RX_BUDGET  16            // epoll: reads per ready port per poll
+
+
+typedef enum {
+  ORBITRADIO_AUTO = 0,
+  ORBITRADIO_URING,
+  ORBITRADIO_EPOLL
+} ORBITRadioBackend_t;
+
+typedef enum {
+  ORBITRADIO_STREAM = 0,
+  ORBITRADIO_DGRAM
+} ORBITRadioKind_t;
+
+typedef enum {
+  ORBITRADIO_EV_RX = 0,                     // res bytes in buf->frame
+  ORBITRADIO_EV_ERR                         // port stopped: res -errno, 0 on EOF; buf NULL
+} ORBITRadioEventType_t;
+
+
+typedef struct {
+  L2PoolBuf_t *buf;
+  uint16_t     port;
+  uint8_t      type;                        // ORBITRadioEventType_t
+  int32_t      res;
+} ORBITRadioEvent_t;
+
+
+typedef struct {
+  ORBITRadioBackend_t backend;
+  uint32_t            rx_depth;             // DGRAM reads posted per port, 0 -> 8
+  uint32_t            tx_depth;             // queued frames per port, 0 -> 64
+  uint32_t            entries;              // io_uring SQ entries, 0 -> 256
+} ORBITRadioConfig_t;
+
+
+typedef struct {
+  uint64_t rx_ops;                          // completed reads (bytes > 0)
+  uint64_t rx_bytes;
+  uint64_t tx_frames;                       // whole frames written
+  uint64_t tx_full;                         // send() refused, TX queue full
+  uint64_t errors;                          // failed reads / writes
+} ORBITRadioPortStats_t;
+
+
+typedef struct {
+  int                   fd;
+  uint8_t               kind;               // ORBITRadioKind_t
+  bool                  up;                 // false after EOF / error
+  bool                  want_out;           // epoll: EPOLLOUT armed
+  bool                  err_pending;        // ERR event not yet returned
+  int32_t               err_res;
+  uint32_t              rx_posted;          // io_uring reads in flight
+  uint32_t              tx_posted;          // io_uring writes in flight
+  L2PoolBuf_t         **txq;                // tx_depth slots, power of 2
+  uint32_t              tx_head;            // oldest queued
+  uint32_t              tx_sub;             // next to submit / write
+  uint32_t              tx_tail;
+  uint32_t              tx_off;             // STREAM: bytes of txq[tx_head] already written
+  ORBITRadioPortStats_t stats;
+} ORBITRadioPort_t;
+
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/* io_uring rings as mapped from the kernel */
+typedef struct {
+  int                  fd;
+  uint32_t            *sq_head, *sq_tail, *sq_mask, *sq_array;
+  uint32_t            *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void                *sq_map, *cq_map;
+  size_t               sq_map_len, cq_map_len, sqes_len;
+  uint32_t             sq_entries, cq_entries;
+  uint32_t             to_submit;           // SQEs written, not yet entered
+  uint32_t             inflight;            // submitted, completion not reaped
+  bool                 fixed;               // pool registered as buffer 0
+} ORBITRadioUring_t;
+
+
+typedef struct {
+  ORBITRadioConfig_t cfg;
+  ORBITRadioBackend_t backend;              // resolved
+  L2Pool_t          *pool;
+  L2PoolCache_t      cache;
+  ORBITRadioPort_t   port[ORBITRADIO_MAX_PORTS];
+  uint16_t           ports;
+  ORBITRadioUring_t  ring;
+  int                ep_fd;
+  uint64_t           syscalls;              // enter / epoll_wait / read / write issued
+} ORBITRadio_t;
+
+
+/* _pool must outlive the radio. Returns 0, or -1 (backend unavailable / allocation). */
+int  ORBITRadio_init(ORBITRadio_t *_r, const ORBITRadioConfig_t *_cfg, L2Pool_t *_pool);
+/* Closes the ring / epoll fd and puts every buffer back; the port fds stay open */
+void ORBITRadio_free(ORBITRadio_t *_r);
+
+/* Port index, or -1. The fd is switched to O_NONBLOCK; DGRAM sockets must be connected. */
+int  ORBITRadio_add_port(ORBITRadio_t *_r, int _fd, ORBITRadioKind_t _kind);
+
+/*
+ * Queues one sealed frame (consumes a reference of _buf). Written on the
+ * next ORBITRadio_poll() / ORBITRadio_flush(), one batch for every port.
+ * false when the port is down or its queue is full (_buf is put back).
+ */
+bool ORBITRadio_send(ORBITRadio_t *_r, uint16_t _port, L2PoolBuf_t *_buf);
+
+/* Submits queued writes without waiting. Returns 0, or -1. */
+int  ORBITRadio_flush(ORBITRadio_t *_r);
+
+/*
+ * Submits, then waits up to _timeout_ms (0: no wait, -1: forever) for at
+ * least one completion and returns up to _max events, or -1 on error.
+ * TX completions are handled inside and produce no events.
+ */
+int  ORBITRadio_poll(ORBITRadio_t *_r, ORBITRadioEvent_t *_ev, size_t _max, int _timeout_ms);
+
+static inline void ORBITRadio_put(ORBITRadio_t *_r, L2PoolBuf_t *_buf) {
+  L2PoolCache_put(&_r->cache, _buf);
+}
+
+/* Buffer for a frame to send, refcnt 1, or NULL when the pool is empty */
+static inline L2PoolBuf_t *ORBITRadio_get(ORBITRadio_t *_r) {
+  return L2PoolCache_get(&_r->cache);
+}
+
+/* io_uring usable on this kernel (with IORING_FEAT_EXT_ARG) */
+bool ORBITRadio_uring_supported(void);
+const char *ORBITRadio_backend_name(ORBITRadioBackend_t _b);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_RADIO_H
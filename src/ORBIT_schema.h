@@ -0,0 +1,238 @@
+/*
+ * File:        src/ORBIT_schema.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Frame schema for Radio_ORBIT.
+ *    One X-macro list per wire struct (offset, length, byte order, check,
+ *    hex-view color of every field); from it are generated:
+ *
+ *      - STATIC_ASSERTs that the list matches the struct in L2_struct.h /
+ *        L2D5_struct.h field by field and covers it without gaps
+ *      - <Prefix>_get_<Field> / <Prefix>_set_<Field> for multi-byte
+ *        integers: one load / store + byte swap (ORBIT_bytes.h)
+ *      - <Prefix>_validate(): whole-struct check without branches, bit
+ *        <Prefix>_F_<Field> set for every field that fails
+ *      - <Prefix>_fields(): name / offset / length / color table, for
+ *        printHexTable color maps and error tags
+ *
+ *  | Prefix       | Struct                       | Checked                 |
+ *  ---------------------------------------------------------------------------
+ *  | L2Frame      | L2Frame                      | SFD, EFD                |
+ *  | L2D5Frame    | L2D5Frame_t                  | TAG is an L2D5TAG_t     |
+ *  | L2D5FrameEnc | L2D5Frame_Encrypted_t        | TAG ENCRYPTED bit       |
+ *  | L2D5HelloPkt | L2D5Routing_HelloPkt_t       | Padding all zero        |
+ *  | L2D5NbRecord | L2D5Routing_NeighborTable_t  | -                       |
+ *  | L2D5RmRecord | L2D5Routing_RemoteTable_t    | -                       |
+ *
+ *  | Kind  | C type   | Accessors                        |
+ *  ----------------------------------------------------
+ *  | U8    | uint8_t  | plain member                     |
+ *  | BE16  | uint16_t | ORBIT_load_be16 / store_be16     |
+ *  | BE32  | uint32_t | ORBIT_load_be32 / store_be32     |
+ *  | SBE32 | int32_t  | ORBIT_load_be32 / store_be32     |
+ *  | BE64  | uint64_t | ORBIT_load_be64 / store_be64     |
+ *  | BYTES | -        | none (addresses, keys, payloads) |
+ *
+ * NOTE:
+ *   - The structs themselves stay as they are (DO NOT MODIFY); a field
+ *     moved there without the list here fails to compile.
+ *   - L2Frame ChkSum is not checked by L2Frame_validate(): the CRC32 is
+ *     L2_deframer's job.
+ *   - KeyHint is BYTES: it is compared as raw bytes (L2D5Key_hint_load).
+ *
+ */
+
+#ifndef ORBIT_SCHEMA_H
+#define ORBIT_SCHEMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "L2_struct.h"
+#include "L2D5_struct.h"
+#include "ORBIT_bytes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef enum {
+  ORBIT_SCHEMA_U8 = 0,
+  ORBIT_SCHEMA_BE16,
+  ORBIT_SCHEMA_BE32,
+  ORBIT_SCHEMA_SBE32,
+  ORBIT_SCHEMA_BE64,
+  ORBIT_SCHEMA_BYTES
+} ORBITSchemaKind_t;
+
+typedef struct {
+  const char *name;
+  uint16_t    off;
+  uint16_t    len;
+  uint8_t     kind;                       // ORBITSchemaKind_t
+  const char *color;                      // ANSI escape for hex views
+} ORBITSchemaField_t;
+
+
+/* ---- field checks: (field bytes, length) -> ok, no branches ---- */
+
+static inline bool ORBITSchema_ok_any(const uint8_t *_p, size_t _n) {
+  (void)_p;
+  (void)_n;
+  return true;
+}
+
+static inline bool ORBITSchema_ok_zero(const uint8_t *_p, size_t _n) {
+  uint8_t acc = 0;
+  for (size_t i = 0; i < _n; i++) {
+    acc |= _p[i];
+  }
+  return acc == 0;
+}
+
+static inline bool ORBITSchema_ok_sfd(const uint8_t *_p, size_t _n) {
+  (void)_n;
+  return _p[0] == MAGIC_L2LAYER_SFD;
+}
+
+static inline bool ORBITSchema_ok_efd(const uint8_t *_p, size_t _n) {
+  (void)_n;
+  return _p[0] == MAGIC_L2LAYER_EFD;
+}
+
+static inline bool ORBITSchema_ok_l2d5tag(const uint8_t *_p, size_t _n) {
+  (void)_n;
+  uint8_t t = _p[0];
+  return (t == L2D5TAG_HELLO_PKT_NB) | (t == L2D5TAG_HELLO_PKT_RM) |
+         (t == L2D5TAG_TCP_DATA_DC) | (t == L2D5TAG_TCP_DATA_RM);
+}
+
+static inline bool ORBITSchema_ok_encrypted(const uint8_t *_p, size_t _n) {
+  (void)_n;
+  return (_p[0] & 0x80) != 0;              // TAG bit 0 (MSB first)
+}
+
+
+/* ---- schemas: X(Prefix, Type, Field, Offset, Length, Kind, Check, Color) ---- */
+
+#define ORBIT_SCHEMA_L2FRAME(X, P, T) \
+  X(P, T, SFD,            0x00,   1, U8,    sfd,      "\033[1;32m") \
+  X(P, T, TAG,            0x01,   2, BYTES, any,      "\033[0;33m") \
+  X(P, T, Payload,        0x03, 216, BYTES, any,      "\033[0;36m") \
+  X(P, T, ChkSum,         0xDB,   4, BE32,  any,      "\033[0;35m") \
+  X(P, T, EFD,            0xDF,   1, U8,    efd,      "\033[1;31m")
+
+#define ORBIT_SCHEMA_L2D5FRAME(X, P, T) \
+  X(P, T, TAG,            0x00,   1, U8,    l2d5tag,  "\033[1;32m") \
+  X(P, T, KeyHint,        0x01,   4, BYTES, any,      "\033[0;33m") \
+  X(P, T, FLAG,           0x05,   1, U8,    any,      "\033[1;93m") \
+  X(P, T, SrcAddress,     0x06,  16, BYTES, any,      "\033[0;36m") \
+  X(P, T, DstAddress,     0x16,  16, BYTES, any,      "\033[0;94m") \
+  X(P, T, TTL,            0x26,   2, BE16,  any,      "\033[1;35m") \
+  X(P, T, Payload,        0x28, 176, BYTES, any,      "\033[0;95m")
+
+#define ORBIT_SCHEMA_L2D5FRAMEENC(X, P, T) \
+  X(P, T, TAG,            0x00,   1, U8,    encrypted, "\033[1;32m") \
+  X(P, T, KeyHint,        0x01,   4, BYTES, any,       "\033[0;33m") \
+  X(P, T, FLAG,           0x05,   1, U8,    any,       "\033[1;93m") \
+  X(P, T, EncryptedPayload, 0x06, 210, BYTES, any,     "\033[0;90m")
+
+#define ORBIT_SCHEMA_L2D5HELLOPKT(X, P, T) \
+  X(P, T, NodeSrcAddr,    0x00,  16, BYTES, any,      "\033[0;36m") \
+  X(P, T, PublicKey,      0x10,  32, BYTES, any,      "\033[0;32m") \
+  X(P, T, TimeStamp,      0x30,   4, BE32,  any,      "\033[0;33m") \
+  X(P, T, SEQ,            0x34,   2, BE16,  any,      "\033[1;93m") \
+  X(P, T, NodesLimit,     0x36,   2, BE16,  any,      "\033[1;35m") \
+  X(P, T, Padding,        0x38, 120, BYTES, zero,     "\033[0;90m")
+
+#define ORBIT_SCHEMA_L2D5NBRECORD(X, P, T) \
+  X(P, T, NodeAddr,       0x00,  16, BYTES, any,      "\033[0;36m") \
+  X(P, T, PublicKey,      0x10,  32, BYTES, any,      "\033[0;32m") \
+  X(P, T, SharedKey,      0x30,  32, BYTES, any,      "\033[0;31m") \
+  X(P, T, last_seen_time, 0x50,   8, BE64,  any,      "\033[0;33m") \
+  X(P, T, last_rssi,      0x58,   4, SBE32, any,      "\033[1;93m") \
+  X(P, T, NodesLimit,     0x5C,   2, BE16,  any,      "\033[1;35m")
+
+#define ORBIT_SCHEMA_L2D5RMRECORD(X, P, T) \
+  X(P, T, NodeAddr,       0x00,  16, BYTES, any,      "\033[0;36m") \
+  X(P, T, PublicKey,      0x10,  32, BYTES, any,      "\033[0;32m") \
+  X(P, T, SharedKey,      0x30,  32, BYTES, any,      "\033[0;31m") \
+  X(P, T, NextHopAddr,    0x50,  16, BYTES, any,      "\033[0;94m") \
+  X(P, T, last_seen_time, 0x60,   8, BE64,  any,      "\033[0;33m") \
+  X(P, T, NodesLimit,     0x68,   2, BE16,  any,      "\033[1;35m") \
+  X(P, T, hops,           0x6A,   2, BE16,  any,      "\033[1;93m")
+
+
+/* ---- generators ---- */
+
+#define ORBIT_SCHEMA_ENUM(P, T, F, O, L, K, C, H)   P##_F_##F,
+#define ORBIT_SCHEMA_LEN(P, T, F, O, L, K, C, H)    + (L)
+#define ORBIT_SCHEMA_CHECK(P, T, F, O, L, K, C, H) \
+  STATIC_ASSERT(offsetof(T, F) == (O) && sizeof(((T *)0)->F) == (L), P##_##F##_matches_struct);
+
+#define ORBIT_SCHEMA_VALID(P, T, F, O, L, K, C, H) \
+  bad |= (uint32_t)!ORBITSchema_ok_##C(p + (O), (L)) << P##_F_##F;
+
+#define ORBIT_SCHEMA_ROW(P, T, F, O, L, K, C, H)    { #F, (O), (L), ORBIT_SCHEMA_##K, H },
+
+#define ORBIT_SCHEMA_ACCESS(P, T, F, O, L, K, C, H) ORBIT_SCHEMA_ACCESS_##K(P, T, F)
+
+#define ORBIT_SCHEMA_ACCESS_U8(P, T, F) \
+  static inline uint8_t P##_get_##F(const T *_p) { return _p->F; } \
+  static inline void P##_set_##F(T *_p, uint8_t _v) { _p->F = _v; }
+
+#define ORBIT_SCHEMA_ACCESS_BE16(P, T, F) \
+  static inline uint16_t P##_get_##F(const T *_p) { return ORBIT_load_be16(_p->F); } \
+  static inline void P##_set_##F(T *_p, uint16_t _v) { ORBIT_store_be16(_p->F, _v); }
+
+#define ORBIT_SCHEMA_ACCESS_BE32(P, T, F) \
+  static inline uint32_t P##_get_##F(const T *_p) { return ORBIT_load_be32(_p->F); } \
+  static inline void P##_set_##F(T *_p, uint32_t _v) { ORBIT_store_be32(_p->F, _v); }
+
+#define ORBIT_SCHEMA_ACCESS_SBE32(P, T, F) \
+  static inline int32_t P##_get_##F(const T *_p) { return (int32_t)ORBIT_load_be32(_p->F); } \
+  static inline void P##_set_##F(T *_p, int32_t _v) { ORBIT_store_be32(_p->F, (uint32_t)_v); }
+
+#define ORBIT_SCHEMA_ACCESS_BE64(P, T, F) \
+  static inline uint64_t P##_get_##F(const T *_p) { return ORBIT_load_be64(_p->F); } \
+  static inline void P##_set_##F(T *_p, uint64_t _v) { ORBIT_store_be64(_p->F, _v); }
+
+#define ORBIT_SCHEMA_ACCESS_BYTES(P, T, F)
+
+/* Everything for one schema; P##_validate(): 0 = valid, else bit P##_F_<Field> per failed field */
+#define ORBIT_SCHEMA_DEFINE(P, T, LIST) \
+  enum { LIST(ORBIT_SCHEMA_ENUM, P, T) P##_FIELDS }; \
+  STATIC_ASSERT(P##_FIELDS <= 32, P##_fits_validate_mask); \
+  STATIC_ASSERT(0 LIST(ORBIT_SCHEMA_LEN, P, T) == sizeof(T), P##_covers_struct); \
+  LIST(ORBIT_SCHEMA_CHECK, P, T) \
+  LIST(ORBIT_SCHEMA_ACCESS, P, T) \
+  static inline uint32_t P##_validate(const T *_s) { \
+    const uint8_t *p = (const uint8_t *)_s; \
+    uint32_t bad = 0; \
+    LIST(ORBIT_SCHEMA_VALID, P, T) \
+    return bad; \
+  } \
+  static inline const ORBITSchemaField_t *P##_fields(size_t *_n) { \
+    static const ORBITSchemaField_t rows[] = { LIST(ORBIT_SCHEMA_ROW, P, T) }; \
+    *_n = P##_FIELDS; \
+    return rows; \
+  }
+
+
+ORBIT_SCHEMA_DEFINE(L2Frame,      L2Frame,                     ORBIT_SCHEMA_L2FRAME)
+ORBIT_SCHEMA_DEFINE(L2D5Frame,    L2D5Frame_t,                 ORBIT_SCHEMA_L2D5FRAME)
+ORBIT_SCHEMA_DEFINE(L2D5FrameEnc, L2D5Frame_Encrypted_t,       ORBIT_SCHEMA_L2D5FRAMEENC)
+ORBIT_SCHEMA_DEFINE(L2D5HelloPkt, L2D5Routing_HelloPkt_t,      ORBIT_SCHEMA_L2D5HELLOPKT)
+ORBIT_SCHEMA_DEFINE(L2D5NbRecord, L2D5Routing_NeighborTable_t, ORBIT_SCHEMA_L2D5NBRECORD)
+ORBIT_SCHEMA_DEFINE(L2D5RmRecord, L2D5Routing_RemoteTable_t,   ORBIT_SCHEMA_L2D5RMRECORD)
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_SCHEMA_H
@@ -0,0 +1,61 @@
+/*
+ * File:        src/ORBIT_schema_view.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Hex views of Radio_ORBIT frames from the frame schema.
+ *    Turns a <Prefix>_fields() table (ORBIT_schema.h) into a printHexTable
+ *    color map and a color legend, so every struct is drawn from the same
+ *    field list that is checked against it at compile time.
+ *
+ *
+ *  | Helper                    | Output                                     |
+ *  --------------------------------------------------------------------------
+ *  | ORBITSchema_color_map()   | one color per field, [ ] around multi-byte |
+ *  | ORBITSchema_legend()      | "<color> ██ <name>" per field, one line    |
+ *
+ * NOTE:
+ *   - Needs printHexTable (<printHexTable/printHexTable.h>); only the
+ *     struct test programs include this, the library does not.
+ *   - Field offsets must fit the 256-byte map (every schema struct does).
+ *
+ */
+
+#ifndef ORBIT_SCHEMA_VIEW_H
+#define ORBIT_SCHEMA_VIEW_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "ORBIT_schema.h"
+#include <printHexTable/printHexTable.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* printHexTable color map from the schema: one color per field, [ ] around multi-byte fields */
+static inline void ORBITSchema_color_map(ANSIColorMap256_t *_map, const ORBITSchemaField_t *_fields, size_t _n) {
+  for (size_t i = 0; i < _n; i++) {
+    uint8_t first = (uint8_t)_fields[i].off, last = (uint8_t)(_fields[i].off + _fields[i].len - 1);
+    char open = _fields[i].len > 1 ? '[' : ' ', close = _fields[i].len > 1 ? ']' : ' ';
+    addr2AnsiColorMap256(_map, first, last, (char *)_fields[i].color, first, open, last, close, 1);
+  }
+}
+
+static inline void ORBITSchema_legend(const ORBITSchemaField_t *_fields, size_t _n) {
+  for (size_t i = 0; i < _n; i++) {
+    printf("%s ██ %s\e[0m\t", _fields[i].color, _fields[i].name);
+  }
+  printf("\n");
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_SCHEMA_VIEW_H
@@ -0,0 +1,976 @@
+/*
+ * File:        src/ORBIT_sim.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Discrete-event mesh simulator for Radio_ORBIT.
+ *
+ * NOTE:
+ *   - See ORBIT_sim.h for the protocol and link model.
+ *
+ */
+
+#define _GNU_SOURCE
+#include "ORBIT_sim.h"
+#include "ORBIT_bytes.h"
+#include "ORBIT_schema.h"
+#include "L2D5_addr.h"
+#include "L2_struct.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+enum {
+  EV_HELLO = 0,
+  EV_TX_START,
+  EV_TX_END
+};
+
+
+static uint64_t wall_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t rng_next(ORBITSim_t *_s) {
+  _s->rng += 0x9E3779B97F4A7C15ull;
+  return L2D5ADDR_mix64(_s->rng);
+}
+
+static inline double rng_unit(ORBITSim_t *_s) {
+  return (double)(rng_next(_s) >> 11) * 0x1.0p-53;
+}
+
+static inline uint64_t rng_below(ORBITSim_t *_s, uint64_t _n) {
+  return _n == 0 ? 0 : rng_next(_s) % _n;
+}
+
+
+/* ---------------------------- calendar queue ---------------------------- */
+
+static int calq_init(ORBITSimCalQ_t *_q, uint32_t _nbuckets, uint32_t _width_shift) {
+  memset(_q, 0, sizeof(*_q));
+  _q->bucket = malloc((size_t)_nbuckets * sizeof(uint32_t));
+  if (_q->bucket == NULL) {
+    return -1;
+  }
+  for (uint32_t i = 0; i < _nbuckets; i++) {
+    _q->bucket[i] = ORBITSIM_NIL;
+  }
+  _q->nbuckets = _nbuckets;
+  _q->width_shift = _width_shift;
+  _q->bucket_top = 1ull << _width_shift;
+  _q->ev_free = ORBITSIM_NIL;
+  return 0;
+}
+
+static void calq_free(ORBITSimCalQ_t *_q) {
+  free(_q->ev);
+  free(_q->bucket);
+  memset(_q, 0, sizeof(*_q));
+}
+
+/* Sorted insert; equal times stay FIFO */
+static void calq_link(ORBITSimCalQ_t *_q, uint32_t _e) {
+  uint64_t t = _q->ev[_e].time;
+  uint32_t *pp = &_q->bucket[(t >> _q->width_shift) & (_q->nbuckets - 1)];
+  while (*pp != ORBITSIM_NIL && _q->ev[*pp].time <= t) {
+    pp = &_q->ev[*pp].next;
+    _q->steps++;
+  }
+  _q->ev[_e].next = *pp;
+  *pp = _e;
+}
+
+/* Unlinks the earliest event, or ORBITSIM_NIL. The slab entry is still owned by the caller. */
+static uint32_t calq_unlink_min(ORBITSimCalQ_t *_q) {
+  if (_q->count == 0) {
+    return ORBITSIM_NIL;
+  }
+  uint32_t mask = _q->nbuckets - 1;
+  uint64_t width = 1ull << _q->width_shift;
+  for (uint32_t i = 0; i < _q->nbuckets; i++) {
+    uint32_t e = _q->bucket[_q->cur];
+    if (e != ORBITSIM_NIL && _q->ev[e].time < _q->bucket_top) {
+      _q->bucket[_q->cur] = _q->ev[e].next;
+      _q->count--;
+      _q->last_time = _q->ev[e].time;
+      return e;
+    }
+    _q->cur = (_q->cur + 1) & mask;
+    _q->bucket_top += width;
+  }
+
+  /* a whole year empty: jump straight to the earliest event */
+  uint32_t best = ORBITSIM_NIL;
+  for (uint32_t i = 0; i < _q->nbuckets; i++) {
+    uint32_t e = _q->bucket[i];
+    if (e != ORBITSIM_NIL && (best == ORBITSIM_NIL || _q->ev[e].time < _q->ev[best].time)) {
+      best = e;
+    }
+  }
+  uint64_t slot = _q->ev[best].time >> _q->width_shift;
+  _q->cur = (uint32_t)(slot & mask);
+  _q->bucket_top = (slot + 1) << _q->width_shift;
+  _q->bucket[_q->cur] = _q->ev[best].next;
+  _q->count--;
+  _q->last_time = _q->ev[best].time;
+  return best;
+}
+
+static void calq_seek(ORBITSimCalQ_t *_q, uint64_t _t) {
+  uint64_t slot = _t >> _q->width_shift;
+  _q->cur = (uint32_t)(slot & (_q->nbuckets - 1));
+  _q->bucket_top = (slot + 1) << _q->width_shift;
+}
+
+/*
+ * New bucket count, width from the mean gap between the next few events
+ * (gaps over twice the mean ignored), times three.
+ */
+static int calq_resize(ORBITSimCalQ_t *_q, uint32_t _nbuckets) {
+  enum { SAMPLE = 32 };
+  uint32_t held[SAMPLE];
+  uint32_t n = 0;
+  uint64_t last = _q->last_time;
+  uint32_t cur = _q->cur;
+  uint64_t top = _q->bucket_top;
+  while (n < SAMPLE && _q->count > 0) {
+    held[n++] = calq_unlink_min(_q);
+  }
+  uint32_t shift = _q->width_shift;
+  if (n >= 2) {
+    double mean = (double)(_q->ev[held[n - 1]].time - _q->ev[held[0]].time) / (n - 1);
+    double sum = 0;
+    uint32_t k = 0;
+    for (uint32_t i = 1; i < n; i++) {
+      uint64_t gap = _q->ev[held[i]].time - _q->ev[held[i - 1]].time;
+      if (gap <= 2 * mean) {
+        sum += (double)gap;
+        k++;
+      }
+    }
+    double width = k != 0 ? 3 * sum / k : 3 * mean;
+    shift = 0;
+    while (shift < 40 && (double)(1ull << shift) < width) {
+      shift++;
+    }
+  }
+  _q->count += n;
+
+  uint32_t *old = _q->bucket;
+  uint32_t old_n = _q->nbuckets;
+  _q->bucket = malloc((size_t)_nbuckets * sizeof(uint32_t));
+  if (_q->bucket == NULL) {
+    /* keep the old geometry; put the sample back */
+    _q->bucket = old;
+    _q->cur = cur;
+    _q->bucket_top = top;
+    for (uint32_t i = 0; i < n; i++) {
+      calq_link(_q, held[i]);
+    }
+    _q->last_time = last;
+    return -1;
+  }
+  for (uint32_t i = 0; i < _nbuckets; i++) {
+    _q->bucket[i] = ORBITSIM_NIL;
+  }
+  _q->nbuckets = _nbuckets;
+  _q->width_shift = shift;
+  for (uint32_t b = 0; b < old_n; b++) {
+    uint32_t e = old[b];
+    while (e != ORBITSIM_NIL) {
+      uint32_t next = _q->ev[e].next;
+      calq_link(_q, e);
+      e = next;
+    }
+  }
+  free(old);
+  for (uint32_t i = 0; i < n; i++) {
+    calq_link(_q, held[i]);
+  }
+  _q->last_time = last;
+  calq_seek(_q, last);
+  _q->resizes++;
+  return 0;
+}
+
+static int calq_push(ORBITSimCalQ_t *_q, uint64_t _time, uint32_t _node, uint32_t _kind, uint32_t _arg) {
+  if (_q->ev_free == ORBITSIM_NIL) {
+    uint32_t cap = _q->ev_cap ? _q->ev_cap * 2 : 1024;
+    ORBITSimEvent_t *ev = realloc(_q->ev, (size_t)cap * sizeof(ORBITSimEvent_t));
+    if (ev == NULL) {
+      return -1;
+    }
+    for (uint32_t i = _q->ev_cap; i < cap; i++) {
+      ev[i].next = i + 1 < cap ? i + 1 : ORBITSIM_NIL;
+    }
+    _q->ev = ev;
+    _q->ev_free = _q->ev_cap;
+    _q->ev_cap = cap;
+  }
+  uint32_t e = _q->ev_free;
+  _q->ev_free = _q->ev[e].next;
+  _q->ev[e].time = _time;
+  _q->ev[e].node = _node;
+  _q->ev[e].kind = _kind;
+  _q->ev[e].arg = _arg;
+  calq_link(_q, e);
+  _q->count++;
+  if (_q->count > 2 * _q->nbuckets) {
+    calq_resize(_q, _q->nbuckets * 2);
+  } else if (++_q->ops == 4096) {
+    /* the event density drifted away from the width: re-estimate it */
+    if (_q->steps > 8 * 4096) {
+      calq_resize(_q, _q->nbuckets);
+    }
+    _q->ops = _q->steps = 0;
+  }
+  return 0;
+}
+
+static void calq_release(ORBITSimCalQ_t *_q, uint32_t _e) {
+  _q->ev[_e].next = _q->ev_free;
+  _q->ev_free = _e;
+  if (_q->nbuckets > 64 && _q->count < _q->nbuckets / 2) {
+    calq_resize(_q, _q->nbuckets / 2);
+  }
+}
+
+
+/* ------------------------------ frame slab ------------------------------ */
+
+static uint32_t slab_get(ORBITSim_t *_s) {
+  if (_s->slab_free == ORBITSIM_NIL) {
+    uint32_t cap = _s->slab_cap ? _s->slab_cap * 2 : 1024;
+    ORBITSimFrame_t *f = realloc(_s->slab, (size_t)cap * sizeof(ORBITSimFrame_t));
+    if (f == NULL) {
+      return ORBITSIM_NIL;
+    }
+    for (uint32_t i = _s->slab_cap; i < cap; i++) {
+      f[i].next = i + 1 < cap ? i + 1 : ORBITSIM_NIL;
+    }
+    _s->slab = f;
+    _s->slab_free = _s->slab_cap;
+    _s->slab_cap = cap;
+  }
+  uint32_t i = _s->slab_free;
+  _s->slab_free = _s->slab[i].next;
+  _s->slab[i].next = ORBITSIM_NIL;
+  return i;
+}
+
+static void slab_put(ORBITSim_t *_s, uint32_t _i) {
+  _s->slab[_i].next = _s->slab_free;
+  _s->slab_free = _i;
+}
+
+
+/* ------------------------------ radio model ------------------------------ */
+
+/* Queue slab frame _f on node _n; arms TX_START after up to _jitter us */
+static void radio_send(ORBITSim_t *_s, uint32_t _n, uint32_t _f, uint64_t _jitter) {
+  ORBITSimNode_t *nd = &_s->node[_n];
+  if (nd->q_head == ORBITSIM_NIL) {
+    nd->q_head = _f;
+  } else {
+    _s->slab[nd->q_tail].next = _f;
+  }
+  nd->q_tail = _f;
+  if (!nd->tx_armed) {
+    nd->tx_armed = true;
+    calq_push(&_s->q, _s->now + rng_below(_s, _jitter + 1), _n, EV_TX_START, 0);
+  }
+}
+
+static void radio_tx_start(ORBITSim_t *_s, uint32_t _n) {
+  ORBITSimNode_t *nd = &_s->node[_n];
+  uint64_t now = _s->now;
+  if (nd->dead) {
+    while (nd->q_head != ORBITSIM_NIL) {
+      uint32_t fi = nd->q_head;
+      nd->q_head = _s->slab[fi].next;
+      slab_put(_s, fi);
+    }
+    nd->tx_armed = false;
+    return;
+  }
+  /* carrier sense: defer while hearing someone */
+  if (nd->rx_end > now) {
+    calq_push(&_s->q, nd->rx_end + 1 + rng_below(_s, _s->cfg.relay_jitter_us), _n, EV_TX_START, 0);
+    return;
+  }
+  uint64_t end = now + _s->airtime_us;
+  nd->tx_start = now;
+  nd->tx_end = end;
+  for (uint32_t k = _s->adj_off[_n]; k < _s->adj_off[_n + 1]; k++) {
+    ORBITSimNode_t *r = &_s->node[_s->adj[k].to];
+    if (r->rx_end > now) {
+      uint64_t until = r->rx_end > end ? r->rx_end : end;
+      r->rx_coll_until = r->rx_coll_until > until ? r->rx_coll_until : until;
+    }
+    if (r->rx_end < end) {
+      r->rx_end = end;
+    }
+  }
+  _s->stats.tx_frames++;
+  _s->stats.tx_bytes += sizeof(L2Frame);
+  calq_push(&_s->q, end, _n, EV_TX_END, 0);
+}
+
+/* Best (SEQ, hops) currently held for _dest: newest SEQ, then fewest hops */
+static bool route_best(const L2D5RouteTable_t *_r, uint32_t _dest, uint16_t *_seq, uint16_t *_hops) {
+  const L2D5RouteCand_t *c = &_r->cand[(size_t)_dest * L2D5ROUTE_CANDIDATES];
+  bool any = false;
+  for (int k = 0; k < L2D5ROUTE_CANDIDATES; k++) {
+    if (c[k].nb_slot == L2D5NB_NIL) {
+      continue;
+    }
+    if (!any || (int16_t)(c[k].seq - *_seq) > 0 || (c[k].seq == *_seq && c[k].hops < *_hops)) {
+      *_seq = c[k].seq;
+      *_hops = c[k].hops;
+      any = true;
+    }
+  }
+  return any;
+}
+
+/* Trickle was reset: HELLO events already queued for _n go stale */
+static void hello_rearm(ORBITSim_t *_s, uint32_t _n) {
+  ORBITSimNode_t *nd = &_s->node[_n];
+  _s->stats.hello_resets++;
+  calq_push(&_s->q, L2D5Trickle_next(&nd->trickle), _n, EV_HELLO, ++nd->hello_gen);
+}
+
+static void node_receive(ORBITSim_t *_s, uint32_t _n, const L2D5Frame_t *_f, int32_t _rssi) {
+  ORBITSimNode_t *nd = &_s->node[_n];
+  const L2D5Routing_HelloPkt_t *h = (const L2D5Routing_HelloPkt_t *)_f->Payload;
+  uint16_t limit = L2D5HelloPkt_get_NodesLimit(h);
+
+  if (_f->TAG == L2D5TAG_HELLO_PKT_NB) {
+    unsigned flags = 0;
+    uint32_t slot = L2D5Neighbor_observe(&nd->nb, h->NodeSrcAddr, h->PublicKey, _s->now, _rssi, &flags);
+    if (slot != L2D5NB_NIL) {
+      nd->nb.nodes_limit[slot] = limit;
+      if (nd->aging.nb != NULL) {
+        L2D5Aging_neighbor_seen(&nd->aging, slot, _s->now);
+      }
+      if (nd->trickle.last_seq != NULL &&
+          L2D5Trickle_hello(&nd->trickle, slot, L2D5HelloPkt_get_SEQ(h), flags, _s->now)) {
+        hello_rearm(_s, _n);
+      }
+    }
+    return;
+  }
+  if (_f->TAG != L2D5TAG_HELLO_PKT_RM || L2D5ADDR_equal(h->NodeSrcAddr, _s->addr[_n])) {
+    return;
+  }
+  uint32_t via = L2D5Neighbor_find(&nd->nb, _f->SrcAddress);
+  uint16_t ttl = L2D5Frame_get_TTL(_f);
+  if (via == L2D5NB_NIL || ttl == 0 || ttl > limit) {
+    return;
+  }
+  L2D5Neighbor_touch(&nd->nb, via, _s->now, _rssi);
+  if (nd->aging.nb != NULL) {
+    L2D5Aging_neighbor_seen(&nd->aging, via, _s->now);
+  }
+  uint16_t hops = (uint16_t)(limit - ttl + 1);
+  uint16_t seq = L2D5HelloPkt_get_SEQ(h), best_seq = 0, best_hops = 0;
+
+  bool fresh = true;
+  if (_s->cfg.flood == ORBITSIM_FLOOD_DUPCACHE) {
+    fresh = L2D5Dup_forward(L2D5Dup_check_hello(&nd->dup, _f, _s->now));
+  } else if (_s->cfg.flood == ORBITSIM_FLOOD_ROUTE) {
+    uint32_t dest = L2D5Route_find(&nd->route, h->NodeSrcAddr);
+    fresh = dest == L2D5ROUTE_NIL || !route_best(&nd->route, dest, &best_seq, &best_hops) ||
+            (int16_t)(seq - best_seq) > 0 || (seq == best_seq && hops < best_hops);
+  }
+
+  uint32_t before = nd->route.count;
+  bool changed = false;
+  uint32_t dest = L2D5Route_hello(&nd->route, h, via, hops, _s->now, &changed);
+  if (dest == L2D5ROUTE_NIL && nd->route.count == nd->route.capacity) {
+    _s->stats.routes_full++;
+  }
+  if (dest != L2D5ROUTE_NIL && nd->aging.nb != NULL) {
+    L2D5Aging_route_seen(&nd->aging, dest, _s->now);
+  }
+  if (changed) {
+    _s->stats.route_changes++;
+  }
+  if (nd->route.count > before) {
+    /* a node never heard before is a topology change too */
+    if (nd->trickle.last_seq != NULL && L2D5Trickle_reset(&nd->trickle, _s->now)) {
+      hello_rearm(_s, _n);
+    }
+    _s->stats.routes_known++;
+    if (_s->stats.coverage99_at_us == UINT64_MAX && _s->stats.routes_known * 100 >= _s->stats.reach_total * 99) {
+      _s->stats.coverage99_at_us = _s->now;
+    }
+  }
+  if (nd->route.count > before && nd->route.count >= nd->reach && !nd->complete) {
+    nd->complete = true;
+    if (++_s->stats.nodes_complete == _s->cfg.nodes) {
+      _s->stats.converged_at_us = _s->now;
+    }
+  }
+
+  if (ttl > 1 && !fresh) {
+    _s->stats.relay_suppressed++;
+  }
+  if (fresh && ttl > 1) {
+    uint32_t fi = slab_get(_s);
+    if (fi == ORBITSIM_NIL) {
+      return;
+    }
+    L2D5Frame_t *out = &_s->slab[fi].frame;
+    memcpy(out, _f, sizeof(*out));
+    memcpy(out->SrcAddress, _s->addr[_n], 16);
+    L2D5Frame_set_TTL(out, (uint16_t)(ttl - 1));
+    _s->stats.tx_relay++;
+    radio_send(_s, _n, fi, _s->cfg.relay_jitter_us);
+  }
+}
+
+static void radio_tx_end(ORBITSim_t *_s, uint32_t _n) {
+  ORBITSimNode_t *nd = &_s->node[_n];
+  uint32_t fi = nd->q_head;
+  nd->q_head = _s->slab[fi].next;
+  /* receivers may grow the slab while relaying */
+  L2D5Frame_t f;
+  memcpy(&f, &_s->slab[fi].frame, sizeof(f));
+
+  for (uint32_t k = _s->adj_off[_n]; k < _s->adj_off[_n + 1]; k++) {
+    const ORBITSimLink_t *l = &_s->adj[k];
+    ORBITSimNode_t *r = &_s->node[l->to];
+    if (r->dead) {
+      continue;
+    }
+    if (r->tx_start < nd->tx_end && r->tx_end > nd->tx_start) {
+      _s->stats.rx_half_duplex++;
+    } else if (_s->cfg.collisions && r->rx_coll_until > nd->tx_start) {
+      _s->stats.rx_collided++;
+    } else if (rng_unit(_s) < l->loss) {
+      _s->stats.rx_lost++;
+    } else {
+      _s->stats.rx_ok++;
+      node_receive(_s, l->to, &f, l->rssi + (int32_t)rng_below(_s, 5) - 2);
+    }
+  }
+  slab_put(_s, fi);
+
+  if (nd->q_head != ORBITSIM_NIL) {
+    calq_push(&_s->q, _s->now + 1 + rng_below(_s, _s->cfg.relay_jitter_us), _n, EV_TX_START, 0);
+  } else {
+    nd->tx_armed = false;
+  }
+}
+
+static void make_hello(ORBITSim_t *_s, uint32_t _n, L2D5Frame_t *_f, uint8_t _tag, uint16_t _ttl) {
+  ORBITSimNode_t *nd = &_s->node[_n];
+  memset(_f, 0, sizeof(*_f));
+  _f->TAG = _tag;
+  _f->FLAG = L2D5FLAG_MKFLAG(15, L2D5FLAG_ERR_NML, L2D5FLAG_NUL_A);
+  memcpy(_f->SrcAddress, _s->addr[_n], 16);
+  memset(_f->DstAddress, 0xFF, 16);
+  L2D5Frame_set_TTL(_f, _ttl);
+  L2D5Routing_HelloPkt_t *h = (L2D5Routing_HelloPkt_t *)_f->Payload;
+  memcpy(h->NodeSrcAddr, _s->addr[_n], 16);
+  /* stand-in public key: a function of the node, nothing stored */
+  for (int i = 0; i < 4; i++) {
+    uint64_t k = L2D5ADDR_mix64(_s->cfg.seed ^ ((uint64_t)_n << 2 | (uint64_t)i));
+    memcpy(h->PublicKey + 8 * i, &k, 8);
+  }
+  L2D5HelloPkt_set_TimeStamp(h, (uint32_t)(_s->now / 1000000));
+  L2D5HelloPkt_set_SEQ(h, nd->seq);
+  L2D5HelloPkt_set_NodesLimit(h, _s->cfg.nodes_limit);
+}
+
+static void node_hello(ORBITSim_t *_s, uint32_t _n, uint32_t _gen) {
+  ORBITSimNode_t *nd = &_s->node[_n];
+  bool trickle = nd->trickle.last_seq != NULL;
+  if (nd->dead || (trickle && _gen != nd->hello_gen)) {
+    return;
+  }
+  if (nd->aging.nb != NULL) {
+    uint64_t nb_before = nd->aging.nb_expired;
+    uint32_t routes_before = nd->route.count;
+    L2D5Aging_advance(&nd->aging, _s->now);
+    _s->stats.nb_expired += nd->aging.nb_expired - nb_before;
+    _s->stats.routes_expired += routes_before - nd->route.count;
+    _s->stats.routes_known -= routes_before - nd->route.count;
+  }
+  if (trickle) {
+    uint64_t suppressed = nd->trickle.suppressed;
+    bool send = L2D5Trickle_poll(&nd->trickle, _s->now);
+    _s->stats.hello_suppressed += nd->trickle.suppressed - suppressed;
+    if (!send) {
+      calq_push(&_s->q, L2D5Trickle_next(&nd->trickle), _n, EV_HELLO, nd->hello_gen);
+      return;
+    }
+  }
+  uint32_t nb = slab_get(_s), rm = slab_get(_s);
+  if (nb != ORBITSIM_NIL) {
+    make_hello(_s, _n, &_s->slab[nb].frame, L2D5TAG_HELLO_PKT_NB, 1);
+    _s->stats.tx_hello_nb++;
+    radio_send(_s, _n, nb, 0);
+  }
+  if (rm != ORBITSIM_NIL) {
+    nd->seq++;
+    make_hello(_s, _n, &_s->slab[rm].frame, L2D5TAG_HELLO_PKT_RM, _s->cfg.nodes_limit);
+    _s->stats.tx_hello_rm++;
+    radio_send(_s, _n, rm, 0);
+  }
+  if (trickle) {
+    calq_push(&_s->q, L2D5Trickle_next(&nd->trickle), _n, EV_HELLO, nd->hello_gen);
+    return;
+  }
+  /* +-5 % so the phases keep drifting apart */
+  uint64_t p = _s->cfg.hello_period_us;
+  calq_push(&_s->q, _s->now + p - p / 20 + rng_below(_s, p / 10 + 1), _n, EV_HELLO, 0);
+}
+
+
+/* ------------------------------- topology ------------------------------- */
+
+static int build_links(ORBITSim_t *_s) {
+  uint32_t n = _s->cfg.nodes;
+  double range = _s->cfg.range_m;
+  uint32_t cells = (uint32_t)ceil(_s->side_m / range);
+  if (cells == 0) {
+    cells = 1;
+  }
+  size_t ncell = (size_t)cells * cells;
+  uint32_t *cell_off = calloc(ncell + 1, sizeof(uint32_t));
+  uint32_t *cell_node = malloc((size_t)n * sizeof(uint32_t));
+  uint32_t *cell_of = malloc((size_t)n * sizeof(uint32_t));
+  _s->adj_off = calloc((size_t)n + 1, sizeof(uint32_t));
+  if (!cell_off || !cell_node || !cell_of || !_s->adj_off) {
+    free(cell_off);
+    free(cell_node);
+    free(cell_of);
+    return -1;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t cx = (uint32_t)(_s->node[i].x / range), cy = (uint32_t)(_s->node[i].y / range);
+    cx = cx < cells ? cx : cells - 1;
+    cy = cy < cells ? cy : cells - 1;
+    cell_of[i] = cy * cells + cx;
+    cell_off[cell_of[i] + 1]++;
+  }
+  for (size_t c = 0; c < ncell; c++) {
+    cell_off[c + 1] += cell_off[c];
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    cell_node[cell_off[cell_of[i]]++] = i;
+  }
+  for (size_t c = ncell; c > 0; c--) {
+    cell_off[c] = cell_off[c - 1];
+  }
+  cell_off[0] = 0;
+
+  /* two passes over the 3x3 cell neighborhood: count, then fill */
+  for (int pass = 0; pass < 2; pass++) {
+    uint32_t w = 0;
+    for (uint32_t i = 0; i < n; i++) {
+      int cx = (int)(cell_of[i] % cells), cy = (int)(cell_of[i] / cells);
+      if (pass == 1) {
+        w = _s->adj_off[i];
+      }
+      uint32_t deg = 0;
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          int x = cx + dx, y = cy + dy;
+          if (x < 0 || y < 0 || x >= (int)cells || y >= (int)cells) {
+            continue;
+          }
+          uint32_t c = (uint32_t)y * cells + (uint32_t)x;
+          for (uint32_t k = cell_off[c]; k < cell_off[c + 1]; k++) {
+            uint32_t j = cell_node[k];
+            double ddx = _s->node[i].x - _s->node[j].x, ddy = _s->node[i].y - _s->node[j].y;
+            double d = sqrt(ddx * ddx + ddy * ddy);
+            if (j == i || d > range) {
+              continue;
+            }
+            deg++;
+            if (pass == 1) {
+              double r = d / range;
+              ORBITSimLink_t *l = &_s->adj[w++];
+              l->to = j;
+              l->loss = (float)(_s->cfg.loss_base + _s->cfg.loss_edge * r * r * r * r);
+              l->rssi = (int16_t)lround(_s->cfg.tx_dbm - 40.0 - 10.0 * _s->cfg.pathloss_exp * log10(d > 1 ? d : 1));
+            }
+          }
+        }
+      }
+      if (pass == 0) {
+        _s->adj_off[i + 1] = _s->adj_off[i] + deg;
+      }
+    }
+    if (pass == 0) {
+      _s->adj = malloc((size_t)_s->adj_off[n] * sizeof(ORBITSimLink_t) + 1);
+      if (_s->adj == NULL) {
+        break;
+      }
+    }
+  }
+  free(cell_off);
+  free(cell_node);
+  free(cell_of);
+  if (_s->adj == NULL) {
+    return -1;
+  }
+  _s->stats.links = _s->adj_off[n];
+  return 0;
+}
+
+/*
+ * BFS from _src up to _depth hops. _stamp / _dist are scratch arrays of
+ * cfg.nodes; _out gets the nodes found (excluding _src). Returns the count.
+ */
+static uint32_t bfs_ball(const ORBITSim_t *_s, uint32_t _src, uint32_t _depth, uint32_t *_stamp,
+                         uint32_t _mark, uint8_t *_dist, uint32_t *_out) {
+  uint32_t head = 0, tail = 0;
+  _stamp[_src] = _mark;
+  _dist[_src] = 0;
+  _out[tail++] = _src;
+  while (head < tail) {
+    uint32_t u = _out[head++];
+    if (_dist[u] >= _depth) {
+      continue;
+    }
+    for (uint32_t k = _s->adj_off[u]; k < _s->adj_off[u + 1]; k++) {
+      uint32_t v = _s->adj[k].to;
+      if (_stamp[v] != _mark) {
+        _stamp[v] = _mark;
+        _dist[v] = (uint8_t)(_dist[u] + 1);
+        _out[tail++] = v;
+      }
+    }
+  }
+  /* drop _src from the front */
+  memmove(_out, _out + 1, (size_t)(tail - 1) * sizeof(uint32_t));
+  return tail - 1;
+}
+
+/* Allocated bytes, same rounding as the table allocators */
+static size_t alloc_bytes(size_t _n, size_t _size) {
+  return (_n * _size + 63) & ~(size_t)63;
+}
+
+static size_t nb_table_bytes(const L2D5NeighborTable_t *_t) {
+  size_t c = _t->capacity;
+  return alloc_bytes(c, 1) + alloc_bytes(c, 16) + alloc_bytes(c, sizeof(uint64_t)) +
+         alloc_bytes(c, sizeof(int32_t)) + alloc_bytes(c, sizeof(uint32_t)) + alloc_bytes(c, sizeof(uint16_t)) +
+         alloc_bytes(c, 1) + alloc_bytes(c, sizeof(L2D5NeighborKeys_t));
+}
+
+static size_t route_table_bytes(const L2D5RouteTable_t *_r) {
+  size_t c = _r->capacity;
+  return alloc_bytes(c, 16) + alloc_bytes(c, sizeof(uint64_t)) +
+         alloc_bytes((size_t)_r->idx_mask + 1, sizeof(L2D5RouteIndexEntry_t)) +
+         alloc_bytes(c * L2D5ROUTE_CANDIDATES, sizeof(L2D5RouteCand_t)) +
+         alloc_bytes(_r->nb_capacity, sizeof(uint32_t)) + alloc_bytes(c, sizeof(uint32_t)) +
+         alloc_bytes(c, sizeof(L2D5RouteCold_t));
+}
+
+
+/* ------------------------------- lifecycle ------------------------------- */
+
+void ORBITSim_config_default(ORBITSimConfig_t *_cfg) {
+  memset(_cfg, 0, sizeof(*_cfg));
+  _cfg->nodes = 1000;
+  _cfg->degree = 10.0;
+  _cfg->seed = 1;
+  _cfg->range_m = 500.0;
+  _cfg->loss_base = 0.02;
+  _cfg->loss_edge = 0.30;
+  _cfg->tx_dbm = 14.0;
+  _cfg->pathloss_exp = 2.7;
+  _cfg->bitrate_bps = 250000;
+  _cfg->preamble_us = 500;
+  _cfg->collisions = true;
+  _cfg->nodes_limit = 3;
+  _cfg->hello_period_us = 30000000;
+  _cfg->relay_jitter_us = 200000;
+  _cfg->route_slack = 8;
+  _cfg->trickle_imin_us = 5000000;
+  _cfg->trickle_doublings = 5;
+  _cfg->trickle_k = 3;
+  _cfg->trickle_max_suppress = 1;
+}
+
+int ORBITSim_init(ORBITSim_t *_s, const ORBITSimConfig_t *_cfg) {
+  memset(_s, 0, sizeof(*_s));
+  _s->cfg = *_cfg;
+  uint32_t n = _cfg->nodes;
+  if (n == 0 || _cfg->nodes_limit == 0 || _cfg->nodes_limit > 255 || _cfg->bitrate_bps == 0 ||
+      _cfg->hello_period_us == 0 || calq_init(&_s->q, 1024, 12) != 0) {
+    return -1;
+  }
+  _s->rng = _cfg->seed;
+  _s->slab_free = ORBITSIM_NIL;
+  _s->stats.converged_at_us = UINT64_MAX;
+  _s->stats.coverage99_at_us = UINT64_MAX;
+  _s->airtime_us = _cfg->preamble_us + ((uint64_t)sizeof(L2Frame) * 8 * 1000000 + _cfg->bitrate_bps - 1) /
+                                       _cfg->bitrate_bps;
+  _s->side_m = sqrt((double)n * M_PI * _cfg->range_m * _cfg->range_m / _cfg->degree);
+
+  _s->node = calloc(n, sizeof(ORBITSimNode_t));
+  _s->addr = malloc((size_t)n * 16);
+  if (_s->node == NULL || _s->addr == NULL) {
+    ORBITSim_free(_s);
+    return -1;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    ORBITSimNode_t *nd = &_s->node[i];
+    nd->x = (float)(rng_unit(_s) * _s->side_m);
+    nd->y = (float)(rng_unit(_s) * _s->side_m);
+    nd->q_head = nd->q_tail = ORBITSIM_NIL;
+    /* 12 random bytes, then the node index so a next hop maps back to a node */
+    uint64_t a = rng_next(_s), b = rng_next(_s);
+    memcpy(_s->addr[i], &a, 8);
+    memcpy(_s->addr[i] + 8, &b, 4);
+    ORBIT_store_be32(_s->addr[i] + 12, i);
+  }
+  if (build_links(_s) != 0) {
+    ORBITSim_free(_s);
+    return -1;
+  }
+
+  uint32_t *stamp = calloc(n, sizeof(uint32_t));
+  uint8_t *dist = malloc(n);
+  uint32_t *ball = malloc((size_t)n * sizeof(uint32_t) + sizeof(uint32_t));
+  int rc = stamp && dist && ball ? 0 : -1;
+  for (uint32_t i = 0; rc == 0 && i < n; i++) {
+    ORBITSimNode_t *nd = &_s->node[i];
+    nd->reach = bfs_ball(_s, i, _cfg->nodes_limit, stamp, i + 1, dist, ball);
+    _s->stats.reach_total += nd->reach;
+    uint32_t deg = _s->adj_off[i + 1] - _s->adj_off[i];
+    uint32_t cap = nd->reach + _cfg->route_slack;
+    if (L2D5Neighbor_init(&nd->nb, deg + deg / 4 + 1) != 0 ||
+        L2D5Route_init(&nd->route, &nd->nb, cap != 0 ? cap : 1) != 0) {
+      rc = -1;
+      break;
+    }
+    if (_cfg->flood == ORBITSIM_FLOOD_DUPCACHE &&
+        L2D5Dup_init(&nd->dup, cap, 4 * _cfg->hello_period_us) != 0) {
+      rc = -1;
+      break;
+    }
+    if (_cfg->expiry_periods != 0 &&
+        L2D5Aging_init(&nd->aging, &nd->nb, &nd->route, _cfg->expiry_periods * _cfg->hello_period_us,
+                       _cfg->expiry_periods * _cfg->hello_period_us, _cfg->hello_period_us / 64 + 1, 0) != 0) {
+      rc = -1;
+      break;
+    }
+    if (_cfg->hello == ORBITSIM_HELLO_TRICKLE &&
+        L2D5Trickle_init(&nd->trickle, nd->nb.capacity, _cfg->trickle_imin_us, _cfg->trickle_doublings,
+                         _cfg->trickle_k, _cfg->trickle_max_suppress, 0, rng_next(_s)) != 0) {
+      rc = -1;
+      break;
+    }
+    _s->table_bytes += nb_table_bytes(&nd->nb) + route_table_bytes(&nd->route) +
+                       (nd->dup.tag != NULL ? L2D5Dup_bytes(&nd->dup) : 0) +
+                       (nd->aging.nb != NULL ? L2D5Aging_bytes(&nd->aging) : 0) +
+                       (nd->trickle.last_seq != NULL ? L2D5Trickle_bytes(&nd->trickle) : 0);
+    if (nd->reach == 0) {
+      nd->complete = true;
+      _s->stats.nodes_complete++;
+    }
+    uint64_t first = nd->trickle.last_seq != NULL ? L2D5Trickle_next(&nd->trickle)
+                                                  : rng_below(_s, _cfg->hello_period_us);
+    calq_push(&_s->q, first, i, EV_HELLO, 0);
+  }
+  free(stamp);
+  free(dist);
+  free(ball);
+  if (rc != 0) {
+    ORBITSim_free(_s);
+    return -1;
+  }
+  if (_s->stats.nodes_complete == n) {
+    _s->stats.converged_at_us = _s->stats.coverage99_at_us = 0;
+  }
+  return 0;
+}
+
+void ORBITSim_free(ORBITSim_t *_s) {
+  if (_s->node != NULL) {
+    for (uint32_t i = 0; i < _s->cfg.nodes; i++) {
+      if (_s->node[i].route.addr != NULL) {
+        L2D5Route_free(&_s->node[i].route);
+      }
+      if (_s->node[i].dup.tag != NULL) {
+        L2D5Dup_free(&_s->node[i].dup);
+      }
+      if (_s->node[i].aging.nb != NULL) {
+        L2D5Aging_free(&_s->node[i].aging);
+      }
+      if (_s->node[i].trickle.last_seq != NULL) {
+        L2D5Trickle_free(&_s->node[i].trickle);
+      }
+      if (_s->node[i].nb.ctrl != NULL) {
+        L2D5Neighbor_free(&_s->node[i].nb);
+      }
+    }
+  }
+  free(_s->node);
+  free(_s->addr);
+  free(_s->adj_off);
+  free(_s->adj);
+  free(_s->slab);
+  calq_free(&_s->q);
+  memset(_s, 0, sizeof(*_s));
+}
+
+
+/* -------------------------------- running -------------------------------- */
+
+uint64_t ORBITSim_run(ORBITSim_t *_s, uint64_t _until_us) {
+  uint64_t t0 = wall_ns(), done = 0;
+  for (;;) {
+    uint32_t e = calq_unlink_min(&_s->q);
+    if (e == ORBITSIM_NIL) {
+      break;
+    }
+    ORBITSimEvent_t ev = _s->q.ev[e];
+    if (ev.time > _until_us) {
+      /* not yet: put it back where it was */
+      _s->q.count++;
+      calq_link(&_s->q, e);
+      calq_seek(&_s->q, ev.time);
+      break;
+    }
+    calq_release(&_s->q, e);
+    _s->now = ev.time;
+    switch (ev.kind) {
+      case EV_HELLO:    node_hello(_s, ev.node, ev.arg); break;
+      case EV_TX_START: radio_tx_start(_s, ev.node); break;
+      case EV_TX_END:   radio_tx_end(_s, ev.node);   break;
+      default: break;
+    }
+    done++;
+  }
+  if (_s->now < _until_us) {
+    _s->now = _until_us;
+  }
+  _s->stats.events += done;
+  _s->stats.wall_ns += wall_ns() - t0;
+  return done;
+}
+
+void ORBITSim_kill(ORBITSim_t *_s, uint32_t _node) {
+  if (_node < _s->cfg.nodes) {
+    _s->node[_node].dead = true;
+  }
+}
+
+void ORBITSim_verify(ORBITSim_t *_s, uint32_t _sources, ORBITSimVerify_t *_out) {
+  uint32_t n = _s->cfg.nodes, limit = _s->cfg.nodes_limit;
+  memset(_out, 0, sizeof(*_out));
+  uint32_t *stamp = calloc(n, sizeof(uint32_t));
+  uint8_t *dist = malloc(n);
+  uint32_t *ball = malloc((size_t)n * sizeof(uint32_t) + sizeof(uint32_t));
+  if (stamp == NULL || dist == NULL || ball == NULL) {
+    free(stamp);
+    free(dist);
+    free(ball);
+    return;
+  }
+  uint32_t step = _sources == 0 || _sources >= n ? 1 : n / _sources;
+  double stretch = 0;
+  for (uint32_t u = 0, mark = 1; u < n; u += step, mark++) {
+    uint32_t m = bfs_ball(_s, u, limit, stamp, mark, dist, ball);
+    for (uint32_t i = 0; i < m; i++) {
+      uint32_t v = ball[i], cur = u, hops = 0;
+      _out->pairs++;
+      while (cur != v && hops < 2 * limit) {
+        uint32_t slot = L2D5Route_next_hop(&_s->node[cur].route, _s->addr[v]);
+        if (slot == L2D5NB_NIL) {
+          break;
+        }
+        if (hops == 0) {
+          _out->known++;
+        }
+        cur = ORBIT_load_be32(_s->node[cur].nb.addr[slot] + 12);
+        hops++;
+      }
+      if (cur == v) {
+        _out->delivered++;
+        _out->shortest += hops == dist[v];
+        stretch += (double)hops / dist[v];
+      }
+    }
+  }
+  _out->stretch = _out->delivered != 0 ? stretch / (double)_out->delivered : 0;
+  free(stamp);
+  free(dist);
+  free(ball);
+}
+
+double ORBITSim_node_bytes(const ORBITSim_t *_s, double *_sim_bytes) {
+  uint32_t n = _s->cfg.nodes;
+  if (_sim_bytes != NULL) {
+    size_t sim = (size_t)n * (sizeof(ORBITSimNode_t) + 16 + sizeof(uint32_t)) +
+                 (size_t)_s->stats.links * sizeof(ORBITSimLink_t) + (size_t)_s->q.ev_cap * sizeof(ORBITSimEvent_t) +
+                 (size_t)_s->q.nbuckets * sizeof(uint32_t) + (size_t)_s->slab_cap * sizeof(ORBITSimFrame_t);
+    *_sim_bytes = (double)sim / n;
+  }
+  return (double)_s->table_bytes / n;
+}
+
+void ORBITSim_report(const ORBITSim_t *_s, FILE *_out) {
+  const ORBITSimStats_t *st = &_s->stats;
+  uint32_t n = _s->cfg.nodes;
+  double sim_s = (double)_s->now * 1e-6, wall_s = (double)st->wall_ns * 1e-9;
+  double per_node_sim = 0, per_node = ORBITSim_node_bytes(_s, &per_node_sim);
+  uint64_t rx_all = st->rx_ok + st->rx_lost + st->rx_collided + st->rx_half_duplex;
+
+  fprintf(_out, "nodes %u, area %.1f km^2, mean degree %.2f, NodesLimit %u, mean reach %.1f\n", n,
+          _s->side_m * _s->side_m * 1e-6, (double)st->links / n, _s->cfg.nodes_limit, (double)st->reach_total / n);
+  fprintf(_out, "airtime %llu us/frame, HELLO period %.1f s, simulated %.1f s in %.2f s wall (%.2f Mevents/s)\n",
+          (unsigned long long)_s->airtime_us, (double)_s->cfg.hello_period_us * 1e-6, sim_s, wall_s,
+          wall_s > 0 ? (double)st->events / wall_s * 1e-6 : 0.0);
+  double period = (double)_s->cfg.hello_period_us;
+  if (st->coverage99_at_us != UINT64_MAX) {
+    fprintf(_out, "99%% of routes known at %.2f s (%.2f HELLO periods)\n", (double)st->coverage99_at_us * 1e-6,
+            (double)st->coverage99_at_us / period);
+  }
+  if (st->converged_at_us != UINT64_MAX) {
+    fprintf(_out, "converged at %.2f s (%.2f HELLO periods)\n", (double)st->converged_at_us * 1e-6,
+            (double)st->converged_at_us / period);
+  } else {
+    fprintf(_out, "not converged: %u / %u nodes complete, %.2f%% of routes known\n", st->nodes_complete, n,
+            st->reach_total ? 100.0 * (double)st->routes_known / (double)st->reach_total : 100.0);
+  }
+  fprintf(_out, "control: %llu frames, %.2f MB on air (NB %llu, RM %llu, relayed %llu, suppressed %llu), "
+          "%.1f frames/node/period\n",
+          (unsigned long long)st->tx_frames, (double)st->tx_bytes * 1e-6, (unsigned long long)st->tx_hello_nb,
+          (unsigned long long)st->tx_hello_rm, (unsigned long long)st->tx_relay,
+          (unsigned long long)st->relay_suppressed,
+          sim_s > 0 ? (double)st->tx_frames / n / (sim_s * 1e6 / (double)_s->cfg.hello_period_us) : 0.0);
+  fprintf(_out, "airtime: %.3f%% of each node's time transmitting\n",
+          _s->now > 0 ? 100.0 * (double)st->tx_frames * (double)_s->airtime_us / ((double)n * (double)_s->now) : 0.0);
+  if (_s->cfg.hello == ORBITSIM_HELLO_TRICKLE) {
+    fprintf(_out, "trickle: Imin %.1f s, Imax %.1f s, k %u; %llu HELLOs suppressed, %llu resets\n",
+            (double)_s->cfg.trickle_imin_us * 1e-6,
+            (double)(_s->cfg.trickle_imin_us << _s->cfg.trickle_doublings) * 1e-6, _s->cfg.trickle_k,
+            (unsigned long long)st->hello_suppressed, (unsigned long long)st->hello_resets);
+  }
+  fprintf(_out, "receptions: %llu ok, %.1f%% lost, %.1f%% collided, %.1f%% half duplex; %llu next-hop changes\n",
+          (unsigned long long)st->rx_ok, rx_all ? 100.0 * (double)st->rx_lost / (double)rx_all : 0.0,
+          rx_all ? 100.0 * (double)st->rx_collided / (double)rx_all : 0.0,
+          rx_all ? 100.0 * (double)st->rx_half_duplex / (double)rx_all : 0.0, (unsigned long long)st->route_changes);
+  if (_s->cfg.expiry_periods != 0) {
+    fprintf(_out, "expiry after %u periods: %llu neighbors, %llu routes aged out\n", _s->cfg.expiry_periods,
+            (unsigned long long)st->nb_expired, (unsigned long long)st->routes_expired);
+  }
+  fprintf(_out, "memory per node: %.0f B tables (neighbor, route, dup cache, aging), %.0f B simulator state\n",
+          per_node, per_node_sim);
+}
@@ -0,0 +1,274 @@
+/*
+ * File:        src/ORBIT_sim.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Discrete-event mesh simulator for Radio_ORBIT.
+ *    Thousands of virtual nodes, each with its own L2D5NeighborTable_t and
+ *    L2D5RouteTable_t, exchanging real L2D5Frame_t / L2D5Routing_HelloPkt_t
+ *    bytes over a radio link model. Measures OEMR convergence, control
+ *    overhead and per-node memory.
+ *
+ *
+ *  Protocol, every hello_period per node (random phase), or when the
+ *  node's Trickle timer says so (hello = ORBITSIM_HELLO_TRICKLE; reset
+ *  by a new or re-keyed neighbor and by a newly learned destination):
+ *
+ *   HELLO_PKT_NB  TTL 1                          -> neighbors observe it
+ *   HELLO_PKT_RM  TTL NodesLimit, SEQ + 1        -> L2D5Route_hello(), and
+ *                 relayed with TTL - 1, SrcAddress = relay, when the flood
+ *                 rule lets it through:
+ *
+ *  | Flood rule | Relays a copy when                                      |
+ *  ---------------------------------------------------------------------
+ *  | DUPCACHE   | L2D5Dup_check_hello() says NEW / BETTER (default)       |
+ *  | ROUTE      | newer SEQ, or same SEQ over fewer hops, than the route  |
+ *  |            | table holds for the origin                              |
+ *  | ALL        | always (no suppression, the storm baseline)             |
+ *
+ *  Link model (unit disk graph plus per-frame effects):
+ *
+ *  | Effect      | Model                                                   |
+ *  ---------------------------------------------------------------------
+ *  | range       | link iff distance <= range_m                            |
+ *  | loss        | loss_base + loss_edge * (d / range)^4, per frame        |
+ *  | RSSI        | tx_dbm - 40 - 10 * pathloss_exp * log10(d), +-2 dB      |
+ *  | airtime     | preamble + sizeof(L2Frame) * 8 / bitrate                |
+ *  | half duplex | a node transmitting misses what it would receive        |
+ *  | collisions  | overlapping receptions at a node both fail (optional)   |
+ *  | carrier     | a node defers while it hears or sends a frame, + backoff|
+ *
+ *  Event queue: calendar queue (Brown 1988), O(1) average enqueue /
+ *  dequeue. Bucket width is re-estimated on every resize, and also when
+ *  inserts start walking long bucket lists (relay bursts).
+ *
+ *  Convergence: every node knows a route to every node within NodesLimit
+ *  hops of it (ground truth from BFS over the link graph).
+ *
+ *  Expiry (expiry_periods != 0): each node runs an L2D5Aging_t at HELLO
+ *  time, so neighbors and routes of killed nodes age out, and routes that
+ *  relied on a lost neighbor go with it.
+ *
+ * NOTE:
+ *   - Single threaded and deterministic for a given seed.
+ *   - Route tables are sized per node from the ground-truth reach plus
+ *     route_slack (dup caches alike), neighbor tables from the node degree.
+ *
+ */
+
+#ifndef ORBIT_SIM_H
+#define ORBIT_SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "L2D5_struct.h"
+#include "L2D5_neighbor.h"
+#include "L2D5_route.h"
+#include "L2D5_dupcache.h"
+#include "L2D5_aging.h"
+#include "L2D5_trickle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define ORBITSIM_NIL UINT32_MAX
+
+
+typedef enum {
+  ORBITSIM_FLOOD_DUPCACHE = 0,
+  ORBITSIM_FLOOD_ROUTE,
+  ORBITSIM_FLOOD_ALL
+} ORBITSimFlood_t;
+
+
+typedef enum {
+  ORBITSIM_HELLO_FIXED = 0,               // every hello_period_us, +-5 %
+  ORBITSIM_HELLO_TRICKLE                  // L2D5Trickle_t per node
+} ORBITSimHello_t;
+
+typedef struct {
+  uint32_t nodes;
+  double   degree;                        // mean neighbors; sets the area
+  uint64_t seed;
+  /* link model */
+  double   range_m;
+  double   loss_base;
+  double   loss_edge;
+  double   tx_dbm;
+  double   pathloss_exp;
+  uint32_t bitrate_bps;
+  uint32_t preamble_us;
+  bool     collisions;
+  /* protocol */
+  uint16_t nodes_limit;
+  uint64_t hello_period_us;
+  uint64_t relay_jitter_us;               // max random delay before a relay / after carrier busy
+  uint32_t route_slack;
+  ORBITSimFlood_t flood;
+  uint32_t expiry_periods;                // neighbor / route timeout in HELLO periods, 0 = never
+  ORBITSimHello_t hello;
+  uint64_t trickle_imin_us;
+  uint32_t trickle_doublings;
+  uint32_t trickle_k;
+  uint32_t trickle_max_suppress;
+} ORBITSimConfig_t;
+
+
+typedef struct {
+  uint64_t events;
+  uint64_t tx_frames;                     // every transmission
+  uint64_t tx_bytes;                      // on air, whole L2 frames
+  uint64_t tx_hello_nb;
+  uint64_t tx_hello_rm;                   // originated
+  uint64_t hello_suppressed;              // Trickle: HELLO pairs not sent
+  uint64_t hello_resets;                  // Trickle: intervals reset to Imin
+  uint64_t tx_relay;                      // HELLO_PKT_RM relayed
+  uint64_t relay_suppressed;              // copies the flood rule did not relay
+  uint64_t rx_ok;
+  uint64_t rx_lost;                       // link loss
+  uint64_t rx_collided;
+  uint64_t rx_half_duplex;
+  uint64_t route_changes;                 // best next hop changed
+  uint64_t routes_full;                   // L2D5Route_hello() found the table full
+  uint64_t routes_known;                  // sum over nodes of route table entries
+  uint64_t nb_expired;                    // neighbor entries aged out
+  uint64_t routes_expired;                // route entries aged out or orphaned with their next hop
+  uint64_t coverage99_at_us;              // 99 % of reach_total known; UINT64_MAX until then
+  uint64_t converged_at_us;               // UINT64_MAX until converged
+  uint32_t nodes_complete;
+  uint32_t links;                         // directed
+  uint64_t reach_total;                   // sum over nodes of nodes within NodesLimit hops
+  uint64_t wall_ns;                       // host time spent in ORBITSim_run()
+} ORBITSimStats_t;
+
+
+typedef struct {
+  L2D5NeighborTable_t nb;
+  L2D5RouteTable_t    route;
+  L2D5DupCache_t      dup;                // ORBITSIM_FLOOD_DUPCACHE only
+  L2D5Aging_t         aging;              // expiry_periods != 0 only
+  L2D5Trickle_t       trickle;            // ORBITSIM_HELLO_TRICKLE only
+  float    x;
+  float    y;
+  uint32_t reach;                         // ground truth: nodes within NodesLimit hops
+  uint16_t seq;
+  uint32_t hello_gen;                     // Trickle: HELLO events from before a reset are stale
+  bool     complete;
+  bool     tx_armed;                      // a TX_START event is queued
+  bool     dead;                          // ORBITSim_kill()
+  uint32_t q_head;                        // outgoing frames, in the frame slab
+  uint32_t q_tail;
+  uint64_t tx_start;
+  uint64_t tx_end;
+  uint64_t rx_end;                        // end of the latest reception heard
+  uint64_t rx_coll_until;                 // receptions starting before this collided
+} ORBITSimNode_t;
+
+
+typedef struct {
+  uint32_t to;
+  float    loss;
+  int16_t  rssi;
+} ORBITSimLink_t;
+
+
+typedef struct {
+  uint64_t time;
+  uint32_t next;
+  uint32_t node;
+  uint32_t kind;
+  uint32_t arg;
+} ORBITSimEvent_t;
+
+
+typedef struct {
+  ORBITSimEvent_t *ev;                    // event slab
+  uint32_t        ev_cap;
+  uint32_t        ev_free;
+  uint32_t       *bucket;                 // sorted singly linked lists
+  uint32_t        nbuckets;
+  uint32_t        width_shift;            // bucket width = 1 << width_shift us
+  uint32_t        cur;
+  uint64_t        bucket_top;             // end of the current bucket's year slot
+  uint32_t        count;
+  uint64_t        last_time;
+  uint32_t        ops;                    // pushes since the last width check
+  uint32_t        steps;                  // list nodes walked by those pushes
+  uint64_t        resizes;
+} ORBITSimCalQ_t;
+
+
+typedef struct {
+  L2D5Frame_t frame;
+  uint32_t    next;
+} ORBITSimFrame_t;
+
+
+typedef struct {
+  ORBITSimConfig_t  cfg;
+  ORBITSimNode_t   *node;
+  uint8_t         (*addr)[16];
+  uint32_t         *adj_off;              // CSR: links of node i at adj[adj_off[i] .. adj_off[i + 1])
+  ORBITSimLink_t   *adj;
+  double            side_m;
+  uint64_t          airtime_us;
+  uint64_t          now;
+  uint64_t          rng;
+  ORBITSimCalQ_t    q;
+  ORBITSimFrame_t  *slab;
+  uint32_t          slab_cap;
+  uint32_t          slab_free;
+  size_t            table_bytes;          // every node's neighbor + route tables
+  ORBITSimStats_t   stats;
+} ORBITSim_t;
+
+
+typedef struct {
+  uint64_t pairs;                         // (u, v) with v within NodesLimit hops of u
+  uint64_t known;                         // u has a next hop for v
+  uint64_t delivered;                     // following next hops reaches v
+  uint64_t shortest;                      // ... in BFS-distance hops
+  double   stretch;                       // mean hops / BFS distance over delivered
+} ORBITSimVerify_t;
+
+
+/*
+ * Defaults: 1000 nodes, degree 10, 250 kbit/s, NodesLimit 3, HELLO every 30 s.
+ * Trickle: Imin 5 s, Imax 160 s, k 3, never two suppressed intervals in a row
+ * (so expiry_periods with Trickle wants > 320 s worth of periods).
+ */
+void ORBITSim_config_default(ORBITSimConfig_t *_cfg);
+
+/* Places nodes, builds links and per-node tables, schedules first HELLOs. 0 or -1. */
+int  ORBITSim_init(ORBITSim_t *_s, const ORBITSimConfig_t *_cfg);
+void ORBITSim_free(ORBITSim_t *_s);
+
+/* Processes events up to simulated time _until_us; returns events processed */
+uint64_t ORBITSim_run(ORBITSim_t *_s, uint64_t _until_us);
+
+/* Node _node goes silent from now on: sends nothing, hears nothing */
+void ORBITSim_kill(ORBITSim_t *_s, uint32_t _node);
+
+/*
+ * Walks next hops from _sources sampled nodes (0 = every node) to everything
+ * within NodesLimit; ground truth is the initial link graph, so before any kill
+ */
+void ORBITSim_verify(ORBITSim_t *_s, uint32_t _sources, ORBITSimVerify_t *_out);
+
+/* Mean bytes per node: neighbor + route (+ dup cache, aging) tables, and simulator state */
+double ORBITSim_node_bytes(const ORBITSim_t *_s, double *_sim_bytes);
+
+void ORBITSim_report(const ORBITSim_t *_s, FILE *_out);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_SIM_H
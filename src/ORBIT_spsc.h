@@ -0,0 +1,115 @@
+/*
+ * File:        src/ORBIT_spsc.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Single-producer / single-consumer pointer ring for Radio_ORBIT.
+ *    Hand-off between pinned pipeline stages, in bursts.
+ *
+ *
+ *  | Cache line | Written by | Fields                                  |
+ *  ---------------------------------------------------------------------
+ *  |     0      |  producer  | tail, head_cache (last head it saw)     |
+ *  |     1      |  consumer  | head, tail_cache (last tail it saw)     |
+ *  |     2      |  nobody    | slots, mask                             |
+ *
+ *  Each side re-reads the other side's index only when its cached copy
+ *  says the ring is full / empty, so a burst costs one acquire load and
+ *  one release store.
+ *
+ * NOTE:
+ *   - Exactly one producer thread and one consumer thread per ring.
+ *   - Header only.
+ *
+ */
+
+#ifndef ORBIT_SPSC_H
+#define ORBIT_SPSC_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct {
+  _Alignas(64) _Atomic uint64_t tail;
+  uint64_t                      head_cache;
+  _Alignas(64) _Atomic uint64_t head;
+  uint64_t                      tail_cache;
+  _Alignas(64) void           **slots;
+  uint64_t                      mask;
+} ORBITSpsc_t;
+
+
+/* _depth is rounded up to a power of 2. Returns 0, or -1 on allocation failure. */
+static inline int ORBITSpsc_init(ORBITSpsc_t *_r, size_t _depth) {
+  size_t n = 2;
+  while (n < _depth) {
+    n <<= 1;
+  }
+  memset(_r, 0, sizeof(*_r));
+  _r->slots = aligned_alloc(64, (n * sizeof(void *) + 63) & ~(size_t)63);
+  if (_r->slots == NULL) {
+    return -1;
+  }
+  _r->mask = n - 1;
+  atomic_init(&_r->tail, 0);
+  atomic_init(&_r->head, 0);
+  return 0;
+}
+
+static inline void ORBITSpsc_free(ORBITSpsc_t *_r) {
+  free(_r->slots);
+  memset(_r, 0, sizeof(*_r));
+}
+
+/* Producer. Enqueues up to _n items, returns how many fit. */
+static inline size_t ORBITSpsc_push_burst(ORBITSpsc_t *_r, void *const *_items, size_t _n) {
+  uint64_t tail = atomic_load_explicit(&_r->tail, memory_order_relaxed);
+  uint64_t room = _r->mask + 1 - (tail - _r->head_cache);
+  if (room < _n) {
+    _r->head_cache = atomic_load_explicit(&_r->head, memory_order_acquire);
+    room = _r->mask + 1 - (tail - _r->head_cache);
+    if (room < _n) {
+      _n = (size_t)room;
+    }
+  }
+  for (size_t i = 0; i < _n; i++) {
+    _r->slots[(tail + i) & _r->mask] = _items[i];
+  }
+  atomic_store_explicit(&_r->tail, tail + _n, memory_order_release);
+  return _n;
+}
+
+/* Consumer. Dequeues up to _max items, returns how many. */
+static inline size_t ORBITSpsc_pop_burst(ORBITSpsc_t *_r, void **_out, size_t _max) {
+  uint64_t head = atomic_load_explicit(&_r->head, memory_order_relaxed);
+  uint64_t avail = _r->tail_cache - head;
+  if (avail < _max) {
+    _r->tail_cache = atomic_load_explicit(&_r->tail, memory_order_acquire);
+    avail = _r->tail_cache - head;
+    if (avail < _max) {
+      _max = (size_t)avail;
+    }
+  }
+  for (size_t i = 0; i < _max; i++) {
+    _out[i] = _r->slots[(head + i) & _r->mask];
+  }
+  atomic_store_explicit(&_r->head, head + _max, memory_order_release);
+  return _max;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_SPSC_H
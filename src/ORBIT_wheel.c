@@ -0,0 +1,198 @@
+/*
+ * File:        src/ORBIT_wheel.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Hierarchical timing wheel for Radio_ORBIT.
+ *    See ORBIT_wheel.h
+ *
+ */
+
+#include "ORBIT_wheel.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+static inline uint64_t rotr64(uint64_t _x, uint32_t _r) {
+  return _r == 0 ? _x : (_x >> _r) | (_x << (64 - _r));
+}
+
+static inline void wheel_link(ORBITWheel_t *_w, uint32_t _id, uint32_t _level, uint32_t _idx) {
+  ORBITWheelTimer_t *t = &_w->t[_id];
+  uint32_t s = _level * ORBITWHEEL_SLOTS + _idx;
+  t->slot = (uint16_t)s;
+  t->prev = ORBITWHEEL_NIL;
+  t->next = _w->head[s];
+  if (t->next != ORBITWHEEL_NIL) {
+    _w->t[t->next].prev = _id;
+  }
+  _w->head[s] = _id;
+  _w->occupied[_level] |= 1ull << _idx;
+}
+
+static inline void wheel_unlink(ORBITWheel_t *_w, uint32_t _id) {
+  ORBITWheelTimer_t *t = &_w->t[_id];
+  uint32_t s = t->slot;
+  if (t->prev != ORBITWHEEL_NIL) {
+    _w->t[t->prev].next = t->next;
+  } else {
+    _w->head[s] = t->next;
+  }
+  if (t->next != ORBITWHEEL_NIL) {
+    _w->t[t->next].prev = t->prev;
+  }
+  if (_w->head[s] == ORBITWHEEL_NIL) {
+    _w->occupied[s / ORBITWHEEL_SLOTS] &= ~(1ull << (s % ORBITWHEEL_SLOTS));
+  }
+  t->slot = ORBITWHEEL_IDLE;
+}
+
+/* Slot for t->deadline as seen from _w->now; a deadline already due goes to the next tick */
+static void wheel_place(ORBITWheel_t *_w, uint32_t _id) {
+  ORBITWheelTimer_t *t = &_w->t[_id];
+  uint64_t now = _w->now;
+  uint64_t exp = t->deadline > now ? t->deadline : now + 1;
+  uint64_t delta = exp - now;
+  uint32_t level = delta < ORBITWHEEL_SLOTS ? 0 : (63u - (uint32_t)__builtin_clzll(delta)) / ORBITWHEEL_BITS;
+
+  if (level >= ORBITWHEEL_LEVELS) {
+    /* beyond the top wheel: park in its furthest slot, re-placed when that cascades */
+    uint32_t shift = ORBITWHEEL_BITS * (ORBITWHEEL_LEVELS - 1);
+    t->expires = ((now >> shift) + ORBITWHEEL_SLOTS - 1) << shift;
+    wheel_link(_w, _id, ORBITWHEEL_LEVELS - 1, (uint32_t)((t->expires >> shift) & (ORBITWHEEL_SLOTS - 1)));
+    return;
+  }
+  t->expires = exp;
+  wheel_link(_w, _id, level, (uint32_t)((exp >> (ORBITWHEEL_BITS * level)) & (ORBITWHEEL_SLOTS - 1)));
+}
+
+/* Earliest tick after now at which some occupied slot fires or cascades */
+static uint64_t wheel_next(const ORBITWheel_t *_w) {
+  uint64_t best = UINT64_MAX;
+  for (uint32_t k = 0; k < ORBITWHEEL_LEVELS; k++) {
+    uint64_t occ = _w->occupied[k];
+    if (occ == 0) {
+      continue;
+    }
+    uint32_t shift = ORBITWHEEL_BITS * k;
+    uint64_t base = _w->now >> shift;
+    uint32_t cur = (uint32_t)(base & (ORBITWHEEL_SLOTS - 1));
+    uint64_t d = (uint64_t)__builtin_ctzll(rotr64(occ, (cur + 1) & (ORBITWHEEL_SLOTS - 1))) + 1;
+    uint64_t t = (base + d) << shift;
+    if (t < best) {
+      best = t;
+    }
+  }
+  return best;
+}
+
+static void wheel_cascade(ORBITWheel_t *_w, uint32_t _level, uint32_t _idx) {
+  uint32_t s = _level * ORBITWHEEL_SLOTS + _idx;
+  uint32_t id = _w->head[s];
+  _w->head[s] = ORBITWHEEL_NIL;
+  _w->occupied[_level] &= ~(1ull << _idx);
+  while (id != ORBITWHEEL_NIL) {
+    uint32_t next = _w->t[id].next;
+    if (_w->t[id].deadline <= _w->now) {
+      /* due this very tick: the level 0 slot being processed next */
+      wheel_link(_w, id, 0, (uint32_t)(_w->now & (ORBITWHEEL_SLOTS - 1)));
+      _w->t[id].expires = _w->now;
+    } else {
+      wheel_place(_w, id);
+    }
+    _w->cascaded++;
+    id = next;
+  }
+}
+
+
+int ORBITWheel_init(ORBITWheel_t *_w, uint32_t _capacity, uint64_t _tick, uint64_t _now) {
+  memset(_w, 0, sizeof(*_w));
+  if (_tick == 0 || _capacity == 0) {
+    return -1;
+  }
+  _w->t = malloc((size_t)_capacity * sizeof(ORBITWheelTimer_t));
+  if (_w->t == NULL) {
+    return -1;
+  }
+  for (uint32_t i = 0; i < _capacity; i++) {
+    _w->t[i].slot = ORBITWHEEL_IDLE;
+    _w->t[i].prev = _w->t[i].next = ORBITWHEEL_NIL;
+    _w->t[i].expires = _w->t[i].deadline = 0;
+  }
+  for (uint32_t s = 0; s < ORBITWHEEL_LEVELS * ORBITWHEEL_SLOTS; s++) {
+    _w->head[s] = ORBITWHEEL_NIL;
+  }
+  _w->capacity = _capacity;
+  _w->tick = _tick;
+  _w->now = _now / _tick;
+  return 0;
+}
+
+void ORBITWheel_free(ORBITWheel_t *_w) {
+  free(_w->t);
+  memset(_w, 0, sizeof(*_w));
+}
+
+void ORBITWheel_schedule(ORBITWheel_t *_w, uint32_t _id, uint64_t _when) {
+  ORBITWheelTimer_t *t = &_w->t[_id];
+  if (t->slot != ORBITWHEEL_IDLE) {
+    wheel_unlink(_w, _id);
+  } else {
+    _w->armed++;
+  }
+  t->deadline = (_when + _w->tick - 1) / _w->tick;
+  wheel_place(_w, _id);
+}
+
+void ORBITWheel_cancel(ORBITWheel_t *_w, uint32_t _id) {
+  if (_w->t[_id].slot != ORBITWHEEL_IDLE) {
+    wheel_unlink(_w, _id);
+    _w->armed--;
+  }
+}
+
+uint32_t ORBITWheel_advance(ORBITWheel_t *_w, uint64_t _now, ORBITWheelFn_t _fn, void *_ctx) {
+  uint64_t target = _now / _w->tick;
+  uint32_t fired = 0;
+
+  while (_w->now < target) {
+    uint64_t next = wheel_next(_w);
+    if (next > target) {
+      _w->now = target;
+      break;
+    }
+    _w->now = next;
+
+    for (uint32_t k = 1; k < ORBITWHEEL_LEVELS; k++) {
+      uint32_t shift = ORBITWHEEL_BITS * k;
+      if ((next & ((1ull << shift) - 1)) != 0) {
+        break;
+      }
+      uint32_t idx = (uint32_t)((next >> shift) & (ORBITWHEEL_SLOTS - 1));
+      if (_w->occupied[k] & (1ull << idx)) {
+        wheel_cascade(_w, k, idx);
+      }
+    }
+
+    uint32_t s = (uint32_t)(next & (ORBITWHEEL_SLOTS - 1));
+    while (_w->head[s] != ORBITWHEEL_NIL) {
+      uint32_t id = _w->head[s];
+      wheel_unlink(_w, id);
+      if (_w->t[id].deadline > next) {
+        wheel_place(_w, id);
+        _w->deferred++;
+        continue;
+      }
+      _w->armed--;
+      _w->fired++;
+      fired++;
+      if (_fn != NULL) {
+        _fn(_ctx, id, next * _w->tick);
+      }
+    }
+  }
+  return fired;
+}
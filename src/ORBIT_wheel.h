@@ -0,0 +1,121 @@
+/*
+ * File:        src/ORBIT_wheel.h
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    Hierarchical timing wheel for Radio_ORBIT.
+ *    Fixed array of timers addressed by id (a table slot), O(1) schedule /
+ *    cancel, and expiry cost proportional to the timers that fire, not to
+ *    how many are armed.
+ *
+ *
+ *  ORBITWHEEL_LEVELS wheels of 64 slots, level k slot = 64^k ticks:
+ *
+ *  | Level | Holds timers due in      | Slot index            |
+ *  ----------------------------------------------------------
+ *  |   0   | 1 .. 63 ticks            | expires & 63          |
+ *  |   1   | 64 .. 4095 ticks         | (expires >> 6) & 63   |
+ *  |   k   | 64^k .. 64^(k+1) - 1     | (expires >> 6k) & 63  |
+ *
+ *  When level k - 1 wraps, level k's current slot is cascaded down. A
+ *  64-bit occupancy mask per level lets ORBITWheel_advance() jump straight
+ *  to the next tick where a slot fires or cascades, so idle time is free.
+ *
+ *  Lazy extension: ORBITWheel_extend() to a later deadline only stores the
+ *  deadline; the timer is re-placed when its old slot comes due. A timer
+ *  refreshed on every packet therefore costs one store per refresh and at
+ *  most one list move per timeout period.
+ *
+ * NOTE:
+ *   - Times are in caller units (e.g. us); one tick = _tick units.
+ *   - The expiry callback may schedule, extend or cancel any timer.
+ *   - Not thread safe.
+ *
+ */
+
+#ifndef ORBIT_WHEEL_H
+#define ORBIT_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define ORBITWHEEL_BITS   6
+#define ORBITWHEEL_SLOTS  (1u << ORBITWHEEL_BITS)
+#define ORBITWHEEL_LEVELS 6                 // 2^36 ticks
+#define ORBITWHEEL_NIL    UINT32_MAX
+#define ORBITWHEEL_IDLE   UINT16_MAX
+
+
+typedef struct {
+  uint64_t expires;                       // tick of the slot it sits in
+  uint64_t deadline;                      // tick it really fires (>= expires)
+  uint32_t prev;
+  uint32_t next;
+  uint16_t slot;                          // level * 64 + index, ORBITWHEEL_IDLE when not armed
+} ORBITWheelTimer_t;
+
+
+typedef struct {
+  ORBITWheelTimer_t *t;
+  uint32_t           capacity;
+  uint32_t           armed;
+  uint64_t           tick;
+  uint64_t           now;                 // current tick
+  uint64_t           occupied[ORBITWHEEL_LEVELS];
+  uint32_t           head[ORBITWHEEL_LEVELS * ORBITWHEEL_SLOTS];
+
+  uint64_t           fired;
+  uint64_t           deferred;            // re-placed after a lazy extension
+  uint64_t           cascaded;
+} ORBITWheel_t;
+
+
+/* Expiry callback: timer _id is already disarmed */
+typedef void (*ORBITWheelFn_t)(void *_ctx, uint32_t _id, uint64_t _now);
+
+
+/* Timers 0 .. _capacity - 1, _tick time units per tick, wheel starting at time _now */
+int  ORBITWheel_init(ORBITWheel_t *_w, uint32_t _capacity, uint64_t _tick, uint64_t _now);
+void ORBITWheel_free(ORBITWheel_t *_w);
+
+/* (Re)arm _id to fire at time _when (rounded up to a tick); moves it if armed */
+void ORBITWheel_schedule(ORBITWheel_t *_w, uint32_t _id, uint64_t _when);
+void ORBITWheel_cancel(ORBITWheel_t *_w, uint32_t _id);
+
+static inline bool ORBITWheel_armed(const ORBITWheel_t *_w, uint32_t _id) {
+  return _w->t[_id].slot != ORBITWHEEL_IDLE;
+}
+
+/* Refresh: push the deadline of an armed timer later with a single store, else schedule */
+static inline void ORBITWheel_extend(ORBITWheel_t *_w, uint32_t _id, uint64_t _when) {
+  ORBITWheelTimer_t *t = &_w->t[_id];
+  uint64_t tk = (_when + _w->tick - 1) / _w->tick;
+  if (t->slot != ORBITWHEEL_IDLE && tk >= t->expires) {
+    t->deadline = tk;
+  } else {
+    ORBITWheel_schedule(_w, _id, _when);
+  }
+}
+
+/* Runs the clock to time _now, calling _fn for every timer due. Returns how many fired. */
+uint32_t ORBITWheel_advance(ORBITWheel_t *_w, uint64_t _now, ORBITWheelFn_t _fn, void *_ctx);
+
+/* Bytes held by the wheel */
+static inline size_t ORBITWheel_bytes(const ORBITWheel_t *_w) {
+  return sizeof(*_w) + (size_t)_w->capacity * sizeof(ORBITWheelTimer_t);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORBIT_WHEEL_H
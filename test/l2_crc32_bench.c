@@ -0,0 +1,95 @@
+/*
+ * File:        test/l2_crc32_bench.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2 FCS (CRC32) Benchmark. zlib crc32() vs every L2CRC32 kernel,
+ *    single frame and batch (contiguous 224-byte frames).
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2_crc32.h"
+#include <sys/random.h>
+#include <time.h>
+#include <zlib.h>
+
+#define BENCH_FRAMES 4096
+#define BENCH_ROUNDS 200
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, double sec, uint32_t sink) {
+  double frames = (double)BENCH_FRAMES * BENCH_ROUNDS;
+  printf("  %-18s %8.2f Mframes/s %8.1f MB/s  %6.1f ns/frame  (%08X)\n",
+         name, frames / sec / 1e6, frames * 216 / sec / 1e6, sec / frames * 1e9, sink);
+}
+
+
+int main() {
+  uint8_t *frames = malloc(BENCH_FRAMES * L2CRC32_FRAME_BYTES);
+  uint8_t *ok = malloc(BENCH_FRAMES);
+  if (frames == NULL || ok == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  if (getrandom(frames, BENCH_FRAMES * L2CRC32_FRAME_BYTES, 0) != (ssize_t)(BENCH_FRAMES * L2CRC32_FRAME_BYTES)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < BENCH_FRAMES; i++) {
+    L2CRC32_seal((L2Frame *)(frames + i * L2CRC32_FRAME_BYTES));
+  }
+
+  printf("L2 FCS over %d x 216-byte payloads, %d rounds:\n", BENCH_FRAMES, BENCH_ROUNDS);
+
+  uint32_t sink = 0;
+  double t0 = now_sec();
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    for (size_t i = 0; i < BENCH_FRAMES; i++) {
+      sink += (uint32_t)crc32(0, frames + i * L2CRC32_FRAME_BYTES + 3, 216);
+    }
+  }
+  report("zlib crc32", now_sec() - t0, sink);
+
+  const L2CRC32_impl_t impls[] = { L2CRC32_IMPL_SLICE8, L2CRC32_IMPL_PCLMUL, L2CRC32_IMPL_ARMV8 };
+  for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+    if (L2CRC32_select(impls[k]) != 0) {
+      continue;
+    }
+    char name[32];
+
+    sink = 0;
+    t0 = now_sec();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (size_t i = 0; i < BENCH_FRAMES; i++) {
+        sink += L2CRC32_frame((const L2Frame *)(frames + i * L2CRC32_FRAME_BYTES));
+      }
+    }
+    snprintf(name, sizeof(name), "%s", L2CRC32_impl_name(impls[k]));
+    report(name, now_sec() - t0, sink);
+
+    sink = 0;
+    t0 = now_sec();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      sink += (uint32_t)L2CRC32_check_batch(frames, BENCH_FRAMES, ok);
+    }
+    snprintf(name, sizeof(name), "%s batch", L2CRC32_impl_name(impls[k]));
+    report(name, now_sec() - t0, sink);
+  }
+
+  free(frames);
+  free(ok);
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * File:        test/l2_crc32_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2 FCS (CRC32) Engine Test Program. Every kernel against zlib crc32(),
+ *    single and batched.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/L2_crc32.h"
+#include <sys/random.h>
+#include <zlib.h>
+
+
+static int check_kernel(L2CRC32_impl_t impl, const uint8_t *buf, size_t buf_len) {
+  if (L2CRC32_select(impl) != 0) {
+    printf("  %-10s skipped (not supported on this CPU)\n", L2CRC32_impl_name(impl));
+    return 0;
+  }
+
+  for (size_t off = 0; off < 16; off++) {
+    for (size_t len = 0; len + off <= buf_len; len += 1 + (len >> 4)) {
+      uint32_t want = (uint32_t)crc32(0x1234u, buf + off, len);
+      uint32_t got  = L2CRC32_update(0x1234u, buf + off, len);
+      if (want != got) {
+        printf("  %-10s FAIL off=%zu len=%zu want=%08X got=%08X\n", L2CRC32_impl_name(impl), off, len, want, got);
+        return 1;
+      }
+    }
+  }
+
+  /* batch: every count, so both the interleaved groups of 4 and the tail run */
+  enum { NB = 4096 / sizeof(L2Frame), BAD = 5 };
+  L2Frame frames[NB];
+  uint8_t ok[NB];
+  memcpy(frames, buf, sizeof(frames));
+  for (size_t i = 0; i < NB; i++) {
+    uint32_t z = (uint32_t)crc32(0, frames[i].Payload, sizeof(frames[i].Payload));
+    frames[i].ChkSum[0] = (uint8_t)(z >> 24);
+    frames[i].ChkSum[1] = (uint8_t)(z >> 16);
+    frames[i].ChkSum[2] = (uint8_t)(z >> 8);
+    frames[i].ChkSum[3] = (uint8_t)z;
+  }
+  frames[BAD].Payload[100] ^= 0x04;
+  for (size_t n = 0; n <= NB; n++) {
+    size_t good = L2CRC32_check_batch((const uint8_t *)frames, n, ok);
+    int bad = good != n - (n > BAD);
+    for (size_t i = 0; i < n; i++) {
+      bad |= ok[i] != (i != BAD);
+    }
+    if (bad) {
+      printf("  %-10s FAIL batch of %zu frames (good=%zu)\n", L2CRC32_impl_name(impl), n, good);
+      return 1;
+    }
+  }
+  printf("  %-10s OK\n", L2CRC32_impl_name(impl));
+  return 0;
+}
+
+
+int main() {
+  int fail = 0;
+  uint8_t buf[4096];
+  if (getrandom(buf, sizeof(buf), 0) != (ssize_t)sizeof(buf)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+
+  printf("Kernels vs zlib:\n");
+  fail |= check_kernel(L2CRC32_IMPL_SLICE8, buf, sizeof(buf));
+  fail |= check_kernel(L2CRC32_IMPL_PCLMUL, buf, sizeof(buf));
+  fail |= check_kernel(L2CRC32_IMPL_ARMV8, buf, sizeof(buf));
+  L2CRC32_select(L2CRC32_IMPL_AUTO);
+  printf("Active: %s\n", L2CRC32_impl_name(L2CRC32_active()));
+
+  /* batch: 64 sealed frames, corrupt a few */
+  enum { NFRAMES = 64 };
+  L2Frame frames[NFRAMES];
+  if (getrandom(frames, sizeof(frames), 0) != (ssize_t)sizeof(frames)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < NFRAMES; i++) {
+    frames[i].SFD = MAGIC_L2LAYER_SFD;
+    frames[i].EFD = MAGIC_L2LAYER_EFD;
+    L2CRC32_seal(&frames[i]);
+    uint32_t z = (uint32_t)crc32(0, frames[i].Payload, sizeof(frames[i].Payload));
+    if (L2CRC32_load(&frames[i]) != z) {
+      printf("seal mismatch with zlib at frame %d\n", i);
+      fail = 1;
+    }
+  }
+  frames[3].Payload[17] ^= 0x01;
+  frames[40].ChkSum[3] ^= 0x80;
+  frames[63].Payload[215] ^= 0x10;
+
+  uint8_t ok[NFRAMES];
+  size_t good = L2CRC32_check_batch((const uint8_t *)frames, NFRAMES, ok);
+  if (good != NFRAMES - 3 || ok[3] || ok[40] || ok[63] || !ok[0] || !ok[62]) {
+    printf("batch check FAIL (good=%zu)\n", good);
+    fail = 1;
+  } else {
+    printf("Batch check OK (%zu/%d frames valid, 3 corrupted detected)\n", good, NFRAMES);
+  }
+
+  printf("\nORBIT L2 FCS (CRC32) Engine Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
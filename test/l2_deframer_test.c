@@ -0,0 +1,129 @@
+/*
+ * File:        test/l2_deframer_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2 Deframer Test Program. Valid frames mixed with noise, false
+ *    SFDs and corrupted frames, pushed in random chunk sizes.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2_crc32.h"
+#include "../src/L2_deframer.h"
+#include <sys/random.h>
+
+#define TEST_FRAMES 2000
+
+
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+
+int main() {
+  static L2Frame sent[TEST_FRAMES];
+  size_t stream_cap = TEST_FRAMES * (sizeof(L2Frame) * 2 + 64);
+  uint8_t *stream = malloc(stream_cap);
+  size_t stream_len = 0;
+  if (stream == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state) || rng_state == 0) {
+    rng_state = 0x2545F491u;
+  }
+
+  /* build a noisy stream */
+  size_t corrupted = 0;
+  for (int i = 0; i < TEST_FRAMES; i++) {
+    size_t noise = rng() % 48;
+    for (size_t k = 0; k < noise; k++) {
+      /* plenty of false SFDs in the noise */
+      stream[stream_len++] = (rng() & 3) ? (uint8_t)rng() : MAGIC_L2LAYER_SFD;
+    }
+    if (rng() % 10 == 0) {
+      /* frame with a flipped payload bit: must be rejected */
+      L2Frame bad;
+      for (size_t k = 0; k < sizeof(bad); k++) {
+        ((uint8_t *)&bad)[k] = (uint8_t)rng();
+      }
+      bad.SFD = MAGIC_L2LAYER_SFD;
+      bad.EFD = MAGIC_L2LAYER_EFD;
+      L2CRC32_seal(&bad);
+      bad.Payload[rng() % sizeof(bad.Payload)] ^= 0x04;
+      memcpy(stream + stream_len, &bad, sizeof(bad));
+      stream_len += sizeof(bad);
+      corrupted++;
+    }
+    for (size_t k = 0; k < sizeof(sent[i]); k++) {
+      ((uint8_t *)&sent[i])[k] = (uint8_t)rng();
+    }
+    sent[i].SFD = MAGIC_L2LAYER_SFD;
+    sent[i].EFD = MAGIC_L2LAYER_EFD;
+    L2CRC32_seal(&sent[i]);
+    memcpy(stream + stream_len, &sent[i], sizeof(sent[i]));
+    stream_len += sizeof(sent[i]);
+  }
+
+  L2Deframer_t d;
+  if (L2Deframer_init(&d, 1024, true) != 0) {
+    perror("L2Deframer_init failed");
+    return EXIT_FAILURE;
+  }
+
+  int fail = 0;
+  size_t got = 0, off = 0;
+  const L2Frame *views[8];
+  while (off < stream_len || d.head != d.scan) {
+    size_t chunk = 1 + rng() % 300;
+    if (chunk > stream_len - off) {
+      chunk = stream_len - off;
+    }
+    off += L2Deframer_push(&d, stream + off, chunk);
+
+    size_t n = L2Deframer_poll(&d, views, 1 + rng() % 8);
+    for (size_t k = 0; k < n; k++) {
+      if (got >= TEST_FRAMES || memcmp(views[k], &sent[got], sizeof(L2Frame)) != 0) {
+        printf("frame %zu mismatch\n", got);
+        fail = 1;
+      }
+      got++;
+    }
+    L2Deframer_release(&d);
+    if (off == stream_len && n == 0 && d.head - d.scan < sizeof(L2Frame)) {
+      break;
+    }
+  }
+
+  if (got != TEST_FRAMES) {
+    printf("recovered %zu of %d frames\n", got, TEST_FRAMES);
+    fail = 1;
+  }
+  printf("Frames:       %llu (sent %d, %zu corrupted injected)\n", (unsigned long long)d.stats.frames, TEST_FRAMES, corrupted);
+  printf("Bad EFD:      %llu\n", (unsigned long long)d.stats.bad_efd);
+  printf("Bad FCS:      %llu\n", (unsigned long long)d.stats.bad_fcs);
+  printf("Resync bytes: %llu\n", (unsigned long long)d.stats.resync_bytes);
+  if (d.stats.bad_fcs < corrupted) {
+    printf("corrupted frames were not all rejected by FCS\n");
+    fail = 1;
+  }
+
+  L2Deframer_free(&d);
+  free(stream);
+  printf("\nORBIT L2 Deframer Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
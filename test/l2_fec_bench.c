@@ -0,0 +1,136 @@
+/*
+ * File:        test/l2_fec_bench.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2 FEC (Reed-Solomon) Benchmark. GF(256) region multiply-add
+ *    per kernel, then group encode and decode (M data frames erased) for
+ *    8+2 and 8+4.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/L2_fec.h"
+#include <sys/random.h>
+#include <time.h>
+
+#define BENCH_GROUPS 2000
+#define BENCH_ROUNDS 20
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t delivered;
+
+static void on_deliver(void *_ctx, const L2Frame *_frame) {
+  (void)_ctx;
+  delivered += _frame->Payload[0];
+}
+
+
+static void bench_codec(const char *name, uint8_t k, uint8_t m) {
+  L2Frame *data = malloc(sizeof(L2Frame) * BENCH_GROUPS * k);
+  L2Frame *parity = malloc(sizeof(L2Frame) * BENCH_GROUPS * m);
+  L2FecEnc_t *e = malloc(sizeof(*e));
+  L2FecDec_t *d = malloc(sizeof(*d));
+  if (data == NULL || parity == NULL || e == NULL || d == NULL) {
+    perror("malloc failed");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < (size_t)BENCH_GROUPS * k; i++) {
+    if (getrandom(data[i].Payload, sizeof(data[i].Payload), 0) != (ssize_t)sizeof(data[i].Payload)) {
+      perror("getrandom failed");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  double bytes = (double)BENCH_GROUPS * BENCH_ROUNDS * k * L2FEC_BYTES;
+
+  L2FecEnc_init(e, k, m);
+  double t0 = now_sec();
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    for (size_t g = 0; g < BENCH_GROUPS; g++) {
+      for (size_t i = 0; i < k; i++) {
+        if (L2FecEnc_push(e, &data[g * k + i]) != 0) {
+          for (uint32_t j = 0; j < m; j++) {
+            L2FecEnc_parity(e, j, &parity[g * m + j]);
+          }
+        }
+      }
+    }
+  }
+  double enc = now_sec() - t0;
+
+  /* first m data frames of every group lost: worst case rebuild */
+  L2FecDec_init(d, on_deliver, NULL);
+  delivered = 0;
+  t0 = now_sec();
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    for (size_t g = 0; g < BENCH_GROUPS; g++) {
+      for (size_t i = m < k ? m : k; i < k; i++) {
+        L2FecDec_push(d, &data[g * k + i]);
+      }
+      for (uint32_t j = 0; j < m; j++) {
+        L2FecDec_push(d, &parity[g * m + j]);
+      }
+    }
+  }
+  double dec = now_sec() - t0;
+
+  printf("  %-8s %2u+%u  encode %8.1f MB/s  decode %8.1f MB/s  (%llu rebuilt, %llu)\n", name, k, m,
+         bytes / enc / 1e6, bytes / dec / 1e6, (unsigned long long)d->recovered, (unsigned long long)delivered);
+
+  free(data);
+  free(parity);
+  free(e);
+  free(d);
+}
+
+
+int main() {
+  static uint8_t src[L2FEC_BYTES * 64], dst[L2FEC_BYTES * 64];
+  if (getrandom(src, sizeof(src), 0) != (ssize_t)sizeof(src)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  memset(dst, 0, sizeof(dst));
+
+  printf("L2 FEC over 216-byte payloads, %d groups, %d rounds:\n", BENCH_GROUPS, BENCH_ROUNDS);
+
+  const L2FEC_impl_t impls[] = { L2FEC_IMPL_SCALAR, L2FEC_IMPL_SSSE3, L2FEC_IMPL_AVX2, L2FEC_IMPL_NEON };
+  for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); n++) {
+    if (L2FEC_select(impls[n]) != 0) {
+      continue;
+    }
+    const char *name = L2FEC_impl_name(impls[n]);
+
+    const int reps = 20000;
+    double t0 = now_sec();
+    for (int r = 0; r < reps; r++) {
+      for (size_t i = 0; i < 64; i++) {
+        L2FEC_mul_add(dst + i * L2FEC_BYTES, src + i * L2FEC_BYTES, (uint8_t)(r * 7 + i), L2FEC_BYTES);
+      }
+    }
+    double sec = now_sec() - t0;
+    uint32_t sink = 0;
+    for (size_t i = 0; i < sizeof(dst); i++) {
+      sink += dst[i];
+    }
+    printf("  %-8s mul_add %8.2f GB/s  (%08X)\n", name, (double)reps * sizeof(src) / sec / 1e9, sink);
+
+    bench_codec(name, 8, 2);
+    bench_codec(name, 8, 4);
+  }
+  return 0;
+}
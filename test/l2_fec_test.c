@@ -0,0 +1,284 @@
+/*
+ * File:        test/l2_fec_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2 FEC (Reed-Solomon) Test Program. GF(256) arithmetic, every
+ *    kernel against the scalar one, group rebuild for every erasure count
+ *    up to M, short (flushed) groups, and airtime per frame delivered
+ *    over several hops with frame errors, with and without FEC.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/L2_fec.h"
+#include "../src/L2_crc32.h"
+#include <sys/random.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+
+
+static uint64_t rng_state;
+
+static inline uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static void fill(void *_p, size_t _n) {
+  uint8_t *p = _p;
+  for (size_t i = 0; i < _n; i++) {
+    p[i] = (uint8_t)rng();
+  }
+}
+
+
+typedef struct {
+  L2Frame  sent[L2FEC_MAX_FRAMES];
+  uint16_t got;                           // data Idx delivered
+  uint32_t delivered;
+  uint32_t errors;
+} Sink_t;
+
+static void on_rebuilt(void *_ctx, const L2Frame *_f) {
+  Sink_t *s = _ctx;
+  uint8_t idx = L2FEC_idx(_f);
+  if (!L2CRC32_check(_f) || _f->SFD != MAGIC_L2LAYER_SFD || _f->EFD != MAGIC_L2LAYER_EFD ||
+      memcmp(_f, &s->sent[idx], sizeof(*_f)) != 0 || (s->got & (1u << idx))) {
+    s->errors++;
+  }
+  s->got |= (uint16_t)(1u << idx);
+  s->delivered++;
+}
+
+/* one group of _n data frames (flushed if _n < _k), frames in _lost never arrive; returns data frames delivered */
+static uint32_t run_group(L2FecEnc_t *_e, L2FecDec_t *_d, Sink_t *_s, uint32_t _n, uint16_t _lost) {
+  L2Frame air[L2FEC_MAX_FRAMES];
+  uint32_t total = 0, due = 0;
+  _s->got = 0;
+  _s->delivered = 0;
+  _s->errors = 0;
+  for (uint32_t i = 0; i < _n; i++) {
+    fill(air[i].Payload, sizeof(air[i].Payload));
+    due = L2FecEnc_push(_e, &air[i]);
+    _s->sent[i] = air[i];
+  }
+  if (due == 0) {
+    due = L2FecEnc_flush(_e);
+  }
+  total = _n;
+  for (uint32_t j = 0; j < due; j++) {
+    L2FecEnc_parity(_e, j, &air[total++]);
+  }
+  for (uint32_t i = 0; i < total; i++) {
+    if (_lost & (1u << i)) {
+      continue;
+    }
+    if (!L2CRC32_check(&air[i])) {
+      _s->errors++;
+    }
+    L2FecResult_t r = L2FecDec_push(_d, &air[i]);
+    if (r == L2FEC_DATA) {
+      on_rebuilt(_s, &air[i]);
+    } else if (r != L2FEC_PARITY) {
+      _s->errors++;
+    }
+  }
+  return _s->delivered;
+}
+
+static uint16_t random_loss(uint32_t _total, uint32_t _count) {
+  uint16_t m = 0;
+  while ((uint32_t)__builtin_popcount(m) < _count) {
+    m |= (uint16_t)(1u << (rng() % _total));
+  }
+  return m;
+}
+
+
+static int check_kernel(L2FEC_impl_t _impl) {
+  if (L2FEC_select(_impl) != 0) {
+    printf("  %-8s skipped (not supported on this CPU)\n", L2FEC_impl_name(_impl));
+    return 0;
+  }
+  uint8_t src[300], a[300], b[300];
+  for (uint32_t round = 0; round < 2000; round++) {
+    size_t len = rng() % sizeof(src), off = rng() % 8;
+    uint8_t c = round < 256 ? (uint8_t)round : (uint8_t)rng();
+    fill(src, sizeof(src));
+    fill(a, sizeof(a));
+    memcpy(b, a, sizeof(b));
+    L2FEC_mul_add(a + off, src, c, len - (len > off ? off : len));
+    for (size_t i = 0; i < len - (len > off ? off : len); i++) {
+      b[off + i] ^= L2FEC_gf_mul(c, src[i]);
+    }
+    if (memcmp(a, b, sizeof(a)) != 0) {
+      printf("  %-8s FAIL c=%u len=%zu off=%zu\n", L2FEC_impl_name(_impl), c, len, off);
+      return 1;
+    }
+  }
+  printf("  %-8s OK\n", L2FEC_impl_name(_impl));
+  return 0;
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  /* GF(2^8) / 0x11D */
+  int gf_ok = 1;
+  for (uint32_t a = 1; a < 256; a++) {
+    gf_ok &= L2FEC_gf_mul((uint8_t)a, L2FEC_gf_inv((uint8_t)a)) == 1;
+    gf_ok &= L2FEC_gf_mul((uint8_t)a, 0) == 0 && L2FEC_gf_mul((uint8_t)a, 1) == a;
+    uint8_t b = (uint8_t)rng(), c = (uint8_t)rng();
+    gf_ok &= L2FEC_gf_mul((uint8_t)a, b ^ c) == (L2FEC_gf_mul((uint8_t)a, b) ^ L2FEC_gf_mul((uint8_t)a, c));
+    gf_ok &= L2FEC_gf_mul((uint8_t)a, L2FEC_gf_mul(b, c)) == L2FEC_gf_mul(L2FEC_gf_mul((uint8_t)a, b), c);
+  }
+  CHECK(gf_ok, "field axioms");
+  CHECK(L2FEC_gf_mul(2, 0x80) == 0x1D, "reduction by 0x11D");
+
+  printf("Kernels vs table:\n");
+  fail |= check_kernel(L2FEC_IMPL_SCALAR);
+  fail |= check_kernel(L2FEC_IMPL_SSSE3);
+  fail |= check_kernel(L2FEC_IMPL_AVX2);
+  fail |= check_kernel(L2FEC_IMPL_NEON);
+  L2FEC_select(L2FEC_IMPL_AUTO);
+  printf("Active: %s\n", L2FEC_impl_name(L2FEC_active()));
+
+  L2FecEnc_t *e = malloc(sizeof(L2FecEnc_t));
+  L2FecDec_t *d = malloc(sizeof(L2FecDec_t));
+  Sink_t *s = malloc(sizeof(Sink_t));
+  if (e == NULL || d == NULL || s == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  CHECK(L2FecEnc_init(e, 0, 1) == -1 && L2FecEnc_init(e, 4, 0) == -1 && L2FecEnc_init(e, 12, 5) == -1,
+        "bad k / m rejected");
+
+  /* any erasures up to m, across data and parity, for every layout */
+  const uint8_t km[][2] = { { 1, 1 }, { 2, 1 }, { 4, 2 }, { 8, 2 }, { 8, 4 }, { 12, 4 }, { 15, 1 }, { 8, 8 } };
+  uint64_t groups = 0, rebuilt = 0;
+  for (uint32_t t = 0; t < sizeof(km) / sizeof(km[0]); t++) {
+    uint8_t k = km[t][0], m = km[t][1];
+    L2FecEnc_init(e, k, m);
+    L2FecDec_init(d, on_rebuilt, s);
+    for (uint32_t round = 0; round < 300; round++) {
+      uint32_t lose = (uint32_t)(rng() % (m + 1));
+      uint16_t lost = random_loss(k + m, lose);
+      uint32_t got = run_group(e, d, s, k, lost);
+      groups++;
+      if (got != k || s->got != (uint16_t)((1u << k) - 1) || s->errors != 0) {
+        printf("FAIL: k=%u m=%u lost=%04X delivered %u errors %u\n", k, m, lost, got, s->errors);
+        fail = 1;
+        break;
+      }
+    }
+    rebuilt += d->recovered;
+  }
+  printf("%llu groups with up to m erasures rebuilt, %llu frames from parity\n", (unsigned long long)groups,
+         (unsigned long long)rebuilt);
+
+  /* more than m lost: what arrived still passes, the rest is counted */
+  L2FecEnc_init(e, 8, 2);
+  L2FecDec_init(d, on_rebuilt, s);
+  uint32_t got = run_group(e, d, s, 8, 0x0007);
+  CHECK(got == 5 && s->errors == 0 && d->recovered == 0, "3 of 8 lost with m = 2: 5 delivered");
+  run_group(e, d, s, 8, 0);
+  CHECK(d->unrecoverable == 1, "previous group closed unrecoverable");
+
+  /* flushed group: parity carries K = 3, the rebuilt frame the K = 8 it was sent with */
+  got = run_group(e, d, s, 3, 0x0003);
+  CHECK(got == 3 && s->errors == 0 && e->short_groups == 1, "short group rebuilt");
+  got = run_group(e, d, s, 8, 0x0101);
+  CHECK(got == 8 && s->errors == 0, "full group after a short one");
+
+  /* plain frames, malformed TAGs */
+  L2Frame f;
+  fill(&f, sizeof(f));
+  f.TAG[0] = 0x00;
+  CHECK(L2FecDec_push(d, &f) == L2FEC_PLAIN, "plain frame passes");
+  f.TAG[0] = MAGIC_L2LAYER_TAG_FEC | 0x7;
+  f.TAG[1] = (3 << 4) | 1;                // K = 4, data 1
+  CHECK(L2FecDec_push(d, &f) == L2FEC_DATA, "data of a new group");
+  f.TAG[1] = (1 << 4) | 2;                // parity of a group flushed at K = 2: data 1 fits
+  CHECK(L2FecDec_push(d, &f) == L2FEC_PARITY, "parity shortens K");
+  f.TAG[1] = (3 << 4) | 3;                // data 3 beyond K = 2
+  CHECK(L2FecDec_push(d, &f) == L2FEC_BAD && d->bad_tag == 1, "data past the known K");
+
+  /*
+   * i.i.d. frame errors per hop: residual loss after FEC, and airtime per
+   * frame delivered across HOPS hops when every residual loss is resent
+   * end to end (a frame travels until a hop loses it)
+   */
+  enum { HOPS = 4 };
+  printf("\n%d hops, airtime per delivered frame (residual loss per hop):\n", HOPS);
+  printf("%8s %15s %15s %15s %15s\n", "FER", "none", "FEC 8+2", "FEC 8+4", "FEC 4+4");
+  const double fer_set[] = { 0.01, 0.05, 0.10, 0.20, 0.30 };
+  const uint8_t modes[][2] = { { 8, 2 }, { 8, 4 }, { 4, 4 } };
+  for (uint32_t fi = 0; fi < 5; fi++) {
+    double fer = fer_set[fi], ovh[4], res[4], air[4];
+    ovh[0] = 1.0;
+    res[0] = fer;
+    for (uint32_t mi = 0; mi < 3; mi++) {
+      uint8_t k = modes[mi][0], m = modes[mi][1];
+      L2FecEnc_init(e, k, m);
+      L2FecDec_init(d, on_rebuilt, s);
+      uint64_t delivered = 0, sent = 0, want = 0;
+      for (uint32_t g = 0; g < 2000; g++) {
+        uint16_t lost = 0;
+        for (uint32_t i = 0; i < (uint32_t)(k + m); i++) {
+          if ((double)(rng() >> 11) / 9007199254740992.0 < fer) {
+            lost |= (uint16_t)(1u << i);
+          }
+        }
+        delivered += run_group(e, d, s, k, lost);
+        if (s->errors != 0) {
+          fail = 1;
+        }
+        sent += k + m;
+        want += k;
+      }
+      ovh[mi + 1] = (double)sent / (double)want;
+      res[mi + 1] = 1.0 - (double)delivered / (double)want;
+    }
+    for (uint32_t mi = 0; mi < 4; mi++) {
+      double hops_tried = 0, pass = 1;
+      for (uint32_t h = 0; h < HOPS; h++) {
+        hops_tried += pass;
+        pass *= 1.0 - res[mi];
+      }
+      air[mi] = ovh[mi] * hops_tried / pass;
+    }
+    printf("%7.0f%% %6.2f (%5.1f%%) %6.2f (%5.1f%%) %6.2f (%5.1f%%) %6.2f (%5.1f%%)\n", fer * 100, air[0],
+           res[0] * 100, air[1], res[1] * 100, air[2], res[2] * 100, air[3], res[3] * 100);
+    if (fer >= 0.05 && fer <= 0.10) {
+      CHECK(res[1] < fer / 3 && res[2] < fer / 10, "FEC cuts residual loss");
+    }
+    if (fer >= 0.20) {
+      CHECK(air[2] < air[0], "FEC cheaper than end-to-end resends on a marginal link");
+    }
+  }
+
+  free(e);
+  free(d);
+  free(s);
+
+  printf("\nORBIT L2 FEC (Reed-Solomon) Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+/*
+ * File:        test/l2_pool_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT Frame Pool Test Program.
+ *    Refcounting, L2 / L2.5 views of one buffer, exhaustion, buffers
+ *    allocated on one thread and freed on others, and get/put cost
+ *    against malloc/free.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - Build with -pthread.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "../src/L2_pool.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NBUF    1024
+#define NWORK   3
+#define NFRAMES 300000
+#define QDEPTH  256
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+
+/* RX thread -> NWORK workers, one SPSC handoff ring each */
+typedef struct {
+  L2PoolBuf_t     *q[QDEPTH];
+  _Atomic uint32_t head, tail;
+  L2Pool_t        *pool;
+  uint64_t         sum;
+} Worker_t;
+
+static void *worker(void *arg) {
+  Worker_t *w = arg;
+  L2PoolCache_t cache;
+  L2PoolCache_init(&cache, w->pool);
+  for (;;) {
+    uint32_t h = atomic_load_explicit(&w->head, memory_order_relaxed);
+    if (h == atomic_load_explicit(&w->tail, memory_order_acquire)) {
+      sched_yield();
+      continue;
+    }
+    L2PoolBuf_t *b = w->q[h % QDEPTH];
+    atomic_store_explicit(&w->head, h + 1, memory_order_release);
+    if (b == NULL) {
+      break;
+    }
+    uint32_t v;
+    memcpy(&v, L2PoolBuf_l2d5(b)->SrcAddress, 4);
+    w->sum += v;
+    L2PoolCache_put(&cache, b);
+  }
+  L2PoolCache_flush(&cache);
+  return NULL;
+}
+
+static void handoff(Worker_t *w, L2PoolBuf_t *b) {
+  uint32_t t = atomic_load_explicit(&w->tail, memory_order_relaxed);
+  while (t - atomic_load_explicit(&w->head, memory_order_acquire) == QDEPTH) {
+    sched_yield();
+  }
+  w->q[t % QDEPTH] = b;
+  atomic_store_explicit(&w->tail, t + 1, memory_order_release);
+}
+
+
+int main() {
+  int fail = 0;
+  L2Pool_t pool;
+  if (L2Pool_init(&pool, NBUF) != 0) {
+    printf("L2Pool_init failed\n");
+    return EXIT_FAILURE;
+  }
+  L2PoolCache_t c;
+  L2PoolCache_init(&c, &pool);
+
+  /* layout */
+  L2PoolBuf_t *b = L2PoolCache_get(&c);
+  CHECK(b != NULL && ((uintptr_t)b % 64) == 0, "64-byte aligned");
+  CHECK((uint8_t *)L2PoolBuf_l2d5(b) == (uint8_t *)b + 3 && L2PoolBuf_from_l2d5(L2PoolBuf_l2d5(b)) == b, "L2.5 view at offset 3");
+  L2PoolBuf_l2d5(b)->TAG = 0x42;
+  CHECK(b->frame.Payload[0] == 0x42, "same bytes");
+
+  /* refcount: two holders, freed on the last put */
+  L2PoolBuf_ref(b);
+  L2PoolCache_put(&c, b);
+  CHECK(atomic_load(&b->refcnt) == 1, "ref held");
+  uint32_t cached = c.count;
+  L2PoolCache_put(&c, b);
+  CHECK(atomic_load(&b->refcnt) == 0 && c.count == cached + 1, "freed on last put");
+
+  /* exhaustion and recovery */
+  static L2PoolBuf_t *all[NBUF + 1];
+  int got = 0;
+  while ((all[got] = L2PoolCache_get(&c)) != NULL) {
+    got++;
+  }
+  CHECK(got == NBUF && atomic_load(&pool.exhausted) == 1, "exhaustion");
+  int dup = 0;
+  static uint8_t seen[NBUF];
+  memset(seen, 0, sizeof(seen));
+  for (int i = 0; i < got; i++) {
+    dup |= seen[all[i]->index]++;
+  }
+  CHECK(!dup, "no buffer handed out twice");
+  for (int i = 0; i < got; i++) {
+    L2PoolCache_put(&c, all[i]);
+  }
+  L2PoolCache_flush(&c);
+  CHECK(atomic_load(&pool.free_count) == NBUF, "all back after flush");
+
+  /* RX thread allocates, workers free into their own caches */
+  static Worker_t w[NWORK];
+  pthread_t th[NWORK];
+  for (int i = 0; i < NWORK; i++) {
+    memset(&w[i], 0, sizeof(w[i]));
+    w[i].pool = &pool;
+    pthread_create(&th[i], NULL, worker, &w[i]);
+  }
+  uint64_t expect = 0;
+  double t0 = now_sec();
+  for (uint32_t i = 0; i < NFRAMES; i++) {
+    L2PoolBuf_t *rx;
+    while ((rx = L2PoolCache_get(&c)) == NULL) {
+      sched_yield();
+    }
+    memcpy(L2PoolBuf_l2d5(rx)->SrcAddress, &i, 4);
+    expect += i;
+    handoff(&w[i % NWORK], rx);
+  }
+  for (int i = 0; i < NWORK; i++) {
+    handoff(&w[i], NULL);
+  }
+  uint64_t sum = 0;
+  for (int i = 0; i < NWORK; i++) {
+    pthread_join(th[i], NULL);
+    sum += w[i].sum;
+  }
+  double mt = (now_sec() - t0) / NFRAMES * 1e9;
+  L2PoolCache_flush(&c);
+  CHECK(sum == expect, "every frame delivered once");
+  CHECK(atomic_load(&pool.free_count) == NBUF, "no leak across threads");
+  printf("RX -> %d workers: %.1f ns/frame\n", NWORK, mt);
+
+  /* get/put cost */
+  enum { ROUNDS = 2000000 };
+  volatile uintptr_t sink = 0;
+  t0 = now_sec();
+  for (int i = 0; i < ROUNDS; i++) {
+    void *m = malloc(sizeof(L2Frame));
+    sink += (uintptr_t)m;
+    free(m);
+  }
+  double tm = (now_sec() - t0) / ROUNDS * 1e9;
+  t0 = now_sec();
+  for (int i = 0; i < ROUNDS; i++) {
+    L2PoolBuf_t *p = L2PoolCache_get(&c);
+    sink += (uintptr_t)p;
+    L2PoolCache_put(&c, p);
+  }
+  double tp = (now_sec() - t0) / ROUNDS * 1e9;
+  printf("get+put: malloc/free %.1f ns, pool cache %.1f ns\n", tm, tp);
+
+  L2PoolCache_flush(&c);
+  L2Pool_free(&pool);
+  printf("\nORBIT Frame Pool Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -15,9 +15,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "../src/L2_struct.h"
+#include "../src/L2_crc32.h"
+#include "../src/ORBIT_schema.h"
+#include "../src/ORBIT_schema_view.h"
 #include <sys/random.h>
-#include <zlib.h>
-#include <printHexTable/printHexTable.h>
 
 
 
@@ -58,12 +59,7 @@ int main() {
   uint8_t* payload_test = gen_rdm_bytestream(216);
   memcpy(l2test.Payload, payload_test, 216);
   //l2test.Payload = payload_test;
-  uint32_t checksum = crc32(0, l2test.Payload, 216);
-
-  l2test.ChkSum[0] = (uint8_t)((checksum >> 24) & 0xFF);
-  l2test.ChkSum[1] = (uint8_t)((checksum >> 16) & 0xFF);
-  l2test.ChkSum[2] = (uint8_t)((checksum >> 8) & 0xFF);
-  l2test.ChkSum[3] = (uint8_t)(checksum & 0xFF);
+  L2CRC32_seal(&l2test);
 
   uint8_t print_l2_buffer[224];
   print_l2_buffer[0] = l2test.SFD;
@@ -82,11 +78,9 @@ int main() {
   displayStruct();
   
   ANSIColorMap256_t l2Frame_ansi_map = {0};
-  addr2AnsiColorMap256(&l2Frame_ansi_map, 0x00, 0x00, "\e[1;32m", 0x00, ' ', 0x00, ' ', 1);
-  addr2AnsiColorMap256(&l2Frame_ansi_map, 0x01, 0x02, "\e[0;33m", 0x01, '[', 0x02, ']', 1);
-  addr2AnsiColorMap256(&l2Frame_ansi_map, 0x03, 0xDA, "\e[0;36m", 0x03, '[', 0xDA, ']', 1);
-  addr2AnsiColorMap256(&l2Frame_ansi_map, 0xDB, 0xDE, "\e[0;35m", 0xDB, '[', 0xDE, ']', 1);
-  addr2AnsiColorMap256(&l2Frame_ansi_map, 0xDF, 0xDF, "\e[1;31m", 0xDF, ' ', 0xDF, ' ', 1);
+  size_t nfields;
+  const ORBITSchemaField_t *fields = L2Frame_fields(&nfields);
+  ORBITSchema_color_map(&l2Frame_ansi_map, fields, nfields);
 
 
 
@@ -94,7 +88,7 @@ int main() {
 
 
   printf("%s", output_str);
-  printf("\e[1;32m ██ SFD\e[0m\t\e[0;33m ██ TAG\e[0m\t\e[0;36m ██ PAYLOAD\e[0m\t\e[0;35m ██ CHECKSUM\e[0m\t\e[1;31m ██ EFD\e[0m\n");
+  ORBITSchema_legend(fields, nfields);
 
   free(payload_test);
   free(output_str);
@@ -0,0 +1,206 @@
+/*
+ * File:        test/l2d5_aes_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Multi-buffer AES Test Program.
+ *    Lane kernels vs OpenSSL AES-256-CBC-CTS, batch vs single-frame key
+ *    cache path (in place and out of place), and frames/sec of both.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2D5_aes.h"
+#include "../src/L2D5_keycache.h"
+#include <sys/random.h>
+#include <openssl/evp.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NSESS  16
+#define NBATCH 64
+
+
+static void rand_bytes(void *buf, size_t len) {
+  if (getrandom(buf, len, 0) != (ssize_t)len) {
+    perror("getrandom failed");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int openssl_cts(int enc, const uint8_t *key, const uint8_t *iv, const uint8_t *in, uint8_t *out, size_t len) {
+  EVP_CIPHER *cbc_cts = EVP_CIPHER_fetch(NULL, "AES-256-CBC-CTS", NULL);
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  int l1 = 0, l2 = 0;
+  EVP_CipherInit_ex(ctx, cbc_cts, NULL, key, iv, enc);
+  EVP_CipherUpdate(ctx, out, &l1, in, (int)len);
+  EVP_CipherFinal_ex(ctx, out + l1, &l2);
+  EVP_CIPHER_CTX_free(ctx);
+  EVP_CIPHER_free(cbc_cts);
+  return l1 + l2;
+}
+
+
+static int test_kernels(void) {
+  int fail = 0;
+  uint8_t key[L2D5AES_LANES][32], iv[L2D5AES_LANES][16];
+  uint8_t pt[L2D5AES_LANES][256], ct[L2D5AES_LANES][256], back[L2D5AES_LANES][256], ref[256];
+  L2D5AesKey_t ks[L2D5AES_LANES];
+  const L2D5AesKey_t *kp[L2D5AES_LANES];
+  const uint8_t *ivp[L2D5AES_LANES], *inp[L2D5AES_LANES], *ctp[L2D5AES_LANES];
+  uint8_t *ctw[L2D5AES_LANES], *backw[L2D5AES_LANES];
+
+  rand_bytes(key, sizeof(key));
+  rand_bytes(iv, sizeof(iv));
+  rand_bytes(pt, sizeof(pt));
+  for (int l = 0; l < L2D5AES_LANES; l++) {
+    L2D5Aes_expand(key[l], &ks[l]);
+    kp[l] = &ks[l];
+    ivp[l] = iv[l];
+    inp[l] = pt[l];
+    ctp[l] = ct[l];
+    ctw[l] = ct[l];
+    backw[l] = back[l];
+  }
+
+  for (size_t len = 16; len <= 256; len++) {
+    size_t n = 1 + len % L2D5AES_LANES;
+    L2D5Aes_cts_encrypt_lanes(kp, ivp, inp, ctw, n, len);
+    L2D5Aes_cts_decrypt_lanes(kp, ivp, ctp, backw, n, len);
+    for (size_t l = 0; l < n; l++) {
+      openssl_cts(1, key[l], iv[l], pt[l], ref, len);
+      if (memcmp(ref, ct[l], len) != 0 || memcmp(back[l], pt[l], len) != 0) {
+        printf("FAIL: lane %zu len %zu\n", l, len);
+        fail = 1;
+        break;
+      }
+    }
+  }
+  printf("Lane kernels vs OpenSSL (len 16..256): %s\n", fail ? "FAIL" : "OK");
+  return fail;
+}
+
+
+int main() {
+  int fail = 0;
+
+  if (!L2D5Aes_available()) {
+    printf("AES-NI not available: batch calls use the OpenSSL fallback\n");
+  } else {
+    fail |= test_kernels();
+  }
+
+  L2D5KeyCache_t cache;
+  if (L2D5KeyCache_init(&cache, NSESS) != 0) {
+    printf("L2D5KeyCache_init failed\n");
+    return EXIT_FAILURE;
+  }
+  uint8_t addr[NSESS][16], pub[NSESS][32], shared[NSESS][32];
+  rand_bytes(addr, sizeof(addr));
+  rand_bytes(pub, sizeof(pub));
+  rand_bytes(shared, sizeof(shared));
+  L2D5Session_t *sess[NSESS];
+  for (int i = 0; i < NSESS; i++) {
+    sess[i] = L2D5KeyCache_install(&cache, addr[i], pub[i], shared[i]);
+  }
+
+  static L2D5Frame_t plain[NBATCH], back[NBATCH], work[NBATCH];
+  static L2D5Frame_Encrypted_t single[NBATCH], batch[NBATCH];
+  L2D5Session_t *bs[NBATCH], *got[NBATCH];
+  const L2D5Frame_t *pin[NBATCH];
+  const L2D5Frame_Encrypted_t *ein[NBATCH];
+  L2D5Frame_Encrypted_t *eout[NBATCH];
+  L2D5Frame_t *pout[NBATCH];
+
+  rand_bytes(plain, sizeof(plain));
+  for (int i = 0; i < NBATCH; i++) {
+    bs[i] = sess[i % NSESS];
+    plain[i].TAG = L2D5TAG_HELLO_PKT_RM;
+    memcpy(plain[i].SrcAddress, addr[i % NSESS], 16);
+    L2D5KeyCache_encrypt(&cache, bs[i], &plain[i], &single[i]);
+    pin[i] = &plain[i];
+    eout[i] = &batch[i];
+    ein[i] = &batch[i];
+    pout[i] = &back[i];
+  }
+
+  /* out of place */
+  CHECK(L2D5KeyCache_encrypt_batch(&cache, bs, pin, eout, NBATCH) == NBATCH, "encrypt_batch count");
+  CHECK(memcmp(single, batch, sizeof(batch)) == 0, "batch ciphertext == single-frame ciphertext");
+  CHECK(L2D5KeyCache_decrypt_batch(&cache, ein, pout, got, NBATCH) == NBATCH, "decrypt_batch count");
+  for (int i = 0; i < NBATCH; i++) {
+    CHECK(got[i] == bs[i] && memcmp(back[i].SrcAddress, plain[i].SrcAddress, 210) == 0, "decrypt_batch payload");
+  }
+
+  /* in place */
+  memcpy(work, plain, sizeof(work));
+  for (int i = 0; i < NBATCH; i++) {
+    pin[i] = &work[i];
+    eout[i] = (L2D5Frame_Encrypted_t *)&work[i];
+    ein[i] = (const L2D5Frame_Encrypted_t *)&work[i];
+    pout[i] = &work[i];
+  }
+  L2D5KeyCache_encrypt_batch(&cache, bs, pin, eout, NBATCH);
+  CHECK(memcmp(work, single, sizeof(work)) == 0, "in-place encrypt");
+  L2D5KeyCache_decrypt_batch(&cache, ein, pout, NULL, NBATCH);
+  for (int i = 0; i < NBATCH; i++) {
+    CHECK(memcmp(work[i].SrcAddress, plain[i].SrcAddress, 210) == 0, "in-place decrypt");
+  }
+
+  /* OpenSSL fallback gives the same bytes */
+  bool aesni = cache.aesni;
+  cache.aesni = false;
+  for (int i = 0; i < NBATCH; i++) {
+    pin[i] = &plain[i];
+    eout[i] = &batch[i];
+    ein[i] = &batch[i];
+    pout[i] = &back[i];
+  }
+  memset(batch, 0, sizeof(batch));
+  L2D5KeyCache_encrypt_batch(&cache, bs, pin, eout, NBATCH);
+  CHECK(memcmp(single, batch, sizeof(batch)) == 0, "fallback ciphertext");
+  CHECK(L2D5KeyCache_decrypt_batch(&cache, ein, pout, got, NBATCH) == NBATCH, "fallback decrypt");
+
+  /* throughput: per-frame OpenSSL contexts vs lanes */
+  enum { ROUNDS = 2000 };
+  double t0 = now_sec();
+  for (int r = 0; r < ROUNDS; r++) {
+    L2D5KeyCache_encrypt_batch(&cache, bs, pin, eout, NBATCH);
+  }
+  double scalar = now_sec() - t0;
+  printf("Encrypt, OpenSSL per frame: %8.1f ns/frame\n", scalar / (ROUNDS * NBATCH) * 1e9);
+  cache.aesni = aesni;
+  if (aesni) {
+    t0 = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+      L2D5KeyCache_encrypt_batch(&cache, bs, pin, eout, NBATCH);
+    }
+    double lanes = now_sec() - t0;
+    printf("Encrypt, %d AES-NI lanes:    %8.1f ns/frame (x%.2f)\n", L2D5AES_LANES,
+           lanes / (ROUNDS * NBATCH) * 1e9, scalar / lanes);
+    t0 = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+      L2D5KeyCache_decrypt_batch(&cache, ein, pout, got, NBATCH);
+    }
+    printf("Decrypt, %d AES-NI lanes:    %8.1f ns/frame\n", L2D5AES_LANES,
+           (now_sec() - t0) / (ROUNDS * NBATCH) * 1e9);
+  }
+
+  L2D5KeyCache_free(&cache);
+  printf("\nORBIT L2.5 Multi-buffer AES Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,294 @@
+/*
+ * File:        test/l2d5_agg_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Payload Aggregation Test Program.
+ *    Random messages to random destinations / PRIs through the aggregator
+ *    and back through the de-aggregation iterator (all delivered, in order,
+ *    within max_latency[PRI] + one tick), full / urgent / evict flushes,
+ *    malformed payloads, and frames on air per message for small sensor
+ *    readings aggregated against one frame per message.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+#include "../src/L2D5_agg.h"
+#include "../src/ORBIT_bytes.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NDST   12
+#define NMSG   200000
+#define TICK   10
+#define HOLD   2000
+
+
+/* message body: | dst | seq (be16) | pri | filler ... | */
+typedef struct {
+  uint64_t  pushed[NDST][65536];          // push time per (dst, seq)
+  uint8_t   pri[NDST][65536];
+  uint16_t  next_seq[NDST];
+  uint64_t  lat[16];
+  uint64_t  frames;
+  uint64_t  msgs;
+  uint64_t  errors;                       // order / content / header
+  uint64_t  late;
+  uint64_t  worst;
+  uint8_t   self[16];
+} Sink_t;
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng_state;
+
+static inline uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static void mkaddr(uint8_t *_addr, uint32_t _i) {
+  memset(_addr, 0, 16);
+  _addr[0] = 0xFD;
+  _addr[14] = (uint8_t)(_i >> 8);
+  _addr[15] = (uint8_t)_i;
+}
+
+static void sink_emit(void *_ctx, const L2D5Frame_t *_f, uint32_t _count, uint64_t _now) {
+  Sink_t *k = _ctx;
+  k->frames++;
+  if (!L2D5Agg_is_aggregate(_f) || !L2D5ADDR_equal(_f->SrcAddress, k->self) || _f->TAG != 0x5A) {
+    k->errors++;
+  }
+  uint32_t dst = _f->DstAddress[15];
+  uint8_t max_pri = 0;
+  uint32_t n = 0;
+  L2D5AggIter_t it;
+  L2D5AggMsg_t m;
+  L2D5AggIter_init(&it, _f);
+  while (L2D5AggIter_next(&it, &m)) {
+    n++;
+    uint16_t seq = ORBIT_load_be16(m.data + 1);
+    if (m.len < 5 || m.data[0] != dst || seq != k->next_seq[dst] || m.port != (uint8_t)(seq * 7) ||
+        m.data[3] != k->pri[dst][seq] || m.data[m.len - 1] != (uint8_t)(seq ^ m.len)) {
+      k->errors++;
+      continue;
+    }
+    k->next_seq[dst]++;
+    max_pri = m.data[3] > max_pri ? m.data[3] : max_pri;
+    uint64_t waited = _now - k->pushed[dst][seq];
+    k->worst = waited > k->worst ? waited : k->worst;
+    if (waited > k->lat[m.data[3]] + TICK) {
+      k->late++;
+    }
+  }
+  if (it.bad || n != _count || L2D5FLAG_GET_PRI(_f->FLAG) != max_pri) {
+    k->errors++;
+  }
+  k->msgs += n;
+}
+
+typedef struct {
+  uint64_t frames;
+  uint32_t count;
+} Counter_t;
+
+static void count_emit(void *_ctx, const L2D5Frame_t *_f, uint32_t _count, uint64_t _now) {
+  (void)_f;
+  (void)_now;
+  Counter_t *c = _ctx;
+  c->frames++;
+  c->count = _count;
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  uint8_t self[16], dst[16];
+  mkaddr(self, 0xFFFF);
+
+  /* 1. random traffic: everything arrives, in order, inside its latency bound */
+  Sink_t *k = calloc(1, sizeof(Sink_t));
+  if (k == NULL) {
+    perror("calloc failed");
+    return EXIT_FAILURE;
+  }
+  memcpy(k->self, self, 16);
+  L2D5Agg_t a;
+  CHECK(L2D5Agg_init(&a, 8, self, HOLD, TICK, 0, NULL, NULL) == -1, "no emit rejected");
+  CHECK(L2D5Agg_init(&a, 8, self, HOLD, TICK, 0, sink_emit, k) == 0, "init");
+  for (uint8_t pri = 0; pri < 16; pri++) {
+    k->lat[pri] = pri == 15 ? 0 : HOLD >> (pri / 3);
+    L2D5Agg_set_latency(&a, pri, k->lat[pri]);
+  }
+  uint16_t seq[NDST] = { 0 };
+  uint8_t buf[L2D5AGG_MAX_MSG];
+  uint64_t now = 0;
+  for (uint32_t i = 0; i < NMSG; i++) {
+    now += rng() % 200;
+    L2D5Agg_poll(&a, now);
+    uint32_t d = (uint32_t)(rng() % NDST);
+    uint8_t pri = (uint8_t)(rng() % 16);
+    size_t len = rng() % 4 == 0 ? 5 + rng() % (L2D5AGG_MAX_MSG - 4) : 5 + rng() % 20;
+    memset(buf, 0xA5, len);
+    buf[0] = (uint8_t)d;
+    ORBIT_store_be16(buf + 1, seq[d]);
+    buf[3] = pri;
+    buf[len - 1] = (uint8_t)(seq[d] ^ len);
+    k->pushed[d][seq[d]] = now;
+    k->pri[d][seq[d]] = pri;
+    mkaddr(dst, d);
+    if (L2D5Agg_push(&a, 0x5A, dst, 12, pri, (uint8_t)(seq[d] * 7), buf, len, now) != 0) {
+      k->errors++;
+    }
+    seq[d]++;
+  }
+  for (uint64_t end = now + HOLD + TICK; now <= end; now += TICK) {
+    L2D5Agg_poll(&a, now);
+  }
+  CHECK(L2D5Agg_pending(&a) == 0, "all deadlines fired");
+  CHECK(L2D5Agg_flush(&a, now) == 0, "nothing left to flush");
+  printf("random: %llu msgs in %llu frames (%.2f msgs/frame), full %llu, deadline %llu, urgent %llu, "
+         "evict %llu, worst wait %llu\n", (unsigned long long)k->msgs, (unsigned long long)k->frames,
+         (double)k->msgs / (double)k->frames, (unsigned long long)a.flush_full,
+         (unsigned long long)a.flush_deadline, (unsigned long long)a.flush_urgent,
+         (unsigned long long)a.flush_evict, (unsigned long long)k->worst);
+  CHECK(k->msgs == NMSG && a.msgs == NMSG, "every message delivered");
+  CHECK(k->errors == 0, "in order, intact, headers right");
+  CHECK(k->late == 0, "latency bound per PRI");
+  CHECK(a.flush_evict > 0 && a.flush_urgent > 0 && a.flush_full > 0, "every flush reason seen");
+  L2D5Agg_free(&a);
+  free(k);
+
+  /* 2. flush reasons one by one */
+  Counter_t c = { 0 };
+  CHECK(L2D5Agg_init(&a, 2, self, 1000, TICK, 0, count_emit, &c) == 0, "init small");
+  L2D5Agg_set_latency(&a, 3, 0);
+  mkaddr(dst, 1);
+  memset(buf, 1, sizeof(buf));
+  CHECK(L2D5Agg_push(&a, 1, dst, 1, 0, 0, buf, 0, 0) == -1, "empty message rejected");
+  CHECK(L2D5Agg_push(&a, 1, dst, 1, 0, 0, buf, L2D5AGG_MAX_MSG + 1, 0) == -1, "oversize rejected");
+  CHECK(L2D5Agg_push(&a, 1, dst, 1, 0, 0, buf, L2D5AGG_MAX_MSG, 0) == 0 && c.frames == 1 && a.flush_full == 1,
+        "max size message goes at once");
+  L2D5Agg_push(&a, 1, dst, 1, 0, 0, buf, 100, 0);
+  L2D5Agg_push(&a, 1, dst, 1, 0, 0, buf, 100, 0);
+  CHECK(c.frames == 2 && c.count == 1 && a.flush_full == 2, "no room: pending frame out first");
+  L2D5Agg_push(&a, 1, dst, 1, 3, 0, buf, 8, 5);
+  CHECK(c.frames == 3 && c.count == 2 && a.flush_urgent == 1, "latency 0 PRI flushes with what is pending");
+  L2D5Agg_push(&a, 1, dst, 1, 0, 0, buf, 8, 10);
+  mkaddr(dst, 2);
+  L2D5Agg_push(&a, 1, dst, 1, 0, 0, buf, 8, 20);
+  L2D5Agg_push(&a, 2, dst, 1, 0, 0, buf, 8, 30);
+  CHECK(c.frames == 4 && c.count == 1 && a.flush_evict == 1, "third key evicts the earliest deadline");
+  CHECK(L2D5Agg_poll(&a, 1010) == 0, "before the deadline tick");
+  CHECK(L2D5Agg_poll(&a, 1020) == 1, "hold deadline");
+  CHECK(L2D5Agg_flush(&a, 1020) == 1 && L2D5Agg_pending(&a) == 0, "flush drains the rest");
+  L2D5Agg_free(&a);
+
+  /* 3. receive side: malformed records stop the walk */
+  L2D5Frame_t f;
+  L2D5AggIter_t it;
+  L2D5AggMsg_t m;
+  memset(&f, 0, sizeof(f));
+  f.Payload[0] = 3; f.Payload[1] = 9; f.Payload[5] = 1;
+  L2D5AggIter_init(&it, &f);
+  CHECK(L2D5AggIter_next(&it, &m) && m.len == 3 && m.port == 9 && m.data == f.Payload + 2, "record in place");
+  CHECK(L2D5AggIter_next(&it, &m) && m.len == 1, "second record");
+  CHECK(!L2D5AggIter_next(&it, &m) && !it.bad, "zero length ends the list");
+  f.Payload[8] = 200;
+  L2D5AggIter_init(&it, &f);
+  L2D5AggIter_next(&it, &m);
+  L2D5AggIter_next(&it, &m);
+  CHECK(!L2D5AggIter_next(&it, &m) && it.bad, "record past the payload flagged");
+  CHECK(!L2D5AggIter_next(&it, &m), "stays stopped");
+  memset(f.Payload, 0, sizeof(f.Payload));
+  f.Payload[0] = L2D5AGG_MAX_MSG;
+  L2D5AggIter_init(&it, &f);
+  CHECK(L2D5AggIter_next(&it, &m) && m.len == L2D5AGG_MAX_MSG, "full payload record");
+  CHECK(!L2D5AggIter_next(&it, &m) && !it.bad, "ends at the payload end");
+  memset(f.Payload, 0xFF, sizeof(f.Payload));
+  int walked = 0;
+  for (int i = 0; i < 100000; i++) {
+    for (int j = 0; j < 176; j++) {
+      f.Payload[j] = (uint8_t)rng();
+    }
+    L2D5AggIter_init(&it, &f);
+    int n = 0;
+    while (L2D5AggIter_next(&it, &m)) {
+      walked += m.data + m.len > f.Payload + L2D5AGG_PAYLOAD;
+      n++;
+    }
+    walked += n > 176 / 3;
+  }
+  CHECK(walked == 0, "random payloads stay in bounds");
+
+  /* 4. 12-byte sensor readings from 8 nodes to 4 sinks: frames on air, cost per message */
+  const uint32_t nreading = 4000000;
+  Counter_t agg_c = { 0 }, one_c = { 0 };
+  L2D5Agg_t one;
+  CHECK(L2D5Agg_init(&a, 16, self, 50000, 1000, 0, count_emit, &agg_c) == 0, "init bench");
+  CHECK(L2D5Agg_init(&one, 16, self, 50000, 1000, 0, count_emit, &one_c) == 0, "init bench 1");
+  for (uint8_t pri = 0; pri < 16; pri++) {
+    L2D5Agg_set_latency(&one, pri, 0);
+  }
+  uint8_t sinks[4][16];
+  for (uint32_t s = 0; s < 4; s++) {
+    mkaddr(sinks[s], 0x100 + s);
+  }
+  uint8_t reading[12] = { 0 };
+  double t0 = now_sec();
+  for (uint32_t i = 0; i < nreading; i++) {
+    uint64_t us = (uint64_t)i * 250;
+    ORBIT_store_be32(reading, i);
+    L2D5Agg_poll(&a, us);
+    L2D5Agg_push(&a, 0x20, sinks[i & 3], 8, 2, (uint8_t)(i & 7), reading, sizeof(reading), us);
+  }
+  L2D5Agg_flush(&a, (uint64_t)nreading * 250);
+  double t1 = now_sec();
+  for (uint32_t i = 0; i < nreading; i++) {
+    uint64_t us = (uint64_t)i * 250;
+    ORBIT_store_be32(reading, i);
+    L2D5Agg_poll(&one, us);
+    L2D5Agg_push(&one, 0x20, sinks[i & 3], 8, 2, (uint8_t)(i & 7), reading, sizeof(reading), us);
+  }
+  double t2 = now_sec();
+  double airtime_agg = (double)agg_c.frames * (double)sizeof(L2D5Frame_t);
+  double airtime_one = (double)one_c.frames * (double)sizeof(L2D5Frame_t);
+  printf("\n%-14s %12s %12s %12s %12s\n", "", "frames", "msgs/frame", "goodput %", "ns/msg");
+  printf("%-14s %12llu %12.2f %12.1f %12.1f\n", "aggregated", (unsigned long long)agg_c.frames,
+         (double)nreading / (double)agg_c.frames, 100.0 * (double)a.msg_bytes / airtime_agg,
+         (t1 - t0) * 1e9 / nreading);
+  printf("%-14s %12llu %12.2f %12.1f %12.1f\n", "one per frame", (unsigned long long)one_c.frames,
+         (double)nreading / (double)one_c.frames, 100.0 * (double)one.msg_bytes / airtime_one,
+         (t2 - t1) * 1e9 / nreading);
+  CHECK(one_c.frames == nreading, "one frame per message");
+  CHECK(agg_c.frames * 10 < one_c.frames, "aggregation cuts frames on air by 10x or more");
+  L2D5Agg_free(&a);
+  L2D5Agg_free(&one);
+
+  printf("\nORBIT L2.5 Payload Aggregation Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
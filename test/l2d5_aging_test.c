@@ -0,0 +1,212 @@
+/*
+ * File:        test/l2d5_aging_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Neighbor / Route Expiry Test Program.
+ *    Neighbor timeout cascading into the remote routes that used it
+ *    (orphaned routes removed, others switch next hop), route timeout,
+ *    re-arm from table last_seen, slot reuse, and housekeeping cost per
+ *    HELLO interval for growing tables.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/random.h>
+#include <time.h>
+#include "../src/L2D5_aging.h"
+#include "../src/ORBIT_bytes.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NB_TIMEOUT    90
+#define ROUTE_TIMEOUT 120
+#define NNEIGH        8
+#define NDEST         64
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void make_hello(L2D5Routing_HelloPkt_t *h, const uint8_t *origin, uint16_t seq) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->NodeSrcAddr, origin, 16);
+  ORBIT_store_be16(h->SEQ, seq);
+  ORBIT_store_be16(h->NodesLimit, 3);
+}
+
+static void count_cb(void *_ctx, uint32_t _slot) {
+  (void)_slot;
+  (*(uint32_t *)_ctx)++;
+}
+
+static uint32_t hello(L2D5Aging_t *a, const uint8_t *origin, uint16_t seq, uint32_t via, uint16_t hops,
+                      uint64_t now) {
+  L2D5Routing_HelloPkt_t h;
+  make_hello(&h, origin, seq);
+  uint32_t dest = L2D5Route_hello(a->route, &h, via, hops, now, NULL);
+  if (dest != L2D5ROUTE_NIL) {
+    L2D5Aging_route_seen(a, dest, now);
+  }
+  return dest;
+}
+
+static uint32_t neighbor(L2D5Aging_t *a, const uint8_t *addr, uint64_t now) {
+  uint32_t slot = L2D5Neighbor_observe(a->nb, addr, NULL, now, -60, NULL);
+  L2D5Aging_neighbor_seen(a, slot, now);
+  return slot;
+}
+
+
+int main() {
+  int fail = 0;
+  static uint8_t nb_addr[NNEIGH][16], dst[NDEST][16];
+  if (getrandom(nb_addr, sizeof(nb_addr), 0) != sizeof(nb_addr) || getrandom(dst, sizeof(dst), 0) != sizeof(dst)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+
+  L2D5NeighborTable_t nb;
+  L2D5RouteTable_t r;
+  L2D5Aging_t a;
+  uint32_t nb_cb = 0;
+  CHECK(L2D5Neighbor_init(&nb, 16) == 0 && L2D5Route_init(&r, &nb, NDEST) == 0, "init tables");
+  CHECK(L2D5Aging_init(&a, &nb, &r, NB_TIMEOUT, ROUTE_TIMEOUT, 1, 0) == 0, "init aging");
+  a.on_neighbor = a.on_route = count_cb;
+  a.ctx = &nb_cb;
+
+  /* dest 0 only via A, dest 1 via A (best) and B, dest 2 only via B */
+  uint32_t A = neighbor(&a, nb_addr[0], 0), B = neighbor(&a, nb_addr[1], 0);
+  uint32_t d0 = hello(&a, dst[0], 1, A, 2, 0);
+  uint32_t d1 = hello(&a, dst[1], 1, A, 2, 0);
+  hello(&a, dst[1], 1, B, 3, 0);
+  uint32_t d2 = hello(&a, dst[2], 1, B, 2, 0);
+  CHECK(L2D5Route_next_hop(&r, dst[1]) == A, "dest 1 prefers A");
+
+  /* B and every route keep being heard, A falls silent */
+  for (uint64_t t = 10; t <= 100; t += 10) {
+    neighbor(&a, nb_addr[1], t);
+    hello(&a, dst[0], (uint16_t)(1 + t), B, 3, t);
+    hello(&a, dst[1], (uint16_t)(1 + t), B, 3, t);
+    hello(&a, dst[2], (uint16_t)(1 + t), B, 2, t);
+    L2D5Aging_advance(&a, t);
+    if (t == 80) {
+      CHECK(L2D5Neighbor_occupied(&nb, A), "A alive before its timeout");
+    }
+  }
+  CHECK(!L2D5Neighbor_occupied(&nb, A) && a.nb_expired == 1, "A expired");
+  CHECK(L2D5Route_next_hop(&r, dst[0]) == B, "dest 0 switched to B");
+  CHECK(L2D5Route_next_hop(&r, dst[1]) == B, "dest 1 switched to B");
+  CHECK(L2D5Route_find(&r, dst[2]) == d2 && a.routes_orphaned == 0, "routes with another next hop kept");
+  CHECK(nb_cb == 1, "neighbor callback");
+  (void)d0;
+  (void)d1;
+
+  /* orphaned: routes only via B disappear with B, before their own timeout */
+  hello(&a, dst[3], 1, B, 2, 100);
+  uint32_t before = r.count;
+  L2D5Aging_advance(&a, 100 + NB_TIMEOUT);
+  CHECK(!L2D5Neighbor_occupied(&nb, B), "B expired");
+  CHECK(a.routes_orphaned == before && r.count == 0, "routes only via B orphaned");
+  CHECK(nb_cb == 2 + before, "route callbacks");
+  CHECK(L2D5Route_next_hop(&r, dst[2]) == L2D5NB_NIL, "no next hop after cascade");
+
+  /* route timeout while the neighbor stays */
+  uint64_t t = 1000;
+  uint32_t C = neighbor(&a, nb_addr[2], t);
+  uint32_t d = hello(&a, dst[4], 7, C, 2, t);
+  for (uint64_t k = 0; k <= ROUTE_TIMEOUT; k += 30) {
+    neighbor(&a, nb_addr[2], t + k);
+    L2D5Aging_advance(&a, t + k);
+  }
+  CHECK(L2D5Route_find(&r, dst[4]) == L2D5ROUTE_NIL && a.routes_expired == 1, "route own timeout");
+  CHECK(L2D5Neighbor_occupied(&nb, C), "neighbor kept");
+
+  /* refreshed in the table only: fires, sees last_seen, re-arms */
+  t = 2000;
+  neighbor(&a, nb_addr[3], t);
+  d = hello(&a, dst[5], 1, C, 2, t);
+  neighbor(&a, nb_addr[2], t);
+  uint32_t D = L2D5Neighbor_find(&nb, nb_addr[3]);
+  L2D5Neighbor_touch(&nb, D, t + 50, -60);
+  neighbor(&a, nb_addr[2], t + 50);
+  L2D5Aging_advance(&a, t + NB_TIMEOUT);
+  CHECK(L2D5Neighbor_occupied(&nb, D) && a.rearmed >= 1, "table refresh honoured");
+  neighbor(&a, nb_addr[2], t + 100);
+  hello(&a, dst[5], 2, C, 2, t + 100);
+  L2D5Aging_advance(&a, t + 50 + NB_TIMEOUT);
+  CHECK(!L2D5Neighbor_occupied(&nb, D), "then expires");
+
+  /* explicit drop cascades the same way */
+  CHECK(L2D5Neighbor_occupied(&nb, C) && L2D5Route_find(&r, dst[5]) == d, "before drop");
+  L2D5Aging_neighbor_drop(&a, C);
+  CHECK(!L2D5Neighbor_occupied(&nb, C) && L2D5Route_find(&r, dst[5]) == L2D5ROUTE_NIL, "drop cascades");
+  CHECK(a.wheel.armed == 0, "no timers left behind");
+  L2D5Aging_free(&a);
+  L2D5Route_free(&r);
+  L2D5Neighbor_free(&nb);
+
+  /* housekeeping per HELLO period: n routes, 1 % of them go silent and expire */
+  printf("\n%8s %16s %24s %24s\n", "routes", "refresh ns", "wheel ns/entry/period", "scan ns/entry/period");
+  double first = 0, last = 0;
+  for (uint32_t n = 256; n <= 65536; n <<= 4) {
+    uint8_t (*addr)[16] = malloc((size_t)n * 16);
+    if (getrandom(addr, (size_t)n * 16, 0) != (ssize_t)n * 16) {
+      perror("getrandom failed");
+      return EXIT_FAILURE;
+    }
+    CHECK(L2D5Neighbor_init(&nb, 16) == 0 && L2D5Route_init(&r, &nb, n) == 0, "init bench tables");
+    CHECK(L2D5Aging_init(&a, &nb, &r, 3000, 3000, 10, 0) == 0, "init bench aging");
+    uint32_t via = neighbor(&a, nb_addr[0], 0);
+    double refresh = 0, adv = 0, scan = 0;
+    uint64_t sink = 0;
+    for (uint64_t p = 1; p <= 20; p++) {
+      uint64_t now = p * 1000;
+      neighbor(&a, nb_addr[0], now);
+      double t0 = now_sec();
+      for (uint32_t i = 0; i < n; i++) {
+        if (p == 1 || i % 100 != 0) {
+          hello(&a, addr[i], (uint16_t)p, via, 2, now);
+        }
+      }
+      /* expiry checked every tick (10) through the period */
+      double t1 = now_sec();
+      for (uint64_t k = 0; k < 1000; k += 10) {
+        L2D5Aging_advance(&a, now + k);
+      }
+      double t2 = now_sec();
+      for (uint64_t k = 0; k < 1000; k += 10) {
+        for (uint32_t dd = L2D5Route_next(&r, 0); dd != L2D5ROUTE_NIL; dd = L2D5Route_next(&r, dd + 1)) {
+          sink += r.cold[dd].last_seen + 3000 <= now + k;
+        }
+      }
+      double t3 = now_sec();
+      refresh += t1 - t0;
+      adv += t2 - t1;
+      scan += t3 - t2;
+    }
+    double per = adv * 1e9 / (20.0 * n);
+    printf("%8u %16.1f %24.2f %24.2f   (%llu expired, %llu sink)\n", n, refresh * 1e9 / (20.0 * n), per,
+           scan * 1e9 / (20.0 * n), (unsigned long long)a.routes_expired, (unsigned long long)sink);
+    first = first == 0 ? per : first;
+    last = per;
+    L2D5Aging_free(&a);
+    L2D5Route_free(&r);
+    L2D5Neighbor_free(&nb);
+    free(addr);
+  }
+  CHECK(last < first * 16 + 5, "housekeeping per entry does not grow with the table");
+
+  printf("\nORBIT L2.5 Neighbor / Route Expiry Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+/*
+ * File:        test/l2d5_classify_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Batch Frame Classifier Test Program.
+ *    L2D5Cls_batch / L2D5Cls_batch_contig against the scalar reference
+ *    for every batch size on random and crafted frames, and per-frame
+ *    cost of both.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2D5_classify.h"
+#include <sys/random.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NFRAMES 4096
+
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Mostly valid frames of the four types, some broken in each header byte */
+static void make_frame(L2Frame *f) {
+  static const uint8_t tags[] = { L2D5TAG_HELLO_PKT_NB, L2D5TAG_HELLO_PKT_RM, L2D5TAG_TCP_DATA_DC,
+                                  L2D5TAG_TCP_DATA_RM };
+  L2D5Frame_t *l = (L2D5Frame_t *)f->Payload;
+  uint64_t r = rng();
+  f->SFD = r % 16 == 0 ? (uint8_t)(r >> 8) : MAGIC_L2LAYER_SFD;
+  f->EFD = r % 16 == 1 ? (uint8_t)(r >> 16) : MAGIC_L2LAYER_EFD;
+  l->TAG = r % 8 == 2 ? (uint8_t)(r >> 24) : tags[(r >> 32) % 4];
+  l->FLAG = (uint8_t)(r >> 40);
+}
+
+/* Expected result from L2D5Cls_frame(); returns mismatching fields */
+static int verify(const L2Frame *const *frames, size_t n, const L2D5ClassBatch_t *b) {
+  int bad = 0;
+  uint8_t count[L2D5CLS_CLASSES] = {0};
+  for (size_t i = 0; i < n; i++) {
+    uint8_t pri;
+    L2D5Class_t c = L2D5Cls_frame(frames[i], &pri);
+    uint8_t tag = ((const L2D5Frame_t *)frames[i]->Payload)->TAG;
+    bad += b->cls[i] != c;
+    bad += b->pri[i] != pri;
+    bad += !(b->mask[c] >> i & 1);
+    bad += count[c] >= b->count[c] || b->idx[c][count[c]] != i;
+    bad += (b->encrypted >> i & 1) != ((tag & L2D5CLS_TAG_ENCRYPTED) != 0);
+    bad += (b->forward >> i & 1) != ((tag & L2D5CLS_TAG_FORWARD) != 0);
+    count[c]++;
+  }
+  uint32_t all = 0;
+  for (int c = 0; c < L2D5CLS_CLASSES; c++) {
+    bad += b->count[c] != count[c];
+    bad += (all & b->mask[c]) != 0;
+    all |= b->mask[c];
+  }
+  bad += n < 32 && (all >> n) != 0;
+  bad += n < 32 && ((b->encrypted | b->forward) >> n) != 0;
+  return bad;
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  L2Frame *frames = aligned_alloc(64, sizeof(L2Frame) * NFRAMES);
+  const L2Frame **ptrs = malloc(sizeof(*ptrs) * NFRAMES);
+  if (frames == NULL || ptrs == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < NFRAMES; i++) {
+    make_frame(&frames[i]);
+    ptrs[i] = &frames[(i * 2654435761u) % NFRAMES];   // scattered, like pool buffers
+  }
+
+  /* every batch size, both entry points */
+  L2D5ClassBatch_t b;
+  int bad = 0, bad_contig = 0;
+  for (int r = 0; r < 200; r++) {
+    for (size_t n = 0; n <= L2D5CLS_MAX; n++) {
+      size_t o = rng() % (NFRAMES - L2D5CLS_MAX);
+      L2D5Cls_batch(ptrs + o, n, &b);
+      bad += verify(ptrs + o, n, &b);
+      const L2Frame *run[L2D5CLS_MAX];
+      for (size_t i = 0; i < n; i++) {
+        run[i] = &frames[o + i];
+      }
+      L2D5Cls_batch_contig(frames + o, n, &b);
+      bad_contig += verify(run, n, &b);
+    }
+  }
+  CHECK(bad == 0, "batch matches L2D5Cls_frame");
+  CHECK(bad_contig == 0, "contiguous batch matches L2D5Cls_frame");
+
+  /* every TAG byte value, SFD / EFD broken one at a time */
+  L2Frame crafted[L2D5CLS_MAX];
+  const L2Frame *cp[L2D5CLS_MAX];
+  bad = 0;
+  for (int t = 0; t < 256; t += L2D5CLS_MAX) {
+    for (int i = 0; i < L2D5CLS_MAX; i++) {
+      memset(&crafted[i], 0, sizeof(L2Frame));
+      crafted[i].SFD = i % 5 == 3 ? 0x00 : MAGIC_L2LAYER_SFD;
+      crafted[i].EFD = i % 7 == 4 ? 0xFE : MAGIC_L2LAYER_EFD;
+      ((L2D5Frame_t *)crafted[i].Payload)->TAG = (uint8_t)(t + i);
+      ((L2D5Frame_t *)crafted[i].Payload)->FLAG = (uint8_t)(t + i * 7);
+      cp[i] = &crafted[i];
+    }
+    L2D5Cls_batch(cp, L2D5CLS_MAX, &b);
+    bad += verify(cp, L2D5CLS_MAX, &b);
+  }
+  CHECK(bad == 0, "every TAG value");
+
+  L2D5Frame_t *l0 = (L2D5Frame_t *)crafted[0].Payload;
+  crafted[0].SFD = MAGIC_L2LAYER_SFD;
+  crafted[0].EFD = MAGIC_L2LAYER_EFD;
+  l0->TAG = L2D5TAG_TCP_DATA_RM;
+  l0->FLAG = L2D5FLAG_MKFLAG(11, L2D5FLAG_ERR_WARN, L2D5FLAG_NUL_D);
+  L2D5Cls_batch(cp, 1, &b);
+  CHECK(b.count[L2D5CLS_DATA_RM] == 1 && b.pri[0] == 11 && b.encrypted == 1 && b.forward == 1,
+        "TCP_DATA_RM: encrypted, forward, PRI 11");
+  l0->TAG = L2D5TAG_HELLO_PKT_NB;
+  L2D5Cls_batch(cp, 1, &b);
+  CHECK(b.count[L2D5CLS_HELLO_NB] == 1 && b.encrypted == 0 && b.forward == 0, "HELLO_PKT_NB: plain");
+
+  /* cost: per-frame switch (what DISPATCH did) vs batch */
+  enum { ROUNDS = 400 };
+  volatile uint32_t sink = 0;
+  double t0 = now_sec();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (size_t o = 0; o < NFRAMES; o += L2D5CLS_MAX) {
+      uint8_t cnt[L2D5CLS_CLASSES] = {0}, idx[L2D5CLS_CLASSES][L2D5CLS_MAX];
+      for (size_t i = 0; i < L2D5CLS_MAX; i++) {
+        uint8_t pri;
+        L2D5Class_t c = L2D5Cls_frame(ptrs[o + i], &pri);
+        idx[c][cnt[c]++] = (uint8_t)i;
+        sink += pri;
+      }
+      sink += cnt[L2D5CLS_DATA_RM] + idx[0][0];
+    }
+  }
+  double scalar = (now_sec() - t0) / ((double)ROUNDS * NFRAMES) * 1e9;
+  t0 = now_sec();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (size_t o = 0; o < NFRAMES; o += L2D5CLS_MAX) {
+      L2D5Cls_batch(ptrs + o, L2D5CLS_MAX, &b);
+      sink += b.count[L2D5CLS_DATA_RM] + b.pri[0];
+    }
+  }
+  double batch = (now_sec() - t0) / ((double)ROUNDS * NFRAMES) * 1e9;
+  printf("Classify, batches of %d scattered frames: per-frame switch %.2f ns/frame, batch %.2f ns/frame\n",
+         L2D5CLS_MAX, scalar, batch);
+
+  free(frames);
+  free(ptrs);
+  printf("\nORBIT L2.5 Batch Frame Classifier Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
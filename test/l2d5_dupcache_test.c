@@ -0,0 +1,141 @@
+/*
+ * File:        test/l2d5_dupcache_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Flood Duplicate Cache Test Program.
+ *    Window semantics (new / seen / late / stale), TTL-better copies,
+ *    SEQ wraparound, hold expiry after a SEQ restart, eviction, no false
+ *    duplicates across many sources, and check cost.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/random.h>
+#include <time.h>
+#include "../src/L2D5_dupcache.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NSRC   4096
+#define NBENCH 4000000
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+
+int main() {
+  int fail = 0;
+  static uint8_t src[NSRC][16];
+  if (getrandom(src, sizeof(src), 0) != sizeof(src)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+
+  L2D5DupCache_t c;
+  CHECK(L2D5Dup_init(&c, 64, 1000) == 0, "init");
+
+  /* window */
+  CHECK(L2D5Dup_check(&c, src[0], 100, 3, 0) == L2D5DUP_NEW, "first copy new");
+  CHECK(L2D5Dup_check(&c, src[0], 100, 3, 1) == L2D5DUP_SEEN, "second copy seen");
+  CHECK(L2D5Dup_check(&c, src[0], 101, 3, 2) == L2D5DUP_NEW, "next SEQ new");
+  CHECK(L2D5Dup_check(&c, src[0], 110, 3, 3) == L2D5DUP_NEW, "SEQ jump new");
+  CHECK(L2D5Dup_check(&c, src[0], 105, 3, 4) == L2D5DUP_NEW, "late unseen SEQ new");
+  CHECK(L2D5Dup_check(&c, src[0], 105, 3, 5) == L2D5DUP_SEEN, "late SEQ seen after");
+  CHECK(L2D5Dup_check(&c, src[0], 101, 3, 6) == L2D5DUP_SEEN, "older seen SEQ");
+  CHECK(L2D5Dup_check(&c, src[0], 110 - 64, 3, 7) == L2D5DUP_STALE, "behind window stale");
+  CHECK(L2D5Dup_check(&c, src[0], 110 - 63, 3, 8) == L2D5DUP_NEW, "window edge accepted");
+  CHECK(L2D5Dup_check(&c, src[0], 300, 3, 9) == L2D5DUP_NEW, "far jump clears window");
+  CHECK(L2D5Dup_check(&c, src[0], 299, 3, 10) == L2D5DUP_NEW, "after far jump, older unseen");
+  CHECK(L2D5Dup_check(&c, src[0], 110, 3, 11) == L2D5DUP_STALE, "after far jump, old stale");
+
+  /* TTL-better copy of the newest SEQ, once */
+  CHECK(L2D5Dup_check(&c, src[1], 7, 1, 0) == L2D5DUP_NEW, "long-way copy new");
+  CHECK(L2D5Dup_check(&c, src[1], 7, 2, 1) == L2D5DUP_BETTER, "shorter copy better");
+  CHECK(L2D5Dup_check(&c, src[1], 7, 2, 2) == L2D5DUP_SEEN, "shorter copy again seen");
+  CHECK(L2D5Dup_check(&c, src[1], 7, 1, 3) == L2D5DUP_SEEN, "long copy again seen");
+  CHECK(L2D5Dup_forward(L2D5DUP_BETTER) && !L2D5Dup_forward(L2D5DUP_SEEN), "forward helper");
+
+  /* wraparound */
+  CHECK(L2D5Dup_check(&c, src[2], 0xFFF0, 3, 0) == L2D5DUP_NEW, "near wrap new");
+  for (uint32_t s = 0xFFF1; s <= 0x1000F; s++) {
+    if (L2D5Dup_check(&c, src[2], (uint16_t)s, 3, 1) != L2D5DUP_NEW) {
+      CHECK(0, "SEQ across wrap new");
+      break;
+    }
+  }
+  CHECK(L2D5Dup_check(&c, src[2], 0xFFFE, 3, 2) == L2D5DUP_SEEN, "pre-wrap SEQ seen after wrap");
+  CHECK(L2D5Dup_check(&c, src[2], 0x0003, 3, 2) == L2D5DUP_SEEN, "post-wrap SEQ seen");
+  CHECK(L2D5Dup_check(&c, src[2], 0xFF00, 3, 2) == L2D5DUP_STALE, "pre-wrap old SEQ stale");
+
+  /* restarted source: stale until the hold expires */
+  CHECK(L2D5Dup_check(&c, src[3], 5000, 3, 0) == L2D5DUP_NEW, "before restart");
+  CHECK(L2D5Dup_check(&c, src[3], 1, 3, 500) == L2D5DUP_STALE, "restart within hold stale");
+  CHECK(L2D5Dup_check(&c, src[3], 2, 3, 900) == L2D5DUP_STALE, "stale does not refresh");
+  CHECK(L2D5Dup_check(&c, src[3], 3, 3, 1001) == L2D5DUP_NEW, "restart after hold new");
+  CHECK(L2D5Dup_check(&c, src[3], 3, 3, 1002) == L2D5DUP_SEEN, "restart tracked");
+
+  /* HELLO_PKT_RM frame helper */
+  L2D5Frame_t f;
+  memset(&f, 0, sizeof(f));
+  f.TAG = L2D5TAG_HELLO_PKT_RM;
+  L2D5Routing_HelloPkt_t *h = (L2D5Routing_HelloPkt_t *)f.Payload;
+  memcpy(h->NodeSrcAddr, src[4], 16);
+  ORBIT_store_be16(h->SEQ, 42);
+  ORBIT_store_be16(f.TTL, 2);
+  CHECK(L2D5Dup_check_hello(&c, &f, 0) == L2D5DUP_NEW, "hello new");
+  CHECK(L2D5Dup_check_hello(&c, &f, 0) == L2D5DUP_SEEN, "hello seen");
+  L2D5Dup_free(&c);
+
+  /* capacity: every source fits, no false duplicates */
+  CHECK(L2D5Dup_init(&c, NSRC, UINT64_MAX) == 0, "init large");
+  int false_dup = 0, missed = 0;
+  for (int i = 0; i < NSRC; i++) {
+    false_dup += L2D5Dup_check(&c, src[i], 1, 3, (uint64_t)i) != L2D5DUP_NEW;
+  }
+  for (int i = 0; i < NSRC; i++) {
+    missed += L2D5Dup_check(&c, src[i], 1, 3, NSRC) != L2D5DUP_SEEN;
+  }
+  printf("%d sources in %zu bytes: %d false duplicates, %d missed (%llu evictions)\n", NSRC, L2D5Dup_bytes(&c),
+         false_dup, missed, (unsigned long long)c.evictions);
+  CHECK(false_dup == 0, "no false duplicates");
+  CHECK(missed <= NSRC / 50, "almost every source remembered");
+  L2D5Dup_free(&c);
+
+  /* eviction fails open: least recently refreshed source goes first */
+  CHECK(L2D5Dup_init(&c, 8, UINT64_MAX) == 0, "init tiny");
+  for (int i = 0; i < 64; i++) {
+    L2D5Dup_check(&c, src[i], 1, 3, (uint64_t)i);
+  }
+  CHECK(c.evictions >= 64 - 16, "evictions counted");
+  CHECK(L2D5Dup_check(&c, src[63], 1, 3, 64) == L2D5DUP_SEEN, "newest kept");
+  CHECK(L2D5Dup_check(&c, src[0], 1, 3, 65) == L2D5DUP_NEW, "oldest evicted, relayed again");
+  L2D5Dup_free(&c);
+
+  /* cost: a relay hearing each flood from ~8 neighbors */
+  CHECK(L2D5Dup_init(&c, NSRC, UINT64_MAX) == 0, "init bench");
+  uint64_t forward = 0;
+  double t0 = now_sec();
+  for (uint32_t i = 0; i < NBENCH; i++) {
+    uint32_t s = L2D5ADDR_mix32(i >> 3) % NSRC;
+    forward += L2D5Dup_forward(L2D5Dup_check(&c, src[s], (uint16_t)(i >> 15), 3, i));
+  }
+  double dt = now_sec() - t0;
+  printf("check: %.1f ns, %llu of %d copies relayed\n", dt * 1e9 / NBENCH, (unsigned long long)forward, NBENCH);
+  CHECK(forward < NBENCH / 4, "most copies suppressed");
+  L2D5Dup_free(&c);
+
+  printf("\nORBIT L2.5 Flood Duplicate Cache Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
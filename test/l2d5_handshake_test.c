@@ -0,0 +1,249 @@
+/*
+ * File:        test/l2d5_handshake_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Handshake Worker Pool Test Program.
+ *    SharedKeys match the peer's side, repeat HELLOs deduplicated, key
+ *    change / neighbor removal while in progress, bad keys, full pool,
+ *    and join time (every neighbor keyed) on one thread vs the pool.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - Build with -pthread and link -lcrypto.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2D5_handshake.h"
+#include <sys/random.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NNODES 256
+
+
+static uint8_t self_sk[32], self_pk[32];
+static uint8_t node_sk[NNODES][32], node_pk[NNODES][32], node_addr[NNODES][16];
+
+
+static void rand_bytes(void *buf, size_t len) {
+  if (getrandom(buf, len, 0) != (ssize_t)len) {
+    perror("getrandom failed");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Poll until nothing is in flight; false on timeout */
+static bool drain(L2D5Hs_t *h) {
+  double t0 = now_sec();
+  while (L2D5Hs_pending(h) != 0) {
+    L2D5Hs_poll(h);
+    if (now_sec() - t0 > 30.0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Neighbor i heard with PublicKey _pk */
+static uint32_t hello(L2D5NeighborTable_t *nb, int i, const uint8_t *pk) {
+  return L2D5Neighbor_observe(nb, node_addr[i], pk, 1, -50, NULL);
+}
+
+/* Every neighbor keyed, what the peer computed on its side */
+static int check_keys(L2D5NeighborTable_t *nb, L2D5KeyCache_t *keys, int n) {
+  int bad = 0;
+  for (int i = 0; i < n; i++) {
+    uint8_t shared[32], hint[4];
+    uint32_t slot = L2D5Neighbor_find(nb, node_addr[i]);
+    if (slot == L2D5NB_NIL || !nb->has_shared[slot] || L2D5Hs_agree(node_sk[i], self_pk, shared) != 0 ||
+        memcmp(nb->keys[slot].SharedKey, shared, 32) != 0) {
+      bad++;
+      continue;
+    }
+    L2D5Key_derive_hint(shared, hint);
+    L2D5Session_t *s = keys != NULL ? L2D5KeyCache_find(keys, node_addr[i]) : NULL;
+    if (keys != NULL && (s == NULL || s->hint != L2D5Key_hint_load(hint))) {
+      bad++;
+    }
+  }
+  return bad;
+}
+
+/* Join time: submit every neighbor, poll until all keyed */
+static double join_pool(uint32_t workers) {
+  L2D5NeighborTable_t nb;
+  L2D5Hs_t h;
+  L2D5Neighbor_init(&nb, NNODES * 2);
+  for (int i = 0; i < NNODES; i++) {
+    hello(&nb, i, node_pk[i]);
+  }
+  if (L2D5Hs_init(&h, &nb, NULL, self_sk, workers, NNODES, NULL) != 0) {
+    printf("L2D5Hs_init failed\n");
+    exit(EXIT_FAILURE);
+  }
+  double t0 = now_sec();
+  for (int i = 0; i < NNODES; i++) {
+    L2D5Hs_submit(&h, L2D5Neighbor_find(&nb, node_addr[i]));
+  }
+  drain(&h);
+  double sec = now_sec() - t0;
+  L2D5Hs_free(&h);
+  L2D5Neighbor_free(&nb);
+  return sec;
+}
+
+/* The same on the calling thread, one HELLO at a time */
+static double join_inline(void) {
+  L2D5NeighborTable_t nb;
+  L2D5Neighbor_init(&nb, NNODES * 2);
+  double t0 = now_sec();
+  for (int i = 0; i < NNODES; i++) {
+    uint8_t shared[32], key[32], iv[16], hint[4];
+    uint32_t slot = hello(&nb, i, node_pk[i]);
+    L2D5Hs_agree(self_sk, node_pk[i], shared);
+    L2D5Key_derive(shared, key, iv);
+    L2D5Key_derive_hint(shared, hint);
+    L2D5Neighbor_set_shared(&nb, slot, shared);
+  }
+  double sec = now_sec() - t0;
+  L2D5Neighbor_free(&nb);
+  return sec;
+}
+
+
+int main() {
+  int fail = 0;
+
+  rand_bytes(self_sk, sizeof(self_sk));
+  rand_bytes(node_sk, sizeof(node_sk));
+  rand_bytes(node_addr, sizeof(node_addr));
+  if (L2D5Hs_public(self_sk, self_pk) != 0) {
+    printf("L2D5Hs_public failed\n");
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < NNODES; i++) {
+    L2D5Hs_public(node_sk[i], node_pk[i]);
+  }
+
+  /* X25519 is symmetric */
+  uint8_t ab[32], ba[32];
+  CHECK(L2D5Hs_agree(self_sk, node_pk[0], ab) == 0 && L2D5Hs_agree(node_sk[0], self_pk, ba) == 0 &&
+        memcmp(ab, ba, 32) == 0, "agree symmetric");
+
+  L2D5NeighborTable_t nb;
+  L2D5KeyCache_t keys;
+  L2D5Hs_t h;
+  if (L2D5Neighbor_init(&nb, NNODES * 2) != 0 || L2D5KeyCache_init(&keys, NNODES * 2) != 0 ||
+      L2D5Hs_init(&h, &nb, &keys, self_sk, 4, 0, NULL) != 0) {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+
+  /* every HELLO repeated 4 times before any result is polled */
+  int queued = 0, dups = 0;
+  for (int r = 0; r < 4; r++) {
+    for (int i = 0; i < NNODES; i++) {
+      L2D5HsSubmit_t rc = L2D5Hs_submit(&h, hello(&nb, i, node_pk[i]));
+      queued += rc == L2D5HS_QUEUED;
+      dups += rc == L2D5HS_DUP;
+    }
+  }
+  CHECK(queued == NNODES && dups == 3 * NNODES, "repeat HELLOs deduplicated");
+  CHECK(drain(&h), "drain");
+  CHECK(h.installed == NNODES, "installed");
+  CHECK(check_keys(&nb, &keys, NNODES) == 0, "SharedKey and session match the peer");
+  CHECK(L2D5Hs_submit(&h, L2D5Neighbor_find(&nb, node_addr[0])) == L2D5HS_HAVE, "keyed neighbor not redone");
+  uint64_t done = 0;
+  for (uint32_t w = 0; w < h.nworkers; w++) {
+    done += atomic_load(&h.worker[w].done);
+  }
+  CHECK(done == NNODES, "one X25519 per neighbor");
+
+  /* neighbor 1 announces a new key while its handshake runs */
+  uint8_t sk2[32], pk2[32];
+  rand_bytes(sk2, sizeof(sk2));
+  L2D5Hs_public(sk2, pk2);
+  L2D5Neighbor_remove(&nb, L2D5Neighbor_find(&nb, node_addr[1]));
+  CHECK(L2D5Hs_submit(&h, hello(&nb, 1, node_pk[1])) == L2D5HS_QUEUED, "rejoin queued");
+  CHECK(L2D5Hs_submit(&h, hello(&nb, 1, pk2)) == L2D5HS_QUEUED, "new key supersedes");
+  CHECK(L2D5Hs_submit(&h, hello(&nb, 1, pk2)) == L2D5HS_DUP, "new key deduplicated");
+  uint64_t sup = h.superseded;
+  CHECK(drain(&h), "drain");
+  uint32_t s1 = L2D5Neighbor_find(&nb, node_addr[1]);
+  uint8_t want[32];
+  L2D5Hs_agree(sk2, self_pk, want);
+  CHECK(nb.has_shared[s1] && memcmp(nb.keys[s1].SharedKey, want, 32) == 0, "newest key wins");
+  CHECK(h.superseded == sup + 1, "old result dropped");
+
+  /* neighbor removed while in progress: result dropped, slot untouched */
+  L2D5Neighbor_remove(&nb, L2D5Neighbor_find(&nb, node_addr[2]));
+  L2D5Hs_submit(&h, hello(&nb, 2, node_pk[2]));
+  L2D5Neighbor_remove(&nb, L2D5Neighbor_find(&nb, node_addr[2]));
+  sup = h.superseded;
+  CHECK(drain(&h), "drain");
+  CHECK(h.superseded == sup + 1 && L2D5Neighbor_find(&nb, node_addr[2]) == L2D5NB_NIL, "removed neighbor dropped");
+
+  /* a low-order peer key gives an all-zero secret and is refused */
+  static const uint8_t zero[32] = {0};
+  L2D5Neighbor_remove(&nb, L2D5Neighbor_find(&nb, node_addr[3]));
+  L2D5Hs_submit(&h, hello(&nb, 3, zero));
+  CHECK(drain(&h), "drain");
+  CHECK(h.failed == 1 && !nb.has_shared[L2D5Neighbor_find(&nb, node_addr[3])], "bad key refused");
+
+  L2D5Hs_free(&h);
+  L2D5KeyCache_free(&keys);
+  L2D5Neighbor_free(&nb);
+
+  /* bounded job table */
+  L2D5Neighbor_init(&nb, NNODES * 2);
+  L2D5Hs_init(&h, &nb, NULL, self_sk, 2, 8, NULL);
+  int full = 0;
+  for (int i = 0; i < 20; i++) {
+    full += L2D5Hs_submit(&h, hello(&nb, i, node_pk[i])) == L2D5HS_FULL;
+  }
+  CHECK(full == 12 && L2D5Hs_pending(&h) == 8, "full pool refuses");
+  CHECK(drain(&h), "drain");
+  for (int r = 0; r < 3 && full != 0; r++) {
+    full = 0;
+    for (int i = 0; i < 20; i++) {
+      full += L2D5Hs_submit(&h, L2D5Neighbor_find(&nb, node_addr[i])) == L2D5HS_FULL;
+    }
+    CHECK(drain(&h), "drain");
+  }
+  CHECK(check_keys(&nb, NULL, 20) == 0, "retried on the next HELLOs");
+  L2D5Hs_free(&h);
+  L2D5Neighbor_free(&nb);
+
+  /* join time */
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  printf("Join, %d neighbors (X25519 + SHA-384 + KeyHint each), %ld CPUs:\n", NNODES, cpus);
+  double base = join_inline();
+  printf("  %-16s %8.2f ms  %8.0f neighbors/s\n", "inline", base * 1e3, NNODES / base);
+  uint32_t counts[] = { 1, 2, 4, (uint32_t)(cpus > 0 && cpus < L2D5HS_MAX_WORKERS ? cpus : 1) };
+  for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+    if (k == 3 && counts[3] <= 4) {
+      break;
+    }
+    double sec = join_pool(counts[k]);
+    char name[32];
+    snprintf(name, sizeof(name), "pool, %u worker%s", counts[k], counts[k] > 1 ? "s" : "");
+    printf("  %-16s %8.2f ms  %8.0f neighbors/s  x%.2f\n", name, sec * 1e3, NNODES / sec, base / sec);
+  }
+
+  printf("\nORBIT L2.5 Handshake Worker Pool Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/*
+ * File:        test/l2d5_keycache_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Session Key Cache Test Program.
+ *    Round trip, KeyHint collisions, LRU eviction, PublicKey change, and
+ *    per-frame cost vs deriving the key for every frame.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2D5_keycache.h"
+#include <sys/random.h>
+#include <openssl/evp.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+
+
+static void rand_bytes(void *buf, size_t len) {
+  if (getrandom(buf, len, 0) != (ssize_t)len) {
+    perror("getrandom failed");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Old per-frame path: derive + fresh context every time */
+static void reference_encrypt(const uint8_t *shared, const L2D5Frame_t *in, uint8_t *out) {
+  uint8_t key[32], iv[16];
+  int l1 = 0, l2 = 0;
+  L2D5Key_derive(shared, key, iv);
+  EVP_CIPHER *cbc_cts = EVP_CIPHER_fetch(NULL, "AES-256-CBC-CTS", NULL);
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  EVP_EncryptInit_ex(ctx, cbc_cts, NULL, key, iv);
+  EVP_EncryptUpdate(ctx, out, &l1, (const uint8_t *)in + 6, 210);
+  EVP_EncryptFinal_ex(ctx, out + l1, &l2);
+  EVP_CIPHER_CTX_free(ctx);
+  EVP_CIPHER_free(cbc_cts);
+}
+
+static void make_frame(L2D5Frame_t *f, const uint8_t *src) {
+  rand_bytes(f, sizeof(*f));
+  f->TAG = L2D5TAG_TCP_DATA_DC;
+  f->FLAG = L2D5FLAG_MKFLAG(5, L2D5FLAG_ERR_NML, L2D5FLAG_NUL_A);
+  memcpy(f->SrcAddress, src, 16);
+}
+
+
+int main() {
+  int fail = 0;
+  L2D5KeyCache_t cache;
+  if (L2D5KeyCache_init(&cache, 4) != 0) {
+    printf("L2D5KeyCache_init failed\n");
+    return EXIT_FAILURE;
+  }
+
+  /* round trip and compatibility with the one-shot OpenSSL path */
+  uint8_t addr[6][16], pub[6][32], shared[6][32];
+  rand_bytes(addr, sizeof(addr));
+  rand_bytes(pub, sizeof(pub));
+  rand_bytes(shared, sizeof(shared));
+
+  L2D5Session_t *s0 = L2D5KeyCache_install(&cache, addr[0], pub[0], shared[0]);
+  CHECK(s0 != NULL, "install");
+
+  L2D5Frame_t plain, back;
+  L2D5Frame_Encrypted_t enc;
+  uint8_t ref[210];
+  make_frame(&plain, addr[0]);
+  CHECK(L2D5KeyCache_encrypt(&cache, s0, &plain, &enc) == 0, "encrypt");
+  reference_encrypt(shared[0], &plain, ref);
+  CHECK(memcmp(enc.EncryptedPayload, ref, 210) == 0, "ciphertext differs from one-shot AES-256-CBC-CTS");
+  uint8_t hint[4];
+  L2D5Key_derive_hint(shared[0], hint);
+  CHECK(memcmp(enc.KeyHint, hint, 4) == 0, "KeyHint");
+  CHECK(L2D5KeyCache_decrypt(&cache, &enc, &back) == s0, "decrypt session");
+  CHECK(memcmp(back.SrcAddress, plain.SrcAddress, 210) == 0, "decrypt payload");
+  CHECK(back.TAG == plain.TAG && back.FLAG == plain.FLAG, "decrypt header");
+
+  /* forced KeyHint collision: two sessions, one hint, address decides */
+  uint8_t k1[32], k2[32], iv[16];
+  rand_bytes(k1, 32);
+  rand_bytes(k2, 32);
+  rand_bytes(iv, 16);
+  L2D5Session_t *c1 = L2D5KeyCache_install_keys(&cache, addr[1], pub[1], k1, iv, 0xABCD1234u);
+  L2D5Session_t *c2 = L2D5KeyCache_install_keys(&cache, addr[2], pub[2], k2, iv, 0xABCD1234u);
+  make_frame(&plain, addr[2]);
+  L2D5KeyCache_encrypt(&cache, c2, &plain, &enc);
+  CHECK(L2D5KeyCache_decrypt(&cache, &enc, &back) == c2, "collision resolved by address");
+  CHECK(memcmp(back.SrcAddress, plain.SrcAddress, 210) == 0, "collision payload");
+  make_frame(&plain, addr[1]);
+  L2D5KeyCache_encrypt(&cache, c1, &plain, &enc);
+  CHECK(L2D5KeyCache_decrypt(&cache, &enc, &back) == c1, "collision resolved by address (2)");
+  printf("Hint collisions resolved: %llu\n", (unsigned long long)cache.collisions);
+
+  /* relayed (TAG FORWARD): SrcAddress is the originator, the hint names the previous hop */
+  make_frame(&plain, addr[5]);
+  plain.TAG = L2D5TAG_TCP_DATA_RM;
+  L2D5KeyCache_encrypt(&cache, s0, &plain, &enc);
+  CHECK(L2D5KeyCache_decrypt(&cache, &enc, &back) == s0, "relayed frame: sole hint session");
+  CHECK(memcmp(back.SrcAddress, plain.SrcAddress, 210) == 0, "relayed frame: originator kept");
+  const L2D5Frame_Encrypted_t *rin = &enc;
+  L2D5Frame_t *rout = &back;
+  L2D5Session_t *rs = NULL;
+  CHECK(L2D5KeyCache_decrypt_batch(&cache, &rin, &rout, &rs, 1) == 1 && rs == s0, "relayed frame: batch");
+  L2D5KeyCache_encrypt(&cache, c1, &plain, &enc);
+  CHECK(L2D5KeyCache_decrypt(&cache, &enc, &back) == NULL, "relayed frame: shared hint dropped");
+  plain.TAG = L2D5TAG_TCP_DATA_DC;
+  L2D5KeyCache_encrypt(&cache, s0, &plain, &enc);
+  CHECK(L2D5KeyCache_decrypt(&cache, &enc, &back) == NULL, "direct frame: foreign SrcAddress dropped");
+
+  /* LRU: capacity 4 holds addr[0..3]; after touching 0 and 1, addr[2] is oldest */
+  L2D5KeyCache_install(&cache, addr[3], pub[3], shared[3]);
+  L2D5KeyCache_encrypt(&cache, L2D5KeyCache_find(&cache, addr[0]), &plain, &enc);
+  L2D5KeyCache_encrypt(&cache, L2D5KeyCache_find(&cache, addr[1]), &plain, &enc);
+  L2D5KeyCache_install(&cache, addr[4], pub[4], shared[4]);
+  CHECK(L2D5KeyCache_find(&cache, addr[2]) == NULL, "LRU victim evicted");
+  CHECK(L2D5KeyCache_find(&cache, addr[0]) != NULL, "recently used kept");
+  CHECK(cache.count == 4 && cache.evictions == 1, "eviction count");
+
+  /* PublicKey change in a new HELLO drops the session */
+  CHECK(L2D5KeyCache_observe_pubkey(&cache, addr[3], pub[3]) == 0, "same key kept");
+  CHECK(L2D5KeyCache_observe_pubkey(&cache, addr[3], pub[5]) == 1, "changed key dropped");
+  CHECK(L2D5KeyCache_find(&cache, addr[3]) == NULL, "dropped session gone");
+
+  /* cost per frame: cached context vs derive + new context */
+  enum { ROUNDS = 100000 };
+  L2D5Session_t *s = L2D5KeyCache_find(&cache, addr[0]);
+  make_frame(&plain, addr[0]);
+  L2D5KeyCache_encrypt(&cache, s, &plain, &enc);
+  double t0 = now_sec();
+  for (int i = 0; i < ROUNDS; i++) {
+    L2D5KeyCache_decrypt(&cache, &enc, &back);
+  }
+  double cached = (now_sec() - t0) / ROUNDS * 1e9;
+  t0 = now_sec();
+  for (int i = 0; i < ROUNDS; i++) {
+    reference_encrypt(shared[0], &plain, ref);
+  }
+  double uncached = (now_sec() - t0) / ROUNDS * 1e9;
+  printf("Cached decrypt:        %8.1f ns/frame\n", cached);
+  printf("Derive + new ctx:      %8.1f ns/frame (without X25519)\n", uncached);
+
+  L2D5KeyCache_free(&cache);
+  printf("\nORBIT L2.5 Session Key Cache Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
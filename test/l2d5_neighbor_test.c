@@ -0,0 +1,220 @@
+/*
+ * File:        test/l2d5_neighbor_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Neighbor Table Test Program.
+ *    Insert / find / remove churn against a plain array of packed
+ *    L2D5Routing_NeighborTable_t records, and lookup cost of both.
+ *    Long insert / remove churn at half load: tombstones are reused and
+ *    rehashed in place, no insert fails, pinned slots never move.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2D5_neighbor.h"
+#include "../src/ORBIT_bytes.h"
+#include <sys/random.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NNODES 512
+#define CHURN_CAP   256
+#define CHURN_LIVE  128
+#define CHURN_POOL  4096
+#define CHURN_OPS   2000000
+#define CHURN_PIN   8
+
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* The layout this replaces: packed records, linear scan */
+static int linear_find(const L2D5Routing_NeighborTable_t *recs, int n, const uint8_t *addr) {
+  for (int i = 0; i < n; i++) {
+    if (memcmp(recs[i].NodeAddr, addr, 16) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+int main() {
+  int fail = 0;
+  static uint8_t addr[NNODES][16], pub[NNODES][32];
+  static L2D5Routing_NeighborTable_t recs[NNODES];
+  if (getrandom(addr, sizeof(addr), 0) != sizeof(addr) || getrandom(pub, sizeof(pub), 0) != sizeof(pub)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  L2D5NeighborTable_t t;
+  if (L2D5Neighbor_init(&t, NNODES + NNODES / 4) != 0) {
+    printf("L2D5Neighbor_init failed\n");
+    return EXIT_FAILURE;
+  }
+  printf("Capacity: %u slots (%u groups)\n", t.capacity, t.group_mask + 1);
+
+  for (int i = 0; i < NNODES; i++) {
+    unsigned flags = 0;
+    uint32_t slot = L2D5Neighbor_observe(&t, addr[i], pub[i], 1000 + i, -40 - i % 60, &flags);
+    CHECK(slot != L2D5NB_NIL && (flags & L2D5NB_OBS_NEW), "observe new");
+    memcpy(recs[i].NodeAddr, addr[i], 16);
+  }
+  CHECK(t.count == NNODES, "count");
+  for (int i = 0; i < NNODES; i++) {
+    uint32_t slot = L2D5Neighbor_find(&t, addr[i]);
+    CHECK(slot != L2D5NB_NIL && L2D5ADDR_equal(t.addr[slot], addr[i]), "find");
+    CHECK(t.last_seen[slot] == (uint64_t)(1000 + i), "last_seen");
+  }
+
+  /* refs survive unrelated churn, die with their slot */
+  uint32_t s7 = L2D5Neighbor_find(&t, addr[7]);
+  L2D5NeighborRef_t r7 = L2D5Neighbor_ref(&t, s7);
+  for (int i = 0; i < NNODES; i += 2) {
+    L2D5Neighbor_remove(&t, L2D5Neighbor_find(&t, addr[i]));
+  }
+  CHECK(L2D5Neighbor_ref_valid(&t, r7) && L2D5Neighbor_find(&t, addr[7]) == s7, "slot stable under churn");
+  for (int i = 0; i < NNODES; i++) {
+    CHECK((L2D5Neighbor_find(&t, addr[i]) == L2D5NB_NIL) == (i % 2 == 0), "find after remove");
+  }
+  L2D5Neighbor_remove(&t, s7);
+  CHECK(!L2D5Neighbor_ref_valid(&t, r7), "ref invalid after remove");
+  for (int i = 0; i < NNODES; i += 2) {
+    CHECK(L2D5Neighbor_insert(&t, addr[i], NULL) != L2D5NB_NIL, "reinsert");
+  }
+  CHECK(t.count == NNODES - NNODES / 2 + NNODES / 2 - 1, "count after churn");
+
+  /* key change */
+  unsigned flags = 0;
+  uint32_t s1 = L2D5Neighbor_find(&t, addr[1]);
+  L2D5Neighbor_set_shared(&t, s1, pub[2]);
+  L2D5Neighbor_observe(&t, addr[1], pub[1], 5000, -50, &flags);
+  CHECK(flags == 0 && t.has_shared[s1], "same key");
+  L2D5Neighbor_observe(&t, addr[1], pub[3], 5001, -51, &flags);
+  CHECK(flags == L2D5NB_OBS_KEY_CHANGED && !t.has_shared[s1], "key changed");
+
+  /* export / import round trip */
+  L2D5Routing_NeighborTable_t rec;
+  L2D5Neighbor_export(&t, s1, &rec);
+  CHECK(ORBIT_load_be64(rec.last_seen_time) == 5001 && (int32_t)ORBIT_load_be32(rec.last_rssi) == -51, "export fields");
+  L2D5NeighborTable_t t2;
+  L2D5Neighbor_init(&t2, 16);
+  uint32_t s2 = L2D5Neighbor_import(&t2, &rec);
+  CHECK(s2 != L2D5NB_NIL && t2.last_rssi[s2] == -51 && memcmp(t2.keys[s2].PublicKey, pub[3], 32) == 0, "import");
+  L2D5Neighbor_free(&t2);
+
+  /* iteration visits every neighbor once */
+  uint32_t seen = 0;
+  for (uint32_t s = L2D5Neighbor_next(&t, 0); s != L2D5NB_NIL; s = L2D5Neighbor_next(&t, s + 1)) {
+    seen++;
+  }
+  CHECK(seen == t.count, "iteration");
+
+  double t0;
+  /* churn at half load: CHURN_LIVE of CHURN_CAP, the first CHURN_PIN never removed */
+  static uint8_t caddr[CHURN_POOL][16];
+  static uint32_t live[CHURN_LIVE];
+  static uint8_t in_table[CHURN_POOL];
+  if (getrandom(caddr, sizeof(caddr), 0) != sizeof(caddr)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  L2D5NeighborTable_t ct;
+  L2D5Neighbor_init(&ct, CHURN_CAP);
+  uint32_t pinned[CHURN_PIN];
+  for (uint32_t i = 0; i < CHURN_LIVE; i++) {
+    live[i] = i;
+    in_table[i] = 1;
+    uint32_t slot = L2D5Neighbor_insert(&ct, caddr[i], NULL);
+    if (i < CHURN_PIN) {
+      pinned[i] = slot;
+    }
+  }
+  uint64_t churn_fail = 0;
+  uint32_t max_deleted = 0;
+  t0 = now_sec();
+  for (uint32_t op = 0; op < CHURN_OPS; op++) {
+    uint32_t k = CHURN_PIN + (uint32_t)(rng() % (CHURN_LIVE - CHURN_PIN));
+    L2D5Neighbor_remove(&ct, L2D5Neighbor_find(&ct, caddr[live[k]]));
+    in_table[live[k]] = 0;
+    uint32_t a;
+    do {
+      a = (uint32_t)(rng() % CHURN_POOL);
+    } while (in_table[a]);
+    if (L2D5Neighbor_insert(&ct, caddr[a], NULL) == L2D5NB_NIL) {
+      churn_fail++;
+      a = live[k];                           // keep the live set size
+      L2D5Neighbor_insert(&ct, caddr[a], NULL);
+    }
+    in_table[a] = 1;
+    live[k] = a;
+    max_deleted = ct.deleted > max_deleted ? ct.deleted : max_deleted;
+  }
+  double churn_dt = now_sec() - t0;
+  CHECK(churn_fail == 0, "churn: every insert below the load limit succeeds");
+  CHECK(ct.count == CHURN_LIVE && max_deleted * L2D5NB_PURGE_DIV <= CHURN_CAP + L2D5NB_PURGE_DIV, "churn: tombstones bounded");
+  uint32_t churn_bad = 0;
+  for (uint32_t a = 0; a < CHURN_POOL; a++) {
+    churn_bad += (L2D5Neighbor_find(&ct, caddr[a]) != L2D5NB_NIL) != in_table[a];
+  }
+  for (uint32_t i = 0; i < CHURN_PIN; i++) {
+    churn_bad += L2D5Neighbor_find(&ct, caddr[i]) != pinned[i];
+  }
+  CHECK(churn_bad == 0, "churn: lookups exact, pinned slots unmoved");
+  printf("Churn, %u live / %u slots: %u remove+insert, %llu failed, max %u tombstones, %llu rehashes, %.1f ns/op\n",
+         CHURN_LIVE, ct.capacity, CHURN_OPS, (unsigned long long)churn_fail, max_deleted,
+         (unsigned long long)ct.purges, churn_dt / CHURN_OPS * 1e9);
+  L2D5Neighbor_free(&ct);
+
+  /* lookup cost */
+  L2D5Neighbor_insert(&t, addr[7], NULL);
+  enum { ROUNDS = 200 };
+  volatile uint64_t sink = 0;
+  t0 = now_sec();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < NNODES; i++) {
+      sink += linear_find(recs, NNODES, addr[(i * 37) % NNODES]);
+    }
+  }
+  double lin = (now_sec() - t0) / (ROUNDS * NNODES) * 1e9;
+  t0 = now_sec();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < NNODES; i++) {
+      sink += L2D5Neighbor_find(&t, addr[(i * 37) % NNODES]);
+    }
+  }
+  double hashed = (now_sec() - t0) / (ROUNDS * NNODES) * 1e9;
+  printf("Lookup, %d neighbors: linear scan %.1f ns, SIMD-probed table %.1f ns\n", NNODES, lin, hashed);
+
+  L2D5Neighbor_free(&t);
+  printf("\nORBIT L2.5 Neighbor Table Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/*
+ * File:        test/l2d5_route_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Route Engine Test Program.
+ *    HELLO_PKT_RM driven route selection, neighbor loss re-evaluation,
+ *    SEQ wraparound, export, import next to live HELLO candidates, and
+ *    next-hop lookup cost against a linear
+ *    scan of packed L2D5Routing_RemoteTable_t records.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2D5_route.h"
+#include "../src/ORBIT_bytes.h"
+#include <sys/random.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NNEIGH 16
+#define NDEST  4096
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void make_hello(L2D5Routing_HelloPkt_t *h, const uint8_t *origin, uint16_t seq, uint16_t limit) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->NodeSrcAddr, origin, 16);
+  h->PublicKey[0] = origin[0];
+  ORBIT_store_be16(h->SEQ, seq);
+  ORBIT_store_be16(h->NodesLimit, limit);
+}
+
+/* The layout this replaces: packed records, linear scan, then a neighbor lookup */
+static uint32_t linear_next_hop(const L2D5Routing_RemoteTable_t *recs, int n, const L2D5NeighborTable_t *nb,
+                                const uint8_t *addr) {
+  for (int i = 0; i < n; i++) {
+    if (memcmp(recs[i].NodeAddr, addr, 16) == 0) {
+      return L2D5Neighbor_find(nb, recs[i].NextHopAddr);
+    }
+  }
+  return L2D5NB_NIL;
+}
+
+
+int main() {
+  int fail = 0;
+  static uint8_t nb_addr[NNEIGH][16], dst[NDEST][16];
+  static L2D5Routing_RemoteTable_t recs[NDEST];
+  if (getrandom(nb_addr, sizeof(nb_addr), 0) != sizeof(nb_addr) || getrandom(dst, sizeof(dst), 0) != sizeof(dst)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+
+  L2D5NeighborTable_t nb;
+  L2D5RouteTable_t r;
+  uint32_t nbs[NNEIGH];
+  if (L2D5Neighbor_init(&nb, 64) != 0 || L2D5Route_init(&r, &nb, NDEST + 64) != 0) {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < NNEIGH; i++) {
+    nbs[i] = L2D5Neighbor_observe(&nb, nb_addr[i], NULL, 1, -50, NULL);
+  }
+
+  /* every destination heard via 3 neighbors; neighbor (d % NNEIGH) is shortest */
+  L2D5Routing_HelloPkt_t h;
+  for (int d = 0; d < NDEST; d++) {
+    make_hello(&h, dst[d], 100, 0);
+    for (int k = 0; k < 3; k++) {
+      int via = (d + k) % NNEIGH;
+      CHECK(L2D5Route_hello(&r, &h, nbs[via], (uint16_t)(2 + k), 10 + k, NULL) != L2D5ROUTE_NIL, "hello");
+    }
+  }
+  CHECK(r.count == NDEST, "count");
+  int ok = 1;
+  for (int d = 0; d < NDEST; d++) {
+    ok &= L2D5Route_next_hop(&r, dst[d]) == nbs[d % NNEIGH];
+  }
+  CHECK(ok, "shortest next hop");
+  CHECK(L2D5Route_next_hop(&r, nb_addr[3]) == nbs[3], "direct neighbor");
+
+  /* stale SEQ via the same neighbor is ignored, newer SEQ wins over fewer hops */
+  bool changed = false;
+  make_hello(&h, dst[0], 99, 0);
+  L2D5Route_hello(&r, &h, nbs[1], 1, 20, &changed);
+  CHECK(L2D5Route_next_hop(&r, dst[0]) == nbs[0] && !changed, "stale seq ignored");
+  make_hello(&h, dst[0], 101, 0);
+  L2D5Route_hello(&r, &h, nbs[2], 9, 21, &changed);
+  CHECK(L2D5Route_next_hop(&r, dst[0]) == nbs[2] && changed, "newer seq preferred");
+
+  /* SEQ wraparound: 0x0002 is newer than 0xFFFE */
+  uint8_t wrap[16];
+  memcpy(wrap, dst[1], 16);
+  wrap[0] ^= 0x55;
+  make_hello(&h, wrap, 0xFFFE, 0);
+  L2D5Route_hello(&r, &h, nbs[1], 2, 30, NULL);
+  make_hello(&h, wrap, 0x0002, 0);
+  L2D5Route_hello(&r, &h, nbs[5], 6, 31, NULL);
+  CHECK(L2D5Route_next_hop(&r, wrap) == nbs[5], "seq wraparound");
+  L2D5Route_remove(&r, L2D5Route_find(&r, wrap));
+
+  /* NodesLimit */
+  make_hello(&h, dst[2], 200, 4);
+  CHECK(L2D5Route_hello(&r, &h, nbs[0], 5, 40, NULL) == L2D5ROUTE_NIL, "hops over NodesLimit rejected");
+
+  /* neighbor loss: only routes through it are touched, alternates take over */
+  uint64_t before = r.changes;
+  L2D5Neighbor_remove(&nb, nbs[4]);
+  uint32_t touched = L2D5Route_neighbor_down(&r, nbs[4]);
+  CHECK(touched > 0 && touched <= 3 * NDEST / NNEIGH + 3, "neighbor_down touched set");
+  CHECK(r.changes - before <= NDEST / NNEIGH + 1, "neighbor_down changes");
+  ok = 1;
+  for (int d = 2; d < NDEST; d++) {
+    uint32_t hop = L2D5Route_next_hop(&r, dst[d]);
+    if (d % NNEIGH == 4) {
+      ok &= hop == nbs[5];
+    } else {
+      ok &= hop == nbs[d % NNEIGH];
+    }
+  }
+  CHECK(ok, "alternate next hop after neighbor loss");
+  CHECK(nb.gen[nbs[4]] != 0 && r.nb_head[nbs[4]] == L2D5ROUTE_NIL, "neighbor list emptied");
+
+  /* export */
+  uint32_t d9 = L2D5Route_find(&r, dst[9]);
+  L2D5Routing_RemoteTable_t rec;
+  L2D5Route_export(&r, d9, &rec);
+  CHECK(memcmp(rec.NextHopAddr, nb_addr[9], 16) == 0 && ORBIT_load_be16(rec.hops) == 2, "export");
+  CHECK(ORBIT_load_be64(rec.last_seen_time) == 12, "export last_seen");
+
+  /* import: one restored candidate per dest, never beside a live HELLO via the same neighbor */
+  uint8_t rs[16];
+  memcpy(rs, dst[11], 16);
+  rs[0] ^= 0xAA;
+  L2D5Routing_RemoteTable_t imp;
+  memset(&imp, 0, sizeof(imp));
+  memcpy(imp.NodeAddr, rs, 16);
+  memcpy(imp.NextHopAddr, nb_addr[1], 16);
+  memset(imp.PublicKey, 0xEE, 32);
+  ORBIT_store_be16(imp.hops, 2);
+  ORBIT_store_be64(imp.last_seen_time, 7);
+  uint32_t rd = L2D5Route_import(&r, &imp);
+  make_hello(&h, rs, 10, 0);
+  L2D5Route_hello(&r, &h, nbs[2], 4, 60, NULL);
+  memcpy(imp.NextHopAddr, nb_addr[2], 16);
+  CHECK(L2D5Route_import(&r, &imp) == rd, "import beside a live HELLO");
+  int via2 = 0, restored = 0;
+  for (uint32_t k = 0; k < L2D5ROUTE_CANDIDATES; k++) {
+    via2 += r.cand[(size_t)rd * L2D5ROUTE_CANDIDATES + k].nb_slot == nbs[2];
+  }
+  CHECK(via2 == 1, "no restored duplicate via the HELLO neighbor");
+  memcpy(imp.NextHopAddr, nb_addr[3], 16);
+  L2D5Route_import(&r, &imp);
+  for (uint32_t k = 0; k < L2D5ROUTE_CANDIDATES; k++) {
+    const L2D5RouteCand_t *c = &r.cand[(size_t)rd * L2D5ROUTE_CANDIDATES + k];
+    restored += c->nb_slot != L2D5NB_NIL && c->restored;
+  }
+  CHECK(restored == 1, "restored candidate merged in place");
+  CHECK(r.cold[rd].PublicKey[0] == rs[0] && r.cold[rd].last_seen == 60, "import keeps HELLO-learned data");
+  CHECK(L2D5Route_next_hop(&r, rs) == nbs[2], "HELLO candidate ranked over restored");
+  L2D5Route_remove(&r, rd);
+
+  /* remove + iteration */
+  L2D5Route_remove(&r, d9);
+  CHECK(L2D5Route_find(&r, dst[9]) == L2D5ROUTE_NIL, "remove");
+  uint32_t seen = 0;
+  for (uint32_t d = L2D5Route_next(&r, 0); d != L2D5ROUTE_NIL; d = L2D5Route_next(&r, d + 1)) {
+    seen++;
+  }
+  CHECK(seen == r.count && seen == NDEST - 1, "iteration");
+  for (int d = 0; d < NDEST; d++) {
+    L2D5Route_export(&r, d == 9 ? 0 : L2D5Route_find(&r, dst[d]), &recs[d]);
+  }
+
+  /* lookup cost */
+  enum { ROUNDS = 20 };
+  volatile uint64_t sink = 0;
+  double t0 = now_sec();
+  for (int k = 0; k < ROUNDS; k++) {
+    for (int d = 0; d < NDEST; d++) {
+      sink += linear_next_hop(recs, NDEST, &nb, dst[(d * 37) % NDEST]);
+    }
+  }
+  double lin = (now_sec() - t0) / (ROUNDS * NDEST) * 1e9;
+  t0 = now_sec();
+  for (int k = 0; k < ROUNDS * 50; k++) {
+    for (int d = 0; d < NDEST; d++) {
+      sink += L2D5Route_next_hop(&r, dst[(d * 37) % NDEST]);
+    }
+  }
+  double hashed = (now_sec() - t0) / (ROUNDS * 50 * NDEST) * 1e9;
+  printf("Next hop, %d destinations: linear scan %.1f ns, route engine %.1f ns\n", NDEST, lin, hashed);
+
+  /* incremental update cost */
+  t0 = now_sec();
+  for (int d = 0; d < NDEST; d++) {
+    make_hello(&h, dst[d], 300, 0);
+    L2D5Route_hello(&r, &h, nbs[(d + 1) % NNEIGH], 3, 50, NULL);
+  }
+  printf("HELLO_PKT_RM update: %.1f ns\n", (now_sec() - t0) / NDEST * 1e9);
+
+  L2D5Route_free(&r);
+  L2D5Neighbor_free(&nb);
+  printf("\nORBIT L2.5 Route Engine Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,313 @@
+/*
+ * File:        test/l2d5_snapshot_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Table Snapshot Test Program.
+ *    Neighbor / route round trip through the mapped file, SharedKeys
+ *    encrypted at rest, wrong storage key, torn log entry, log full
+ *    compaction, age rebasing, restored routes losing to HELLOs, and warm
+ *    start time vs relearning every SharedKey with X25519.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - Link -lcrypto.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/L2D5_snapshot.h"
+#include "../src/ORBIT_schema.h"
+#include <openssl/evp.h>
+#include <sys/random.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NNEIGH 200
+#define NDEST  1000
+
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void fill(uint8_t *_p, size_t _n) {
+  for (size_t i = 0; i < _n; i++) {
+    _p[i] = (uint8_t)rng();
+  }
+}
+
+static void make_hello(L2D5Routing_HelloPkt_t *h, const uint8_t *origin, uint16_t seq) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->NodeSrcAddr, origin, 16);
+  L2D5HelloPkt_set_SEQ(h, seq);
+}
+
+static int tables_init(L2D5NeighborTable_t *_nb, L2D5RouteTable_t *_r, L2D5KeyCache_t *_kc) {
+  return L2D5Neighbor_init(_nb, 256) != 0 || L2D5Route_init(_r, _nb, NDEST + 24) != 0 ||
+         (_kc != NULL && L2D5KeyCache_init(_kc, 256) != 0) ? -1 : 0;
+}
+
+static void tables_free(L2D5NeighborTable_t *_nb, L2D5RouteTable_t *_r, L2D5KeyCache_t *_kc) {
+  L2D5Route_free(_r);
+  L2D5Neighbor_free(_nb);
+  if (_kc != NULL) {
+    L2D5KeyCache_free(_kc);
+  }
+}
+
+/* bytes of _needle anywhere in the file */
+static bool file_contains(const char *_path, const uint8_t *_needle, size_t _n) {
+  FILE *f = fopen(_path, "rb");
+  if (f == NULL) {
+    return false;
+  }
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *buf = malloc((size_t)len);
+  bool hit = false;
+  if (buf != NULL && fread(buf, 1, (size_t)len, f) == (size_t)len) {
+    for (long i = 0; i + (long)_n <= len && !hit; i++) {
+      hit = memcmp(buf + i, _needle, _n) == 0;
+    }
+  }
+  free(buf);
+  fclose(f);
+  return hit;
+}
+
+/* One X25519 per neighbor, as a cold start would */
+static double x25519_relearn(int _n) {
+  EVP_PKEY *own = NULL, *peer = NULL;
+  EVP_PKEY_CTX *kg = EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, NULL);
+  if (kg == NULL || EVP_PKEY_keygen_init(kg) != 1 || EVP_PKEY_keygen(kg, &own) != 1 ||
+      EVP_PKEY_keygen(kg, &peer) != 1) {
+    return -1;
+  }
+  uint8_t shared[32];
+  size_t len;
+  double t0 = now_sec();
+  for (int i = 0; i < _n; i++) {
+    EVP_PKEY_CTX *d = EVP_PKEY_CTX_new(own, NULL);
+    len = sizeof(shared);
+    if (d == NULL || EVP_PKEY_derive_init(d) != 1 || EVP_PKEY_derive_set_peer(d, peer) != 1 ||
+        EVP_PKEY_derive(d, shared, &len) != 1) {
+      EVP_PKEY_CTX_free(d);
+      return -1;
+    }
+    EVP_PKEY_CTX_free(d);
+  }
+  double t = now_sec() - t0;
+  EVP_PKEY_free(own);
+  EVP_PKEY_free(peer);
+  EVP_PKEY_CTX_free(kg);
+  return t;
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  char path[] = "/tmp/orbit_snapshot_XXXXXX";
+  int tmp = mkstemp(path);
+  if (tmp < 0) {
+    perror("mkstemp failed");
+    return EXIT_FAILURE;
+  }
+  close(tmp);
+
+  uint8_t key[L2D5SNAP_KEY_BYTES], bad_key[L2D5SNAP_KEY_BYTES];
+  static uint8_t nb_addr[NNEIGH][16], nb_pub[NNEIGH][32], nb_shared[NNEIGH][32], dst[NDEST][16];
+  fill(key, sizeof(key));
+  memcpy(bad_key, key, sizeof(key));
+  bad_key[0] ^= 1;
+  fill(&nb_addr[0][0], sizeof(nb_addr));
+  fill(&nb_pub[0][0], sizeof(nb_pub));
+  fill(&nb_shared[0][0], sizeof(nb_shared));
+  fill(&dst[0][0], sizeof(dst));
+
+  /* ---- first run: learn, log, compact ---- */
+  L2D5NeighborTable_t nb;
+  L2D5RouteTable_t r;
+  L2D5Snap_t s;
+  if (tables_init(&nb, &r, NULL) != 0 || L2D5Snap_open(&s, path, key, &nb, &r, 64) != 0) {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+  CHECK(s.hdr.gen == 0 && L2D5Snap_restore(&s, NULL, NULL, 0, 0, 0) == 0, "new file restores nothing");
+
+  uint32_t slots[NNEIGH];
+  for (int i = 0; i < NNEIGH; i++) {
+    slots[i] = L2D5Neighbor_observe(&nb, nb_addr[i], nb_pub[i], 1000 + (uint64_t)i, -40 - i % 50, NULL);
+    memcpy(nb.keys[slots[i]].SharedKey, nb_shared[i], 32);
+    nb.has_shared[slots[i]] = 1;
+    CHECK(L2D5Snap_neighbor_put(&s, slots[i]) == 0, "neighbor_put");
+  }
+  /* 64-entry log: the first append compacted, later ones filled and compacted again */
+  CHECK(s.compactions >= 3 && s.log_count <= 64, "log full compacts");
+
+  L2D5Routing_HelloPkt_t h;
+  for (int d = 0; d < NDEST; d++) {
+    make_hello(&h, dst[d], 500);
+    uint32_t dest = L2D5Route_hello(&r, &h, slots[d % NNEIGH], (uint16_t)(2 + d % 5), 2000 + (uint64_t)d, NULL);
+    if (d < 40) {
+      CHECK(L2D5Snap_route_put(&s, dest) == 0, "route_put");
+    }
+  }
+  CHECK(L2D5Snap_compact(&s, 3000) == 0 && s.log_count == 0, "compact");
+  uint64_t gen = s.hdr.gen;
+
+  /* logged after the compaction: one removal each, one refreshed neighbor */
+  CHECK(L2D5Snap_route_del(&s, dst[7], 3050) == 0, "route_del");
+  L2D5Route_remove(&r, L2D5Route_find(&r, dst[7]));
+  L2D5Route_neighbor_down(&r, slots[3]);
+  L2D5Neighbor_remove(&nb, slots[3]);
+  CHECK(L2D5Snap_neighbor_del(&s, nb_addr[3], 3060) == 0, "neighbor_del");
+  L2D5Neighbor_touch(&nb, slots[5], 3100, -30);
+  CHECK(L2D5Snap_neighbor_put(&s, slots[5]) == 0 && s.log_count == 3 && s.hdr.gen == gen, "log appends");
+  CHECK(L2D5Snap_sync(&s, true) == 0, "sync");
+
+  /* SharedKeys never in plaintext */
+  int plain = 0;
+  for (int i = 0; i < NNEIGH; i += 17) {
+    plain += file_contains(path, nb_shared[i], 32);
+  }
+  CHECK(plain == 0, "SharedKey not stored in plaintext");
+  CHECK(file_contains(path, nb_addr[0], 16), "records stored");
+  L2D5Snap_close(&s);
+  uint32_t live_routes = r.count;
+  tables_free(&nb, &r, NULL);
+
+  /* ---- wrong storage key ---- */
+  if (tables_init(&nb, &r, NULL) != 0 || L2D5Snap_open(&s, path, bad_key, &nb, &r, 64) != 0) {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+  CHECK(L2D5Snap_restore(&s, NULL, NULL, 10, 0, 0) == -1 && nb.count == 0 && r.count == 0, "wrong key rejected");
+  L2D5Snap_close(&s);
+  tables_free(&nb, &r, NULL);
+
+  /* ---- warm start ---- */
+  L2D5KeyCache_t kc;
+  L2D5Aging_t ag;
+  if (tables_init(&nb, &r, &kc) != 0 || L2D5Aging_init(&ag, &nb, &r, 10000, 20000, 100, 50000) != 0) {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+  double t0 = now_sec();
+  int n = -1;
+  if (L2D5Snap_open(&s, path, key, &nb, &r, 64) == 0) {
+    n = L2D5Snap_restore(&s, &kc, &ag, 50000, 100, 0);
+  }
+  double warm = now_sec() - t0;
+  int warm_n = n;
+  CHECK(n == (int)(s.restored_nb + s.restored_rm) && s.hdr.gen == gen && s.log_count == 3, "restore ran");
+  CHECK(nb.count == NNEIGH - 1 && L2D5Neighbor_find(&nb, nb_addr[3]) == L2D5NB_NIL, "neighbors restored, del replayed");
+  CHECK(r.count == live_routes && L2D5Route_find(&r, dst[7]) == L2D5ROUTE_NIL, "routes restored, del replayed");
+
+  int keys_ok = 0, sessions = 0, fwd_ok = 0;
+  for (int i = 0; i < NNEIGH; i++) {
+    uint32_t slot = L2D5Neighbor_find(&nb, nb_addr[i]);
+    if (slot != L2D5NB_NIL) {
+      keys_ok += memcmp(nb.keys[slot].SharedKey, nb_shared[i], 32) == 0 &&
+                 memcmp(nb.keys[slot].PublicKey, nb_pub[i], 32) == 0 && nb.has_shared[slot];
+      sessions += L2D5KeyCache_find(&kc, nb_addr[i]) != NULL;
+    }
+  }
+  for (int d = 0; d < NDEST; d++) {
+    uint32_t via = L2D5Route_next_hop(&r, dst[d]);
+    fwd_ok += d % NNEIGH != 3 && d != 7 && via != L2D5NB_NIL && L2D5ADDR_equal(nb.addr[via], nb_addr[d % NNEIGH]);
+  }
+  CHECK(keys_ok == NNEIGH - 1, "SharedKey / PublicKey round trip");
+  CHECK(sessions == NNEIGH - 1, "sessions installed without X25519");
+  CHECK(fwd_ok == NDEST - NDEST / NNEIGH - 1, "next hops restored");
+
+  /* ages: newest record (3100) becomes now - offline */
+  uint32_t s5 = L2D5Neighbor_find(&nb, nb_addr[5]);
+  uint32_t s0 = L2D5Neighbor_find(&nb, nb_addr[0]);
+  CHECK(s5 != L2D5NB_NIL && nb.last_seen[s5] == 50000 - 100 && nb.last_rssi[s5] == -30, "logged put rebased");
+  CHECK(s0 != L2D5NB_NIL && nb.last_seen[s0] == 50000 - 100 - (3100 - 1000), "image record rebased");
+  uint32_t d9 = L2D5Route_find(&r, dst[9]);
+  CHECK(d9 != L2D5ROUTE_NIL && r.cold[d9].last_seen == 50000 - 100 - (3100 - 2009), "route rebased");
+
+  /* restored routes: SEQ unknown, any HELLO wins */
+  uint32_t d20 = L2D5Route_find(&r, dst[20]);
+  make_hello(&h, dst[20], 1);
+  bool changed = false;
+  L2D5Route_hello(&r, &h, s0, 9, 50001, &changed);
+  CHECK(changed && L2D5Route_next_hop(&r, dst[20]) == s0, "HELLO with older SEQ replaces restored route");
+  L2D5Route_hello(&r, &h, s5, 1, 50002, &changed);
+  CHECK(L2D5Route_next_hop(&r, dst[20]) == s5 && d20 == L2D5Route_find(&r, dst[20]), "then normal selection");
+
+  /* first write after a restart opens a new generation */
+  CHECK(L2D5Snap_neighbor_put(&s, s0) == 0 && s.hdr.gen == gen + 1 && s.log_count == 0, "restart compacts");
+  L2D5Snap_close(&s);
+  L2D5Aging_free(&ag);
+  tables_free(&nb, &r, &kc);
+
+  /* ---- max_age, torn log entry ---- */
+  if (tables_init(&nb, &r, NULL) != 0 || L2D5Snap_open(&s, path, key, &nb, &r, 64) != 0) {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+  n = L2D5Snap_restore(&s, NULL, NULL, 50000, 0, 1000);
+  CHECK(n > 0 && s.skipped > 0 && nb.count < NNEIGH - 1, "max_age skips old records");
+  int old = 0;
+  for (uint32_t i = L2D5Neighbor_next(&nb, 0); i != L2D5NB_NIL; i = L2D5Neighbor_next(&nb, i + 1)) {
+    old += nb.last_seen[i] < 50000 - 1000;
+  }
+  CHECK(old == 0, "kept records within max_age");
+  /* append two, tear the first: replay must stop before both */
+  uint32_t x = L2D5Neighbor_next(&nb, 0);
+  CHECK(L2D5Snap_neighbor_put(&s, x) == 0 && L2D5Snap_neighbor_put(&s, x) == 0 &&
+        L2D5Snap_neighbor_put(&s, x) == 0 && s.log_count == 2, "appends after restart compaction");
+  L2D5SnapEntry_t *log = (L2D5SnapEntry_t *)(s.map + L2D5SNAP_DATA_OFFSET + 2 * s.image_bytes);
+  log[0].rec[60] ^= 0x40;
+  L2D5Snap_close(&s);
+  tables_free(&nb, &r, NULL);
+
+  if (tables_init(&nb, &r, NULL) != 0 || L2D5Snap_open(&s, path, key, &nb, &r, 64) != 0) {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+  CHECK(s.log_count == 0, "torn entry ends the log");
+  CHECK(L2D5Snap_restore(&s, NULL, NULL, 60000, 0, 0) > 0, "image still restores");
+  /* a removal that compacts stamps the image with its own time, not the old saved_at */
+  gen = s.hdr.gen;
+  CHECK(L2D5Snap_neighbor_del(&s, nb_addr[0], 61000) == 0 && s.hdr.gen == gen + 1 && s.hdr.saved_at == 61000,
+        "compacting removal stamps saved_at");
+  L2D5Snap_close(&s);
+  tables_free(&nb, &r, NULL);
+
+  double cold = x25519_relearn(NNEIGH);
+  CHECK(cold > 0, "X25519");
+  printf("warm start: %d neighbors + routes in %.3f ms; relearning %d SharedKeys with X25519 %.3f ms "
+         "(plus the HELLO interval to hear them)\n", warm_n, warm * 1e3, NNEIGH, cold * 1e3);
+
+  unlink(path);
+  printf("\nORBIT L2.5 Table Snapshot Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -15,13 +15,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "../src/L2D5_struct.h"
+#include "../src/ORBIT_schema.h"
+#include "../src/ORBIT_schema_view.h"
 #include <sys/random.h>
 #include <zlib.h>
 #include <sodium.h>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <time.h>
-#include <printHexTable/printHexTable.h>
 #define CRYPTO_X25519_PK_BYTES  32
 #define CRYPTO_X25519_SK_BYTES  32
 #define CRYPTO_X25519_SHR_BYTES 32
@@ -130,8 +131,7 @@ int main() {
   for(int i=0; i<16; i++) {
     l2d5test.DstAddress[i] = 0xFF;
   }
-  l2d5test.TTL[0] = 0;
-  l2d5test.TTL[1] = 0;
+  L2D5Frame_set_TTL(&l2d5test, 0);
 
 
 
@@ -140,15 +140,9 @@ int main() {
   L2D5Routing_HelloPkt_t testHelloPkt;
   memcpy(testHelloPkt.NodeSrcAddr, testSrcAddress, 16);
   memcpy(testHelloPkt.PublicKey, shared_key, 32);
-  time_t timestamp_now = time(NULL);
-  uint32_t time_uint32 = (uint32_t) timestamp_now;
-  uint8_t time_uint8_array[sizeof(time_uint32)];
-  memcpy(time_uint8_array, &time_uint32, sizeof(time_uint32));
-  memcpy(testHelloPkt.TimeStamp, time_uint8_array, 4);
-  testHelloPkt.SEQ[0] = 0xA;
-  testHelloPkt.SEQ[1] = 0x0;
-  testHelloPkt.NodesLimit[0] = 0xFE;
-  testHelloPkt.NodesLimit[1] = 0x00;
+  L2D5HelloPkt_set_TimeStamp(&testHelloPkt, (uint32_t)time(NULL));
+  L2D5HelloPkt_set_SEQ(&testHelloPkt, 10);
+  L2D5HelloPkt_set_NodesLimit(&testHelloPkt, 254);
   for(int i=0; i<120; i++) {
     testHelloPkt.Padding[i] = 0;
   }
@@ -172,13 +166,9 @@ int main() {
   ANSIColorMap256_t l2d5Frame_ansi_map = {0};
   ANSIErrTagMap256_t l2d5Frame_ansi_err_map = {0};
 
-  addr2AnsiColorMap256(&l2d5Frame_ansi_map, 0x00, 0x00, "\e[1;32m", 0x00, ' ', 0x00, ' ', 1);
-  addr2AnsiColorMap256(&l2d5Frame_ansi_map, 0x01, 0x04, "\e[0;33m", 0x01, '[', 0x04, ']', 1);
-  addr2AnsiColorMap256(&l2d5Frame_ansi_map, 0x05, 0x05, "\e[1;93m", 0x05, ' ', 0x05, ' ', 1);
-  addr2AnsiColorMap256(&l2d5Frame_ansi_map, 0x06, 0x15, "\e[0;36m", 0x06, '[', 0x15, ']', 1);
-  addr2AnsiColorMap256(&l2d5Frame_ansi_map, 0x16, 0x25, "\e[0;94m", 0x16, '[', 0x25, ']', 1);
-  addr2AnsiColorMap256(&l2d5Frame_ansi_map, 0x26, 0x27, "\e[1;35m", 0x26, '[', 0x27, ']', 1);
-  addr2AnsiColorMap256(&l2d5Frame_ansi_map, 0x28, 0xD7, "\e[0;95m", 0x28, '[', 0xD7, ']', 1);
+  size_t nfields;
+  const ORBITSchemaField_t *fields = L2D5Frame_fields(&nfields);
+  ORBITSchema_color_map(&l2d5Frame_ansi_map, fields, nfields);
 
   
   addr2AnsiErrTag256(&l2d5Frame_ansi_err_map, 0x72, 0x72, 0x1);
@@ -198,7 +188,7 @@ int main() {
   #define ARRAY_LEN(x) (sizeof(x) / sizeof((x)[0]))
   char *output_str = printColorHexTable256(l2d5Frame_buffer, sizeof(l2d5Frame_buffer), &l2d5Frame_ansi_map, &l2d5Frame_ansi_err_map, "L2.5 Frame Non-Encrypted", "printHexTable version "PRINTHEXTABLE_VERSION"  by @KaliAssistant");
   printf("%s", output_str);
-  printf("\e[1;32m ██ TAG\e[0m \e[0;33m ██ KEYHINT\e[0m \e[1;93m ██ FLAG\e[0m \e[0;36m ██ SRCADDR\e[0m \e[0;94m ██ DSTADDR\e[0m \e[1;35m ██ TTL\e[0m \e[0;95m ██ PAYLOAD\e[0m\n");
+  ORBITSchema_legend(fields, nfields);
   printf("\n");
   printf("%s+@error\e[0m %s+@warning\e[0m %s+@debug\e[0m\n", ANSI_LEVEL_COLOR[3], ANSI_LEVEL_COLOR[2], ANSI_LEVEL_COLOR[1]);
   //printHexTable256(l2d5Frame_buffer, sizeof(l2d5Frame_buffer), "", "");
@@ -0,0 +1,123 @@
+/*
+ * File:        test/l2d5_trickle_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 Trickle HELLO Scheduler Test Program.
+ *    Interval doubling up to Imax, transmit point in the second half,
+ *    suppression by k consistent HELLOs counted once per SEQ, forced
+ *    HELLO after max_suppress, reset on new neighbor / key change / SEQ
+ *    restart, and HELLOs sent over a stable hour against a fixed period.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/random.h>
+#include "../src/L2D5_trickle.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define IMIN      1000
+#define DOUBLINGS 6
+
+
+int main() {
+  int fail = 0;
+  uint64_t seed;
+  if (getrandom(&seed, sizeof(seed), 0) != sizeof(seed)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+
+  L2D5Trickle_t tr;
+  CHECK(L2D5Trickle_init(&tr, 16, 1, 0, 1, 1, 0, seed) == -1, "Imin too small rejected");
+  CHECK(L2D5Trickle_init(&tr, 16, IMIN, DOUBLINGS, 0, 0, 0, seed) == 0, "init");
+
+  /* no suppression: one HELLO per interval, in its second half, I doubling to Imax */
+  uint64_t expect_i = IMIN, start = 0;
+  int bad_t = 0, bad_i = 0, sends = 0;
+  for (int k = 0; k < 12; k++) {
+    bad_i += tr.i != expect_i || tr.start != start;
+    bad_t += tr.t < start + expect_i / 2 || tr.t >= start + expect_i;
+    uint64_t t = tr.t;
+    CHECK(L2D5Trickle_next(&tr) == t, "next is the transmit point");
+    sends += L2D5Trickle_poll(&tr, t - 1);
+    sends += L2D5Trickle_poll(&tr, t);
+    CHECK(L2D5Trickle_next(&tr) == start + expect_i, "then the interval end");
+    sends += L2D5Trickle_poll(&tr, start + expect_i);
+    start += expect_i;
+    expect_i = expect_i * 2 < (uint64_t)IMIN << DOUBLINGS ? expect_i * 2 : (uint64_t)IMIN << DOUBLINGS;
+  }
+  CHECK(bad_i == 0, "interval doubles up to Imax");
+  CHECK(bad_t == 0, "transmit point in [I/2, I)");
+  CHECK(sends == 12 && tr.sent == 12, "one HELLO per interval");
+  CHECK(tr.i == (uint64_t)IMIN << DOUBLINGS, "at Imax");
+
+  /* consistent neighbors, SEQ counted once; inconsistency resets to Imin */
+  CHECK(L2D5Trickle_hello(&tr, 0, 5, L2D5NB_OBS_NEW, start), "new neighbor resets");
+  CHECK(tr.i == IMIN && tr.resets == 1 && tr.start == start, "back to Imin, new interval");
+  CHECK(!L2D5Trickle_reset(&tr, start), "no reset at Imin");
+  L2D5Trickle_free(&tr);
+
+  CHECK(L2D5Trickle_init(&tr, 16, IMIN, DOUBLINGS, 2, 1, 0, seed) == 0, "init k = 2");
+  for (uint32_t s = 0; s < 4; s++) {
+    L2D5Trickle_hello(&tr, s, 1, L2D5NB_OBS_NEW, 0);
+  }
+  CHECK(tr.c == 0, "new neighbors are not consistent");
+  L2D5Trickle_hello(&tr, 0, 2, 0, 1);
+  L2D5Trickle_hello(&tr, 0, 2, 0, 2);
+  CHECK(tr.c == 1, "same SEQ twice counts once");
+  CHECK(L2D5Trickle_poll(&tr, tr.t), "c < k: sent");
+  L2D5Trickle_poll(&tr, L2D5Trickle_next(&tr));
+  L2D5Trickle_hello(&tr, 1, 2, 0, tr.start);
+  L2D5Trickle_hello(&tr, 2, 2, 0, tr.start);
+  CHECK(!L2D5Trickle_poll(&tr, tr.t) && tr.suppressed == 1, "c >= k: suppressed");
+  L2D5Trickle_poll(&tr, L2D5Trickle_next(&tr));
+  L2D5Trickle_hello(&tr, 1, 3, 0, tr.start);
+  L2D5Trickle_hello(&tr, 2, 3, 0, tr.start);
+  CHECK(L2D5Trickle_poll(&tr, tr.t), "max_suppress reached: forced");
+  L2D5Trickle_poll(&tr, L2D5Trickle_next(&tr));
+  CHECK(tr.i == 8 * IMIN, "still doubling");
+  CHECK(!L2D5Trickle_hello(&tr, 3, 9, 0, tr.start) && tr.i == 8 * IMIN, "SEQ jump forward is consistent");
+  CHECK(L2D5Trickle_hello(&tr, 3, 4, 0, tr.start) && tr.i == IMIN, "SEQ restart resets");
+  L2D5Trickle_poll(&tr, tr.start + IMIN);
+  CHECK(L2D5Trickle_hello(&tr, 2, 3, L2D5NB_OBS_KEY_CHANGED, tr.start) && tr.i == IMIN, "key change resets");
+  CHECK(!L2D5Trickle_hello(&tr, 99, 1, L2D5NB_OBS_NEW, tr.start), "slot out of range ignored");
+  L2D5Trickle_free(&tr);
+
+  /* one node among 8 neighbors over a stable hour: HELLOs vs a fixed Imin period */
+  CHECK(L2D5Trickle_init(&tr, 16, IMIN, DOUBLINGS, 3, 1, 0, seed) == 0, "init hour");
+  const uint64_t hour = 3600 * IMIN;
+  uint64_t nb_seq[8] = { 0 }, now = 0, last_sent = 0, max_gap = 0;
+  while ((now = L2D5Trickle_next(&tr)) < hour) {
+    /* each neighbor heard at about two of every three timer events */
+    for (uint32_t s = 0; s < 8; s++) {
+      if ((now / 7 + s * 13) % 3 != 0) {
+        nb_seq[s]++;
+        L2D5Trickle_hello(&tr, s, (uint16_t)nb_seq[s], nb_seq[s] == 1 ? L2D5NB_OBS_NEW : 0, now);
+      }
+    }
+    if (L2D5Trickle_poll(&tr, now)) {
+      max_gap = now - last_sent > max_gap ? now - last_sent : max_gap;
+      last_sent = now;
+    }
+  }
+  printf("stable hour: %llu HELLOs (fixed Imin period: %llu), %llu suppressed, %llu intervals, "
+         "longest silence %.2f Imax\n", (unsigned long long)tr.sent, (unsigned long long)(hour / IMIN),
+         (unsigned long long)tr.suppressed, (unsigned long long)tr.intervals,
+         (double)max_gap / (double)((uint64_t)IMIN << DOUBLINGS));
+  CHECK(tr.sent * 20 < hour / IMIN, "far fewer HELLOs than a fixed period");
+  CHECK(tr.suppressed > 0, "some HELLOs suppressed");
+  CHECK(max_gap < 3 * ((uint64_t)IMIN << DOUBLINGS), "silence bounded by max_suppress");
+  L2D5Trickle_free(&tr);
+
+  printf("\nORBIT L2.5 Trickle HELLO Scheduler Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/*
+ * File:        test/l2d5_txsched_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L2.5 TX Scheduler Test Program.
+ *    Strict PRI order, weighted-fair shares, lossless per-producer FIFO
+ *    with concurrent producers, and producer-side push latency against a
+ *    mutex-protected queue.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - Build with -pthread.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "../src/L2D5_txsched.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NPROD   4
+#define PERPROD 200000
+
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* item = (producer << 32 | seq) + 1, never NULL */
+static inline void *mk_item(uint64_t prod, uint64_t seq) {
+  return (void *)(uintptr_t)(((prod << 32) | seq) + 1);
+}
+
+
+/* --------------------- baseline: mutex + 16 FIFOs ---------------------- */
+
+typedef struct {
+  pthread_mutex_t lock;
+  void   **q[L2D5TX_LEVELS];
+  uint32_t head[L2D5TX_LEVELS], tail[L2D5TX_LEVELS], mask;
+} MutexQ_t;
+
+static bool mq_push(MutexQ_t *m, uint8_t pri, void *item) {
+  bool ok = false;
+  pthread_mutex_lock(&m->lock);
+  if (m->tail[pri] - m->head[pri] <= m->mask) {
+    m->q[pri][m->tail[pri]++ & m->mask] = item;
+    ok = true;
+  }
+  pthread_mutex_unlock(&m->lock);
+  return ok;
+}
+
+static void *mq_pop(MutexQ_t *m) {
+  void *item = NULL;
+  pthread_mutex_lock(&m->lock);
+  for (int p = L2D5TX_LEVELS - 1; p >= 0; p--) {
+    if (m->head[p] != m->tail[p]) {
+      item = m->q[p][m->head[p]++ & m->mask];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&m->lock);
+  return item;
+}
+
+
+/* ----------------------------- producers ------------------------------- */
+
+typedef struct {
+  L2D5TxSched_t *s;
+  MutexQ_t      *m;
+  uint64_t       id;
+  uint64_t      *lat;             // PERPROD push latencies (ns)
+} Prod_t;
+
+
+static void *producer(void *arg) {
+  Prod_t *p = arg;
+  for (uint64_t i = 0; i < PERPROD; i++) {
+    uint8_t pri = (uint8_t)((i * 7 + p->id) & 15);
+    void *item = mk_item(p->id, i);
+    uint64_t t0 = now_ns();
+    while (p->s ? !L2D5TxSched_push(p->s, pri, item) : !mq_push(p->m, pri, item)) {
+    }
+    p->lat[i] = now_ns() - t0;
+  }
+  return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/* Returns 0 when every item arrived once and in per-(producer, PRI) FIFO order */
+static int run(L2D5TxSched_t *s, MutexQ_t *m, double *p50, double *p999, double *mps) {
+  static uint64_t lat[NPROD][PERPROD];
+  static uint64_t last[NPROD][L2D5TX_LEVELS];
+  pthread_t th[NPROD];
+  Prod_t prod[NPROD];
+  int bad = 0;
+
+  memset(last, 0xFF, sizeof(last));
+  uint64_t t0 = now_ns();
+  for (int i = 0; i < NPROD; i++) {
+    prod[i] = (Prod_t){ s, m, (uint64_t)i, lat[i] };
+    pthread_create(&th[i], NULL, producer, &prod[i]);
+  }
+  for (uint64_t got = 0; got < (uint64_t)NPROD * PERPROD;) {
+    void *it = s ? L2D5TxSched_pop(s, NULL) : mq_pop(m);
+    if (it == NULL) {
+      continue;
+    }
+    uint64_t v = (uint64_t)(uintptr_t)it - 1;
+    uint64_t id = v >> 32, seq = v & 0xFFFFFFFF;
+    uint8_t pri = (uint8_t)((seq * 7 + id) & 15);
+    /* within one (producer, PRI) stream sequence numbers step by 16 */
+    if (id >= NPROD || seq != (last[id][pri] == UINT64_MAX ? seq % 16 : last[id][pri] + 16)) {
+      bad = 1;
+    } else {
+      last[id][pri] = seq;
+    }
+    got++;
+  }
+  double secs = (double)(now_ns() - t0) * 1e-9;
+  for (int i = 0; i < NPROD; i++) {
+    pthread_join(th[i], NULL);
+  }
+  uint64_t *all = &lat[0][0];
+  qsort(all, (size_t)NPROD * PERPROD, sizeof(uint64_t), cmp_u64);
+  *p50 = (double)all[(size_t)NPROD * PERPROD / 2];
+  *p999 = (double)all[(size_t)NPROD * PERPROD * 999 / 1000];
+  *mps = (double)NPROD * PERPROD / secs / 1e6;
+  return bad;
+}
+
+
+int main() {
+  int fail = 0;
+  L2D5TxSched_t s;
+  if (L2D5TxSched_init(&s, 1024) != 0) {
+    printf("L2D5TxSched_init failed\n");
+    return EXIT_FAILURE;
+  }
+
+  /* strict: highest PRI first, FIFO inside a PRI, FLAG PRI honoured */
+  static L2D5Frame_t fr[48];
+  for (int i = 0; i < 48; i++) {
+    memset(&fr[i], 0, sizeof(fr[i]));
+    fr[i].FLAG = L2D5FLAG_MKFLAG((uint8_t)(i % 16), L2D5FLAG_ERR_NML, L2D5FLAG_NUL_A);
+    CHECK(L2D5TxSched_push_frame(&s, &fr[i]), "push_frame");
+  }
+  int ok = 1, last_pri = 16, last_idx = -1;
+  for (int i = 0; i < 48; i++) {
+    uint8_t pri = 0;
+    L2D5Frame_t *f = L2D5TxSched_pop(&s, &pri);
+    int idx = (int)(f - fr);
+    ok &= f != NULL && pri == L2D5FLAG_GET_PRI(f->FLAG) && pri <= last_pri;
+    ok &= pri != last_pri || idx > last_idx;
+    last_pri = pri;
+    last_idx = idx;
+  }
+  CHECK(ok && L2D5TxSched_pop(&s, NULL) == NULL && L2D5TxSched_empty(&s), "strict order");
+
+  /* full ring */
+  int pushed = 0;
+  while (L2D5TxSched_push(&s, 3, &fr[0])) {
+    pushed++;
+  }
+  CHECK(pushed == 1024 && atomic_load(&s.ring[3].dropped) == 1, "full ring");
+  void *burst[2048];
+  CHECK(L2D5TxSched_pop_burst(&s, burst, 2048) == 1024, "pop_burst");
+
+  /* weighted: PRI 15 and PRI 0 both backlogged, weights 8 : 1 */
+  uint16_t w[L2D5TX_LEVELS] = {0};
+  w[0] = 1;
+  w[15] = 8;
+  L2D5TxSched_set_weighted(&s, w);
+  for (int i = 0; i < 900; i++) {
+    L2D5TxSched_push(&s, 15, &fr[15]);
+    if (i < 300) {
+      L2D5TxSched_push(&s, 0, &fr[0]);
+    }
+  }
+  int low = 0;
+  for (int i = 0; i < 450; i++) {
+    uint8_t pri = 0;
+    L2D5TxSched_pop(&s, &pri);
+    low += pri == 0;
+  }
+  CHECK(low == 50, "weighted share 8:1");
+  while (L2D5TxSched_pop(&s, NULL) != NULL) {
+  }
+  L2D5TxSched_set_strict(&s);
+
+  /* concurrent producers */
+  double p50, p999, mps;
+  CHECK(run(&s, NULL, &p50, &p999, &mps) == 0, "MPSC lossless FIFO");
+  printf("Lock-free scheduler : %6.2f Mframes/s, push p50 %4.0f ns, p99.9 %6.0f ns\n", mps, p50, p999);
+
+  MutexQ_t m;
+  pthread_mutex_init(&m.lock, NULL);
+  m.mask = 1023;
+  for (int p = 0; p < L2D5TX_LEVELS; p++) {
+    m.q[p] = calloc(1024, sizeof(void *));
+    m.head[p] = m.tail[p] = 0;
+  }
+  CHECK(run(NULL, &m, &p50, &p999, &mps) == 0, "mutex baseline");
+  printf("Mutex queue         : %6.2f Mframes/s, push p50 %4.0f ns, p99.9 %6.0f ns\n", mps, p50, p999);
+  for (int p = 0; p < L2D5TX_LEVELS; p++) {
+    free(m.q[p]);
+  }
+  pthread_mutex_destroy(&m.lock);
+
+  L2D5TxSched_free(&s);
+  printf("\nORBIT L2.5 TX Scheduler Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
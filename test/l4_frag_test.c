@@ -0,0 +1,380 @@
+/*
+ * File:        test/l4_frag_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L4 Fragmentation / Reassembly Test Program.
+ *    Messages from many sources interleaved, shuffled and duplicated
+ *    (delivered once, byte exact, in place, late duplicates of completed
+ *    messages dropped), missing-fragment lists, timeout and eviction,
+ *    malformed headers, the single-fragment fast path, and reassembly cost
+ *    per fragment for growing images against a sorted fragment list.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+#include "../src/L4_frag.h"
+#include "../src/ORBIT_bytes.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NSRC    6
+#define MAX_MSG (64 * 1024)
+
+
+typedef struct {
+  const uint8_t *expect[NSRC];            // message each source is sending
+  uint32_t       len[NSRC];
+  uint32_t       delivered[NSRC];
+  uint64_t       errors;
+  const uint8_t *last;                    // data pointer of the last delivery
+  const L4Reasm_t *r;
+  uint64_t       in_place;
+} Sink_t;
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng_state;
+
+static inline uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static void mkaddr(uint8_t *_addr, uint32_t _i) {
+  memset(_addr, 0, 16);
+  _addr[0] = 0xFD;
+  _addr[15] = (uint8_t)_i;
+}
+
+static void shuffle(uint16_t *_v, uint32_t _n) {
+  for (uint32_t i = _n; i > 1; i--) {
+    uint32_t j = (uint32_t)(rng() % i);
+    uint16_t t = _v[i - 1];
+    _v[i - 1] = _v[j];
+    _v[j] = t;
+  }
+}
+
+static void sink_deliver(void *_ctx, const uint8_t *_src, uint16_t _msg_id, uint8_t _port, const uint8_t *_data,
+                         uint32_t _len) {
+  Sink_t *k = _ctx;
+  uint32_t s = _src[15];
+  k->last = _data;
+  if (s >= NSRC || _port != (uint8_t)(_msg_id + s) || _len != k->len[s] || memcmp(_data, k->expect[s], _len) != 0) {
+    k->errors++;
+    return;
+  }
+  if (_data >= k->r->buf && _data < k->r->buf + (size_t)k->r->capacity * k->r->max_msg) {
+    k->in_place++;
+  }
+  k->delivered[s]++;
+}
+
+static void null_deliver(void *_ctx, const uint8_t *_src, uint16_t _msg_id, uint8_t _port, const uint8_t *_data,
+                         uint32_t _len) {
+  (void)_src;
+  (void)_msg_id;
+  (void)_port;
+  (void)_data;
+  *(uint64_t *)_ctx += _len;
+}
+
+
+/* sorted singly linked fragment list: what reassembly looks like without offsets / bitmap */
+typedef struct ListFrag {
+  struct ListFrag *next;
+  uint16_t         index;
+  uint8_t          data[L4FRAG_DATA];
+} ListFrag_t;
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  uint8_t *msgs = malloc((size_t)NSRC * MAX_MSG);
+  uint16_t *order = malloc(L4FRAG_MAX_COUNT * sizeof(uint16_t));
+  if (msgs == NULL || order == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < (size_t)NSRC * MAX_MSG; i++) {
+    msgs[i] = (uint8_t)rng();
+  }
+
+  /* 1. sender */
+  L4FragTx_t tx;
+  L4Frag_t f;
+  CHECK(L4FragTx_init(&tx, 1, 0, msgs, 0) == -1, "empty message rejected");
+  CHECK(L4FragTx_init(&tx, 1, 0, msgs, L4FRAG_MAX_MSG + 1) == -1, "oversize rejected");
+  CHECK(L4FragTx_init(&tx, 0x1234, 7, msgs, 2 * L4FRAG_DATA + 5) == 0 && tx.count == 3, "3 fragments");
+  int built = 0;
+  while (L4FragTx_next(&tx, &f)) {
+    built++;
+  }
+  CHECK(built == 3, "next builds each fragment once");
+  CHECK(ORBIT_load_be16(f.MsgID) == 0x1234 && f.Port == 7 && f.Type == L4TYPE_DATA &&
+        ORBIT_load_be16(f.FragIndex) == 2 && ORBIT_load_be16(f.FragCount) == 3 &&
+        ORBIT_load_be32(f.TotalLen) == 2 * L4FRAG_DATA + 5, "header fields");
+  CHECK(memcmp(f.Data, msgs + 2 * L4FRAG_DATA, 5) == 0 && f.Data[5] == 0 && f.Data[L4FRAG_DATA - 1] == 0,
+        "last fragment data, zero tail");
+
+  /* 2. NSRC sources, shuffled / duplicated / interleaved, many rounds */
+  Sink_t k;
+  memset(&k, 0, sizeof(k));
+  L4Reasm_t r;
+  k.r = &r;
+  CHECK(L4Reasm_init(&r, NSRC, MAX_MSG, 1000000, 100, 0, NULL, NULL) == -1, "no deliver rejected");
+  CHECK(L4Reasm_init(&r, NSRC, L4FRAG_MAX_MSG + 1, 1000000, 100, 0, sink_deliver, &k) == -1, "max_msg too big");
+  CHECK(L4Reasm_init(&r, NSRC, MAX_MSG, 1000000, 100, 0, sink_deliver, &k) == 0, "init");
+  uint8_t src[NSRC][16];
+  L4FragTx_t txs[NSRC];
+  uint16_t *orders[NSRC];
+  uint32_t pos[NSRC];
+  for (uint32_t s = 0; s < NSRC; s++) {
+    mkaddr(src[s], s);
+    orders[s] = malloc(L4Frag_count(MAX_MSG) * 2 * sizeof(uint16_t));
+    if (orders[s] == NULL) {
+      perror("malloc failed");
+      return EXIT_FAILURE;
+    }
+  }
+  uint64_t now = 0, sent = 0, dup_sent = 0, stray = 0, singles = 0;
+  const uint32_t rounds = 40;
+  for (uint32_t round = 0; round < rounds; round++) {
+    uint32_t live = 0;
+    for (uint32_t s = 0; s < NSRC; s++) {
+      uint32_t len = 1 + (uint32_t)(rng() % MAX_MSG);
+      k.expect[s] = msgs + (size_t)s * MAX_MSG + rng() % (MAX_MSG - len + 1);
+      k.len[s] = len;
+      L4FragTx_init(&txs[s], (uint16_t)(round * NSRC + s), (uint8_t)(round * NSRC + s + s), k.expect[s], len);
+      uint32_t n = txs[s].count;
+      singles += n == 1;
+      for (uint32_t i = 0; i < n; i++) {
+        orders[s][i] = (uint16_t)i;
+      }
+      /* about 1 in 8 fragments arrives twice */
+      uint32_t m = n;
+      for (uint32_t i = 0; i < n; i++) {
+        if (rng() % 8 == 0) {
+          orders[s][m++] = (uint16_t)i;
+        }
+      }
+      dup_sent += m - n;
+      shuffle(orders[s], m);
+      pos[s] = m;
+      live += m;
+    }
+    while (live > 0) {
+      uint32_t s = (uint32_t)(rng() % NSRC);
+      if (pos[s] == 0) {
+        continue;
+      }
+      L4FragTx_build(&txs[s], orders[s][--pos[s]], &f);
+      L4ReasmStatus_t st = L4Reasm_push(&r, src[s], &f, now);
+      stray += st == L4REASM_BAD || st == L4REASM_TOO_BIG;
+      sent++;
+      live--;
+      now += 10;
+    }
+    L4Reasm_poll(&r, now);
+  }
+  uint32_t delivered = 0;
+  for (uint32_t s = 0; s < NSRC; s++) {
+    delivered += k.delivered[s];
+  }
+  printf("interleaved: %llu fragments sent, %llu stored, %llu dups, %u messages, %llu in place, %zu bytes table\n",
+         (unsigned long long)sent, (unsigned long long)r.fragments, (unsigned long long)r.dups, delivered,
+         (unsigned long long)k.in_place, L4Reasm_bytes(&r));
+  CHECK(delivered == rounds * NSRC && k.errors == 0, "every message delivered once, byte exact");
+  CHECK(r.dups == dup_sent && stray == 0, "duplicates caught");
+  CHECK(k.in_place + singles == r.messages, "reassembled in place");
+  CHECK(L4Reasm_pending(&r) == 0 && r.expired == 0 && r.evicted == 0, "nothing left behind");
+
+  /* 3. missing fragments, then selective repeat */
+  uint32_t len = 40 * L4FRAG_DATA + 9;
+  k.expect[1] = msgs;
+  k.len[1] = len;
+  k.delivered[1] = 0;
+  L4FragTx_init(&tx, 500, (uint8_t)(500 + 1), msgs, len);
+  uint16_t miss[64];
+  CHECK(L4Reasm_missing(&r, src[1], 500, miss, 64) == -1, "unknown message");
+  for (uint16_t i = 0; i < tx.count; i++) {
+    if (i % 7 != 3 && i != 40) {
+      L4FragTx_build(&tx, i, &f);
+      L4Reasm_push(&r, src[1], &f, now);
+    }
+  }
+  int32_t nm = L4Reasm_missing(&r, src[1], 500, miss, 64);
+  int ok = nm == 7;
+  for (int32_t i = 0; ok && i < 6; i++) {
+    ok = miss[i] == 7 * i + 3;
+  }
+  CHECK(ok && miss[6] == 40, "missing list exact and in order");
+  CHECK(L4Reasm_missing(&r, src[1], 500, miss, 2) == 7 && miss[1] == 10, "short output, full count");
+  for (int32_t i = 0; i < nm; i++) {
+    L4FragTx_build(&tx, miss[i], &f);
+    L4Reasm_push(&r, src[1], &f, now);
+  }
+  CHECK(k.delivered[1] == 1 && k.errors == 0 && L4Reasm_missing(&r, src[1], 500, miss, 64) == -1,
+        "repeat completes the message");
+
+  /* 4. timeout, eviction, bad headers, single fragment */
+  L4FragTx_init(&tx, 600, 0, msgs, 3 * L4FRAG_DATA);
+  L4FragTx_build(&tx, 0, &f);
+  CHECK(L4Reasm_push(&r, src[2], &f, now) == L4REASM_PART, "part");
+  CHECK(L4Reasm_push(&r, src[2], &f, now) == L4REASM_DUP, "dup");
+  CHECK(L4Reasm_poll(&r, now + 999900) == 0, "not yet timed out");
+  L4FragTx_build(&tx, 1, &f);
+  L4Reasm_push(&r, src[2], &f, now + 500000);
+  CHECK(L4Reasm_poll(&r, now + 1000100) == 0, "new fragment restarts the timeout");
+  CHECK(L4Reasm_poll(&r, now + 1500100) == 1 && r.expired == 1, "timed out");
+  CHECK(L4Reasm_missing(&r, src[2], 600, miss, 64) == -1, "timed out message gone");
+  now += 2000000;
+  L4Reasm_poll(&r, now);
+
+  uint8_t other[NSRC + 1][16];
+  for (uint32_t s = 0; s <= NSRC; s++) {
+    mkaddr(other[s], 10 + s);
+    L4FragTx_init(&tx, 700, 0, msgs, 2 * L4FRAG_DATA);
+    L4FragTx_build(&tx, 0, &f);
+    L4Reasm_push(&r, other[s], &f, now + s);
+    if (s == NSRC - 1) {
+      CHECK(r.evicted == 0, "table full, no eviction yet");
+    }
+  }
+  CHECK(r.evicted == 1 && L4Reasm_missing(&r, other[0], 700, miss, 64) == -1, "full table evicts the oldest");
+  CHECK(L4Reasm_missing(&r, other[1], 700, miss, 64) == 1 && miss[0] == 1, "others kept");
+
+  L4FragTx_init(&tx, 700, 9, msgs, 2 * L4FRAG_DATA);
+  L4FragTx_build(&tx, 1, &f);
+  CHECK(L4Reasm_push(&r, other[1], &f, now) == L4REASM_BAD, "port differs from the pending message");
+  L4FragTx_build(&tx, 0, &f);
+  f.Type = 0x7F;
+  CHECK(L4Reasm_push(&r, src[3], &f, now) == L4REASM_BAD, "unknown type");
+  L4FragTx_build(&tx, 0, &f);
+  ORBIT_store_be16(f.FragCount, 3);
+  CHECK(L4Reasm_push(&r, src[3], &f, now) == L4REASM_BAD, "count / length mismatch");
+  L4FragTx_build(&tx, 0, &f);
+  ORBIT_store_be16(f.FragIndex, 2);
+  CHECK(L4Reasm_push(&r, src[3], &f, now) == L4REASM_BAD, "index past count");
+  L4FragTx_build(&tx, 0, &f);
+  ORBIT_store_be32(f.TotalLen, 0);
+  ORBIT_store_be16(f.FragCount, 0);
+  CHECK(L4Reasm_push(&r, src[3], &f, now) == L4REASM_BAD, "zero length");
+  L4FragTx_init(&tx, 701, 0, msgs, MAX_MSG + 1);
+  L4FragTx_build(&tx, 0, &f);
+  CHECK(L4Reasm_push(&r, src[3], &f, now) == L4REASM_TOO_BIG && r.too_big == 1, "too big for the table");
+
+  k.expect[4] = msgs + 77;
+  k.len[4] = 100;
+  k.delivered[4] = 0;
+  L4FragTx_init(&tx, 800, (uint8_t)(800 + 4), k.expect[4], 100);
+  L4FragTx_build(&tx, 0, &f);
+  CHECK(L4Reasm_push(&r, src[4], &f, now) == L4REASM_DONE && k.delivered[4] == 1, "single fragment delivered");
+  CHECK(k.last == f.Data, "straight from the fragment");
+  L4Reasm_free(&r);
+
+  /* 5. reassembly of one shuffled image: ns per fragment, bitmap + offsets against a sorted list */
+  printf("\n%10s %10s %14s %14s %12s\n", "image", "fragments", "table ns/frag", "list ns/frag", "table MB/s");
+  uint8_t *image = malloc(4u << 20);
+  ListFrag_t *pool = malloc(L4FRAG_MAX_COUNT * sizeof(ListFrag_t));
+  if (image == NULL || pool == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < (4u << 20); i++) {
+    image[i] = (uint8_t)(i * 31 + (i >> 9));
+  }
+  double table_1m = 0, list_1m = 0;
+  for (uint32_t size = 64u << 10; size <= 4u << 20; size <<= 2) {
+    uint64_t got = 0;
+    CHECK(L4Reasm_init(&r, 1, size, 1000000, 100, 0, null_deliver, &got) == 0, "init bench");
+    L4FragTx_init(&tx, 1, 0, image, size);
+    uint32_t n = tx.count;
+    for (uint32_t i = 0; i < n; i++) {
+      order[i] = (uint16_t)i;
+    }
+    shuffle(order, n);
+    L4Frag_t *frags = malloc((size_t)n * sizeof(L4Frag_t));
+    if (frags == NULL) {
+      perror("malloc failed");
+      return EXIT_FAILURE;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+      L4FragTx_build(&tx, order[i], &frags[i]);
+    }
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < n; i++) {
+      L4Reasm_push(&r, src[0], &frags[i], 0);
+    }
+    double t1 = now_sec();
+    CHECK(got == size && r.messages == 1, "image reassembled");
+
+    /* sorted insert, then a walk to copy out */
+    ListFrag_t *head = NULL;
+    double t2 = now_sec();
+    for (uint32_t i = 0; i < n; i++) {
+      ListFrag_t *lf = &pool[i];
+      lf->index = ORBIT_load_be16(frags[i].FragIndex);
+      memcpy(lf->data, frags[i].Data, L4FRAG_DATA);
+      ListFrag_t **pp = &head;
+      while (*pp != NULL && (*pp)->index < lf->index) {
+        pp = &(*pp)->next;
+      }
+      lf->next = *pp;
+      *pp = lf;
+    }
+    uint32_t off = 0;
+    for (ListFrag_t *lf = head; lf != NULL; lf = lf->next) {
+      uint32_t c = size - off < L4FRAG_DATA ? size - off : L4FRAG_DATA;
+      memcpy(r.buf + off, lf->data, c);
+      off += c;
+    }
+    double t3 = now_sec();
+    CHECK(off == size && memcmp(r.buf, image, size) == 0, "list reassembles the same image");
+
+    double tn = (t1 - t0) * 1e9 / n, ln = (t3 - t2) * 1e9 / n;
+    printf("%9uK %10u %14.1f %14.1f %12.0f\n", size >> 10, n, tn, ln, size / (t1 - t0) / 1e6);
+    if (size == 1u << 20) {
+      table_1m = tn;
+      list_1m = ln;
+    }
+    free(frags);
+    L4Reasm_free(&r);
+  }
+  CHECK(table_1m * 10 < list_1m, "flat cost per fragment, far below the sorted list at 1M");
+
+  for (uint32_t s = 0; s < NSRC; s++) {
+    free(orders[s]);
+  }
+  free(image);
+  free(pool);
+  free(order);
+  free(msgs);
+
+  printf("\nORBIT L4 Fragmentation / Reassembly Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,368 @@
+/*
+ * File:        test/l4_rel_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT L4 Reliable Transport Test Program.
+ *    Bulk transfers over a half-duplex radio chain model (one frame per
+ *    node per airtime slot, no two senders within 2 hops, per-hop loss,
+ *    bounded relay queues): byte-exact in-order delivery, RTT estimate,
+ *    a single loss repaired by SACK without RTO, a link outage repaired
+ *    by RTO backoff, receiver duplicates / window / idle close, and
+ *    throughput against stop-and-wait for 1 .. 8 hops.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include "../src/L4_rel.h"
+#include "../src/L2D5_struct.h"
+#include "../src/ORBIT_bytes.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define MAX_HOPS 8
+#define QCAP     64
+#define XFER     (128 * 1024)
+
+
+typedef struct {
+  uint8_t pkt[176];
+  int8_t  dir;                            // +1 toward node hops, -1 toward node 0
+} Frame_t;
+
+typedef struct {
+  Frame_t  q[QCAP];
+  uint32_t head;
+  uint32_t count;
+} Queue_t;
+
+typedef struct {
+  uint32_t  hops;
+  double    loss;
+  int64_t   drop_seq;                     // first copy of this data Seq lost, -1 = none
+  uint64_t  down_from;                    // every frame lost in [down_from, down_to)
+  uint64_t  down_to;
+  Queue_t   node[MAX_HOPS + 1];
+  L4Rel_t   a;                            // sender at node 0
+  L4Rel_t   b;                            // receiver at node hops
+  uint8_t   addr_a[16];
+  uint8_t   addr_b[16];
+  uint64_t  now;
+  uint64_t  slots;
+  uint64_t  frames;                       // transmissions on every hop
+  uint64_t  queue_drops;
+  /* receiver check */
+  const uint8_t *expect;
+  uint32_t  got;
+  uint64_t  errors;
+} Chain_t;
+
+
+static uint64_t rng_state;
+
+static inline uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static void q_push(Chain_t *_c, uint32_t _n, const void *_pkt, int8_t _dir) {
+  Queue_t *q = &_c->node[_n];
+  if (q->count == QCAP) {
+    _c->queue_drops++;
+    return;
+  }
+  Frame_t *f = &q->q[(q->head + q->count++) % QCAP];
+  memcpy(f->pkt, _pkt, 176);
+  f->dir = _dir;
+}
+
+static void out_a(void *_ctx, uint8_t _tag, const uint8_t *_peer, const void *_pkt, uint64_t _now) {
+  (void)_tag;
+  (void)_peer;
+  (void)_now;
+  q_push(_ctx, 0, _pkt, +1);
+}
+
+static void out_b(void *_ctx, uint8_t _tag, const uint8_t *_peer, const void *_pkt, uint64_t _now) {
+  (void)_tag;
+  (void)_peer;
+  (void)_now;
+  Chain_t *c = _ctx;
+  q_push(c, c->hops, _pkt, -1);
+}
+
+static void data_b(void *_ctx, const uint8_t *_src, uint16_t _conn_id, const uint8_t *_data, uint32_t _len) {
+  (void)_src;
+  (void)_conn_id;
+  Chain_t *c = _ctx;
+  if (c->expect == NULL || memcmp(_data, c->expect + c->got, _len) != 0) {
+    c->errors++;
+  }
+  c->got += _len;
+}
+
+static void data_none(void *_ctx, const uint8_t *_src, uint16_t _conn_id, const uint8_t *_data, uint32_t _len) {
+  (void)_ctx;
+  (void)_src;
+  (void)_conn_id;
+  (void)_data;
+  (void)_len;
+}
+
+static int chain_init(Chain_t *_c, uint32_t _hops, double _loss, const L4RelConfig_t *_cfg) {
+  memset(_c, 0, sizeof(*_c));
+  _c->hops = _hops;
+  _c->loss = _loss;
+  _c->drop_seq = -1;
+  memset(_c->addr_a, 0xA0, 16);
+  memset(_c->addr_b, 0xB0, 16);
+  if (L4Rel_init(&_c->a, _cfg, 1, 1, 0, out_a, data_none, _c) != 0 ||
+      L4Rel_init(&_c->b, _cfg, 1, 1, 0, out_b, data_b, _c) != 0) {
+    return -1;
+  }
+  return L4Rel_connect(&_c->a, _c->addr_b, 7, L2D5TAG_TCP_DATA_RM, (uint8_t)_hops, 0);
+}
+
+static void chain_free(Chain_t *_c) {
+  L4Rel_free(&_c->a);
+  L4Rel_free(&_c->b);
+}
+
+/* one airtime slot: timers, then every node allowed to send does */
+static void chain_slot(Chain_t *_c, uint64_t _air) {
+  L4Rel_poll(&_c->a, _c->now);
+  L4Rel_poll(&_c->b, _c->now);
+
+  uint32_t order[MAX_HOPS + 1];
+  int      tx[MAX_HOPS + 1];
+  for (uint32_t i = 0; i <= _c->hops; i++) {
+    order[i] = i;
+    tx[i] = 0;
+  }
+  for (uint32_t i = _c->hops + 1; i > 1; i--) {
+    uint32_t j = (uint32_t)(rng() % i), t = order[i - 1];
+    order[i - 1] = order[j];
+    order[j] = t;
+  }
+  /* carrier sense: no two senders within 2 hops */
+  for (uint32_t k = 0; k <= _c->hops; k++) {
+    uint32_t i = order[k];
+    int ok = _c->node[i].count != 0;
+    for (uint32_t j = (i >= 2 ? i - 2 : 0); ok && j <= i + 2 && j <= _c->hops; j++) {
+      ok = !tx[j];
+    }
+    tx[i] = ok;
+  }
+
+  _c->now += _air;
+  _c->slots++;
+  Frame_t sent[MAX_HOPS + 1];
+  uint32_t to[MAX_HOPS + 1], n = 0;
+  for (uint32_t i = 0; i <= _c->hops; i++) {
+    if (!tx[i]) {
+      continue;
+    }
+    Queue_t *q = &_c->node[i];
+    Frame_t *f = &q->q[q->head];
+    q->head = (q->head + 1) % QCAP;
+    q->count--;
+    _c->frames++;
+    bool lost = (double)(rng() >> 11) / 9007199254740992.0 < _c->loss ||
+                (_c->now > _c->down_from && _c->now <= _c->down_to);
+    if (_c->drop_seq >= 0 && f->pkt[2] == L4TYPE_SEG && ORBIT_load_be32(f->pkt + 4) == (uint32_t)_c->drop_seq) {
+      _c->drop_seq = -1;
+      lost = true;
+    }
+    if (!lost) {
+      sent[n] = *f;
+      to[n++] = (uint32_t)((int32_t)i + f->dir);
+    }
+  }
+  /* receptions after every sender has picked its frame */
+  for (uint32_t k = 0; k < n; k++) {
+    if (to[k] == _c->hops && sent[k].dir > 0) {
+      L4Rel_input(&_c->b, _c->addr_a, L2D5TAG_TCP_DATA_RM, sent[k].pkt, _c->now);
+    } else if (to[k] == 0 && sent[k].dir < 0) {
+      L4Rel_input(&_c->a, _c->addr_b, L2D5TAG_TCP_DATA_RM, sent[k].pkt, _c->now);
+    } else {
+      q_push(_c, to[k], sent[k].pkt, sent[k].dir);
+    }
+  }
+}
+
+/* pushes _len bytes through, returns slots used (UINT64_MAX on timeout) */
+static uint64_t chain_transfer(Chain_t *_c, int32_t _flow, const uint8_t *_data, uint32_t _len, uint64_t _air,
+                               uint64_t _max_slots) {
+  uint32_t queued = 0;
+  uint64_t start = _c->slots;
+  _c->expect = _data;
+  while (_c->got < _len || L4Rel_outstanding(&_c->a, (uint32_t)_flow) != 0) {
+    if (_c->slots - start > _max_slots) {
+      return UINT64_MAX;
+    }
+    if (queued < _len) {
+      queued += L4Rel_send(&_c->a, (uint32_t)_flow, _data + queued, _len - queued, _c->now);
+    }
+    chain_slot(_c, _air);
+  }
+  return _c->slots - start;
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  uint8_t *data = malloc(XFER);
+  if (data == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  for (uint32_t i = 0; i < XFER; i++) {
+    data[i] = (uint8_t)rng();
+  }
+  L4RelConfig_t cfg;
+  L4Rel_config_default(&cfg);
+  const uint64_t air = cfg.airtime;
+  Chain_t *c = malloc(sizeof(Chain_t));
+  if (c == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+
+  L4RelConfig_t bad = cfg;
+  bad.max_cwnd = L4REL_WINDOW + 1;
+  L4Rel_t r;
+  CHECK(L4Rel_init(&r, &bad, 1, 1, 0, out_a, data_none, c) == -1, "max_cwnd over the window rejected");
+
+  /* 1. clean 3-hop transfer, RTT estimate */
+  int32_t f = chain_init(c, 3, 0.0, &cfg);
+  CHECK(f == 0, "connect");
+  uint64_t slots = chain_transfer(c, f, data, XFER, air, 100000);
+  L4RelTx_t *t = &c->a.tx[0];
+  printf("clean 3 hops: %llu slots, srtt %.1f ms (min %.1f), rto %.1f ms, cwnd %u, %llu retransmits, "
+         "%llu acks, %llu queue drops\n", (unsigned long long)slots, t->srtt / 1000.0, t->rtt_min / 1000.0,
+         t->rto / 1000.0, t->cwnd, (unsigned long long)t->retransmits, (unsigned long long)c->b.rx[0].acks_sent,
+         (unsigned long long)c->queue_drops);
+  CHECK(slots != UINT64_MAX && c->got == XFER && c->errors == 0, "delivered, in order, byte exact");
+  CHECK(t->retransmits == 0 && t->rto_fired == 0 && c->queue_drops == 0, "no loss, no queue overflow");
+  CHECK(t->rtt_min >= 6 * air && t->srtt < 40 * air, "RTT at least the 6 hops there and back");
+  CHECK(t->rto >= cfg.min_rto && t->bytes_acked == XFER, "RTO floor, all acknowledged");
+  CHECK(c->b.rx[0].acks_sent * 3 < c->b.rx[0].segs, "delayed ACKs");
+  chain_free(c);
+
+  /* 2. one data segment lost: SACK / RACK resends it, no RTO */
+  f = chain_init(c, 2, 0.0, &cfg);
+  c->drop_seq = 40;
+  slots = chain_transfer(c, f, data, XFER, air, 100000);
+  t = &c->a.tx[0];
+  CHECK(c->got == XFER && c->errors == 0, "loss repaired");
+  CHECK(t->retransmits == 1 && t->lost_marked == 1 && t->rto_fired == 0, "one fast retransmit, no RTO");
+  CHECK(t->decreases == 0, "no queue, no backoff");
+  chain_free(c);
+
+  /* 3. the link goes down for 4 s: RTO with backoff, then recovery */
+  f = chain_init(c, 2, 0.0, &cfg);
+  c->down_from = 200 * air;
+  c->down_to = c->down_from + 4000000;
+  slots = chain_transfer(c, f, data, XFER, air, 200000);
+  t = &c->a.tx[0];
+  printf("outage: %llu slots, %llu RTOs, %llu retransmits\n", (unsigned long long)slots,
+         (unsigned long long)t->rto_fired, (unsigned long long)t->retransmits);
+  CHECK(c->got == XFER && c->errors == 0, "outage survived");
+  CHECK(t->rto_fired >= 2 && t->rto_fired < 8, "RTO backs off");
+  chain_free(c);
+
+  /* 4. receiver edges */
+  f = chain_init(c, 1, 0.0, &cfg);
+  L4Seg_t g;
+  memset(&g, 0, sizeof(g));
+  ORBIT_store_be16(g.ConnID, 9);
+  g.Type = L4TYPE_SEG;
+  ORBIT_store_be16(g.Len, 10);
+  c->expect = data;
+  memcpy(g.Data, data, 10);
+  L4Rel_input(&c->b, c->addr_a, L2D5TAG_TCP_DATA_DC, &g, 0);
+  L4Rel_input(&c->b, c->addr_a, L2D5TAG_TCP_DATA_DC, &g, 0);
+  L4RelRx_t *x = &c->b.rx[0];
+  CHECK(x->open && x->rcv_nxt == 1 && x->dups == 1 && c->got == 10, "duplicate dropped");
+  CHECK(x->acks_sent == 1 && c->node[1].count == 1, "duplicate ACKed at once");
+  ORBIT_store_be32(g.Seq, 1 + L4REL_WINDOW);
+  L4Rel_input(&c->b, c->addr_a, L2D5TAG_TCP_DATA_DC, &g, 0);
+  CHECK(x->out_of_window == 1, "beyond the window dropped");
+  ORBIT_store_be32(g.Seq, 3);
+  L4Rel_input(&c->b, c->addr_a, L2D5TAG_TCP_DATA_DC, &g, 0);
+  CHECK(x->ooo == 1 && x->acks_sent == 2, "new hole ACKed at once");
+  L4Ack_t *ack = (L4Ack_t *)c->node[1].q[1].pkt;
+  CHECK(ORBIT_load_be32(ack->CumAck) == 1 && ack->SackMap[0] == 0x02, "SACK bit for seq 3");
+  ORBIT_store_be16(g.ConnID, 10);
+  L4Rel_input(&c->b, c->addr_a, L2D5TAG_TCP_DATA_DC, &g, 0);
+  CHECK(c->b.rx_full == 1, "receive table full");
+  ORBIT_store_be16(g.Len, 0);
+  ORBIT_store_be16(g.ConnID, 9);
+  L4Rel_input(&c->b, c->addr_a, L2D5TAG_TCP_DATA_DC, &g, 0);
+  L4Rel_input(&c->a, c->addr_a, L2D5TAG_TCP_DATA_DC, ack, 0);
+  CHECK(c->b.stray == 1 && c->a.stray == 1, "empty segment, ACK from a stranger");
+  L4Rel_poll(&c->b, cfg.rx_idle - 1000);
+  CHECK(x->open, "not idle yet");
+  L4Rel_poll(&c->b, cfg.rx_idle + 1000);
+  CHECK(!x->open, "idle receive flow closed");
+  chain_free(c);
+
+  /* 5. throughput: windowed vs stop-and-wait */
+  L4RelConfig_t sw = cfg;
+  sw.max_cwnd = 1;
+  sw.ack_every = 1;
+  printf("\n%4s %6s %22s %22s %8s %10s\n", "hops", "loss", "windowed % chan/bound", "stop-wait % chan/bound",
+         "speedup", "retx %");
+  const uint32_t hop_set[] = { 1, 2, 3, 5, 8 };
+  const double loss_set[] = { 0.0, 0.02 };
+  for (uint32_t li = 0; li < 2; li++) {
+    for (uint32_t hi = 0; hi < 5; hi++) {
+      uint32_t h = hop_set[hi];
+      double chan[2], retx = 0;
+      for (int mode = 0; mode < 2; mode++) {
+        f = chain_init(c, h, loss_set[li], mode == 0 ? &cfg : &sw);
+        slots = chain_transfer(c, f, data, XFER, air, 2000000);
+        CHECK(slots != UINT64_MAX && c->got == XFER && c->errors == 0, "bulk transfer complete");
+        /* share of one hop's capacity (a full 164-byte segment every airtime) */
+        chan[mode] = 100.0 * XFER / L4SEG_DATA / (double)slots;
+        if (mode == 0) {
+          retx = 100.0 * c->a.tx[0].retransmits / (double)c->a.tx[0].segs_sent;
+        }
+        chain_free(c);
+      }
+      /* a chain moves one frame per min(hops, 3) slots at best, and the ACKs share them */
+      double bound = 100.0 / ((h < 3 ? h : 3) * (1.0 + 1.0 / cfg.ack_every));
+      printf("%4u %5.0f%% %10.1f / %7.1f %12.1f / %7.1f %7.2fx %9.1f\n", h, loss_set[li] * 100, chan[0],
+             100.0 * chan[0] / bound, chan[1], 100.0 * chan[1] / bound, chan[0] / chan[1], retx);
+      if (li == 0) {
+        CHECK(chan[0] / bound > (h <= 3 ? 0.85 : 0.55), "windowed near the chain bound");
+        CHECK(chan[0] > (h < 5 ? 1.4 : 1.8) * chan[1], "ahead of stop-and-wait");
+      } else {
+        CHECK(chan[0] > (h < 2 ? 1.2 : 1.5) * chan[1], "ahead of stop-and-wait with 2 % loss per hop");
+      }
+    }
+  }
+
+  free(c);
+  free(data);
+
+  printf("\nORBIT L4 Reliable Transport Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
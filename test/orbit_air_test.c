@@ -0,0 +1,354 @@
+/*
+ * File:        test/orbit_air_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT Virtual Air Medium Test Program.
+ *    Range topology, clean delivery in order, loss rate, bit errors
+ *    against the FCS and the deframer (with noise bursts for resync),
+ *    latency and bitrate pacing, sender backlog, receiver overrun, and
+ *    a multi-process run with forked node processes reporting the
+ *    aggregate delivery rate.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - The medium file goes to /dev/shm (or /tmp when missing). Link -lm.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include "../src/ORBIT_air.h"
+#include "../src/ORBIT_bytes.h"
+#include "../src/L2_crc32.h"
+#include "../src/L2_deframer.h"
+#include <sys/random.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NFRAMES  20000
+#define PROCS    8
+#define PER_PROC 50000
+
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void make_frame(L2Frame *f, uint16_t node, uint32_t seq) {
+  for (size_t b = 0; b < sizeof(*f); b++) {
+    ((uint8_t *)f)[b] = (uint8_t)rng();
+  }
+  f->SFD = MAGIC_L2LAYER_SFD;
+  f->EFD = MAGIC_L2LAYER_EFD;
+  ORBIT_store_be16(f->Payload, node);
+  ORBIT_store_be32(f->Payload + 2, seq);
+  L2CRC32_seal(f);
+}
+
+/* Receives until nothing is deliverable; counts per sender */
+static size_t drain(ORBITAir_t *a, uint64_t now, uint32_t *from, int *order_bad, uint32_t *next) {
+  static L2Frame buf[256];
+  static ORBITAirRxMeta_t meta[256];
+  size_t total = 0, n;
+  while ((n = ORBITAir_recv(a, buf, meta, 256, now)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      uint16_t src = meta[i].src;
+      from[src]++;
+      if (next != NULL) {
+        uint32_t seq = ORBIT_load_be32(buf[i].Payload + 2);
+        *order_bad += ORBIT_load_be16(buf[i].Payload) != src || seq < next[src] || !L2CRC32_check(&buf[i]);
+        next[src] = seq + 1;
+      }
+    }
+    total += n;
+  }
+  return total;
+}
+
+
+/* Forked node: send PER_PROC frames in bursts, receive throughout */
+typedef struct {
+  uint64_t sent, received, overrun, corrupt;
+  double   secs;
+} proc_report_t;
+
+static void node_proc(const char *path, int out_fd) {
+  ORBITAir_t a;
+  proc_report_t rep = {0};
+  if (ORBITAir_attach(&a, path, -1) != 0) {
+    _exit(2);
+  }
+  static L2Frame buf[256];
+  L2Frame f;
+  make_frame(&f, a.self, 0);
+  double t0 = now_sec(), quiet = 0;
+  while (rep.sent < PER_PROC || now_sec() - quiet < 0.05) {
+    for (int k = 0; k < 32 && rep.sent < PER_PROC; k++) {
+      rep.sent += ORBITAir_send(&a, &f, ORBITAir_now());
+    }
+    size_t n, got = 0;
+    while ((n = ORBITAir_recv(&a, buf, NULL, 256, ORBITAir_now())) > 0) {
+      for (size_t i = 0; i < n; i++) {
+        rep.corrupt += !L2CRC32_check(&buf[i]);
+      }
+      got += n;
+    }
+    rep.received += got;
+    if (got != 0 || rep.sent < PER_PROC) {
+      quiet = now_sec();
+    }
+    sched_yield();
+  }
+  rep.secs = now_sec() - t0;
+  rep.overrun = a.stats.overrun;
+  ORBITAir_detach(&a);
+  ssize_t w = write(out_fd, &rep, sizeof(rep));
+  _exit(w == sizeof(rep) ? 0 : 3);
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  char path[64];
+  snprintf(path, sizeof(path), "%s/orbit_air_test.%d", access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp",
+           (int)getpid());
+  ORBITAirParams_t prm = {0};
+  CHECK(ORBITAir_create(path, 4, 1 << 15, &prm) == 0, "create");
+
+  /* A(0) - 100 m - B(100) - 100 m - C(200), range 150: A and C cannot hear each other */
+  ORBITAir_t a, b, c, d;
+  CHECK(ORBITAir_attach(&a, path, 0) == 0 && ORBITAir_attach(&b, path, -1) == 0 && ORBITAir_attach(&c, path, -1) == 0,
+        "attach three nodes");
+  CHECK(a.self == 0 && b.self == 1 && c.self == 2, "first free node ids");
+  CHECK(ORBITAir_attach(&d, path, 1) == -1, "taken node refused");
+  ORBITAir_set_position(&a, 0, 0, 150);
+  ORBITAir_set_position(&b, 100, 0, 150);
+  ORBITAir_set_position(&c, 200, 0, 150);
+
+  L2Frame f;
+  uint64_t t = ORBITAir_now();
+  for (uint32_t i = 0; i < NFRAMES; i++) {
+    make_frame(&f, 0, i);
+    ORBITAir_send(&a, &f, t);
+    make_frame(&f, 2, i);
+    ORBITAir_send(&c, &f, t);
+  }
+  make_frame(&f, 1, 0);
+  ORBITAir_send(&b, &f, t);
+  uint32_t from_a[4] = {0}, from_b[4] = {0}, from_c[4] = {0}, next[4] = {0};
+  int order_bad = 0;
+  t = ORBITAir_now();
+  drain(&a, t, from_a, &order_bad, NULL);
+  drain(&b, t, from_b, &order_bad, next);
+  drain(&c, t, from_c, &order_bad, NULL);
+  CHECK(from_b[0] == NFRAMES && from_b[2] == NFRAMES && order_bad == 0, "B hears A and C, every frame, in order");
+  CHECK(from_a[2] == 0 && from_c[0] == 0, "A and C out of range");
+  CHECK(from_a[1] == 1 && from_c[1] == 1 && from_a[0] == 0, "B heard by both, nobody hears itself");
+
+  /* loss: 10% per receiver, independent */
+  prm.loss_ppm = 100000;
+  ORBITAir_set_params(&c, &prm);
+  uint64_t lost0 = b.stats.lost;
+  memset(from_b, 0, sizeof(from_b));
+  for (uint32_t i = 0; i < NFRAMES; i++) {
+    ORBITAir_send(&a, &f, t);
+  }
+  drain(&b, ORBITAir_now(), from_b, &order_bad, NULL);
+  double kept = (double)from_b[0] / NFRAMES;
+  CHECK(kept > 0.88 && kept < 0.92 && from_b[0] + (b.stats.lost - lost0) == NFRAMES, "loss 10%");
+  printf("loss 10%%: %.2f%% delivered\n", kept * 100);
+
+  /* bit errors 1e-4: P(frame hit) = 1 - (1 - 1e-4)^1792 = 16.4%; FCS and deframer see them */
+  prm.loss_ppm = 0;
+  prm.ber_ppb = 100000;
+  prm.noise_ppm = 50000;
+  ORBITAir_set_params(&a, &prm);
+  uint64_t corrupt0 = b.stats.corrupted, flips0 = b.stats.bit_errors;
+  L2Deframer_t dfr;
+  L2Deframer_init(&dfr, 64 * sizeof(L2Frame), true);
+  uint32_t good = 0, crc_bad = 0, flipped = 0, meta_bad = 0, sent_ber = NFRAMES;
+  for (uint32_t i = 0; i < sent_ber; i++) {
+    make_frame(&f, 0, i);
+    ORBITAir_send(&a, &f, t);
+  }
+  static uint8_t stream[64 * 1024];
+  size_t got;
+  uint64_t now = ORBITAir_now();
+  while ((got = ORBITAir_recv_bytes(&b, stream, sizeof(stream), now)) > 0) {
+    for (size_t off = 0; off < got;) {
+      size_t took = L2Deframer_push(&dfr, stream + off, got - off);
+      const L2Frame *views[64];
+      size_t m;
+      while ((m = L2Deframer_poll(&dfr, views, 64)) > 0) {
+        good += (uint32_t)m;
+        L2Deframer_release(&dfr);
+      }
+      L2Deframer_release(&dfr);             // skipped garbage too
+      off += took;
+    }
+  }
+  uint32_t corrupted = (uint32_t)(b.stats.corrupted - corrupt0);
+  double hit = (double)corrupted / sent_ber;
+  CHECK(hit > 0.14 && hit < 0.19, "BER 1e-4: corrupted frame share");
+  CHECK(b.stats.bit_errors - flips0 >= corrupted, "flips counted");
+  /* TAG is outside the FCS: a flip there alone still passes */
+  CHECK(good <= sent_ber - corrupted * 9 / 10 && good > (sent_ber - corrupted) * 9 / 10, "deframer: clean frames pass");
+  CHECK(dfr.stats.bad_fcs + dfr.stats.bad_efd > 0 && dfr.stats.resync_bytes > 0 && b.stats.noise_bytes > 0,
+        "deframer: CRC failures and resync exercised");
+  printf("BER 1e-4: %.2f%% frames corrupted, %llu bit flips, deframer %u good / %llu bad FCS / %llu resync bytes\n",
+         hit * 100, (unsigned long long)(b.stats.bit_errors - flips0), good,
+         (unsigned long long)dfr.stats.bad_fcs, (unsigned long long)dfr.stats.resync_bytes);
+  L2Deframer_free(&dfr);
+
+  /* per-frame meta agrees with the FCS */
+  prm.noise_ppm = 0;
+  ORBITAir_set_params(&a, &prm);
+  for (uint32_t i = 0; i < 2000; i++) {
+    make_frame(&f, 0, i);
+    ORBITAir_send(&a, &f, t);
+  }
+  static L2Frame rx[256];
+  static ORBITAirRxMeta_t meta[256];
+  size_t n;
+  while ((n = ORBITAir_recv(&b, rx, meta, 256, ORBITAir_now())) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      bool ok = L2CRC32_check(&rx[i]);
+      crc_bad += !ok;
+      flipped += meta[i].flips != 0;
+      meta_bad += !ok && meta[i].flips == 0;
+    }
+  }
+  CHECK(crc_bad > 0 && crc_bad <= flipped && meta_bad == 0, "flips in meta match FCS failures");
+
+  /* latency 5 ms, 1.792 Mbit/s: one frame per ms of air, 10 ms backlog */
+  prm.ber_ppb = 0;
+  prm.latency_ns = 5000000;
+  prm.bitrate_bps = 1792000;
+  prm.backlog_ns = 10000000;
+  ORBITAir_set_params(&a, &prm);
+  memset(from_b, 0, sizeof(from_b));
+  drain(&b, UINT64_MAX, from_b, &order_bad, NULL);
+  t = ORBITAir_now();
+  a.busy_until = 0;
+  int accepted = 0;
+  for (int i = 0; i < 50; i++) {
+    accepted += ORBITAir_send(&a, &f, t);
+  }
+  CHECK(accepted == 11, "backlog: 10 ms of air time ahead, then refused");
+  CHECK(ORBITAir_recv(&b, rx, meta, 256, t + 5999999) == 0, "nothing before latency + air time");
+  n = ORBITAir_recv(&b, rx, meta, 256, t + 6000000);
+  CHECK(n == 1 && meta[0].ready_ns == t + 6000000 && meta[0].tx_ns == t, "first frame at latency + air time");
+  n = ORBITAir_recv(&b, rx + 1, meta + 1, 255, t + 1000000000ull);
+  int spacing_bad = 0;
+  for (size_t i = 1; i <= n; i++) {
+    spacing_bad += meta[i].ready_ns - meta[i - 1].ready_ns != 1000000;
+  }
+  CHECK(n == 10 && spacing_bad == 0, "frames one air time apart");
+
+  /* overrun: a receiver 3 x slots behind gets the newest slots only */
+  prm = (ORBITAirParams_t){0};
+  ORBITAir_set_params(&a, &prm);
+  uint64_t over0 = b.stats.overrun;
+  memset(from_b, 0, sizeof(from_b));
+  for (uint32_t i = 0; i < 3u << 15; i++) {
+    ORBITAir_send(&a, &f, t);
+  }
+  drain(&b, UINT64_MAX, from_b, &order_bad, NULL);
+  CHECK(from_b[0] == 1u << 15 && b.stats.overrun - over0 == 2u << 15, "overrun counted, newest kept");
+
+  /* detach frees the id */
+  ORBITAir_detach(&c);
+  CHECK(ORBITAir_attach(&d, path, -1) == 0 && d.self == 2, "detached id reused");
+  ORBITAir_detach(&d);
+  ORBITAir_detach(&a);
+  ORBITAir_detach(&b);
+
+  /* sender cost */
+  CHECK(ORBITAir_create(path, 2, 4096, NULL) == 0, "recreate");
+  ORBITAir_attach(&a, path, 0);
+  ORBITAir_attach(&b, path, 1);
+  enum { ROUNDS = 2000000 };
+  double t0 = now_sec();
+  uint64_t recvd = 0;
+  for (int i = 0; i < ROUNDS; i++) {
+    ORBITAir_send(&a, &f, 0);
+    if ((i & 63) == 63) {
+      while ((n = ORBITAir_recv(&b, rx, NULL, 256, UINT64_MAX)) > 0) {
+        recvd += n;
+      }
+    }
+  }
+  double dt = now_sec() - t0;
+  CHECK(recvd == ROUNDS, "one-to-one: every frame");
+  printf("one sender, one receiver, one thread: %.2f Mframes/s\n", ROUNDS / dt / 1e6);
+  ORBITAir_detach(&a);
+  ORBITAir_detach(&b);
+
+  /* processes: PROCS nodes all in range of each other */
+  CHECK(ORBITAir_create(path, PROCS, 1 << 14, NULL) == 0, "create for processes");
+  int pipes[PROCS][2];
+  pid_t pids[PROCS];
+  t0 = now_sec();
+  for (int i = 0; i < PROCS; i++) {
+    if (pipe(pipes[i]) != 0) {
+      return EXIT_FAILURE;
+    }
+    pids[i] = fork();
+    if (pids[i] == 0) {
+      close(pipes[i][0]);
+      node_proc(path, pipes[i][1]);
+    }
+    close(pipes[i][1]);
+  }
+  proc_report_t sum = {0};
+  int proc_bad = 0;
+  for (int i = 0; i < PROCS; i++) {
+    proc_report_t rep;
+    int status = 0;
+    proc_bad += read(pipes[i][0], &rep, sizeof(rep)) != sizeof(rep);
+    waitpid(pids[i], &status, 0);
+    proc_bad += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    close(pipes[i][0]);
+    sum.sent += rep.sent;
+    sum.received += rep.received;
+    sum.overrun += rep.overrun;
+    sum.corrupt += rep.corrupt;
+  }
+  dt = now_sec() - t0;
+  CHECK(proc_bad == 0, "node processes ran");
+  CHECK(sum.corrupt == 0, "processes: no torn frames");
+  CHECK(sum.sent == (uint64_t)PROCS * PER_PROC, "processes: every send accepted");
+  printf("%d processes: %llu sent, %llu delivered (%llu overrun) in %.3f s = %.2f Mframes/s delivered\n", PROCS,
+         (unsigned long long)sum.sent, (unsigned long long)sum.received, (unsigned long long)sum.overrun, dt,
+         sum.received / dt / 1e6);
+  unlink(path);
+
+  printf("\nORBIT Virtual Air Medium Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
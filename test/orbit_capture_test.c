@@ -0,0 +1,324 @@
+/*
+ * File:        test/orbit_capture_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT pcapng Capture Test Program.
+ *    Write / decode round trip over several lanes (frame, timestamp, RSSI,
+ *    interface, annotations), rotation with a file limit, drop accounting
+ *    with RX threads outrunning the writer, a damaged block, the text
+ *    line, and capture / decode rates.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - Build with -pthread. Files go to /tmp.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "../src/ORBIT_capture.h"
+#include "../src/ORBIT_schema.h"
+#include "../src/L2_crc32.h"
+#include "../src/L2D5_classify.h"
+#include <sys/random.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define LANES    3
+#define PER_LANE 2000
+#define BURST    200000
+
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Lane k, sequence i: TAG cycles the four types, seq in the payload tail */
+static void make_frame(L2Frame *f, uint16_t lane, uint32_t i) {
+  static const uint8_t tags[] = { L2D5TAG_HELLO_PKT_NB, L2D5TAG_HELLO_PKT_RM, L2D5TAG_TCP_DATA_DC,
+                                  L2D5TAG_TCP_DATA_RM };
+  L2D5Frame_t *l = (L2D5Frame_t *)f->Payload;
+  for (size_t b = 0; b < sizeof(*f); b++) {
+    ((uint8_t *)f)[b] = (uint8_t)rng();
+  }
+  f->SFD = MAGIC_L2LAYER_SFD;
+  f->EFD = MAGIC_L2LAYER_EFD;
+  l->TAG = tags[i % 4];
+  l->FLAG = (uint8_t)(i * 7);
+  L2D5Frame_set_TTL(l, (uint16_t)(i + lane));
+  ORBIT_store_be32(l->Payload + 170, (uint32_t)lane << 24 | i);
+  L2CRC32_seal(f);
+  if (i % 97 == 5) {
+    f->Payload[100] ^= 1;                   // FCS failure
+  }
+}
+
+static uint64_t t_of(uint16_t lane, uint32_t i) { return 1700000000123456789ull + (uint64_t)i * 1000 + lane; }
+static int32_t rssi_of(uint16_t lane, uint32_t i) { return -40 - (int32_t)((i + lane) % 80); }
+
+/* Every record of one file; bad counts mismatches against make_frame() */
+static long read_all(const char *path, uint32_t *next_seq, int *bad, bool check) {
+  ORBITCapReader_t r;
+  ORBITCapRecord_t rec[50];
+  if (ORBITCapReader_open(&r, path, true) != 0) {
+    return -1;
+  }
+  long total = 0;
+  int n;
+  while ((n = ORBITCapReader_next(&r, rec, 50)) > 0) {
+    total += n;
+    for (int k = 0; check && k < n; k++) {
+      const ORBITCapRecord_t *c = &rec[k];
+      const L2D5Frame_t *l = (const L2D5Frame_t *)c->frame->Payload;
+      uint32_t id = ORBIT_load_be32(l->Payload + 170);
+      uint16_t lane = (uint16_t)(id >> 24);
+      uint32_t i = id & 0xFFFFFF;
+      uint8_t pri;
+      L2D5Class_t cls = L2D5Cls_frame(c->frame, &pri);
+      *bad += lane >= LANES || c->iface != lane || i != next_seq[lane];
+      *bad += c->ts_ns != t_of(lane, i) || c->rssi != rssi_of(lane, i);
+      *bad += c->cls != cls || c->pri != pri || c->tag != l->TAG;
+      *bad += c->fcs != (i % 97 != 5);
+      *bad += c->encrypted != (cls != L2D5CLS_MALFORMED && (l->TAG & L2D5CLS_TAG_ENCRYPTED) != 0);
+      *bad += c->encrypted ? c->src != NULL || c->ttl != 0
+                           : c->src != l->SrcAddress || c->dst != l->DstAddress || c->ttl != (uint16_t)(i + lane);
+      if (lane < LANES) {
+        next_seq[lane] = i + 1;
+      }
+    }
+  }
+  *bad += n < 0;
+  ORBITCapReader_close(&r);
+  return total;
+}
+
+
+/* RX thread: frames as fast as possible, the writer cannot keep up */
+typedef struct {
+  ORBITCap_t *cap;
+  uint16_t    lane;
+  uint64_t    accepted;
+} burst_arg_t;
+
+static void *burst(void *arg) {
+  burst_arg_t *a = arg;
+  L2Frame f;
+  memset(&f, 0x33, sizeof(f));
+  for (uint32_t i = 0; i < BURST; i++) {
+    a->accepted += ORBITCap_frame(a->cap, a->lane, &f, i, -60);
+  }
+  return NULL;
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  char path[64], name[80];
+  snprintf(path, sizeof(path), "/tmp/orbit_capture_test.%d", (int)getpid());
+  ORBITCap_t cap;
+  ORBITCapConfig_t cfg = { .path = path, .lanes = LANES, .buf_bytes = 16 * ORBITCAP_EPB_BYTES };
+
+  /* round trip: lanes interleaved, a retry after each drop keeps every frame */
+  CHECK(ORBITCap_open(&cap, &cfg) == 0, "open");
+  L2Frame f;
+  uint64_t drops = 0;
+  for (uint32_t i = 0; i < PER_LANE; i++) {
+    for (uint16_t k = 0; k < LANES; k++) {
+      make_frame(&f, k, i);
+      while (!ORBITCap_frame(&cap, k, &f, t_of(k, i), rssi_of(k, i))) {
+        drops++;
+        usleep(50);
+      }
+    }
+  }
+  ORBITCap_poll(&cap, 0, UINT64_MAX);       // old enough: hands off lane 0's partial buffer
+  ORBITCap_close(&cap);
+  CHECK(cap.written == (uint64_t)LANES * PER_LANE && cap.write_errors == 0, "every frame written");
+  uint32_t next[LANES] = {0};
+  int bad = 0;
+  long got = read_all(path, next, &bad, true);
+  CHECK(got == (long)LANES * PER_LANE, "every frame decoded");
+  CHECK(bad == 0, "decoded fields, order and annotations");
+  printf("round trip: %ld frames over %d lanes, %llu retries\n", got, LANES, (unsigned long long)drops);
+
+  /* text line */
+  ORBITCapReader_t r;
+  ORBITCapRecord_t rec[8];
+  char line[256];
+  CHECK(ORBITCapReader_open(&r, path, false) == 0 && ORBITCapReader_next(&r, rec, 8) == 8, "reader");
+  ORBITCap_format(&rec[0], line, sizeof(line));
+  snprintf(name, sizeof(name), "1700000000.123456789 if0 %ddBm HELLO_PKT_NB(0x%02x) pri 0 NML NUL_A ",
+           rssi_of(0, 0), L2D5TAG_HELLO_PKT_NB);
+  CHECK(strncmp(line, name, strlen(name)) == 0 && strstr(line, " ttl 0 fcs -") != NULL, "format: hello");
+  printf("%s\n", line);
+  ORBITCap_format(&rec[LANES * 2 + 1], line, sizeof(line));
+  CHECK(strstr(line, " enc pri ") != NULL && strstr(line, " - > - ttl 0 ") != NULL, "format: encrypted");
+  printf("%s\n", line);
+  ORBITCapReader_close(&r);
+
+  /* damaged block: the records before it, then -1 */
+  FILE *in = fopen(path, "rb");
+  snprintf(name, sizeof(name), "%s.bad", path);
+  FILE *out = fopen(name, "wb");
+  static uint8_t file[4 << 20];
+  size_t size = in ? fread(file, 1, sizeof(file), in) : 0;
+  size_t epbs = (size_t)LANES * PER_LANE * ORBITCAP_EPB_BYTES;
+  if (size > epbs) {
+    file[size - epbs + 100 * ORBITCAP_EPB_BYTES + 4] ^= 0x40;   // length of the 101st EPB
+  }
+  if (out) {
+    fwrite(file, 1, size, out);
+    fclose(out);
+  }
+  if (in) {
+    fclose(in);
+  }
+  ORBITCapRecord_t many[256];
+  int n1 = -2, n2 = -2;
+  if (ORBITCapReader_open(&r, name, false) == 0) {
+    n1 = ORBITCapReader_next(&r, many, 256);
+    n2 = ORBITCapReader_next(&r, many, 256);
+    ORBITCapReader_close(&r);
+  }
+  CHECK(n1 == 100 && n2 == -1, "damaged block stops the reader");
+  unlink(name);
+  unlink(path);
+  CHECK(ORBITCapReader_open(&r, "/nonexistent/orbit.pcapng", false) == -1, "missing file");
+
+  /* rotation: 40 EPBs per file, keep the newest 3 */
+  cfg.file_bytes = 40 * ORBITCAP_EPB_BYTES;
+  cfg.files = 3;
+  cfg.lanes = 1;
+  CHECK(ORBITCap_open(&cap, &cfg) == 0, "open rotating");
+  for (uint32_t i = 0; i < 1000; i++) {
+    make_frame(&f, 0, i);
+    while (!ORBITCap_frame(&cap, 0, &f, t_of(0, i), rssi_of(0, i))) {
+      usleep(50);
+    }
+  }
+  ORBITCap_close(&cap);
+  uint32_t last = cap.seq;
+  int present = 0, old = 0;
+  long kept = 0;
+  bad = 0;
+  for (uint32_t s = 0; s <= last; s++) {
+    snprintf(name, sizeof(name), "%s.%u", path, s);
+    bool exists = access(name, F_OK) == 0;
+    present += exists;
+    old += exists && s + 3 <= last;
+    if (exists) {
+      long c = read_all(name, next, &bad, false);
+      kept += c;
+      bad += c <= 0 || c > 40;
+      unlink(name);
+    }
+  }
+  CHECK(cap.rotations == last && last >= 3, "rotated");
+  CHECK(present == 3 && old == 0, "only the newest 3 files kept");
+  CHECK(bad == 0, "each file decodes, at most file_bytes of EPBs");
+  printf("rotation: %u files written, %d kept with %ld frames\n", last + 1, present, kept);
+
+  /* RX threads outrunning the writer: captured + dropped == offered, captured == written */
+  cfg.file_bytes = 0;
+  cfg.files = 0;
+  cfg.lanes = LANES;
+  cfg.buf_bytes = 4 * ORBITCAP_EPB_BYTES;
+  CHECK(ORBITCap_open(&cap, &cfg) == 0, "open burst");
+  pthread_t th[LANES];
+  burst_arg_t args[LANES];
+  double t0 = now_sec();
+  for (uint16_t k = 0; k < LANES; k++) {
+    args[k] = (burst_arg_t){ .cap = &cap, .lane = k };
+    pthread_create(&th[k], NULL, burst, &args[k]);
+  }
+  uint64_t accepted = 0;
+  for (int k = 0; k < LANES; k++) {
+    pthread_join(th[k], NULL);
+    accepted += args[k].accepted;
+  }
+  double t_burst = now_sec() - t0;
+  uint64_t captured = 0, dropped = 0;
+  for (int k = 0; k < LANES; k++) {
+    captured += atomic_load(&cap.lane[k].captured);
+    dropped += atomic_load(&cap.lane[k].dropped);
+  }
+  ORBITCap_close(&cap);
+  CHECK(captured == accepted && captured + dropped == (uint64_t)LANES * BURST, "drop accounting");
+  CHECK(cap.written == captured, "every accepted frame written");
+  printf("burst: %d x %d frames offered in %.3f s (%.2f Mframes/s), %llu dropped\n", LANES, BURST, t_burst,
+         LANES * BURST / t_burst / 1e6, (unsigned long long)dropped);
+
+  long burst_decoded = 0;
+  if (ORBITCapReader_open(&r, path, false) == 0) {
+    int n;
+    while ((n = ORBITCapReader_next(&r, many, 256)) > 0) {
+      burst_decoded += n;
+    }
+    ORBITCapReader_close(&r);
+  }
+  CHECK(burst_decoded == (long)captured, "burst file decodes");
+  unlink(path);
+
+  /* sustained: one lane, default buffers, waiting out drops; then decode that file */
+  enum { SUSTAINED = 200000 };
+  cfg.lanes = 1;
+  cfg.buf_bytes = 0;
+  CHECK(ORBITCap_open(&cap, &cfg) == 0, "open sustained");
+  make_frame(&f, 0, 0);
+  uint64_t waits = 0;
+  t0 = now_sec();
+  for (uint32_t i = 0; i < SUSTAINED; i++) {
+    while (!ORBITCap_frame(&cap, 0, &f, i, -50)) {
+      waits++;
+      sched_yield();
+    }
+  }
+  ORBITCap_close(&cap);
+  double t_cap = now_sec() - t0;
+  CHECK(cap.written == SUSTAINED, "sustained: every frame written");
+  printf("capture to file: %d frames in %.3f s (%.2f Mframes/s), %llu producer waits\n", SUSTAINED, t_cap,
+         SUSTAINED / t_cap / 1e6, (unsigned long long)waits);
+  t0 = now_sec();
+  long decoded = 0;
+  if (ORBITCapReader_open(&r, path, true) == 0) {
+    int n;
+    while ((n = ORBITCapReader_next(&r, many, 256)) > 0) {
+      decoded += n;
+    }
+    ORBITCapReader_close(&r);
+  }
+  double t_dec = now_sec() - t0;
+  CHECK(decoded == SUSTAINED, "sustained file decodes");
+  printf("decode with FCS check: %ld frames in %.3f s (%.2f Mframes/s)\n", decoded, t_dec,
+         decoded / (t_dec > 0 ? t_dec : 1e-9) / 1e6);
+  unlink(path);
+
+  printf("\nORBIT Capture Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/*
+ * File:        test/orbit_metrics_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT Metrics Test Program.
+ *    Histogram bucket error bound and quantiles against sorted samples,
+ *    exact counters from several writer threads while another thread
+ *    snapshots, queue depth gauges from L2D5TxSched, text export, and
+ *    instrumentation cost per frame.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - Build with -pthread.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../src/ORBIT_metrics.h"
+#include "../src/L2D5_txsched.h"
+#include <sys/random.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NSAMPLES 200000
+#define WRITERS  4
+#define PER_WRITER 2000000
+
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+
+static ORBITMetrics_t m;
+static _Atomic int writers_done;
+
+static void *writer(void *arg) {
+  ORBITMetricsShard_t *s = ORBITMetrics_shard(&m, (uint32_t)(uintptr_t)arg);
+  for (uint64_t i = 0; i < PER_WRITER; i++) {
+    ORBITMetrics_add(s, ORBITM_C_RX_DATA_RM, 1);
+    ORBITMetrics_add(s, ORBITM_C_RESYNC_BYTES, 3);
+    ORBITMetrics_hist_record(s, ORBITM_H_ROUTE, 100 + (i & 1023));
+  }
+  atomic_fetch_add(&writers_done, 1);
+  return NULL;
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  /* bucket bounds: contiguous, value within 1/16 of its bucket's lower bound */
+  int bad = 0;
+  for (uint32_t b = 1; b < ORBITM_HIST_BUCKETS; b++) {
+    bad += ORBITMetrics_hist_index(ORBITMetrics_hist_lower(b)) != b ||
+           ORBITMetrics_hist_index(ORBITMetrics_hist_lower(b) - 1) != b - 1;
+  }
+  CHECK(bad == 0, "buckets contiguous");
+  bad = 0;
+  for (int i = 0; i < 1000000; i++) {
+    uint64_t v = rng() >> (rng() % 64);
+    uint64_t lo = ORBITMetrics_hist_lower(ORBITMetrics_hist_index(v));
+    bad += v < (1ull << ORBITM_HIST_MAX_EXP) && (lo > v || (v - lo) * ORBITM_HIST_SUB > v);
+  }
+  CHECK(bad == 0, "bucket error <= 1/16");
+  CHECK(ORBITMetrics_hist_index(UINT64_MAX) == ORBITM_HIST_BUCKETS - 1, "overflow -> last bucket");
+
+  /* quantiles vs sorted samples (log-normal-ish latencies, 50 ns .. 5 ms) */
+  if (ORBITMetrics_init(&m, WRITERS + 1) != 0) {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+  static uint64_t samples[NSAMPLES];
+  static ORBITMetricsSnap_t snap;
+  ORBITMetricsShard_t *s0 = ORBITMetrics_shard(&m, WRITERS);
+  for (int i = 0; i < NSAMPLES; i++) {
+    samples[i] = 50 + (rng() % 1000) * (1ull << (rng() % 13));
+    ORBITMetrics_hist_record(s0, ORBITM_H_DECRYPT, samples[i]);
+  }
+  qsort(samples, NSAMPLES, sizeof(samples[0]), cmp_u64);
+  ORBITMetrics_snapshot(&m, &snap);
+  static const double qs[] = { 0.0, 0.5, 0.9, 0.99, 0.999, 1.0 };
+  bad = 0;
+  for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+    uint64_t exact = samples[(size_t)((NSAMPLES - 1) * qs[i])];
+    uint64_t est = ORBITMetrics_quantile(&snap, ORBITM_H_DECRYPT, qs[i]);
+    bad += est > exact || (exact - est) * ORBITM_HIST_SUB > exact;
+  }
+  CHECK(bad == 0, "quantiles within 1/16 of exact");
+  CHECK(snap.hist[ORBITM_H_DECRYPT].count == NSAMPLES && snap.hist[ORBITM_H_DECRYPT].max == samples[NSAMPLES - 1],
+        "count / max");
+  ORBITMetrics_hist_record_n(s0, ORBITM_H_ENCRYPT, 40, 32);
+  ORBITMetrics_snapshot(&m, &snap);
+  CHECK(snap.hist[ORBITM_H_ENCRYPT].count == 32 && snap.hist[ORBITM_H_ENCRYPT].sum == 40 * 32 &&
+        ORBITMetrics_quantile(&snap, ORBITM_H_ENCRYPT, 0.99) == 40, "burst record");
+
+  /* writers on their own shards, a reader snapshotting meanwhile */
+  pthread_t th[WRITERS];
+  for (uintptr_t i = 0; i < WRITERS; i++) {
+    pthread_create(&th[i], NULL, writer, (void *)i);
+  }
+  uint64_t last = 0, snaps = 0;
+  bad = 0;
+  while (atomic_load(&writers_done) < WRITERS) {
+    ORBITMetrics_snapshot(&m, &snap);
+    bad += snap.counter[ORBITM_C_RX_DATA_RM] < last;
+    last = snap.counter[ORBITM_C_RX_DATA_RM];
+    snaps++;
+  }
+  for (int i = 0; i < WRITERS; i++) {
+    pthread_join(th[i], NULL);
+  }
+  ORBITMetrics_snapshot(&m, &snap);
+  CHECK(bad == 0, "counters never go backwards while read");
+  CHECK(snap.counter[ORBITM_C_RX_DATA_RM] == (uint64_t)WRITERS * PER_WRITER &&
+        snap.counter[ORBITM_C_RESYNC_BYTES] == 3ull * WRITERS * PER_WRITER &&
+        snap.hist[ORBITM_H_ROUTE].count == (uint64_t)WRITERS * PER_WRITER, "counters exact after join");
+  printf("%llu snapshots taken while %d writers ran\n", (unsigned long long)snaps, WRITERS);
+
+  /* queue depth per FLAG PRI, sampled by the scheduler's consumer */
+  L2D5TxSched_t sched;
+  static int items[64];
+  L2D5TxSched_init(&sched, 64);
+  for (int i = 0; i < 10; i++) {
+    L2D5TxSched_push(&sched, 3, &items[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    L2D5TxSched_push(&sched, 12, &items[10 + i]);
+  }
+  L2D5TxSched_pop(&sched, NULL);
+  for (uint8_t p = 0; p < ORBITM_PRI_LEVELS; p++) {
+    ORBITMetrics_queue_depth(s0, p, L2D5TxSched_depth(&sched, p));
+  }
+  ORBITMetrics_snapshot(&m, &snap);
+  CHECK(snap.queue_depth[3] == 10 && snap.queue_depth[12] == 3 && snap.queue_depth[0] == 0, "queue depth gauges");
+  L2D5TxSched_free(&sched);
+
+  /* text export */
+  char *text = NULL;
+  size_t len = 0;
+  FILE *mem = open_memstream(&text, &len);
+  CHECK(mem != NULL && ORBITMetrics_write_text(&snap, mem) == 0, "write_text");
+  fclose(mem);
+  char line[128];
+  snprintf(line, sizeof(line), "orbit_rx_frames_total{tag=\"TCP_DATA_RM\"} %llu\n",
+           (unsigned long long)WRITERS * PER_WRITER);
+  CHECK(text != NULL && strstr(text, line) != NULL, "text: counter line");
+  CHECK(text != NULL && strstr(text, "orbit_queue_depth{pri=\"12\"} 3\n") != NULL, "text: gauge line");
+  CHECK(text != NULL && strstr(text, "orbit_stage_latency_ns_count{stage=\"encrypt\"} 32\n") != NULL,
+        "text: histogram line");
+  CHECK(text != NULL && strstr(text, "orbit_l2_crc_fail_total 0\n") != NULL, "text: unlabeled counter");
+  free(text);
+
+  /* cost per frame: per-frame record vs one record per 32-frame burst */
+  enum { ROUNDS = 20000000, BURST = 32 };
+  ORBITMetricsShard_t *s1 = ORBITMetrics_shard(&m, 0);
+  uint64_t acc = 0;
+  double t0 = now_sec();
+  for (uint64_t i = 0; i < ROUNDS; i++) {
+    acc += i * 7;
+    __asm__ volatile("" : "+r"(acc));
+  }
+  double base = now_sec() - t0;
+  t0 = now_sec();
+  for (uint64_t i = 0; i < ROUNDS; i++) {
+    acc += i * 7;
+    ORBITMetrics_add(s1, ORBITM_C_RX_DATA_DC, 1);
+    ORBITMetrics_hist_record(s1, ORBITM_H_DEFRAME, acc & 0xFFFF);
+    __asm__ volatile("" : "+r"(acc));
+  }
+  double per_frame = now_sec() - t0;
+  t0 = now_sec();
+  for (uint64_t i = 0; i < ROUNDS; i++) {
+    acc += i * 7;
+    if ((i & (BURST - 1)) == BURST - 1) {
+      ORBITMetrics_add(s1, ORBITM_C_RX_DATA_DC, BURST);
+      ORBITMetrics_hist_record_n(s1, ORBITM_H_DEFRAME, acc & 0xFFFF, BURST);
+    }
+    __asm__ volatile("" : "+r"(acc));
+  }
+  double per_burst = now_sec() - t0;
+  double ns_frame = (per_frame - base) / ROUNDS * 1e9, ns_burst = (per_burst - base) / ROUNDS * 1e9;
+  printf("instrumentation per frame: counter + histogram %.2f ns, once per %d-frame burst %.2f ns\n",
+         ns_frame, BURST, ns_burst);
+
+  ORBITMetrics_free(&m);
+  printf("\nORBIT Metrics Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,390 @@
+/*
+ * File:        test/orbit_pipeline_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT Relay Pipeline Test Program.
+ *    Relay R with neighbor A on radio 0 and neighbor B on radio 1.
+ *    B relays remote D's encrypted HELLO_PKT_RM (twice: the copy is a
+ *    duplicate), R decrypts it, learns D via B and relays it once to A.
+ *    Then A streams encrypted TCP_DATA_RM frames for D (relayed to B with
+ *    A's SrcAddress, re-encrypted) mixed with TCP_DATA_DC frames for R
+ *    (delivered locally). Last, C is heard on radio 1 with a HELLO_PKT_NB:
+ *    R agrees a key with it at runtime and C's frame is delivered. Prints
+ *    the per-stage throughput / latency report, checks the metrics
+ *    counters, RSSI, and the pcapng capture of both RX ports.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - Build with -pthread and link -lcrypto.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <sys/random.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/ORBIT_pipeline.h"
+#include "../src/ORBIT_bytes.h"
+#include "../src/L2_crc32.h"
+#include "../src/L2D5_classify.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NFRAMES 200000
+#define KFRAMES 64
+#define WINDOW  768               // frames in flight; below every ring depth, so nothing is dropped
+
+
+static uint8_t addr_r[16], addr_a[16], addr_b[16], addr_c[16], addr_d[16];
+static uint8_t pub_a[32], pub_b[32], pub_c[32], pub_r[32];
+static uint8_t sk_r[32], sk_c[32];
+static uint8_t shared_a[32], shared_b[32], shared_c[32];
+
+/* radio 1: D's HELLO_PKT_RM twice, C's HELLO_PKT_NB, C's TCP_DATA_DC; served up to p1_ready */
+static L2Frame  p1_frames[4];
+static _Atomic int p1_ready;
+static L2Frame  data_frames[KFRAMES];
+static _Atomic int go;
+static uint64_t rx_off[2], rx_left[2];
+
+static L2D5KeyCache_t a_side, b_side;      // used on the TX thread only once started
+static _Atomic uint64_t tx_frames, tx_bad, hello_tx, delivered, deliver_bad, c_delivered;
+static ORBITPipe_t p;
+
+
+static void l2_wrap(L2Frame *l2, const void *l2d5) {
+  l2->SFD = MAGIC_L2LAYER_SFD;
+  l2->TAG[0] = l2->TAG[1] = 0;
+  memcpy(l2->Payload, l2d5, sizeof(l2->Payload));
+  l2->EFD = MAGIC_L2LAYER_EFD;
+  L2CRC32_seal(l2);
+}
+
+static uint64_t total_drops(ORBITPipe_t *p);
+
+static int16_t rssi_of(uint16_t port) {
+  return (int16_t)(-40 - 27 * port);
+}
+
+static int16_t rssi_fn(void *ctx, uint16_t port) {
+  (void)ctx;
+  return rssi_of(port);
+}
+
+static size_t rx_fn(void *ctx, uint16_t port, uint8_t *buf, size_t cap) {
+  (void)ctx;
+  const uint8_t *src;
+  size_t span;
+  if (port == 1) {
+    size_t end = (size_t)atomic_load(&p1_ready) * sizeof(L2Frame), n = end - rx_off[1];
+    n = n < cap ? n : cap;
+    memcpy(buf, (const uint8_t *)p1_frames + rx_off[1], n);
+    rx_off[1] += n;
+    return n;
+  } else {
+    /* pace the offered load like a radio link would, instead of overrunning every ring */
+    uint64_t sent = ((uint64_t)NFRAMES * sizeof(L2Frame) - rx_left[0]) / sizeof(L2Frame);
+    uint64_t done = atomic_load(&tx_frames) + atomic_load(&delivered) + total_drops(&p);
+    if (!atomic_load(&go) || sent - done >= WINDOW) {
+      return 0;
+    }
+    if (cap > (WINDOW - (sent - done)) * sizeof(L2Frame)) {
+      cap = (size_t)(WINDOW - (sent - done)) * sizeof(L2Frame);
+    }
+    src = (const uint8_t *)data_frames;
+    span = sizeof(data_frames);
+  }
+  size_t n = cap;
+  if (n > rx_left[port]) {
+    n = (size_t)rx_left[port];
+  }
+  if (n > span - rx_off[port]) {
+    n = (size_t)(span - rx_off[port]);
+  }
+  memcpy(buf, src + rx_off[port], n);
+  rx_off[port] = (rx_off[port] + n) % span;
+  rx_left[port] -= n;
+  return n;
+}
+
+static void tx_fn(void *ctx, uint16_t port, const L2Frame *frame) {
+  (void)ctx;
+  L2D5Frame_t pt;
+  if (port == 0) {
+    /* A decrypts D's HELLO as relayed by R: originator kept, TTL decremented */
+    const L2D5Routing_HelloPkt_t *h = (const L2D5Routing_HelloPkt_t *)pt.Payload;
+    atomic_fetch_add(&hello_tx, 1);
+    if (!L2CRC32_check(frame) || frame->Payload[0] != L2D5TAG_HELLO_PKT_RM ||
+        L2D5KeyCache_decrypt(&a_side, (const L2D5Frame_Encrypted_t *)frame->Payload, &pt) == NULL ||
+        !L2D5ADDR_equal(pt.SrcAddress, addr_d) || !L2D5ADDR_equal(h->NodeSrcAddr, addr_d) ||
+        ORBIT_load_be16(pt.TTL) != 6) {
+      atomic_fetch_add(&tx_bad, 1);
+    }
+    return;
+  }
+  uint64_t n = atomic_fetch_add(&tx_frames, 1);
+  if (port != 1 || !L2CRC32_check(frame)) {
+    atomic_fetch_add(&tx_bad, 1);
+    return;
+  }
+  if (n % 97 == 0) {
+    /* B decrypts what R sent: SrcAddress still A, TTL decremented */
+    if (L2D5KeyCache_decrypt(&b_side, (const L2D5Frame_Encrypted_t *)frame->Payload, &pt) == NULL ||
+        !L2D5ADDR_equal(pt.SrcAddress, addr_a) || !L2D5ADDR_equal(pt.DstAddress, addr_d) ||
+        ORBIT_load_be16(pt.TTL) != 7 || pt.Payload[0] != 0xD0) {
+      atomic_fetch_add(&tx_bad, 1);
+    }
+  }
+}
+
+static void deliver_fn(void *ctx, L2PoolBuf_t *buf) {
+  (void)ctx;
+  L2D5Frame_t *f = L2PoolBuf_l2d5(buf);
+  if (L2D5ADDR_equal(f->SrcAddress, addr_c)) {
+    atomic_fetch_add(&deliver_bad, f->Payload[0] != 0xCC || buf->rssi != rssi_of(1));
+    atomic_fetch_add(&c_delivered, 1);
+    return;
+  }
+  if (f->TAG != L2D5TAG_TCP_DATA_DC || !L2D5ADDR_equal(f->SrcAddress, addr_a) || f->Payload[0] != 0xDC ||
+      buf->rssi != rssi_of(0)) {
+    atomic_fetch_add(&deliver_bad, 1);
+  }
+  atomic_fetch_add(&delivered, 1);
+}
+
+static uint64_t counter(ORBITMCounter_t c) {
+  static ORBITMetricsSnap_t snap;
+  ORBITMetrics_snapshot(&p.metrics, &snap);
+  return snap.counter[c];
+}
+
+/* Waits up to _ms for *_v >= _want */
+static bool wait_for(_Atomic uint64_t *_v, uint64_t _want, int _ms) {
+  struct timespec nap = { 0, 1000000 };
+  for (int i = 0; atomic_load(_v) < _want && i < _ms; i++) {
+    nanosleep(&nap, NULL);
+  }
+  return atomic_load(_v) >= _want;
+}
+
+static uint64_t total_drops(ORBITPipe_t *p) {
+  uint64_t d = 0;
+  for (int s = ORBITPIPE_STAGE_DISPATCH; s < ORBITPIPE_STAGES; s++) {
+    d += atomic_load(&p->stats[s].drop);
+  }
+  for (int k = 0; k < p->cfg.ports; k++) {
+    d += atomic_load(&p->rx_stats[k].drop);
+  }
+  return d;
+}
+
+
+static void seal_to(L2D5KeyCache_t *keys, L2D5Session_t *sess, const L2D5Frame_t *pt, L2Frame *out) {
+  L2D5Frame_Encrypted_t ct;
+  L2D5KeyCache_encrypt(keys, sess, pt, &ct);
+  l2_wrap(out, &ct);
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(addr_r, 16, 0) != 16 || getrandom(addr_a, 16, 0) != 16 || getrandom(addr_b, 16, 0) != 16 ||
+      getrandom(addr_c, 16, 0) != 16 || getrandom(addr_d, 16, 0) != 16 || getrandom(shared_a, 32, 0) != 32 ||
+      getrandom(shared_b, 32, 0) != 32 || getrandom(pub_a, 32, 0) != 32 || getrandom(pub_b, 32, 0) != 32 ||
+      getrandom(sk_r, 32, 0) != 32 || getrandom(sk_c, 32, 0) != 32) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  if (L2D5Hs_public(sk_r, pub_r) != 0 || L2D5Hs_public(sk_c, pub_c) != 0 || L2D5Hs_agree(sk_c, pub_r, shared_c) != 0) {
+    printf("X25519 failed\n");
+    return EXIT_FAILURE;
+  }
+
+  /* A encrypts towards R, B relays D's HELLO to R; both decrypt what R sends them */
+  L2D5KeyCache_t c_side;
+  L2D5KeyCache_init(&a_side, 4);
+  L2D5KeyCache_init(&b_side, 4);
+  L2D5KeyCache_init(&c_side, 4);
+  L2D5Session_t *a_to_r = L2D5KeyCache_install(&a_side, addr_a, pub_r, shared_a);
+  L2D5Session_t *b_to_r = L2D5KeyCache_install(&b_side, addr_r, pub_r, shared_b);
+  L2D5Session_t *c_to_r = L2D5KeyCache_install(&c_side, addr_c, pub_r, shared_c);
+
+  for (int i = 0; i < KFRAMES; i++) {
+    L2D5Frame_t pt;
+    memset(&pt, 0, sizeof(pt));
+    bool local = i % 4 == 3;
+    pt.TAG = local ? L2D5TAG_TCP_DATA_DC : L2D5TAG_TCP_DATA_RM;
+    pt.FLAG = L2D5FLAG_MKFLAG(5, L2D5FLAG_ERR_NML, L2D5FLAG_NUL_A);
+    memcpy(pt.SrcAddress, addr_a, 16);
+    memcpy(pt.DstAddress, local ? addr_r : addr_d, 16);
+    ORBIT_store_be16(pt.TTL, 8);
+    pt.Payload[0] = local ? 0xDC : 0xD0;
+    pt.Payload[1] = (uint8_t)i;
+    seal_to(&a_side, a_to_r, &pt, &data_frames[i]);
+  }
+
+  /* B relays D's HELLO_PKT_RM: NodesLimit 8, TTL 7 -> 2 hops; SrcAddress is D */
+  L2D5Frame_t hf;
+  memset(&hf, 0, sizeof(hf));
+  hf.TAG = L2D5TAG_HELLO_PKT_RM;
+  memcpy(hf.SrcAddress, addr_d, 16);
+  memset(hf.DstAddress, 0xFF, 16);
+  ORBIT_store_be16(hf.TTL, 7);
+  L2D5Routing_HelloPkt_t *h = (L2D5Routing_HelloPkt_t *)hf.Payload;
+  memcpy(h->NodeSrcAddr, addr_d, 16);
+  ORBIT_store_be16(h->SEQ, 1);
+  ORBIT_store_be16(h->NodesLimit, 8);
+  seal_to(&b_side, b_to_r, &hf, &p1_frames[0]);
+  p1_frames[1] = p1_frames[0];
+
+  /* C: plaintext HELLO_PKT_NB with its real PublicKey, then one frame for R */
+  memset(&hf, 0, sizeof(hf));
+  hf.TAG = L2D5TAG_HELLO_PKT_NB;
+  memcpy(hf.SrcAddress, addr_c, 16);
+  memset(hf.DstAddress, 0xFF, 16);
+  memcpy(h->NodeSrcAddr, addr_c, 16);
+  memcpy(h->PublicKey, pub_c, 32);
+  ORBIT_store_be16(h->NodesLimit, 8);
+  l2_wrap(&p1_frames[2], &hf);
+  memset(&hf, 0, sizeof(hf));
+  hf.TAG = L2D5TAG_TCP_DATA_DC;
+  memcpy(hf.SrcAddress, addr_c, 16);
+  memcpy(hf.DstAddress, addr_r, 16);
+  ORBIT_store_be16(hf.TTL, 1);
+  hf.Payload[0] = 0xCC;
+  seal_to(&c_side, c_to_r, &hf, &p1_frames[3]);
+  atomic_store(&p1_ready, 2);
+  rx_left[0] = (uint64_t)NFRAMES * sizeof(L2Frame);
+
+  ORBITPipeConfig_t cfg;
+  ORBITPipe_config_default(&cfg);
+  memcpy(cfg.self_addr, addr_r, 16);
+  cfg.ports = 2;
+  cfg.secret_key = sk_r;
+  cfg.rx_fn = rx_fn;
+  cfg.rssi_fn = rssi_fn;
+  cfg.tx_fn = tx_fn;
+  cfg.deliver_fn = deliver_fn;
+  for (int s = 0; s < ORBITPIPE_STAGES; s++) {
+    cfg.cpu_stage[s] = s % 2 ? 0 : ORBITPIPE_CPU_ANY;   // exercise pinning on CPU 0
+  }
+
+  char cap_path[64];
+  snprintf(cap_path, sizeof(cap_path), "/tmp/orbit_pipeline_test.%d.pcapng", (int)getpid());
+  ORBITCap_t cap;
+  ORBITCapConfig_t cap_cfg = { .path = cap_path, .lanes = 2 };
+  if (ORBITCap_open(&cap, &cap_cfg) != 0) {
+    printf("ORBITCap_open failed\n");
+    return EXIT_FAILURE;
+  }
+  cfg.capture = &cap;
+
+  if (ORBITPipe_init(&p, &cfg) != 0) {
+    printf("ORBITPipe_init failed\n");
+    return EXIT_FAILURE;
+  }
+  uint32_t slot_a = ORBITPipe_add_neighbor(&p, addr_a, pub_a, shared_a, 0);
+  CHECK(slot_a != L2D5NB_NIL, "add A");
+  CHECK(ORBITPipe_add_neighbor(&p, addr_b, pub_b, shared_b, 1) != L2D5NB_NIL, "add B");
+  CHECK(ORBITPipe_start(&p) == 0, "start");
+
+  /* D's HELLO: relayed once to A, which also means D is routed via B */
+  CHECK(wait_for(&hello_tx, 1, 5000), "HELLO_PKT_RM relayed");
+  atomic_store(&go, 1);
+  struct timespec nap = { 0, 1000000 };
+  int waited = 0;
+  while (atomic_load(&tx_frames) + atomic_load(&delivered) + total_drops(&p) < NFRAMES && waited++ < 30000) {
+    nanosleep(&nap, NULL);
+  }
+
+  /* C at runtime: HELLO -> handshake -> keys in both crypto stages -> its frame decrypts */
+  atomic_store(&p1_ready, 3);
+  for (waited = 0; (counter(ORBITM_C_KEYS_RX) < 1 || counter(ORBITM_C_KEYS_TX) < 1) && waited < 5000; waited++) {
+    nanosleep(&nap, NULL);
+  }
+  CHECK(waited < 5000, "runtime handshake installed C's session");
+  atomic_store(&p1_ready, 4);
+  CHECK(wait_for(&c_delivered, 1, 5000), "C's frame delivered");
+  ORBITPipe_stop(&p);
+
+  uint64_t tx = atomic_load(&tx_frames), dl = atomic_load(&delivered), dr = total_drops(&p);
+  printf("Relayed %llu, delivered %llu, dropped %llu of %d\n\n",
+         (unsigned long long)tx, (unsigned long long)dl, (unsigned long long)dr, NFRAMES);
+  ORBITPipe_report(&p, stdout);
+  printf("\n");
+
+  CHECK(tx + dl == NFRAMES && dr == 0, "every frame relayed or delivered");
+  CHECK(tx > 0 && dl > 0, "relay and local delivery both happened");
+  CHECK(atomic_load(&hello_tx) == 1, "HELLO_PKT_RM relayed once, duplicate dropped");
+  CHECK(atomic_load(&tx_bad) == 0, "relayed frames valid for A and B");
+  CHECK(atomic_load(&deliver_bad) == 0, "delivered frames valid");
+  CHECK(atomic_load(&p.stats[ORBITPIPE_STAGE_DECRYPT].drop) == 0, "no decrypt failures");
+  CHECK(atomic_load(&p.pool.free_count) == p.pool.count, "pool drained after stop");
+
+  uint32_t slot_c = L2D5Neighbor_find(&p.nb, addr_c);
+  CHECK(slot_c != L2D5NB_NIL && p.nb.has_shared[slot_c] && memcmp(p.nb.keys[slot_c].SharedKey, shared_c, 32) == 0,
+        "C: SharedKey agreed");
+  CHECK(slot_c != L2D5NB_NIL && p.tx_sess[slot_c] != NULL && L2D5KeyCache_find(&p.rx_keys, addr_c) != NULL,
+        "C: session in both crypto stages");
+  CHECK(slot_c != L2D5NB_NIL && p.nb.last_rssi[slot_c] == rssi_of(1) && p.nb.last_rssi[slot_a] == rssi_of(0),
+        "neighbor RSSI from the radio");
+
+  static ORBITMetricsSnap_t ms;
+  ORBITMetrics_snapshot(&p.metrics, &ms);
+  CHECK(ms.counter[ORBITM_C_RX_DATA_RM] == tx && ms.counter[ORBITM_C_RX_DATA_DC] == dl + 1 &&
+        ms.counter[ORBITM_C_RX_HELLO_RM] == 2 && ms.counter[ORBITM_C_RX_HELLO_NB] == 1 &&
+        ms.counter[ORBITM_C_RX_MALFORMED] == 0, "metrics: RX per tag");
+  CHECK(ms.counter[ORBITM_C_TX_DATA_RM] == tx && ms.counter[ORBITM_C_TX_HELLO_RM] == 1 &&
+        ms.counter[ORBITM_C_DELIVERED] == dl + 1, "metrics: TX per tag");
+  CHECK(ms.counter[ORBITM_C_FCS_FAIL] == 0 && ms.counter[ORBITM_C_DECRYPT_FAIL] == 0 &&
+        ms.counter[ORBITM_C_TTL_DROP] == 0 && ms.counter[ORBITM_C_RING_FULL] == 0 &&
+        ms.counter[ORBITM_C_NO_ROUTE] == 0, "metrics: no drops");
+  CHECK(ms.counter[ORBITM_C_DUP_DROP] == 1 && ms.counter[ORBITM_C_KEYS_RX] == 1 && ms.counter[ORBITM_C_KEYS_TX] == 1,
+        "metrics: duplicate HELLO, runtime keys");
+  CHECK(ms.hist[ORBITM_H_DECRYPT].count == NFRAMES + 3 && ms.hist[ORBITM_H_SCHEDULE].count == NFRAMES + 2 &&
+        ms.hist[ORBITM_H_DEFRAME].count == NFRAMES + 4, "metrics: every frame timed");
+  printf("decrypt p50 %llu ns / p99 %llu ns per frame, route p50 %llu ns\n\n",
+         (unsigned long long)ORBITMetrics_quantile(&ms, ORBITM_H_DECRYPT, 0.5),
+         (unsigned long long)ORBITMetrics_quantile(&ms, ORBITM_H_DECRYPT, 0.99),
+         (unsigned long long)ORBITMetrics_quantile(&ms, ORBITM_H_ROUTE, 0.5));
+
+  /* capture: what RX accepted reached the file, the HELLOs on port 1, RSSI per radio */
+  uint64_t offered = 0;
+  for (int k = 0; k < 2; k++) {
+    offered += atomic_load(&cap.lane[k].captured) + atomic_load(&cap.lane[k].dropped);
+  }
+  ORBITCap_close(&cap);
+  ORBITCapReader_t rd;
+  ORBITCapRecord_t rec[64];
+  uint64_t decoded = 0, hello_on_1 = 0, rssi_bad = 0;
+  int rn = -1;
+  if (ORBITCapReader_open(&rd, cap_path, true) == 0) {
+    while ((rn = ORBITCapReader_next(&rd, rec, 64)) > 0) {
+      for (int i = 0; i < rn; i++) {
+        hello_on_1 += rec[i].iface == 1 && rec[i].cls == L2D5CLS_HELLO_RM && rec[i].fcs == 1;
+        rssi_bad += rec[i].rssi != rssi_of((uint16_t)rec[i].iface);
+      }
+      decoded += (uint64_t)rn;
+    }
+    ORBITCapReader_close(&rd);
+  }
+  unlink(cap_path);
+  CHECK(offered == NFRAMES + 4, "capture: every RX frame offered");
+  CHECK(rn == 0 && decoded == cap.written && cap.write_errors == 0, "capture: file decodes");
+  CHECK(rssi_bad == 0, "capture: RSSI per radio");
+  printf("capture: %llu of %llu frames written, HELLO_PKT_RM on port 1: %llu\n\n",
+         (unsigned long long)decoded, (unsigned long long)offered, (unsigned long long)hello_on_1);
+
+  ORBITPipe_free(&p);
+  L2D5KeyCache_free(&a_side);
+  L2D5KeyCache_free(&b_side);
+  L2D5KeyCache_free(&c_side);
+  printf("ORBIT Relay Pipeline Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,480 @@
+/*
+ * File:        test/orbit_radio_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT Radio I/O Test Program.
+ *    pty pairs (byte-stream modems) and UDP loopback sockets (UDP links)
+ *    stand in for radios. For each backend: frames from every peer reach
+ *    the node in order (streams through L2Deframer), frames sent by the
+ *    node reach every peer, a hung-up pty reports an error, and buffers
+ *    all return to the pool. epoll teardown with frames still queued,
+ *    on a live port and after EPIPE, returns each buffer exactly once.
+ *    Then frames/sec per core and syscalls per frame across 1 - 16 UDP
+ *    interfaces.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *   - io_uring is skipped when the kernel does not offer it.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "../src/ORBIT_radio.h"
+#include "../src/ORBIT_bytes.h"
+#include "../src/L2_crc32.h"
+#include "../src/L2_deframer.h"
+#include <sys/random.h>
+#include <time.h>
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NPTY     3
+#define NUDP     3
+#define NPORTS   (NPTY + NUDP)
+#define NFRAMES  300
+#define BENCH_BURST 32
+
+
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Sealed frame: port and sequence in the payload, random fill */
+static void make_frame(L2Frame *f, uint16_t port, uint32_t seq) {
+  for (size_t b = 0; b < sizeof(*f); b++) {
+    ((uint8_t *)f)[b] = (uint8_t)rng();
+  }
+  f->SFD = MAGIC_L2LAYER_SFD;
+  f->EFD = MAGIC_L2LAYER_EFD;
+  ORBIT_store_be16(f->Payload, port);
+  ORBIT_store_be32(f->Payload + 2, seq);
+  L2CRC32_seal(f);
+}
+
+/* Raw pty pair: node side master, peer side slave */
+static int open_pty(int *peer) {
+  int m = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (m < 0 || grantpt(m) != 0 || unlockpt(m) != 0) {
+    return -1;
+  }
+  *peer = open(ptsname(m), O_RDWR | O_NOCTTY | O_CLOEXEC);
+  struct termios t;
+  if (*peer < 0 || tcgetattr(*peer, &t) != 0) {
+    return -1;
+  }
+  cfmakeraw(&t);
+  tcsetattr(*peer, TCSANOW, &t);
+  tcgetattr(m, &t);
+  cfmakeraw(&t);
+  tcsetattr(m, TCSANOW, &t);
+  return m;
+}
+
+/* Two connected UDP sockets on 127.0.0.1 */
+static int open_udp(int *peer) {
+  int s[2];
+  struct sockaddr_in a[2];
+  socklen_t len = sizeof(a[0]);
+  for (int i = 0; i < 2; i++) {
+    s[i] = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    memset(&a[i], 0, sizeof(a[i]));
+    a[i].sin_family = AF_INET;
+    a[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int big = 1 << 20;
+    setsockopt(s[i], SOL_SOCKET, SO_RCVBUF, &big, sizeof(big));
+    if (s[i] < 0 || bind(s[i], (struct sockaddr *)&a[i], sizeof(a[i])) != 0 ||
+        getsockname(s[i], (struct sockaddr *)&a[i], &len) != 0) {
+      return -1;
+    }
+  }
+  connect(s[0], (struct sockaddr *)&a[1], sizeof(a[1]));
+  connect(s[1], (struct sockaddr *)&a[0], sizeof(a[0]));
+  *peer = s[1];
+  return s[0];
+}
+
+static int write_all(int fd, const void *p, size_t n) {
+  const uint8_t *b = p;
+  while (n != 0) {
+    ssize_t w = write(fd, b, n);
+    if (w <= 0) {
+      return -1;
+    }
+    b += w;
+    n -= (size_t)w;
+  }
+  return 0;
+}
+
+
+/* One backend end to end; returns the number of failures */
+static int run_backend(ORBITRadioBackend_t backend) {
+  int fail = 0;
+  L2Pool_t pool;
+  ORBITRadio_t r;
+  ORBITRadioConfig_t cfg = { .backend = backend };
+  int node[NPORTS], peer[NPORTS];
+  L2Deframer_t dfr[NPORTS];
+  uint32_t next[NPORTS] = {0};
+  int bad = 0;
+  L2Frame f;
+
+  if (L2Pool_init(&pool, 1024) != 0 || ORBITRadio_init(&r, &cfg, &pool) != 0) {
+    printf("FAIL: init %s\n", ORBITRadio_backend_name(backend));
+    return 1;
+  }
+  printf("backend %s%s\n", ORBITRadio_backend_name(r.backend),
+         r.backend == ORBITRADIO_URING ? (r.ring.fixed ? ", pool registered" : ", pool not registered") : "");
+  for (int i = 0; i < NPORTS; i++) {
+    node[i] = i < NPTY ? open_pty(&peer[i]) : open_udp(&peer[i]);
+    L2Deframer_init(&dfr[i], 16 * sizeof(L2Frame), true);
+    bad += node[i] < 0 || ORBITRadio_add_port(&r, node[i], i < NPTY ? ORBITRADIO_STREAM : ORBITRADIO_DGRAM) != i;
+  }
+  CHECK(bad == 0, "ports added");
+
+  /* RX: peers write, the node deframes streams and takes datagrams as they are */
+  ORBITRadioEvent_t ev[64];
+  uint32_t sent = 0, got = 0;
+  double t_end = now_sec() + 10;
+  bad = 0;
+  while (got < (uint32_t)NPORTS * NFRAMES && now_sec() < t_end) {
+    if (sent < NFRAMES) {
+      for (int i = 0; i < NPORTS; i++) {
+        make_frame(&f, (uint16_t)i, sent);
+        bad += i < NPTY ? write_all(peer[i], &f, sizeof(f)) != 0 : send(peer[i], &f, sizeof(f), 0) != sizeof(f);
+      }
+      sent++;
+    }
+    int n = ORBITRadio_poll(&r, ev, 64, sent < NFRAMES ? 0 : 100);
+    bad += n < 0;
+    for (int k = 0; k < n; k++) {
+      uint16_t port = ev[k].port;
+      if (ev[k].type != ORBITRADIO_EV_RX) {
+        bad++;
+        continue;
+      }
+      if (port < NPTY) {
+        L2Deframer_push(&dfr[port], (const uint8_t *)&ev[k].buf->frame, (size_t)ev[k].res);
+        const L2Frame *views[16];
+        size_t m = L2Deframer_poll(&dfr[port], views, 16);
+        for (size_t j = 0; j < m; j++) {
+          bad += ORBIT_load_be16(views[j]->Payload) != port || ORBIT_load_be32(views[j]->Payload + 2) != next[port]++;
+        }
+        got += (uint32_t)m;
+        L2Deframer_release(&dfr[port]);
+      } else {
+        const L2Frame *g = &ev[k].buf->frame;
+        bad += ev[k].res != (int32_t)sizeof(L2Frame) || !L2CRC32_check(g) || ORBIT_load_be16(g->Payload) != port ||
+               ORBIT_load_be32(g->Payload + 2) != next[port]++;
+        got++;
+      }
+      ORBITRadio_put(&r, ev[k].buf);
+    }
+  }
+  CHECK(got == (uint32_t)NPORTS * NFRAMES, "RX: every frame on every port");
+  CHECK(bad == 0, "RX: in order, intact");
+  for (int i = 0; i < NPTY; i++) {
+    CHECK(dfr[i].stats.bad_fcs == 0 && dfr[i].stats.resync_bytes == 0, "RX: stream bytes in order");
+  }
+
+  /* TX: the node sends, every peer reads its frames back */
+  bad = 0;
+  uint32_t tx_sent[NPORTS] = {0}, tx_got[NPORTS] = {0};
+  L2Deframer_t pdfr[NPTY];
+  for (int i = 0; i < NPTY; i++) {
+    L2Deframer_init(&pdfr[i], 16 * sizeof(L2Frame), true);
+    fcntl(peer[i], F_SETFL, fcntl(peer[i], F_GETFL) | O_NONBLOCK);
+  }
+  for (int i = NPTY; i < NPORTS; i++) {
+    fcntl(peer[i], F_SETFL, fcntl(peer[i], F_GETFL) | O_NONBLOCK);
+  }
+  uint32_t total = 0;
+  t_end = now_sec() + 10;
+  while (total < (uint32_t)NPORTS * NFRAMES && now_sec() < t_end) {
+    for (int i = 0; i < NPORTS; i++) {
+      while (tx_sent[i] < NFRAMES && tx_sent[i] - tx_got[i] < 32) {
+        L2PoolBuf_t *b = ORBITRadio_get(&r);
+        if (b == NULL) {
+          break;
+        }
+        make_frame(&b->frame, (uint16_t)i, tx_sent[i]);
+        if (!ORBITRadio_send(&r, (uint16_t)i, b)) {
+          break;
+        }
+        tx_sent[i]++;
+      }
+    }
+    int n = ORBITRadio_poll(&r, ev, 64, 0);
+    bad += n < 0;
+    for (int k = 0; k < n; k++) {
+      bad += ev[k].type != ORBITRADIO_EV_RX;
+      if (ev[k].buf != NULL) {
+        ORBITRadio_put(&r, ev[k].buf);
+      }
+    }
+    for (int i = 0; i < NPORTS; i++) {
+      if (i < NPTY) {
+        size_t room;
+        uint8_t *w = L2Deframer_wbuf(&pdfr[i], &room);
+        ssize_t rd = room ? read(peer[i], w, room) : 0;
+        L2Deframer_commit(&pdfr[i], rd > 0 ? (size_t)rd : 0);
+        const L2Frame *views[16];
+        size_t m = L2Deframer_poll(&pdfr[i], views, 16);
+        for (size_t j = 0; j < m; j++) {
+          bad += ORBIT_load_be16(views[j]->Payload) != i || ORBIT_load_be32(views[j]->Payload + 2) != tx_got[i]++;
+        }
+        total += (uint32_t)m;
+        L2Deframer_release(&pdfr[i]);
+      } else {
+        while (recv(peer[i], &f, sizeof(f), 0) == sizeof(f)) {
+          bad += !L2CRC32_check(&f) || ORBIT_load_be16(f.Payload) != i || ORBIT_load_be32(f.Payload + 2) != tx_got[i]++;
+          total++;
+        }
+      }
+    }
+  }
+  CHECK(total == (uint32_t)NPORTS * NFRAMES, "TX: every frame reached its peer");
+  CHECK(bad == 0, "TX: in order, intact");
+  uint64_t tx_frames = 0;
+  for (int i = 0; i < NPORTS; i++) {
+    tx_frames += r.port[i].stats.tx_frames;
+  }
+  CHECK(tx_frames == (uint64_t)NPORTS * NFRAMES, "TX: stats");
+
+  /* hang-up: the peer side of pty 1 closes */
+  close(peer[1]);
+  peer[1] = -1;
+  int errs = 0, err_port = -1;
+  t_end = now_sec() + 5;
+  while (errs == 0 && now_sec() < t_end) {
+    int n = ORBITRadio_poll(&r, ev, 64, 50);
+    for (int k = 0; k < n; k++) {
+      if (ev[k].type == ORBITRADIO_EV_ERR) {
+        errs++;
+        err_port = ev[k].port;
+      } else if (ev[k].buf != NULL) {
+        ORBITRadio_put(&r, ev[k].buf);
+      }
+    }
+  }
+  CHECK(errs == 1 && err_port == 1 && !r.port[1].up, "hang-up reported once, port down");
+  L2PoolBuf_t *b = ORBITRadio_get(&r);
+  CHECK(b != NULL && !ORBITRadio_send(&r, 1, b), "send on a down port refused");
+
+  ORBITRadio_free(&r);
+  CHECK(atomic_load(&pool.free_count) == pool.count, "every buffer back in the pool");
+  for (int i = 0; i < NPORTS; i++) {
+    close(node[i]);
+    if (peer[i] >= 0) {
+      close(peer[i]);
+    }
+    L2Deframer_free(&dfr[i]);
+  }
+  for (int i = 0; i < NPTY; i++) {
+    L2Deframer_free(&pdfr[i]);
+  }
+  L2Pool_free(&pool);
+  return fail;
+}
+
+
+/* Node-side cost only: peers' send / recv are outside the timed calls */
+static void bench(ORBITRadioBackend_t backend, int ifaces, double *rx_rate, double *tx_rate, double *rx_sys,
+                  double *tx_sys) {
+  L2Pool_t pool;
+  ORBITRadio_t r;
+  ORBITRadioConfig_t cfg = { .backend = backend, .rx_depth = BENCH_BURST, .tx_depth = BENCH_BURST };
+  int node[16], peer[16];
+  L2Frame f;
+  ORBITRadioEvent_t ev[256];
+  enum { ROUNDS = 300 };
+
+  L2Pool_init(&pool, 4096);
+  ORBITRadio_init(&r, &cfg, &pool);
+  for (int i = 0; i < ifaces; i++) {
+    node[i] = open_udp(&peer[i]);
+    ORBITRadio_add_port(&r, node[i], ORBITRADIO_DGRAM);
+    fcntl(peer[i], F_SETFL, fcntl(peer[i], F_GETFL) | O_NONBLOCK);
+  }
+  make_frame(&f, 0, 0);
+  ORBITRadio_poll(&r, ev, 256, 0);          // post the reads
+
+  double t_rx = 0, t_tx = 0;
+  uint64_t rx = 0, tx = 0, sys_rx = 0, sys_tx = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < ifaces; i++) {
+      for (int k = 0; k < BENCH_BURST; k++) {
+        send(peer[i], &f, sizeof(f), 0);
+      }
+    }
+    uint64_t want = rx + (uint64_t)ifaces * BENCH_BURST, s0 = r.syscalls;
+    double t0 = now_sec();
+    for (int spin = 0; rx < want && spin < 100000; spin++) {
+      int n = ORBITRadio_poll(&r, ev, 256, 100);
+      for (int k = 0; k < n; k++) {
+        rx += ev[k].type == ORBITRADIO_EV_RX;
+        if (ev[k].buf != NULL) {
+          ORBITRadio_put(&r, ev[k].buf);
+        }
+      }
+    }
+    t_rx += now_sec() - t0;
+    sys_rx += r.syscalls - s0;
+
+    s0 = r.syscalls;
+    uint64_t before = 0, after = 0;
+    for (int i = 0; i < ifaces; i++) {
+      before += r.port[i].stats.tx_frames;
+    }
+    t0 = now_sec();
+    for (int i = 0; i < ifaces; i++) {
+      for (int k = 0; k < BENCH_BURST; k++) {
+        L2PoolBuf_t *b = ORBITRadio_get(&r);
+        if (b != NULL) {
+          memcpy(&b->frame, &f, sizeof(f));
+          ORBITRadio_send(&r, (uint16_t)i, b);
+        }
+      }
+    }
+    for (int spin = 0; after < before + (uint64_t)ifaces * BENCH_BURST && spin < 100000; spin++) {
+      int n = ORBITRadio_poll(&r, ev, 256, 0);
+      for (int k = 0; k < n; k++) {
+        if (ev[k].buf != NULL) {
+          ORBITRadio_put(&r, ev[k].buf);
+        }
+      }
+      after = 0;
+      for (int i = 0; i < ifaces; i++) {
+        after += r.port[i].stats.tx_frames;
+      }
+    }
+    t_tx += now_sec() - t0;
+    sys_tx += r.syscalls - s0;
+    tx += after - before;
+    for (int i = 0; i < ifaces; i++) {
+      while (recv(peer[i], &f, sizeof(f), 0) > 0) {
+      }
+    }
+  }
+  *rx_rate = rx / t_rx;
+  *tx_rate = tx / t_tx;
+  *rx_sys = (double)sys_rx / (rx ? rx : 1);
+  *tx_sys = (double)sys_tx / (tx ? tx : 1);
+  ORBITRadio_free(&r);
+  for (int i = 0; i < ifaces; i++) {
+    close(node[i]);
+    close(peer[i]);
+  }
+  L2Pool_free(&pool);
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  bool uring = ORBITRadio_uring_supported();
+  if (uring) {
+    fail |= run_backend(ORBITRADIO_URING);
+  } else {
+    printf("io_uring not available, skipped\n");
+  }
+  fail |= run_backend(ORBITRADIO_EPOLL);
+
+  /* AUTO resolves to io_uring when the kernel has it */
+  L2Pool_t pool;
+  ORBITRadio_t r;
+  ORBITRadioConfig_t cfg = { .backend = ORBITRADIO_AUTO };
+  L2Pool_init(&pool, 64);
+  CHECK(ORBITRadio_init(&r, &cfg, &pool) == 0 && r.backend == (uring ? ORBITRADIO_URING : ORBITRADIO_EPOLL),
+        "AUTO backend");
+  ORBITRadio_free(&r);
+  L2Pool_free(&pool);
+
+  /* epoll teardown: queued frames go back to the pool once, port up or after a write error */
+  signal(SIGPIPE, SIG_IGN);
+  for (int broken = 0; broken < 2; broken++) {
+    int sv[2];
+    L2PoolBuf_t *queued[3], *held[3] = { NULL, NULL, NULL };
+    cfg.backend = ORBITRADIO_EPOLL;
+    L2Pool_init(&pool, 64);
+    CHECK(ORBITRadio_init(&r, &cfg, &pool) == 0 && socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0 &&
+          ORBITRadio_add_port(&r, sv[0], ORBITRADIO_STREAM) == 0, "teardown: setup");
+    if (broken) {
+      close(sv[1]);
+    }
+    for (int i = 0; i < 3; i++) {
+      queued[i] = ORBITRadio_get(&r);
+      make_frame(&queued[i]->frame, 0, (uint32_t)i);
+      CHECK(ORBITRadio_send(&r, 0, queued[i]), "teardown: queued");
+    }
+    if (broken) {
+      ORBITRadioEvent_t ev[4];
+      ORBITRadio_flush(&r);
+      CHECK(ORBITRadio_poll(&r, ev, 4, 0) == 1 && ev[0].type == ORBITRADIO_EV_ERR && ev[0].res == -EPIPE,
+            "teardown: EPIPE reported");
+      for (int i = 0; i < 3; i++) {
+        held[i] = ORBITRadio_get(&r);
+      }
+    }
+    ORBITRadio_free(&r);
+    int refs_bad = 0;
+    for (int i = 0; i < 3; i++) {
+      refs_bad += broken ? atomic_load(&held[i]->refcnt) != 1 : atomic_load(&queued[i]->refcnt) != 0;
+    }
+    CHECK(refs_bad == 0, broken ? "teardown after EPIPE: held buffers untouched" : "teardown: queued put once");
+    CHECK(atomic_load(&pool.free_count) == pool.count - (broken ? 3 : 0),
+          broken ? "teardown after EPIPE: pool count" : "teardown: pool count");
+    close(sv[0]);
+    if (!broken) {
+      close(sv[1]);
+    }
+    L2Pool_free(&pool);
+  }
+
+  printf("\nUDP loopback, %d-frame bursts per interface, node side only (one core):\n", BENCH_BURST);
+  printf("%-9s %6s %14s %10s %14s %10s\n", "backend", "ifaces", "RX frames/s", "sys/frame", "TX frames/s",
+         "sys/frame");
+  static const int widths[] = { 1, 2, 4, 8, 16 };
+  for (int b = uring ? 0 : 1; b < 2; b++) {
+    ORBITRadioBackend_t be = b == 0 ? ORBITRADIO_URING : ORBITRADIO_EPOLL;
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+      double rx, tx, rs, ts;
+      bench(be, widths[w], &rx, &tx, &rs, &ts);
+      printf("%-9s %6d %14.0f %10.3f %14.0f %10.3f\n", ORBITRadio_backend_name(be), widths[w], rx, rs, tx, ts);
+    }
+  }
+
+  printf("\nORBIT Radio I/O Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/*
+ * File:        test/orbit_wheel_test.c
+ * Author:      KaliAssistant <work.kaliassistant.github@gmail.com>
+ * URL:         https://github.com/KaliAssistant/Radio_ORBIT
+ * Licence:     GNU/GPLv3.0
+ *
+ * Description:
+ *    ORBIT Timing Wheel Test Program.
+ *    Random schedule / extend / cancel / advance against a brute-force
+ *    model (every timer fires exactly once, at its tick), lazy extension,
+ *    far deadlines, and expiry cost per timer for growing timer counts
+ *    against a linear scan of last_seen.
+ *
+ * NOTE:
+ *   - This program only tested on Debian GNU/Linux.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+#include "../src/ORBIT_wheel.h"
+
+#define CHECK(cond, msg) do { if (!(cond)) { printf("FAIL: %s\n", msg); fail = 1; } } while (0)
+#define NTIMER 2048
+#define NSTEP  20000
+#define TICK   10
+
+
+typedef struct {
+  uint64_t *expect;                       // tick it must fire at, 0 = not armed
+  uint64_t  errors;
+  uint64_t  fired;
+} Model_t;
+
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng_state;
+
+static inline uint64_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static void model_fire(void *_ctx, uint32_t _id, uint64_t _now) {
+  Model_t *m = _ctx;
+  if (m->expect[_id] == 0 || m->expect[_id] * TICK != _now) {
+    m->errors++;
+  }
+  m->expect[_id] = 0;
+  m->fired++;
+}
+
+static void count_fire(void *_ctx, uint32_t _id, uint64_t _now) {
+  (void)_id;
+  (void)_now;
+  (*(uint64_t *)_ctx)++;
+}
+
+/* Tick a (re)arm at time _when fires at, seen from wheel tick _now */
+static uint64_t model_tick(uint64_t _when, uint64_t _now) {
+  uint64_t tk = (_when + TICK - 1) / TICK;
+  return tk > _now ? tk : _now + 1;
+}
+
+
+int main() {
+  int fail = 0;
+  if (getrandom(&rng_state, sizeof(rng_state), 0) != sizeof(rng_state)) {
+    perror("getrandom failed");
+    return EXIT_FAILURE;
+  }
+  rng_state |= 1;
+
+  ORBITWheel_t w;
+  Model_t m = { calloc(NTIMER, sizeof(uint64_t)), 0, 0 };
+  CHECK(ORBITWheel_init(&w, NTIMER, TICK, 12345) == 0, "init");
+
+  /* 1. random operations against the model; deltas span every level */
+  uint64_t now = 12345, armed = 0;
+  for (int step = 0; step < NSTEP; step++) {
+    for (int k = 0; k < 8; k++) {
+      uint32_t id = (uint32_t)(rng() % NTIMER);
+      uint64_t span = 1ull << (rng() % 30);
+      uint64_t back = rng() % 4 == 0 ? span / 8 : 0;
+      uint64_t when = now + (rng() % (span + 1)) - (back < now ? back : now);
+      switch (rng() % 4) {
+        case 0:
+          ORBITWheel_cancel(&w, id);
+          m.expect[id] = 0;
+          break;
+        case 1:
+          ORBITWheel_extend(&w, id, when);
+          m.expect[id] = model_tick(when, w.now);
+          break;
+        default:
+          ORBITWheel_schedule(&w, id, when);
+          m.expect[id] = model_tick(when, w.now);
+          break;
+      }
+    }
+    now += rng() % 4 == 0 ? rng() % (1ull << (rng() % 26)) : rng() % (8 * TICK);
+    ORBITWheel_advance(&w, now, model_fire, &m);
+  }
+  armed = 0;
+  for (uint32_t i = 0; i < NTIMER; i++) {
+    armed += m.expect[i] != 0;
+    if ((m.expect[i] != 0) != ORBITWheel_armed(&w, i) || (m.expect[i] != 0 && m.expect[i] * TICK <= now)) {
+      m.errors++;
+    }
+  }
+  printf("random: %llu fired, %llu armed, %llu cascaded, %llu deferred, %llu errors\n",
+         (unsigned long long)m.fired, (unsigned long long)armed, (unsigned long long)w.cascaded,
+         (unsigned long long)w.deferred, (unsigned long long)m.errors);
+  CHECK(m.errors == 0, "every timer fires once, at its tick");
+  CHECK(w.armed == armed, "armed count");
+  CHECK(m.fired == w.fired, "fired count");
+
+  /* drain: everything left fires by the furthest deadline */
+  ORBITWheel_advance(&w, UINT64_MAX / 2, model_fire, &m);
+  CHECK(w.armed == 0 && m.errors == 0, "drain");
+  ORBITWheel_free(&w);
+
+  /* 2. lazy extension: refreshing every tick moves each timer once per timeout at most */
+  CHECK(ORBITWheel_init(&w, NTIMER, 1, 0) == 0, "init lazy");
+  uint64_t fired = 0;
+  for (uint32_t i = 0; i < NTIMER; i++) {
+    ORBITWheel_schedule(&w, i, 1000);
+  }
+  for (uint64_t t = 1; t <= 10000; t++) {
+    for (uint32_t i = 0; i < NTIMER; i += 16) {
+      ORBITWheel_extend(&w, (uint32_t)(i + t % 16), t + 1000);
+    }
+    ORBITWheel_advance(&w, t, count_fire, &fired);
+  }
+  printf("lazy: %d refreshes, %llu deferred, %llu cascaded, %llu fired\n", 10000 * NTIMER / 16,
+         (unsigned long long)w.deferred, (unsigned long long)w.cascaded, (unsigned long long)fired);
+  CHECK(fired == 0, "refreshed timers never fire");
+  CHECK(w.deferred + w.cascaded <= (uint64_t)NTIMER * 3 * (10000 / 1000 + 1), "refresh is a store, not a move");
+  ORBITWheel_free(&w);
+
+  /* 3. beyond the top level */
+  CHECK(ORBITWheel_init(&w, 2, 1, 0) == 0, "init far");
+  ORBITWheel_schedule(&w, 0, 1ull << 40);
+  ORBITWheel_schedule(&w, 1, (1ull << 40) + 1);
+  fired = 0;
+  ORBITWheel_advance(&w, (1ull << 40) - 1, count_fire, &fired);
+  CHECK(fired == 0 && w.armed == 2, "far timers wait");
+  ORBITWheel_advance(&w, 1ull << 40, count_fire, &fired);
+  CHECK(fired == 1, "far timer fires on time");
+  ORBITWheel_advance(&w, (1ull << 40) + 1, count_fire, &fired);
+  CHECK(fired == 2 && w.armed == 0, "far timer after it");
+  ORBITWheel_free(&w);
+
+  /* 4. cost per expiry for 1k .. 1M timers vs scanning last_seen every tick */
+  printf("\n%9s %14s %14s %14s\n", "timers", "schedule ns", "expiry ns/tmr", "scan ns/tick");
+  double first = 0, last = 0;
+  for (uint32_t n = 1024; n <= (1u << 20); n <<= 5) {
+    uint64_t *last_seen = malloc((size_t)n * sizeof(uint64_t));
+    CHECK(ORBITWheel_init(&w, n, 1, 0) == 0, "init bench");
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < n; i++) {
+      last_seen[i] = rng() % 100000;
+      ORBITWheel_schedule(&w, i, last_seen[i] + 100000);
+    }
+    double t1 = now_sec();
+    fired = 0;
+    ORBITWheel_advance(&w, 200000, count_fire, &fired);
+    double t2 = now_sec();
+    uint64_t stale = 0;
+    for (int k = 0; k < 64; k++) {
+      for (uint32_t i = 0; i < n; i++) {
+        stale += last_seen[i] + 100000 <= (uint64_t)(150000 + k);
+      }
+    }
+    double t3 = now_sec();
+    double per = (t2 - t1) * 1e9 / n;
+    printf("%9u %14.1f %14.1f %14.0f   (%llu stale)\n", n, (t1 - t0) * 1e9 / n, per, (t3 - t2) * 1e9 / 64,
+           (unsigned long long)stale);
+    CHECK(fired == n, "every bench timer fired");
+    CHECK(w.cascaded <= (uint64_t)n * ORBITWHEEL_LEVELS, "each timer cascades at most once per level");
+    first = first == 0 ? per : first;
+    last = per;
+    ORBITWheel_free(&w);
+    free(last_seen);
+  }
+  CHECK(last < first * 16, "expiry cost per timer does not grow with the table");
+
+  free(m.expect);
+  printf("\nORBIT Timing Wheel Test Program: %s\n", fail ? "FAIL" : "PASS");
+  printf("Author: KaliAssistant <work.kaliassistant.github@gmail.com>\n");
+  printf("URL:    https://github.com/KaliAssistant/Radio_ORBIT\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}